@@ -242,7 +242,8 @@ static void encode_help_display(void)
     fprintf(stdout, "-M <key value>\n");
     fprintf(stdout, "    Mode switch.\n");
     fprintf(stdout, "    [1=BYPASS(LAZY) 2=RESET 4=RESTART(TERMALL)\n");
-    fprintf(stdout, "    8=VSC 16=ERTERM(SEGTERM) 32=SEGMARK(SEGSYM)]\n");
+    fprintf(stdout, "    8=VSC 16=ERTERM(SEGTERM) 32=SEGMARK(SEGSYM)\n");
+    fprintf(stdout, "    64=HT (HTJ2K block coder, cannot be combined with others)]\n");
     fprintf(stdout, "    Indicate multiple modes by adding their values.\n");
     fprintf(stdout,
             "      Example: RESTART(4) + RESET(2) + SEGMARK(32) => -M 38\n");
@@ -315,6 +316,10 @@ static void encode_help_display(void)
     if (opj_has_thread_support()) {
         fprintf(stdout, "-threads <num_threads|ALL_CPUS>\n"
                 "    Number of threads to use for encoding or ALL_CPUS for all available cores.\n");
+        fprintf(stdout, "-tiles-in-flight <num_tiles>\n"
+                "    Number of tiles encoded concurrently, each by a single thread.\n"
+                "    Only used with -threads and several tiles. Tiles are written in\n"
+                "    tile order, or in the order they are finished with -TLM.\n");
     }
     /* UniPG>> */
 #ifdef USE_JPWL
@@ -617,6 +622,7 @@ static int parse_cmdline_encoder(int argc, char **argv,
                                  OPJ_BOOL* pOutTLM,
                                  int* pOutGuardBits,
                                  int* pOutNumThreads,
+                                 int* pOutTilesInFlight,
                                  unsigned int* pTarget_bitdepth)
 {
     OPJ_UINT32 i, j;
@@ -637,6 +643,7 @@ static int parse_cmdline_encoder(int argc, char **argv,
         {"PLT", NO_ARG, NULL, 'A'},
         {"threads",   REQ_ARG, NULL, 'B'},
         {"TLM", NO_ARG, NULL, 'D'},
+        {"tiles-in-flight", REQ_ARG, NULL, 'N'},
         {"TargetBitDepth", REQ_ARG, NULL, 'X'},
         {"GuardBits", REQ_ARG, NULL, 'G'}
     };
@@ -1100,7 +1107,7 @@ static int parse_cmdline_encoder(int argc, char **argv,
         case 'M': {         /* Mode switch pas tous au point !! */
             int value = 0;
             if (sscanf(opj_optarg, "%d", &value) == 1) {
-                for (i = 0; i <= 5; i++) {
+                for (i = 0; i <= 6; i++) {
                     int cache = value & (1 << i);
                     if (cache) {
                         parameters->mode |= (1 << i);
@@ -1762,6 +1769,13 @@ static int parse_cmdline_encoder(int argc, char **argv,
 
         /* ------------------------------------------------------ */
 
+        case 'N': {         /* Number of tiles encoded concurrently */
+            sscanf(opj_optarg, "%d", pOutTilesInFlight);
+        }
+        break;
+
+        /* ------------------------------------------------------ */
+
 
         default:
             fprintf(stderr, "[WARNING] An invalid option has been ignored\n");
@@ -1944,6 +1958,7 @@ int main(int argc, char **argv)
     OPJ_BOOL PLT = OPJ_FALSE;
     OPJ_BOOL TLM = OPJ_FALSE;
     int num_threads = 0;
+    int tiles_in_flight = 0;
     int guard_bits = -1;
 
     /** desired bitdepth from input file */
@@ -1969,7 +1984,8 @@ int main(int argc, char **argv)
                          255; /* This will be set later according to the input image or the provided option */
     if (parse_cmdline_encoder(argc, argv, &parameters, &img_fol, &raw_cp,
                               indexfilename, sizeof(indexfilename), &framerate, &PLT, &TLM,
-                              &guard_bits, &num_threads, &target_bitdepth) == 1) {
+                              &guard_bits, &num_threads, &tiles_in_flight,
+                              &target_bitdepth) == 1) {
         ret = 1;
         goto fin;
     }
@@ -2215,9 +2231,10 @@ int main(int argc, char **argv)
         }
 
         {
-            const char* options[4] = { NULL, NULL, NULL, NULL };
+            const char* options[5] = { NULL, NULL, NULL, NULL, NULL };
             int iOpt = 0;
             char szGuardBits[32];
+            char szTilesInFlight[32];
             if (PLT) {
                 options[iOpt++] = "PLT=YES";
             }
@@ -2228,6 +2245,10 @@ int main(int argc, char **argv)
                 sprintf(szGuardBits, "GUARD_BITS=%d", guard_bits);
                 options[iOpt++] = szGuardBits;
             }
+            if (tiles_in_flight > 1) {
+                sprintf(szTilesInFlight, "TILES_IN_FLIGHT=%d", tiles_in_flight);
+                options[iOpt++] = szTilesInFlight;
+            }
             if (iOpt > 0 && !opj_encoder_set_extra_options(l_codec, options)) {
                 fprintf(stderr, "failed to encode image: opj_encoder_set_extra_options\n");
                 opj_destroy_codec(l_codec);
@@ -151,6 +151,8 @@ typedef struct opj_decompress_params {
     int split_pnm;
     /** number of threads */
     int num_threads;
+    /** number of tiles decoded concurrently */
+    int tiles_in_flight;
     /* Quiet */
     int quiet;
     /* Allow partial decode */
@@ -247,6 +249,9 @@ static void decode_help_display(void)
     if (opj_has_thread_support()) {
         fprintf(stdout, "  -threads <num_threads|ALL_CPUS>\n"
                 "    Number of threads to use for decoding or ALL_CPUS for all available cores.\n");
+        fprintf(stdout, "  -tiles-in-flight <num_tiles>\n"
+                "    Number of tiles decoded concurrently, each by a single thread.\n"
+                "    Only used with -threads and images made of several tiles.\n");
     }
     fprintf(stdout, "  -allow-partial\n"
             "    Disable strict mode to allow decoding partial codestreams.\n");
@@ -606,6 +611,7 @@ int parse_cmdline_decoder(int argc, char **argv,
         {"threads",   REQ_ARG, NULL, 'T'},
         {"quiet", NO_ARG,  NULL, 1},
         {"allow-partial", NO_ARG,  NULL, 1},
+        {"tiles-in-flight", REQ_ARG, NULL, 'N'},
     };
 
     const char optlist[] = "i:o:r:l:x:d:t:p:c:"
@@ -919,6 +925,12 @@ int parse_cmdline_decoder(int argc, char **argv,
         }
         break;
 
+        /* ----------------------------------------------------- */
+        case 'N': { /* Number of tiles decoded concurrently */
+            sscanf(opj_optarg, "%d", &parameters->tiles_in_flight);
+        }
+        break;
+
         /* ----------------------------------------------------- */
 
         default:
@@ -1516,6 +1528,21 @@ int main(int argc, char **argv)
             goto fin;
         }
 
+        if (parameters.tiles_in_flight > 1) {
+            char szTilesInFlight[32];
+            const char* options[2] = { NULL, NULL };
+            sprintf(szTilesInFlight, "TILES_IN_FLIGHT=%d", parameters.tiles_in_flight);
+            options[0] = szTilesInFlight;
+            if (!opj_decoder_set_extra_options(l_codec, options)) {
+                fprintf(stderr,
+                        "ERROR -> opj_decompress: failed to set number of tiles in flight\n");
+                opj_stream_destroy(l_stream);
+                opj_destroy_codec(l_codec);
+                failed = 1;
+                goto fin;
+            }
+        }
+
         /* Read the main header of the codestream and if necessary the JP2 boxes*/
         if (! opj_read_header(l_stream, l_codec, &image)) {
             fprintf(stderr, "ERROR -> opj_decompress: failed to read the header\n");
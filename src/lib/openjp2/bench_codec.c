@@ -0,0 +1,795 @@
+/*
+ * Copyright (c) 2026, OpenJPEG contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS `AS IS'
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Per-stage benchmark of the decoder.
+ *
+ * Each codestream is decoded tile after tile, running the stages of
+ * opj_tcd_decode_tile_stage() one at a time, so that Tier-2, Tier-1 (MQ or
+ * HT), inverse DWT, MCT, DC level shift and the copy to the output image
+ * (opj_j2k_update_image_data()) are timed in isolation. The main header
+ * parsing and the whole decoding through the public API are timed too, as
+ * well as the MQ decoder alone on a synthetic stream of symbols.
+ *
+ * The best time of several iterations is kept for each stage. Results are
+ * printed as a table, and can be written as JSON to be compared against a
+ * reference run with tests/performance/compare_perfs.py.
+ */
+
+#include "opj_includes.h"
+
+#define MAX_THREAD_COUNTS   16
+#define MAX_INPUTS          64
+#define MQ_NUM_SYMBOLS      (1U << 22)
+
+/** A codestream to benchmark, held in memory */
+typedef struct bench_input {
+    char name[256];
+    OPJ_BYTE* data;
+    OPJ_SIZE_T size;
+    OPJ_CODEC_FORMAT format;
+} bench_input_t;
+
+/** Growable buffer, used as the output stream of the encoder */
+typedef struct bench_buffer {
+    OPJ_BYTE* data;
+    OPJ_SIZE_T size;
+    OPJ_SIZE_T capacity;
+    OPJ_SIZE_T pos;
+} bench_buffer_t;
+
+/** Measure of one stage */
+typedef struct bench_result {
+    char codestream[256];
+    int threads;
+    char stage[32];
+    int iterations;
+    OPJ_FLOAT64 time_ms;
+    OPJ_FLOAT64 msamples_per_s;
+} bench_result_t;
+
+static bench_result_t* results = NULL;
+static OPJ_SIZE_T num_results = 0;
+static int iterations = 3;
+
+static void usage(void)
+{
+    printf(
+        "bench_codec [-i file]* [-generate] [-size val] [-threads n1,n2,...]\n");
+    printf(
+        "            [-iterations val] [-json file]\n");
+    printf(
+        "Times each stage of the decoding of the input codestreams (J2K or\n");
+    printf(
+        "JP2). -i can be repeated. Without -i, or with -generate, codestreams\n");
+    printf(
+        "of val x val pixels (1024 by default) are generated with the 5x3 and\n");
+    printf(
+        "9x7 filters, and with MQ and HT code-blocks.\n");
+    printf(
+        "-threads gives the thread counts to run with (1 and the number of\n");
+    printf(
+        "CPUs by default).\n");
+    printf(
+        "-iterations runs each stage several times (3 by default), and keeps\n");
+    printf(
+        "the best time.\n");
+    printf(
+        "-json writes the results to a file, that can be compared with\n");
+    printf(
+        "another one with tests/performance/compare_perfs.py.\n");
+    exit(1);
+}
+
+static void quiet_callback(const char *msg, void *client_data)
+{
+    (void)msg;
+    (void)client_data;
+}
+
+static void error_callback(const char *msg, void *client_data)
+{
+    (void)client_data;
+    fprintf(stderr, "[ERROR] %s", msg);
+}
+
+static void set_handlers(opj_codec_t *codec)
+{
+    opj_set_info_handler(codec, quiet_callback, NULL);
+    opj_set_warning_handler(codec, quiet_callback, NULL);
+    opj_set_error_handler(codec, error_callback, NULL);
+}
+
+static void add_result(const char* codestream, int threads, const char* stage,
+                       OPJ_FLOAT64 time_s, OPJ_UINT64 samples)
+{
+    bench_result_t* result;
+
+    results = (bench_result_t*)opj_realloc(results,
+                                           (num_results + 1) * sizeof(bench_result_t));
+    if (results == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        exit(1);
+    }
+    result = &results[num_results++];
+    snprintf(result->codestream, sizeof(result->codestream), "%s", codestream);
+    result->threads = threads;
+    snprintf(result->stage, sizeof(result->stage), "%s", stage);
+    result->iterations = iterations;
+    result->time_ms = time_s * 1e3;
+    result->msamples_per_s = time_s > 0 ? (OPJ_FLOAT64)samples / time_s * 1e-6 :
+                             0;
+
+    printf("%-24s %7d  %-12s %12.3f %12.2f\n", result->codestream,
+           result->threads, result->stage, result->time_ms,
+           result->msamples_per_s);
+    fflush(stdout);
+}
+
+/* ----------------------------------------------------------------------- */
+/* Generation of the codestreams */
+
+static OPJ_SIZE_T buffer_write(void* p_buffer, OPJ_SIZE_T p_nb_bytes,
+                               void* p_user_data)
+{
+    bench_buffer_t* buf = (bench_buffer_t*)p_user_data;
+    if (buf->pos + p_nb_bytes > buf->capacity) {
+        OPJ_SIZE_T capacity = (buf->pos + p_nb_bytes) * 2;
+        OPJ_BYTE* data = (OPJ_BYTE*)opj_realloc(buf->data, capacity);
+        if (data == NULL) {
+            return (OPJ_SIZE_T) - 1;
+        }
+        buf->data = data;
+        buf->capacity = capacity;
+    }
+    memcpy(buf->data + buf->pos, p_buffer, p_nb_bytes);
+    buf->pos += p_nb_bytes;
+    if (buf->pos > buf->size) {
+        buf->size = buf->pos;
+    }
+    return p_nb_bytes;
+}
+
+static OPJ_OFF_T buffer_skip(OPJ_OFF_T p_nb_bytes, void* p_user_data)
+{
+    bench_buffer_t* buf = (bench_buffer_t*)p_user_data;
+    buf->pos += (OPJ_SIZE_T)p_nb_bytes;
+    return p_nb_bytes;
+}
+
+static OPJ_BOOL buffer_seek(OPJ_OFF_T p_nb_bytes, void* p_user_data)
+{
+    bench_buffer_t* buf = (bench_buffer_t*)p_user_data;
+    buf->pos = (OPJ_SIZE_T)p_nb_bytes;
+    return OPJ_TRUE;
+}
+
+/* Creates a RGB image made of smooth gradients with some noise */
+static opj_image_t* create_image(OPJ_UINT32 size)
+{
+    opj_image_cmptparm_t cmptparm[3];
+    opj_image_t *image;
+    OPJ_UINT32 compno, x, y;
+    OPJ_UINT32 seed = 12345;
+
+    memset(cmptparm, 0, sizeof(cmptparm));
+    for (compno = 0; compno < 3; ++compno) {
+        cmptparm[compno].dx = 1;
+        cmptparm[compno].dy = 1;
+        cmptparm[compno].w = size;
+        cmptparm[compno].h = size;
+        cmptparm[compno].prec = 8;
+    }
+    image = opj_image_create(3, cmptparm, OPJ_CLRSPC_SRGB);
+    if (image == NULL) {
+        return NULL;
+    }
+    image->x1 = size;
+    image->y1 = size;
+    for (compno = 0; compno < 3; ++compno) {
+        OPJ_INT32* data = image->comps[compno].data;
+        for (y = 0; y < size; ++y) {
+            for (x = 0; x < size; ++x) {
+                OPJ_UINT32 v = ((x + y * (compno + 1)) * 255U) / (3U * size);
+                seed = seed * 1103515245U + 12345U;
+                v += (seed >> 16) & 15U;
+                data[(OPJ_SIZE_T)y * size + x] = (OPJ_INT32)opj_uint_min(v, 255U);
+            }
+        }
+    }
+    return image;
+}
+
+static OPJ_BOOL generate_input(bench_input_t* input, OPJ_UINT32 size,
+                               OPJ_BOOL irreversible, OPJ_BOOL ht)
+{
+    opj_cparameters_t parameters;
+    opj_codec_t *codec;
+    opj_stream_t *stream;
+    opj_image_t *image;
+    bench_buffer_t buf;
+    OPJ_BOOL ret = OPJ_FALSE;
+
+    image = create_image(size);
+    if (image == NULL) {
+        return OPJ_FALSE;
+    }
+
+    opj_set_default_encoder_parameters(&parameters);
+    parameters.irreversible = irreversible;
+    parameters.tcp_mct = 1;
+    if (ht) {
+        parameters.mode = J2K_CCP_CBLKSTY_HT;
+    }
+
+    memset(&buf, 0, sizeof(buf));
+    codec = opj_create_compress(OPJ_CODEC_J2K);
+    set_handlers(codec);
+    stream = opj_stream_create(OPJ_J2K_STREAM_CHUNK_SIZE, OPJ_FALSE);
+    if (stream != NULL && opj_setup_encoder(codec, &parameters, image)) {
+        opj_stream_set_user_data(stream, &buf, NULL);
+        opj_stream_set_write_function(stream, buffer_write);
+        opj_stream_set_skip_function(stream, buffer_skip);
+        opj_stream_set_seek_function(stream, buffer_seek);
+        ret = opj_start_compress(codec, image, stream) &&
+              opj_encode(codec, stream) &&
+              opj_end_compress(codec, stream);
+    }
+    opj_stream_destroy(stream);
+    opj_destroy_codec(codec);
+    opj_image_destroy(image);
+
+    if (!ret) {
+        opj_free(buf.data);
+        return OPJ_FALSE;
+    }
+    snprintf(input->name, sizeof(input->name), "gen_%u_%s_%s", size,
+             irreversible ? "97" : "53", ht ? "ht" : "mq");
+    input->data = buf.data;
+    input->size = buf.size;
+    input->format = OPJ_CODEC_J2K;
+    return OPJ_TRUE;
+}
+
+static OPJ_BOOL read_input(bench_input_t* input, const char* filename)
+{
+    FILE* f = fopen(filename, "rb");
+    const char* basename;
+    long size;
+
+    if (f == NULL) {
+        fprintf(stderr, "Cannot open %s\n", filename);
+        return OPJ_FALSE;
+    }
+    fseek(f, 0, SEEK_END);
+    size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    input->data = (OPJ_BYTE*)opj_malloc(size > 0 ? (OPJ_SIZE_T)size : 1);
+    if (input->data == NULL || size < 4 ||
+            fread(input->data, 1, (OPJ_SIZE_T)size, f) != (OPJ_SIZE_T)size) {
+        fprintf(stderr, "Cannot read %s\n", filename);
+        fclose(f);
+        opj_free(input->data);
+        input->data = NULL;
+        return OPJ_FALSE;
+    }
+    fclose(f);
+    input->size = (OPJ_SIZE_T)size;
+    /* A J2K codestream starts with SOC followed by SIZ */
+    input->format = (input->data[0] == 0xFF && input->data[1] == 0x4F &&
+                     input->data[2] == 0xFF && input->data[3] == 0x51) ?
+                    OPJ_CODEC_J2K : OPJ_CODEC_JP2;
+    basename = strrchr(filename, '/');
+    snprintf(input->name, sizeof(input->name), "%s",
+             basename ? basename + 1 : filename);
+    return OPJ_TRUE;
+}
+
+/* ----------------------------------------------------------------------- */
+/* Benchmarks */
+
+static opj_codec_t* open_input(const bench_input_t* input, int threads,
+                               opj_stream_t** p_stream, opj_image_t** p_image)
+{
+    opj_dparameters_t parameters;
+    opj_codec_t* codec = opj_create_decompress(input->format);
+
+    set_handlers(codec);
+    opj_set_default_decoder_parameters(&parameters);
+    *p_stream = opj_stream_create_memory_stream(input->data, input->size);
+    *p_image = NULL;
+    if (*p_stream == NULL ||
+            !opj_setup_decoder(codec, &parameters) ||
+            !opj_codec_set_threads(codec, threads) ||
+            !opj_read_header(*p_stream, codec, p_image)) {
+        opj_stream_destroy(*p_stream);
+        opj_destroy_codec(codec);
+        return NULL;
+    }
+    return codec;
+}
+
+static OPJ_UINT64 get_num_samples(const opj_image_t* image)
+{
+    OPJ_UINT64 samples = 0;
+    OPJ_UINT32 compno;
+    for (compno = 0; compno < image->numcomps; compno++) {
+        samples += (OPJ_UINT64)image->comps[compno].w * image->comps[compno].h;
+    }
+    return samples;
+}
+
+/* Times the main header parsing, and the whole decoding with the public API */
+static OPJ_BOOL bench_decode(const bench_input_t* input, int threads,
+                             opj_image_t** p_decoded)
+{
+    OPJ_FLOAT64 best_header = 0, best_decode = 0;
+    OPJ_UINT64 samples = 0;
+    int iter;
+
+    for (iter = 0; iter < iterations; iter++) {
+        opj_stream_t* stream;
+        opj_image_t* image;
+        opj_codec_t* codec;
+        OPJ_FLOAT64 t0, t1, t2;
+
+        t0 = opj_wallclock();
+        codec = open_input(input, threads, &stream, &image);
+        t1 = opj_wallclock();
+        if (codec == NULL) {
+            return OPJ_FALSE;
+        }
+        if (!opj_decode(codec, stream, image) ||
+                !opj_end_decompress(codec, stream)) {
+            opj_image_destroy(image);
+            opj_stream_destroy(stream);
+            opj_destroy_codec(codec);
+            return OPJ_FALSE;
+        }
+        t2 = opj_wallclock();
+        if (iter == 0 || t1 - t0 < best_header) {
+            best_header = t1 - t0;
+        }
+        if (iter == 0 || t2 - t1 < best_decode) {
+            best_decode = t2 - t1;
+        }
+        samples = get_num_samples(image);
+        opj_stream_destroy(stream);
+        opj_destroy_codec(codec);
+        if (iter == 0 && p_decoded != NULL) {
+            *p_decoded = image;
+        } else {
+            opj_image_destroy(image);
+        }
+    }
+
+    add_result(input->name, threads, "markers", best_header, samples);
+    add_result(input->name, threads, "decode", best_decode, samples);
+    return OPJ_TRUE;
+}
+
+/* Times the stages of the decoding of each tile on their own */
+static OPJ_BOOL bench_stages(const bench_input_t* input, int threads,
+                             const opj_image_t* reference)
+{
+    static const char* const stage_names[OPJ_TCD_NUM_STAGES] = {
+        "tile_init", "t2", "t1", "dwt", "mct", "dc_shift"
+    };
+    OPJ_FLOAT64 total[OPJ_TCD_NUM_STAGES + 1];
+    OPJ_FLOAT64 best[OPJ_TCD_NUM_STAGES + 1];
+    opj_stream_t* stream;
+    opj_image_t* image;
+    opj_image_t* output;
+    opj_codec_t* codec;
+    opj_codec_private_t* l_codec;
+    opj_j2k_t* j2k;
+    OPJ_BYTE* tile_buffer = NULL;
+    OPJ_UINT32 tile_buffer_size = 0;
+    OPJ_BOOL ht = OPJ_FALSE;
+    OPJ_BOOL ret = OPJ_TRUE;
+    OPJ_UINT32 compno;
+    OPJ_UINT64 samples;
+    int stage;
+
+    codec = open_input(input, threads, &stream, &image);
+    if (codec == NULL) {
+        return OPJ_FALSE;
+    }
+    l_codec = (opj_codec_private_t*)codec;
+    j2k = input->format == OPJ_CODEC_J2K ? (opj_j2k_t*)l_codec->m_codec :
+          ((opj_jp2_t*)l_codec->m_codec)->j2k;
+
+    /* Output image, allocated beforehand so that the tile buffers are */
+    /* always copied, and never borrowed */
+    output = opj_image_create0();
+    opj_copy_image_header(j2k->m_private_image, output);
+    for (compno = 0; compno < output->numcomps; compno++) {
+        opj_image_comp_t* comp = &output->comps[compno];
+        comp->data = (OPJ_INT32*)opj_image_data_alloc((OPJ_SIZE_T)comp->w *
+                     comp->h * sizeof(OPJ_INT32));
+        if (comp->data == NULL) {
+            ret = OPJ_FALSE;
+        }
+    }
+    samples = get_num_samples(output);
+    memset(total, 0, sizeof(total));
+    memset(best, 0, sizeof(best));
+
+    while (ret) {
+        OPJ_UINT32 tile_index, data_size, nb_comps;
+        OPJ_INT32 tx0, ty0, tx1, ty1;
+        OPJ_BOOL go_on;
+        opj_tcp_t* tcp;
+        int iter;
+
+        if (!opj_read_tile_header(codec, stream, &tile_index, &data_size,
+                                  &tx0, &ty0, &tx1, &ty1, &nb_comps, &go_on)) {
+            ret = OPJ_FALSE;
+            break;
+        }
+        if (!go_on) {
+            break;
+        }
+        tcp = &j2k->m_cp.tcps[tile_index];
+        if (tcp->tccps[0].cblksty & J2K_CCP_CBLKSTY_HT) {
+            ht = OPJ_TRUE;
+        }
+        j2k->m_tcd->src_read_only = tcp->m_data_borrowed;
+
+        for (iter = 0; iter < iterations && ret; iter++) {
+            OPJ_FLOAT64 t0, t1;
+            for (stage = 0; stage < OPJ_TCD_NUM_STAGES; stage++) {
+                t0 = opj_wallclock();
+                if (!opj_tcd_decode_tile_stage(j2k->m_tcd,
+                                               (OPJ_TCD_DECODE_STAGE)stage,
+                                               tcp->m_data, tcp->m_data_size,
+                                               tile_index,
+                                               &l_codec->m_event_mgr)) {
+                    ret = OPJ_FALSE;
+                    break;
+                }
+                t1 = opj_wallclock();
+                if (iter == 0 || t1 - t0 < best[stage]) {
+                    best[stage] = t1 - t0;
+                }
+            }
+            if (!ret) {
+                break;
+            }
+            t0 = opj_wallclock();
+            if (!opj_j2k_update_image_data(j2k->m_tcd, output)) {
+                ret = OPJ_FALSE;
+                break;
+            }
+            t1 = opj_wallclock();
+            if (iter == 0 || t1 - t0 < best[OPJ_TCD_NUM_STAGES]) {
+                best[OPJ_TCD_NUM_STAGES] = t1 - t0;
+            }
+        }
+        if (!ret) {
+            break;
+        }
+        for (stage = 0; stage <= OPJ_TCD_NUM_STAGES; stage++) {
+            total[stage] += best[stage];
+        }
+
+        /* Decode the tile once more through the API, so that the codec */
+        /* moves to the next tile */
+        if (data_size > tile_buffer_size) {
+            OPJ_BYTE* new_buffer = (OPJ_BYTE*)opj_realloc(tile_buffer, data_size);
+            if (new_buffer == NULL) {
+                ret = OPJ_FALSE;
+                break;
+            }
+            tile_buffer = new_buffer;
+            tile_buffer_size = data_size;
+        }
+        if (!opj_decode_tile_data(codec, tile_index, tile_buffer, data_size,
+                                  stream)) {
+            ret = OPJ_FALSE;
+        }
+    }
+
+    if (ret && reference != NULL) {
+        for (compno = 0; compno < output->numcomps; compno++) {
+            const opj_image_comp_t* comp = &output->comps[compno];
+            if (memcmp(comp->data, reference->comps[compno].data,
+                       (OPJ_SIZE_T)comp->w * comp->h * sizeof(OPJ_INT32)) != 0) {
+                fprintf(stderr, "%s: stage by stage decoding does not match "
+                        "opj_decode()\n", input->name);
+                ret = OPJ_FALSE;
+            }
+        }
+    }
+
+    if (ret) {
+        for (stage = 0; stage < OPJ_TCD_NUM_STAGES; stage++) {
+            const char* name = stage_names[stage];
+            if (stage == OPJ_TCD_STAGE_T1) {
+                name = ht ? "t1_ht" : "t1_mq";
+            }
+            add_result(input->name, threads, name, total[stage], samples);
+        }
+        add_result(input->name, threads, "output", total[OPJ_TCD_NUM_STAGES],
+                   samples);
+    }
+
+    opj_free(tile_buffer);
+    opj_image_destroy(output);
+    opj_image_destroy(image);
+    opj_stream_destroy(stream);
+    opj_destroy_codec(codec);
+    return ret;
+}
+
+/* Times the MQ decoder alone, on symbols encoded with various contexts */
+/* and probabilities */
+static OPJ_BOOL bench_mq_decode(void)
+{
+    opj_mqc_t mqc_enc, mqc_dec;
+    opj_mqc_t* mqc;
+    OPJ_BYTE* ctxs = (OPJ_BYTE*)opj_malloc(MQ_NUM_SYMBOLS);
+    OPJ_BYTE* symbols = (OPJ_BYTE*)opj_malloc(MQ_NUM_SYMBOLS);
+    OPJ_BYTE* decoded = (OPJ_BYTE*)opj_malloc(MQ_NUM_SYMBOLS);
+    /* One byte before the start of the buffer is used by the encoder, and */
+    /* OPJ_COMMON_CBLK_DATA_EXTRA after its end by the decoder */
+    OPJ_BYTE* buffer = (OPJ_BYTE*)opj_calloc(1,
+                       MQ_NUM_SYMBOLS + 1 + OPJ_COMMON_CBLK_DATA_EXTRA);
+    OPJ_UINT32 i, len;
+    OPJ_UINT32 seed = 12345;
+    OPJ_FLOAT64 best = 0;
+    OPJ_BOOL ret = OPJ_TRUE;
+    int iter;
+
+    if (ctxs == NULL || symbols == NULL || decoded == NULL || buffer == NULL) {
+        ret = OPJ_FALSE;
+        goto end;
+    }
+
+    /* The probability of a 1 depends on the context */
+    for (i = 0; i < MQ_NUM_SYMBOLS; i++) {
+        OPJ_UINT32 ctxno;
+        seed = seed * 1103515245U + 12345U;
+        ctxno = (seed >> 16) % 9U;
+        seed = seed * 1103515245U + 12345U;
+        ctxs[i] = (OPJ_BYTE)ctxno;
+        symbols[i] = (OPJ_BYTE)(((seed >> 16) % 20U) <= ctxno);
+    }
+
+    mqc = &mqc_enc;
+    opj_mqc_init_enc(mqc, buffer + 1);
+    opj_mqc_resetstates(mqc);
+    {
+        DOWNLOAD_MQC_VARIABLES(mqc, curctx, a, c, ct);
+        for (i = 0; i < MQ_NUM_SYMBOLS; i++) {
+            curctx = &mqc->ctxs[ctxs[i]];
+            opj_mqc_encode_macro(mqc, curctx, a, c, ct, symbols[i]);
+        }
+        UPLOAD_MQC_VARIABLES(mqc, curctx, a, c, ct);
+    }
+    opj_mqc_flush(mqc);
+    len = opj_mqc_numbytes(mqc);
+
+    for (iter = 0; iter < iterations; iter++) {
+        OPJ_FLOAT64 t0, t1;
+
+        t0 = opj_wallclock();
+        mqc = &mqc_dec;
+        opj_mqc_init_dec(mqc, buffer + 1, len, OPJ_COMMON_CBLK_DATA_EXTRA);
+        opj_mqc_resetstates(mqc);
+        {
+            DOWNLOAD_MQC_VARIABLES(mqc, curctx, a, c, ct);
+            OPJ_UINT32 v;
+            for (i = 0; i < MQ_NUM_SYMBOLS; i++) {
+                curctx = &mqc->ctxs[ctxs[i]];
+                opj_mqc_decode_macro(v, mqc, curctx, a, c, ct);
+                decoded[i] = (OPJ_BYTE)v;
+            }
+            UPLOAD_MQC_VARIABLES(mqc, curctx, a, c, ct);
+        }
+        opq_mqc_finish_dec(mqc);
+        t1 = opj_wallclock();
+        if (iter == 0 || t1 - t0 < best) {
+            best = t1 - t0;
+        }
+
+        if (memcmp(decoded, symbols, MQ_NUM_SYMBOLS) != 0) {
+            fprintf(stderr, "MQ decoding does not match the encoded symbols\n");
+            ret = OPJ_FALSE;
+            goto end;
+        }
+    }
+
+    add_result("synthetic", 1, "mq_decode", best, MQ_NUM_SYMBOLS);
+
+end:
+    opj_free(ctxs);
+    opj_free(symbols);
+    opj_free(decoded);
+    opj_free(buffer);
+    return ret;
+}
+
+static OPJ_BOOL write_json(const char* filename)
+{
+    FILE* f = fopen(filename, "wt");
+    OPJ_SIZE_T i;
+
+    if (f == NULL) {
+        fprintf(stderr, "Cannot create %s\n", filename);
+        return OPJ_FALSE;
+    }
+    fprintf(f, "{\n");
+    fprintf(f, "  \"version\": \"%s\",\n", opj_version());
+    fprintf(f, "  \"results\": [\n");
+    for (i = 0; i < num_results; i++) {
+        const bench_result_t* result = &results[i];
+        const char* p;
+        /* Codestream names come from file names: escape them */
+        fprintf(f, "    {\"codestream\": \"");
+        for (p = result->codestream; *p; p++) {
+            if (*p == '"' || *p == '\\') {
+                fputc('\\', f);
+            }
+            fputc(*p, f);
+        }
+        fprintf(f, "\", \"threads\": %d, \"stage\": \"%s\", "
+                "\"iterations\": %d, \"time_ms\": %.3f, "
+                "\"msamples_per_s\": %.3f}%s\n",
+                result->threads, result->stage, result->iterations,
+                result->time_ms, result->msamples_per_s,
+                i + 1 < num_results ? "," : "");
+    }
+    fprintf(f, "  ]\n");
+    fprintf(f, "}\n");
+    fclose(f);
+    return OPJ_TRUE;
+}
+
+int main(int argc, char** argv)
+{
+    bench_input_t inputs[MAX_INPUTS];
+    int num_inputs = 0;
+    int thread_counts[MAX_THREAD_COUNTS];
+    int num_thread_counts = 0;
+    const char* json_filename = NULL;
+    OPJ_BOOL generate = OPJ_FALSE;
+    OPJ_UINT32 size = 1024;
+    int ret = 0;
+    int i, j;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-i") == 0 && i + 1 < argc) {
+            if (num_inputs == MAX_INPUTS) {
+                fprintf(stderr, "Too many inputs\n");
+                exit(1);
+            }
+            if (!read_input(&inputs[num_inputs], argv[i + 1])) {
+                exit(1);
+            }
+            num_inputs++;
+            i ++;
+        } else if (strcmp(argv[i], "-generate") == 0) {
+            generate = OPJ_TRUE;
+        } else if (strcmp(argv[i], "-size") == 0 && i + 1 < argc) {
+            int val = atoi(argv[i + 1]);
+            if (val <= 0) {
+                fprintf(stderr, "Invalid value for size. Should be >= 1\n");
+                exit(1);
+            }
+            size = (OPJ_UINT32)val;
+            i ++;
+        } else if (strcmp(argv[i], "-threads") == 0 && i + 1 < argc) {
+            const char* p = argv[i + 1];
+            num_thread_counts = 0;
+            while (*p) {
+                int val = atoi(p);
+                if (val <= 0 || num_thread_counts == MAX_THREAD_COUNTS) {
+                    fprintf(stderr, "Invalid value for threads\n");
+                    exit(1);
+                }
+                thread_counts[num_thread_counts++] = val;
+                while (*p && *p != ',') {
+                    p++;
+                }
+                if (*p == ',') {
+                    p++;
+                }
+            }
+            i ++;
+        } else if (strcmp(argv[i], "-iterations") == 0 && i + 1 < argc) {
+            iterations = atoi(argv[i + 1]);
+            if (iterations <= 0) {
+                fprintf(stderr, "Invalid value for iterations. Should be >= 1\n");
+                exit(1);
+            }
+            i ++;
+        } else if (strcmp(argv[i], "-json") == 0 && i + 1 < argc) {
+            json_filename = argv[i + 1];
+            i ++;
+        } else {
+            usage();
+        }
+    }
+
+    if (num_thread_counts == 0) {
+        thread_counts[num_thread_counts++] = 1;
+        if (opj_get_num_cpus() > 1) {
+            thread_counts[num_thread_counts++] = opj_get_num_cpus();
+        }
+    }
+
+    if (num_inputs == 0 || generate) {
+        static const OPJ_BOOL modes[4][2] = {
+            { OPJ_FALSE, OPJ_FALSE }, { OPJ_TRUE, OPJ_FALSE },
+            { OPJ_FALSE, OPJ_TRUE }, { OPJ_TRUE, OPJ_TRUE }
+        };
+        for (j = 0; j < 4; j++) {
+            if (num_inputs == MAX_INPUTS) {
+                fprintf(stderr, "Too many inputs\n");
+                exit(1);
+            }
+            if (!generate_input(&inputs[num_inputs], size, modes[j][0],
+                                modes[j][1])) {
+                fprintf(stderr, "Cannot generate codestream\n");
+                exit(1);
+            }
+            num_inputs++;
+        }
+    }
+
+    printf("%-24s %7s  %-12s %12s %12s\n", "codestream", "threads", "stage",
+           "time_ms", "Msamples/s");
+
+    if (!bench_mq_decode()) {
+        ret = 1;
+    }
+
+    for (i = 0; i < num_inputs && ret == 0; i++) {
+        for (j = 0; j < num_thread_counts; j++) {
+            opj_image_t* reference = NULL;
+            if (!bench_decode(&inputs[i], thread_counts[j], &reference) ||
+                    !bench_stages(&inputs[i], thread_counts[j], reference)) {
+                fprintf(stderr, "Cannot decode %s\n", inputs[i].name);
+                ret = 1;
+            }
+            opj_image_destroy(reference);
+            if (ret != 0) {
+                break;
+            }
+        }
+    }
+
+    if (ret == 0 && json_filename != NULL && !write_json(json_filename)) {
+        ret = 1;
+    }
+
+    for (i = 0; i < num_inputs; i++) {
+        opj_free(inputs[i].data);
+    }
+    opj_free(results);
+    return ret;
+}
@@ -44,6 +44,24 @@ OPJ_INT32 getValue(OPJ_UINT32 i)
     return ((OPJ_INT32)i % 511) - 256;
 }
 
+void fill_tilec(opj_tcd_tilecomp_t * l_tilec,
+                OPJ_BOOL irreversible)
+{
+    size_t i, nValues;
+
+    nValues = (size_t)(l_tilec->x1 - l_tilec->x0) *
+              (size_t)(l_tilec->y1 - l_tilec->y0);
+    for (i = 0; i < nValues; i++) {
+        OPJ_INT32 val = getValue((OPJ_UINT32)i);
+        if (irreversible) {
+            OPJ_FLOAT32 fVal = (OPJ_FLOAT32)val;
+            memcpy(&l_tilec->data[i], &fVal, sizeof(OPJ_FLOAT32));
+        } else {
+            l_tilec->data[i] = val;
+        }
+    }
+}
+
 void init_tilec(opj_tcd_tilecomp_t * l_tilec,
                 OPJ_INT32 x0,
                 OPJ_INT32 y0,
@@ -54,7 +72,7 @@ void init_tilec(opj_tcd_tilecomp_t * l_tilec,
 {
     opj_tcd_resolution_t* l_res;
     OPJ_UINT32 resno, l_level_no;
-    size_t i, nValues;
+    size_t nValues;
 
     memset(l_tilec, 0, sizeof(*l_tilec));
     l_tilec->x0 = x0;
@@ -65,15 +83,7 @@ void init_tilec(opj_tcd_tilecomp_t * l_tilec,
               (size_t)(l_tilec->y1 - l_tilec->y0);
     l_tilec->data = (OPJ_INT32*) opj_malloc(sizeof(OPJ_INT32) * nValues);
     assert(l_tilec->data != NULL);
-    for (i = 0; i < nValues; i++) {
-        OPJ_INT32 val = getValue((OPJ_UINT32)i);
-        if (irreversible) {
-            OPJ_FLOAT32 fVal = (OPJ_FLOAT32)val;
-            memcpy(&l_tilec->data[i], &fVal, sizeof(OPJ_FLOAT32));
-        } else {
-            l_tilec->data[i] = val;
-        }
-    }
+    fill_tilec(l_tilec, irreversible);
     l_tilec->numresolutions = numresolutions;
     l_tilec->minimum_num_resolutions = numresolutions;
     l_tilec->resolutions = (opj_tcd_resolution_t*) opj_calloc(
@@ -104,12 +114,42 @@ void free_tilec(opj_tcd_tilecomp_t * l_tilec)
     opj_free(l_tilec->resolutions);
 }
 
+/* FNV-1a hash of the tile-component samples, to compare the output of */
+/* different builds or SIMD levels (see the OPJ_SIMD_LEVEL variable) */
+OPJ_UINT32 checksum_tilec(const opj_tcd_tilecomp_t * l_tilec)
+{
+    size_t i, nValues;
+    OPJ_UINT32 hash = 2166136261U;
+
+    nValues = (size_t)(l_tilec->x1 - l_tilec->x0) *
+              (size_t)(l_tilec->y1 - l_tilec->y0);
+    for (i = 0; i < nValues; i++) {
+        OPJ_UINT32 val = (OPJ_UINT32)l_tilec->data[i];
+        int k;
+        for (k = 0; k < 4; k++) {
+            hash ^= (val >> (8 * k)) & 0xFF;
+            hash *= 16777619U;
+        }
+    }
+    return hash;
+}
+
 void usage(void)
 {
     printf(
         "bench_dwt [-decode|encode] [-I] [-size value] [-check] [-display]\n");
     printf(
         "          [-num_resolutions val] [-offset x y] [-num_threads val]\n");
+    printf(
+        "          [-iterations val] [-checksum]\n");
+    printf(
+        "-encode benchmarks the forward transform, -I the 9x7 filter.\n");
+    printf(
+        "-iterations runs the transform several times on the same input,\n");
+    printf(
+        "and reports the best and average times.\n");
+    printf(
+        "-checksum prints a hash of the transformed samples.\n");
     exit(1);
 }
 
@@ -140,17 +180,6 @@ OPJ_FLOAT64 opj_clock(void)
 #endif
 }
 
-static OPJ_FLOAT64 opj_wallclock(void)
-{
-#ifdef _WIN32
-    return opj_clock();
-#else
-    struct timeval tv;
-    gettimeofday(&tv, NULL);
-    return (OPJ_FLOAT64)tv.tv_sec + 1e-6 * (OPJ_FLOAT64)tv.tv_usec;
-#endif
-}
-
 int main(int argc, char** argv)
 {
     int num_threads = 0;
@@ -164,6 +193,10 @@ int main(int argc, char** argv)
     OPJ_INT32 i, j, k;
     OPJ_BOOL display = OPJ_FALSE;
     OPJ_BOOL check = OPJ_FALSE;
+    OPJ_BOOL checksum = OPJ_FALSE;
+    OPJ_INT32 iterations = 1;
+    OPJ_INT32 iter;
+    OPJ_FLOAT64 best = 0, best_wc = 0, sum = 0, sum_wc = 0;
     OPJ_INT32 size = 16384 - 1;
     OPJ_FLOAT64 start, stop;
     OPJ_FLOAT64 start_wc, stop_wc;
@@ -182,6 +215,15 @@ int main(int argc, char** argv)
             display = OPJ_TRUE;
         } else if (strcmp(argv[i], "-check") == 0) {
             check = OPJ_TRUE;
+        } else if (strcmp(argv[i], "-checksum") == 0) {
+            checksum = OPJ_TRUE;
+        } else if (strcmp(argv[i], "-iterations") == 0 && i + 1 < argc) {
+            iterations = atoi(argv[i + 1]);
+            if (iterations <= 0) {
+                fprintf(stderr, "Invalid value for iterations. Should be >= 1\n");
+                exit(1);
+            }
+            i ++;
         } else if (strcmp(argv[i], "-I") == 0) {
             irreversible = OPJ_TRUE;
         } else if (strcmp(argv[i], "-size") == 0 && i + 1 < argc) {
@@ -261,27 +303,55 @@ int main(int argc, char** argv)
     image_comp.dx = 1;
     image_comp.dy = 1;
 
-    start = opj_clock();
-    start_wc = opj_wallclock();
-    if (bench_decode) {
-        if (irreversible)  {
-            opj_dwt_decode_real(&tcd, &tilec, tilec.numresolutions);
-        } else {
-            opj_dwt_decode(&tcd, &tilec, tilec.numresolutions);
+    for (iter = 0; iter < iterations; iter++) {
+        if (iter > 0) {
+            fill_tilec(&tilec, irreversible);
         }
-    } else {
-        if (irreversible)  {
-            opj_dwt_encode_real(&tcd, &tilec);
+        start = opj_clock();
+        start_wc = opj_wallclock();
+        if (bench_decode) {
+            if (irreversible)  {
+                opj_dwt_decode_real(&tcd, &tilec, tilec.numresolutions);
+            } else {
+                opj_dwt_decode(&tcd, &tilec, tilec.numresolutions);
+            }
         } else {
-            opj_dwt_encode(&tcd, &tilec);
+            if (irreversible)  {
+                opj_dwt_encode_real(&tcd, &tilec);
+            } else {
+                opj_dwt_encode(&tcd, &tilec);
+            }
+        }
+        stop = opj_clock();
+        stop_wc = opj_wallclock();
+        if (iter == 0 || stop - start < best) {
+            best = stop - start;
+        }
+        if (iter == 0 || stop_wc - start_wc < best_wc) {
+            best_wc = stop_wc - start_wc;
         }
+        sum += stop - start;
+        sum_wc += stop_wc - start_wc;
+    }
+    if (iterations == 1) {
+        printf("time for %s: total = %.03f s, wallclock = %.03f s\n",
+               bench_decode ? "dwt_decode" : "dwt_encode",
+               best,
+               best_wc);
+    } else {
+        printf("time for %s (%s, %d iterations): "
+               "best = %.03f s, average = %.03f s, "
+               "best wallclock = %.03f s, average wallclock = %.03f s\n",
+               bench_decode ? "dwt_decode" : "dwt_encode",
+               irreversible ? "9x7" : "5x3",
+               iterations,
+               best, sum / iterations,
+               best_wc, sum_wc / iterations);
+    }
+
+    if (checksum) {
+        printf("checksum = %08x\n", checksum_tilec(&tilec));
     }
-    stop = opj_clock();
-    stop_wc = opj_wallclock();
-    printf("time for %s: total = %.03f s, wallclock = %.03f s\n",
-           bench_decode ? "dwt_decode" : "dwt_encode",
-           stop - start,
-           stop_wc - start_wc);
 
     if (display) {
         if (bench_decode) {
@@ -196,6 +196,58 @@ opj_stream_t* OPJ_CALLCONV opj_stream_default_create(OPJ_BOOL l_is_input)
     return opj_stream_create(OPJ_J2K_STREAM_CHUNK_SIZE, l_is_input);
 }
 
+/**
+ * Seek function of the streams held in memory: only moves the read pointer
+ * within the data.
+ */
+static OPJ_BOOL opj_stream_memory_seek(opj_stream_private_t * p_stream,
+                                       OPJ_OFF_T p_size, opj_event_mgr_t * p_event_mgr)
+{
+    OPJ_ARG_NOT_USED(p_event_mgr);
+    if ((OPJ_UINT64)p_size > p_stream->m_user_data_length) {
+        return OPJ_FALSE;
+    }
+    p_stream->m_current_data = p_stream->m_stored_data + p_size;
+    p_stream->m_bytes_in_buffer = (OPJ_SIZE_T)(p_stream->m_user_data_length -
+                                  (OPJ_UINT64)p_size);
+    p_stream->m_byte_offset = p_size;
+    return OPJ_TRUE;
+}
+
+opj_stream_t* OPJ_CALLCONV opj_stream_create_memory_stream(const void *p_data,
+        OPJ_SIZE_T p_size)
+{
+    opj_stream_private_t * l_stream = 00;
+
+    if (p_data == NULL && p_size != 0) {
+        return 00;
+    }
+    l_stream = (opj_stream_private_t*) opj_calloc(1, sizeof(opj_stream_private_t));
+    if (! l_stream) {
+        return 00;
+    }
+
+    /* The whole data is seen as the already filled read buffer of a stream */
+    /* that reached its end, so that the generic read and skip functions */
+    /* never call the (default) user functions */
+    l_stream->m_is_in_memory = OPJ_TRUE;
+    l_stream->m_stored_data = (OPJ_BYTE *) p_data;
+    l_stream->m_current_data = l_stream->m_stored_data;
+    l_stream->m_buffer_size = p_size;
+    l_stream->m_bytes_in_buffer = p_size;
+    l_stream->m_user_data_length = p_size;
+    l_stream->m_status = OPJ_STREAM_STATUS_INPUT | OPJ_STREAM_STATUS_END;
+    l_stream->m_opj_skip = opj_stream_read_skip;
+    l_stream->m_opj_seek = opj_stream_memory_seek;
+
+    l_stream->m_read_fn = opj_stream_default_read;
+    l_stream->m_write_fn = opj_stream_default_write;
+    l_stream->m_skip_fn = opj_stream_default_skip;
+    l_stream->m_seek_fn = opj_stream_default_seek;
+
+    return (opj_stream_t *) l_stream;
+}
+
 void OPJ_CALLCONV opj_stream_destroy(opj_stream_t* p_stream)
 {
     opj_stream_private_t* l_stream = (opj_stream_private_t*) p_stream;
@@ -204,7 +256,9 @@ void OPJ_CALLCONV opj_stream_destroy(opj_stream_t* p_stream)
         if (l_stream->m_free_user_data_fn) {
             l_stream->m_free_user_data_fn(l_stream->m_user_data);
         }
-        opj_free(l_stream->m_stored_data);
+        if (! l_stream->m_is_in_memory) {
+            opj_free(l_stream->m_stored_data);
+        }
         l_stream->m_stored_data = 00;
         opj_free(l_stream);
     }
@@ -600,7 +654,9 @@ OPJ_OFF_T opj_stream_skip(opj_stream_private_t * p_stream, OPJ_OFF_T p_size,
 OPJ_BOOL opj_stream_read_seek(opj_stream_private_t * p_stream, OPJ_OFF_T p_size,
                               opj_event_mgr_t * p_event_mgr)
 {
-    OPJ_ARG_NOT_USED(p_event_mgr);
+    if (p_stream->m_is_in_memory) {
+        return opj_stream_memory_seek(p_stream, p_size, p_event_mgr);
+    }
     p_stream->m_current_data = p_stream->m_stored_data;
     p_stream->m_bytes_in_buffer = 0;
 
@@ -647,7 +703,46 @@ OPJ_BOOL opj_stream_seek(opj_stream_private_t * p_stream, OPJ_OFF_T p_size,
 
 OPJ_BOOL opj_stream_has_seek(const opj_stream_private_t * p_stream)
 {
-    return p_stream->m_seek_fn != opj_stream_default_seek;
+    return p_stream->m_seek_fn != opj_stream_default_seek ||
+           p_stream->m_is_in_memory;
+}
+
+OPJ_BOOL opj_stream_has_prefetch(const opj_stream_private_t * p_stream)
+{
+    return p_stream->m_prefetch_fn != NULL;
+}
+
+void opj_stream_prefetch(opj_stream_private_t * p_stream,
+                         const OPJ_OFF_T * p_ranges, OPJ_UINT32 p_nb_ranges)
+{
+    if (p_stream->m_prefetch_fn != NULL) {
+        p_stream->m_prefetch_fn(p_ranges, p_nb_ranges, p_stream->m_user_data);
+    }
+}
+
+OPJ_BOOL opj_stream_is_in_memory(const opj_stream_private_t * p_stream)
+{
+    return p_stream->m_is_in_memory;
+}
+
+const OPJ_BYTE* opj_stream_read_data_in_place(opj_stream_private_t * p_stream,
+        OPJ_SIZE_T p_size, OPJ_SIZE_T * p_read_size,
+        opj_event_mgr_t * p_event_mgr)
+{
+    const OPJ_BYTE* l_data;
+
+    OPJ_ARG_NOT_USED(p_event_mgr);
+    if (! p_stream->m_is_in_memory || p_stream->m_bytes_in_buffer == 0) {
+        *p_read_size = (OPJ_SIZE_T) - 1;
+        return NULL;
+    }
+    l_data = p_stream->m_current_data;
+    *p_read_size = p_size < p_stream->m_bytes_in_buffer ? p_size :
+                   p_stream->m_bytes_in_buffer;
+    p_stream->m_current_data += *p_read_size;
+    p_stream->m_bytes_in_buffer -= *p_read_size;
+    p_stream->m_byte_offset += (OPJ_OFF_T) * p_read_size;
+    return l_data;
 }
 
 OPJ_SIZE_T opj_stream_default_read(void * p_buffer, OPJ_SIZE_T p_nb_bytes,
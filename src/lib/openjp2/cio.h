@@ -75,6 +75,13 @@ The functions in CIO.C have for goal to realize a byte input / output process.
 #define OPJ_STREAM_STATUS_END     0x4U
 #define OPJ_STREAM_STATUS_ERROR   0x8U
 
+/**
+ * Function receiving the byte ranges that a decoder is going to read, as
+ * p_nb_ranges pairs of start and end offsets sorted by increasing offset.
+ */
+typedef void (* opj_stream_prefetch_fn)(const OPJ_OFF_T * p_ranges,
+                                        OPJ_UINT32 p_nb_ranges, void * p_user_data);
+
 /**
 Byte input-output stream.
 */
@@ -117,6 +124,12 @@ typedef struct opj_stream_private {
      */
     opj_stream_seek_fn      m_seek_fn;
 
+    /**
+     * Pointer to the function told about the ranges that will be read, so
+     * that it can fetch them ahead of time (NULL for most streams).
+     */
+    opj_stream_prefetch_fn  m_prefetch_fn;
+
     /**
      * Actual data stored into the stream if read from. Data is read by chunk of fixed size.
      * you should never access this data directly.
@@ -161,6 +174,14 @@ typedef struct opj_stream_private {
      */
     OPJ_UINT32 m_status;
 
+    /**
+     * Whether m_stored_data holds the whole content of the stream, as with
+     * opj_stream_create_memory_stream(). In that case, m_stored_data does not
+     * belong to the stream, is never written, and the data can be read in
+     * place with opj_stream_read_data_in_place().
+     */
+    OPJ_BOOL m_is_in_memory;
+
 }
 opj_stream_private_t;
 
@@ -380,6 +401,43 @@ OPJ_BOOL opj_stream_seek(opj_stream_private_t * p_stream, OPJ_OFF_T p_size,
  */
 OPJ_BOOL opj_stream_has_seek(const opj_stream_private_t * p_stream);
 
+/**
+ * Tells if the given stream fetches data ahead of time, and benefits from
+ * knowing the ranges that will be read with opj_stream_prefetch().
+ */
+OPJ_BOOL opj_stream_has_prefetch(const opj_stream_private_t * p_stream);
+
+/**
+ * Tells the stream the byte ranges that are going to be read.
+ * @param       p_stream    the stream.
+ * @param       p_ranges    p_nb_ranges pairs of start and end offsets, sorted
+ *                          by increasing offset.
+ * @param       p_nb_ranges number of ranges.
+ */
+void opj_stream_prefetch(opj_stream_private_t * p_stream,
+                         const OPJ_OFF_T * p_ranges, OPJ_UINT32 p_nb_ranges);
+
+/**
+ * Tells if the content of the given stream is held in memory, so that it can
+ * be read with opj_stream_read_data_in_place().
+ */
+OPJ_BOOL opj_stream_is_in_memory(const opj_stream_private_t * p_stream);
+
+/**
+ * Reads some bytes from a stream held in memory, without copying them.
+ * @param       p_stream    the stream to read data from.
+ * @param       p_size      number of bytes to read.
+ * @param       p_read_size receives the number of bytes read, which is less
+ *                          than p_size at the end of the stream, or -1 if the
+ *                          stream is already at its end.
+ * @param       p_event_mgr the user event manager to be notified of special events.
+ * @return      a pointer to the bytes read, valid as long as the stream, or
+ *              NULL if the stream is not held in memory or is at its end.
+ */
+const OPJ_BYTE* opj_stream_read_data_in_place(opj_stream_private_t * p_stream,
+        OPJ_SIZE_T p_size, OPJ_SIZE_T * p_read_size,
+        struct opj_event_mgr * p_event_mgr);
+
 /**
  * FIXME DOC.
  */
@@ -42,6 +42,7 @@
 
 #define OPJ_SKIP_POISON
 #include "opj_includes.h"
+#include "dwt_kernels.h"
 
 #ifdef __SSE__
 #include <xmmintrin.h>
@@ -69,20 +70,6 @@
 #define OPJ_WS(i) v->mem[(i)*2]
 #define OPJ_WD(i) v->mem[(1+(i)*2)]
 
-#if defined(__AVX512F__)
-/** Number of int32 values in a AVX512 register */
-#define VREG_INT_COUNT       16
-#elif defined(__AVX2__)
-/** Number of int32 values in a AVX2 register */
-#define VREG_INT_COUNT       8
-#else
-/** Number of int32 values in a SSE2 or NEON register */
-#define VREG_INT_COUNT       4
-#endif
-
-/** Number of columns that we can process in parallel in the vertical pass */
-#define PARALLEL_COLS_53     (2*VREG_INT_COUNT)
-
 /** @name Local data structures */
 /*@{*/
 
@@ -93,12 +80,6 @@ typedef struct dwt_local {
     OPJ_INT32 cas;  /* 0 = start on even coord, 1 = start on odd coord */
 } opj_dwt_t;
 
-#define NB_ELTS_V8  8
-
-typedef union {
-    OPJ_FLOAT32 f[NB_ELTS_V8];
-} opj_v8_t;
-
 typedef struct v8dwt_local {
     opj_v8_t*   wavelet ;
     OPJ_INT32       dn ;  /* number of elements in high pass band */
@@ -110,15 +91,6 @@ typedef struct v8dwt_local {
     OPJ_UINT32      win_h_x1; /* end coord in high pass band */
 } opj_v8dwt_t ;
 
-/* From table F.4 from the standard */
-static const OPJ_FLOAT32 opj_dwt_alpha =  -1.586134342f;
-static const OPJ_FLOAT32 opj_dwt_beta  =  -0.052980118f;
-static const OPJ_FLOAT32 opj_dwt_gamma = 0.882911075f;
-static const OPJ_FLOAT32 opj_dwt_delta = 0.443506852f;
-
-static const OPJ_FLOAT32 opj_K      = 1.230174105f;
-static const OPJ_FLOAT32 opj_invK   = (OPJ_FLOAT32)(1.0 / 1.230174105);
-
 /*@}*/
 
 /** @name Local static functions */
@@ -150,18 +122,8 @@ static OPJ_BOOL opj_dwt_decode_tile(opj_thread_pool_t* tp,
 
 static OPJ_BOOL opj_dwt_decode_partial_tile(
     opj_tcd_tilecomp_t* tilec,
-    OPJ_UINT32 numres);
-
-/* Forward transform, for the vertical pass, processing cols columns */
-/* where cols <= NB_ELTS_V8 */
-/* Where void* is a OPJ_INT32* for 5x3 and OPJ_FLOAT32* for 9x7 */
-typedef void (*opj_encode_and_deinterleave_v_fnptr_type)(
-    void *array,
-    void *tmp,
-    OPJ_UINT32 height,
-    OPJ_BOOL even,
-    OPJ_UINT32 stride_width,
-    OPJ_UINT32 cols);
+    OPJ_UINT32 numres,
+    OPJ_BOOL keep_state);
 
 /* Where void* is a OPJ_INT32* for 5x3 and OPJ_FLOAT32* for 9x7 */
 typedef void (*opj_encode_and_deinterleave_h_one_row_fnptr_type)(
@@ -173,12 +135,18 @@ typedef void (*opj_encode_and_deinterleave_h_one_row_fnptr_type)(
 static OPJ_BOOL opj_dwt_encode_procedure(opj_thread_pool_t* tp,
         opj_tcd_tilecomp_t * tilec,
         opj_encode_and_deinterleave_v_fnptr_type p_encode_and_deinterleave_v,
+        OPJ_UINT32 v_cols,
         opj_encode_and_deinterleave_h_one_row_fnptr_type
         p_encode_and_deinterleave_h_one_row);
 
 static OPJ_UINT32 opj_dwt_max_resolution(opj_tcd_resolution_t* OPJ_RESTRICT r,
         OPJ_UINT32 i);
 
+/**
+Returns the DWT kernels for the SIMD level of the host CPU
+*/
+static const opj_dwt_kernels_t* opj_dwt_get_kernels(void);
+
 /* <summary>                             */
 /* Inverse 9-7 wavelet transform in 1-D. */
 /* </summary>                            */
@@ -337,51 +305,6 @@ static void opj_dwt_decode_1(const opj_dwt_t *v)
 
 #endif /* STANDARD_SLOW_VERSION */
 
-#if defined(__AVX512F__)
-static int32_t loop_short_sse(int32_t len, const int32_t** lf_ptr,
-                              const int32_t** hf_ptr, int32_t** out_ptr,
-                              int32_t* prev_even)
-{
-    int32_t next_even;
-    __m128i odd, even_m1, unpack1, unpack2;
-    const int32_t batch = (len - 2) / 8;
-    const __m128i two = _mm_set1_epi32(2);
-
-    for (int32_t i = 0; i < batch; i++) {
-        const __m128i lf_ = _mm_loadu_si128((__m128i*)(*lf_ptr + 1));
-        const __m128i hf1_ = _mm_loadu_si128((__m128i*)(*hf_ptr));
-        const __m128i hf2_ = _mm_loadu_si128((__m128i*)(*hf_ptr + 1));
-
-        __m128i even = _mm_add_epi32(hf1_, hf2_);
-        even = _mm_add_epi32(even, two);
-        even = _mm_srai_epi32(even, 2);
-        even = _mm_sub_epi32(lf_, even);
-
-        next_even = _mm_extract_epi32(even, 3);
-        even_m1 = _mm_bslli_si128(even, 4);
-        even_m1 = _mm_insert_epi32(even_m1, *prev_even, 0);
-
-        //out[0] + out[2]
-        odd = _mm_add_epi32(even_m1, even);
-        odd = _mm_srai_epi32(odd, 1);
-        odd = _mm_add_epi32(odd, hf1_);
-
-        unpack1 = _mm_unpacklo_epi32(even_m1, odd);
-        unpack2 = _mm_unpackhi_epi32(even_m1, odd);
-
-        _mm_storeu_si128((__m128i*)(*out_ptr + 0), unpack1);
-        _mm_storeu_si128((__m128i*)(*out_ptr + 4), unpack2);
-
-        *prev_even = next_even;
-
-        *out_ptr += 8;
-        *lf_ptr += 4;
-        *hf_ptr += 4;
-    }
-    return batch;
-}
-#endif
-
 #if !defined(STANDARD_SLOW_VERSION)
 static void  opj_idwt53_h_cas0(OPJ_INT32* tmp,
                                const OPJ_INT32 sn,
@@ -414,145 +337,6 @@ static void  opj_idwt53_h_cas0(OPJ_INT32* tmp,
     if (!(len & 1)) { /* if len is even */
         tmp[len - 1] = in_odd[(len - 1) / 2] + tmp[len - 2];
     }
-#else
-#if defined(__AVX512F__)
-    OPJ_INT32* out_ptr = tmp;
-    int32_t prev_even = in_even[0] - ((in_odd[0] + 1) >> 1);
-
-    const __m512i permutevar_mask = _mm512_setr_epi32(
-                                        0x10, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b,
-                                        0x0c, 0x0d, 0x0e);
-    const __m512i store1_perm = _mm512_setr_epi64(0x00, 0x01, 0x08, 0x09, 0x02,
-                                0x03, 0x0a, 0x0b);
-    const __m512i store2_perm = _mm512_setr_epi64(0x04, 0x05, 0x0c, 0x0d, 0x06,
-                                0x07, 0x0e, 0x0f);
-
-    const __m512i two = _mm512_set1_epi32(2);
-
-    int32_t simd_batch_512 = (len - 2) / 32;
-    int32_t leftover;
-
-    for (i = 0; i < simd_batch_512; i++) {
-        const __m512i lf_avx2 = _mm512_loadu_si512((__m512i*)(in_even + 1));
-        const __m512i hf1_avx2 = _mm512_loadu_si512((__m512i*)(in_odd));
-        const __m512i hf2_avx2 = _mm512_loadu_si512((__m512i*)(in_odd + 1));
-        int32_t next_even;
-        __m512i duplicate, even_m1, odd, unpack1, unpack2, store1, store2;
-
-        __m512i even = _mm512_add_epi32(hf1_avx2, hf2_avx2);
-        even = _mm512_add_epi32(even, two);
-        even = _mm512_srai_epi32(even, 2);
-        even = _mm512_sub_epi32(lf_avx2, even);
-
-        next_even = _mm_extract_epi32(_mm512_extracti32x4_epi32(even, 3), 3);
-
-        duplicate = _mm512_set1_epi32(prev_even);
-        even_m1 = _mm512_permutex2var_epi32(even, permutevar_mask, duplicate);
-
-        //out[0] + out[2]
-        odd = _mm512_add_epi32(even_m1, even);
-        odd = _mm512_srai_epi32(odd, 1);
-        odd = _mm512_add_epi32(odd, hf1_avx2);
-
-        unpack1 = _mm512_unpacklo_epi32(even_m1, odd);
-        unpack2 = _mm512_unpackhi_epi32(even_m1, odd);
-
-        store1 = _mm512_permutex2var_epi64(unpack1, store1_perm, unpack2);
-        store2 = _mm512_permutex2var_epi64(unpack1, store2_perm, unpack2);
-
-        _mm512_storeu_si512(out_ptr, store1);
-        _mm512_storeu_si512(out_ptr + 16, store2);
-
-        prev_even = next_even;
-
-        out_ptr += 32;
-        in_even += 16;
-        in_odd += 16;
-    }
-
-    leftover = len - simd_batch_512 * 32;
-    if (leftover > 8) {
-        leftover -= 8 * loop_short_sse(leftover, &in_even, &in_odd, &out_ptr,
-                                       &prev_even);
-    }
-    out_ptr[0] = prev_even;
-
-    for (j = 1; j < (leftover - 2); j += 2) {
-        out_ptr[2] = in_even[1] - ((in_odd[0] + (in_odd[1]) + 2) >> 2);
-        out_ptr[1] = in_odd[0] + ((out_ptr[0] + out_ptr[2]) >> 1);
-        in_even++;
-        in_odd++;
-        out_ptr += 2;
-    }
-
-    if (len & 1) {
-        out_ptr[2] = in_even[1] - ((in_odd[0] + 1) >> 1);
-        out_ptr[1] = in_odd[0] + ((out_ptr[0] + out_ptr[2]) >> 1);
-    } else { //!(len & 1)
-        out_ptr[1] = in_odd[0] + out_ptr[0];
-    }
-#elif  defined(__AVX2__)
-    OPJ_INT32* out_ptr = tmp;
-    int32_t prev_even = in_even[0] - ((in_odd[0] + 1) >> 1);
-
-    const __m256i reg_permutevar_mask_move_right = _mm256_setr_epi32(0x00, 0x00,
-            0x01, 0x02, 0x03, 0x04, 0x05, 0x06);
-    const __m256i two = _mm256_set1_epi32(2);
-
-    int32_t simd_batch = (len - 2) / 16;
-    int32_t next_even;
-    __m256i even_m1, odd, unpack1_avx2, unpack2_avx2;
-
-    for (i = 0; i < simd_batch; i++) {
-        const __m256i lf_avx2 = _mm256_loadu_si256((__m256i*)(in_even + 1));
-        const __m256i hf1_avx2 = _mm256_loadu_si256((__m256i*)(in_odd));
-        const __m256i hf2_avx2 = _mm256_loadu_si256((__m256i*)(in_odd + 1));
-
-        __m256i even = _mm256_add_epi32(hf1_avx2, hf2_avx2);
-        even = _mm256_add_epi32(even, two);
-        even = _mm256_srai_epi32(even, 2);
-        even = _mm256_sub_epi32(lf_avx2, even);
-
-        next_even = _mm_extract_epi32(_mm256_extracti128_si256(even, 1), 3);
-        even_m1 = _mm256_permutevar8x32_epi32(even, reg_permutevar_mask_move_right);
-        even_m1 = _mm256_blend_epi32(even_m1, _mm256_set1_epi32(prev_even), (1 << 0));
-
-        //out[0] + out[2]
-        odd = _mm256_add_epi32(even_m1, even);
-        odd = _mm256_srai_epi32(odd, 1);
-        odd = _mm256_add_epi32(odd, hf1_avx2);
-
-        unpack1_avx2 = _mm256_unpacklo_epi32(even_m1, odd);
-        unpack2_avx2 = _mm256_unpackhi_epi32(even_m1, odd);
-
-        _mm_storeu_si128((__m128i*)(out_ptr + 0), _mm256_castsi256_si128(unpack1_avx2));
-        _mm_storeu_si128((__m128i*)(out_ptr + 4), _mm256_castsi256_si128(unpack2_avx2));
-        _mm_storeu_si128((__m128i*)(out_ptr + 8), _mm256_extracti128_si256(unpack1_avx2,
-                         0x1));
-        _mm_storeu_si128((__m128i*)(out_ptr + 12),
-                         _mm256_extracti128_si256(unpack2_avx2, 0x1));
-
-        prev_even = next_even;
-
-        out_ptr += 16;
-        in_even += 8;
-        in_odd += 8;
-    }
-    out_ptr[0] = prev_even;
-    for (j = simd_batch * 16 + 1; j < (len - 2); j += 2) {
-        out_ptr[2] = in_even[1] - ((in_odd[0] + in_odd[1] + 2) >> 2);
-        out_ptr[1] = in_odd[0] + ((out_ptr[0] + out_ptr[2]) >> 1);
-        in_even++;
-        in_odd++;
-        out_ptr += 2;
-    }
-
-    if (len & 1) {
-        out_ptr[2] = in_even[1] - ((in_odd[0] + 1) >> 1);
-        out_ptr[1] = in_odd[0] + ((out_ptr[0] + out_ptr[2]) >> 1);
-    } else { //!(len & 1)
-        out_ptr[1] = in_odd[0] + out_ptr[0];
-    }
 #else
     OPJ_INT32 d1c, d1n, s1n, s0c, s0n;
 
@@ -587,7 +371,6 @@ static void  opj_idwt53_h_cas0(OPJ_INT32* tmp,
     } else {
         tmp[len - 1] = d1n + s0n;
     }
-#endif /*(__AVX512F__ || __AVX2__)*/
 #endif /*TWO_PASS_VERSION*/
     memcpy(tiledp, tmp, (OPJ_UINT32)len * sizeof(OPJ_INT32));
 }
@@ -681,7 +464,7 @@ static void opj_idwt53_h(const opj_dwt_t *dwt,
     const OPJ_INT32 len = sn + dwt->dn;
     if (dwt->cas == 0) { /* Left-most sample is on even coordinate */
         if (len > 1) {
-            opj_idwt53_h_cas0(dwt->mem, sn, len, tiledp);
+            opj_dwt_get_kernels()->idwt53_h_cas0(dwt->mem, sn, len, tiledp);
         } else {
             /* Unmodified value */
         }
@@ -702,296 +485,10 @@ static void opj_idwt53_h(const opj_dwt_t *dwt,
 #endif
 }
 
-#if (defined(__ARM_NEON) || defined(__SSE2__) || defined(__AVX2__) || defined(__AVX512F__)) && !defined(STANDARD_SLOW_VERSION)
-
-/* Conveniency macros to improve the readability of the formulas */
-#if defined(__AVX512F__)
-#define VREG        __m512i
-#define LOAD_CST(x) _mm512_set1_epi32(x)
-#define LOAD(x)     _mm512_loadu_si512((const VREG*)(x))
-#define LOADU(x)    _mm512_loadu_si512((const VREG*)(x))
-#define STORE(x,y)  _mm512_storeu_si512((VREG*)(x),(y))
-#define STOREU(x,y) _mm512_storeu_si512((VREG*)(x),(y))
-#define ADD(x,y)    _mm512_add_epi32((x),(y))
-#define SUB(x,y)    _mm512_sub_epi32((x),(y))
-#define SAR(x,y)    _mm512_srai_epi32((x),(y))
-#elif defined(__AVX2__)
-#define VREG        __m256i
-#define LOAD_CST(x) _mm256_set1_epi32(x)
-#define LOAD(x)     _mm256_load_si256((const VREG*)(x))
-#define LOADU(x)    _mm256_loadu_si256((const VREG*)(x))
-#define STORE(x,y)  _mm256_store_si256((VREG*)(x),(y))
-#define STOREU(x,y) _mm256_storeu_si256((VREG*)(x),(y))
-#define ADD(x,y)    _mm256_add_epi32((x),(y))
-#define SUB(x,y)    _mm256_sub_epi32((x),(y))
-#define SAR(x,y)    _mm256_srai_epi32((x),(y))
-#elif defined(__ARM_NEON)
-#define VREG        int32x4_t
-#define LOAD_CST(x) vdupq_n_s32(x)
-#define LOAD(x)     vld1q_s32((const int32_t*)(x))
-#define LOADU(x)    vld1q_s32((const int32_t*)(x))
-#define STORE(x,y)  vst1q_s32((int32_t*)(x),(y))
-#define STOREU(x,y) vst1q_s32((int32_t*)(x),(y))
-#define ADD(x,y)    vaddq_s32((x),(y))
-#define SUB(x,y)    vsubq_s32((x),(y))
-#define SAR(x,y)    vshrq_n_s32((x),(y))
-#else
-#define VREG        __m128i
-#define LOAD_CST(x) _mm_set1_epi32(x)
-#define LOAD(x)     _mm_load_si128((const VREG*)(x))
-#define LOADU(x)    _mm_loadu_si128((const VREG*)(x))
-#define STORE(x,y)  _mm_store_si128((VREG*)(x),(y))
-#define STOREU(x,y) _mm_storeu_si128((VREG*)(x),(y))
-#define ADD(x,y)    _mm_add_epi32((x),(y))
-#define SUB(x,y)    _mm_sub_epi32((x),(y))
-#define SAR(x,y)    _mm_srai_epi32((x),(y))
-#endif
-#define ADD3(x,y,z) ADD(ADD(x,y),z)
-
-static
-void opj_idwt53_v_final_memcpy(OPJ_INT32* tiledp_col,
-                               const OPJ_INT32* tmp,
-                               OPJ_INT32 len,
-                               OPJ_SIZE_T stride)
-{
-    OPJ_INT32 i;
-    for (i = 0; i < len; ++i) {
-        /* A memcpy(&tiledp_col[i * stride + 0],
-                    &tmp[PARALLEL_COLS_53 * i + 0],
-                    PARALLEL_COLS_53 * sizeof(OPJ_INT32))
-           would do but would be a tiny bit slower.
-           We can take here advantage of our knowledge of alignment */
-        STOREU(&tiledp_col[(OPJ_SIZE_T)i * stride + 0],
-               LOAD(&tmp[PARALLEL_COLS_53 * i + 0]));
-        STOREU(&tiledp_col[(OPJ_SIZE_T)i * stride + VREG_INT_COUNT],
-               LOAD(&tmp[PARALLEL_COLS_53 * i + VREG_INT_COUNT]));
-    }
-}
-
-/** Vertical inverse 5x3 wavelet transform for 8 columns in SSE2 and NEON,
- * or 16 in AVX2, when top-most pixel is on even coordinate */
-static void opj_idwt53_v_cas0_mcols_SIMD(
-    OPJ_INT32* tmp,
-    const OPJ_INT32 sn,
-    const OPJ_INT32 len,
-    OPJ_INT32* tiledp_col,
-    const OPJ_SIZE_T stride)
-{
-    const OPJ_INT32* in_even = &tiledp_col[0];
-    const OPJ_INT32* in_odd = &tiledp_col[(OPJ_SIZE_T)sn * stride];
-
-    OPJ_INT32 i;
-    OPJ_SIZE_T j;
-    VREG d1c_0, d1n_0, s1n_0, s0c_0, s0n_0;
-    VREG d1c_1, d1n_1, s1n_1, s0c_1, s0n_1;
-    const VREG two = LOAD_CST(2);
-
-    assert(len > 1);
-#if defined(__AVX512F__)
-    assert(PARALLEL_COLS_53 == 32);
-    assert(VREG_INT_COUNT == 16);
-#elif defined(__AVX2__)
-    assert(PARALLEL_COLS_53 == 16);
-    assert(VREG_INT_COUNT == 8);
-#else
-    assert(PARALLEL_COLS_53 == 8);
-    assert(VREG_INT_COUNT == 4);
-#endif
-
-//For AVX512 code aligned load/store is set to it's unaligned equivalents
-#if !defined(__AVX512F__)
-    /* Note: loads of input even/odd values must be done in a unaligned */
-    /* fashion. But stores in tmp can be done with aligned store, since */
-    /* the temporary buffer is properly aligned */
-    assert((OPJ_SIZE_T)tmp % (sizeof(OPJ_INT32) * VREG_INT_COUNT) == 0);
-#endif
-
-    s1n_0 = LOADU(in_even + 0);
-    s1n_1 = LOADU(in_even + VREG_INT_COUNT);
-    d1n_0 = LOADU(in_odd);
-    d1n_1 = LOADU(in_odd + VREG_INT_COUNT);
-
-    /* s0n = s1n - ((d1n + 1) >> 1); <==> */
-    /* s0n = s1n - ((d1n + d1n + 2) >> 2); */
-    s0n_0 = SUB(s1n_0, SAR(ADD3(d1n_0, d1n_0, two), 2));
-    s0n_1 = SUB(s1n_1, SAR(ADD3(d1n_1, d1n_1, two), 2));
-
-    for (i = 0, j = 1; i < (len - 3); i += 2, j++) {
-        d1c_0 = d1n_0;
-        s0c_0 = s0n_0;
-        d1c_1 = d1n_1;
-        s0c_1 = s0n_1;
-
-        s1n_0 = LOADU(in_even + j * stride);
-        s1n_1 = LOADU(in_even + j * stride + VREG_INT_COUNT);
-        d1n_0 = LOADU(in_odd + j * stride);
-        d1n_1 = LOADU(in_odd + j * stride + VREG_INT_COUNT);
-
-        /*s0n = s1n - ((d1c + d1n + 2) >> 2);*/
-        s0n_0 = SUB(s1n_0, SAR(ADD3(d1c_0, d1n_0, two), 2));
-        s0n_1 = SUB(s1n_1, SAR(ADD3(d1c_1, d1n_1, two), 2));
-
-        STORE(tmp + PARALLEL_COLS_53 * (i + 0), s0c_0);
-        STORE(tmp + PARALLEL_COLS_53 * (i + 0) + VREG_INT_COUNT, s0c_1);
-
-        /* d1c + ((s0c + s0n) >> 1) */
-        STORE(tmp + PARALLEL_COLS_53 * (i + 1) + 0,
-              ADD(d1c_0, SAR(ADD(s0c_0, s0n_0), 1)));
-        STORE(tmp + PARALLEL_COLS_53 * (i + 1) + VREG_INT_COUNT,
-              ADD(d1c_1, SAR(ADD(s0c_1, s0n_1), 1)));
-    }
-
-    STORE(tmp + PARALLEL_COLS_53 * (i + 0) + 0, s0n_0);
-    STORE(tmp + PARALLEL_COLS_53 * (i + 0) + VREG_INT_COUNT, s0n_1);
-
-    if (len & 1) {
-        VREG tmp_len_minus_1;
-        s1n_0 = LOADU(in_even + (OPJ_SIZE_T)((len - 1) / 2) * stride);
-        /* tmp_len_minus_1 = s1n - ((d1n + 1) >> 1); */
-        tmp_len_minus_1 = SUB(s1n_0, SAR(ADD3(d1n_0, d1n_0, two), 2));
-        STORE(tmp + PARALLEL_COLS_53 * (len - 1), tmp_len_minus_1);
-        /* d1n + ((s0n + tmp_len_minus_1) >> 1) */
-        STORE(tmp + PARALLEL_COLS_53 * (len - 2),
-              ADD(d1n_0, SAR(ADD(s0n_0, tmp_len_minus_1), 1)));
-
-        s1n_1 = LOADU(in_even + (OPJ_SIZE_T)((len - 1) / 2) * stride + VREG_INT_COUNT);
-        /* tmp_len_minus_1 = s1n - ((d1n + 1) >> 1); */
-        tmp_len_minus_1 = SUB(s1n_1, SAR(ADD3(d1n_1, d1n_1, two), 2));
-        STORE(tmp + PARALLEL_COLS_53 * (len - 1) + VREG_INT_COUNT,
-              tmp_len_minus_1);
-        /* d1n + ((s0n + tmp_len_minus_1) >> 1) */
-        STORE(tmp + PARALLEL_COLS_53 * (len - 2) + VREG_INT_COUNT,
-              ADD(d1n_1, SAR(ADD(s0n_1, tmp_len_minus_1), 1)));
-
-
-    } else {
-        STORE(tmp + PARALLEL_COLS_53 * (len - 1) + 0,
-              ADD(d1n_0, s0n_0));
-        STORE(tmp + PARALLEL_COLS_53 * (len - 1) + VREG_INT_COUNT,
-              ADD(d1n_1, s0n_1));
-    }
-
-    opj_idwt53_v_final_memcpy(tiledp_col, tmp, len, stride);
-}
-
-
-/** Vertical inverse 5x3 wavelet transform for 8 columns in SSE2 and NEON,
- * or 16 in AVX2, when top-most pixel is on odd coordinate */
-static void opj_idwt53_v_cas1_mcols_SIMD(
-    OPJ_INT32* tmp,
-    const OPJ_INT32 sn,
-    const OPJ_INT32 len,
-    OPJ_INT32* tiledp_col,
-    const OPJ_SIZE_T stride)
-{
-    OPJ_INT32 i;
-    OPJ_SIZE_T j;
-
-    VREG s1_0, s2_0, dc_0, dn_0;
-    VREG s1_1, s2_1, dc_1, dn_1;
-    const VREG two = LOAD_CST(2);
-
-    const OPJ_INT32* in_even = &tiledp_col[(OPJ_SIZE_T)sn * stride];
-    const OPJ_INT32* in_odd = &tiledp_col[0];
-
-    assert(len > 2);
-#if defined(__AVX512F__)
-    assert(PARALLEL_COLS_53 == 32);
-    assert(VREG_INT_COUNT == 16);
-#elif defined(__AVX2__)
-    assert(PARALLEL_COLS_53 == 16);
-    assert(VREG_INT_COUNT == 8);
-#else
-    assert(PARALLEL_COLS_53 == 8);
-    assert(VREG_INT_COUNT == 4);
-#endif
-
-//For AVX512 code aligned load/store is set to it's unaligned equivalents
-#if !defined(__AVX512F__)
-    /* Note: loads of input even/odd values must be done in a unaligned */
-    /* fashion. But stores in tmp can be done with aligned store, since */
-    /* the temporary buffer is properly aligned */
-    assert((OPJ_SIZE_T)tmp % (sizeof(OPJ_INT32) * VREG_INT_COUNT) == 0);
+#if (defined(__ARM_NEON) || defined(__SSE2__)) && !defined(STANDARD_SLOW_VERSION)
+#include "dwt_simd_inl.h"
 #endif
 
-    s1_0 = LOADU(in_even + stride);
-    /* in_odd[0] - ((in_even[0] + s1 + 2) >> 2); */
-    dc_0 = SUB(LOADU(in_odd + 0),
-               SAR(ADD3(LOADU(in_even + 0), s1_0, two), 2));
-    STORE(tmp + PARALLEL_COLS_53 * 0, ADD(LOADU(in_even + 0), dc_0));
-
-    s1_1 = LOADU(in_even + stride + VREG_INT_COUNT);
-    /* in_odd[0] - ((in_even[0] + s1 + 2) >> 2); */
-    dc_1 = SUB(LOADU(in_odd + VREG_INT_COUNT),
-               SAR(ADD3(LOADU(in_even + VREG_INT_COUNT), s1_1, two), 2));
-    STORE(tmp + PARALLEL_COLS_53 * 0 + VREG_INT_COUNT,
-          ADD(LOADU(in_even + VREG_INT_COUNT), dc_1));
-
-    for (i = 1, j = 1; i < (len - 2 - !(len & 1)); i += 2, j++) {
-
-        s2_0 = LOADU(in_even + (j + 1) * stride);
-        s2_1 = LOADU(in_even + (j + 1) * stride + VREG_INT_COUNT);
-
-        /* dn = in_odd[j * stride] - ((s1 + s2 + 2) >> 2); */
-        dn_0 = SUB(LOADU(in_odd + j * stride),
-                   SAR(ADD3(s1_0, s2_0, two), 2));
-        dn_1 = SUB(LOADU(in_odd + j * stride + VREG_INT_COUNT),
-                   SAR(ADD3(s1_1, s2_1, two), 2));
-
-        STORE(tmp + PARALLEL_COLS_53 * i, dc_0);
-        STORE(tmp + PARALLEL_COLS_53 * i + VREG_INT_COUNT, dc_1);
-
-        /* tmp[i + 1] = s1 + ((dn + dc) >> 1); */
-        STORE(tmp + PARALLEL_COLS_53 * (i + 1) + 0,
-              ADD(s1_0, SAR(ADD(dn_0, dc_0), 1)));
-        STORE(tmp + PARALLEL_COLS_53 * (i + 1) + VREG_INT_COUNT,
-              ADD(s1_1, SAR(ADD(dn_1, dc_1), 1)));
-
-        dc_0 = dn_0;
-        s1_0 = s2_0;
-        dc_1 = dn_1;
-        s1_1 = s2_1;
-    }
-    STORE(tmp + PARALLEL_COLS_53 * i, dc_0);
-    STORE(tmp + PARALLEL_COLS_53 * i + VREG_INT_COUNT, dc_1);
-
-    if (!(len & 1)) {
-        /*dn = in_odd[(len / 2 - 1) * stride] - ((s1 + 1) >> 1); */
-        dn_0 = SUB(LOADU(in_odd + (OPJ_SIZE_T)(len / 2 - 1) * stride),
-                   SAR(ADD3(s1_0, s1_0, two), 2));
-        dn_1 = SUB(LOADU(in_odd + (OPJ_SIZE_T)(len / 2 - 1) * stride + VREG_INT_COUNT),
-                   SAR(ADD3(s1_1, s1_1, two), 2));
-
-        /* tmp[len - 2] = s1 + ((dn + dc) >> 1); */
-        STORE(tmp + PARALLEL_COLS_53 * (len - 2) + 0,
-              ADD(s1_0, SAR(ADD(dn_0, dc_0), 1)));
-        STORE(tmp + PARALLEL_COLS_53 * (len - 2) + VREG_INT_COUNT,
-              ADD(s1_1, SAR(ADD(dn_1, dc_1), 1)));
-
-        STORE(tmp + PARALLEL_COLS_53 * (len - 1) + 0, dn_0);
-        STORE(tmp + PARALLEL_COLS_53 * (len - 1) + VREG_INT_COUNT, dn_1);
-    } else {
-        STORE(tmp + PARALLEL_COLS_53 * (len - 1) + 0, ADD(s1_0, dc_0));
-        STORE(tmp + PARALLEL_COLS_53 * (len - 1) + VREG_INT_COUNT,
-              ADD(s1_1, dc_1));
-    }
-
-    opj_idwt53_v_final_memcpy(tiledp_col, tmp, len, stride);
-}
-
-#undef VREG
-#undef LOAD_CST
-#undef LOADU
-#undef LOAD
-#undef STORE
-#undef STOREU
-#undef ADD
-#undef ADD3
-#undef SUB
-#undef SAR
-
-#endif /* (defined(__SSE2__) || defined(__AVX2__)) && !defined(STANDARD_SLOW_VERSION) */
-
 #if !defined(STANDARD_SLOW_VERSION)
 /** Vertical inverse 5x3 wavelet transform for one column, when top-most
  * pixel is on even coordinate */
@@ -1114,17 +611,17 @@ static void opj_idwt53_v(const opj_dwt_t *dwt,
 #else
     const OPJ_INT32 sn = dwt->sn;
     const OPJ_INT32 len = sn + dwt->dn;
+    const opj_dwt_kernels_t* kernels = opj_dwt_get_kernels();
     if (dwt->cas == 0) {
         /* If len == 1, unmodified value */
 
-#if (defined(__ARM_NEON) || defined(__SSE2__) || defined(__AVX2__))
-        if (len > 1 && nb_cols == PARALLEL_COLS_53) {
+        if (len > 1 && nb_cols == kernels->parallel_cols_53 &&
+                kernels->idwt53_v_cas0_mcols != NULL) {
             /* Same as below general case, except that thanks to SIMD */
-            /* we can efficiently process 8/16 columns in parallel */
-            opj_idwt53_v_cas0_mcols_SIMD(dwt->mem, sn, len, tiledp_col, stride);
+            /* we can efficiently process 8/16/32 columns in parallel */
+            kernels->idwt53_v_cas0_mcols(dwt->mem, sn, len, tiledp_col, stride);
             return;
         }
-#endif
         if (len > 1) {
             OPJ_INT32 c;
             for (c = 0; c < nb_cols; c++, tiledp_col++) {
@@ -1160,14 +657,13 @@ static void opj_idwt53_v(const opj_dwt_t *dwt,
             return;
         }
 
-#if (defined(__ARM_NEON) || defined(__SSE2__) || defined(__AVX2__))
-        if (len > 2 && nb_cols == PARALLEL_COLS_53) {
+        if (len > 2 && nb_cols == kernels->parallel_cols_53 &&
+                kernels->idwt53_v_cas1_mcols != NULL) {
             /* Same as below general case, except that thanks to SIMD */
-            /* we can efficiently process 8/16 columns in parallel */
-            opj_idwt53_v_cas1_mcols_SIMD(dwt->mem, sn, len, tiledp_col, stride);
+            /* we can efficiently process 8/16/32 columns in parallel */
+            kernels->idwt53_v_cas1_mcols(dwt->mem, sn, len, tiledp_col, stride);
             return;
         }
-#endif
         if (len > 2) {
             OPJ_INT32 c;
             for (c = 0; c < nb_cols; c++, tiledp_col++) {
@@ -1437,6 +933,7 @@ typedef struct {
     OPJ_INT32 * OPJ_RESTRICT tiledp;
     OPJ_UINT32 min_j;
     OPJ_UINT32 max_j;
+    OPJ_UINT32 cols;
     opj_encode_and_deinterleave_v_fnptr_type p_encode_and_deinterleave_v;
 } opj_dwt_encode_v_job_t;
 
@@ -1447,13 +944,13 @@ static void opj_dwt_encode_v_func(void* user_data, opj_tls_t* tls)
     (void)tls;
 
     job = (opj_dwt_encode_v_job_t*)user_data;
-    for (j = job->min_j; j + NB_ELTS_V8 - 1 < job->max_j; j += NB_ELTS_V8) {
+    for (j = job->min_j; j + job->cols - 1 < job->max_j; j += job->cols) {
         (*job->p_encode_and_deinterleave_v)(job->tiledp + j,
                                             job->v.mem,
                                             job->rh,
                                             job->v.cas == 0,
                                             job->w,
-                                            NB_ELTS_V8);
+                                            job->cols);
     }
     if (j < job->max_j) {
         (*job->p_encode_and_deinterleave_v)(job->tiledp + j,
@@ -1943,6 +1440,7 @@ static void opj_dwt_encode_and_deinterleave_v_real(
 static INLINE OPJ_BOOL opj_dwt_encode_procedure(opj_thread_pool_t* tp,
         opj_tcd_tilecomp_t * tilec,
         opj_encode_and_deinterleave_v_fnptr_type p_encode_and_deinterleave_v,
+        OPJ_UINT32 v_cols,
         opj_encode_and_deinterleave_h_one_row_fnptr_type
         p_encode_and_deinterleave_h_one_row)
 {
@@ -1966,11 +1464,11 @@ static INLINE OPJ_BOOL opj_dwt_encode_procedure(opj_thread_pool_t* tp,
 
     l_data_size = opj_dwt_max_resolution(tilec->resolutions, tilec->numresolutions);
     /* overflow check */
-    if (l_data_size > (SIZE_MAX / (NB_ELTS_V8 * sizeof(OPJ_INT32)))) {
+    if (l_data_size > (SIZE_MAX / (v_cols * sizeof(OPJ_INT32)))) {
         /* FIXME event manager error callback */
         return OPJ_FALSE;
     }
-    l_data_size *= NB_ELTS_V8 * sizeof(OPJ_INT32);
+    l_data_size *= v_cols * sizeof(OPJ_INT32);
     bj = (OPJ_INT32*)opj_aligned_32_malloc(l_data_size);
     /* l_data_size is equal to 0 when numresolutions == 1 but bj is not used */
     /* in that case, so do not error out */
@@ -2003,14 +1501,14 @@ static INLINE OPJ_BOOL opj_dwt_encode_procedure(opj_thread_pool_t* tp,
         dn = (OPJ_INT32)(rh - rh1);
 
         /* Perform vertical pass */
-        if (num_threads <= 1 || rw < 2 * NB_ELTS_V8) {
-            for (j = 0; j + NB_ELTS_V8 - 1 < rw; j += NB_ELTS_V8) {
+        if (num_threads <= 1 || rw < 2 * v_cols) {
+            for (j = 0; j + v_cols - 1 < rw; j += v_cols) {
                 p_encode_and_deinterleave_v(tiledp + j,
                                             bj,
                                             rh,
                                             cas_col == 0,
                                             w,
-                                            NB_ELTS_V8);
+                                            v_cols);
             }
             if (j < rw) {
                 p_encode_and_deinterleave_v(tiledp + j,
@@ -2027,7 +1525,7 @@ static INLINE OPJ_BOOL opj_dwt_encode_procedure(opj_thread_pool_t* tp,
             if (rw < num_jobs) {
                 num_jobs = rw;
             }
-            step_j = ((rw / num_jobs) / NB_ELTS_V8) * NB_ELTS_V8;
+            step_j = ((rw / num_jobs) / v_cols) * v_cols;
 
             for (j = 0; j < num_jobs; j++) {
                 opj_dwt_encode_v_job_t* job;
@@ -2053,6 +1551,7 @@ static INLINE OPJ_BOOL opj_dwt_encode_procedure(opj_thread_pool_t* tp,
                 job->tiledp = tiledp;
                 job->min_j = j * step_j;
                 job->max_j = (j + 1 == num_jobs) ? rw : (j + 1) * step_j;
+                job->cols = v_cols;
                 job->p_encode_and_deinterleave_v = p_encode_and_deinterleave_v;
                 opj_thread_pool_submit_job(tp, opj_dwt_encode_v_func, job);
             }
@@ -2125,8 +1624,10 @@ static INLINE OPJ_BOOL opj_dwt_encode_procedure(opj_thread_pool_t* tp,
 OPJ_BOOL opj_dwt_encode(opj_tcd_t *p_tcd,
                         opj_tcd_tilecomp_t * tilec)
 {
+    const opj_dwt_kernels_t* kernels = opj_dwt_get_kernels();
     return opj_dwt_encode_procedure(p_tcd->thread_pool, tilec,
-                                    opj_dwt_encode_and_deinterleave_v,
+                                    kernels->encode_and_deinterleave_v_53,
+                                    kernels->encode_cols,
                                     opj_dwt_encode_and_deinterleave_h_one_row);
 }
 
@@ -2139,7 +1640,7 @@ OPJ_BOOL opj_dwt_decode(opj_tcd_t *p_tcd, opj_tcd_tilecomp_t* tilec,
     if (p_tcd->whole_tile_decoding) {
         return opj_dwt_decode_tile(p_tcd->thread_pool, tilec, numres);
     } else {
-        return opj_dwt_decode_partial_tile(tilec, numres);
+        return opj_dwt_decode_partial_tile(tilec, numres, p_tcd->refinable);
     }
 }
 
@@ -2165,8 +1666,10 @@ OPJ_FLOAT64 opj_dwt_getnorm(OPJ_UINT32 level, OPJ_UINT32 orient)
 OPJ_BOOL opj_dwt_encode_real(opj_tcd_t *p_tcd,
                              opj_tcd_tilecomp_t * tilec)
 {
+    const opj_dwt_kernels_t* kernels = opj_dwt_get_kernels();
     return opj_dwt_encode_procedure(p_tcd->thread_pool, tilec,
-                                    opj_dwt_encode_and_deinterleave_v_real,
+                                    kernels->encode_and_deinterleave_v_97,
+                                    kernels->encode_cols,
                                     opj_dwt_encode_and_deinterleave_h_one_row_real);
 }
 
@@ -2266,14 +1769,15 @@ typedef struct {
 static void opj_dwt_decode_v_func(void* user_data, opj_tls_t* tls)
 {
     OPJ_UINT32 j;
+    OPJ_UINT32 parallel_cols;
     opj_dwt_decode_v_job_t* job;
     (void)tls;
 
     job = (opj_dwt_decode_v_job_t*)user_data;
-    for (j = job->min_j; j + PARALLEL_COLS_53 <= job->max_j;
-            j += PARALLEL_COLS_53) {
+    parallel_cols = (OPJ_UINT32)opj_dwt_get_kernels()->parallel_cols_53;
+    for (j = job->min_j; j + parallel_cols <= job->max_j; j += parallel_cols) {
         opj_idwt53_v(&job->v, &job->tiledp[j], (OPJ_SIZE_T)job->w,
-                     PARALLEL_COLS_53);
+                     (OPJ_INT32)parallel_cols);
     }
     if (j < job->max_j)
         opj_idwt53_v(&job->v, &job->tiledp[j], (OPJ_SIZE_T)job->w,
@@ -2284,198 +1788,251 @@ static void opj_dwt_decode_v_func(void* user_data, opj_tls_t* tls)
 }
 
 
-/* <summary>                            */
-/* Inverse wavelet transform in 2-D.    */
-/* </summary>                           */
-static OPJ_BOOL opj_dwt_decode_tile(opj_thread_pool_t* tp,
-                                    opj_tcd_tilecomp_t* tilec, OPJ_UINT32 numres)
+/* <summary>                                                      */
+/* Inverse wavelet transform in 2-D of one resolution level.      */
+/* Resolution resno is reconstructed in place from resolution     */
+/* resno - 1 and from the bands of resolution resno.              */
+/* mem is a temporary buffer of h_mem_size bytes.                 */
+/* </summary>                                                     */
+static OPJ_BOOL opj_dwt_decode_tile_level(opj_thread_pool_t* tp,
+        opj_tcd_tilecomp_t* tilec,
+        OPJ_UINT32 resno,
+        OPJ_INT32* mem,
+        OPJ_SIZE_T h_mem_size)
 {
     opj_dwt_t h;
     opj_dwt_t v;
 
-    opj_tcd_resolution_t* tr = tilec->resolutions;
+    opj_tcd_resolution_t* tr = tilec->resolutions + resno;
+    opj_tcd_resolution_t* tr_low = tr - 1;
 
     OPJ_UINT32 rw = (OPJ_UINT32)(tr->x1 -
                                  tr->x0);  /* width of the resolution level computed */
     OPJ_UINT32 rh = (OPJ_UINT32)(tr->y1 -
                                  tr->y0);  /* height of the resolution level computed */
 
+    OPJ_UINT32 w = (OPJ_UINT32)(tilec->resolutions[tilec->minimum_num_resolutions -
+                                                               1].x1 -
+                                tilec->resolutions[tilec->minimum_num_resolutions - 1].x0);
+    OPJ_INT32 * OPJ_RESTRICT tiledp = tilec->data;
+    OPJ_UINT32 j;
+    int num_threads = opj_thread_pool_get_thread_count(tp);
+
+    h.mem = mem;
+    v.mem = mem;
+    h.sn = (OPJ_INT32)(tr_low->x1 - tr_low->x0);
+    v.sn = (OPJ_INT32)(tr_low->y1 - tr_low->y0);
+
+    h.dn = (OPJ_INT32)(rw - (OPJ_UINT32)h.sn);
+    h.cas = tr->x0 % 2;
+
+    if (num_threads <= 1 || rh <= 1) {
+        for (j = 0; j < rh; ++j) {
+            opj_idwt53_h(&h, &tiledp[(OPJ_SIZE_T)j * w]);
+        }
+    } else {
+        OPJ_UINT32 num_jobs = (OPJ_UINT32)num_threads;
+        OPJ_UINT32 step_j;
+
+        if (rh < num_jobs) {
+            num_jobs = rh;
+        }
+        step_j = (rh / num_jobs);
+
+        for (j = 0; j < num_jobs; j++) {
+            opj_dwt_decode_h_job_t* job;
+
+            job = (opj_dwt_decode_h_job_t*) opj_malloc(sizeof(opj_dwt_decode_h_job_t));
+            if (!job) {
+                /* It would be nice to fallback to single thread case, but */
+                /* unfortunately some jobs may be launched and have modified */
+                /* tiledp, so it is not practical to recover from that error */
+                /* FIXME event manager error callback */
+                opj_thread_pool_wait_completion(tp, 0);
+                return OPJ_FALSE;
+            }
+            job->h = h;
+            job->rw = rw;
+            job->w = w;
+            job->tiledp = tiledp;
+            job->min_j = j * step_j;
+            job->max_j = (j + 1U) * step_j; /* this can overflow */
+            if (j == (num_jobs - 1U)) {  /* this will take care of the overflow */
+                job->max_j = rh;
+            }
+            job->h.mem = (OPJ_INT32*)opj_aligned_32_malloc(h_mem_size);
+            if (!job->h.mem) {
+                /* FIXME event manager error callback */
+                opj_thread_pool_wait_completion(tp, 0);
+                opj_free(job);
+                return OPJ_FALSE;
+            }
+            opj_thread_pool_submit_job(tp, opj_dwt_decode_h_func, job);
+        }
+        opj_thread_pool_wait_completion(tp, 0);
+    }
+
+    v.dn = (OPJ_INT32)(rh - (OPJ_UINT32)v.sn);
+    v.cas = tr->y0 % 2;
+
+    if (num_threads <= 1 || rw <= 1) {
+        const OPJ_UINT32 parallel_cols =
+            (OPJ_UINT32)opj_dwt_get_kernels()->parallel_cols_53;
+        for (j = 0; j + parallel_cols <= rw; j += parallel_cols) {
+            opj_idwt53_v(&v, &tiledp[j], (OPJ_SIZE_T)w, (OPJ_INT32)parallel_cols);
+        }
+        if (j < rw) {
+            opj_idwt53_v(&v, &tiledp[j], (OPJ_SIZE_T)w, (OPJ_INT32)(rw - j));
+        }
+    } else {
+        OPJ_UINT32 num_jobs = (OPJ_UINT32)num_threads;
+        OPJ_UINT32 step_j;
+
+        if (rw < num_jobs) {
+            num_jobs = rw;
+        }
+        step_j = (rw / num_jobs);
+
+        for (j = 0; j < num_jobs; j++) {
+            opj_dwt_decode_v_job_t* job;
+
+            job = (opj_dwt_decode_v_job_t*) opj_malloc(sizeof(opj_dwt_decode_v_job_t));
+            if (!job) {
+                /* It would be nice to fallback to single thread case, but */
+                /* unfortunately some jobs may be launched and have modified */
+                /* tiledp, so it is not practical to recover from that error */
+                /* FIXME event manager error callback */
+                opj_thread_pool_wait_completion(tp, 0);
+                return OPJ_FALSE;
+            }
+            job->v = v;
+            job->rh = rh;
+            job->w = w;
+            job->tiledp = tiledp;
+            job->min_j = j * step_j;
+            job->max_j = (j + 1U) * step_j; /* this can overflow */
+            if (j == (num_jobs - 1U)) {  /* this will take care of the overflow */
+                job->max_j = rw;
+            }
+            job->v.mem = (OPJ_INT32*)opj_aligned_32_malloc(h_mem_size);
+            if (!job->v.mem) {
+                /* FIXME event manager error callback */
+                opj_thread_pool_wait_completion(tp, 0);
+                opj_free(job);
+                return OPJ_FALSE;
+            }
+            opj_thread_pool_submit_job(tp, opj_dwt_decode_v_func, job);
+        }
+        opj_thread_pool_wait_completion(tp, 0);
+    }
+    return OPJ_TRUE;
+}
+
+/* <summary>                            */
+/* Inverse wavelet transform in 2-D.    */
+/* </summary>                           */
+static OPJ_BOOL opj_dwt_decode_tile(opj_thread_pool_t* tp,
+                                    opj_tcd_tilecomp_t* tilec, OPJ_UINT32 numres)
+{
+    OPJ_INT32* mem;
+
+    opj_tcd_resolution_t* tr = tilec->resolutions;
+
     OPJ_UINT32 w = (OPJ_UINT32)(tilec->resolutions[tilec->minimum_num_resolutions -
                                                                1].x1 -
                                 tilec->resolutions[tilec->minimum_num_resolutions - 1].x0);
     OPJ_SIZE_T h_mem_size;
-    int num_threads;
+    OPJ_UINT32 resno;
+    const OPJ_INT32 parallel_cols = opj_dwt_get_kernels()->parallel_cols_53;
 
     /* Not entirely sure for the return code of w == 0 which is triggered per */
     /* https://github.com/uclouvain/openjpeg/issues/1505 */
     if (numres == 1U || w == 0) {
         return OPJ_TRUE;
     }
-    num_threads = opj_thread_pool_get_thread_count(tp);
     h_mem_size = opj_dwt_max_resolution(tr, numres);
     /* overflow check */
-    if (h_mem_size > (SIZE_MAX / PARALLEL_COLS_53 / sizeof(OPJ_INT32))) {
+    if (h_mem_size > (SIZE_MAX / (OPJ_SIZE_T)parallel_cols / sizeof(OPJ_INT32))) {
         /* FIXME event manager error callback */
         return OPJ_FALSE;
     }
-    /* We need PARALLEL_COLS_53 times the height of the array, */
+    /* We need parallel_cols times the height of the array, */
     /* since for the vertical pass */
-    /* we process PARALLEL_COLS_53 columns at a time */
-    h_mem_size *= PARALLEL_COLS_53 * sizeof(OPJ_INT32);
-    h.mem = (OPJ_INT32*)opj_aligned_32_malloc(h_mem_size);
-    if (! h.mem) {
+    /* we process parallel_cols columns at a time */
+    h_mem_size *= (OPJ_SIZE_T)parallel_cols * sizeof(OPJ_INT32);
+    mem = (OPJ_INT32*)opj_aligned_32_malloc(h_mem_size);
+    if (! mem) {
         /* FIXME event manager error callback */
         return OPJ_FALSE;
     }
 
-    v.mem = h.mem;
-
-    while (--numres) {
-        OPJ_INT32 * OPJ_RESTRICT tiledp = tilec->data;
-        OPJ_UINT32 j;
-
-        ++tr;
-        h.sn = (OPJ_INT32)rw;
-        v.sn = (OPJ_INT32)rh;
-
-        rw = (OPJ_UINT32)(tr->x1 - tr->x0);
-        rh = (OPJ_UINT32)(tr->y1 - tr->y0);
+    for (resno = 1; resno < numres; ++resno) {
+        if (!opj_dwt_decode_tile_level(tp, tilec, resno, mem, h_mem_size)) {
+            opj_aligned_free(mem);
+            return OPJ_FALSE;
+        }
+    }
+    opj_aligned_free(mem);
+    return OPJ_TRUE;
+}
 
-        h.dn = (OPJ_INT32)(rw - (OPJ_UINT32)h.sn);
-        h.cas = tr->x0 % 2;
+OPJ_BOOL opj_dwt_decode_tile_resolution(opj_thread_pool_t* tp,
+                                        opj_tcd_tilecomp_t* tilec,
+                                        OPJ_UINT32 resno)
+{
+    OPJ_INT32* mem;
+    opj_tcd_resolution_t* tr = tilec->resolutions + resno;
+    OPJ_UINT32 w = (OPJ_UINT32)(tilec->resolutions[tilec->minimum_num_resolutions -
+                                                               1].x1 -
+                                tilec->resolutions[tilec->minimum_num_resolutions - 1].x0);
+    OPJ_SIZE_T h_mem_size;
+    OPJ_BOOL ret;
+    const OPJ_INT32 parallel_cols = opj_dwt_get_kernels()->parallel_cols_53;
 
-        if (num_threads <= 1 || rh <= 1) {
-            for (j = 0; j < rh; ++j) {
-                opj_idwt53_h(&h, &tiledp[(OPJ_SIZE_T)j * w]);
-            }
-        } else {
-            OPJ_UINT32 num_jobs = (OPJ_UINT32)num_threads;
-            OPJ_UINT32 step_j;
+    if (resno == 0 || w == 0) {
+        return OPJ_TRUE;
+    }
+    h_mem_size = opj_uint_max((OPJ_UINT32)(tr->x1 - tr->x0),
+                              (OPJ_UINT32)(tr->y1 - tr->y0));
+    /* overflow check */
+    if (h_mem_size > (SIZE_MAX / (OPJ_SIZE_T)parallel_cols / sizeof(OPJ_INT32))) {
+        return OPJ_FALSE;
+    }
+    h_mem_size *= (OPJ_SIZE_T)parallel_cols * sizeof(OPJ_INT32);
+    mem = (OPJ_INT32*)opj_aligned_32_malloc(h_mem_size);
+    if (! mem) {
+        return OPJ_FALSE;
+    }
+    ret = opj_dwt_decode_tile_level(tp, tilec, resno, mem, h_mem_size);
+    opj_aligned_free(mem);
+    return ret;
+}
 
-            if (rh < num_jobs) {
-                num_jobs = rh;
-            }
-            step_j = (rh / num_jobs);
-
-            for (j = 0; j < num_jobs; j++) {
-                opj_dwt_decode_h_job_t* job;
-
-                job = (opj_dwt_decode_h_job_t*) opj_malloc(sizeof(opj_dwt_decode_h_job_t));
-                if (!job) {
-                    /* It would be nice to fallback to single thread case, but */
-                    /* unfortunately some jobs may be launched and have modified */
-                    /* tiledp, so it is not practical to recover from that error */
-                    /* FIXME event manager error callback */
-                    opj_thread_pool_wait_completion(tp, 0);
-                    opj_aligned_free(h.mem);
-                    return OPJ_FALSE;
-                }
-                job->h = h;
-                job->rw = rw;
-                job->w = w;
-                job->tiledp = tiledp;
-                job->min_j = j * step_j;
-                job->max_j = (j + 1U) * step_j; /* this can overflow */
-                if (j == (num_jobs - 1U)) {  /* this will take care of the overflow */
-                    job->max_j = rh;
-                }
-                job->h.mem = (OPJ_INT32*)opj_aligned_32_malloc(h_mem_size);
-                if (!job->h.mem) {
-                    /* FIXME event manager error callback */
-                    opj_thread_pool_wait_completion(tp, 0);
-                    opj_free(job);
-                    opj_aligned_free(h.mem);
-                    return OPJ_FALSE;
-                }
-                opj_thread_pool_submit_job(tp, opj_dwt_decode_h_func, job);
-            }
-            opj_thread_pool_wait_completion(tp, 0);
-        }
-
-        v.dn = (OPJ_INT32)(rh - (OPJ_UINT32)v.sn);
-        v.cas = tr->y0 % 2;
-
-        if (num_threads <= 1 || rw <= 1) {
-            for (j = 0; j + PARALLEL_COLS_53 <= rw;
-                    j += PARALLEL_COLS_53) {
-                opj_idwt53_v(&v, &tiledp[j], (OPJ_SIZE_T)w, PARALLEL_COLS_53);
-            }
-            if (j < rw) {
-                opj_idwt53_v(&v, &tiledp[j], (OPJ_SIZE_T)w, (OPJ_INT32)(rw - j));
-            }
-        } else {
-            OPJ_UINT32 num_jobs = (OPJ_UINT32)num_threads;
-            OPJ_UINT32 step_j;
-
-            if (rw < num_jobs) {
-                num_jobs = rw;
-            }
-            step_j = (rw / num_jobs);
-
-            for (j = 0; j < num_jobs; j++) {
-                opj_dwt_decode_v_job_t* job;
-
-                job = (opj_dwt_decode_v_job_t*) opj_malloc(sizeof(opj_dwt_decode_v_job_t));
-                if (!job) {
-                    /* It would be nice to fallback to single thread case, but */
-                    /* unfortunately some jobs may be launched and have modified */
-                    /* tiledp, so it is not practical to recover from that error */
-                    /* FIXME event manager error callback */
-                    opj_thread_pool_wait_completion(tp, 0);
-                    opj_aligned_free(v.mem);
-                    return OPJ_FALSE;
-                }
-                job->v = v;
-                job->rh = rh;
-                job->w = w;
-                job->tiledp = tiledp;
-                job->min_j = j * step_j;
-                job->max_j = (j + 1U) * step_j; /* this can overflow */
-                if (j == (num_jobs - 1U)) {  /* this will take care of the overflow */
-                    job->max_j = rw;
-                }
-                job->v.mem = (OPJ_INT32*)opj_aligned_32_malloc(h_mem_size);
-                if (!job->v.mem) {
-                    /* FIXME event manager error callback */
-                    opj_thread_pool_wait_completion(tp, 0);
-                    opj_free(job);
-                    opj_aligned_free(v.mem);
-                    return OPJ_FALSE;
-                }
-                opj_thread_pool_submit_job(tp, opj_dwt_decode_v_func, job);
-            }
-            opj_thread_pool_wait_completion(tp, 0);
-        }
-    }
-    opj_aligned_free(h.mem);
-    return OPJ_TRUE;
-}
-
-static void opj_dwt_interleave_partial_h(OPJ_INT32 *dest,
-        OPJ_INT32 cas,
-        opj_sparse_array_int32_t* sa,
-        OPJ_UINT32 sa_line,
-        OPJ_UINT32 sn,
-        OPJ_UINT32 win_l_x0,
-        OPJ_UINT32 win_l_x1,
-        OPJ_UINT32 win_h_x0,
-        OPJ_UINT32 win_h_x1)
-{
-    OPJ_BOOL ret;
-    ret = opj_sparse_array_int32_read(sa,
-                                      win_l_x0, sa_line,
-                                      win_l_x1, sa_line + 1,
-                                      dest + cas + 2 * win_l_x0,
-                                      2, 0, OPJ_TRUE);
-    assert(ret);
-    ret = opj_sparse_array_int32_read(sa,
-                                      sn + win_h_x0, sa_line,
-                                      sn + win_h_x1, sa_line + 1,
-                                      dest + 1 - cas + 2 * win_h_x0,
-                                      2, 0, OPJ_TRUE);
-    assert(ret);
-    OPJ_UNUSED(ret);
-}
+static void opj_dwt_interleave_partial_h(OPJ_INT32 *dest,
+        OPJ_INT32 cas,
+        opj_sparse_array_int32_t* sa,
+        OPJ_UINT32 sa_line,
+        OPJ_UINT32 sn,
+        OPJ_UINT32 win_l_x0,
+        OPJ_UINT32 win_l_x1,
+        OPJ_UINT32 win_h_x0,
+        OPJ_UINT32 win_h_x1)
+{
+    OPJ_BOOL ret;
+    ret = opj_sparse_array_int32_read(sa,
+                                      win_l_x0, sa_line,
+                                      win_l_x1, sa_line + 1,
+                                      dest + cas + 2 * win_l_x0,
+                                      2, 0, OPJ_TRUE);
+    assert(ret);
+    ret = opj_sparse_array_int32_read(sa,
+                                      sn + win_h_x0, sa_line,
+                                      sn + win_h_x1, sa_line + 1,
+                                      dest + 1 - cas + 2 * win_h_x0,
+                                      2, 0, OPJ_TRUE);
+    assert(ret);
+    OPJ_UNUSED(ret);
+}
 
 
 static void opj_dwt_interleave_partial_v(OPJ_INT32 *dest,
@@ -2785,21 +2342,17 @@ static void opj_dwt_segment_grow(OPJ_UINT32 filter_width,
 }
 
 
-static opj_sparse_array_int32_t* opj_dwt_init_sparse_array(
+/** Writes the decoded code-blocks of the resolutions [resno_start, numres[ */
+/** of a tile component in a sparse array */
+static OPJ_BOOL opj_dwt_fill_sparse_array(
+    opj_sparse_array_int32_t* sa,
     opj_tcd_tilecomp_t* tilec,
+    OPJ_UINT32 resno_start,
     OPJ_UINT32 numres)
 {
-    opj_tcd_resolution_t* tr_max = &(tilec->resolutions[numres - 1]);
-    OPJ_UINT32 w = (OPJ_UINT32)(tr_max->x1 - tr_max->x0);
-    OPJ_UINT32 h = (OPJ_UINT32)(tr_max->y1 - tr_max->y0);
     OPJ_UINT32 resno, bandno, precno, cblkno;
-    opj_sparse_array_int32_t* sa = opj_sparse_array_int32_create(
-                                       w, h, opj_uint_min(w, 64), opj_uint_min(h, 64));
-    if (sa == NULL) {
-        return NULL;
-    }
 
-    for (resno = 0; resno < numres; ++resno) {
+    for (resno = resno_start; resno < numres; ++resno) {
         opj_tcd_resolution_t* res = &tilec->resolutions[resno];
 
         for (bandno = 0; bandno < res->numbands; ++bandno) {
@@ -2828,8 +2381,7 @@ static opj_sparse_array_int32_t* opj_dwt_init_sparse_array(
                                                           x + cblk_w, y + cblk_h,
                                                           cblk->decoded_data,
                                                           1, cblk_w, OPJ_TRUE)) {
-                            opj_sparse_array_int32_free(sa);
-                            return NULL;
+                            return OPJ_FALSE;
                         }
                     }
                 }
@@ -2837,18 +2389,92 @@ static opj_sparse_array_int32_t* opj_dwt_init_sparse_array(
         }
     }
 
+    return OPJ_TRUE;
+}
+
+/** Returns the sparse array of the coefficients of the resolutions */
+/** [0, numres[ of a tile component, for a partial inverse transform. */
+/** The resolution levels up to *p_resno_start - 1 are already */
+/** reconstructed in it, when the coefficients kept by a previous */
+/** transform of the same window with fewer resolutions are reused. */
+/** Otherwise, *p_resno_start is 1. */
+static opj_sparse_array_int32_t* opj_dwt_init_sparse_array(
+    opj_tcd_tilecomp_t* tilec,
+    OPJ_UINT32 numres,
+    OPJ_BOOL keep_state,
+    OPJ_UINT32* p_resno_start)
+{
+    /* The coefficients that are kept must fit all the resolutions */
+    opj_tcd_resolution_t* tr_max = &(tilec->resolutions[keep_state ?
+                                                       tilec->numresolutions - 1 : numres - 1]);
+    OPJ_UINT32 w = (OPJ_UINT32)(tr_max->x1 - tr_max->x0);
+    OPJ_UINT32 h = (OPJ_UINT32)(tr_max->y1 - tr_max->y0);
+    OPJ_UINT32 resno_filled;
+    opj_sparse_array_int32_t* sa;
+
+    if (keep_state && tilec->dwt_sa != NULL &&
+            tilec->dwt_numres <= numres &&
+            tilec->dwt_win_x0 == tilec->win_x0 &&
+            tilec->dwt_win_y0 == tilec->win_y0 &&
+            tilec->dwt_win_x1 == tilec->win_x1 &&
+            tilec->dwt_win_y1 == tilec->win_y1) {
+        /* The levels of the lower resolutions are computed in the same */
+        /* way whatever the number of resolutions, and only write in the */
+        /* area of their resolution, which the bands of the next */
+        /* resolutions do not overlap */
+        sa = tilec->dwt_sa;
+        resno_filled = tilec->dwt_numres;
+        tilec->dwt_sa = NULL;
+        tilec->dwt_numres = 0;
+    } else {
+        opj_tcd_release_dwt_state(tilec);
+        sa = opj_sparse_array_int32_create(w, h, opj_uint_min(w, 64),
+                                           opj_uint_min(h, 64));
+        if (sa == NULL) {
+            return NULL;
+        }
+        resno_filled = 0;
+    }
+
+    if (!opj_dwt_fill_sparse_array(sa, tilec, resno_filled, numres)) {
+        opj_sparse_array_int32_free(sa);
+        return NULL;
+    }
+    *p_resno_start = opj_uint_max(resno_filled, 1);
     return sa;
 }
 
+/** Ends a partial inverse transform of a tile component, keeping its */
+/** coefficients for a next transform with more resolutions if keep_state */
+static void opj_dwt_release_sparse_array(
+    opj_tcd_tilecomp_t* tilec,
+    opj_sparse_array_int32_t* sa,
+    OPJ_UINT32 numres,
+    OPJ_BOOL keep_state)
+{
+    if (!keep_state) {
+        opj_sparse_array_int32_free(sa);
+        return;
+    }
+    tilec->dwt_sa = sa;
+    tilec->dwt_numres = numres;
+    tilec->dwt_win_x0 = tilec->win_x0;
+    tilec->dwt_win_y0 = tilec->win_y0;
+    tilec->dwt_win_x1 = tilec->win_x1;
+    tilec->dwt_win_y1 = tilec->win_y1;
+}
+
 
 static OPJ_BOOL opj_dwt_decode_partial_tile(
     opj_tcd_tilecomp_t* tilec,
-    OPJ_UINT32 numres)
+    OPJ_UINT32 numres,
+    OPJ_BOOL keep_state)
 {
     opj_sparse_array_int32_t* sa;
     opj_dwt_t h;
     opj_dwt_t v;
     OPJ_UINT32 resno;
+    OPJ_UINT32 resno_start;
     /* This value matches the maximum left/right extension given in tables */
     /* F.2 and F.3 of the standard. */
     const OPJ_UINT32 filter_width = 2U;
@@ -2874,12 +2500,12 @@ static OPJ_BOOL opj_dwt_decode_partial_tile(
         return OPJ_TRUE;
     }
 
-    sa = opj_dwt_init_sparse_array(tilec, numres);
+    sa = opj_dwt_init_sparse_array(tilec, numres, keep_state, &resno_start);
     if (sa == NULL) {
         return OPJ_FALSE;
     }
 
-    if (numres == 1U) {
+    if (resno_start >= numres) {
         OPJ_BOOL ret = opj_sparse_array_int32_read(sa,
                        tr_max->win_x0 - (OPJ_UINT32)tr_max->x0,
                        tr_max->win_y0 - (OPJ_UINT32)tr_max->y0,
@@ -2890,7 +2516,7 @@ static OPJ_BOOL opj_dwt_decode_partial_tile(
                        OPJ_TRUE);
         assert(ret);
         OPJ_UNUSED(ret);
-        opj_sparse_array_int32_free(sa);
+        opj_dwt_release_sparse_array(tilec, sa, numres, keep_state);
         return OPJ_TRUE;
     }
     h_mem_size = opj_dwt_max_resolution(tr, numres);
@@ -2912,7 +2538,12 @@ static OPJ_BOOL opj_dwt_decode_partial_tile(
 
     v.mem = h.mem;
 
-    for (resno = 1; resno < numres; resno ++) {
+    /* Resolution the transform starts from */
+    tr = &(tilec->resolutions[resno_start - 1]);
+    rw = (OPJ_UINT32)(tr->x1 - tr->x0);
+    rh = (OPJ_UINT32)(tr->y1 - tr->y0);
+
+    for (resno = resno_start; resno < numres; resno ++) {
         OPJ_UINT32 i, j;
         /* Window of interest subband-based coordinates */
         OPJ_UINT32 win_ll_x0, win_ll_y0, win_ll_x1, win_ll_y1;
@@ -3083,7 +2714,7 @@ static OPJ_BOOL opj_dwt_decode_partial_tile(
         assert(ret);
         OPJ_UNUSED(ret);
     }
-    opj_sparse_array_int32_free(sa);
+    opj_dwt_release_sparse_array(tilec, sa, numres, keep_state);
     return OPJ_TRUE;
 }
 
@@ -3245,9 +2876,10 @@ static void opj_v8dwt_interleave_partial_v(opj_v8dwt_t* OPJ_RESTRICT dwt,
 static void opj_v8dwt_decode_step1_sse(opj_v8_t* w,
                                        OPJ_UINT32 start,
                                        OPJ_UINT32 end,
-                                       const __m128 c)
+                                       const OPJ_FLOAT32 cst)
 {
     __m128* OPJ_RESTRICT vw = (__m128*) w;
+    const __m128 c = _mm_set1_ps(cst);
     OPJ_UINT32 i = start;
     /* To be adapted if NB_ELTS_V8 changes */
     vw += 4 * start;
@@ -3262,8 +2894,9 @@ static void opj_v8dwt_decode_step2_sse(opj_v8_t* l, opj_v8_t* w,
                                        OPJ_UINT32 start,
                                        OPJ_UINT32 end,
                                        OPJ_UINT32 m,
-                                       __m128 c)
+                                       OPJ_FLOAT32 cst)
 {
+    __m128 c = _mm_set1_ps(cst);
     __m128* OPJ_RESTRICT vl = (__m128*) l;
     __m128* OPJ_RESTRICT vw = (__m128*) w;
     /* To be adapted if NB_ELTS_V8 changes */
@@ -3361,7 +2994,7 @@ static void opj_v8dwt_decode_step2_neon(opj_v8_t* l, opj_v8_t* w,
     }
 }
 
-#else
+#endif
 
 static void opj_v8dwt_decode_step1(opj_v8_t* w,
                                    OPJ_UINT32 start,
@@ -3424,7 +3057,81 @@ static void opj_v8dwt_decode_step2(opj_v8_t* l, opj_v8_t* w,
     }
 }
 
+/** Plain C kernels */
+static const opj_dwt_kernels_t opj_dwt_kernels_generic = {
+    8,
+#ifdef STANDARD_SLOW_VERSION
+    NULL,
+#else
+    opj_idwt53_h_cas0,
+#endif
+    NULL,
+    NULL,
+    opj_v8dwt_decode_step1,
+    opj_v8dwt_decode_step2,
+    NB_ELTS_V8,
+    opj_dwt_encode_and_deinterleave_v,
+    opj_dwt_encode_and_deinterleave_v_real
+};
+
+#if defined(__SSE__) || defined(__ARM_NEON)
+/** Kernels for the instruction set enabled by the compiler flags */
+static const opj_dwt_kernels_t opj_dwt_kernels_baseline = {
+#if (defined(__ARM_NEON) || defined(__SSE2__)) && !defined(STANDARD_SLOW_VERSION)
+    PARALLEL_COLS_53,
+    opj_idwt53_h_cas0,
+    opj_idwt53_v_cas0_mcols_SIMD,
+    opj_idwt53_v_cas1_mcols_SIMD,
+#else
+    8,
+#ifdef STANDARD_SLOW_VERSION
+    NULL,
+#else
+    opj_idwt53_h_cas0,
+#endif
+    NULL,
+    NULL,
+#endif
+#ifdef __SSE__
+    opj_v8dwt_decode_step1_sse,
+    opj_v8dwt_decode_step2_sse,
+#else
+    opj_v8dwt_decode_step1_neon,
+    opj_v8dwt_decode_step2_neon,
+#endif
+#if (defined(__AVX2__) || defined(__AVX512F__)) && !defined(STANDARD_SLOW_VERSION)
+    VREG_INT_COUNT,
+    opj_dwt_encode_and_deinterleave_v_53_SIMD,
+    opj_dwt_encode_and_deinterleave_v_97_SIMD
+#else
+    NB_ELTS_V8,
+    opj_dwt_encode_and_deinterleave_v,
+    opj_dwt_encode_and_deinterleave_v_real
+#endif
+};
+#endif
+
+static const opj_dwt_kernels_t* opj_dwt_get_kernels(void)
+{
+    switch (opj_cpu_get_simd_level()) {
+#ifdef OPJ_HAVE_AVX512_KERNELS
+    case OPJ_SIMD_AVX512:
+        return &opj_dwt_kernels_avx512;
+#endif
+#ifdef OPJ_HAVE_AVX2_KERNELS
+    case OPJ_SIMD_AVX2:
+        return &opj_dwt_kernels_avx2;
 #endif
+    case OPJ_SIMD_GENERIC:
+        return &opj_dwt_kernels_generic;
+    default:
+#if defined(__SSE__) || defined(__ARM_NEON)
+        return &opj_dwt_kernels_baseline;
+#else
+        return &opj_dwt_kernels_generic;
+#endif
+    }
+}
 
 /* <summary>                             */
 /* Inverse 9-7 wavelet transform in 1-D. */
@@ -3440,6 +3147,7 @@ static void opj_v8dwt_decode(opj_v8dwt_t* OPJ_RESTRICT dwt)
     /* Due to using two_invK instead of invK, we have to compensate in tcd.c */
     /* the computation of the stepsize for the non LL subbands */
     const float two_invK = 1.625732422f;
+    const opj_dwt_kernels_t* kernels = opj_dwt_get_kernels();
     if (dwt->cas == 0) {
         if (!((dwt->dn > 0) || (dwt->sn > 1))) {
             return;
@@ -3453,70 +3161,26 @@ static void opj_v8dwt_decode(opj_v8dwt_t* OPJ_RESTRICT dwt)
         a = 1;
         b = 0;
     }
-#ifdef __SSE__
-    opj_v8dwt_decode_step1_sse(dwt->wavelet + a, dwt->win_l_x0, dwt->win_l_x1,
-                               _mm_set1_ps(opj_K));
-    opj_v8dwt_decode_step1_sse(dwt->wavelet + b, dwt->win_h_x0, dwt->win_h_x1,
-                               _mm_set1_ps(two_invK));
-    opj_v8dwt_decode_step2_sse(dwt->wavelet + b, dwt->wavelet + a + 1,
-                               dwt->win_l_x0, dwt->win_l_x1,
-                               (OPJ_UINT32)opj_int_min(dwt->sn, dwt->dn - a),
-                               _mm_set1_ps(-opj_dwt_delta));
-    opj_v8dwt_decode_step2_sse(dwt->wavelet + a, dwt->wavelet + b + 1,
-                               dwt->win_h_x0, dwt->win_h_x1,
-                               (OPJ_UINT32)opj_int_min(dwt->dn, dwt->sn - b),
-                               _mm_set1_ps(-opj_dwt_gamma));
-    opj_v8dwt_decode_step2_sse(dwt->wavelet + b, dwt->wavelet + a + 1,
-                               dwt->win_l_x0, dwt->win_l_x1,
-                               (OPJ_UINT32)opj_int_min(dwt->sn, dwt->dn - a),
-                               _mm_set1_ps(-opj_dwt_beta));
-    opj_v8dwt_decode_step2_sse(dwt->wavelet + a, dwt->wavelet + b + 1,
-                               dwt->win_h_x0, dwt->win_h_x1,
-                               (OPJ_UINT32)opj_int_min(dwt->dn, dwt->sn - b),
-                               _mm_set1_ps(-opj_dwt_alpha));
-#elif defined(__ARM_NEON)
-    opj_v8dwt_decode_step1_neon(dwt->wavelet + a, dwt->win_l_x0, dwt->win_l_x1,
+    kernels->v8dwt_decode_step1(dwt->wavelet + a, dwt->win_l_x0, dwt->win_l_x1,
                                 opj_K);
-    opj_v8dwt_decode_step1_neon(dwt->wavelet + b, dwt->win_h_x0, dwt->win_h_x1,
+    kernels->v8dwt_decode_step1(dwt->wavelet + b, dwt->win_h_x0, dwt->win_h_x1,
                                 two_invK);
-    opj_v8dwt_decode_step2_neon(dwt->wavelet + b, dwt->wavelet + a + 1,
+    kernels->v8dwt_decode_step2(dwt->wavelet + b, dwt->wavelet + a + 1,
                                 dwt->win_l_x0, dwt->win_l_x1,
                                 (OPJ_UINT32)opj_int_min(dwt->sn, dwt->dn - a),
                                 -opj_dwt_delta);
-    opj_v8dwt_decode_step2_neon(dwt->wavelet + a, dwt->wavelet + b + 1,
+    kernels->v8dwt_decode_step2(dwt->wavelet + a, dwt->wavelet + b + 1,
                                 dwt->win_h_x0, dwt->win_h_x1,
                                 (OPJ_UINT32)opj_int_min(dwt->dn, dwt->sn - b),
                                 -opj_dwt_gamma);
-    opj_v8dwt_decode_step2_neon(dwt->wavelet + b, dwt->wavelet + a + 1,
+    kernels->v8dwt_decode_step2(dwt->wavelet + b, dwt->wavelet + a + 1,
                                 dwt->win_l_x0, dwt->win_l_x1,
                                 (OPJ_UINT32)opj_int_min(dwt->sn, dwt->dn - a),
                                 -opj_dwt_beta);
-    opj_v8dwt_decode_step2_neon(dwt->wavelet + a, dwt->wavelet + b + 1,
+    kernels->v8dwt_decode_step2(dwt->wavelet + a, dwt->wavelet + b + 1,
                                 dwt->win_h_x0, dwt->win_h_x1,
                                 (OPJ_UINT32)opj_int_min(dwt->dn, dwt->sn - b),
                                 -opj_dwt_alpha);
-#else
-    opj_v8dwt_decode_step1(dwt->wavelet + a, dwt->win_l_x0, dwt->win_l_x1,
-                           opj_K);
-    opj_v8dwt_decode_step1(dwt->wavelet + b, dwt->win_h_x0, dwt->win_h_x1,
-                           two_invK);
-    opj_v8dwt_decode_step2(dwt->wavelet + b, dwt->wavelet + a + 1,
-                           dwt->win_l_x0, dwt->win_l_x1,
-                           (OPJ_UINT32)opj_int_min(dwt->sn, dwt->dn - a),
-                           -opj_dwt_delta);
-    opj_v8dwt_decode_step2(dwt->wavelet + a, dwt->wavelet + b + 1,
-                           dwt->win_h_x0, dwt->win_h_x1,
-                           (OPJ_UINT32)opj_int_min(dwt->dn, dwt->sn - b),
-                           -opj_dwt_gamma);
-    opj_v8dwt_decode_step2(dwt->wavelet + b, dwt->wavelet + a + 1,
-                           dwt->win_l_x0, dwt->win_l_x1,
-                           (OPJ_UINT32)opj_int_min(dwt->sn, dwt->dn - a),
-                           -opj_dwt_beta);
-    opj_v8dwt_decode_step2(dwt->wavelet + a, dwt->wavelet + b + 1,
-                           dwt->win_h_x0, dwt->win_h_x1,
-                           (OPJ_UINT32)opj_int_min(dwt->dn, dwt->sn - b),
-                           -opj_dwt_alpha);
-#endif
 }
 
 typedef struct {
@@ -3606,18 +3270,24 @@ static void opj_dwt97_decode_v_func(void* user_data, opj_tls_t* tls)
 }
 
 
-/* <summary>                             */
-/* Inverse 9-7 wavelet transform in 2-D. */
-/* </summary>                            */
+/* <summary>                                                      */
+/* Inverse 9-7 wavelet transform in 2-D of one resolution level.  */
+/* Resolution resno is reconstructed in place from resolution     */
+/* resno - 1 and from the bands of resolution resno.              */
+/* wavelet is a temporary buffer of l_data_size elements.         */
+/* </summary>                                                     */
 static
-OPJ_BOOL opj_dwt_decode_tile_97(opj_thread_pool_t* tp,
-                                opj_tcd_tilecomp_t* OPJ_RESTRICT tilec,
-                                OPJ_UINT32 numres)
+OPJ_BOOL opj_dwt_decode_tile_97_level(opj_thread_pool_t* tp,
+                                      opj_tcd_tilecomp_t* OPJ_RESTRICT tilec,
+                                      OPJ_UINT32 resno,
+                                      opj_v8_t* wavelet,
+                                      OPJ_SIZE_T l_data_size)
 {
     opj_v8dwt_t h;
     opj_v8dwt_t v;
 
-    opj_tcd_resolution_t* res = tilec->resolutions;
+    opj_tcd_resolution_t* res = tilec->resolutions + resno;
+    opj_tcd_resolution_t* res_low = res - 1;
 
     OPJ_UINT32 rw = (OPJ_UINT32)(res->x1 -
                                  res->x0);    /* width of the resolution level computed */
@@ -3628,221 +3298,257 @@ OPJ_BOOL opj_dwt_decode_tile_97(opj_thread_pool_t* tp,
                                                                1].x1 -
                                 tilec->resolutions[tilec->minimum_num_resolutions - 1].x0);
 
-    OPJ_SIZE_T l_data_size;
+    OPJ_FLOAT32 * OPJ_RESTRICT aj = (OPJ_FLOAT32*) tilec->data;
+    OPJ_UINT32 j;
     const int num_threads = opj_thread_pool_get_thread_count(tp);
 
-    if (numres == 1) {
-        return OPJ_TRUE;
-    }
+    h.wavelet = wavelet;
+    v.wavelet = wavelet;
+    h.sn = (OPJ_INT32)(res_low->x1 - res_low->x0);
+    v.sn = (OPJ_INT32)(res_low->y1 - res_low->y0);
 
-    l_data_size = opj_dwt_max_resolution(res, numres);
-    /* overflow check */
-    if (l_data_size > (SIZE_MAX / sizeof(opj_v8_t))) {
-        /* FIXME event manager error callback */
-        return OPJ_FALSE;
-    }
-    h.wavelet = (opj_v8_t*) opj_aligned_malloc(l_data_size * sizeof(opj_v8_t));
-    if (!h.wavelet) {
-        /* FIXME event manager error callback */
-        return OPJ_FALSE;
-    }
-    v.wavelet = h.wavelet;
+    h.dn = (OPJ_INT32)(rw - (OPJ_UINT32)h.sn);
+    h.cas = res->x0 % 2;
 
-    while (--numres) {
-        OPJ_FLOAT32 * OPJ_RESTRICT aj = (OPJ_FLOAT32*) tilec->data;
-        OPJ_UINT32 j;
-
-        h.sn = (OPJ_INT32)rw;
-        v.sn = (OPJ_INT32)rh;
+    h.win_l_x0 = 0;
+    h.win_l_x1 = (OPJ_UINT32)h.sn;
+    h.win_h_x0 = 0;
+    h.win_h_x1 = (OPJ_UINT32)h.dn;
 
-        ++res;
-
-        rw = (OPJ_UINT32)(res->x1 -
-                          res->x0);   /* width of the resolution level computed */
-        rh = (OPJ_UINT32)(res->y1 -
-                          res->y0);   /* height of the resolution level computed */
-
-        h.dn = (OPJ_INT32)(rw - (OPJ_UINT32)h.sn);
-        h.cas = res->x0 % 2;
+    if (num_threads <= 1 || rh < 2 * NB_ELTS_V8) {
+        for (j = 0; j + (NB_ELTS_V8 - 1) < rh; j += NB_ELTS_V8) {
+            OPJ_UINT32 k;
+            opj_v8dwt_interleave_h(&h, aj, w, NB_ELTS_V8);
+            opj_v8dwt_decode(&h);
 
-        h.win_l_x0 = 0;
-        h.win_l_x1 = (OPJ_UINT32)h.sn;
-        h.win_h_x0 = 0;
-        h.win_h_x1 = (OPJ_UINT32)h.dn;
+            /* To be adapted if NB_ELTS_V8 changes */
+            for (k = 0; k < rw; k++) {
+                aj[k      ] = h.wavelet[k].f[0];
+                aj[k + (OPJ_SIZE_T)w  ] = h.wavelet[k].f[1];
+                aj[k + (OPJ_SIZE_T)w * 2] = h.wavelet[k].f[2];
+                aj[k + (OPJ_SIZE_T)w * 3] = h.wavelet[k].f[3];
+            }
+            for (k = 0; k < rw; k++) {
+                aj[k + (OPJ_SIZE_T)w * 4] = h.wavelet[k].f[4];
+                aj[k + (OPJ_SIZE_T)w * 5] = h.wavelet[k].f[5];
+                aj[k + (OPJ_SIZE_T)w * 6] = h.wavelet[k].f[6];
+                aj[k + (OPJ_SIZE_T)w * 7] = h.wavelet[k].f[7];
+            }
 
-        if (num_threads <= 1 || rh < 2 * NB_ELTS_V8) {
-            for (j = 0; j + (NB_ELTS_V8 - 1) < rh; j += NB_ELTS_V8) {
-                OPJ_UINT32 k;
-                opj_v8dwt_interleave_h(&h, aj, w, NB_ELTS_V8);
-                opj_v8dwt_decode(&h);
+            aj += w * NB_ELTS_V8;
+        }
+    } else {
+        OPJ_UINT32 num_jobs = (OPJ_UINT32)num_threads;
+        OPJ_UINT32 step_j;
 
-                /* To be adapted if NB_ELTS_V8 changes */
-                for (k = 0; k < rw; k++) {
-                    aj[k      ] = h.wavelet[k].f[0];
-                    aj[k + (OPJ_SIZE_T)w  ] = h.wavelet[k].f[1];
-                    aj[k + (OPJ_SIZE_T)w * 2] = h.wavelet[k].f[2];
-                    aj[k + (OPJ_SIZE_T)w * 3] = h.wavelet[k].f[3];
-                }
-                for (k = 0; k < rw; k++) {
-                    aj[k + (OPJ_SIZE_T)w * 4] = h.wavelet[k].f[4];
-                    aj[k + (OPJ_SIZE_T)w * 5] = h.wavelet[k].f[5];
-                    aj[k + (OPJ_SIZE_T)w * 6] = h.wavelet[k].f[6];
-                    aj[k + (OPJ_SIZE_T)w * 7] = h.wavelet[k].f[7];
-                }
+        if ((rh / NB_ELTS_V8) < num_jobs) {
+            num_jobs = rh / NB_ELTS_V8;
+        }
+        step_j = ((rh / num_jobs) / NB_ELTS_V8) * NB_ELTS_V8;
+        for (j = 0; j < num_jobs; j++) {
+            opj_dwt97_decode_h_job_t* job;
 
-                aj += w * NB_ELTS_V8;
+            job = (opj_dwt97_decode_h_job_t*) opj_malloc(sizeof(opj_dwt97_decode_h_job_t));
+            if (!job) {
+                opj_thread_pool_wait_completion(tp, 0);
+                return OPJ_FALSE;
             }
-        } else {
-            OPJ_UINT32 num_jobs = (OPJ_UINT32)num_threads;
-            OPJ_UINT32 step_j;
-
-            if ((rh / NB_ELTS_V8) < num_jobs) {
-                num_jobs = rh / NB_ELTS_V8;
+            job->h.wavelet = (opj_v8_t*)opj_aligned_malloc(l_data_size * sizeof(opj_v8_t));
+            if (!job->h.wavelet) {
+                opj_thread_pool_wait_completion(tp, 0);
+                opj_free(job);
+                return OPJ_FALSE;
             }
-            step_j = ((rh / num_jobs) / NB_ELTS_V8) * NB_ELTS_V8;
-            for (j = 0; j < num_jobs; j++) {
-                opj_dwt97_decode_h_job_t* job;
+            job->h.dn = h.dn;
+            job->h.sn = h.sn;
+            job->h.cas = h.cas;
+            job->h.win_l_x0 = h.win_l_x0;
+            job->h.win_l_x1 = h.win_l_x1;
+            job->h.win_h_x0 = h.win_h_x0;
+            job->h.win_h_x1 = h.win_h_x1;
+            job->rw = rw;
+            job->w = w;
+            job->aj = aj;
+            job->nb_rows = (j + 1 == num_jobs) ? (rh & (OPJ_UINT32)~
+                                                  (NB_ELTS_V8 - 1)) - j * step_j : step_j;
+            aj += w * job->nb_rows;
+            opj_thread_pool_submit_job(tp, opj_dwt97_decode_h_func, job);
+        }
+        opj_thread_pool_wait_completion(tp, 0);
+        j = rh & (OPJ_UINT32)~(NB_ELTS_V8 - 1);
+    }
 
-                job = (opj_dwt97_decode_h_job_t*) opj_malloc(sizeof(opj_dwt97_decode_h_job_t));
-                if (!job) {
-                    opj_thread_pool_wait_completion(tp, 0);
-                    opj_aligned_free(h.wavelet);
-                    return OPJ_FALSE;
-                }
-                job->h.wavelet = (opj_v8_t*)opj_aligned_malloc(l_data_size * sizeof(opj_v8_t));
-                if (!job->h.wavelet) {
-                    opj_thread_pool_wait_completion(tp, 0);
-                    opj_free(job);
-                    opj_aligned_free(h.wavelet);
-                    return OPJ_FALSE;
-                }
-                job->h.dn = h.dn;
-                job->h.sn = h.sn;
-                job->h.cas = h.cas;
-                job->h.win_l_x0 = h.win_l_x0;
-                job->h.win_l_x1 = h.win_l_x1;
-                job->h.win_h_x0 = h.win_h_x0;
-                job->h.win_h_x1 = h.win_h_x1;
-                job->rw = rw;
-                job->w = w;
-                job->aj = aj;
-                job->nb_rows = (j + 1 == num_jobs) ? (rh & (OPJ_UINT32)~
-                                                      (NB_ELTS_V8 - 1)) - j * step_j : step_j;
-                aj += w * job->nb_rows;
-                opj_thread_pool_submit_job(tp, opj_dwt97_decode_h_func, job);
+    if (j < rh) {
+        OPJ_UINT32 k;
+        opj_v8dwt_interleave_h(&h, aj, w, rh - j);
+        opj_v8dwt_decode(&h);
+        for (k = 0; k < rw; k++) {
+            OPJ_UINT32 l;
+            for (l = 0; l < rh - j; l++) {
+                aj[k + (OPJ_SIZE_T)w  * l ] = h.wavelet[k].f[l];
             }
-            opj_thread_pool_wait_completion(tp, 0);
-            j = rh & (OPJ_UINT32)~(NB_ELTS_V8 - 1);
         }
+    }
+
+    v.dn = (OPJ_INT32)(rh - (OPJ_UINT32)v.sn);
+    v.cas = res->y0 % 2;
+    v.win_l_x0 = 0;
+    v.win_l_x1 = (OPJ_UINT32)v.sn;
+    v.win_h_x0 = 0;
+    v.win_h_x1 = (OPJ_UINT32)v.dn;
 
-        if (j < rh) {
+    aj = (OPJ_FLOAT32*) tilec->data;
+    if (num_threads <= 1 || rw < 2 * NB_ELTS_V8) {
+        for (j = rw; j > (NB_ELTS_V8 - 1); j -= NB_ELTS_V8) {
             OPJ_UINT32 k;
-            opj_v8dwt_interleave_h(&h, aj, w, rh - j);
-            opj_v8dwt_decode(&h);
-            for (k = 0; k < rw; k++) {
-                OPJ_UINT32 l;
-                for (l = 0; l < rh - j; l++) {
-                    aj[k + (OPJ_SIZE_T)w  * l ] = h.wavelet[k].f[l];
-                }
+
+            opj_v8dwt_interleave_v(&v, aj, w, NB_ELTS_V8);
+            opj_v8dwt_decode(&v);
+
+            for (k = 0; k < rh; ++k) {
+                memcpy(&aj[k * (OPJ_SIZE_T)w], &v.wavelet[k], NB_ELTS_V8 * sizeof(OPJ_FLOAT32));
             }
+            aj += NB_ELTS_V8;
+        }
+    } else {
+        /* "bench_dwt -I" shows that scaling is poor, likely due to RAM
+            transfer being the limiting factor. So limit the number of
+            threads.
+         */
+        OPJ_UINT32 num_jobs = opj_uint_max((OPJ_UINT32)num_threads / 2, 2U);
+        OPJ_UINT32 step_j;
+
+        if ((rw / NB_ELTS_V8) < num_jobs) {
+            num_jobs = rw / NB_ELTS_V8;
         }
+        step_j = ((rw / num_jobs) / NB_ELTS_V8) * NB_ELTS_V8;
+        for (j = 0; j < num_jobs; j++) {
+            opj_dwt97_decode_v_job_t* job;
 
-        v.dn = (OPJ_INT32)(rh - (OPJ_UINT32)v.sn);
-        v.cas = res->y0 % 2;
-        v.win_l_x0 = 0;
-        v.win_l_x1 = (OPJ_UINT32)v.sn;
-        v.win_h_x0 = 0;
-        v.win_h_x1 = (OPJ_UINT32)v.dn;
-
-        aj = (OPJ_FLOAT32*) tilec->data;
-        if (num_threads <= 1 || rw < 2 * NB_ELTS_V8) {
-            for (j = rw; j > (NB_ELTS_V8 - 1); j -= NB_ELTS_V8) {
-                OPJ_UINT32 k;
-
-                opj_v8dwt_interleave_v(&v, aj, w, NB_ELTS_V8);
-                opj_v8dwt_decode(&v);
-
-                for (k = 0; k < rh; ++k) {
-                    memcpy(&aj[k * (OPJ_SIZE_T)w], &v.wavelet[k], NB_ELTS_V8 * sizeof(OPJ_FLOAT32));
-                }
-                aj += NB_ELTS_V8;
+            job = (opj_dwt97_decode_v_job_t*) opj_malloc(sizeof(opj_dwt97_decode_v_job_t));
+            if (!job) {
+                opj_thread_pool_wait_completion(tp, 0);
+                return OPJ_FALSE;
             }
-        } else {
-            /* "bench_dwt -I" shows that scaling is poor, likely due to RAM
-                transfer being the limiting factor. So limit the number of
-                threads.
-             */
-            OPJ_UINT32 num_jobs = opj_uint_max((OPJ_UINT32)num_threads / 2, 2U);
-            OPJ_UINT32 step_j;
-
-            if ((rw / NB_ELTS_V8) < num_jobs) {
-                num_jobs = rw / NB_ELTS_V8;
+            job->v.wavelet = (opj_v8_t*)opj_aligned_malloc(l_data_size * sizeof(opj_v8_t));
+            if (!job->v.wavelet) {
+                opj_thread_pool_wait_completion(tp, 0);
+                opj_free(job);
+                return OPJ_FALSE;
             }
-            step_j = ((rw / num_jobs) / NB_ELTS_V8) * NB_ELTS_V8;
-            for (j = 0; j < num_jobs; j++) {
-                opj_dwt97_decode_v_job_t* job;
+            job->v.dn = v.dn;
+            job->v.sn = v.sn;
+            job->v.cas = v.cas;
+            job->v.win_l_x0 = v.win_l_x0;
+            job->v.win_l_x1 = v.win_l_x1;
+            job->v.win_h_x0 = v.win_h_x0;
+            job->v.win_h_x1 = v.win_h_x1;
+            job->rh = rh;
+            job->w = w;
+            job->aj = aj;
+            job->nb_columns = (j + 1 == num_jobs) ? (rw & (OPJ_UINT32)~
+                              (NB_ELTS_V8 - 1)) - j * step_j : step_j;
+            aj += job->nb_columns;
+            opj_thread_pool_submit_job(tp, opj_dwt97_decode_v_func, job);
+        }
+        opj_thread_pool_wait_completion(tp, 0);
+    }
 
-                job = (opj_dwt97_decode_v_job_t*) opj_malloc(sizeof(opj_dwt97_decode_v_job_t));
-                if (!job) {
-                    opj_thread_pool_wait_completion(tp, 0);
-                    opj_aligned_free(h.wavelet);
-                    return OPJ_FALSE;
-                }
-                job->v.wavelet = (opj_v8_t*)opj_aligned_malloc(l_data_size * sizeof(opj_v8_t));
-                if (!job->v.wavelet) {
-                    opj_thread_pool_wait_completion(tp, 0);
-                    opj_free(job);
-                    opj_aligned_free(h.wavelet);
-                    return OPJ_FALSE;
-                }
-                job->v.dn = v.dn;
-                job->v.sn = v.sn;
-                job->v.cas = v.cas;
-                job->v.win_l_x0 = v.win_l_x0;
-                job->v.win_l_x1 = v.win_l_x1;
-                job->v.win_h_x0 = v.win_h_x0;
-                job->v.win_h_x1 = v.win_h_x1;
-                job->rh = rh;
-                job->w = w;
-                job->aj = aj;
-                job->nb_columns = (j + 1 == num_jobs) ? (rw & (OPJ_UINT32)~
-                                  (NB_ELTS_V8 - 1)) - j * step_j : step_j;
-                aj += job->nb_columns;
-                opj_thread_pool_submit_job(tp, opj_dwt97_decode_v_func, job);
-            }
-            opj_thread_pool_wait_completion(tp, 0);
+    if (rw & (NB_ELTS_V8 - 1)) {
+        OPJ_UINT32 k;
+
+        j = rw & (NB_ELTS_V8 - 1);
+
+        opj_v8dwt_interleave_v(&v, aj, w, j);
+        opj_v8dwt_decode(&v);
+
+        for (k = 0; k < rh; ++k) {
+            memcpy(&aj[k * (OPJ_SIZE_T)w], &v.wavelet[k],
+                   (OPJ_SIZE_T)j * sizeof(OPJ_FLOAT32));
         }
+    }
 
-        if (rw & (NB_ELTS_V8 - 1)) {
-            OPJ_UINT32 k;
+    return OPJ_TRUE;
+}
+
+/* <summary>                             */
+/* Inverse 9-7 wavelet transform in 2-D. */
+/* </summary>                            */
+static
+OPJ_BOOL opj_dwt_decode_tile_97(opj_thread_pool_t* tp,
+                                opj_tcd_tilecomp_t* OPJ_RESTRICT tilec,
+                                OPJ_UINT32 numres)
+{
+    opj_v8_t* wavelet;
+    OPJ_SIZE_T l_data_size;
+    OPJ_UINT32 resno;
 
-            j = rw & (NB_ELTS_V8 - 1);
+    if (numres == 1) {
+        return OPJ_TRUE;
+    }
 
-            opj_v8dwt_interleave_v(&v, aj, w, j);
-            opj_v8dwt_decode(&v);
+    l_data_size = opj_dwt_max_resolution(tilec->resolutions, numres);
+    /* overflow check */
+    if (l_data_size > (SIZE_MAX / sizeof(opj_v8_t))) {
+        /* FIXME event manager error callback */
+        return OPJ_FALSE;
+    }
+    wavelet = (opj_v8_t*) opj_aligned_malloc(l_data_size * sizeof(opj_v8_t));
+    if (!wavelet) {
+        /* FIXME event manager error callback */
+        return OPJ_FALSE;
+    }
 
-            for (k = 0; k < rh; ++k) {
-                memcpy(&aj[k * (OPJ_SIZE_T)w], &v.wavelet[k],
-                       (OPJ_SIZE_T)j * sizeof(OPJ_FLOAT32));
-            }
+    for (resno = 1; resno < numres; ++resno) {
+        if (!opj_dwt_decode_tile_97_level(tp, tilec, resno, wavelet, l_data_size)) {
+            opj_aligned_free(wavelet);
+            return OPJ_FALSE;
         }
     }
 
-    opj_aligned_free(h.wavelet);
+    opj_aligned_free(wavelet);
     return OPJ_TRUE;
 }
 
+OPJ_BOOL opj_dwt_decode_tile_resolution_real(opj_thread_pool_t* tp,
+        opj_tcd_tilecomp_t* OPJ_RESTRICT tilec,
+        OPJ_UINT32 resno)
+{
+    opj_v8_t* wavelet;
+    opj_tcd_resolution_t* res = tilec->resolutions + resno;
+    OPJ_SIZE_T l_data_size;
+    OPJ_BOOL ret;
+
+    if (resno == 0) {
+        return OPJ_TRUE;
+    }
+    l_data_size = opj_uint_max((OPJ_UINT32)(res->x1 - res->x0),
+                               (OPJ_UINT32)(res->y1 - res->y0));
+    /* overflow check */
+    if (l_data_size > (SIZE_MAX / sizeof(opj_v8_t))) {
+        return OPJ_FALSE;
+    }
+    wavelet = (opj_v8_t*) opj_aligned_malloc(l_data_size * sizeof(opj_v8_t));
+    if (!wavelet) {
+        return OPJ_FALSE;
+    }
+    ret = opj_dwt_decode_tile_97_level(tp, tilec, resno, wavelet, l_data_size);
+    opj_aligned_free(wavelet);
+    return ret;
+}
+
 static
 OPJ_BOOL opj_dwt_decode_partial_97(opj_tcd_tilecomp_t* OPJ_RESTRICT tilec,
-                                   OPJ_UINT32 numres)
+                                   OPJ_UINT32 numres,
+                                   OPJ_BOOL keep_state)
 {
     opj_sparse_array_int32_t* sa;
     opj_v8dwt_t h;
     opj_v8dwt_t v;
     OPJ_UINT32 resno;
+    OPJ_UINT32 resno_start;
     /* This value matches the maximum left/right extension given in tables */
-    /* F.2 and F.3 of the standard. Note: in opj_tcd_is_subband_area_of_interest() */
-    /* we currently use 3. */
+    /* F.2 and F.3 of the standard, as in opj_tcd_is_subband_area_of_interest() */
     const OPJ_UINT32 filter_width = 4U;
 
     opj_tcd_resolution_t* tr = tilec->resolutions;
@@ -3866,12 +3572,12 @@ OPJ_BOOL opj_dwt_decode_partial_97(opj_tcd_tilecomp_t* OPJ_RESTRICT tilec,
         return OPJ_TRUE;
     }
 
-    sa = opj_dwt_init_sparse_array(tilec, numres);
+    sa = opj_dwt_init_sparse_array(tilec, numres, keep_state, &resno_start);
     if (sa == NULL) {
         return OPJ_FALSE;
     }
 
-    if (numres == 1U) {
+    if (resno_start >= numres) {
         OPJ_BOOL ret = opj_sparse_array_int32_read(sa,
                        tr_max->win_x0 - (OPJ_UINT32)tr_max->x0,
                        tr_max->win_y0 - (OPJ_UINT32)tr_max->y0,
@@ -3882,7 +3588,7 @@ OPJ_BOOL opj_dwt_decode_partial_97(opj_tcd_tilecomp_t* OPJ_RESTRICT tilec,
                        OPJ_TRUE);
         assert(ret);
         OPJ_UNUSED(ret);
-        opj_sparse_array_int32_free(sa);
+        opj_dwt_release_sparse_array(tilec, sa, numres, keep_state);
         return OPJ_TRUE;
     }
 
@@ -3901,7 +3607,12 @@ OPJ_BOOL opj_dwt_decode_partial_97(opj_tcd_tilecomp_t* OPJ_RESTRICT tilec,
     }
     v.wavelet = h.wavelet;
 
-    for (resno = 1; resno < numres; resno ++) {
+    /* Resolution the transform starts from */
+    tr = &(tilec->resolutions[resno_start - 1]);
+    rw = (OPJ_UINT32)(tr->x1 - tr->x0);
+    rh = (OPJ_UINT32)(tr->y1 - tr->y0);
+
+    for (resno = resno_start; resno < numres; resno ++) {
         OPJ_UINT32 j;
         /* Window of interest subband-based coordinates */
         OPJ_UINT32 win_ll_x0, win_ll_y0, win_ll_x1, win_ll_y1;
@@ -4060,7 +3771,7 @@ OPJ_BOOL opj_dwt_decode_partial_97(opj_tcd_tilecomp_t* OPJ_RESTRICT tilec,
         assert(ret);
         OPJ_UNUSED(ret);
     }
-    opj_sparse_array_int32_free(sa);
+    opj_dwt_release_sparse_array(tilec, sa, numres, keep_state);
 
     opj_aligned_free(h.wavelet);
     return OPJ_TRUE;
@@ -4074,6 +3785,400 @@ OPJ_BOOL opj_dwt_decode_real(opj_tcd_t *p_tcd,
     if (p_tcd->whole_tile_decoding) {
         return opj_dwt_decode_tile_97(p_tcd->thread_pool, tilec, numres);
     } else {
-        return opj_dwt_decode_partial_97(tilec, numres);
+        return opj_dwt_decode_partial_97(tilec, numres, p_tcd->refinable);
+    }
+}
+
+
+/* <summary>                                                              */
+/* Inverse DWT in 2-D, row by row, for the decoding by strips.           */
+/* </summary>                                                             */
+
+/** Maximum number of vertical lifting steps: 2 for the 5-3 filter and 4 */
+/** for the 9-7 filter, whose scaling is done when a row is read */
+#define OPJ_DWT_LINES_MAX_STEPS 4
+
+/** Number of rows kept by a resolution level: the row being computed, */
+/** its two neighbours and the rows waiting for the next steps */
+#define OPJ_DWT_LINES_NB_ROWS (OPJ_DWT_LINES_MAX_STEPS + 2)
+
+typedef struct opj_dwt_lines_level {
+    /** Width and height of the resolution */
+    OPJ_UINT32 rw;
+    OPJ_UINT32 rh;
+    /** Number of low-pass columns, i.e. width of the lower resolution */
+    OPJ_UINT32 sn_x;
+    /** Parity of the first column and of the first row */
+    OPJ_UINT32 cas_x;
+    OPJ_UINT32 cas_y;
+    /** Number of vertical lifting steps, 0 if the resolution has one row */
+    OPJ_UINT32 nb_steps;
+    /** Rows that are computed, relative to the resolution */
+    OPJ_UINT32 y0;
+    OPJ_UINT32 y1;
+    /** Next row returned by opj_dwt_lines_level_next() */
+    OPJ_UINT32 next;
+    /** Rows [y0, done[k][ went through the vertical lifting step k. */
+    /** done[0] is the end of the rows read and transformed horizontally */
+    OPJ_UINT32 done[OPJ_DWT_LINES_MAX_STEPS + 1];
+    /** Ring of rows, row y being in rows[y % OPJ_DWT_LINES_NB_ROWS] */
+    OPJ_INT32* rows[OPJ_DWT_LINES_NB_ROWS];
+} opj_dwt_lines_level_t;
+
+struct opj_dwt_lines {
+    OPJ_UINT32 numres;
+    /** End of the rows of the highest resolution that are returned */
+    OPJ_UINT32 y1;
+    OPJ_BOOL reversible;
+    opj_dwt_band_row_fn band_row_fn;
+    void* user_data;
+    /** levels[r] for the resolution r. Only rows[0] of levels[0] is */
+    /** used, to read the LL band */
+    opj_dwt_lines_level_t* levels;
+    /** Buffer of the horizontal transform */
+    OPJ_INT32* tmp;
+};
+
+/** Returns whether row y of a resolution is a low-pass row */
+static INLINE OPJ_BOOL opj_dwt_lines_is_low(const opj_dwt_lines_level_t* lv,
+        OPJ_UINT32 y)
+{
+    return ((y + lv->cas_y) & 1) == 0;
+}
+
+/** Inverse 9-7 wavelet transform of a row laid out as [L(sn) | H(dn)], */
+/** with the same operations as opj_v8dwt_decode(), in the same order */
+static void opj_dwt_lines_decode_h_97(OPJ_FLOAT32* OPJ_RESTRICT row,
+                                      OPJ_FLOAT32* OPJ_RESTRICT tmp,
+                                      OPJ_UINT32 sn, OPJ_UINT32 dn,
+                                      OPJ_UINT32 cas)
+{
+    /* See BUG_WEIRD_TWO_INVK in opj_v8dwt_decode() */
+    const float two_invK = 1.625732422f;
+    OPJ_FLOAT32* OPJ_RESTRICT l = tmp;
+    OPJ_FLOAT32* OPJ_RESTRICT h = tmp + sn;
+    OPJ_UINT32 i;
+
+    if (sn + dn < 2) {
+        return;
+    }
+    memcpy(tmp, row, (sn + dn) * sizeof(OPJ_FLOAT32));
+    for (i = 0; i < sn; i++) {
+        l[i] = l[i] * opj_K;
+    }
+    for (i = 0; i < dn; i++) {
+        h[i] = h[i] * two_invK;
+    }
+    if (cas == 0) {
+        /* L[i] is between H[i-1] and H[i], H[i] between L[i] and L[i+1] */
+        const OPJ_FLOAT32 c_l[2] = { -opj_dwt_delta, -opj_dwt_beta };
+        const OPJ_FLOAT32 c_h[2] = { -opj_dwt_gamma, -opj_dwt_alpha };
+        OPJ_UINT32 k;
+        for (k = 0; k < 2; k++) {
+            for (i = 0; i < sn; i++) {
+                const OPJ_FLOAT32 left = h[i == 0 ? 0 : i - 1];
+                const OPJ_FLOAT32 right = h[i < dn ? i : i - 1];
+                l[i] = l[i] + (left + right) * c_l[k];
+            }
+            for (i = 0; i < dn; i++) {
+                const OPJ_FLOAT32 right = l[i + 1 < sn ? i + 1 : i];
+                h[i] = h[i] + (l[i] + right) * c_h[k];
+            }
+        }
+    } else {
+        /* H[i] is between L[i-1] and L[i], L[i] between H[i] and H[i+1] */
+        const OPJ_FLOAT32 c_l[2] = { -opj_dwt_delta, -opj_dwt_beta };
+        const OPJ_FLOAT32 c_h[2] = { -opj_dwt_gamma, -opj_dwt_alpha };
+        OPJ_UINT32 k;
+        for (k = 0; k < 2; k++) {
+            for (i = 0; i < sn; i++) {
+                const OPJ_FLOAT32 right = h[i + 1 < dn ? i + 1 : i];
+                l[i] = l[i] + (h[i] + right) * c_l[k];
+            }
+            for (i = 0; i < dn; i++) {
+                const OPJ_FLOAT32 left = l[i == 0 ? 0 : i - 1];
+                const OPJ_FLOAT32 right = l[i < sn ? i : i - 1];
+                h[i] = h[i] + (left + right) * c_h[k];
+            }
+        }
+    }
+    for (i = 0; i < sn; i++) {
+        row[2 * i + cas] = l[i];
+    }
+    for (i = 0; i < dn; i++) {
+        row[2 * i + 1 - cas] = h[i];
+    }
+}
+
+/** Reads row y of a resolution from the bands, and transforms it */
+/** horizontally */
+static OPJ_BOOL opj_dwt_lines_read_row(opj_dwt_lines_t* l,
+                                       OPJ_UINT32 resno, OPJ_UINT32 y,
+                                       OPJ_INT32* row);
+
+/** Returns the next row of a resolution, or NULL in case of failure */
+static const OPJ_INT32* opj_dwt_lines_level_next(opj_dwt_lines_t* l,
+        OPJ_UINT32 resno)
+{
+    opj_dwt_lines_level_t* lv = &l->levels[resno];
+    const OPJ_UINT32 nb_steps = lv->nb_steps;
+    const OPJ_UINT32 y = lv->next;
+
+    if (resno == 0) {
+        if (!l->band_row_fn(l->user_data, 0, 0, y, lv->rows[0], lv->rw)) {
+            return NULL;
+        }
+        lv->next++;
+        return lv->rows[0];
+    }
+
+    /* Rows go through the steps as soon as their neighbours are ready, */
+    /* so that only OPJ_DWT_LINES_NB_ROWS of them are alive at once */
+    while (lv->done[nb_steps] <= y) {
+        OPJ_BOOL progress = OPJ_FALSE;
+        OPJ_UINT32 k;
+        for (k = nb_steps; k >= 1; k--) {
+            /* Step k applies to the low-pass rows when k is odd */
+            const OPJ_BOOL low = (k & 1) != 0;
+            const OPJ_UINT32 f = lv->done[k];
+            OPJ_UINT32 prev, next;
+            OPJ_INT32* cur;
+            const OPJ_INT32* a;
+            const OPJ_INT32* b;
+            OPJ_UINT32 i;
+
+            if (f >= lv->done[k - 1]) {
+                continue;
+            }
+            if (opj_dwt_lines_is_low(lv, f) != low) {
+                /* Not modified by this step */
+                lv->done[k]++;
+                progress = OPJ_TRUE;
+                break;
+            }
+            /* Neighbours, with a symmetric extension at the edges of */
+            /* the computed rows */
+            prev = (f == lv->y0) ? f + 1 : f - 1;
+            next = (f + 1 >= lv->y1) ? f - 1 : f + 1;
+            if (prev >= lv->done[k - 1] || next >= lv->done[k - 1]) {
+                continue;
+            }
+            cur = lv->rows[f % OPJ_DWT_LINES_NB_ROWS];
+            a = lv->rows[prev % OPJ_DWT_LINES_NB_ROWS];
+            b = lv->rows[next % OPJ_DWT_LINES_NB_ROWS];
+            if (l->reversible) {
+                if (low) {
+                    for (i = 0; i < lv->rw; i++) {
+                        cur[i] -= (a[i] + b[i] + 2) >> 2;
+                    }
+                } else {
+                    for (i = 0; i < lv->rw; i++) {
+                        cur[i] += (a[i] + b[i]) >> 1;
+                    }
+                }
+            } else {
+                static const OPJ_FLOAT32 coefs[OPJ_DWT_LINES_MAX_STEPS] = {
+                    -opj_dwt_delta, -opj_dwt_gamma,
+                    -opj_dwt_beta, -opj_dwt_alpha
+                };
+                const OPJ_FLOAT32 c = coefs[k - 1];
+                OPJ_FLOAT32* fcur = (OPJ_FLOAT32*)cur;
+                const OPJ_FLOAT32* fa = (const OPJ_FLOAT32*)a;
+                const OPJ_FLOAT32* fb = (const OPJ_FLOAT32*)b;
+                for (i = 0; i < lv->rw; i++) {
+                    fcur[i] = fcur[i] + (fa[i] + fb[i]) * c;
+                }
+            }
+            lv->done[k]++;
+            progress = OPJ_TRUE;
+            break;
+        }
+        if (!progress) {
+            const OPJ_UINT32 r = lv->done[0];
+            assert(r < lv->y1);
+            if (!opj_dwt_lines_read_row(l, resno, r,
+                                        lv->rows[r % OPJ_DWT_LINES_NB_ROWS])) {
+                return NULL;
+            }
+            lv->done[0]++;
+        }
+    }
+    lv->next++;
+    return lv->rows[y % OPJ_DWT_LINES_NB_ROWS];
+}
+
+static OPJ_BOOL opj_dwt_lines_read_row(opj_dwt_lines_t* l,
+                                       OPJ_UINT32 resno, OPJ_UINT32 y,
+                                       OPJ_INT32* row)
+{
+    /* See BUG_WEIRD_TWO_INVK in opj_v8dwt_decode() */
+    const float two_invK = 1.625732422f;
+    opj_dwt_lines_level_t* lv = &l->levels[resno];
+    const OPJ_UINT32 sn_x = lv->sn_x;
+    const OPJ_UINT32 dn_x = lv->rw - sn_x;
+    const OPJ_BOOL low = opj_dwt_lines_is_low(lv, y);
+    OPJ_UINT32 i;
+
+    /* Bands of the resolution: HL, LH and HH */
+    if (low) {
+        const OPJ_INT32* lower = opj_dwt_lines_level_next(l, resno - 1);
+        if (lower == NULL) {
+            return OPJ_FALSE;
+        }
+        memcpy(row, lower, sn_x * sizeof(OPJ_INT32));
+        if (!l->band_row_fn(l->user_data, resno, 0, (y - lv->cas_y) / 2,
+                            row + sn_x, dn_x)) {
+            return OPJ_FALSE;
+        }
+    } else {
+        const OPJ_UINT32 band_y = (y + lv->cas_y - 1) / 2;
+        if (!l->band_row_fn(l->user_data, resno, 1, band_y, row, sn_x) ||
+                !l->band_row_fn(l->user_data, resno, 2, band_y, row + sn_x,
+                                dn_x)) {
+            return OPJ_FALSE;
+        }
+    }
+
+    if (l->reversible) {
+        opj_dwt_t h;
+        h.mem = l->tmp;
+        h.sn = (OPJ_INT32)sn_x;
+        h.dn = (OPJ_INT32)dn_x;
+        h.cas = (OPJ_INT32)lv->cas_x;
+        opj_idwt53_h(&h, row);
+        if (lv->nb_steps == 0 && lv->cas_y == 1) {
+            /* Single row on an odd coordinate, see opj_idwt53_v() */
+            for (i = 0; i < lv->rw; i++) {
+                row[i] /= 2;
+            }
+        }
+    } else {
+        OPJ_FLOAT32* frow = (OPJ_FLOAT32*)row;
+        opj_dwt_lines_decode_h_97(frow, (OPJ_FLOAT32*)l->tmp, sn_x, dn_x,
+                                  lv->cas_x);
+        if (lv->nb_steps > 0) {
+            const OPJ_FLOAT32 c = low ? opj_K : two_invK;
+            for (i = 0; i < lv->rw; i++) {
+                frow[i] = frow[i] * c;
+            }
+        }
+    }
+    return OPJ_TRUE;
+}
+
+opj_dwt_lines_t* opj_dwt_lines_create(opj_tcd_tilecomp_t* tilec,
+                                      OPJ_UINT32 numres,
+                                      OPJ_BOOL reversible,
+                                      OPJ_UINT32 y0, OPJ_UINT32 y1,
+                                      opj_dwt_band_row_fn band_row_fn,
+                                      void* user_data)
+{
+    opj_dwt_lines_t* l;
+    OPJ_UINT32 resno;
+    OPJ_UINT32 max_rw = 1;
+
+    assert(numres >= 1 && numres <= tilec->numresolutions);
+    l = (opj_dwt_lines_t*)opj_calloc(1, sizeof(opj_dwt_lines_t));
+    if (l == NULL) {
+        return NULL;
+    }
+    l->levels = (opj_dwt_lines_level_t*)opj_calloc(numres,
+                sizeof(opj_dwt_lines_level_t));
+    if (l->levels == NULL) {
+        opj_free(l);
+        return NULL;
+    }
+    l->numres = numres;
+    l->y1 = y1;
+    l->reversible = reversible;
+    l->band_row_fn = band_row_fn;
+    l->user_data = user_data;
+
+    /* From the highest resolution down, the rows needed by the rows of */
+    /* the resolution above */
+    for (resno = numres; resno-- > 0;) {
+        const opj_tcd_resolution_t* res = &tilec->resolutions[resno];
+        opj_dwt_lines_level_t* lv = &l->levels[resno];
+        OPJ_UINT32 nb_rows = OPJ_DWT_LINES_NB_ROWS;
+        OPJ_UINT32 i;
+
+        lv->rw = (OPJ_UINT32)(res->x1 - res->x0);
+        lv->rh = (OPJ_UINT32)(res->y1 - res->y0);
+        assert(y0 <= y1 && y1 <= lv->rh);
+        lv->next = y0;
+        if (resno == 0) {
+            lv->y0 = y0;
+            lv->y1 = y1;
+            nb_rows = 1;
+        } else {
+            const opj_tcd_resolution_t* lower = &tilec->resolutions[resno - 1];
+            OPJ_UINT32 k;
+
+            lv->sn_x = (OPJ_UINT32)(lower->x1 - lower->x0);
+            lv->cas_x = (OPJ_UINT32)(res->x0 & 1);
+            lv->cas_y = (OPJ_UINT32)(res->y0 & 1);
+            lv->nb_steps = (lv->rh < 2) ? 0 :
+                           (reversible ? 2 : OPJ_DWT_LINES_MAX_STEPS);
+            /* Each step reaches one row further */
+            lv->y0 = (y0 > lv->nb_steps) ? y0 - lv->nb_steps : 0;
+            lv->y1 = opj_uint_min(lv->rh, y1 + lv->nb_steps);
+            for (k = 0; k <= OPJ_DWT_LINES_MAX_STEPS; k++) {
+                lv->done[k] = lv->y0;
+            }
+
+            /* Low-pass rows of [y0, y1[ are the rows of the lower */
+            /* resolution. (y + 1 - cas_y) / 2 low-pass rows are above y */
+            y0 = (lv->y0 + 1 - lv->cas_y) / 2;
+            y1 = (lv->y1 + 1 - lv->cas_y) / 2;
+        }
+        max_rw = opj_uint_max(max_rw, lv->rw);
+        for (i = 0; i < nb_rows; i++) {
+            lv->rows[i] = (OPJ_INT32*)opj_aligned_malloc(
+                              opj_uint_max(lv->rw, 1) * sizeof(OPJ_INT32));
+            if (lv->rows[i] == NULL) {
+                opj_dwt_lines_destroy(l);
+                return NULL;
+            }
+        }
+    }
+    l->tmp = (OPJ_INT32*)opj_aligned_malloc(max_rw * sizeof(OPJ_INT32));
+    if (l->tmp == NULL) {
+        opj_dwt_lines_destroy(l);
+        return NULL;
+    }
+    return l;
+}
+
+OPJ_BOOL opj_dwt_lines_next(opj_dwt_lines_t* l, const OPJ_INT32** p_row)
+{
+    const OPJ_INT32* row;
+
+    if (l->levels[l->numres - 1].next >= l->y1) {
+        return OPJ_FALSE;
+    }
+    row = opj_dwt_lines_level_next(l, l->numres - 1);
+    if (row == NULL) {
+        return OPJ_FALSE;
+    }
+    *p_row = row;
+    return OPJ_TRUE;
+}
+
+void opj_dwt_lines_destroy(opj_dwt_lines_t* l)
+{
+    OPJ_UINT32 resno, i;
+
+    if (l == NULL) {
+        return;
+    }
+    if (l->levels != NULL) {
+        for (resno = 0; resno < l->numres; resno++) {
+            for (i = 0; i < OPJ_DWT_LINES_NB_ROWS; i++) {
+                opj_aligned_free(l->levels[resno].rows[i]);
+            }
+        }
+        opj_free(l->levels);
     }
+    opj_aligned_free(l->tmp);
+    opj_free(l);
 }
@@ -73,6 +73,21 @@ OPJ_BOOL opj_dwt_decode(opj_tcd_t *p_tcd,
                         opj_tcd_tilecomp_t* tilec,
                         OPJ_UINT32 numres);
 
+/**
+Inverse 5-3 wavelet transform in 2-D of a single resolution level, when
+decoding a whole tile.
+Resolution resno is reconstructed in place from resolution resno - 1, which
+must be already reconstructed, and from the bands of resolution resno. Only
+the samples of resolution resno of tilec->data are accessed, so that the
+code-blocks of higher resolutions can be decoded concurrently.
+@param tp Thread pool used to parallelize the transform
+@param tilec Tile component information (current tile)
+@param resno Resolution level to reconstruct
+*/
+OPJ_BOOL opj_dwt_decode_tile_resolution(opj_thread_pool_t* tp,
+                                        opj_tcd_tilecomp_t* tilec,
+                                        OPJ_UINT32 resno);
+
 /**
 Get the norm of a wavelet function of a subband at a specified level for the reversible 5-3 DWT.
 @param level Level of the wavelet function
@@ -99,6 +114,78 @@ OPJ_BOOL opj_dwt_decode_real(opj_tcd_t *p_tcd,
                              opj_tcd_tilecomp_t* OPJ_RESTRICT tilec,
                              OPJ_UINT32 numres);
 
+/**
+Inverse 9-7 wavelet transform in 2-D of a single resolution level, when
+decoding a whole tile.
+See opj_dwt_decode_tile_resolution().
+@param tp Thread pool used to parallelize the transform
+@param tilec Tile component information (current tile)
+@param resno Resolution level to reconstruct
+*/
+OPJ_BOOL opj_dwt_decode_tile_resolution_real(opj_thread_pool_t* tp,
+        opj_tcd_tilecomp_t* OPJ_RESTRICT tilec,
+        OPJ_UINT32 resno);
+
+/**
+Callback of opj_dwt_lines_create(), which must write to row the width
+samples of row y of a band, already dequantized.
+@param user_data User data given to opj_dwt_lines_create()
+@param resno Resolution level of the band
+@param bandno Index of the band in the resolution
+@param y Row in the band, relative to its top
+@param row Output row
+@param width Width of the band
+@return OPJ_FALSE in case of failure
+*/
+typedef OPJ_BOOL(*opj_dwt_band_row_fn)(void* user_data,
+                                       OPJ_UINT32 resno,
+                                       OPJ_UINT32 bandno,
+                                       OPJ_UINT32 y,
+                                       OPJ_INT32* row,
+                                       OPJ_UINT32 width);
+
+/** Inverse wavelet transform computed row by row */
+typedef struct opj_dwt_lines opj_dwt_lines_t;
+
+/**
+Creates an inverse wavelet transform computed row by row, which returns rows
+[y0, y1[ of resolution numres - 1 one after the other. Each resolution level
+only keeps the few rows needed by the vertical lifting steps, and the band
+rows are read in increasing order, when they are needed, so that the
+code-blocks can be decoded and released as the transform goes down the tile.
+The rows are the same as the ones of opj_dwt_decode() and
+opj_dwt_decode_real().
+@param tilec Tile component information (current tile)
+@param numres Number of resolution levels to decode
+@param reversible Whether the 5-3 or the 9-7 filter is used
+@param y0 First row, relative to the top of the resolution
+@param y1 End row, relative to the top of the resolution
+@param band_row_fn Callback reading the rows of the bands
+@param user_data User data given to band_row_fn
+@return a new transform, or NULL in case of failure
+*/
+opj_dwt_lines_t* opj_dwt_lines_create(opj_tcd_tilecomp_t* tilec,
+                                      OPJ_UINT32 numres,
+                                      OPJ_BOOL reversible,
+                                      OPJ_UINT32 y0, OPJ_UINT32 y1,
+                                      opj_dwt_band_row_fn band_row_fn,
+                                      void* user_data);
+
+/**
+Computes the next row of an inverse wavelet transform.
+@param l Transform
+@param p_row Output pointer to the row, of the width of the resolution, and
+valid until the next call
+@return OPJ_FALSE in case of failure, or if all the rows were returned
+*/
+OPJ_BOOL opj_dwt_lines_next(opj_dwt_lines_t* l, const OPJ_INT32** p_row);
+
+/**
+Destroys an inverse wavelet transform computed row by row.
+@param l Transform
+*/
+void opj_dwt_lines_destroy(opj_dwt_lines_t* l);
+
 /**
 Get the norm of a wavelet function of a subband at a specified level for the irreversible 9-7 DWT
 @param level Level of the wavelet function
@@ -0,0 +1,149 @@
+/*
+ * The copyright in this software is being made available under the 2-clauses
+ * BSD License, included below. This software may be subject to other third
+ * party and contributor rights, including patent rights, and no such rights
+ * are granted under this license.
+ *
+ * Copyright (c) 2026, OpenJPEG contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS `AS IS'
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef OPJ_DWT_KERNELS_H
+#define OPJ_DWT_KERNELS_H
+/**
+@file dwt_kernels.h
+@brief SIMD kernels of the DWT
+
+The kernels are gathered in one table per instruction set. dwt.c holds the
+generic and baseline (SSE2 or NEON) tables, dwt_avx2.c and dwt_avx512.c the
+ones that are compiled with the AVX2 and AVX-512 compiler flags.
+*/
+
+/** @defgroup DWT DWT - Implementation of a discrete wavelet transform */
+/*@{*/
+
+#define NB_ELTS_V8  8
+
+typedef union {
+    OPJ_FLOAT32 f[NB_ELTS_V8];
+} opj_v8_t;
+
+/* From table F.4 from the standard */
+static const OPJ_FLOAT32 opj_dwt_alpha =  -1.586134342f;
+static const OPJ_FLOAT32 opj_dwt_beta  =  -0.052980118f;
+static const OPJ_FLOAT32 opj_dwt_gamma = 0.882911075f;
+static const OPJ_FLOAT32 opj_dwt_delta = 0.443506852f;
+
+static const OPJ_FLOAT32 opj_K      = 1.230174105f;
+static const OPJ_FLOAT32 opj_invK   = (OPJ_FLOAT32)(1.0 / 1.230174105);
+
+/** Forward DWT of the vertical pass, processing cols columns of height
+ * lines and storing the low-pass band above the high-pass one.
+ * array is a OPJ_INT32* for 5x3 and a OPJ_FLOAT32* for 9x7. */
+typedef void (*opj_encode_and_deinterleave_v_fnptr_type)(
+    void *array,
+    void *tmp,
+    OPJ_UINT32 height,
+    OPJ_BOOL even,
+    OPJ_UINT32 stride_width,
+    OPJ_UINT32 cols);
+
+/** DWT kernels for a given instruction set */
+typedef struct opj_dwt_kernels {
+    /** Number of columns processed by idwt53_v_cas0_mcols/idwt53_v_cas1_mcols */
+    OPJ_INT32 parallel_cols_53;
+
+    /** Horizontal inverse 5x3 transform of one row whose left-most sample is
+     * on an even coordinate (len > 1). tmp must hold len values. */
+    void (*idwt53_h_cas0)(OPJ_INT32* tmp,
+                          const OPJ_INT32 sn,
+                          const OPJ_INT32 len,
+                          OPJ_INT32* tiledp);
+
+    /** Vertical inverse 5x3 transform of parallel_cols_53 columns whose
+     * top-most sample is on an even coordinate (len > 1), or NULL. tmp must
+     * hold len * parallel_cols_53 values, aligned on 32 bytes. */
+    void (*idwt53_v_cas0_mcols)(OPJ_INT32* tmp,
+                                const OPJ_INT32 sn,
+                                const OPJ_INT32 len,
+                                OPJ_INT32* tiledp_col,
+                                const OPJ_SIZE_T stride);
+
+    /** Same as idwt53_v_cas0_mcols, when the top-most sample is on an odd
+     * coordinate (len > 2). */
+    void (*idwt53_v_cas1_mcols)(OPJ_INT32* tmp,
+                                const OPJ_INT32 sn,
+                                const OPJ_INT32 len,
+                                OPJ_INT32* tiledp_col,
+                                const OPJ_SIZE_T stride);
+
+    /** Scaling step of the inverse 9x7 transform on 8 interleaved lines */
+    void (*v8dwt_decode_step1)(opj_v8_t* w,
+                               OPJ_UINT32 start,
+                               OPJ_UINT32 end,
+                               const OPJ_FLOAT32 c);
+
+    /** Lifting step of the inverse 9x7 transform on 8 interleaved lines */
+    void (*v8dwt_decode_step2)(opj_v8_t* l, opj_v8_t* w,
+                               OPJ_UINT32 start,
+                               OPJ_UINT32 end,
+                               OPJ_UINT32 m,
+                               OPJ_FLOAT32 c);
+
+    /** Maximum number of columns processed by encode_and_deinterleave_v_53
+     * and encode_and_deinterleave_v_97 */
+    OPJ_UINT32 encode_cols;
+
+    /** Vertical forward 5x3 transform of cols <= encode_cols columns. tmp
+     * must hold height * encode_cols values, aligned on 32 bytes. */
+    opj_encode_and_deinterleave_v_fnptr_type encode_and_deinterleave_v_53;
+
+    /** Same as encode_and_deinterleave_v_53, for the forward 9x7 transform */
+    opj_encode_and_deinterleave_v_fnptr_type encode_and_deinterleave_v_97;
+} opj_dwt_kernels_t;
+
+#ifdef OPJ_HAVE_AVX2_KERNELS
+/** Kernels of dwt_avx2.c */
+extern const opj_dwt_kernels_t opj_dwt_kernels_avx2;
+
+/** AVX version of opj_dwt_kernels_t::v8dwt_decode_step1 */
+void opj_v8dwt_decode_step1_avx2(opj_v8_t* w,
+                                 OPJ_UINT32 start,
+                                 OPJ_UINT32 end,
+                                 const OPJ_FLOAT32 c);
+
+/** AVX version of opj_dwt_kernels_t::v8dwt_decode_step2 */
+void opj_v8dwt_decode_step2_avx2(opj_v8_t* l, opj_v8_t* w,
+                                 OPJ_UINT32 start,
+                                 OPJ_UINT32 end,
+                                 OPJ_UINT32 m,
+                                 OPJ_FLOAT32 c);
+#endif
+#ifdef OPJ_HAVE_AVX512_KERNELS
+/** Kernels of dwt_avx512.c */
+extern const opj_dwt_kernels_t opj_dwt_kernels_avx512;
+#endif
+
+/*@}*/
+
+#endif /* OPJ_DWT_KERNELS_H */
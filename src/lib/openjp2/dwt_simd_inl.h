@@ -0,0 +1,608 @@
+/*
+ * The copyright in this software is being made available under the 2-clauses
+ * BSD License, included below. This software may be subject to other third
+ * party and contributor rights, including patent rights, and no such rights
+ * are granted under this license.
+ *
+ * Copyright (c) 2002-2014, Universite catholique de Louvain (UCL), Belgium
+ * Copyright (c) 2002-2014, Professor Benoit Macq
+ * Copyright (c) 2001-2003, David Janssens
+ * Copyright (c) 2002-2003, Yannick Verschueren
+ * Copyright (c) 2003-2007, Francois-Olivier Devaux
+ * Copyright (c) 2003-2014, Antonin Descampe
+ * Copyright (c) 2005, Herve Drolon, FreeImage Team
+ * Copyright (c) 2007, Jonathan Ballard <dzonatas@dzonux.net>
+ * Copyright (c) 2007, Callum Lerwick <seg@haxxed.com>
+ * Copyright (c) 2017, IntoPIX SA <support@intopix.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS `AS IS'
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Vertical inverse 5x3 wavelet transform of several columns at once, and,
+ * with AVX2 and AVX-512, vertical forward 5x3 and 9x7 transforms of one
+ * vector of columns at once.
+ *
+ * This file is included by dwt.c for the SSE2 and NEON kernels, and by
+ * dwt_avx2.c and dwt_avx512.c. The vector width is the one of the widest
+ * instruction set enabled by the compiler flags of the including file,
+ * which must include the matching intrinsics headers beforehand.
+ */
+
+#if defined(__AVX512F__)
+/** Number of int32 values in a AVX512 register */
+#define VREG_INT_COUNT       16
+#elif defined(__AVX2__)
+/** Number of int32 values in a AVX2 register */
+#define VREG_INT_COUNT       8
+#else
+/** Number of int32 values in a SSE2 or NEON register */
+#define VREG_INT_COUNT       4
+#endif
+
+/** Number of columns that we can process in parallel in the vertical pass */
+#define PARALLEL_COLS_53     (2*VREG_INT_COUNT)
+
+/* Conveniency macros to improve the readability of the formulas */
+#if defined(__AVX512F__)
+#define VREG        __m512i
+#define LOAD_CST(x) _mm512_set1_epi32(x)
+#define LOAD(x)     _mm512_loadu_si512((const VREG*)(x))
+#define LOADU(x)    _mm512_loadu_si512((const VREG*)(x))
+#define STORE(x,y)  _mm512_storeu_si512((VREG*)(x),(y))
+#define STOREU(x,y) _mm512_storeu_si512((VREG*)(x),(y))
+#define ADD(x,y)    _mm512_add_epi32((x),(y))
+#define SUB(x,y)    _mm512_sub_epi32((x),(y))
+#define SAR(x,y)    _mm512_srai_epi32((x),(y))
+#elif defined(__AVX2__)
+#define VREG        __m256i
+#define LOAD_CST(x) _mm256_set1_epi32(x)
+#define LOAD(x)     _mm256_load_si256((const VREG*)(x))
+#define LOADU(x)    _mm256_loadu_si256((const VREG*)(x))
+#define STORE(x,y)  _mm256_store_si256((VREG*)(x),(y))
+#define STOREU(x,y) _mm256_storeu_si256((VREG*)(x),(y))
+#define ADD(x,y)    _mm256_add_epi32((x),(y))
+#define SUB(x,y)    _mm256_sub_epi32((x),(y))
+#define SAR(x,y)    _mm256_srai_epi32((x),(y))
+#elif defined(__ARM_NEON)
+#define VREG        int32x4_t
+#define LOAD_CST(x) vdupq_n_s32(x)
+#define LOAD(x)     vld1q_s32((const int32_t*)(x))
+#define LOADU(x)    vld1q_s32((const int32_t*)(x))
+#define STORE(x,y)  vst1q_s32((int32_t*)(x),(y))
+#define STOREU(x,y) vst1q_s32((int32_t*)(x),(y))
+#define ADD(x,y)    vaddq_s32((x),(y))
+#define SUB(x,y)    vsubq_s32((x),(y))
+#define SAR(x,y)    vshrq_n_s32((x),(y))
+#else
+#define VREG        __m128i
+#define LOAD_CST(x) _mm_set1_epi32(x)
+#define LOAD(x)     _mm_load_si128((const VREG*)(x))
+#define LOADU(x)    _mm_loadu_si128((const VREG*)(x))
+#define STORE(x,y)  _mm_store_si128((VREG*)(x),(y))
+#define STOREU(x,y) _mm_storeu_si128((VREG*)(x),(y))
+#define ADD(x,y)    _mm_add_epi32((x),(y))
+#define SUB(x,y)    _mm_sub_epi32((x),(y))
+#define SAR(x,y)    _mm_srai_epi32((x),(y))
+#endif
+#define ADD3(x,y,z) ADD(ADD(x,y),z)
+
+static
+void opj_idwt53_v_final_memcpy(OPJ_INT32* tiledp_col,
+                               const OPJ_INT32* tmp,
+                               OPJ_INT32 len,
+                               OPJ_SIZE_T stride)
+{
+    OPJ_INT32 i;
+    for (i = 0; i < len; ++i) {
+        /* A memcpy(&tiledp_col[i * stride + 0],
+                    &tmp[PARALLEL_COLS_53 * i + 0],
+                    PARALLEL_COLS_53 * sizeof(OPJ_INT32))
+           would do but would be a tiny bit slower.
+           We can take here advantage of our knowledge of alignment */
+        STOREU(&tiledp_col[(OPJ_SIZE_T)i * stride + 0],
+               LOAD(&tmp[PARALLEL_COLS_53 * i + 0]));
+        STOREU(&tiledp_col[(OPJ_SIZE_T)i * stride + VREG_INT_COUNT],
+               LOAD(&tmp[PARALLEL_COLS_53 * i + VREG_INT_COUNT]));
+    }
+}
+
+/** Vertical inverse 5x3 wavelet transform for 8 columns in SSE2 and NEON,
+ * or 16 in AVX2, when top-most pixel is on even coordinate */
+static void opj_idwt53_v_cas0_mcols_SIMD(
+    OPJ_INT32* tmp,
+    const OPJ_INT32 sn,
+    const OPJ_INT32 len,
+    OPJ_INT32* tiledp_col,
+    const OPJ_SIZE_T stride)
+{
+    const OPJ_INT32* in_even = &tiledp_col[0];
+    const OPJ_INT32* in_odd = &tiledp_col[(OPJ_SIZE_T)sn * stride];
+
+    OPJ_INT32 i;
+    OPJ_SIZE_T j;
+    VREG d1c_0, d1n_0, s1n_0, s0c_0, s0n_0;
+    VREG d1c_1, d1n_1, s1n_1, s0c_1, s0n_1;
+    const VREG two = LOAD_CST(2);
+
+    assert(len > 1);
+#if defined(__AVX512F__)
+    assert(PARALLEL_COLS_53 == 32);
+    assert(VREG_INT_COUNT == 16);
+#elif defined(__AVX2__)
+    assert(PARALLEL_COLS_53 == 16);
+    assert(VREG_INT_COUNT == 8);
+#else
+    assert(PARALLEL_COLS_53 == 8);
+    assert(VREG_INT_COUNT == 4);
+#endif
+
+//For AVX512 code aligned load/store is set to it's unaligned equivalents
+#if !defined(__AVX512F__)
+    /* Note: loads of input even/odd values must be done in a unaligned */
+    /* fashion. But stores in tmp can be done with aligned store, since */
+    /* the temporary buffer is properly aligned */
+    assert((OPJ_SIZE_T)tmp % (sizeof(OPJ_INT32) * VREG_INT_COUNT) == 0);
+#endif
+
+    s1n_0 = LOADU(in_even + 0);
+    s1n_1 = LOADU(in_even + VREG_INT_COUNT);
+    d1n_0 = LOADU(in_odd);
+    d1n_1 = LOADU(in_odd + VREG_INT_COUNT);
+
+    /* s0n = s1n - ((d1n + 1) >> 1); <==> */
+    /* s0n = s1n - ((d1n + d1n + 2) >> 2); */
+    s0n_0 = SUB(s1n_0, SAR(ADD3(d1n_0, d1n_0, two), 2));
+    s0n_1 = SUB(s1n_1, SAR(ADD3(d1n_1, d1n_1, two), 2));
+
+    for (i = 0, j = 1; i < (len - 3); i += 2, j++) {
+        d1c_0 = d1n_0;
+        s0c_0 = s0n_0;
+        d1c_1 = d1n_1;
+        s0c_1 = s0n_1;
+
+        s1n_0 = LOADU(in_even + j * stride);
+        s1n_1 = LOADU(in_even + j * stride + VREG_INT_COUNT);
+        d1n_0 = LOADU(in_odd + j * stride);
+        d1n_1 = LOADU(in_odd + j * stride + VREG_INT_COUNT);
+
+        /*s0n = s1n - ((d1c + d1n + 2) >> 2);*/
+        s0n_0 = SUB(s1n_0, SAR(ADD3(d1c_0, d1n_0, two), 2));
+        s0n_1 = SUB(s1n_1, SAR(ADD3(d1c_1, d1n_1, two), 2));
+
+        STORE(tmp + PARALLEL_COLS_53 * (i + 0), s0c_0);
+        STORE(tmp + PARALLEL_COLS_53 * (i + 0) + VREG_INT_COUNT, s0c_1);
+
+        /* d1c + ((s0c + s0n) >> 1) */
+        STORE(tmp + PARALLEL_COLS_53 * (i + 1) + 0,
+              ADD(d1c_0, SAR(ADD(s0c_0, s0n_0), 1)));
+        STORE(tmp + PARALLEL_COLS_53 * (i + 1) + VREG_INT_COUNT,
+              ADD(d1c_1, SAR(ADD(s0c_1, s0n_1), 1)));
+    }
+
+    STORE(tmp + PARALLEL_COLS_53 * (i + 0) + 0, s0n_0);
+    STORE(tmp + PARALLEL_COLS_53 * (i + 0) + VREG_INT_COUNT, s0n_1);
+
+    if (len & 1) {
+        VREG tmp_len_minus_1;
+        s1n_0 = LOADU(in_even + (OPJ_SIZE_T)((len - 1) / 2) * stride);
+        /* tmp_len_minus_1 = s1n - ((d1n + 1) >> 1); */
+        tmp_len_minus_1 = SUB(s1n_0, SAR(ADD3(d1n_0, d1n_0, two), 2));
+        STORE(tmp + PARALLEL_COLS_53 * (len - 1), tmp_len_minus_1);
+        /* d1n + ((s0n + tmp_len_minus_1) >> 1) */
+        STORE(tmp + PARALLEL_COLS_53 * (len - 2),
+              ADD(d1n_0, SAR(ADD(s0n_0, tmp_len_minus_1), 1)));
+
+        s1n_1 = LOADU(in_even + (OPJ_SIZE_T)((len - 1) / 2) * stride + VREG_INT_COUNT);
+        /* tmp_len_minus_1 = s1n - ((d1n + 1) >> 1); */
+        tmp_len_minus_1 = SUB(s1n_1, SAR(ADD3(d1n_1, d1n_1, two), 2));
+        STORE(tmp + PARALLEL_COLS_53 * (len - 1) + VREG_INT_COUNT,
+              tmp_len_minus_1);
+        /* d1n + ((s0n + tmp_len_minus_1) >> 1) */
+        STORE(tmp + PARALLEL_COLS_53 * (len - 2) + VREG_INT_COUNT,
+              ADD(d1n_1, SAR(ADD(s0n_1, tmp_len_minus_1), 1)));
+
+
+    } else {
+        STORE(tmp + PARALLEL_COLS_53 * (len - 1) + 0,
+              ADD(d1n_0, s0n_0));
+        STORE(tmp + PARALLEL_COLS_53 * (len - 1) + VREG_INT_COUNT,
+              ADD(d1n_1, s0n_1));
+    }
+
+    opj_idwt53_v_final_memcpy(tiledp_col, tmp, len, stride);
+}
+
+
+/** Vertical inverse 5x3 wavelet transform for 8 columns in SSE2 and NEON,
+ * or 16 in AVX2, when top-most pixel is on odd coordinate */
+static void opj_idwt53_v_cas1_mcols_SIMD(
+    OPJ_INT32* tmp,
+    const OPJ_INT32 sn,
+    const OPJ_INT32 len,
+    OPJ_INT32* tiledp_col,
+    const OPJ_SIZE_T stride)
+{
+    OPJ_INT32 i;
+    OPJ_SIZE_T j;
+
+    VREG s1_0, s2_0, dc_0, dn_0;
+    VREG s1_1, s2_1, dc_1, dn_1;
+    const VREG two = LOAD_CST(2);
+
+    const OPJ_INT32* in_even = &tiledp_col[(OPJ_SIZE_T)sn * stride];
+    const OPJ_INT32* in_odd = &tiledp_col[0];
+
+    assert(len > 2);
+#if defined(__AVX512F__)
+    assert(PARALLEL_COLS_53 == 32);
+    assert(VREG_INT_COUNT == 16);
+#elif defined(__AVX2__)
+    assert(PARALLEL_COLS_53 == 16);
+    assert(VREG_INT_COUNT == 8);
+#else
+    assert(PARALLEL_COLS_53 == 8);
+    assert(VREG_INT_COUNT == 4);
+#endif
+
+//For AVX512 code aligned load/store is set to it's unaligned equivalents
+#if !defined(__AVX512F__)
+    /* Note: loads of input even/odd values must be done in a unaligned */
+    /* fashion. But stores in tmp can be done with aligned store, since */
+    /* the temporary buffer is properly aligned */
+    assert((OPJ_SIZE_T)tmp % (sizeof(OPJ_INT32) * VREG_INT_COUNT) == 0);
+#endif
+
+    s1_0 = LOADU(in_even + stride);
+    /* in_odd[0] - ((in_even[0] + s1 + 2) >> 2); */
+    dc_0 = SUB(LOADU(in_odd + 0),
+               SAR(ADD3(LOADU(in_even + 0), s1_0, two), 2));
+    STORE(tmp + PARALLEL_COLS_53 * 0, ADD(LOADU(in_even + 0), dc_0));
+
+    s1_1 = LOADU(in_even + stride + VREG_INT_COUNT);
+    /* in_odd[0] - ((in_even[0] + s1 + 2) >> 2); */
+    dc_1 = SUB(LOADU(in_odd + VREG_INT_COUNT),
+               SAR(ADD3(LOADU(in_even + VREG_INT_COUNT), s1_1, two), 2));
+    STORE(tmp + PARALLEL_COLS_53 * 0 + VREG_INT_COUNT,
+          ADD(LOADU(in_even + VREG_INT_COUNT), dc_1));
+
+    for (i = 1, j = 1; i < (len - 2 - !(len & 1)); i += 2, j++) {
+
+        s2_0 = LOADU(in_even + (j + 1) * stride);
+        s2_1 = LOADU(in_even + (j + 1) * stride + VREG_INT_COUNT);
+
+        /* dn = in_odd[j * stride] - ((s1 + s2 + 2) >> 2); */
+        dn_0 = SUB(LOADU(in_odd + j * stride),
+                   SAR(ADD3(s1_0, s2_0, two), 2));
+        dn_1 = SUB(LOADU(in_odd + j * stride + VREG_INT_COUNT),
+                   SAR(ADD3(s1_1, s2_1, two), 2));
+
+        STORE(tmp + PARALLEL_COLS_53 * i, dc_0);
+        STORE(tmp + PARALLEL_COLS_53 * i + VREG_INT_COUNT, dc_1);
+
+        /* tmp[i + 1] = s1 + ((dn + dc) >> 1); */
+        STORE(tmp + PARALLEL_COLS_53 * (i + 1) + 0,
+              ADD(s1_0, SAR(ADD(dn_0, dc_0), 1)));
+        STORE(tmp + PARALLEL_COLS_53 * (i + 1) + VREG_INT_COUNT,
+              ADD(s1_1, SAR(ADD(dn_1, dc_1), 1)));
+
+        dc_0 = dn_0;
+        s1_0 = s2_0;
+        dc_1 = dn_1;
+        s1_1 = s2_1;
+    }
+    STORE(tmp + PARALLEL_COLS_53 * i, dc_0);
+    STORE(tmp + PARALLEL_COLS_53 * i + VREG_INT_COUNT, dc_1);
+
+    if (!(len & 1)) {
+        /*dn = in_odd[(len / 2 - 1) * stride] - ((s1 + 1) >> 1); */
+        dn_0 = SUB(LOADU(in_odd + (OPJ_SIZE_T)(len / 2 - 1) * stride),
+                   SAR(ADD3(s1_0, s1_0, two), 2));
+        dn_1 = SUB(LOADU(in_odd + (OPJ_SIZE_T)(len / 2 - 1) * stride + VREG_INT_COUNT),
+                   SAR(ADD3(s1_1, s1_1, two), 2));
+
+        /* tmp[len - 2] = s1 + ((dn + dc) >> 1); */
+        STORE(tmp + PARALLEL_COLS_53 * (len - 2) + 0,
+              ADD(s1_0, SAR(ADD(dn_0, dc_0), 1)));
+        STORE(tmp + PARALLEL_COLS_53 * (len - 2) + VREG_INT_COUNT,
+              ADD(s1_1, SAR(ADD(dn_1, dc_1), 1)));
+
+        STORE(tmp + PARALLEL_COLS_53 * (len - 1) + 0, dn_0);
+        STORE(tmp + PARALLEL_COLS_53 * (len - 1) + VREG_INT_COUNT, dn_1);
+    } else {
+        STORE(tmp + PARALLEL_COLS_53 * (len - 1) + 0, ADD(s1_0, dc_0));
+        STORE(tmp + PARALLEL_COLS_53 * (len - 1) + VREG_INT_COUNT,
+              ADD(s1_1, dc_1));
+    }
+
+    opj_idwt53_v_final_memcpy(tiledp_col, tmp, len, stride);
+}
+
+#if defined(__AVX2__) || defined(__AVX512F__)
+
+/*
+ * Forward transforms of the vertical pass.
+ *
+ * The lifting steps are streamed over the lines of the columns, so that the
+ * columns are read from the tile with no separate fetch pass, and the
+ * results written to their deinterleaved position as soon as they are
+ * final. The symmetric extension at both ends of the columns boils down to
+ * using the only available neighbour twice.
+ *
+ * The 9x7 arithmetic does the same operations, in the same order and with
+ * no FMA, as opj_v8dwt_encode_step1() and opj_v8dwt_encode_step2() in
+ * dwt.c, so that all kernels give identical results.
+ */
+
+#if defined(__AVX512F__)
+#define VREGF           __m512
+#define VMASK           __mmask16
+#define MAKE_MASK(n)    ((__mmask16)((1U << (n)) - 1U))
+#define LOADM(x,m)      _mm512_maskz_loadu_epi32((m),(const void*)(x))
+#define STOREM(x,m,y)   _mm512_mask_storeu_epi32((void*)(x),(m),(y))
+#define LOADF_CST(x)    _mm512_set1_ps(x)
+#define LOADF(x)        _mm512_loadu_ps((const float*)(x))
+#define LOADFM(x,m)     _mm512_maskz_loadu_ps((m),(const void*)(x))
+#define STOREF(x,y)     _mm512_storeu_ps((float*)(x),(y))
+#define STOREFM(x,m,y)  _mm512_mask_storeu_ps((void*)(x),(m),(y))
+#define ADDF(x,y)       _mm512_add_ps((x),(y))
+#define MULF(x,y)       _mm512_mul_ps((x),(y))
+#else
+#define VREGF           __m256
+#define VMASK           __m256i
+#define MAKE_MASK(n)    _mm256_cmpgt_epi32(_mm256_set1_epi32((int)(n)), \
+                                           _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7))
+#define LOADM(x,m)      _mm256_maskload_epi32((const int*)(x),(m))
+#define STOREM(x,m,y)   _mm256_maskstore_epi32((int*)(x),(m),(y))
+#define LOADF_CST(x)    _mm256_set1_ps(x)
+#define LOADF(x)        _mm256_loadu_ps((const float*)(x))
+#define LOADFM(x,m)     _mm256_maskload_ps((const float*)(x),(m))
+#define STOREF(x,y)     _mm256_storeu_ps((float*)(x),(y))
+#define STOREFM(x,m,y)  _mm256_maskstore_ps((float*)(x),(m),(y))
+#define ADDF(x,y)       _mm256_add_ps((x),(y))
+#define MULF(x,y)       _mm256_mul_ps((x),(y))
+#endif
+
+/* Load and store of line r of the columns, with a mask when not all the */
+/* columns of the vector are processed */
+#define LOAD_LINE(p,r)     (masked ? LOADM((p) + (OPJ_SIZE_T)(r) * stride, mask) : \
+                            LOADU((p) + (OPJ_SIZE_T)(r) * stride))
+#define STORE_LINE(p,r,y)  do { if (masked) { \
+        STOREM((p) + (OPJ_SIZE_T)(r) * stride, mask, (y)); } else { \
+        STOREU((p) + (OPJ_SIZE_T)(r) * stride, (y)); } } while(0)
+
+/** Forward 5x3 transform of the vertical pass, see
+ * opj_dwt_encode_and_deinterleave_v_53_SIMD() */
+static INLINE void opj_dwt_encode_v_53_mcols_SIMD(OPJ_INT32* array,
+        OPJ_INT32* tmp,
+        OPJ_UINT32 height,
+        OPJ_BOOL even,
+        OPJ_SIZE_T stride,
+        VMASK mask,
+        OPJ_BOOL masked)
+{
+    const OPJ_UINT32 sn = (height + (even ? 1 : 0)) >> 1;
+    const OPJ_UINT32 dn = height - sn;
+    /* Parity of the lines of the high-pass band */
+    const OPJ_UINT32 hp = even ? 1 : 0;
+    const VREG two = LOAD_CST(2);
+    VREG xm1, dm2;
+    OPJ_UINT32 k;
+
+    if (height < 2) {
+        if (height == 1 && !even) {
+            const VREG x0 = LOAD_LINE(array, 0);
+            STORE_LINE(array, 0, ADD(x0, x0));
+        }
+        return;
+    }
+
+    /* The low-pass line k - 1 is written to line (k - 1) / 2, which has */
+    /* already been read, once the high-pass line k has been computed. */
+    /* The high-pass lines go to tmp, until the low-pass band is complete */
+    xm1 = LOAD_LINE(array, 1 - hp);
+    dm2 = xm1;
+    for (k = hp; k < height; k += 2) {
+        const VREG xk = LOAD_LINE(array, k);
+        const VREG xp1 = (k + 1 < height) ? LOAD_LINE(array, k + 1) : xm1;
+        const VREG d = SUB(xk, SAR(ADD(xm1, xp1), 1));
+        if (k >= 1) {
+            const VREG dl = (k >= 2) ? dm2 : d;
+            STORE_LINE(array, (k - 1) >> 1,
+                       ADD(xm1, SAR(ADD3(dl, d, two), 2)));
+        }
+        STORE(tmp + (OPJ_SIZE_T)(k >> 1) * VREG_INT_COUNT, d);
+        dm2 = d;
+        xm1 = xp1;
+    }
+    if (((height - 1) & 1) != hp) {
+        STORE_LINE(array, (height - 1) >> 1,
+                   ADD(xm1, SAR(ADD3(dm2, dm2, two), 2)));
+    }
+
+    for (k = 0; k < dn; k++) {
+        STORE_LINE(array, sn + k, LOAD(tmp + (OPJ_SIZE_T)k * VREG_INT_COUNT));
+    }
+}
+
+/** Forward 5x3 transform of the vertical pass, processing up to
+ * VREG_INT_COUNT columns */
+static void opj_dwt_encode_and_deinterleave_v_53_SIMD(
+    void *arrayIn,
+    void *tmpIn,
+    OPJ_UINT32 height,
+    OPJ_BOOL even,
+    OPJ_UINT32 stride_width,
+    OPJ_UINT32 cols)
+{
+    if (cols == VREG_INT_COUNT) {
+        opj_dwt_encode_v_53_mcols_SIMD((OPJ_INT32*)arrayIn, (OPJ_INT32*)tmpIn,
+                                       height, even, stride_width,
+                                       MAKE_MASK(VREG_INT_COUNT), OPJ_FALSE);
+    } else {
+        opj_dwt_encode_v_53_mcols_SIMD((OPJ_INT32*)arrayIn, (OPJ_INT32*)tmpIn,
+                                       height, even, stride_width,
+                                       MAKE_MASK(cols), OPJ_TRUE);
+    }
+}
+
+#undef LOAD_LINE
+#undef STORE_LINE
+#define LOAD_LINE(p,s,r)   (src_masked ? LOADFM((p) + (OPJ_SIZE_T)(r) * (s), mask) : \
+                            LOADF((p) + (OPJ_SIZE_T)(r) * (s)))
+#define STORE_LINE(p,s,r,y)  do { if (dst_masked) { \
+        STOREFM((p) + (OPJ_SIZE_T)(r) * (s), mask, (y)); } else { \
+        STOREF((p) + (OPJ_SIZE_T)(r) * (s), (y)); } } while(0)
+
+/** Two consecutive lifting steps of the forward 9x7 transform, the first
+ * one with c1 on the high-pass lines and the second one with c2 on the
+ * low-pass lines. Line k of src goes to line k / 2 of low or high, after
+ * a multiplication by invK and K respectively when scale is set. */
+static INLINE void opj_dwt_encode_v_97_lift2_SIMD(
+    const OPJ_FLOAT32* src,
+    OPJ_SIZE_T src_stride,
+    OPJ_BOOL src_masked,
+    OPJ_FLOAT32* low,
+    OPJ_SIZE_T low_stride,
+    OPJ_FLOAT32* high,
+    OPJ_SIZE_T high_stride,
+    OPJ_BOOL dst_masked,
+    VMASK mask,
+    OPJ_UINT32 height,
+    OPJ_UINT32 hp,
+    OPJ_FLOAT32 c1,
+    OPJ_FLOAT32 c2,
+    OPJ_BOOL scale)
+{
+    const VREGF vc1 = LOADF_CST(c1);
+    const VREGF vc2 = LOADF_CST(c2);
+    const VREGF vK = LOADF_CST(opj_K);
+    const VREGF vinvK = LOADF_CST(opj_invK);
+    VREGF xm1, dm2;
+    OPJ_UINT32 k;
+
+    xm1 = LOAD_LINE(src, src_stride, 1 - hp);
+    dm2 = xm1;
+    for (k = hp; k < height; k += 2) {
+        const VREGF xk = LOAD_LINE(src, src_stride, k);
+        const VREGF xp1 = (k + 1 < height) ? LOAD_LINE(src, src_stride, k + 1) : xm1;
+        const VREGF d = ADDF(xk, MULF(ADDF(xm1, xp1), vc1));
+        if (k >= 1) {
+            const VREGF dl = (k >= 2) ? dm2 : d;
+            const VREGF s = ADDF(xm1, MULF(ADDF(dl, d), vc2));
+            STORE_LINE(low, low_stride, (k - 1) >> 1, scale ? MULF(s, vinvK) : s);
+        }
+        STORE_LINE(high, high_stride, k >> 1, scale ? MULF(d, vK) : d);
+        dm2 = d;
+        xm1 = xp1;
+    }
+    if (((height - 1) & 1) != hp) {
+        const VREGF s = ADDF(xm1, MULF(ADDF(dm2, dm2), vc2));
+        STORE_LINE(low, low_stride, (height - 1) >> 1, scale ? MULF(s, vinvK) : s);
+    }
+}
+
+/** Forward 9x7 transform of the vertical pass, see
+ * opj_dwt_encode_and_deinterleave_v_97_SIMD() */
+static INLINE void opj_dwt_encode_v_97_mcols_SIMD(OPJ_FLOAT32* array,
+        OPJ_FLOAT32* tmp,
+        OPJ_UINT32 height,
+        OPJ_BOOL even,
+        OPJ_SIZE_T stride,
+        VMASK mask,
+        OPJ_BOOL masked)
+{
+    const OPJ_UINT32 sn = (height + (even ? 1 : 0)) >> 1;
+    const OPJ_UINT32 hp = even ? 1 : 0;
+
+    if (height < 2) {
+        return;
+    }
+
+    /* alpha and beta steps, from the tile to tmp, in interleaved order */
+    opj_dwt_encode_v_97_lift2_SIMD(array, stride, masked,
+                                   tmp + (1 - hp) * VREG_INT_COUNT,
+                                   2 * VREG_INT_COUNT,
+                                   tmp + hp * VREG_INT_COUNT,
+                                   2 * VREG_INT_COUNT,
+                                   OPJ_FALSE,
+                                   mask, height, hp,
+                                   opj_dwt_alpha, opj_dwt_beta, OPJ_FALSE);
+    /* gamma and delta steps and scaling, from tmp to the deinterleaved */
+    /* bands of the tile */
+    opj_dwt_encode_v_97_lift2_SIMD(tmp, VREG_INT_COUNT, OPJ_FALSE,
+                                   array, stride,
+                                   array + (OPJ_SIZE_T)sn * stride, stride,
+                                   masked,
+                                   mask, height, hp,
+                                   opj_dwt_gamma, opj_dwt_delta, OPJ_TRUE);
+}
+
+/** Forward 9x7 transform of the vertical pass, processing up to
+ * VREG_INT_COUNT columns */
+static void opj_dwt_encode_and_deinterleave_v_97_SIMD(
+    void *arrayIn,
+    void *tmpIn,
+    OPJ_UINT32 height,
+    OPJ_BOOL even,
+    OPJ_UINT32 stride_width,
+    OPJ_UINT32 cols)
+{
+    if (cols == VREG_INT_COUNT) {
+        opj_dwt_encode_v_97_mcols_SIMD((OPJ_FLOAT32*)arrayIn, (OPJ_FLOAT32*)tmpIn,
+                                       height, even, stride_width,
+                                       MAKE_MASK(VREG_INT_COUNT), OPJ_FALSE);
+    } else {
+        opj_dwt_encode_v_97_mcols_SIMD((OPJ_FLOAT32*)arrayIn, (OPJ_FLOAT32*)tmpIn,
+                                       height, even, stride_width,
+                                       MAKE_MASK(cols), OPJ_TRUE);
+    }
+}
+
+#undef LOAD_LINE
+#undef STORE_LINE
+#undef VREGF
+#undef VMASK
+#undef MAKE_MASK
+#undef LOADM
+#undef STOREM
+#undef LOADF_CST
+#undef LOADF
+#undef LOADFM
+#undef STOREF
+#undef STOREFM
+#undef ADDF
+#undef MULF
+
+#endif /* defined(__AVX2__) || defined(__AVX512F__) */
+
+#undef VREG
+#undef LOAD_CST
+#undef LOADU
+#undef LOAD
+#undef STORE
+#undef STOREU
+#undef ADD
+#undef ADD3
+#undef SUB
+#undef SAR
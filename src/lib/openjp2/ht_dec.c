@@ -45,6 +45,15 @@
 #include "opj_includes.h"
 
 #include "t1_ht_luts.h"
+#include "t1_kernels.h"
+
+#ifdef OPJ_HT_DEC_AVX2
+#include <immintrin.h>
+
+#if defined(__GNUC__)
+#pragma GCC poison malloc calloc realloc free
+#endif
+#endif
 
 /////////////////////////////////////////////////////////////////////////////
 // compiler detection
@@ -1029,6 +1038,540 @@ OPJ_UINT32 frwd_fetch(frwd_struct_t *msp)
     return (OPJ_UINT32)msp->tmp;
 }
 
+//************************************************************************/
+/** @brief Decodes the MagSgn bits of the significant samples of a quad,
+  *         and updates the line state
+  *
+  *  The samples of the quad are visited in the order (x, y), (x, y + 1),
+  *  (x + 1, y), and (x + 1, y + 1). Insignificant samples inside the
+  *  codeblock are set to zero.
+  *
+  *  @param [in, out] magsgn is a pointer to the MagSgn frwd_struct_t
+  *  @param [in]      qinf is the quad information decoded from VLC
+  *  @param [in]      U_q is the u value of the quad, including E^max
+  *  @param [in]      p is the number of bitplanes of the codeblock
+  *  @param [in]      locs has one bit per sample of the quad that lies
+  *                   inside the codeblock
+  *  @param [out]     sp is a pointer to the first sample of the quad
+  *  @param [in]      stride is the decoded codeblock buffer stride
+  *  @param [in, out] lsp is a pointer to the line state of the quad;
+  *                   lsp[0] receives E^N, and lsp[1] E^NW for the next quad
+  */
+static INLINE
+void decode_quad_magsgn(frwd_struct_t *magsgn, OPJ_UINT32 qinf,
+                        OPJ_UINT32 U_q, OPJ_UINT32 p, OPJ_UINT32 locs,
+                        OPJ_UINT32 *sp, OPJ_INT32 stride, OPJ_UINT8 *lsp)
+{
+    OPJ_UINT32 m_n, v_n;
+    OPJ_UINT32 ms_val;
+
+    if (qinf & 0x10) { //is it significant? (sigma_n)
+        OPJ_UINT32 val;
+
+        ms_val = frwd_fetch(magsgn);         //get 32 bits of magsgn data
+        m_n = U_q - ((qinf >> 12) & 1);      //evaluate m_n (number of bits
+        // to read from bitstream), using EMB e_k
+        frwd_advance(magsgn, m_n);          //consume m_n
+        val = ms_val << 31;                 //get sign bit
+        v_n = ms_val & ((1U << m_n) - 1);   //keep only m_n bits
+        v_n |= ((qinf & 0x100) >> 8) << m_n;  //add EMB e_1 as MSB
+        v_n |= 1;                             //add center of bin
+        //v_n now has 2 * (\mu - 1) + 0.5 with correct sign bit
+        //add 2 to make it 2*\mu+0.5, shift it up to missing MSBs
+        sp[0] = val | ((v_n + 2) << (p - 1));
+    } else if (locs & 0x1) { // if this is inside the codeblock, set the
+        sp[0] = 0;           // sample to zero
+    }
+
+    if (qinf & 0x20) { //sigma_n
+        OPJ_UINT32 val, t;
+
+        ms_val = frwd_fetch(magsgn);         //get 32 bits
+        m_n = U_q - ((qinf >> 13) & 1);      //m_n, uses EMB e_k
+        frwd_advance(magsgn, m_n);           //consume m_n
+        val = ms_val << 31;                  //get sign bit
+        v_n = ms_val & ((1U << m_n) - 1);    //keep only m_n bits
+        v_n |= ((qinf & 0x200) >> 9) << m_n; //add EMB e_1
+        v_n |= 1;                            //bin center
+        sp[stride] = val | ((v_n + 2) << (p - 1));
+
+        //update line_state: bit 7 (\sigma^N), and E^N
+        t = lsp[0] & 0x7F;       // keep E^NW
+        v_n = 32 - count_leading_zeros(v_n);
+        lsp[0] = (OPJ_UINT8)(0x80 | (t > v_n ? t : v_n)); //max(E^NW, E^N) | s
+    } else if (locs & 0x2) { // if this is inside the codeblock, set the
+        sp[stride] = 0;      // sample to zero
+    }
+
+    if (qinf & 0x40) {
+        OPJ_UINT32 val;
+
+        ms_val = frwd_fetch(magsgn);
+        m_n = U_q - ((qinf >> 14) & 1);
+        frwd_advance(magsgn, m_n);
+        val = ms_val << 31;
+        v_n = ms_val & ((1U << m_n) - 1);
+        v_n |= (((qinf & 0x400) >> 10) << m_n);
+        v_n |= 1;
+        sp[1] = val | ((v_n + 2) << (p - 1));
+    } else if (locs & 0x4) {
+        sp[1] = 0;
+    }
+
+    lsp[1] = 0;
+    if (qinf & 0x80) {
+        OPJ_UINT32 val;
+
+        ms_val = frwd_fetch(magsgn);
+        m_n = U_q - ((qinf >> 15) & 1); //m_n
+        frwd_advance(magsgn, m_n);
+        val = ms_val << 31;
+        v_n = ms_val & ((1U << m_n) - 1);
+        v_n |= ((qinf & 0x800) >> 11) << m_n;
+        v_n |= 1; //center of bin
+        sp[stride + 1] = val | ((v_n + 2) << (p - 1));
+
+        //line_state: bit 7 (\sigma^NW), and E^NW for next quad
+        lsp[1] = (OPJ_UINT8)(0x80 | (32 - count_leading_zeros(v_n)));
+    } else if (locs & 0x8) { //if outside set to 0
+        sp[stride + 1] = 0;
+    }
+}
+
+//************************************************************************/
+/** @brief Applies the magnitude refinement bits to 8 columns of a stripe
+  *
+  *  Each nibble of sig flags the significant samples of one column, and
+  *  the bits of cwd are consumed in that order, one per significant sample.
+  *
+  *  @param [in, out] dp is a pointer to the first sample of the columns
+  *  @param [in]      stride is the decoded codeblock buffer stride
+  *  @param [in]      sig is the significance of the 4 rows of 8 columns
+  *  @param [in]      cwd is the head of the MagRef bitstream
+  *  @param [in]      p is the number of bitplanes of the codeblock
+  */
+static INLINE
+void decode_mrp_columns(OPJ_UINT32 *dp, OPJ_INT32 stride, OPJ_UINT32 sig,
+                        OPJ_UINT32 cwd, OPJ_UINT32 p)
+{
+    OPJ_UINT32 half = 1u << (p - 2); // half the center of the bin
+    OPJ_UINT32 col_mask = 0xFu;  // a mask for a column in sig
+    int j;
+    for (j = 0; j < 8; ++j, dp++) { //one column at a time
+        if (sig & col_mask) { // lowest nibble
+            OPJ_UINT32 sample_mask = 0x11111111u & col_mask; //LSB
+
+            if (sig & sample_mask) { //if LSB is set
+                OPJ_UINT32 sym;
+
+                assert(dp[0] != 0); // decoded value cannot be zero
+                sym = cwd & 1; // get it value
+                // remove center of bin if sym is 0
+                dp[0] ^= (1 - sym) << (p - 1);
+                dp[0] |= half;      // put half the center of bin
+                cwd >>= 1;          //consume word
+            }
+            sample_mask += sample_mask; //next row
+
+            if (sig & sample_mask) {
+                OPJ_UINT32 sym;
+
+                assert(dp[stride] != 0);
+                sym = cwd & 1;
+                dp[stride] ^= (1 - sym) << (p - 1);
+                dp[stride] |= half;
+                cwd >>= 1;
+            }
+            sample_mask += sample_mask;
+
+            if (sig & sample_mask) {
+                OPJ_UINT32 sym;
+
+                assert(dp[2 * stride] != 0);
+                sym = cwd & 1;
+                dp[2 * stride] ^= (1 - sym) << (p - 1);
+                dp[2 * stride] |= half;
+                cwd >>= 1;
+            }
+            sample_mask += sample_mask;
+
+            if (sig & sample_mask) {
+                OPJ_UINT32 sym;
+
+                assert(dp[3 * stride] != 0);
+                sym = cwd & 1;
+                dp[3 * stride] ^= (1 - sym) << (p - 1);
+                dp[3 * stride] |= half;
+                cwd >>= 1;
+            }
+            sample_mask += sample_mask;
+        }
+        col_mask <<= 4; //next column
+    }
+}
+
+//************************************************************************/
+/** @brief Sets the sign and value of the samples of 4 columns of a stripe
+  *         that became significant in the significance propagation pass
+  *
+  *  @param [in, out] dp is a pointer to the first sample of the columns
+  *  @param [in]      stride is the decoded codeblock buffer stride
+  *  @param [in]      new_sig has one nibble per column, flagging the new
+  *                   significant samples
+  *  @param [in]      cwd is the head of the SigProp bitstream, holding
+  *                   one sign bit per new significant sample
+  *  @param [in]      val is the value of a new significant sample
+  *
+  *  @return the number of consumed bits
+  */
+static INLINE
+OPJ_UINT32 decode_spp_signs(OPJ_UINT32 *dp, OPJ_INT32 stride,
+                            OPJ_UINT32 new_sig, OPJ_UINT32 cwd,
+                            OPJ_UINT32 val)
+{
+    OPJ_UINT32 col_mask = 0xFu; //mask to select a column
+    OPJ_UINT32 cnt = 0;
+    int j;
+
+    for (j = 0; j < 4; ++j, ++dp, col_mask <<= 4) {
+        OPJ_UINT32 sample_mask;
+
+        if ((col_mask & new_sig) == 0) { //if non is significant
+            continue;
+        }
+
+        //scan 4 signs
+        sample_mask = 0x11111111u & col_mask;
+        if (new_sig & sample_mask) {
+            assert(dp[0] == 0);
+            dp[0] |= ((cwd & 1) << 31) | val; //put value and sign
+            cwd >>= 1;
+            ++cnt; //consume bit and increment number
+            //of consumed bits
+        }
+
+        sample_mask += sample_mask;
+        if (new_sig & sample_mask) {
+            assert(dp[stride] == 0);
+            dp[stride] |= ((cwd & 1) << 31) | val;
+            cwd >>= 1;
+            ++cnt;
+        }
+
+        sample_mask += sample_mask;
+        if (new_sig & sample_mask) {
+            assert(dp[2 * stride] == 0);
+            dp[2 * stride] |= ((cwd & 1) << 31) | val;
+            cwd >>= 1;
+            ++cnt;
+        }
+
+        sample_mask += sample_mask;
+        if (new_sig & sample_mask) {
+            assert(dp[3 * stride] == 0);
+            dp[3 * stride] |= ((cwd & 1) << 31) | val;
+            cwd >>= 1;
+            ++cnt;
+        }
+    }
+    return cnt;
+}
+
+//************************************************************************/
+/** @brief Converts a row of decoded samples from sign-magnitude to two's
+  *         complement
+  *
+  *  @param [in, out] sp is a pointer to the samples
+  *  @param [in]      width is the number of samples
+  */
+static INLINE
+void convert_row_to_twos_complement(OPJ_INT32 *sp, OPJ_INT32 width)
+{
+    OPJ_INT32 x;
+    for (x = 0; x < width; ++x, ++sp) {
+        OPJ_INT32 val = (*sp & 0x7FFFFFFF);
+        *sp = ((OPJ_UINT32) * sp & 0x80000000) ? -val : val;
+    }
+}
+
+//************************************************************************/
+/** @brief Sets the significance of the samples of two rows, from the
+  *         samples decoded by the cleanup pass
+  *
+  *  This replaces the decoding of the cleanup pass for the rows, when its
+  *  output is known from a previous decoding of the codeblock. A sample is
+  *  significant if and only if it is not zero.
+  *
+  *  @param [in, out] sip is a pointer to the sigma array of the rows
+  *  @param [in]      sp is a pointer to the first sample of the rows
+  *  @param [in]      width is the decoded codeblock width
+  *  @param [in]      stride is the decoded codeblock buffer stride
+  *  @param [in]      rows is the number of rows, 1 or 2
+  *  @param [in]      shift is the position of the first row in its
+  *                   stripe, 0 or 2
+  */
+static INLINE
+void set_sigma_from_samples(OPJ_UINT32 *sip, const OPJ_UINT32 *sp,
+                            OPJ_INT32 width, OPJ_INT32 stride,
+                            OPJ_INT32 rows, OPJ_UINT32 shift)
+{
+    OPJ_INT32 x;
+    for (x = 0; x < width; ++x) {
+        OPJ_UINT32 sig = sp[x] != 0;
+        if (rows > 1) {
+            sig |= (OPJ_UINT32)(sp[x + stride] != 0) << 1;
+        }
+        sip[x >> 3] |= sig << (((OPJ_UINT32)(x & 7) << 2) + shift);
+    }
+}
+
+#ifdef OPJ_HT_DEC_AVX2
+
+//************************************************************************/
+/** @brief Returns, in each lane, the 32 bits of a 64-bit bitstream buffer
+  *         that start at the bit position given by the lane of pos
+  *
+  *  @param [in]  tmp is the bitstream buffer
+  *  @param [in]  pos holds 4 bit positions
+  */
+static INLINE
+__m128i magsgn_window_avx2(OPJ_UINT64 tmp, __m128i pos)
+{
+    __m256i w = _mm256_srlv_epi64(_mm256_set1_epi64x((long long)tmp),
+                                  _mm256_cvtepu32_epi64(pos));
+    return _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(w,
+                                  _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6)));
+}
+
+//************************************************************************/
+/** @brief AVX2 version of decode_quad_magsgn()
+  *
+  *  The MagSgn bits of the 4 samples are extracted together when the
+  *  bitstream buffer holds all of them, or one column at a time. When a
+  *  column needs more bits than the buffer holds, decode_quad_magsgn()
+  *  is used.
+  */
+static INLINE
+void decode_quad_magsgn_avx2(frwd_struct_t *magsgn, OPJ_UINT32 qinf,
+                             OPJ_UINT32 U_q, OPJ_UINT32 p, OPJ_UINT32 locs,
+                             OPJ_UINT32 *sp, OPJ_INT32 stride,
+                             OPJ_UINT8 *lsp)
+{
+    const __m128i one = _mm_set1_epi32(1);
+    __m128i q, sig, m, inc, pos, v, e_1, val;
+    OPJ_UINT32 total;
+    OPJ_UINT32 s[4], vn[4];
+
+    if ((qinf & 0xF0) == 0) { // no significant sample
+        if (locs & 0x1) {
+            sp[0] = 0;
+        }
+        if (locs & 0x2) {
+            sp[stride] = 0;
+        }
+        if (locs & 0x4) {
+            sp[1] = 0;
+        }
+        if (locs & 0x8) {
+            sp[stride + 1] = 0;
+        }
+        lsp[1] = 0;
+        return;
+    }
+
+    // sigma_n (bits 4 to 7 of qinf) as lane masks
+    q = _mm_set1_epi32((OPJ_INT32)qinf);
+    sig = _mm_srai_epi32(_mm_sllv_epi32(q, _mm_setr_epi32(27, 26, 25, 24)), 31);
+    // m_n = U_q - e_k (bits 12 to 15 of qinf), 0 for insignificant samples
+    m = _mm_srlv_epi32(q, _mm_setr_epi32(12, 13, 14, 15));
+    m = _mm_sub_epi32(_mm_set1_epi32((OPJ_INT32)U_q), _mm_and_si128(m, one));
+    m = _mm_and_si128(m, sig);
+    // inclusive prefix sum of m_n, the last lane is the total
+    inc = _mm_add_epi32(m, _mm_slli_si128(m, 4));
+    inc = _mm_add_epi32(inc, _mm_slli_si128(inc, 8));
+    total = (OPJ_UINT32)_mm_extract_epi32(inc, 3);
+
+    // the sign of a sample is read from the bit that follows its m_n bits,
+    // so more bits than the total must be available; otherwise, the two
+    // columns of the quad are read one after the other
+    pos = _mm_sub_epi32(inc, m);
+    frwd_fetch(magsgn);
+    if (total < magsgn->bits) {
+        v = magsgn_window_avx2(magsgn->tmp, pos);
+        frwd_advance(magsgn, total);
+    } else {
+        OPJ_UINT32 first = (OPJ_UINT32)_mm_extract_epi32(inc, 1);
+        if (first >= magsgn->bits || total - first >= 32) {
+            decode_quad_magsgn(magsgn, qinf, U_q, p, locs, sp, stride, lsp);
+            return;
+        }
+        v = magsgn_window_avx2(magsgn->tmp, pos);
+        frwd_advance(magsgn, first);
+        frwd_fetch(magsgn); // at least 32 bits
+        pos = _mm_sub_epi32(pos, _mm_set1_epi32((OPJ_INT32)first));
+        v = _mm_blend_epi32(v, magsgn_window_avx2(magsgn->tmp, pos), 0xC);
+        frwd_advance(magsgn, total - first);
+    }
+
+    val = _mm_slli_epi32(v, 31);                                  //sign bit
+    v = _mm_and_si128(v, _mm_sub_epi32(_mm_sllv_epi32(one, m), one)); //m_n bits
+    e_1 = _mm_and_si128(_mm_srlv_epi32(q, _mm_setr_epi32(8, 9, 10, 11)), one);
+    v = _mm_or_si128(v, _mm_sllv_epi32(e_1, m));                  //EMB e_1
+    v = _mm_or_si128(v, one);                                     //bin center
+    val = _mm_or_si128(val, _mm_sll_epi32(_mm_add_epi32(v, _mm_set1_epi32(2)),
+                                          _mm_cvtsi32_si128((OPJ_INT32)(p - 1))));
+    val = _mm_and_si128(val, sig);
+    _mm_storeu_si128((__m128i*)s, val);
+    _mm_storeu_si128((__m128i*)vn, v);
+
+    if (locs == 0xF) {
+        sp[0] = s[0];
+        sp[stride] = s[1];
+        sp[1] = s[2];
+        sp[stride + 1] = s[3];
+    } else {
+        if (locs & 0x1) {
+            sp[0] = s[0];
+        }
+        if (locs & 0x2) {
+            sp[stride] = s[1];
+        }
+        if (locs & 0x4) {
+            sp[1] = s[2];
+        }
+        if (locs & 0x8) {
+            sp[stride + 1] = s[3];
+        }
+    }
+
+    //update line_state: E^N, and E^NW for the next quad
+    if (qinf & 0x20) {
+        OPJ_UINT32 t = lsp[0] & 0x7F;
+        OPJ_UINT32 e = 32 - count_leading_zeros(vn[1]);
+        lsp[0] = (OPJ_UINT8)(0x80 | (t > e ? t : e));
+    }
+    lsp[1] = (qinf & 0x80) ?
+             (OPJ_UINT8)(0x80 | (32 - count_leading_zeros(vn[3]))) : 0;
+}
+
+//************************************************************************/
+/** @brief AVX2 version of decode_mrp_columns()
+  *
+  *  One lane per column; the position of the bit of a sample in cwd is
+  *  the number of significant samples that precede it.
+  */
+static INLINE
+void decode_mrp_columns_avx2(OPJ_UINT32 *dp, OPJ_INT32 stride,
+                             OPJ_UINT32 sig, OPJ_UINT32 cwd, OPJ_UINT32 p)
+{
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256i half = _mm256_set1_epi32((OPJ_INT32)(1u << (p - 2)));
+    const __m128i shift = _mm_cvtsi32_si128((OPJ_INT32)(p - 1));
+    const __m256i bits = _mm256_set1_epi32((OPJ_INT32)cwd);
+    __m256i nib, cnt, pos, t;
+    int r;
+
+    nib = _mm256_srlv_epi32(_mm256_set1_epi32((OPJ_INT32)sig),
+                            _mm256_setr_epi32(0, 4, 8, 12, 16, 20, 24, 28));
+    nib = _mm256_and_si256(nib, _mm256_set1_epi32(0xF));
+    // number of significant samples in each column
+    cnt = _mm256_shuffle_epi8(_mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3,
+                              1, 2, 2, 3, 2, 3, 3, 4,
+                              0, 1, 1, 2, 1, 2, 2, 3,
+                              1, 2, 2, 3, 2, 3, 3, 4), nib);
+    // exclusive prefix sum over the columns
+    pos = _mm256_add_epi32(cnt, _mm256_slli_si256(cnt, 4));
+    pos = _mm256_add_epi32(pos, _mm256_slli_si256(pos, 8));
+    t = _mm256_permutevar8x32_epi32(pos, _mm256_set1_epi32(3));
+    pos = _mm256_add_epi32(pos, _mm256_blend_epi32(_mm256_setzero_si256(), t,
+                           0xF0));
+    pos = _mm256_sub_epi32(pos, cnt);
+
+    for (r = 0; r < 4; ++r) {
+        OPJ_INT32 *row = (OPJ_INT32*)dp + r * stride;
+        __m256i bit = _mm256_and_si256(_mm256_srli_epi32(nib, r), one);
+        __m256i mask = _mm256_cmpeq_epi32(bit, one);
+        __m256i sym = _mm256_and_si256(_mm256_srlv_epi32(bits, pos), one);
+        __m256i d = _mm256_maskload_epi32(row, mask);
+        // remove center of bin if sym is 0, and put half the center of bin
+        d = _mm256_xor_si256(d, _mm256_sll_epi32(_mm256_xor_si256(sym, one),
+                             shift));
+        _mm256_maskstore_epi32(row, mask, _mm256_or_si256(d, half));
+        pos = _mm256_add_epi32(pos, bit);
+    }
+}
+
+//************************************************************************/
+/** @brief AVX2 version of decode_spp_signs() */
+static INLINE
+OPJ_UINT32 decode_spp_signs_avx2(OPJ_UINT32 *dp, OPJ_INT32 stride,
+                                 OPJ_UINT32 new_sig, OPJ_UINT32 cwd,
+                                 OPJ_UINT32 val)
+{
+    const __m128i one = _mm_set1_epi32(1);
+    const __m128i value = _mm_set1_epi32((OPJ_INT32)val);
+    const __m128i bits = _mm_set1_epi32((OPJ_INT32)cwd);
+    __m128i nib, cnt, pos;
+    int r;
+
+    new_sig &= 0xFFFF;
+    if (new_sig == 0) {
+        return 0;
+    }
+    nib = _mm_srlv_epi32(_mm_set1_epi32((OPJ_INT32)new_sig),
+                         _mm_setr_epi32(0, 4, 8, 12));
+    nib = _mm_and_si128(nib, _mm_set1_epi32(0xF));
+    cnt = _mm_shuffle_epi8(_mm_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3,
+                                         1, 2, 2, 3, 2, 3, 3, 4), nib);
+    pos = _mm_add_epi32(cnt, _mm_slli_si128(cnt, 4));
+    pos = _mm_add_epi32(pos, _mm_slli_si128(pos, 8));
+    pos = _mm_sub_epi32(pos, cnt);
+
+    for (r = 0; r < 4; ++r) {
+        OPJ_INT32 *row = (OPJ_INT32*)dp + r * stride;
+        __m128i bit = _mm_and_si128(_mm_srli_epi32(nib, r), one);
+        __m128i mask = _mm_cmpeq_epi32(bit, one);
+        __m128i sign = _mm_slli_epi32(_mm_srlv_epi32(bits, pos), 31);
+        __m128i d = _mm_maskload_epi32(row, mask);
+        d = _mm_or_si128(d, _mm_or_si128(sign, value));
+        _mm_maskstore_epi32(row, mask, d);
+        pos = _mm_add_epi32(pos, bit);
+    }
+    return population_count(new_sig);
+}
+
+//************************************************************************/
+/** @brief AVX2 version of convert_row_to_twos_complement() */
+static INLINE
+void convert_row_to_twos_complement_avx2(OPJ_INT32 *sp, OPJ_INT32 width)
+{
+    const __m256i mag_mask = _mm256_set1_epi32(0x7FFFFFFF);
+    OPJ_INT32 x;
+    for (x = 0; x + 8 <= width; x += 8, sp += 8) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)sp);
+        __m256i s = _mm256_srai_epi32(v, 31);
+        v = _mm256_and_si256(v, mag_mask);
+        // (v ^ s) - s negates v where the sign bit was set
+        v = _mm256_sub_epi32(_mm256_xor_si256(v, s), s);
+        _mm256_storeu_si256((__m256i*)sp, v);
+    }
+    convert_row_to_twos_complement(sp, width - x);
+}
+
+#define DECODE_QUAD_MAGSGN decode_quad_magsgn_avx2
+#define DECODE_MRP_COLUMNS decode_mrp_columns_avx2
+#define DECODE_SPP_SIGNS decode_spp_signs_avx2
+#define CONVERT_ROW_TO_TWOS_COMPLEMENT convert_row_to_twos_complement_avx2
+
+#else
+
+#define DECODE_QUAD_MAGSGN decode_quad_magsgn
+#define DECODE_MRP_COLUMNS decode_mrp_columns
+#define DECODE_SPP_SIGNS decode_spp_signs
+#define CONVERT_ROW_TO_TWOS_COMPLEMENT convert_row_to_twos_complement
+
+#endif /* OPJ_HT_DEC_AVX2 */
+
 //************************************************************************/
 /** @brief Allocates T1 buffers
   *
@@ -1096,6 +1639,7 @@ static OPJ_BOOL opj_t1_allocate_buffers(
     return OPJ_TRUE;
 }
 
+#ifndef OPJ_HT_DEC_AVX2
 /**
 Decode 1 HT code-block
 @param t1 T1 handle
@@ -1115,6 +1659,7 @@ OPJ_BOOL opj_t1_ht_decode_cblk(opj_t1_t *t1,
                                opj_event_mgr_t *p_manager,
                                opj_mutex_t* p_manager_mutex,
                                OPJ_BOOL check_pterm);
+#endif
 
 //************************************************************************/
 /** @brief Decodes one codeblock, processing the cleanup, siginificance
@@ -1129,7 +1674,7 @@ OPJ_BOOL opj_t1_ht_decode_cblk(opj_t1_t *t1,
   *  @param [in]       p_manager_mutex a mutex to control access to p_manager
   *  @param [in]       check_pterm: check termination (not used)
   */
-OPJ_BOOL opj_t1_ht_decode_cblk(opj_t1_t *t1,
+static OPJ_BOOL ht_decode_cblk(opj_t1_t *t1,
                                opj_tcd_cblk_dec_t* cblk,
                                OPJ_UINT32 orient,
                                OPJ_UINT32 roishift,
@@ -1166,6 +1711,12 @@ OPJ_BOOL opj_t1_ht_decode_cblk(opj_t1_t *t1,
     OPJ_INT32 x, y; // loop indices
     OPJ_BOOL stripe_causal = (cblksty & J2K_CCP_CBLKSTY_VSC) != 0;
     OPJ_UINT32 cblk_len = 0;
+    // whether the output of the cleanup pass is taken from the state saved
+    // by a previous decoding of the codeblock, and only the SigProp and
+    // MagRef passes are decoded
+    OPJ_BOOL resume = OPJ_FALSE;
+    // whether the output of the cleanup pass is saved
+    OPJ_BOOL keep_dec_state = t1->keep_dec_state && cblk->decoded_data != NULL;
 
     (void)(orient);      // stops unused parameter message
     (void)(check_pterm); // stops unused parameter message
@@ -1242,7 +1793,10 @@ OPJ_BOOL opj_t1_ht_decode_cblk(opj_t1_t *t1,
     // OPJ_BYTE* coded_data is a pointer to bitstream
     coded_data = cblkdata;
     // OPJ_UINT32* decoded_data is a pointer to decoded codeblock data buf.
-    decoded_data = (OPJ_UINT32*)t1->data;
+    // For subtile decoding, directly decode in the decoded_data buffer of
+    // the code-block, which is zero-initialized like t1->data
+    decoded_data = cblk->decoded_data ? (OPJ_UINT32*)cblk->decoded_data :
+                   (OPJ_UINT32*)t1->data;
     // OPJ_UINT32 num_passes is the number of passes: 1 if CUP only, 2 for
     // CUP+SPP, and 3 for CUP+SPP+MRP
     num_passes = cblk->numsegs > 0 ? cblk->segs[0].real_num_passes : 0;
@@ -1446,6 +2000,14 @@ OPJ_BOOL opj_t1_ht_decode_cblk(opj_t1_t *t1,
     // here expanded to 528
     line_state = (OPJ_UINT8 *)(mbr2 + 132);
 
+    if (keep_dec_state && num_passes > 1 && cblk->dec_state != NULL &&
+            cblk->dec_state->numpasses == 1 &&
+            cblk->dec_state->mqc.offset == lengths1) {
+        resume = OPJ_TRUE;
+        memcpy(decoded_data, cblk->dec_state->data,
+               (size_t)width * (size_t)height * sizeof(OPJ_UINT32));
+    }
+
     //initial 2 lines
     /////////////////
     lsp = line_state;              // point to line state
@@ -1458,12 +2020,10 @@ OPJ_BOOL opj_t1_ht_decode_cblk(opj_t1_t *t1,
     sp = decoded_data;          // decoded codeblock samples
     // vlc_val;                 // fetched data from VLC bitstream
 
-    for (x = 0; x < width; x += 4) { // one iteration per quad pair
+    for (x = 0; x < width && !resume; x += 4) { // one iteration per quad pair
         OPJ_UINT32 U_q[2]; // u values for the quad pair
         OPJ_UINT32 uvlc_mode;
         OPJ_UINT32 consumed_bits;
-        OPJ_UINT32 m_n, v_n;
-        OPJ_UINT32 ms_val;
         OPJ_UINT32 locs;
 
         // decode VLC
@@ -1615,159 +2175,20 @@ OPJ_BOOL opj_t1_ht_decode_cblk(opj_t1_t *t1,
         }
 
         //first quad, starting at first sample in quad and moving on
-        if (qinf[0] & 0x10) { //is it significant? (sigma_n)
-            OPJ_UINT32 val;
-
-            ms_val = frwd_fetch(&magsgn);         //get 32 bits of magsgn data
-            m_n = U_q[0] - ((qinf[0] >> 12) & 1); //evaluate m_n (number of bits
-            // to read from bitstream), using EMB e_k
-            frwd_advance(&magsgn, m_n);         //consume m_n
-            val = ms_val << 31;                 //get sign bit
-            v_n = ms_val & ((1U << m_n) - 1);   //keep only m_n bits
-            v_n |= ((qinf[0] & 0x100) >> 8) << m_n;  //add EMB e_1 as MSB
-            v_n |= 1;                                //add center of bin
-            //v_n now has 2 * (\mu - 1) + 0.5 with correct sign bit
-            //add 2 to make it 2*\mu+0.5, shift it up to missing MSBs
-            sp[0] = val | ((v_n + 2) << (p - 1));
-        } else if (locs & 0x1) { // if this is inside the codeblock, set the
-            sp[0] = 0;           // sample to zero
-        }
-
-        if (qinf[0] & 0x20) { //sigma_n
-            OPJ_UINT32 val, t;
-
-            ms_val = frwd_fetch(&magsgn);         //get 32 bits
-            m_n = U_q[0] - ((qinf[0] >> 13) & 1); //m_n, uses EMB e_k
-            frwd_advance(&magsgn, m_n);           //consume m_n
-            val = ms_val << 31;                   //get sign bit
-            v_n = ms_val & ((1U << m_n) - 1);     //keep only m_n bits
-            v_n |= ((qinf[0] & 0x200) >> 9) << m_n; //add EMB e_1
-            v_n |= 1;                               //bin center
-            //v_n now has 2 * (\mu - 1) + 0.5 with correct sign bit
-            //add 2 to make it 2*\mu+0.5, shift it up to missing MSBs
-            sp[stride] = val | ((v_n + 2) << (p - 1));
-
-            //update line_state: bit 7 (\sigma^N), and E^N
-            t = lsp[0] & 0x7F;       // keep E^NW
-            v_n = 32 - count_leading_zeros(v_n);
-            lsp[0] = (OPJ_UINT8)(0x80 | (t > v_n ? t : v_n)); //max(E^NW, E^N) | s
-        } else if (locs & 0x2) { // if this is inside the codeblock, set the
-            sp[stride] = 0;      // sample to zero
-        }
-
-        ++lsp; // move to next quad information
-        ++sp;  // move to next column of samples
-
-        //this is similar to the above two samples
-        if (qinf[0] & 0x40) {
-            OPJ_UINT32 val;
-
-            ms_val = frwd_fetch(&magsgn);
-            m_n = U_q[0] - ((qinf[0] >> 14) & 1);
-            frwd_advance(&magsgn, m_n);
-            val = ms_val << 31;
-            v_n = ms_val & ((1U << m_n) - 1);
-            v_n |= (((qinf[0] & 0x400) >> 10) << m_n);
-            v_n |= 1;
-            sp[0] = val | ((v_n + 2) << (p - 1));
-        } else if (locs & 0x4) {
-            sp[0] = 0;
-        }
-
-        lsp[0] = 0;
-        if (qinf[0] & 0x80) {
-            OPJ_UINT32 val;
-            ms_val = frwd_fetch(&magsgn);
-            m_n = U_q[0] - ((qinf[0] >> 15) & 1); //m_n
-            frwd_advance(&magsgn, m_n);
-            val = ms_val << 31;
-            v_n = ms_val & ((1U << m_n) - 1);
-            v_n |= ((qinf[0] & 0x800) >> 11) << m_n;
-            v_n |= 1; //center of bin
-            sp[stride] = val | ((v_n + 2) << (p - 1));
-
-            //line_state: bit 7 (\sigma^NW), and E^NW for next quad
-            lsp[0] = (OPJ_UINT8)(0x80 | (32 - count_leading_zeros(v_n)));
-        } else if (locs & 0x8) { //if outside set to 0
-            sp[stride] = 0;
-        }
-
-        ++sp; //move to next column
+        DECODE_QUAD_MAGSGN(&magsgn, qinf[0], U_q[0], p, locs & 0xF, sp, stride,
+                           lsp);
+        lsp += 1; // move to next quad information
+        sp += 2;  // move to next quad of samples
 
         //second quad
-        if (qinf[1] & 0x10) {
-            OPJ_UINT32 val;
-
-            ms_val = frwd_fetch(&magsgn);
-            m_n = U_q[1] - ((qinf[1] >> 12) & 1); //m_n
-            frwd_advance(&magsgn, m_n);
-            val = ms_val << 31;
-            v_n = ms_val & ((1U << m_n) - 1);
-            v_n |= (((qinf[1] & 0x100) >> 8) << m_n);
-            v_n |= 1;
-            sp[0] = val | ((v_n + 2) << (p - 1));
-        } else if (locs & 0x10) {
-            sp[0] = 0;
-        }
-
-        if (qinf[1] & 0x20) {
-            OPJ_UINT32 val, t;
-
-            ms_val = frwd_fetch(&magsgn);
-            m_n = U_q[1] - ((qinf[1] >> 13) & 1); //m_n
-            frwd_advance(&magsgn, m_n);
-            val = ms_val << 31;
-            v_n = ms_val & ((1U << m_n) - 1);
-            v_n |= (((qinf[1] & 0x200) >> 9) << m_n);
-            v_n |= 1;
-            sp[stride] = val | ((v_n + 2) << (p - 1));
-
-            //update line_state: bit 7 (\sigma^N), and E^N
-            t = lsp[0] & 0x7F;            //E^NW
-            v_n = 32 - count_leading_zeros(v_n);     //E^N
-            lsp[0] = (OPJ_UINT8)(0x80 | (t > v_n ? t : v_n)); //max(E^NW, E^N) | s
-        } else if (locs & 0x20) {
-            sp[stride] = 0;    //no need to update line_state
-        }
-
-        ++lsp; //move line state to next quad
-        ++sp;  //move to next sample
-
-        if (qinf[1] & 0x40) {
-            OPJ_UINT32 val;
-
-            ms_val = frwd_fetch(&magsgn);
-            m_n = U_q[1] - ((qinf[1] >> 14) & 1); //m_n
-            frwd_advance(&magsgn, m_n);
-            val = ms_val << 31;
-            v_n = ms_val & ((1U << m_n) - 1);
-            v_n |= (((qinf[1] & 0x400) >> 10) << m_n);
-            v_n |= 1;
-            sp[0] = val | ((v_n + 2) << (p - 1));
-        } else if (locs & 0x40) {
-            sp[0] = 0;
-        }
-
-        lsp[0] = 0;
-        if (qinf[1] & 0x80) {
-            OPJ_UINT32 val;
-
-            ms_val = frwd_fetch(&magsgn);
-            m_n = U_q[1] - ((qinf[1] >> 15) & 1); //m_n
-            frwd_advance(&magsgn, m_n);
-            val = ms_val << 31;
-            v_n = ms_val & ((1U << m_n) - 1);
-            v_n |= (((qinf[1] & 0x800) >> 11) << m_n);
-            v_n |= 1; //center of bin
-            sp[stride] = val | ((v_n + 2) << (p - 1));
-
-            //line_state: bit 7 (\sigma^NW), and E^NW for next quad
-            lsp[0] = (OPJ_UINT8)(0x80 | (32 - count_leading_zeros(v_n)));
-        } else if (locs & 0x80) {
-            sp[stride] = 0;
-        }
-
-        ++sp;
+        DECODE_QUAD_MAGSGN(&magsgn, qinf[1], U_q[1], p, locs >> 4, sp, stride,
+                           lsp);
+        lsp += 1;
+        sp += 2;
+    }
+    if (resume) {
+        set_sigma_from_samples(sigma1, decoded_data, width, stride,
+                               height > 1 ? 2 : 1, 0);
     }
 
     //non-initial lines
@@ -1786,11 +2207,9 @@ OPJ_BOOL opj_t1_ht_decode_cblk(opj_t1_t *t1,
         lsp[0] = 0;                     // and set it to zero
         sp = decoded_data + y * stride; // generated samples
         c_q = 0;                        // context
-        for (x = 0; x < width; x += 4) {
+        for (x = 0; x < width && !resume; x += 4) {
             OPJ_UINT32 U_q[2];
             OPJ_UINT32 uvlc_mode, consumed_bits;
-            OPJ_UINT32 m_n, v_n;
-            OPJ_UINT32 ms_val;
             OPJ_UINT32 locs;
 
             // decode vlc
@@ -1917,151 +2336,19 @@ OPJ_BOOL opj_t1_ht_decode_cblk(opj_t1_t *t1,
 
 
 
-            if (qinf[0] & 0x10) { //sigma_n
-                OPJ_UINT32 val;
-
-                ms_val = frwd_fetch(&magsgn);
-                m_n = U_q[0] - ((qinf[0] >> 12) & 1); //m_n
-                frwd_advance(&magsgn, m_n);
-                val = ms_val << 31;
-                v_n = ms_val & ((1U << m_n) - 1);
-                v_n |= ((qinf[0] & 0x100) >> 8) << m_n;
-                v_n |= 1; //center of bin
-                sp[0] = val | ((v_n + 2) << (p - 1));
-            } else if (locs & 0x1) {
-                sp[0] = 0;
-            }
-
-            if (qinf[0] & 0x20) { //sigma_n
-                OPJ_UINT32 val, t;
-
-                ms_val = frwd_fetch(&magsgn);
-                m_n = U_q[0] - ((qinf[0] >> 13) & 1); //m_n
-                frwd_advance(&magsgn, m_n);
-                val = ms_val << 31;
-                v_n = ms_val & ((1U << m_n) - 1);
-                v_n |= ((qinf[0] & 0x200) >> 9) << m_n;
-                v_n |= 1; //center of bin
-                sp[stride] = val | ((v_n + 2) << (p - 1));
-
-                //update line_state: bit 7 (\sigma^N), and E^N
-                t = lsp[0] & 0x7F;          //E^NW
-                v_n = 32 - count_leading_zeros(v_n);
-                lsp[0] = (OPJ_UINT8)(0x80 | (t > v_n ? t : v_n));
-            } else if (locs & 0x2) {
-                sp[stride] = 0;    //no need to update line_state
-            }
-
-            ++lsp;
-            ++sp;
-
-            if (qinf[0] & 0x40) { //sigma_n
-                OPJ_UINT32 val;
-
-                ms_val = frwd_fetch(&magsgn);
-                m_n = U_q[0] - ((qinf[0] >> 14) & 1); //m_n
-                frwd_advance(&magsgn, m_n);
-                val = ms_val << 31;
-                v_n = ms_val & ((1U << m_n) - 1);
-                v_n |= (((qinf[0] & 0x400) >> 10) << m_n);
-                v_n |= 1;                            //center of bin
-                sp[0] = val | ((v_n + 2) << (p - 1));
-            } else if (locs & 0x4) {
-                sp[0] = 0;
-            }
-
-            if (qinf[0] & 0x80) { //sigma_n
-                OPJ_UINT32 val;
-
-                ms_val = frwd_fetch(&magsgn);
-                m_n = U_q[0] - ((qinf[0] >> 15) & 1); //m_n
-                frwd_advance(&magsgn, m_n);
-                val = ms_val << 31;
-                v_n = ms_val & ((1U << m_n) - 1);
-                v_n |= ((qinf[0] & 0x800) >> 11) << m_n;
-                v_n |= 1; //center of bin
-                sp[stride] = val | ((v_n + 2) << (p - 1));
-
-                //update line_state: bit 7 (\sigma^NW), and E^NW for next quad
-                lsp[0] = (OPJ_UINT8)(0x80 | (32 - count_leading_zeros(v_n)));
-            } else if (locs & 0x8) {
-                sp[stride] = 0;
-            }
-
-            ++sp;
-
-            if (qinf[1] & 0x10) { //sigma_n
-                OPJ_UINT32 val;
-
-                ms_val = frwd_fetch(&magsgn);
-                m_n = U_q[1] - ((qinf[1] >> 12) & 1); //m_n
-                frwd_advance(&magsgn, m_n);
-                val = ms_val << 31;
-                v_n = ms_val & ((1U << m_n) - 1);
-                v_n |= (((qinf[1] & 0x100) >> 8) << m_n);
-                v_n |= 1;                            //center of bin
-                sp[0] = val | ((v_n + 2) << (p - 1));
-            } else if (locs & 0x10) {
-                sp[0] = 0;
-            }
-
-            if (qinf[1] & 0x20) { //sigma_n
-                OPJ_UINT32 val, t;
-
-                ms_val = frwd_fetch(&magsgn);
-                m_n = U_q[1] - ((qinf[1] >> 13) & 1); //m_n
-                frwd_advance(&magsgn, m_n);
-                val = ms_val << 31;
-                v_n = ms_val & ((1U << m_n) - 1);
-                v_n |= (((qinf[1] & 0x200) >> 9) << m_n);
-                v_n |= 1; //center of bin
-                sp[stride] = val | ((v_n + 2) << (p - 1));
-
-                //update line_state: bit 7 (\sigma^N), and E^N
-                t = lsp[0] & 0x7F;          //E^NW
-                v_n = 32 - count_leading_zeros(v_n);
-                lsp[0] = (OPJ_UINT8)(0x80 | (t > v_n ? t : v_n));
-            } else if (locs & 0x20) {
-                sp[stride] = 0;    //no need to update line_state
-            }
-
-            ++lsp;
-            ++sp;
-
-            if (qinf[1] & 0x40) { //sigma_n
-                OPJ_UINT32 val;
-
-                ms_val = frwd_fetch(&magsgn);
-                m_n = U_q[1] - ((qinf[1] >> 14) & 1); //m_n
-                frwd_advance(&magsgn, m_n);
-                val = ms_val << 31;
-                v_n = ms_val & ((1U << m_n) - 1);
-                v_n |= (((qinf[1] & 0x400) >> 10) << m_n);
-                v_n |= 1;                            //center of bin
-                sp[0] = val | ((v_n + 2) << (p - 1));
-            } else if (locs & 0x40) {
-                sp[0] = 0;
-            }
-
-            if (qinf[1] & 0x80) { //sigma_n
-                OPJ_UINT32 val;
-
-                ms_val = frwd_fetch(&magsgn);
-                m_n = U_q[1] - ((qinf[1] >> 15) & 1); //m_n
-                frwd_advance(&magsgn, m_n);
-                val = ms_val << 31;
-                v_n = ms_val & ((1U << m_n) - 1);
-                v_n |= (((qinf[1] & 0x800) >> 11) << m_n);
-                v_n |= 1; //center of bin
-                sp[stride] = val | ((v_n + 2) << (p - 1));
-
-                //update line_state: bit 7 (\sigma^NW), and E^NW for next quad
-                lsp[0] = (OPJ_UINT8)(0x80 | (32 - count_leading_zeros(v_n)));
-            } else if (locs & 0x80) {
-                sp[stride] = 0;
-            }
+            DECODE_QUAD_MAGSGN(&magsgn, qinf[0], U_q[0], p, locs & 0xF, sp,
+                               stride, lsp);
+            lsp += 1;
+            sp += 2;
 
-            ++sp;
+            DECODE_QUAD_MAGSGN(&magsgn, qinf[1], U_q[1], p, locs >> 4, sp,
+                               stride, lsp);
+            lsp += 1;
+            sp += 2;
+        }
+        if (resume) {
+            set_sigma_from_samples(sip, decoded_data + y * stride, width, stride,
+                                   y + 2 <= height ? 2 : 1, (OPJ_UINT32)(y & 2));
         }
 
         y += 2;
@@ -2073,7 +2360,6 @@ OPJ_BOOL opj_t1_ht_decode_cblk(opj_t1_t *t1,
                 OPJ_UINT32 *cur_sig = y & 0x4 ? sigma1 : sigma2;
                 // the address of the data that needs updating
                 OPJ_UINT32 *dpp = decoded_data + (y - 4) * stride;
-                OPJ_UINT32 half = 1u << (p - 2); // half the center of the bin
                 OPJ_INT32 i;
                 for (i = 0; i < width; i += 8) {
                     //Process one entry from sigma array at a time
@@ -2081,61 +2367,8 @@ OPJ_BOOL opj_t1_ht_decode_cblk(opj_t1_t *t1,
                     // and the 32 bits contain 8 columns
                     OPJ_UINT32 cwd = rev_fetch_mrp(&magref); // get 32 bit data
                     OPJ_UINT32 sig = *cur_sig++; // 32 bit that will be processed now
-                    OPJ_UINT32 col_mask = 0xFu;  // a mask for a column in sig
-                    OPJ_UINT32 *dp = dpp + i;    // next column in decode samples
                     if (sig) { // if any of the 32 bits are set
-                        int j;
-                        for (j = 0; j < 8; ++j, dp++) { //one column at a time
-                            if (sig & col_mask) { // lowest nibble
-                                OPJ_UINT32 sample_mask = 0x11111111u & col_mask; //LSB
-
-                                if (sig & sample_mask) { //if LSB is set
-                                    OPJ_UINT32 sym;
-
-                                    assert(dp[0] != 0); // decoded value cannot be zero
-                                    sym = cwd & 1; // get it value
-                                    // remove center of bin if sym is 0
-                                    dp[0] ^= (1 - sym) << (p - 1);
-                                    dp[0] |= half;      // put half the center of bin
-                                    cwd >>= 1;          //consume word
-                                }
-                                sample_mask += sample_mask; //next row
-
-                                if (sig & sample_mask) {
-                                    OPJ_UINT32 sym;
-
-                                    assert(dp[stride] != 0);
-                                    sym = cwd & 1;
-                                    dp[stride] ^= (1 - sym) << (p - 1);
-                                    dp[stride] |= half;
-                                    cwd >>= 1;
-                                }
-                                sample_mask += sample_mask;
-
-                                if (sig & sample_mask) {
-                                    OPJ_UINT32 sym;
-
-                                    assert(dp[2 * stride] != 0);
-                                    sym = cwd & 1;
-                                    dp[2 * stride] ^= (1 - sym) << (p - 1);
-                                    dp[2 * stride] |= half;
-                                    cwd >>= 1;
-                                }
-                                sample_mask += sample_mask;
-
-                                if (sig & sample_mask) {
-                                    OPJ_UINT32 sym;
-
-                                    assert(dp[3 * stride] != 0);
-                                    sym = cwd & 1;
-                                    dp[3 * stride] ^= (1 - sym) << (p - 1);
-                                    dp[3 * stride] |= half;
-                                    cwd >>= 1;
-                                }
-                                sample_mask += sample_mask;
-                            }
-                            col_mask <<= 4; //next column
-                        }
+                        DECODE_MRP_COLUMNS(dpp + i, stride, sig, cwd, p);
                     }
                     // consume data according to the number of bits set
                     rev_advance_mrp(&magref, population_count(sig));
@@ -2294,54 +2527,11 @@ OPJ_BOOL opj_t1_ht_decode_cblk(opj_t1_t *t1,
 
                             //obtain signs here
                             if (new_sig & (0xFFFFu << (4 * n))) { //if any
-                                OPJ_UINT32 col_mask;
-                                OPJ_INT32 j;
                                 OPJ_UINT32 *dp = decoded_data + (y - 8) * stride;
                                 dp += i + n; // decoded samples address
-                                col_mask = 0xFu << (4 * n); //mask to select a column
-
-                                for (j = n; j < end; ++j, ++dp, col_mask <<= 4) {
-                                    OPJ_UINT32 sample_mask;
-
-                                    if ((col_mask & new_sig) == 0) { //if non is significant
-                                        continue;
-                                    }
-
-                                    //scan 4 signs
-                                    sample_mask = 0x11111111u & col_mask;
-                                    if (new_sig & sample_mask) {
-                                        assert(dp[0] == 0);
-                                        dp[0] |= ((cwd & 1) << 31) | val; //put value and sign
-                                        cwd >>= 1;
-                                        ++cnt; //consume bit and increment number
-                                        //of consumed bits
-                                    }
-
-                                    sample_mask += sample_mask;
-                                    if (new_sig & sample_mask) {
-                                        assert(dp[stride] == 0);
-                                        dp[stride] |= ((cwd & 1) << 31) | val;
-                                        cwd >>= 1;
-                                        ++cnt;
-                                    }
-
-                                    sample_mask += sample_mask;
-                                    if (new_sig & sample_mask) {
-                                        assert(dp[2 * stride] == 0);
-                                        dp[2 * stride] |= ((cwd & 1) << 31) | val;
-                                        cwd >>= 1;
-                                        ++cnt;
-                                    }
-
-                                    sample_mask += sample_mask;
-                                    if (new_sig & sample_mask) {
-                                        assert(dp[3 * stride] == 0);
-                                        dp[3 * stride] |= ((cwd & 1) << 31) | val;
-                                        cwd >>= 1;
-                                        ++cnt;
-                                    }
-                                }
-
+                                cnt += DECODE_SPP_SIGNS(dp, stride,
+                                                        new_sig >> (4 * n),
+                                                        cwd, val);
                             }
                             frwd_advance(&sigprop, cnt); //consume the bits from bitstrm
                             cnt = 0;
@@ -2382,61 +2572,12 @@ OPJ_BOOL opj_t1_ht_decode_cblk(opj_t1_t *t1,
             //do magref
             OPJ_UINT32 *cur_sig = height & 0x4 ? sigma2 : sigma1; //reversed
             OPJ_UINT32 *dpp = decoded_data + (height & 0xFFFFFC) * stride;
-            OPJ_UINT32 half = 1u << (p - 2);
             OPJ_INT32 i;
             for (i = 0; i < width; i += 8) {
                 OPJ_UINT32 cwd = rev_fetch_mrp(&magref);
                 OPJ_UINT32 sig = *cur_sig++;
-                OPJ_UINT32 col_mask = 0xF;
-                OPJ_UINT32 *dp = dpp + i;
                 if (sig) {
-                    int j;
-                    for (j = 0; j < 8; ++j, dp++) {
-                        if (sig & col_mask) {
-                            OPJ_UINT32 sample_mask = 0x11111111 & col_mask;
-
-                            if (sig & sample_mask) {
-                                OPJ_UINT32 sym;
-                                assert(dp[0] != 0);
-                                sym = cwd & 1;
-                                dp[0] ^= (1 - sym) << (p - 1);
-                                dp[0] |= half;
-                                cwd >>= 1;
-                            }
-                            sample_mask += sample_mask;
-
-                            if (sig & sample_mask) {
-                                OPJ_UINT32 sym;
-                                assert(dp[stride] != 0);
-                                sym = cwd & 1;
-                                dp[stride] ^= (1 - sym) << (p - 1);
-                                dp[stride] |= half;
-                                cwd >>= 1;
-                            }
-                            sample_mask += sample_mask;
-
-                            if (sig & sample_mask) {
-                                OPJ_UINT32 sym;
-                                assert(dp[2 * stride] != 0);
-                                sym = cwd & 1;
-                                dp[2 * stride] ^= (1 - sym) << (p - 1);
-                                dp[2 * stride] |= half;
-                                cwd >>= 1;
-                            }
-                            sample_mask += sample_mask;
-
-                            if (sig & sample_mask) {
-                                OPJ_UINT32 sym;
-                                assert(dp[3 * stride] != 0);
-                                sym = cwd & 1;
-                                dp[3 * stride] ^= (1 - sym) << (p - 1);
-                                dp[3 * stride] |= half;
-                                cwd >>= 1;
-                            }
-                            sample_mask += sample_mask;
-                        }
-                        col_mask <<= 4;
-                    }
+                    DECODE_MRP_COLUMNS(dpp + i, stride, sig, cwd, p);
                 }
                 rev_advance_mrp(&magref, population_count(sig));
             }
@@ -2602,52 +2743,10 @@ OPJ_BOOL opj_t1_ht_decode_cblk(opj_t1_t *t1,
 
                         //signs here
                         if (new_sig & (0xFFFFu << (4 * n))) {
-                            OPJ_UINT32 col_mask;
-                            OPJ_INT32 j;
                             OPJ_UINT32 *dp = decoded_data + y * stride;
                             dp += i + n;
-                            col_mask = 0xFu << (4 * n);
-
-                            for (j = n; j < end; ++j, ++dp, col_mask <<= 4) {
-                                OPJ_UINT32 sample_mask;
-                                if ((col_mask & new_sig) == 0) {
-                                    continue;
-                                }
-
-                                //scan 4 signs
-                                sample_mask = 0x11111111u & col_mask;
-                                if (new_sig & sample_mask) {
-                                    assert(dp[0] == 0);
-                                    dp[0] |= ((cwd & 1) << 31) | val;
-                                    cwd >>= 1;
-                                    ++cnt;
-                                }
-
-                                sample_mask += sample_mask;
-                                if (new_sig & sample_mask) {
-                                    assert(dp[stride] == 0);
-                                    dp[stride] |= ((cwd & 1) << 31) | val;
-                                    cwd >>= 1;
-                                    ++cnt;
-                                }
-
-                                sample_mask += sample_mask;
-                                if (new_sig & sample_mask) {
-                                    assert(dp[2 * stride] == 0);
-                                    dp[2 * stride] |= ((cwd & 1) << 31) | val;
-                                    cwd >>= 1;
-                                    ++cnt;
-                                }
-
-                                sample_mask += sample_mask;
-                                if (new_sig & sample_mask) {
-                                    assert(dp[3 * stride] == 0);
-                                    dp[3 * stride] |= ((cwd & 1) << 31) | val;
-                                    cwd >>= 1;
-                                    ++cnt;
-                                }
-                            }
-
+                            cnt += DECODE_SPP_SIGNS(dp, stride, new_sig >> (4 * n),
+                                                    cwd, val);
                         }
                         frwd_advance(&sigprop, cnt);
                         cnt = 0;
@@ -2674,16 +2773,67 @@ OPJ_BOOL opj_t1_ht_decode_cblk(opj_t1_t *t1,
         }
     }
 
+    if (keep_dec_state && num_passes == 1) {
+        // save the output of the cleanup pass, from which the decoding is
+        // resumed when more passes are decoded
+        opj_tcd_cblk_dec_state_t* state = opj_t1_get_cblk_dec_state(cblk, 0);
+        if (state != NULL) {
+            state->numpasses = 1;
+            state->segno = 1;
+            state->passno = 0;
+            state->mqc.offset = lengths1;
+            memcpy(state->data, decoded_data,
+                   (size_t)width * (size_t)height * sizeof(OPJ_UINT32));
+        }
+    }
+
     {
-        OPJ_INT32 x, y;
+        OPJ_INT32 y;
         for (y = 0; y < height; ++y) {
-            OPJ_INT32* sp = (OPJ_INT32*)decoded_data + y * stride;
-            for (x = 0; x < width; ++x, ++sp) {
-                OPJ_INT32 val = (*sp & 0x7FFFFFFF);
-                *sp = ((OPJ_UINT32) * sp & 0x80000000) ? -val : val;
-            }
+            CONVERT_ROW_TO_TWOS_COMPLEMENT((OPJ_INT32*)decoded_data + y * stride,
+                                           width);
         }
     }
 
     return OPJ_TRUE;
 }
+
+#ifdef OPJ_HT_DEC_AVX2
+
+OPJ_BOOL opj_t1_ht_decode_cblk_avx2(opj_t1_t *t1,
+                                    opj_tcd_cblk_dec_t* cblk,
+                                    OPJ_UINT32 orient,
+                                    OPJ_UINT32 roishift,
+                                    OPJ_UINT32 cblksty,
+                                    opj_event_mgr_t *p_manager,
+                                    opj_mutex_t* p_manager_mutex,
+                                    OPJ_BOOL check_pterm)
+{
+    return ht_decode_cblk(t1, cblk, orient, roishift, cblksty, p_manager,
+                          p_manager_mutex, check_pterm);
+}
+
+#else
+
+OPJ_BOOL opj_t1_ht_decode_cblk(opj_t1_t *t1,
+                               opj_tcd_cblk_dec_t* cblk,
+                               OPJ_UINT32 orient,
+                               OPJ_UINT32 roishift,
+                               OPJ_UINT32 cblksty,
+                               opj_event_mgr_t *p_manager,
+                               opj_mutex_t* p_manager_mutex,
+                               OPJ_BOOL check_pterm)
+{
+#ifdef OPJ_HAVE_AVX2_KERNELS
+    // the AVX2 build of this file, see ht_dec_avx2.c
+    if (opj_cpu_get_simd_level() >= OPJ_SIMD_AVX2) {
+        return opj_t1_ht_decode_cblk_avx2(t1, cblk, orient, roishift, cblksty,
+                                          p_manager, p_manager_mutex,
+                                          check_pterm);
+    }
+#endif
+    return ht_decode_cblk(t1, cblk, orient, roishift, cblksty, p_manager,
+                          p_manager_mutex, check_pterm);
+}
+
+#endif /* OPJ_HT_DEC_AVX2 */
@@ -0,0 +1,574 @@
+/*
+ * The copyright in this software is being made available under the 2-clauses
+ * BSD License, included below. This software may be subject to other third
+ * party and contributor rights, including patent rights, and no such rights
+ * are granted under this license.
+ *
+ * Copyright (c) 2026, OpenJPEG contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS `AS IS'
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @file ht_enc.c
+ *  @brief implements the HTJ2K block encoder (cleanup pass only)
+ *
+ *  The bitstream produced here is the exact counterpart of the one read by
+ *  opj_t1_ht_decode_cblk() in ht_dec.c: the MagSgn stream grows forward
+ *  from the start of the code-block, the MEL stream follows it, and the
+ *  VLC stream grows backward from the end of the code-block, its last 12
+ *  bits holding the combined length of the MEL and VLC streams (Scup).
+ */
+
+#include "opj_includes.h"
+
+#include "t1_ht_enc_luts.h"
+
+/** Largest code-block width: 1024 samples, that is 512 quads */
+#define HT_ENC_MAX_QUADS 512
+
+/** Size of the buffer collecting the MEL bitstream */
+#define HT_ENC_MEL_SIZE 1024
+
+/** Size of the buffer collecting the VLC bitstream */
+#define HT_ENC_VLC_SIZE 4096
+
+/** Largest value of Scup allowed by the standard */
+#define HT_ENC_MAX_SCUP 4079
+
+/* ----------------------------------------------------------------------- */
+
+/** @brief State structure of the MEL encoder
+  *
+  *  MEL encodes runs of zero events with an adaptive run-length code;
+  *  it is used for quads in the zero context and, in the initial line
+  *  of quads, for the u values of quad pairs.
+  */
+typedef struct enc_mel {
+    OPJ_UINT8* buf;         //!<destination buffer
+    OPJ_UINT32 pos;         //!<number of bytes written to buf
+    OPJ_UINT32 size;        //!<size of buf
+    OPJ_BOOL   overflow;    //!<OPJ_TRUE if buf was too small
+    int remaining_bits;     //!<number of bits that can still go into tmp
+    int tmp;                //!<byte being assembled
+    int run;                //!<number of zero events in the current run
+    int k;                  //!<state of the MEL coder, 0 to 12
+    int threshold;          //!<run length that ends the current run
+} enc_mel_t;
+
+/** @brief State structure of the VLC encoder, growing backward
+  */
+typedef struct enc_vlc {
+    OPJ_UINT8* buf;         //!<last byte of the destination buffer
+    OPJ_UINT32 pos;         //!<number of bytes written backward from buf
+    OPJ_UINT32 size;        //!<size of the destination buffer
+    OPJ_BOOL   overflow;    //!<OPJ_TRUE if the buffer was too small
+    int used_bits;          //!<number of bits already in tmp
+    int tmp;                //!<byte being assembled
+    OPJ_BOOL last_greater_than_8F; //!<OPJ_TRUE if last byte was > 0x8F
+} enc_vlc_t;
+
+/** @brief State structure of the MagSgn encoder
+  */
+typedef struct enc_ms {
+    OPJ_UINT8* buf;         //!<destination buffer
+    OPJ_UINT32 pos;         //!<number of bytes written to buf
+    OPJ_UINT32 size;        //!<size of buf
+    OPJ_BOOL   overflow;    //!<OPJ_TRUE if buf was too small
+    int max_bits;           //!<7 after a 0xFF byte, 8 otherwise
+    int used_bits;          //!<number of bits already in tmp
+    OPJ_UINT32 tmp;         //!<byte being assembled
+} enc_ms_t;
+
+/* ----------------------------------------------------------------------- */
+
+/** @brief Initializes the MEL encoder */
+static void mel_enc_init(enc_mel_t* melp, OPJ_UINT8* buf, OPJ_UINT32 size)
+{
+    melp->buf = buf;
+    melp->pos = 0;
+    melp->size = size;
+    melp->overflow = OPJ_FALSE;
+    melp->remaining_bits = 8;
+    melp->tmp = 0;
+    melp->run = 0;
+    melp->k = 0;
+    melp->threshold = 1; // 1 << mel_exp[0]
+}
+
+/** @brief Emits one bit to the MEL bitstream, with bit-stuffing after 0xFF */
+static INLINE void mel_emit_bit(enc_mel_t* melp, int v)
+{
+    melp->tmp = (melp->tmp << 1) + v;
+    melp->remaining_bits--;
+    if (melp->remaining_bits == 0) {
+        if (melp->pos >= melp->size) {
+            melp->overflow = OPJ_TRUE;
+        } else {
+            melp->buf[melp->pos++] = (OPJ_UINT8)melp->tmp;
+        }
+        melp->remaining_bits = (melp->tmp == 0xFF ? 7 : 8);
+        melp->tmp = 0;
+    }
+}
+
+/** @brief Encodes one MEL event
+  *
+  *  @param [in]  melp is the MEL encoder state
+  *  @param [in]  bit is the event: OPJ_TRUE (significant) ends the run
+  */
+static INLINE void mel_encode(enc_mel_t* melp, OPJ_BOOL bit)
+{
+    static const int mel_exp[13] = {0, 0, 0, 1, 1, 1, 2, 2, 2, 3, 3, 4, 5};
+
+    if (!bit) {
+        if (++melp->run >= melp->threshold) {
+            mel_emit_bit(melp, 1);
+            melp->run = 0;
+            melp->k = opj_int_min(12, melp->k + 1);
+            melp->threshold = 1 << mel_exp[melp->k];
+        }
+    } else {
+        int t = mel_exp[melp->k];
+        mel_emit_bit(melp, 0);
+        while (t > 0) {
+            --t;
+            mel_emit_bit(melp, (melp->run >> t) & 1);
+        }
+        melp->run = 0;
+        melp->k = opj_int_max(0, melp->k - 1);
+        melp->threshold = 1 << mel_exp[melp->k];
+    }
+}
+
+/** @brief Initializes the VLC encoder
+  *
+  *  The last byte of the buffer is reserved for Scup, and the low nibble
+  *  of the byte before it too; these are filled by the caller at the end.
+  */
+static void vlc_enc_init(enc_vlc_t* vlcp, OPJ_UINT8* buf, OPJ_UINT32 size)
+{
+    vlcp->buf = buf + size - 1;
+    vlcp->buf[0] = 0xFF;
+    vlcp->pos = 1;
+    vlcp->size = size;
+    vlcp->overflow = OPJ_FALSE;
+    vlcp->used_bits = 4;
+    vlcp->tmp = 0xF;
+    vlcp->last_greater_than_8F = OPJ_TRUE;
+}
+
+/** @brief Emits a codeword to the VLC bitstream, LSB first
+  *
+  *  A byte following (in the backward direction) a byte larger than 0x8F
+  *  carries 7 bits only if its 7 LSBs are all ones.
+  */
+static INLINE void vlc_encode(enc_vlc_t* vlcp, int cwd, int cwd_len)
+{
+    while (cwd_len > 0) {
+        int avail_bits = 8 - (vlcp->last_greater_than_8F ? 1 : 0) -
+                         vlcp->used_bits;
+        int t = opj_int_min(avail_bits, cwd_len);
+        vlcp->tmp |= (cwd & ((1 << t) - 1)) << vlcp->used_bits;
+        vlcp->used_bits += t;
+        avail_bits -= t;
+        cwd_len -= t;
+        cwd >>= t;
+        if (avail_bits == 0) {
+            if (vlcp->last_greater_than_8F && vlcp->tmp != 0x7F) {
+                vlcp->last_greater_than_8F = OPJ_FALSE;
+                continue; // one more bit is available in this byte
+            }
+            if (vlcp->pos >= vlcp->size) {
+                vlcp->overflow = OPJ_TRUE;
+            } else {
+                *(vlcp->buf - vlcp->pos) = (OPJ_UINT8)vlcp->tmp;
+                vlcp->pos++;
+            }
+            vlcp->last_greater_than_8F = vlcp->tmp > 0x8F;
+            vlcp->tmp = 0;
+            vlcp->used_bits = 0;
+        }
+    }
+}
+
+/** @brief Terminates the MEL and VLC bitstreams
+  *
+  *  When possible, the last MEL byte and the last VLC byte are fused into
+  *  one byte, since they meet in the middle.
+  */
+static void mel_vlc_terminate(enc_mel_t* melp, enc_vlc_t* vlcp)
+{
+    int mel_mask, vlc_mask, fuse;
+
+    if (melp->run > 0) {
+        mel_emit_bit(melp, 1);
+    }
+
+    melp->tmp = melp->tmp << melp->remaining_bits;
+    mel_mask = (0xFF << melp->remaining_bits) & 0xFF;
+    vlc_mask = 0xFF >> (8 - vlcp->used_bits);
+    if ((mel_mask | vlc_mask) == 0) {
+        return; // the last MEL byte cannot be 0xFF
+    }
+
+    fuse = melp->tmp | vlcp->tmp;
+    if ((((fuse ^ melp->tmp) & mel_mask) |
+            ((fuse ^ vlcp->tmp) & vlc_mask)) == 0 &&
+            fuse != 0xFF && vlcp->pos > 1) {
+        if (melp->pos >= melp->size) {
+            melp->overflow = OPJ_TRUE;
+        } else {
+            melp->buf[melp->pos++] = (OPJ_UINT8)fuse;
+        }
+    } else {
+        if (melp->pos >= melp->size || vlcp->pos >= vlcp->size) {
+            melp->overflow = OPJ_TRUE;
+        } else {
+            melp->buf[melp->pos++] = (OPJ_UINT8)melp->tmp;
+            *(vlcp->buf - vlcp->pos) = (OPJ_UINT8)vlcp->tmp;
+            vlcp->pos++;
+        }
+    }
+}
+
+/** @brief Initializes the MagSgn encoder */
+static void ms_enc_init(enc_ms_t* msp, OPJ_UINT8* buf, OPJ_UINT32 size)
+{
+    msp->buf = buf;
+    msp->pos = 0;
+    msp->size = size;
+    msp->overflow = OPJ_FALSE;
+    msp->max_bits = 8;
+    msp->used_bits = 0;
+    msp->tmp = 0;
+}
+
+/** @brief Emits cwd_len bits of cwd to the MagSgn bitstream, LSB first */
+static INLINE void ms_encode(enc_ms_t* msp, OPJ_UINT32 cwd, int cwd_len)
+{
+    while (cwd_len > 0) {
+        int t = opj_int_min(msp->max_bits - msp->used_bits, cwd_len);
+        msp->tmp |= (cwd & ((1U << t) - 1)) << msp->used_bits;
+        msp->used_bits += t;
+        cwd >>= t;
+        cwd_len -= t;
+        if (msp->used_bits >= msp->max_bits) {
+            if (msp->pos >= msp->size) {
+                msp->overflow = OPJ_TRUE;
+            } else {
+                msp->buf[msp->pos++] = (OPJ_UINT8)msp->tmp;
+            }
+            msp->max_bits = (msp->tmp == 0xFF) ? 7 : 8;
+            msp->tmp = 0;
+            msp->used_bits = 0;
+        }
+    }
+}
+
+/** @brief Terminates the MagSgn bitstream
+  *
+  *  The last byte is padded with ones, which is what the decoder feeds
+  *  past the end of the stream; a trailing 0xFF is therefore dropped.
+  */
+static void ms_terminate(enc_ms_t* msp)
+{
+    if (msp->used_bits) {
+        int t = msp->max_bits - msp->used_bits;
+        msp->tmp |= (0xFFU & ((1U << t) - 1)) << msp->used_bits;
+        if (msp->tmp != 0xFF) {
+            if (msp->pos >= msp->size) {
+                msp->overflow = OPJ_TRUE;
+            } else {
+                msp->buf[msp->pos++] = (OPJ_UINT8)msp->tmp;
+            }
+        }
+    } else if (msp->max_bits == 7) {
+        msp->pos--;
+    }
+}
+
+/** @brief Emits the prefix of the UVLC codeword of u, u >= 1 */
+static INLINE void uvlc_encode_prefix(enc_vlc_t* vlcp, OPJ_UINT32 u)
+{
+    if (u == 1) {
+        vlc_encode(vlcp, 1, 1);
+    } else if (u == 2) {
+        vlc_encode(vlcp, 2, 2);
+    } else if (u <= 4) {
+        vlc_encode(vlcp, 4, 3);
+    } else {
+        vlc_encode(vlcp, 0, 3);
+    }
+}
+
+/** @brief Emits the suffix of the UVLC codeword of u, u >= 1 */
+static INLINE void uvlc_encode_suffix(enc_vlc_t* vlcp, OPJ_UINT32 u)
+{
+    if (u >= 5) {
+        vlc_encode(vlcp, (int)(u - 5), 5);
+    } else if (u >= 3) {
+        vlc_encode(vlcp, (int)(u - 3), 1);
+    }
+}
+
+/** @brief Returns the number of set bits in the 4 LSBs of val */
+static INLINE OPJ_UINT32 popcount4(OPJ_UINT32 val)
+{
+    return (val & 1) + ((val >> 1) & 1) + ((val >> 2) & 1) + ((val >> 3) & 1);
+}
+
+/* ----------------------------------------------------------------------- */
+
+/**
+Encode 1 HT code-block with a single cleanup pass
+@param t1 T1 handle
+@param bpno Bit-plane of the cleanup pass
+@param dest Buffer receiving the cleanup segment
+@param dest_size Size of dest
+@param p_len Receives the length of the cleanup segment
+*/
+OPJ_BOOL opj_t1_ht_encode_cblk(opj_t1_t *t1,
+                               OPJ_UINT32 bpno,
+                               OPJ_BYTE* dest,
+                               OPJ_UINT32 dest_size,
+                               OPJ_UINT32* p_len);
+
+//************************************************************************/
+/** @brief Encodes one codeblock with a single cleanup pass
+  *
+  *  The samples are the signed quantization indices held in t1->data, in
+  *  raster order, whose magnitudes must be lower than 2^30.  The cleanup
+  *  pass codes them from bit-plane bpno: the bpno least significant bits
+  *  of the magnitudes are dropped.  At least one sample must be
+  *  significant at that bit-plane.
+  *
+  *  @param [in]  t1 is codeblock coefficients storage
+  *  @param [in]  bpno is the bit-plane of the cleanup pass
+  *  @param [out] dest receives the cleanup segment
+  *  @param [in]  dest_size is the size of dest
+  *  @param [out] p_len receives the length of the cleanup segment
+  *  @return OPJ_FALSE if the coded data do not fit in dest or in the
+  *          limits set by the standard
+  */
+OPJ_BOOL opj_t1_ht_encode_cblk(opj_t1_t *t1,
+                               OPJ_UINT32 bpno,
+                               OPJ_BYTE* dest,
+                               OPJ_UINT32 dest_size,
+                               OPJ_UINT32* p_len)
+{
+    const OPJ_UINT32 width = t1->w;
+    const OPJ_UINT32 height = t1->h;
+    const OPJ_INT32* data = t1->data;
+    OPJ_UINT8 mel_buf[HT_ENC_MEL_SIZE];
+    OPJ_UINT8 vlc_buf[HT_ENC_VLC_SIZE];
+    // line states: bit 7 is the significance of the bottom samples of the
+    // quad row above at columns 2k-1 and 2k, the 7 LSBs their max exponent
+    OPJ_UINT8 line_state[2][HT_ENC_MAX_QUADS + 2];
+    OPJ_UINT8 *prev_ls, *cur_ls;
+    enc_mel_t mel;
+    enc_vlc_t vlc;
+    enc_ms_t ms;
+    OPJ_UINT32 x, y, i, n;
+    OPJ_UINT32 lcup, scup;
+
+    if (width > 2 * HT_ENC_MAX_QUADS) {
+        return OPJ_FALSE;
+    }
+
+    mel_enc_init(&mel, mel_buf, HT_ENC_MEL_SIZE);
+    vlc_enc_init(&vlc, vlc_buf, HT_ENC_VLC_SIZE);
+    ms_enc_init(&ms, dest, dest_size);
+
+    memset(line_state, 0, sizeof(line_state));
+    prev_ls = line_state[0];
+    cur_ls = line_state[1];
+
+    for (y = 0; y < height; y += 2) {
+        const OPJ_BOOL initial = (y == 0);
+        OPJ_UINT32 c_q = 0;
+
+        memset(cur_ls, 0, HT_ENC_MAX_QUADS + 2);
+
+        for (x = 0; x < width; x += 4) {
+            OPJ_UINT32 v[2][4], e[2][4];
+            OPJ_UINT32 rho[2], e_qmax[2], U_q[2], u_q[2], e_k[2];
+            const OPJ_UINT32 nquads = (x + 2 < width) ? 2 : 1;
+
+            // gather the samples of the quad pair; sample n of a quad is
+            // at row (n & 1) and column (n >> 1) within the quad
+            for (i = 0; i < 2; ++i) {
+                rho[i] = e_qmax[i] = 0;
+                for (n = 0; n < 4; ++n) {
+                    const OPJ_UINT32 col = x + 2 * i + (n >> 1);
+                    const OPJ_UINT32 row = y + (n & 1);
+                    OPJ_INT32 val;
+                    OPJ_UINT32 mu;
+
+                    v[i][n] = e[i][n] = 0;
+                    if (i >= nquads || col >= width || row >= height) {
+                        continue;
+                    }
+                    val = data[row * width + col];
+                    if (val == 0) {
+                        continue;
+                    }
+                    mu = (OPJ_UINT32)(val < 0 ? -val : val) >> bpno;
+                    if (mu == 0) {
+                        continue;
+                    }
+                    rho[i] |= 1U << n;
+                    v[i][n] = 2 * (mu - 1) + (val < 0 ? 1U : 0U);
+                    e[i][n] = opj_uint_floorlog2(2 * mu - 1) + 1;
+                    e_qmax[i] = opj_uint_max(e_qmax[i], e[i][n]);
+
+                    // update the line state for the next row of quads
+                    if (n & 1) {
+                        const OPJ_UINT32 k = (col + 1) >> 1;
+                        cur_ls[k] = (OPJ_UINT8)(0x80 | opj_uint_max(
+                                                    cur_ls[k] & 0x7FU, e[i][n]));
+                    }
+                }
+            }
+
+            // VLC codewords (and MEL events in the zero context)
+            for (i = 0; i < nquads; ++i) {
+                const OPJ_UINT32 q = (x >> 1) + i;
+                OPJ_UINT32 kappa = 1;
+                OPJ_UINT32 emb = 0;
+
+                if (!initial) {
+                    // c_q holds sigma^W | sigma^SW
+                    c_q |= prev_ls[q] >> 7;
+                    c_q |= (prev_ls[q + 1] >> 5) & 0x4;
+                    if (popcount4(rho[i]) > 1) {
+                        OPJ_UINT32 E = opj_uint_max(prev_ls[q] & 0x7FU,
+                                                    prev_ls[q + 1] & 0x7FU);
+                        kappa = E > 2 ? E - 1 : 1;
+                    }
+                }
+
+                U_q[i] = u_q[i] = e_k[i] = 0;
+                if (rho[i]) {
+                    U_q[i] = opj_uint_max(e_qmax[i], kappa);
+                    u_q[i] = U_q[i] - kappa;
+                    if (u_q[i] > 0) {
+                        for (n = 0; n < 4; ++n) {
+                            emb |= (e[i][n] == U_q[i] ? 1U : 0U) << n;
+                        }
+                    }
+                }
+
+                if (c_q == 0) {
+                    mel_encode(&mel, rho[i] != 0);
+                }
+                if (c_q != 0 || rho[i] != 0) {
+                    const OPJ_UINT16* tbl = initial ? vlc_enc_tbl0 : vlc_enc_tbl1;
+                    const OPJ_UINT32 entry = tbl[(c_q << 8) | (rho[i] << 4) | emb];
+                    assert(entry != 0);
+                    vlc_encode(&vlc, (int)(entry >> 8), (int)((entry >> 4) & 0xF));
+                    e_k[i] = entry & 0xF;
+                }
+
+                // context of the next quad
+                if (initial) {
+                    c_q = (rho[i] & 1) | (rho[i] >> 1);
+                } else {
+                    c_q = ((rho[i] >> 1) | (rho[i] >> 2)) & 0x2;
+                }
+            }
+
+            // u values
+            if (nquads == 2 && u_q[0] > 0 && u_q[1] > 0) {
+                if (initial) {
+                    const OPJ_BOOL both_gt_2 = u_q[0] > 2 && u_q[1] > 2;
+                    mel_encode(&mel, both_gt_2);
+                    if (both_gt_2) {
+                        uvlc_encode_prefix(&vlc, u_q[0] - 2);
+                        uvlc_encode_prefix(&vlc, u_q[1] - 2);
+                        uvlc_encode_suffix(&vlc, u_q[0] - 2);
+                        uvlc_encode_suffix(&vlc, u_q[1] - 2);
+                    } else if (u_q[0] > 2) {
+                        uvlc_encode_prefix(&vlc, u_q[0]);
+                        vlc_encode(&vlc, (int)(u_q[1] - 1), 1);
+                        uvlc_encode_suffix(&vlc, u_q[0]);
+                    } else {
+                        uvlc_encode_prefix(&vlc, u_q[0]);
+                        uvlc_encode_prefix(&vlc, u_q[1]);
+                        uvlc_encode_suffix(&vlc, u_q[0]);
+                        uvlc_encode_suffix(&vlc, u_q[1]);
+                    }
+                } else {
+                    uvlc_encode_prefix(&vlc, u_q[0]);
+                    uvlc_encode_prefix(&vlc, u_q[1]);
+                    uvlc_encode_suffix(&vlc, u_q[0]);
+                    uvlc_encode_suffix(&vlc, u_q[1]);
+                }
+            } else {
+                for (i = 0; i < nquads; ++i) {
+                    if (u_q[i] > 0) {
+                        uvlc_encode_prefix(&vlc, u_q[i]);
+                        uvlc_encode_suffix(&vlc, u_q[i]);
+                    }
+                }
+            }
+
+            // magnitudes and signs; the decoder infers the MSB of the
+            // samples flagged in e_k
+            for (i = 0; i < nquads; ++i) {
+                for (n = 0; n < 4; ++n) {
+                    if (rho[i] & (1U << n)) {
+                        const OPJ_UINT32 m = U_q[i] - ((e_k[i] >> n) & 1);
+                        ms_encode(&ms, v[i][n] & ((1U << m) - 1), (int)m);
+                    }
+                }
+            }
+        }
+
+        // swap line states
+        {
+            OPJ_UINT8* tmp = prev_ls;
+            prev_ls = cur_ls;
+            cur_ls = tmp;
+        }
+    }
+
+    mel_vlc_terminate(&mel, &vlc);
+    ms_terminate(&ms);
+
+    scup = mel.pos + vlc.pos;
+    lcup = ms.pos + scup;
+    if (mel.overflow || vlc.overflow || ms.overflow ||
+            scup > HT_ENC_MAX_SCUP || lcup > dest_size) {
+        return OPJ_FALSE;
+    }
+
+    memcpy(dest + ms.pos, mel_buf, mel.pos);
+    memcpy(dest + ms.pos + mel.pos, vlc.buf - vlc.pos + 1, vlc.pos);
+
+    // Scup goes in the last byte and in the low nibble of the one before
+    dest[lcup - 1] = (OPJ_UINT8)(scup >> 4);
+    dest[lcup - 2] = (OPJ_UINT8)((dest[lcup - 2] & 0xF0) | (scup & 0xF));
+
+    *p_len = lcup;
+    return OPJ_TRUE;
+}
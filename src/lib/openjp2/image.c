@@ -261,3 +261,97 @@ opj_image_t* OPJ_CALLCONV opj_image_tile_create(OPJ_UINT32 numcmpts,
 
     return image;
 }
+
+OPJ_SIZE_T opj_image_sample_size(OPJ_SAMPLE_TYPE p_type)
+{
+    switch (p_type) {
+    case OPJ_SAMPLE_U8:
+        return sizeof(OPJ_BYTE);
+    case OPJ_SAMPLE_U16:
+        return sizeof(OPJ_UINT16);
+    case OPJ_SAMPLE_I16:
+        return sizeof(OPJ_INT16);
+    case OPJ_SAMPLE_F32:
+        return sizeof(OPJ_FLOAT32);
+    default:
+        return 0;
+    }
+}
+
+void opj_image_comp_pack(const opj_image_comp_t* p_comp,
+                         OPJ_SAMPLE_TYPE p_type,
+                         void* p_dest,
+                         OPJ_SIZE_T p_sample_stride,
+                         OPJ_SIZE_T p_row_stride)
+{
+    const OPJ_INT32* l_src = p_comp->data;
+    OPJ_UINT32 l_prec = opj_uint_min(opj_uint_max(p_comp->prec, 1U), 31U);
+    OPJ_INT32 l_min, l_max, l_offset = 0;
+    OPJ_UINT32 l_shift = 0;
+    OPJ_UINT32 x, y;
+
+    if (p_comp->sgnd) {
+        l_min = (OPJ_INT32)(-(OPJ_INT64)(1U << (l_prec - 1U)));
+        l_max = (OPJ_INT32)((1U << (l_prec - 1U)) - 1U);
+    } else {
+        l_min = 0;
+        l_max = (OPJ_INT32)((1U << l_prec) - 1U);
+    }
+
+    /* Offset and shift that bring the clamped samples into the destination */
+    /* range */
+    switch (p_type) {
+    case OPJ_SAMPLE_U8:
+    case OPJ_SAMPLE_U16:
+        if (p_comp->sgnd) {
+            l_offset = (OPJ_INT32)(1U << (l_prec - 1U));
+        }
+        l_shift = l_prec - opj_uint_min(l_prec, p_type == OPJ_SAMPLE_U8 ? 8U : 16U);
+        break;
+    case OPJ_SAMPLE_I16:
+        l_shift = l_prec - opj_uint_min(l_prec, p_comp->sgnd ? 16U : 15U);
+        break;
+    default:
+        break;
+    }
+
+    for (y = 0; y < p_comp->h; ++y) {
+        OPJ_BYTE* l_dest = (OPJ_BYTE*)p_dest + y * p_row_stride;
+
+        switch (p_type) {
+        case OPJ_SAMPLE_U8:
+            for (x = 0; x < p_comp->w; ++x) {
+                OPJ_INT32 l_value = opj_int_clamp(*l_src++, l_min, l_max);
+                *l_dest = (OPJ_BYTE)((l_value + l_offset) >> l_shift);
+                l_dest += p_sample_stride;
+            }
+            break;
+        case OPJ_SAMPLE_U16:
+            for (x = 0; x < p_comp->w; ++x) {
+                OPJ_INT32 l_value = opj_int_clamp(*l_src++, l_min, l_max);
+                OPJ_UINT16 l_sample = (OPJ_UINT16)((l_value + l_offset) >> l_shift);
+                memcpy(l_dest, &l_sample, sizeof(l_sample));
+                l_dest += p_sample_stride;
+            }
+            break;
+        case OPJ_SAMPLE_I16:
+            for (x = 0; x < p_comp->w; ++x) {
+                OPJ_INT32 l_value = opj_int_clamp(*l_src++, l_min, l_max);
+                OPJ_INT16 l_sample = (OPJ_INT16)(l_value >> l_shift);
+                memcpy(l_dest, &l_sample, sizeof(l_sample));
+                l_dest += p_sample_stride;
+            }
+            break;
+        case OPJ_SAMPLE_F32:
+            for (x = 0; x < p_comp->w; ++x) {
+                OPJ_FLOAT32 l_sample = (OPJ_FLOAT32)opj_int_clamp(*l_src++, l_min,
+                                       l_max);
+                memcpy(l_dest, &l_sample, sizeof(l_sample));
+                l_dest += p_sample_stride;
+            }
+            break;
+        default:
+            return;
+        }
+    }
+}
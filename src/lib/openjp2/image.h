@@ -64,6 +64,27 @@ void opj_image_comp_header_update(opj_image_t * p_image,
 void opj_copy_image_header(const opj_image_t* p_image_src,
                            opj_image_t* p_image_dest);
 
+/**
+ * Returns the size in bytes of a sample of the given type, or 0 if the type
+ * is unknown.
+ */
+OPJ_SIZE_T opj_image_sample_size(OPJ_SAMPLE_TYPE p_type);
+
+/**
+ * Converts the samples of a component to a packed sample type, with the
+ * rules documented in opj_decode_rows().
+ * @param p_comp            the component, whose data has w * h samples.
+ * @param p_type            type of the destination samples.
+ * @param p_dest            destination of the first sample.
+ * @param p_sample_stride   number of bytes between two samples of a row.
+ * @param p_row_stride      number of bytes between two rows.
+ */
+void opj_image_comp_pack(const opj_image_comp_t* p_comp,
+                         OPJ_SAMPLE_TYPE p_type,
+                         void* p_dest,
+                         OPJ_SIZE_T p_sample_stride,
+                         OPJ_SIZE_T p_row_stride);
+
 /*@}*/
 
 #endif /* OPJ_IMAGE_H */
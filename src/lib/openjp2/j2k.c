@@ -211,6 +211,15 @@ static void opj_j2k_tcp_destroy(opj_tcp_t *p_tcp);
  */
 static void opj_j2k_tcp_data_destroy(opj_tcp_t *p_tcp);
 
+/**
+ * Gives the packet lengths of a tile to the tile decoder, if they are valid.
+ *
+ * @param       p_tcd           the tile decoder.
+ * @param       p_tcp           the tile coding parameters.
+ */
+static void opj_j2k_set_tcd_packet_lengths(opj_tcd_t *p_tcd,
+        const opj_tcp_t *p_tcp);
+
 /**
  * Destroys a coding parameter structure.
  *
@@ -325,7 +334,21 @@ static OPJ_BOOL opj_j2k_write_SQcd_SQcc(opj_j2k_t *p_j2k,
 /**
  * Updates the Tile Length Marker.
  */
-static void opj_j2k_update_tlm(opj_j2k_t * p_j2k, OPJ_UINT32 p_tile_part_size);
+static void opj_j2k_update_tlm(opj_j2k_t * p_j2k, OPJ_UINT32 p_tile_no,
+                               OPJ_UINT32 p_tile_part_size);
+
+/**
+ * Updates the Tile Length Marker with the tile-parts of an encoded tile.
+ *
+ * @param       p_j2k           J2K codec.
+ * @param       p_tile_no       index of the tile.
+ * @param       p_data          tile-parts of the tile, as written by opj_j2k_write_tile_parts().
+ * @param       p_data_size     size of p_data.
+ */
+static void opj_j2k_update_tlm_with_tile_parts(opj_j2k_t * p_j2k,
+        OPJ_UINT32 p_tile_no,
+        const OPJ_BYTE * p_data,
+        OPJ_UINT32 p_data_size);
 
 /**
  * Reads a SQcd or SQcc element, i.e. the quantization values of a band in the QCD or QCC.
@@ -364,14 +387,76 @@ static OPJ_BOOL opj_j2k_decode_tiles(opj_j2k_t *p_j2k,
                                      opj_stream_private_t *p_stream,
                                      opj_event_mgr_t * p_manager);
 
+/**
+ * Reads the tiles, and decodes up to m_max_tiles_in_flight of them
+ * concurrently in the thread pool.
+ *
+ * @param       p_j2k           the jpeg2000 codec.
+ * @param       p_end_pos       position of the end of the last tile-part when
+ *                              tile-parts are accessed through the TLM index.
+ * @param       p_stream        the stream to read data from.
+ * @param       p_manager       the user event manager.
+ */
+static OPJ_BOOL opj_j2k_decode_tiles_parallel(opj_j2k_t *p_j2k,
+        OPJ_OFF_T p_end_pos,
+        opj_stream_private_t *p_stream,
+        opj_event_mgr_t * p_manager);
+
+/**
+ * Creates the code-block cache if the CODEBLOCK_CACHE_SIZE option is set,
+ * and attaches it to the tile decoder of a single-tiled image. Also makes
+ * that tile decoder keep its decoding state if the image may be refined
+ * later.
+ *
+ * @param       p_j2k           the jpeg2000 codec.
+ * @param       p_manager       the user event manager.
+ */
+static OPJ_BOOL opj_j2k_setup_cblk_cache(opj_j2k_t *p_j2k,
+        opj_event_mgr_t * p_manager);
+
+/**
+ * Checks that an image is not decoded again with the PROGRESSIVE_REFINEMENT
+ * option unless it is made of a single tile, as the tiles of a multi-tiled
+ * image are not kept once decoded.
+ *
+ * @param       p_j2k           the jpeg2000 codec.
+ * @param       p_manager       the user event manager.
+ */
+static OPJ_BOOL opj_j2k_check_refinement(opj_j2k_t *p_j2k,
+        opj_event_mgr_t * p_manager);
+
+/**
+ * Reads the tiles, and passes the decoded image by strips to the
+ * m_strip_fn function of the decoder.
+ *
+ * @param       p_j2k           the jpeg2000 codec.
+ * @param       p_end_pos       position of the end of the last tile-part when
+ *                              tile-parts are accessed through the TLM index.
+ * @param       p_stream        the stream to read data from.
+ * @param       p_manager       the user event manager.
+ */
+static OPJ_BOOL opj_j2k_decode_tiles_by_strips(opj_j2k_t *p_j2k,
+        OPJ_OFF_T p_end_pos,
+        opj_stream_private_t *p_stream,
+        opj_event_mgr_t * p_manager);
+
+/**
+ * Finishes the decoding of the current tile by reading the marker that
+ * follows its data.
+ *
+ * @param       p_j2k           the jpeg2000 codec.
+ * @param       p_stream        the stream to read data from.
+ * @param       p_manager       the user event manager.
+ */
+static OPJ_BOOL opj_j2k_move_to_next_tile_header(opj_j2k_t * p_j2k,
+        opj_stream_private_t *p_stream,
+        opj_event_mgr_t * p_manager);
+
 static OPJ_BOOL opj_j2k_pre_write_tile(opj_j2k_t * p_j2k,
                                        OPJ_UINT32 p_tile_index,
                                        opj_stream_private_t *p_stream,
                                        opj_event_mgr_t * p_manager);
 
-static OPJ_BOOL opj_j2k_update_image_data(opj_tcd_t * p_tcd,
-        opj_image_t* p_output_image);
-
 static void opj_get_tile_dimensions(opj_image_t * l_image,
                                     opj_tcd_tilecomp_t * l_tilec,
                                     opj_image_comp_t * l_img_comp,
@@ -398,19 +483,56 @@ static OPJ_BOOL opj_j2k_setup_header_writing(opj_j2k_t *p_j2k,
         opj_event_mgr_t * p_manager);
 
 static OPJ_BOOL opj_j2k_write_first_tile_part(opj_j2k_t *p_j2k,
+        opj_tcd_t * p_tcd,
+        OPJ_UINT32 p_tile_no,
         OPJ_BYTE * p_data,
         OPJ_UINT32 * p_data_written,
         OPJ_UINT32 total_data_size,
-        opj_stream_private_t *p_stream,
         struct opj_event_mgr * p_manager);
 
 static OPJ_BOOL opj_j2k_write_all_tile_parts(opj_j2k_t *p_j2k,
+        opj_tcd_t * p_tcd,
+        OPJ_UINT32 p_tile_no,
+        OPJ_BYTE * p_data,
+        OPJ_UINT32 * p_data_written,
+        OPJ_UINT32 total_data_size,
+        struct opj_event_mgr * p_manager);
+
+/**
+ * Encodes a tile whose data has been set in the tile coder, and writes all
+ * its tile-parts in memory. The state of the tile-part being written is kept
+ * in p_tcd, so that tiles can be encoded concurrently with different tile
+ * coders. The TLM marker is not updated.
+ *
+ * @param       p_j2k           J2K codec.
+ * @param       p_tcd           tile coder initialized for the tile.
+ * @param       p_tile_no       index of the tile.
+ * @param       p_data          output buffer.
+ * @param       p_data_written  number of bytes written in p_data.
+ * @param       total_data_size size of p_data.
+ * @param       p_manager       the user event manager.
+ */
+static OPJ_BOOL opj_j2k_write_tile_parts(opj_j2k_t *p_j2k,
+        opj_tcd_t * p_tcd,
+        OPJ_UINT32 p_tile_no,
         OPJ_BYTE * p_data,
         OPJ_UINT32 * p_data_written,
         OPJ_UINT32 total_data_size,
-        opj_stream_private_t *p_stream,
         struct opj_event_mgr * p_manager);
 
+/**
+ * Encodes up to m_max_tiles_in_flight tiles concurrently in the thread pool,
+ * and writes their tile-parts to the stream in tile order, or in the order
+ * in which tiles are finished when TLM markers are written.
+ *
+ * @param       p_j2k           J2K codec.
+ * @param       p_stream        the stream to write data to.
+ * @param       p_manager       the user event manager.
+ */
+static OPJ_BOOL opj_j2k_encode_tiles_parallel(opj_j2k_t *p_j2k,
+        opj_stream_private_t *p_stream,
+        opj_event_mgr_t * p_manager);
+
 /**
  * Gets the offset of the header.
  *
@@ -462,6 +584,17 @@ static OPJ_BOOL opj_j2k_write_siz(opj_j2k_t *p_j2k,
                                   opj_stream_private_t *p_stream,
                                   opj_event_mgr_t * p_manager);
 
+/**
+ * Writes the CAP marker (extended capabilities), signalling HT code-blocks
+ *
+ * @param       p_j2k           J2K codec.
+ * @param       p_stream        the stream to write data to.
+ * @param       p_manager       the user event manager.
+*/
+static OPJ_BOOL opj_j2k_write_cap(opj_j2k_t *p_j2k,
+                                  opj_stream_private_t *p_stream,
+                                  opj_event_mgr_t * p_manager);
+
 /**
  * Reads a SIZ marker (image and tile size)
  * @param       p_j2k           the jpeg2000 file codec.
@@ -671,11 +804,13 @@ static OPJ_BOOL opj_j2k_write_poc(opj_j2k_t *p_j2k,
  * Writes the POC marker (Progression Order Change)
  *
  * @param       p_j2k          J2K codec.
+ * @param       p_tile_no      index of the tile whose POC is written.
  * @param       p_data         FIXME DOC
  * @param       p_data_written the stream to write data to.
  * @param       p_manager      the user event manager.
  */
 static void opj_j2k_write_poc_in_memory(opj_j2k_t *p_j2k,
+                                        OPJ_UINT32 p_tile_no,
                                         OPJ_BYTE * p_data,
                                         OPJ_UINT32 * p_data_written,
                                         opj_event_mgr_t * p_manager);
@@ -770,6 +905,33 @@ static OPJ_BOOL opj_j2k_read_plt(opj_j2k_t *p_j2k,
                                  OPJ_UINT32 p_header_size,
                                  opj_event_mgr_t * p_manager);
 
+/**
+ * Appends the length of a packet read from a PLT marker to the packet
+ * lengths of a tile.
+ *
+ * @param       p_tcp           the tile coding parameters.
+ * @param       p_packet_len    the length of the packet.
+ *
+ * @return      OPJ_FALSE if memory could not be allocated.
+ */
+static OPJ_BOOL opj_j2k_add_packet_length(opj_tcp_t *p_tcp,
+        OPJ_UINT32 p_packet_len);
+
+/**
+ * Checks that the packet lengths read from the PLT markers of the current
+ * tile-part match its data, and invalidates the packet lengths of the tile
+ * otherwise. Returns the number of bytes of the tile-part data that must be
+ * read: when only the first quality layers of a tile made of a single LRCP
+ * tile-part are decoded, the packets of the trailing layers are not needed.
+ *
+ * @param       p_j2k           the jpeg2000 codec.
+ * @param       p_tcp           the tile coding parameters.
+ *
+ * @return      the number of bytes of the tile-part data to read.
+ */
+static OPJ_UINT32 opj_j2k_get_tile_part_read_size(opj_j2k_t *p_j2k,
+        opj_tcp_t *p_tcp);
+
 /**
  * Reads a PPM marker (Packed headers, main header)
  *
@@ -831,17 +993,19 @@ static OPJ_BOOL opj_j2k_write_tlm(opj_j2k_t *p_j2k,
  * Writes the SOT marker (Start of tile-part)
  *
  * @param       p_j2k            J2K codec.
+ * @param       p_tile_no        Index of the tile (Isot)
+ * @param       p_tile_part_no   Index of the tile-part (TPsot)
  * @param       p_data           Output buffer
  * @param       total_data_size  Output buffer size
  * @param       p_data_written   Number of bytes written into stream
- * @param       p_stream         the stream to write data to.
  * @param       p_manager        the user event manager.
 */
 static OPJ_BOOL opj_j2k_write_sot(opj_j2k_t *p_j2k,
+                                  OPJ_UINT32 p_tile_no,
+                                  OPJ_UINT32 p_tile_part_no,
                                   OPJ_BYTE * p_data,
                                   OPJ_UINT32 total_data_size,
                                   OPJ_UINT32 * p_data_written,
-                                  const opj_stream_private_t *p_stream,
                                   opj_event_mgr_t * p_manager);
 
 /**
@@ -882,19 +1046,20 @@ static OPJ_BOOL opj_j2k_read_sot(opj_j2k_t *p_j2k,
  * This also writes optional PLT markers (before SOD)
  *
  * @param       p_j2k               J2K codec.
- * @param       p_tile_coder        FIXME DOC
+ * @param       p_tile_coder        tile coder, whose tp_num and cur_tp_num
+ *                                  designate the tile-part to write.
+ * @param       p_tile_no           index of the tile.
  * @param       p_data              FIXME DOC
  * @param       p_data_written      FIXME DOC
  * @param       total_data_size   FIXME DOC
- * @param       p_stream            the stream to write data to.
  * @param       p_manager           the user event manager.
 */
 static OPJ_BOOL opj_j2k_write_sod(opj_j2k_t *p_j2k,
                                   opj_tcd_t * p_tile_coder,
+                                  OPJ_UINT32 p_tile_no,
                                   OPJ_BYTE * p_data,
                                   OPJ_UINT32 * p_data_written,
                                   OPJ_UINT32 total_data_size,
-                                  const opj_stream_private_t *p_stream,
                                   opj_event_mgr_t * p_manager);
 
 /**
@@ -908,15 +1073,16 @@ static OPJ_BOOL opj_j2k_read_sod(opj_j2k_t *p_j2k,
                                  opj_stream_private_t *p_stream,
                                  opj_event_mgr_t * p_manager);
 
-static void opj_j2k_update_tlm(opj_j2k_t * p_j2k, OPJ_UINT32 p_tile_part_size)
+static void opj_j2k_update_tlm(opj_j2k_t * p_j2k, OPJ_UINT32 p_tile_no,
+                               OPJ_UINT32 p_tile_part_size)
 {
     if (p_j2k->m_specific_param.m_encoder.m_Ttlmi_is_byte) {
         opj_write_bytes(p_j2k->m_specific_param.m_encoder.m_tlm_sot_offsets_current,
-                        p_j2k->m_current_tile_number, 1);
+                        p_tile_no, 1);
         p_j2k->m_specific_param.m_encoder.m_tlm_sot_offsets_current += 1;
     } else {
         opj_write_bytes(p_j2k->m_specific_param.m_encoder.m_tlm_sot_offsets_current,
-                        p_j2k->m_current_tile_number, 2);
+                        p_tile_no, 2);
         p_j2k->m_specific_param.m_encoder.m_tlm_sot_offsets_current += 2;
     }
 
@@ -925,6 +1091,24 @@ static void opj_j2k_update_tlm(opj_j2k_t * p_j2k, OPJ_UINT32 p_tile_part_size)
     p_j2k->m_specific_param.m_encoder.m_tlm_sot_offsets_current += 4;
 }
 
+static void opj_j2k_update_tlm_with_tile_parts(opj_j2k_t * p_j2k,
+        OPJ_UINT32 p_tile_no,
+        const OPJ_BYTE * p_data,
+        OPJ_UINT32 p_data_size)
+{
+    OPJ_UINT32 l_offset = 0;
+
+    /* Each tile-part starts with a SOT marker, whose Psot is the length */
+    /* of the tile-part */
+    while (l_offset + 12 <= p_data_size) {
+        OPJ_UINT32 l_tile_part_size;
+        opj_read_bytes(p_data + l_offset + 6, &l_tile_part_size, 4);  /* PSOT */
+        assert(l_tile_part_size >= 12 && l_offset + l_tile_part_size <= p_data_size);
+        opj_j2k_update_tlm(p_j2k, p_tile_no, l_tile_part_size);
+        l_offset += l_tile_part_size;
+    }
+}
+
 /**
  * Writes the RGN marker (Region Of Interest)
  *
@@ -1276,11 +1460,13 @@ static OPJ_BOOL opj_j2k_check_poc_val(const opj_poc_t *p_pocs,
  * @param               cp                      the coding parameters.
  * @param               pino            the offset of the given poc (i.e. its position in the coding parameter).
  * @param               tileno          the given tile.
+ * @param               p_tp_pos        if not NULL, receives the position in the progression
+ *                                      order at which tile-parts are split.
  *
  * @return              the number of tile parts.
  */
-static OPJ_UINT32 opj_j2k_get_num_tp(opj_cp_t *cp, OPJ_UINT32 pino,
-                                     OPJ_UINT32 tileno);
+static OPJ_UINT32 opj_j2k_get_num_tp(const opj_cp_t *cp, OPJ_UINT32 pino,
+                                     OPJ_UINT32 tileno, OPJ_INT32 *p_tp_pos);
 
 /**
  * Calculates the total number of tile parts needed by the encoder to
@@ -1746,14 +1932,14 @@ static OPJ_BOOL opj_j2k_check_poc_val(const opj_poc_t *p_pocs,
 
 /* ----------------------------------------------------------------------- */
 
-static OPJ_UINT32 opj_j2k_get_num_tp(opj_cp_t *cp, OPJ_UINT32 pino,
-                                     OPJ_UINT32 tileno)
+static OPJ_UINT32 opj_j2k_get_num_tp(const opj_cp_t *cp, OPJ_UINT32 pino,
+                                     OPJ_UINT32 tileno, OPJ_INT32 *p_tp_pos)
 {
     const OPJ_CHAR *prog = 00;
     OPJ_INT32 i;
     OPJ_UINT32 tpnum = 1;
-    opj_tcp_t *tcp = 00;
-    opj_poc_t * l_current_poc = 00;
+    const opj_tcp_t *tcp = 00;
+    const opj_poc_t * l_current_poc = 00;
 
     /*  preconditions */
     assert(tileno < (cp->tw * cp->th));
@@ -1792,7 +1978,9 @@ static OPJ_UINT32 opj_j2k_get_num_tp(opj_cp_t *cp, OPJ_UINT32 pino,
             }
             /* would we split here ? */
             if (cp->m_specific_param.m_enc.m_tp_flag == prog[i]) {
-                cp->m_specific_param.m_enc.m_tp_pos = i;
+                if (p_tp_pos) {
+                    *p_tp_pos = i;
+                }
                 break;
             }
         }
@@ -1840,7 +2028,7 @@ static OPJ_BOOL opj_j2k_calculate_tp(opj_j2k_t *p_j2k,
 
                     for (pino = 0; pino <= tcp->numpocs; ++pino)
                     {
-                            OPJ_UINT32 tp_num = opj_j2k_get_num_tp(cp,pino,tileno);
+                            OPJ_UINT32 tp_num = opj_j2k_get_num_tp(cp,pino,tileno,&cp->m_specific_param.m_enc.m_tp_pos);
 
                             *p_nb_tiles = *p_nb_tiles + tp_num;
 
@@ -1869,7 +2057,8 @@ static OPJ_BOOL opj_j2k_calculate_tp(opj_j2k_t *p_j2k,
             opj_pi_update_encoding_parameters(image, cp, tileno);
 
             for (pino = 0; pino <= tcp->numpocs; ++pino) {
-                OPJ_UINT32 tp_num = opj_j2k_get_num_tp(cp, pino, tileno);
+                OPJ_UINT32 tp_num = opj_j2k_get_num_tp(cp, pino, tileno,
+                                      &cp->m_specific_param.m_enc.m_tp_pos);
 
                 *p_nb_tiles = *p_nb_tiles + tp_num;
 
@@ -2064,6 +2253,60 @@ static OPJ_BOOL opj_j2k_write_siz(opj_j2k_t *p_j2k,
     return OPJ_TRUE;
 }
 
+static OPJ_BOOL opj_j2k_write_cap(opj_j2k_t *p_j2k,
+                                  opj_stream_private_t *p_stream,
+                                  opj_event_mgr_t * p_manager)
+{
+    OPJ_BYTE l_data[10];
+    OPJ_UINT32 l_magb = 0;
+    OPJ_UINT32 l_ccap15 = 0;
+    OPJ_UINT32 l_tileno, l_compno, l_bandno;
+    opj_cp_t *l_cp = &(p_j2k->m_cp);
+
+    /* preconditions */
+    assert(p_j2k != 00);
+    assert(p_stream != 00);
+    assert(p_manager != 00);
+
+    /* MAGB: largest number of magnitude bitplanes of the code-blocks */
+    for (l_tileno = 0; l_tileno < l_cp->tw * l_cp->th; ++l_tileno) {
+        const opj_tcp_t *l_tcp = &l_cp->tcps[l_tileno];
+        for (l_compno = 0; l_compno < p_j2k->m_private_image->numcomps; ++l_compno) {
+            const opj_tccp_t *l_tccp = &l_tcp->tccps[l_compno];
+            const OPJ_UINT32 l_numbands = 3 * l_tccp->numresolutions - 2;
+            for (l_bandno = 0; l_bandno < l_numbands; ++l_bandno) {
+                l_magb = opj_uint_max(l_magb, (OPJ_UINT32)
+                                      l_tccp->stepsizes[l_bandno].expn + l_tccp->numgbits - 1);
+            }
+            if (l_tccp->qmfbid == 0) {
+                /* HTIRV: irreversible transform used */
+                l_ccap15 |= 0x0020;
+            }
+        }
+    }
+
+    /* Bits 15-14 left to 0: all code-blocks are HT code-blocks. */
+    /* Bits 4-0 encode MAGB (15444-15, Table A.4) */
+    if (l_magb > 8 && l_magb < 28) {
+        l_ccap15 |= l_magb - 8;
+    } else if (l_magb >= 28 && l_magb < 48) {
+        l_ccap15 |= 13 + (l_magb >> 2);
+    } else if (l_magb >= 48) {
+        l_ccap15 |= 31;
+    }
+
+    opj_write_bytes(l_data, J2K_MS_CAP, 2);         /* CAP */
+    opj_write_bytes(l_data + 2, 8, 2);              /* Lcap */
+    opj_write_bytes(l_data + 4, 0x00020000, 4);     /* Pcap: Part-15 */
+    opj_write_bytes(l_data + 8, l_ccap15, 2);       /* Ccap15 */
+
+    if (opj_stream_write_data(p_stream, l_data, 10, p_manager) != 10) {
+        return OPJ_FALSE;
+    }
+
+    return OPJ_TRUE;
+}
+
 /**
  * Reads a SIZ marker (image and tile size)
  * @param       p_j2k           the jpeg2000 file codec.
@@ -3330,7 +3573,7 @@ static OPJ_BOOL opj_j2k_write_poc(opj_j2k_t *p_j2k,
         p_j2k->m_specific_param.m_encoder.m_header_tile_data_size = l_poc_size;
     }
 
-    opj_j2k_write_poc_in_memory(p_j2k,
+    opj_j2k_write_poc_in_memory(p_j2k, p_j2k->m_current_tile_number,
                                 p_j2k->m_specific_param.m_encoder.m_header_tile_data, &l_written_size,
                                 p_manager);
 
@@ -3344,6 +3587,7 @@ static OPJ_BOOL opj_j2k_write_poc(opj_j2k_t *p_j2k,
 }
 
 static void opj_j2k_write_poc_in_memory(opj_j2k_t *p_j2k,
+                                        OPJ_UINT32 p_tile_no,
                                         OPJ_BYTE * p_data,
                                         OPJ_UINT32 * p_data_written,
                                         opj_event_mgr_t * p_manager
@@ -3366,7 +3610,7 @@ static void opj_j2k_write_poc_in_memory(opj_j2k_t *p_j2k,
 
     OPJ_UNUSED(p_manager);
 
-    l_tcp = &p_j2k->m_cp.tcps[p_j2k->m_current_tile_number];
+    l_tcp = &p_j2k->m_cp.tcps[p_tile_no];
     l_tccp = &l_tcp->tccps[0];
     l_image = p_j2k->m_private_image;
     l_nb_comp = l_image->numcomps;
@@ -3861,13 +4105,19 @@ static OPJ_BOOL opj_j2k_read_plt(opj_j2k_t *p_j2k,
                                 )
 {
     OPJ_UINT32 l_Zplt, l_tmp, l_packet_len = 0, i;
+    opj_tcp_t *l_tcp;
+    OPJ_BOOL l_store;
 
     /* preconditions */
     assert(p_header_data != 00);
     assert(p_j2k != 00);
     assert(p_manager != 00);
 
-    OPJ_UNUSED(p_j2k);
+    /* The packet lengths are kept so that T2 can skip packets without */
+    /* parsing their header, unless the data of the tile-part is skipped */
+    l_tcp = &(p_j2k->m_cp.tcps[p_j2k->m_current_tile_number]);
+    l_store = !p_j2k->m_specific_param.m_decoder.m_skip_data &&
+              !l_tcp->m_packet_lengths_invalid;
 
     if (p_header_size < 1) {
         opj_event_msg(p_manager, EVT_ERROR, "Error reading PLT marker\n");
@@ -3884,9 +4134,20 @@ static OPJ_BOOL opj_j2k_read_plt(opj_j2k_t *p_j2k,
         /* take only the last seven bytes */
         l_packet_len |= (l_tmp & 0x7f);
         if (l_tmp & 0x80) {
+            if (l_packet_len > (UINT_MAX >> 7)) {
+                /* Too large to be the length of a packet of a tile-part */
+                l_store = OPJ_FALSE;
+                l_tcp->m_packet_lengths_invalid = 1;
+            }
             l_packet_len <<= 7;
         } else {
             /* store packet length and proceed to next packet */
+            if (l_store &&
+                    !opj_j2k_add_packet_length(l_tcp, l_packet_len)) {
+                opj_event_msg(p_manager, EVT_ERROR,
+                              "Not enough memory to read PLT marker\n");
+                return OPJ_FALSE;
+            }
             l_packet_len = 0;
         }
     }
@@ -3899,6 +4160,82 @@ static OPJ_BOOL opj_j2k_read_plt(opj_j2k_t *p_j2k,
     return OPJ_TRUE;
 }
 
+static OPJ_BOOL opj_j2k_add_packet_length(opj_tcp_t *p_tcp,
+        OPJ_UINT32 p_packet_len)
+{
+    if (p_tcp->m_nb_packet_lengths == p_tcp->m_max_packet_lengths) {
+        OPJ_UINT32 *l_new_lengths;
+        OPJ_UINT32 l_new_max;
+
+        if (p_tcp->m_max_packet_lengths > UINT_MAX / 2U / sizeof(OPJ_UINT32)) {
+            return OPJ_FALSE;
+        }
+        l_new_max = p_tcp->m_max_packet_lengths ?
+                    2U * p_tcp->m_max_packet_lengths : 256U;
+        l_new_lengths = (OPJ_UINT32*)opj_realloc(p_tcp->m_packet_lengths,
+                        l_new_max * sizeof(OPJ_UINT32));
+        if (! l_new_lengths) {
+            return OPJ_FALSE;
+        }
+        p_tcp->m_packet_lengths = l_new_lengths;
+        p_tcp->m_max_packet_lengths = l_new_max;
+    }
+    p_tcp->m_packet_lengths[p_tcp->m_nb_packet_lengths++] = p_packet_len;
+    return OPJ_TRUE;
+}
+
+static OPJ_UINT32 opj_j2k_get_tile_part_read_size(opj_j2k_t *p_j2k,
+        opj_tcp_t *p_tcp)
+{
+    const OPJ_UINT32 l_sot_length =
+        p_j2k->m_specific_param.m_decoder.m_sot_length;
+    const OPJ_UINT32 l_start = p_tcp->m_packet_lengths_tp_start;
+    const OPJ_UINT32 l_nb = p_tcp->m_nb_packet_lengths - l_start;
+    OPJ_UINT64 l_sum = 0;
+    OPJ_UINT32 i;
+
+    if (p_tcp->m_packet_lengths_invalid) {
+        return l_sot_length;
+    }
+
+    /* With packed packet headers, the packets of the tile-part data are */
+    /* only made of their body, so PLT markers are not used */
+    if (p_j2k->m_cp.ppm || p_tcp->ppt || (l_nb == 0 && l_sot_length != 0)) {
+        p_tcp->m_packet_lengths_invalid = 1;
+        return l_sot_length;
+    }
+
+    for (i = 0; i < l_nb; ++i) {
+        l_sum += p_tcp->m_packet_lengths[l_start + i];
+    }
+    if (l_sum != l_sot_length) {
+        p_tcp->m_packet_lengths_invalid = 1;
+        return l_sot_length;
+    }
+
+    /* In a tile made of a single tile-part, with a LRCP progression and */
+    /* no progression order change, each layer is made of the same number */
+    /* of packets, and the packets of the layers that are not decoded */
+    /* come last. They are read anyway if the image may be refined later */
+    if (p_tcp->m_nb_tile_parts == 1 && l_start == 0 &&
+            !p_j2k->m_specific_param.m_decoder.m_refinable &&
+            !p_tcp->POC && p_tcp->prg == OPJ_LRCP &&
+            p_tcp->num_layers_to_decode < p_tcp->numlayers &&
+            (l_nb % p_tcp->numlayers) == 0) {
+        const OPJ_UINT32 l_nb_needed =
+            (l_nb / p_tcp->numlayers) * p_tcp->num_layers_to_decode;
+
+        l_sum = 0;
+        for (i = 0; i < l_nb_needed; ++i) {
+            l_sum += p_tcp->m_packet_lengths[i];
+        }
+        p_tcp->m_data_truncated = 1;
+        return (OPJ_UINT32)l_sum;
+    }
+
+    return l_sot_length;
+}
+
 /**
  * Reads a PPM marker (Packed packet headers, main header)
  *
@@ -4353,19 +4690,17 @@ static OPJ_BOOL opj_j2k_write_tlm(opj_j2k_t *p_j2k,
 }
 
 static OPJ_BOOL opj_j2k_write_sot(opj_j2k_t *p_j2k,
+                                  OPJ_UINT32 p_tile_no,
+                                  OPJ_UINT32 p_tile_part_no,
                                   OPJ_BYTE * p_data,
                                   OPJ_UINT32 total_data_size,
                                   OPJ_UINT32 * p_data_written,
-                                  const opj_stream_private_t *p_stream,
                                   opj_event_mgr_t * p_manager
                                  )
 {
     /* preconditions */
     assert(p_j2k != 00);
     assert(p_manager != 00);
-    assert(p_stream != 00);
-
-    OPJ_UNUSED(p_stream);
 
     if (total_data_size < 12) {
         opj_event_msg(p_manager, EVT_ERROR,
@@ -4381,20 +4716,19 @@ static OPJ_BOOL opj_j2k_write_sot(opj_j2k_t *p_j2k,
                     2);                                                   /* Lsot */
     p_data += 2;
 
-    opj_write_bytes(p_data, p_j2k->m_current_tile_number,
+    opj_write_bytes(p_data, p_tile_no,
                     2);                        /* Isot */
     p_data += 2;
 
     /* Psot  */
     p_data += 4;
 
-    opj_write_bytes(p_data,
-                    p_j2k->m_specific_param.m_encoder.m_current_tile_part_number,
+    opj_write_bytes(p_data, p_tile_part_no,
                     1);                        /* TPsot */
     ++p_data;
 
     opj_write_bytes(p_data,
-                    p_j2k->m_cp.tcps[p_j2k->m_current_tile_number].m_nb_tile_parts,
+                    p_j2k->m_cp.tcps[p_tile_no].m_nb_tile_parts,
                     1);                      /* TNsot */
     ++p_data;
 
@@ -4637,6 +4971,14 @@ static OPJ_BOOL opj_j2k_read_sot(opj_j2k_t *p_j2k,
 
     p_j2k->m_specific_param.m_decoder.m_state = J2K_STATE_TPH;
 
+    /* The packet lengths read from the PLT markers of this tile-part are */
+    /* appended to the ones of the tile-parts whose data is already read */
+    if (l_tcp->m_data == NULL) {
+        l_tcp->m_nb_packet_lengths = 0;
+        l_tcp->m_packet_lengths_invalid = 0;
+    }
+    l_tcp->m_packet_lengths_tp_start = l_tcp->m_nb_packet_lengths;
+
     /* Check if the current tile is outside the area we want decode or not corresponding to the tile index*/
     if (p_j2k->m_specific_param.m_decoder.m_tile_ind_to_dec == -1) {
         p_j2k->m_specific_param.m_decoder.m_skip_data =
@@ -4834,10 +5176,10 @@ static OPJ_BOOL opj_j2k_write_plt_in_memory(opj_j2k_t *p_j2k,
 
 static OPJ_BOOL opj_j2k_write_sod(opj_j2k_t *p_j2k,
                                   opj_tcd_t * p_tile_coder,
+                                  OPJ_UINT32 p_tile_no,
                                   OPJ_BYTE * p_data,
                                   OPJ_UINT32 * p_data_written,
                                   OPJ_UINT32 total_data_size,
-                                  const opj_stream_private_t *p_stream,
                                   opj_event_mgr_t * p_manager
                                  )
 {
@@ -4848,9 +5190,6 @@ static OPJ_BOOL opj_j2k_write_sod(opj_j2k_t *p_j2k,
     /* preconditions */
     assert(p_j2k != 00);
     assert(p_manager != 00);
-    assert(p_stream != 00);
-
-    OPJ_UNUSED(p_stream);
 
     if (total_data_size < 4) {
         opj_event_msg(p_manager, EVT_ERROR,
@@ -4864,17 +5203,11 @@ static OPJ_BOOL opj_j2k_write_sod(opj_j2k_t *p_j2k,
     /* make room for the EOF marker */
     l_remaining_data =  total_data_size - 4;
 
-    /* update tile coder */
-    p_tile_coder->tp_num =
-        p_j2k->m_specific_param.m_encoder.m_current_poc_tile_part_number ;
-    p_tile_coder->cur_tp_num =
-        p_j2k->m_specific_param.m_encoder.m_current_tile_part_number;
-
     /* INDEX >> */
     /* TODO mergeV2: check this part which use cstr_info */
     /*l_cstr_info = p_j2k->cstr_info;
     if (l_cstr_info) {
-            if (!p_j2k->m_specific_param.m_encoder.m_current_tile_part_number ) {
+            if (!p_tile_coder->cur_tp_num ) {
                     //TODO cstr_info->tile[p_j2k->m_current_tile_number].end_header = p_stream_tell(p_stream) + p_j2k->pos_correction - 1;
                     l_cstr_info->tile[p_j2k->m_current_tile_number].tileno = p_j2k->m_current_tile_number;
             }
@@ -4898,7 +5231,7 @@ static OPJ_BOOL opj_j2k_write_sod(opj_j2k_t *p_j2k,
     /*}*/
     /* << INDEX */
 
-    if (p_j2k->m_specific_param.m_encoder.m_current_tile_part_number == 0) {
+    if (p_tile_coder->cur_tp_num == 0) {
         p_tile_coder->tcd_image->tiles->packno = 0;
 #ifdef deadcode
         if (l_cstr_info) {
@@ -4928,7 +5261,7 @@ static OPJ_BOOL opj_j2k_write_sod(opj_j2k_t *p_j2k,
     }
     l_remaining_data -= p_j2k->m_specific_param.m_encoder.m_reserved_bytes_for_PLT;
 
-    if (! opj_tcd_encode_tile(p_tile_coder, p_j2k->m_current_tile_number,
+    if (! opj_tcd_encode_tile(p_tile_coder, p_tile_no,
                               p_data + 2,
                               p_data_written, l_remaining_data, l_cstr_info,
                               marker_info,
@@ -4981,11 +5314,14 @@ static OPJ_BOOL opj_j2k_read_sod(opj_j2k_t *p_j2k,
                                 )
 {
     OPJ_SIZE_T l_current_read_size;
+    OPJ_SIZE_T l_current_skip_size = 0;
+    OPJ_UINT32 l_read_size;
     opj_codestream_index_t * l_cstr_index = 00;
     OPJ_BYTE ** l_current_data = 00;
     opj_tcp_t * l_tcp = 00;
     OPJ_UINT32 * l_tile_len = 00;
     OPJ_BOOL l_sot_length_pb_detected = OPJ_FALSE;
+    OPJ_BOOL l_read_in_place;
 
     /* preconditions */
     assert(p_j2k != 00);
@@ -5013,6 +5349,14 @@ static OPJ_BOOL opj_j2k_read_sod(opj_j2k_t *p_j2k,
     l_current_data = &(l_tcp->m_data);
     l_tile_len = &l_tcp->m_data_size;
 
+    /* Packets that are not decoded may not need to be read */
+    l_read_size = opj_j2k_get_tile_part_read_size(p_j2k, l_tcp);
+
+    /* When the stream is held in memory, the data of a tile made of a */
+    /* single tile-part is used in place. It is copied if another tile-part */
+    /* follows. */
+    l_read_in_place = opj_stream_is_in_memory(p_stream) && !*l_current_data;
+
     /* Patch to support new PHR data */
     if (p_j2k->m_specific_param.m_decoder.m_sot_length) {
         /* If we are here, we'll try to read the data after allocation */
@@ -5028,34 +5372,52 @@ static OPJ_BOOL opj_j2k_read_sod(opj_j2k_t *p_j2k,
                               "Tile part length size inconsistent with stream length\n");
             }
         }
-        if (p_j2k->m_specific_param.m_decoder.m_sot_length >
-                UINT_MAX - OPJ_COMMON_CBLK_DATA_EXTRA) {
+        if (l_read_size > UINT_MAX - OPJ_COMMON_CBLK_DATA_EXTRA) {
             opj_event_msg(p_manager, EVT_ERROR,
-                          "p_j2k->m_specific_param.m_decoder.m_sot_length > "
-                          "UINT_MAX - OPJ_COMMON_CBLK_DATA_EXTRA");
+                          "l_read_size > UINT_MAX - OPJ_COMMON_CBLK_DATA_EXTRA");
             return OPJ_FALSE;
         }
         /* Add a margin of OPJ_COMMON_CBLK_DATA_EXTRA to the allocation we */
         /* do so that opj_mqc_init_dec_common() can safely add a synthetic */
         /* 0xFFFF marker. */
-        if (! *l_current_data) {
+        if (l_read_in_place) {
+            /* Nothing to allocate */
+        } else if (! *l_current_data) {
             /* LH: oddly enough, in this path, l_tile_len!=0.
              * TODO: If this was consistent, we could simplify the code to only use realloc(), as realloc(0,...) default to malloc(0,...).
              */
             *l_current_data = (OPJ_BYTE*) opj_malloc(
-                                  p_j2k->m_specific_param.m_decoder.m_sot_length + OPJ_COMMON_CBLK_DATA_EXTRA);
+                                  l_read_size + OPJ_COMMON_CBLK_DATA_EXTRA);
+        } else if (l_tcp->m_data_borrowed) {
+            OPJ_BYTE *l_new_current_data;
+            if (*l_tile_len > UINT_MAX - OPJ_COMMON_CBLK_DATA_EXTRA -
+                    l_read_size) {
+                opj_event_msg(p_manager, EVT_ERROR,
+                              "*l_tile_len > UINT_MAX - OPJ_COMMON_CBLK_DATA_EXTRA - "
+                              "l_read_size");
+                return OPJ_FALSE;
+            }
+
+            /* Copy the previous tile-parts out of the stream */
+            l_new_current_data = (OPJ_BYTE *) opj_malloc(*l_tile_len +
+                                 l_read_size + OPJ_COMMON_CBLK_DATA_EXTRA);
+            if (l_new_current_data) {
+                memcpy(l_new_current_data, *l_current_data, *l_tile_len);
+            }
+            *l_current_data = l_new_current_data;
+            l_tcp->m_data_borrowed = 0;
         } else {
             OPJ_BYTE *l_new_current_data;
             if (*l_tile_len > UINT_MAX - OPJ_COMMON_CBLK_DATA_EXTRA -
-                    p_j2k->m_specific_param.m_decoder.m_sot_length) {
+                    l_read_size) {
                 opj_event_msg(p_manager, EVT_ERROR,
                               "*l_tile_len > UINT_MAX - OPJ_COMMON_CBLK_DATA_EXTRA - "
-                              "p_j2k->m_specific_param.m_decoder.m_sot_length");
+                              "l_read_size");
                 return OPJ_FALSE;
             }
 
             l_new_current_data = (OPJ_BYTE *) opj_realloc(*l_current_data,
-                                 *l_tile_len + p_j2k->m_specific_param.m_decoder.m_sot_length +
+                                 *l_tile_len + l_read_size +
                                  OPJ_COMMON_CBLK_DATA_EXTRA);
             if (! l_new_current_data) {
                 opj_free(*l_current_data);
@@ -5067,7 +5429,7 @@ static OPJ_BOOL opj_j2k_read_sod(opj_j2k_t *p_j2k,
             *l_current_data = l_new_current_data;
         }
 
-        if (*l_current_data == 00) {
+        if (!l_read_in_place && *l_current_data == 00) {
             opj_event_msg(p_manager, EVT_ERROR, "Not enough memory to decode tile\n");
             return OPJ_FALSE;
         }
@@ -5104,17 +5466,35 @@ static OPJ_BOOL opj_j2k_read_sod(opj_j2k_t *p_j2k,
     }
 
     /* Patch to support new PHR data */
-    if (!l_sot_length_pb_detected) {
+    if (!l_sot_length_pb_detected && l_read_in_place) {
+        *l_current_data = (OPJ_BYTE *) opj_stream_read_data_in_place(
+                              p_stream,
+                              l_read_size,
+                              &l_current_read_size,
+                              p_manager);
+        l_tcp->m_data_borrowed = (*l_current_data != NULL);
+    } else if (!l_sot_length_pb_detected) {
         l_current_read_size = opj_stream_read_data(
                                   p_stream,
                                   *l_current_data + *l_tile_len,
-                                  p_j2k->m_specific_param.m_decoder.m_sot_length,
+                                  l_read_size,
                                   p_manager);
     } else {
         l_current_read_size = 0;
     }
 
-    if (l_current_read_size != p_j2k->m_specific_param.m_decoder.m_sot_length) {
+    if (l_current_read_size == l_read_size &&
+            l_read_size < p_j2k->m_specific_param.m_decoder.m_sot_length) {
+        /* Skip the packets of the quality layers that are not decoded */
+        const OPJ_OFF_T l_skip_size = (OPJ_OFF_T)(
+                                          p_j2k->m_specific_param.m_decoder.m_sot_length - l_read_size);
+        if (opj_stream_skip(p_stream, l_skip_size, p_manager) == l_skip_size) {
+            l_current_skip_size = (OPJ_SIZE_T)l_skip_size;
+        }
+    }
+
+    if (l_current_read_size + l_current_skip_size !=
+            p_j2k->m_specific_param.m_decoder.m_sot_length) {
         if (l_current_read_size == (OPJ_SIZE_T)(-1)) {
             /* Avoid issue of https://github.com/uclouvain/openjpeg/issues/1533 */
             opj_event_msg(p_manager, EVT_ERROR, "Stream too short\n");
@@ -5457,7 +5837,14 @@ static OPJ_BOOL opj_j2k_update_rates(opj_j2k_t *p_j2k,
     /* bin/test_tile_encoder 1 256 256 32 32 8 0 reversible_with_precinct.j2k 4 4 3 0 0 1 16 16 */
     /* TODO revise this to take into account the overhead linked to the */
     /* number of packets and number of code blocks in packets */
-    l_tile_size = (OPJ_UINT64)((double)l_tile_size * 1.4 / 8);
+    /* HT code-blocks have a single cleanup pass, so there is no coding pass */
+    /* to truncate, and the MEL/VLC segments plus the Scup bytes add a */
+    /* few bytes per code-block on top of the raw samples. */
+    if (OPJ_IS_PART15(l_cp->rsiz)) {
+        l_tile_size = (OPJ_UINT64)((double)l_tile_size * 2.0 / 8);
+    } else {
+        l_tile_size = (OPJ_UINT64)((double)l_tile_size * 1.4 / 8);
+    }
 
     /* Arbitrary amount to make the following work: */
     /* bin/test_tile_encoder 1 256 256 17 16 8 0 reversible_no_precinct.j2k 4 4 3 0 0 1 */
@@ -5513,7 +5900,8 @@ static OPJ_BOOL opj_j2k_read_eoc(opj_j2k_t *p_j2k,
     l_nb_tiles = p_j2k->m_cp.th * p_j2k->m_cp.tw;
     l_tcp = p_j2k->m_cp.tcps;
 
-    l_tcd = opj_tcd_create(OPJ_TRUE);
+    l_tcd = opj_tcd_create(OPJ_TRUE, NULL,
+                           p_j2k->m_specific_param.m_decoder.m_mem_counter);
     if (l_tcd == 00) {
         opj_event_msg(p_manager, EVT_ERROR, "Cannot decode tile, memory error\n");
         return OPJ_FALSE;
@@ -6772,6 +7160,65 @@ void opj_j2k_decoder_set_strict_mode(opj_j2k_t *j2k, OPJ_BOOL strict)
     }
 }
 
+OPJ_BOOL opj_j2k_decoder_set_extra_options(
+    opj_j2k_t *p_j2k,
+    const char* const* p_options,
+    opj_event_mgr_t * p_manager)
+{
+    const char* const* p_option_iter;
+
+    if (p_options == NULL) {
+        return OPJ_TRUE;
+    }
+
+    for (p_option_iter = p_options; *p_option_iter != NULL; ++p_option_iter) {
+        if (strncmp(*p_option_iter, "TILES_IN_FLIGHT=",
+                    strlen("TILES_IN_FLIGHT=")) == 0) {
+            int tiles_in_flight = atoi(*p_option_iter + strlen("TILES_IN_FLIGHT="));
+            if (tiles_in_flight < 0) {
+                opj_event_msg(p_manager, EVT_ERROR,
+                              "Invalid value for option: %s.\n", *p_option_iter);
+                return OPJ_FALSE;
+            }
+            p_j2k->m_specific_param.m_decoder.m_max_tiles_in_flight =
+                (OPJ_UINT32)tiles_in_flight;
+        } else if (strncmp(*p_option_iter, "CODEBLOCK_CACHE_SIZE=",
+                           strlen("CODEBLOCK_CACHE_SIZE=")) == 0) {
+            int cache_size = atoi(*p_option_iter + strlen("CODEBLOCK_CACHE_SIZE="));
+            if (cache_size < 0 || (OPJ_SIZE_T)cache_size > SIZE_MAX / (1024 * 1024)) {
+                opj_event_msg(p_manager, EVT_ERROR,
+                              "Invalid value for option: %s.\n", *p_option_iter);
+                return OPJ_FALSE;
+            }
+            /* The cache is created again with the new size when decoding */
+            opj_cblk_cache_destroy(p_j2k->m_specific_param.m_decoder.m_cblk_cache);
+            p_j2k->m_specific_param.m_decoder.m_cblk_cache = NULL;
+            if (p_j2k->m_tcd) {
+                p_j2k->m_tcd->cblk_cache = NULL;
+            }
+            p_j2k->m_specific_param.m_decoder.m_cblk_cache_size =
+                (OPJ_SIZE_T)cache_size * 1024 * 1024;
+        } else if (strncmp(*p_option_iter, "PROGRESSIVE_REFINEMENT=",
+                           strlen("PROGRESSIVE_REFINEMENT=")) == 0) {
+            if (strcmp(*p_option_iter, "PROGRESSIVE_REFINEMENT=YES") == 0) {
+                p_j2k->m_specific_param.m_decoder.m_refinable = OPJ_TRUE;
+            } else if (strcmp(*p_option_iter, "PROGRESSIVE_REFINEMENT=NO") == 0) {
+                p_j2k->m_specific_param.m_decoder.m_refinable = OPJ_FALSE;
+            } else {
+                opj_event_msg(p_manager, EVT_ERROR,
+                              "Invalid value for option: %s.\n", *p_option_iter);
+                return OPJ_FALSE;
+            }
+        } else {
+            opj_event_msg(p_manager, EVT_ERROR,
+                          "Invalid option: %s.\n", *p_option_iter);
+            return OPJ_FALSE;
+        }
+    }
+
+    return OPJ_TRUE;
+}
+
 OPJ_BOOL opj_j2k_set_threads(opj_j2k_t *j2k, OPJ_UINT32 num_threads)
 {
     /* Currently we pass the thread-pool to the tcd, so we cannot re-set it */
@@ -6791,34 +7238,166 @@ OPJ_BOOL opj_j2k_set_threads(opj_j2k_t *j2k, OPJ_UINT32 num_threads)
     return OPJ_FALSE;
 }
 
-static int opj_j2k_get_default_thread_count(void)
+OPJ_BOOL opj_j2k_set_thread_pool(opj_j2k_t *j2k, opj_thread_pool_t* tp)
 {
-    const char* num_threads_str = getenv("OPJ_NUM_THREADS");
-    int num_cpus;
-    int num_threads;
-
-    if (num_threads_str == NULL || !opj_has_thread_support()) {
-        return 0;
-    }
-    num_cpus = opj_get_num_cpus();
-    if (strcmp(num_threads_str, "ALL_CPUS") == 0) {
-        return num_cpus;
-    }
-    if (num_cpus == 0) {
-        num_cpus = 32;
-    }
-    num_threads = atoi(num_threads_str);
-    if (num_threads < 0) {
-        num_threads = 0;
-    } else if (num_threads > 2 * num_cpus) {
-        num_threads = 2 * num_cpus;
+    /* Same restriction as opj_j2k_set_threads() */
+    if (opj_has_thread_support() && j2k->m_tcd == NULL) {
+        opj_thread_pool_t* l_tp;
+        if (tp != NULL) {
+            l_tp = opj_thread_pool_create_view(tp);
+        } else {
+            l_tp = opj_thread_pool_create(0);
+        }
+        if (l_tp == NULL) {
+            return OPJ_FALSE;
+        }
+        opj_thread_pool_destroy(j2k->m_tp);
+        j2k->m_tp = l_tp;
+        return OPJ_TRUE;
     }
-    return num_threads;
+    return OPJ_FALSE;
 }
 
-/* ----------------------------------------------------------------------- */
-/* J2K encoder interface                                                       */
-/* ----------------------------------------------------------------------- */
+OPJ_BOOL opj_j2k_set_allocator(opj_j2k_t *p_j2k,
+                               const opj_allocator_t* p_allocator,
+                               opj_event_mgr_t * p_manager)
+{
+    opj_allocator_t* l_allocator = &(p_j2k->m_specific_param.m_decoder.m_allocator);
+
+    /* The arenas are created with the tile decoders */
+    if (!p_j2k->m_is_decoder || p_j2k->m_tcd != NULL) {
+        opj_event_msg(p_manager, EVT_ERROR,
+                      "The allocator must be set before reading the header\n");
+        return OPJ_FALSE;
+    }
+    if (p_allocator != NULL) {
+        *l_allocator = *p_allocator;
+    } else {
+        memset(l_allocator, 0, sizeof(opj_allocator_t));
+    }
+    return OPJ_TRUE;
+}
+
+OPJ_BOOL opj_j2k_enable_stats(opj_j2k_t *p_j2k,
+                              OPJ_BOOL enable,
+                              opj_event_mgr_t * p_manager)
+{
+    opj_j2k_dec_t* l_dec = &(p_j2k->m_specific_param.m_decoder);
+
+    if (!p_j2k->m_is_decoder) {
+        opj_event_msg(p_manager, EVT_ERROR,
+                      "Statistics can only be collected when decoding\n");
+        return OPJ_FALSE;
+    }
+
+    opj_free(l_dec->m_stats.tiles);
+    memset(&(l_dec->m_stats), 0, sizeof(opj_codec_stats_t));
+    memset(&(l_dec->m_stats_header_time), 0, sizeof(opj_stage_time_t));
+    l_dec->m_stats_header_size = 0;
+    if (p_j2k->m_tcd) {
+        p_j2k->m_tcd->stats = NULL;
+    }
+    opj_mem_counter_reset_peak(l_dec->m_mem_counter);
+
+    l_dec->m_stats_enabled = enable;
+    return OPJ_TRUE;
+}
+
+const opj_codec_stats_t* opj_j2k_get_stats(opj_j2k_t *p_j2k)
+{
+    opj_j2k_dec_t* l_dec = &(p_j2k->m_specific_param.m_decoder);
+    opj_codec_stats_t* l_stats = &(l_dec->m_stats);
+    OPJ_UINT32 i, l_stage;
+
+    if (!p_j2k->m_is_decoder || !l_dec->m_stats_enabled) {
+        return NULL;
+    }
+
+    memset(l_stats->stages, 0, sizeof(l_stats->stages));
+    l_stats->stages[OPJ_STAGE_MARKERS] = l_dec->m_stats_header_time;
+    l_stats->bytes_read = l_dec->m_stats_header_size;
+    l_stats->codeblocks_decoded = 0;
+    l_stats->codeblocks_skipped = 0;
+    l_stats->codeblocks_cached = 0;
+    l_stats->codeblocks_resumed = 0;
+    l_stats->tiles_decoded = 0;
+    l_stats->peak_allocated_bytes = (OPJ_UINT64)opj_mem_counter_get_peak(
+                                        l_dec->m_mem_counter);
+    for (i = 0; i < l_stats->nb_tiles; i++) {
+        const opj_tile_stats_t* l_tile = &(l_stats->tiles[i]);
+        for (l_stage = 0; l_stage < OPJ_NUM_DECODE_STAGES; l_stage++) {
+            l_stats->stages[l_stage].wall_time += l_tile->stages[l_stage].wall_time;
+            l_stats->stages[l_stage].cpu_time += l_tile->stages[l_stage].cpu_time;
+        }
+        l_stats->bytes_read += l_tile->bytes_read;
+        l_stats->codeblocks_decoded += l_tile->codeblocks_decoded;
+        l_stats->codeblocks_skipped += l_tile->codeblocks_skipped;
+        l_stats->codeblocks_cached += l_tile->codeblocks_cached;
+        l_stats->codeblocks_resumed += l_tile->codeblocks_resumed;
+        if (l_tile->decoded) {
+            l_stats->tiles_decoded ++;
+        }
+    }
+    return l_stats;
+}
+
+/**
+ * Returns the statistics of a tile, allocating the ones of all tiles the
+ * first time, or NULL if statistics are not collected.
+ */
+static opj_tile_stats_t* opj_j2k_get_tile_stats(opj_j2k_t *p_j2k,
+        OPJ_UINT32 p_tile_no)
+{
+    opj_codec_stats_t* l_stats = &(p_j2k->m_specific_param.m_decoder.m_stats);
+    const OPJ_UINT32 l_nb_tiles = p_j2k->m_cp.tw * p_j2k->m_cp.th;
+
+    if (!p_j2k->m_specific_param.m_decoder.m_stats_enabled ||
+            p_tile_no >= l_nb_tiles) {
+        return NULL;
+    }
+    if (l_stats->tiles == NULL) {
+        OPJ_UINT32 i;
+        l_stats->tiles = (opj_tile_stats_t*) opj_calloc(l_nb_tiles,
+                         sizeof(opj_tile_stats_t));
+        if (l_stats->tiles == NULL) {
+            return NULL;
+        }
+        l_stats->nb_tiles = l_nb_tiles;
+        for (i = 0; i < l_nb_tiles; i++) {
+            l_stats->tiles[i].tile_index = i;
+        }
+    }
+    return &(l_stats->tiles[p_tile_no]);
+}
+
+static int opj_j2k_get_default_thread_count(void)
+{
+    const char* num_threads_str = getenv("OPJ_NUM_THREADS");
+    int num_cpus;
+    int num_threads;
+
+    if (num_threads_str == NULL || !opj_has_thread_support()) {
+        return 0;
+    }
+    num_cpus = opj_get_num_cpus();
+    if (strcmp(num_threads_str, "ALL_CPUS") == 0) {
+        return num_cpus;
+    }
+    if (num_cpus == 0) {
+        num_cpus = 32;
+    }
+    num_threads = atoi(num_threads_str);
+    if (num_threads < 0) {
+        num_threads = 0;
+    } else if (num_threads > 2 * num_cpus) {
+        num_threads = 2 * num_cpus;
+    }
+    return num_threads;
+}
+
+/* ----------------------------------------------------------------------- */
+/* J2K encoder interface                                                       */
+/* ----------------------------------------------------------------------- */
 
 opj_j2k_t* opj_j2k_create_compress(void)
 {
@@ -7965,6 +8544,43 @@ OPJ_BOOL opj_j2k_setup_encoder(opj_j2k_t *p_j2k,
         }
     }
 
+    /* HT code-blocks (Part-15) are signalled by Rsiz bit 14 and a CAP marker */
+    if (parameters->mode & (J2K_CCP_CBLKSTY_HT | J2K_CCP_CBLKSTY_HTMIXED)) {
+        if (parameters->mode != J2K_CCP_CBLKSTY_HT) {
+            opj_event_msg(p_manager, EVT_ERROR,
+                          "The HT code-block style cannot be combined with "
+                          "other mode switches, nor with mixed mode.\n");
+            return OPJ_FALSE;
+        }
+        if (parameters->roi_compno != -1) {
+            opj_event_msg(p_manager, EVT_ERROR,
+                          "ROI is not supported with HT code-blocks.\n");
+            return OPJ_FALSE;
+        }
+        if (parameters->cp_fixed_alloc) {
+            /* The layers are given in bit-planes of MQ coding passes */
+            opj_event_msg(p_manager, EVT_ERROR,
+                          "Fixed layer allocation is not supported with HT "
+                          "code-blocks.\n");
+            return OPJ_FALSE;
+        }
+        for (i = 0; parameters->tcp_numlayers > 1 &&
+                i < (OPJ_UINT32)parameters->tcp_numlayers; i++) {
+            /* A code-block is included in a single layer, with a cleanup */
+            /* pass that the following layers cannot refine */
+            if (parameters->cp_fixed_quality ?
+                    parameters->tcp_distoratio[i] > 0.0f :
+                    parameters->tcp_rates[i] > 0.0f) {
+                opj_event_msg(p_manager, EVT_ERROR,
+                              "Several quality layers with rate or quality "
+                              "targets are not supported with HT "
+                              "code-blocks.\n");
+                return OPJ_FALSE;
+            }
+        }
+        parameters->rsiz |= OPJ_PROFILE_PART15;
+    }
+
     /*
     copy user encoding parameters
     */
@@ -8487,11 +9103,123 @@ OPJ_BOOL opj_j2k_end_decompress(opj_j2k_t *p_j2k,
     return OPJ_TRUE;
 }
 
+OPJ_BOOL opj_j2k_reset_decompress(opj_j2k_t *p_j2k,
+                                  opj_event_mgr_t * p_manager)
+{
+    opj_j2k_dec_t* l_dec = &(p_j2k->m_specific_param.m_decoder);
+    opj_cp_t l_cp;
+
+    /* preconditions */
+    assert(p_j2k != 00);
+    assert(p_manager != 00);
+
+    if (!p_j2k->m_is_decoder) {
+        opj_event_msg(p_manager, EVT_ERROR,
+                      "Only a decompressor can be reset\n");
+        return OPJ_FALSE;
+    }
+
+    /* Forget everything read from the previous codestream */
+    opj_j2k_tcp_destroy(l_dec->m_default_tcp);
+    memset(l_dec->m_default_tcp, 0, sizeof(opj_tcp_t));
+
+    opj_free(l_dec->m_comps_indices_to_decode);
+    l_dec->m_comps_indices_to_decode = 00;
+    l_dec->m_numcomps_to_decode = 0;
+
+    opj_free(l_dec->m_tlm.m_tile_part_infos);
+    memset(&(l_dec->m_tlm), 0, sizeof(opj_j2k_tlm_info_t));
+
+    opj_free(l_dec->m_intersecting_tile_parts_offset);
+    l_dec->m_intersecting_tile_parts_offset = NULL;
+    l_dec->m_idx_intersecting_tile_parts = 0;
+    l_dec->m_num_intersecting_tile_parts = 0;
+
+    l_dec->m_state = J2K_STATE_NONE;
+    l_dec->m_sot_length = 0;
+    l_dec->m_start_tile_x = 0;
+    l_dec->m_start_tile_y = 0;
+    l_dec->m_end_tile_x = 0;
+    l_dec->m_end_tile_y = 0;
+    l_dec->m_tile_ind_to_dec = -1;
+    l_dec->m_last_sot_read_pos = 0;
+    l_dec->m_last_tile_part = 0;
+    l_dec->m_can_decode = 0;
+    l_dec->m_discard_tiles = 0;
+    l_dec->m_skip_data = 0;
+    l_dec->m_nb_tile_parts_correction = 0;
+#ifdef OPJ_DISABLE_TPSOT_FIX
+    l_dec->m_nb_tile_parts_correction_checked = 1;
+#else
+    l_dec->m_nb_tile_parts_correction_checked = p_j2k->m_cp.strict ? 1 : 0;
+#endif
+
+    /* Keep the decoding parameters set by the user, but not the coding */
+    /* parameters of the previous codestream */
+    l_cp = p_j2k->m_cp;
+    opj_j2k_cp_destroy(&(p_j2k->m_cp));
+    memset(&(p_j2k->m_cp), 0, sizeof(opj_cp_t));
+    p_j2k->m_cp.m_specific_param.m_dec = l_cp.m_specific_param.m_dec;
+    p_j2k->m_cp.strict = l_cp.strict;
+    p_j2k->m_cp.m_is_decoder = 1;
+    p_j2k->m_cp.allow_different_bit_depth_sign = 1;
+#ifdef USE_JPWL
+    p_j2k->m_cp.correct = l_cp.correct;
+    p_j2k->m_cp.exp_comps = l_cp.exp_comps;
+    p_j2k->m_cp.max_tiles = l_cp.max_tiles;
+#endif /* USE_JPWL */
+
+    j2k_destroy_cstr_index(p_j2k->cstr_index);
+    p_j2k->cstr_index = opj_j2k_create_cstr_index();
+    if (!p_j2k->cstr_index) {
+        opj_event_msg(p_manager, EVT_ERROR,
+                      "Not enough memory to reset the decoder\n");
+        return OPJ_FALSE;
+    }
+
+    opj_image_destroy(p_j2k->m_private_image);
+    p_j2k->m_private_image = NULL;
+
+    opj_image_destroy(p_j2k->m_output_image);
+    p_j2k->m_output_image = NULL;
+
+    /* The cached code-blocks belong to the previous codestream */
+    if (l_dec->m_cblk_cache) {
+        opj_cblk_cache_clear(l_dec->m_cblk_cache);
+    }
+
+    p_j2k->m_current_tile_number = 0;
+    p_j2k->ihdr_w = 0;
+    p_j2k->ihdr_h = 0;
+
+    /* The tile decoder, with its arena and the buffers of the tile */
+    /* components, is kept for the next codestream. It no longer refers to */
+    /* the image and coding parameters that have just been freed */
+    if (p_j2k->m_tcd) {
+        p_j2k->m_tcd->image = NULL;
+        p_j2k->m_tcd->cp = NULL;
+        p_j2k->m_tcd->tcp = NULL;
+        p_j2k->m_tcd->stats = NULL;
+        opj_free(p_j2k->m_tcd->used_component);
+        p_j2k->m_tcd->used_component = NULL;
+    }
+
+    /* Statistics are collected per codestream */
+    if (l_dec->m_stats_enabled) {
+        return opj_j2k_enable_stats(p_j2k, OPJ_TRUE, p_manager);
+    }
+    return OPJ_TRUE;
+}
+
 OPJ_BOOL opj_j2k_read_header(opj_stream_private_t *p_stream,
                              opj_j2k_t* p_j2k,
                              opj_image_t** p_image,
                              opj_event_mgr_t* p_manager)
 {
+    opj_j2k_dec_t* l_dec = &(p_j2k->m_specific_param.m_decoder);
+    opj_stage_time_t l_start;
+    OPJ_OFF_T l_header_start = 0;
+
     /* preconditions */
     assert(p_j2k != 00);
     assert(p_stream != 00);
@@ -8525,11 +9253,20 @@ OPJ_BOOL opj_j2k_read_header(opj_stream_private_t *p_stream,
     }
 
     /* read header */
+    if (l_dec->m_stats_enabled) {
+        l_header_start = opj_stream_tell(p_stream);
+        opj_stage_time_start(&l_start);
+    }
     if (! opj_j2k_exec(p_j2k, p_j2k->m_procedure_list, p_stream, p_manager)) {
         opj_image_destroy(p_j2k->m_private_image);
         p_j2k->m_private_image = NULL;
         return OPJ_FALSE;
     }
+    if (l_dec->m_stats_enabled) {
+        opj_stage_time_add_since(&(l_dec->m_stats_header_time), &l_start);
+        l_dec->m_stats_header_size += (OPJ_UINT64)(opj_stream_tell(p_stream) -
+                                      l_header_start);
+    }
 
     *p_image = opj_image_create0();
     if (!(*p_image)) {
@@ -9324,8 +10061,23 @@ static OPJ_BOOL opj_j2k_copy_default_tcp_and_create_tcd(opj_j2k_t * p_j2k,
         ++l_tcp;
     }
 
+    /* Reuse the tile decoder kept by opj_j2k_reset_decompress() if it has */
+    /* been set up for the same number of components. Everything else in */
+    /* it is set up again for each tile from the new coding parameters */
+    if (p_j2k->m_tcd) {
+        if (p_j2k->m_tcd->tcd_image->tiles->numcomps == l_image->numcomps) {
+            p_j2k->m_tcd->image = l_image;
+            p_j2k->m_tcd->cp = &(p_j2k->m_cp);
+            return OPJ_TRUE;
+        }
+        opj_tcd_destroy(p_j2k->m_tcd);
+        p_j2k->m_tcd = 00;
+    }
+
     /* Create the current tile decoder*/
-    p_j2k->m_tcd = opj_tcd_create(OPJ_TRUE);
+    p_j2k->m_tcd = opj_tcd_create(OPJ_TRUE,
+                                  &(p_j2k->m_specific_param.m_decoder.m_allocator),
+                                  p_j2k->m_specific_param.m_decoder.m_mem_counter);
     if (! p_j2k->m_tcd) {
         return OPJ_FALSE;
     }
@@ -9382,6 +10134,12 @@ void opj_j2k_destroy(opj_j2k_t *p_j2k)
         opj_free(p_j2k->m_specific_param.m_decoder.m_intersecting_tile_parts_offset);
         p_j2k->m_specific_param.m_decoder.m_intersecting_tile_parts_offset = NULL;
 
+        opj_free(p_j2k->m_specific_param.m_decoder.m_stats.tiles);
+        p_j2k->m_specific_param.m_decoder.m_stats.tiles = NULL;
+
+        opj_cblk_cache_destroy(p_j2k->m_specific_param.m_decoder.m_cblk_cache);
+        p_j2k->m_specific_param.m_decoder.m_cblk_cache = NULL;
+
     } else {
 
         if (p_j2k->m_specific_param.m_encoder.m_encoded_tile_data) {
@@ -9425,6 +10183,11 @@ void opj_j2k_destroy(opj_j2k_t *p_j2k)
     opj_thread_pool_destroy(p_j2k->m_tp);
     p_j2k->m_tp = NULL;
 
+    /* Last, as the tile decoders and the code-block cache update it */
+    if (p_j2k->m_is_decoder) {
+        opj_mem_counter_destroy(p_j2k->m_specific_param.m_decoder.m_mem_counter);
+    }
+
     opj_free(p_j2k);
 }
 
@@ -9541,10 +10304,34 @@ static void opj_j2k_tcp_destroy(opj_tcp_t *p_tcp)
 static void opj_j2k_tcp_data_destroy(opj_tcp_t *p_tcp)
 {
     if (p_tcp->m_data) {
-        opj_free(p_tcp->m_data);
+        if (! p_tcp->m_data_borrowed) {
+            opj_free(p_tcp->m_data);
+        }
         p_tcp->m_data = NULL;
         p_tcp->m_data_size = 0;
     }
+    p_tcp->m_data_borrowed = 0;
+    if (p_tcp->m_packet_lengths) {
+        opj_free(p_tcp->m_packet_lengths);
+        p_tcp->m_packet_lengths = NULL;
+    }
+    p_tcp->m_nb_packet_lengths = 0;
+    p_tcp->m_max_packet_lengths = 0;
+    p_tcp->m_packet_lengths_tp_start = 0;
+    p_tcp->m_packet_lengths_invalid = 0;
+    p_tcp->m_data_truncated = 0;
+}
+
+static void opj_j2k_set_tcd_packet_lengths(opj_tcd_t *p_tcd,
+        const opj_tcp_t *p_tcp)
+{
+    if (p_tcp->m_packet_lengths_invalid) {
+        p_tcd->packet_lengths = NULL;
+        p_tcd->nb_packet_lengths = 0;
+    } else {
+        p_tcd->packet_lengths = p_tcp->m_packet_lengths;
+        p_tcd->nb_packet_lengths = p_tcp->m_nb_packet_lengths;
+    }
 }
 
 static void opj_j2k_cp_destroy(opj_cp_t *p_cp)
@@ -9698,15 +10485,17 @@ static OPJ_BOOL opj_j2k_need_nb_tile_parts_correction(opj_stream_private_t
     return OPJ_TRUE;
 }
 
-OPJ_BOOL opj_j2k_read_tile_header(opj_j2k_t * p_j2k,
-                                  OPJ_UINT32 * p_tile_index,
-                                  OPJ_UINT32 * p_data_size,
-                                  OPJ_INT32 * p_tile_x0, OPJ_INT32 * p_tile_y0,
-                                  OPJ_INT32 * p_tile_x1, OPJ_INT32 * p_tile_y1,
-                                  OPJ_UINT32 * p_nb_comps,
-                                  OPJ_BOOL * p_go_on,
-                                  opj_stream_private_t *p_stream,
-                                  opj_event_mgr_t * p_manager)
+/** Reads the tile-part headers and data of the next tile, see */
+/** opj_j2k_read_tile_header() */
+static OPJ_BOOL opj_j2k_read_tile_header_internal(opj_j2k_t * p_j2k,
+        OPJ_UINT32 * p_tile_index,
+        OPJ_UINT32 * p_data_size,
+        OPJ_INT32 * p_tile_x0, OPJ_INT32 * p_tile_y0,
+        OPJ_INT32 * p_tile_x1, OPJ_INT32 * p_tile_y1,
+        OPJ_UINT32 * p_nb_comps,
+        OPJ_BOOL * p_go_on,
+        opj_stream_private_t *p_stream,
+        opj_event_mgr_t * p_manager)
 {
     OPJ_UINT32 l_current_marker = J2K_MS_SOT;
     OPJ_UINT32 l_marker_size;
@@ -10110,6 +10899,42 @@ OPJ_BOOL opj_j2k_read_tile_header(opj_j2k_t * p_j2k,
     return OPJ_TRUE;
 }
 
+OPJ_BOOL opj_j2k_read_tile_header(opj_j2k_t * p_j2k,
+                                  OPJ_UINT32 * p_tile_index,
+                                  OPJ_UINT32 * p_data_size,
+                                  OPJ_INT32 * p_tile_x0, OPJ_INT32 * p_tile_y0,
+                                  OPJ_INT32 * p_tile_x1, OPJ_INT32 * p_tile_y1,
+                                  OPJ_UINT32 * p_nb_comps,
+                                  OPJ_BOOL * p_go_on,
+                                  opj_stream_private_t *p_stream,
+                                  opj_event_mgr_t * p_manager)
+{
+    opj_stage_time_t l_start;
+    opj_tile_stats_t* l_tile_stats = NULL;
+    OPJ_BOOL l_ret;
+
+    if (!p_j2k->m_specific_param.m_decoder.m_stats_enabled) {
+        return opj_j2k_read_tile_header_internal(p_j2k, p_tile_index, p_data_size,
+                p_tile_x0, p_tile_y0, p_tile_x1, p_tile_y1, p_nb_comps, p_go_on,
+                p_stream, p_manager);
+    }
+
+    opj_stage_time_start(&l_start);
+    l_ret = opj_j2k_read_tile_header_internal(p_j2k, p_tile_index, p_data_size,
+            p_tile_x0, p_tile_y0, p_tile_x1, p_tile_y1, p_nb_comps, p_go_on,
+            p_stream, p_manager);
+    if (l_ret && *p_go_on) {
+        l_tile_stats = opj_j2k_get_tile_stats(p_j2k, *p_tile_index);
+    }
+    /* The markers read once the last tile has been reached are not */
+    /* accounted to a tile */
+    opj_stage_time_add_since(l_tile_stats ?
+                             &(l_tile_stats->stages[OPJ_STAGE_MARKERS]) :
+                             &(p_j2k->m_specific_param.m_decoder.m_stats_header_time),
+                             &l_start);
+    return l_ret;
+}
+
 OPJ_BOOL opj_j2k_decode_tile(opj_j2k_t * p_j2k,
                              OPJ_UINT32 p_tile_index,
                              OPJ_BYTE * p_data,
@@ -10117,8 +10942,6 @@ OPJ_BOOL opj_j2k_decode_tile(opj_j2k_t * p_j2k,
                              opj_stream_private_t *p_stream,
                              opj_event_mgr_t * p_manager)
 {
-    OPJ_UINT32 l_current_marker;
-    OPJ_BYTE l_data [2];
     opj_tcp_t * l_tcp;
     opj_image_t* l_image_for_bounds;
 
@@ -10145,6 +10968,9 @@ OPJ_BOOL opj_j2k_decode_tile(opj_j2k_t * p_j2k,
     /* but full tile decoding is done */
     l_image_for_bounds = p_j2k->m_output_image ? p_j2k->m_output_image :
                          p_j2k->m_private_image;
+    p_j2k->m_tcd->src_read_only = l_tcp->m_data_borrowed;
+    opj_j2k_set_tcd_packet_lengths(p_j2k->m_tcd, l_tcp);
+    p_j2k->m_tcd->stats = opj_j2k_get_tile_stats(p_j2k, p_tile_index);
     if (! opj_tcd_decode_tile(p_j2k->m_tcd,
                               l_image_for_bounds->x0,
                               l_image_for_bounds->y0,
@@ -10161,14 +10987,25 @@ OPJ_BOOL opj_j2k_decode_tile(opj_j2k_t * p_j2k,
         opj_event_msg(p_manager, EVT_ERROR, "Failed to decode.\n");
         return OPJ_FALSE;
     }
+    if (p_j2k->m_tcd->stats) {
+        p_j2k->m_tcd->stats->decoded = OPJ_TRUE;
+    }
 
     /* p_data can be set to NULL when the call will take care of using */
     /* itself the TCD data. This is typically the case for whole single */
     /* tile decoding optimization. */
     if (p_data != NULL) {
+        opj_stage_time_t l_start;
+        if (p_j2k->m_tcd->stats) {
+            opj_stage_time_start(&l_start);
+        }
         if (! opj_tcd_update_tile_data(p_j2k->m_tcd, p_data, p_data_size)) {
             return OPJ_FALSE;
         }
+        if (p_j2k->m_tcd->stats) {
+            opj_stage_time_add_since(&(p_j2k->m_tcd->stats->stages[OPJ_STAGE_OUTPUT]),
+                                     &l_start);
+        }
 
         /* To avoid to destroy the tcp which can be useful when we try to decode a tile decoded before (cf j2k_random_tile_access)
         * we destroy just the data which will be re-read in read_tile_header*/
@@ -10177,6 +11014,16 @@ OPJ_BOOL opj_j2k_decode_tile(opj_j2k_t * p_j2k,
         opj_j2k_tcp_data_destroy(l_tcp);
     }
 
+    return opj_j2k_move_to_next_tile_header(p_j2k, p_stream, p_manager);
+}
+
+static OPJ_BOOL opj_j2k_move_to_next_tile_header(opj_j2k_t * p_j2k,
+        opj_stream_private_t *p_stream,
+        opj_event_mgr_t * p_manager)
+{
+    OPJ_UINT32 l_current_marker;
+    OPJ_BYTE l_data [2];
+
     p_j2k->m_specific_param.m_decoder.m_can_decode = 0;
     p_j2k->m_specific_param.m_decoder.m_state &= (~(OPJ_UINT32)J2K_STATE_DATA);
 
@@ -10210,7 +11057,9 @@ OPJ_BOOL opj_j2k_decode_tile(opj_j2k_t * p_j2k,
     return OPJ_TRUE;
 }
 
-static OPJ_BOOL opj_j2k_update_image_data(opj_tcd_t * p_tcd,
+/** Copies the decoded tile to the output image, see */
+/** opj_j2k_update_image_data() */
+static OPJ_BOOL opj_j2k_update_image_data_internal(opj_tcd_t * p_tcd,
         opj_image_t* p_output_image)
 {
     OPJ_UINT32 i, j;
@@ -10376,13 +11225,17 @@ static OPJ_BOOL opj_j2k_update_image_data(opj_tcd_t * p_tcd,
                 l_width_dest == l_img_comp_dest->w &&
                 l_height_dest == l_img_comp_dest->h) {
             /* If the final image matches the tile buffer, then borrow it */
-            /* directly to save a copy */
+            /* directly to save a copy. It is no longer held by the */
+            /* decoder */
             if (p_tcd->whole_tile_decoding) {
+                opj_mem_counter_remove(p_tcd->mem_counter, l_tilec->data_size);
                 l_img_comp_dest->data = l_tilec->data;
                 l_tilec->data = NULL;
             } else {
+                opj_mem_counter_remove(p_tcd->mem_counter, l_tilec->data_win_size);
                 l_img_comp_dest->data = l_tilec->data_win;
                 l_tilec->data_win = NULL;
+                l_tilec->data_win_size = 0;
             }
             continue;
         } else if (l_img_comp_dest->data == NULL) {
@@ -10427,6 +11280,21 @@ static OPJ_BOOL opj_j2k_update_image_data(opj_tcd_t * p_tcd,
     return OPJ_TRUE;
 }
 
+OPJ_BOOL opj_j2k_update_image_data(opj_tcd_t * p_tcd,
+                                   opj_image_t* p_output_image)
+{
+    opj_stage_time_t l_start;
+    OPJ_BOOL l_ret;
+
+    if (p_tcd->stats == NULL) {
+        return opj_j2k_update_image_data_internal(p_tcd, p_output_image);
+    }
+    opj_stage_time_start(&l_start);
+    l_ret = opj_j2k_update_image_data_internal(p_tcd, p_output_image);
+    opj_stage_time_add_since(&(p_tcd->stats->stages[OPJ_STAGE_OUTPUT]), &l_start);
+    return l_ret;
+}
+
 static OPJ_BOOL opj_j2k_update_image_dimensions(opj_image_t* p_image,
         opj_event_mgr_t * p_manager)
 {
@@ -10548,6 +11416,10 @@ OPJ_BOOL opj_j2k_set_decode_area(opj_j2k_t *p_j2k,
     OPJ_BOOL ret;
     OPJ_UINT32 it_comp;
 
+    if (!opj_j2k_check_refinement(p_j2k, p_manager)) {
+        return OPJ_FALSE;
+    }
+
     if (p_j2k->m_cp.tw == 1 && p_j2k->m_cp.th == 1 &&
             p_j2k->m_cp.tcps[0].m_data != NULL) {
         /* In the case of a single-tiled image whose codestream we have already */
@@ -10754,6 +11626,12 @@ opj_j2k_t* opj_j2k_create_decompress(void)
         return 00;
     }
 
+    l_j2k->m_specific_param.m_decoder.m_mem_counter = opj_mem_counter_create();
+    if (!l_j2k->m_specific_param.m_decoder.m_mem_counter) {
+        opj_j2k_destroy(l_j2k);
+        return 00;
+    }
+
     l_j2k->m_tp = opj_thread_pool_create(opj_j2k_get_default_thread_count());
     if (!l_j2k->m_tp) {
         l_j2k->m_tp = opj_thread_pool_create(0);
@@ -11948,6 +12826,42 @@ static int CompareOffT(const void* a, const void* b)
     return 1;
 }
 
+/**
+ * Gives the stream the ranges of the tile-parts intersecting the area to
+ * decode, so that it can read them ahead.
+ */
+static void opj_j2k_prefetch_tile_parts(opj_j2k_t *p_j2k,
+                                        opj_stream_private_t *p_stream)
+{
+    OPJ_OFF_T* l_ranges;
+    OPJ_UINT32 l_nb_ranges = 0;
+    OPJ_UINT32 i, j, k;
+
+    l_ranges = (OPJ_OFF_T*)opj_malloc(2 * sizeof(OPJ_OFF_T) *
+                                      p_j2k->m_specific_param.m_decoder.m_num_intersecting_tile_parts);
+    if (l_ranges == NULL) {
+        /* Read-ahead is only an optimization */
+        return;
+    }
+    for (j = p_j2k->m_specific_param.m_decoder.m_start_tile_y;
+            j < p_j2k->m_specific_param.m_decoder.m_end_tile_y; ++j) {
+        for (i = p_j2k->m_specific_param.m_decoder.m_start_tile_x;
+                i < p_j2k->m_specific_param.m_decoder.m_end_tile_x; ++i) {
+            const opj_tile_index_t* l_tile_index =
+                &(p_j2k->cstr_index->tile_index[j * p_j2k->m_cp.tw + i]);
+            for (k = 0; k < l_tile_index->nb_tps; ++k) {
+                l_ranges[2 * l_nb_ranges] = l_tile_index->tp_index[k].start_pos;
+                l_ranges[2 * l_nb_ranges + 1] = l_tile_index->tp_index[k].end_pos;
+                ++l_nb_ranges;
+            }
+        }
+    }
+    /* Sort by increasing start offset */
+    qsort(l_ranges, l_nb_ranges, 2 * sizeof(OPJ_OFF_T), CompareOffT);
+    opj_stream_prefetch(p_stream, l_ranges, l_nb_ranges);
+    opj_free(l_ranges);
+}
+
 static OPJ_BOOL opj_j2k_decode_tiles(opj_j2k_t *p_j2k,
                                      opj_stream_private_t *p_stream,
                                      opj_event_mgr_t * p_manager)
@@ -11960,8 +12874,11 @@ static OPJ_BOOL opj_j2k_decode_tiles(opj_j2k_t *p_j2k,
     OPJ_OFF_T end_pos = 0;
 
     /* Particular case for whole single tile decoding */
-    /* We can avoid allocating intermediate tile buffers */
-    if (p_j2k->m_cp.tw == 1 && p_j2k->m_cp.th == 1 &&
+    /* We can avoid allocating intermediate tile buffers. Not when the */
+    /* image may be refined later, for which the tile is kept */
+    if (p_j2k->m_specific_param.m_decoder.m_strip_fn == NULL &&
+            !p_j2k->m_specific_param.m_decoder.m_refinable &&
+            p_j2k->m_cp.tw == 1 && p_j2k->m_cp.th == 1 &&
             p_j2k->m_cp.tx0 == 0 && p_j2k->m_cp.ty0 == 0 &&
             p_j2k->m_output_image->x0 == 0 &&
             p_j2k->m_output_image->y0 == 0 &&
@@ -12068,9 +12985,26 @@ static OPJ_BOOL opj_j2k_decode_tiles(opj_j2k_t *p_j2k,
                   p_j2k->m_specific_param.m_decoder.m_num_intersecting_tile_parts,
                   sizeof(OPJ_OFF_T),
                   CompareOffT);
+
+            if (opj_stream_has_prefetch(p_stream)) {
+                opj_j2k_prefetch_tile_parts(p_j2k, p_stream);
+            }
         }
     }
 
+    if (p_j2k->m_specific_param.m_decoder.m_strip_fn != NULL) {
+        return opj_j2k_decode_tiles_by_strips(p_j2k, end_pos, p_stream, p_manager);
+    }
+
+    /* Decode several tiles concurrently if asked to. This is not possible */
+    /* with a PPM marker, whose packet headers must be consumed in tile order */
+    if (p_j2k->m_specific_param.m_decoder.m_max_tiles_in_flight > 1 &&
+            opj_thread_pool_get_thread_count(p_j2k->m_tp) > 1 &&
+            p_j2k->m_cp.tw * p_j2k->m_cp.th > 1 &&
+            !p_j2k->m_cp.ppm) {
+        return opj_j2k_decode_tiles_parallel(p_j2k, end_pos, p_stream, p_manager);
+    }
+
     for (;;) {
         if (p_j2k->m_cp.tw == 1 && p_j2k->m_cp.th == 1 &&
                 p_j2k->m_cp.tcps[0].m_data != NULL) {
@@ -12111,10 +13045,11 @@ static OPJ_BOOL opj_j2k_decode_tiles(opj_j2k_t *p_j2k,
         }
 
         if (p_j2k->m_cp.tw == 1 && p_j2k->m_cp.th == 1 &&
-                !(p_j2k->m_output_image->x0 == p_j2k->m_private_image->x0 &&
-                  p_j2k->m_output_image->y0 == p_j2k->m_private_image->y0 &&
-                  p_j2k->m_output_image->x1 == p_j2k->m_private_image->x1 &&
-                  p_j2k->m_output_image->y1 == p_j2k->m_private_image->y1)) {
+                (p_j2k->m_specific_param.m_decoder.m_refinable ||
+                 !(p_j2k->m_output_image->x0 == p_j2k->m_private_image->x0 &&
+                   p_j2k->m_output_image->y0 == p_j2k->m_private_image->y0 &&
+                   p_j2k->m_output_image->x1 == p_j2k->m_private_image->x1 &&
+                   p_j2k->m_output_image->y1 == p_j2k->m_private_image->y1))) {
             /* Keep current tcp data */
         } else {
             opj_j2k_tcp_data_destroy(&p_j2k->m_cp.tcps[l_current_tile_no]);
@@ -12145,42 +13080,1012 @@ static OPJ_BOOL opj_j2k_decode_tiles(opj_j2k_t *p_j2k,
     return OPJ_TRUE;
 }
 
-/**
- * Sets up the procedures to do on decoding data. Developers wanting to extend the library can add their own reading procedures.
- */
-static OPJ_BOOL opj_j2k_setup_decoding(opj_j2k_t *p_j2k,
-                                       opj_event_mgr_t * p_manager)
+/** Decoding context of one of the tiles decoded concurrently */
+typedef struct opj_j2k_tile_decode_job {
+    opj_j2k_t* j2k;
+    /** Tile decoder owned by this job slot */
+    opj_tcd_t* tcd;
+    /** Thread pool with no worker, so that T1 and DWT run in the worker
+     * thread that decodes the tile */
+    opj_thread_pool_t* tp;
+    /** Image header used by tcd, so that resno_decoded is not shared */
+    opj_image_t* tcd_image;
+    /** Header of the output image, whose component data points to the
+     * buffers of j2k->m_output_image */
+    opj_image_t* output_view;
+    opj_event_mgr_t* p_manager;
+    /** Mutex protecting busy */
+    opj_mutex_t* mutex;
+    /** Signaled when a job slot becomes available */
+    opj_cond_t* cond;
+    OPJ_UINT32 tile_no;
+    /** Compressed data of the tile, owned by the job unless data_borrowed */
+    OPJ_BYTE* data;
+    OPJ_UINT32 data_size;
+    /** Whether data points into the memory of the stream */
+    OPJ_BOOL data_borrowed;
+    /** Lengths of the packets of data, owned by the job, or NULL */
+    OPJ_UINT32* packet_lengths;
+    OPJ_UINT32 nb_packet_lengths;
+    OPJ_BOOL busy;
+    OPJ_BOOL has_result;
+    OPJ_BOOL ret;
+} opj_j2k_tile_decode_job_t;
+
+static void opj_j2k_tile_decode_job_free_data(opj_j2k_tile_decode_job_t* job)
 {
-    /* preconditions*/
-    assert(p_j2k != 00);
-    assert(p_manager != 00);
+    if (!job->data_borrowed) {
+        opj_free(job->data);
+    }
+    job->data = NULL;
+    job->data_size = 0;
+    job->data_borrowed = OPJ_FALSE;
+    opj_free(job->packet_lengths);
+    job->packet_lengths = NULL;
+    job->nb_packet_lengths = 0;
+}
 
-    if (! opj_procedure_list_add_procedure(p_j2k->m_procedure_list,
-                                           (opj_procedure)opj_j2k_decode_tiles, p_manager)) {
-        return OPJ_FALSE;
+static void opj_j2k_decode_tile_job(void* user_data, opj_tls_t* tls)
+{
+    opj_j2k_tile_decode_job_t* job = (opj_j2k_tile_decode_job_t*)user_data;
+    opj_j2k_t* p_j2k = job->j2k;
+    opj_image_t* l_output_image = p_j2k->m_output_image;
+    const OPJ_UINT32 l_nb_tiles = p_j2k->m_cp.tw * p_j2k->m_cp.th;
+
+    (void)tls;
+
+    job->tcd->src_read_only = job->data_borrowed;
+    job->tcd->packet_lengths = job->packet_lengths;
+    job->tcd->nb_packet_lengths = job->nb_packet_lengths;
+    job->ret = opj_tcd_decode_tile(job->tcd,
+                                   l_output_image->x0,
+                                   l_output_image->y0,
+                                   l_output_image->x1,
+                                   l_output_image->y1,
+                                   p_j2k->m_specific_param.m_decoder.m_numcomps_to_decode,
+                                   p_j2k->m_specific_param.m_decoder.m_comps_indices_to_decode,
+                                   job->data,
+                                   job->data_size,
+                                   job->tile_no,
+                                   p_j2k->cstr_index, job->p_manager);
+    opj_j2k_tile_decode_job_free_data(job);
+
+    if (!job->ret) {
+        opj_event_msg(job->p_manager, EVT_ERROR, "Failed to decode.\n");
+        opj_event_msg(job->p_manager, EVT_ERROR, "Failed to decode tile %d/%d\n",
+                      job->tile_no + 1, l_nb_tiles);
+    } else {
+        opj_event_msg(job->p_manager, EVT_INFO, "Tile %d/%d has been decoded.\n",
+                      job->tile_no + 1, l_nb_tiles);
+        if (job->tcd->stats) {
+            job->tcd->stats->decoded = OPJ_TRUE;
+        }
+
+        /* Tiles cover disjoint areas of the output image, whose buffers */
+        /* have been allocated before the job was submitted */
+        job->ret = opj_j2k_update_image_data(job->tcd, job->output_view);
+        if (job->ret) {
+            opj_event_msg(job->p_manager, EVT_INFO,
+                          "Image data has been updated with tile %d.\n\n", job->tile_no + 1);
+        }
     }
-    /* DEVELOPER CORNER, add your custom procedures */
 
-    return OPJ_TRUE;
+    opj_mutex_lock(job->mutex);
+    job->busy = OPJ_FALSE;
+    job->has_result = OPJ_TRUE;
+    opj_cond_signal(job->cond);
+    opj_mutex_unlock(job->mutex);
 }
 
-/*
- * Read and decode one tile.
+/**
+ * Allocates the buffers of the components of an output image that are
+ * going to be written by the tiles, as opj_j2k_update_image_data() would do
+ * it lazily for the first tile. Buffers already allocated, and empty
+ * components, are left as they are. New buffers are zero-initialized.
  */
-static OPJ_BOOL opj_j2k_decode_one_tile(opj_j2k_t *p_j2k,
-                                        opj_stream_private_t *p_stream,
-                                        opj_event_mgr_t * p_manager)
+static OPJ_BOOL opj_j2k_alloc_output_image_data(opj_j2k_t *p_j2k,
+        opj_image_t* p_image)
 {
-    OPJ_BOOL l_go_on = OPJ_TRUE;
-    OPJ_UINT32 l_current_tile_no;
-    OPJ_UINT32 l_tile_no_to_dec;
-    OPJ_INT32 l_tile_x0, l_tile_y0, l_tile_x1, l_tile_y1;
-    OPJ_UINT32 l_nb_comps;
-    OPJ_UINT32 l_nb_tiles;
-    OPJ_UINT32 i;
+    OPJ_UINT32 compno;
 
-    /* Move into the codestream to the first SOT used to decode the desired tile */
-    l_tile_no_to_dec = (OPJ_UINT32)
+    for (compno = 0; compno < p_image->numcomps; compno++) {
+        opj_image_comp_t* l_img_comp = &(p_image->comps[compno]);
+        OPJ_SIZE_T l_width = l_img_comp->w;
+        OPJ_SIZE_T l_height = l_img_comp->h;
+
+        if (l_img_comp->data != NULL || l_width == 0 || l_height == 0) {
+            continue;
+        }
+        if (p_j2k->m_specific_param.m_decoder.m_numcomps_to_decode) {
+            OPJ_UINT32 i;
+            for (i = 0; i < p_j2k->m_specific_param.m_decoder.m_numcomps_to_decode; i++) {
+                if (p_j2k->m_specific_param.m_decoder.m_comps_indices_to_decode[i] ==
+                        compno) {
+                    break;
+                }
+            }
+            if (i == p_j2k->m_specific_param.m_decoder.m_numcomps_to_decode) {
+                continue;
+            }
+        }
+
+        if ((l_width > (SIZE_MAX / l_height)) ||
+                l_width * l_height > SIZE_MAX / sizeof(OPJ_INT32)) {
+            /* would overflow */
+            return OPJ_FALSE;
+        }
+        l_img_comp->data = (OPJ_INT32*) opj_image_data_alloc(l_width * l_height *
+                           sizeof(OPJ_INT32));
+        if (! l_img_comp->data) {
+            return OPJ_FALSE;
+        }
+        memset(l_img_comp->data, 0, l_width * l_height * sizeof(OPJ_INT32));
+    }
+    return OPJ_TRUE;
+}
+
+static void opj_j2k_destroy_tile_decode_jobs(opj_j2k_tile_decode_job_t* p_jobs,
+        OPJ_UINT32 p_nb_jobs)
+{
+    OPJ_UINT32 i;
+    for (i = 0; i < p_nb_jobs; i++) {
+        opj_j2k_tile_decode_job_t* job = &(p_jobs[i]);
+        opj_tcd_destroy(job->tcd);
+        opj_thread_pool_destroy(job->tp);
+        opj_image_destroy(job->tcd_image);
+        if (job->output_view) {
+            OPJ_UINT32 compno;
+            /* The buffers belong to m_output_image */
+            for (compno = 0; compno < job->output_view->numcomps; compno++) {
+                job->output_view->comps[compno].data = NULL;
+            }
+            opj_image_destroy(job->output_view);
+        }
+        opj_j2k_tile_decode_job_free_data(job);
+    }
+    opj_free(p_jobs);
+}
+
+static OPJ_BOOL opj_j2k_decode_tiles_parallel(opj_j2k_t *p_j2k,
+        OPJ_OFF_T p_end_pos,
+        opj_stream_private_t *p_stream,
+        opj_event_mgr_t * p_manager)
+{
+    OPJ_BOOL l_go_on = OPJ_TRUE;
+    OPJ_BOOL l_ret = OPJ_TRUE;
+    OPJ_BOOL l_output_allocated = OPJ_FALSE;
+    OPJ_UINT32 l_current_tile_no;
+    OPJ_INT32 l_tile_x0, l_tile_y0, l_tile_x1, l_tile_y1;
+    OPJ_UINT32 l_nb_comps;
+    OPJ_UINT32 nr_tiles = 0;
+    const OPJ_UINT32 l_nb_tiles = p_j2k->m_cp.tw * p_j2k->m_cp.th;
+    OPJ_UINT32 l_nb_jobs;
+    OPJ_UINT32 i;
+    opj_j2k_tile_decode_job_t* l_jobs = NULL;
+    opj_mutex_t* l_mutex = NULL;
+    opj_cond_t* l_cond = NULL;
+    opj_locked_event_mgr_t l_locked_event_mgr;
+
+    l_nb_jobs = opj_uint_min(p_j2k->m_specific_param.m_decoder.m_max_tiles_in_flight,
+                             l_nb_tiles);
+
+    l_mutex = opj_mutex_create();
+    l_cond = opj_cond_create();
+    l_jobs = (opj_j2k_tile_decode_job_t*) opj_calloc(l_nb_jobs,
+             sizeof(opj_j2k_tile_decode_job_t));
+    if (l_mutex == NULL || l_cond == NULL || l_jobs == NULL) {
+        opj_free(l_jobs);
+        opj_cond_destroy(l_cond);
+        opj_mutex_destroy(l_mutex);
+        opj_event_msg(p_manager, EVT_ERROR, "Not enough memory to decode tiles\n");
+        return OPJ_FALSE;
+    }
+    opj_locked_event_mgr_init(&l_locked_event_mgr, p_manager, l_mutex);
+
+    for (i = 0; i < l_nb_jobs; i++) {
+        opj_j2k_tile_decode_job_t* job = &(l_jobs[i]);
+        job->j2k = p_j2k;
+        job->p_manager = &(l_locked_event_mgr.m_event_mgr);
+        job->mutex = l_mutex;
+        job->cond = l_cond;
+        job->tp = opj_thread_pool_create(0);
+        job->tcd_image = opj_image_create0();
+        job->tcd = opj_tcd_create(OPJ_TRUE,
+                                  &(p_j2k->m_specific_param.m_decoder.m_allocator),
+                                  p_j2k->m_specific_param.m_decoder.m_mem_counter);
+        if (job->tp == NULL || job->tcd_image == NULL || job->tcd == NULL) {
+            l_ret = OPJ_FALSE;
+            break;
+        }
+        opj_copy_image_header(p_j2k->m_private_image, job->tcd_image);
+        if (job->tcd_image->comps == NULL ||
+                !opj_tcd_init(job->tcd, job->tcd_image, &(p_j2k->m_cp), job->tp)) {
+            l_ret = OPJ_FALSE;
+            break;
+        }
+    }
+    if (!l_ret) {
+        opj_j2k_destroy_tile_decode_jobs(l_jobs, l_nb_jobs);
+        opj_cond_destroy(l_cond);
+        opj_mutex_destroy(l_mutex);
+        opj_event_msg(p_manager, EVT_ERROR, "Not enough memory to decode tiles\n");
+        return OPJ_FALSE;
+    }
+
+    for (;;) {
+        opj_j2k_tile_decode_job_t* job = NULL;
+        opj_tcd_t* l_tcd;
+        opj_tcp_t* l_tcp;
+        OPJ_BOOL l_failed = OPJ_FALSE;
+
+        /* Wait for a job slot to be available */
+        opj_mutex_lock(l_mutex);
+        for (;;) {
+            for (i = 0; i < l_nb_jobs; i++) {
+                if (l_jobs[i].has_result && !l_jobs[i].ret) {
+                    l_failed = OPJ_TRUE;
+                }
+                if (job == NULL && !l_jobs[i].busy) {
+                    job = &(l_jobs[i]);
+                }
+            }
+            if (job != NULL || l_failed) {
+                break;
+            }
+            opj_cond_wait(l_cond, l_mutex);
+        }
+        opj_mutex_unlock(l_mutex);
+        if (l_failed) {
+            l_ret = OPJ_FALSE;
+            break;
+        }
+
+        /* Read the header of the next tile in the tile decoder of the */
+        /* slot, so that opj_tcd_init_decode_tile() sets it up */
+        l_tcd = p_j2k->m_tcd;
+        p_j2k->m_tcd = job->tcd;
+        if (! opj_j2k_read_tile_header(p_j2k,
+                                       &l_current_tile_no,
+                                       NULL,
+                                       &l_tile_x0, &l_tile_y0,
+                                       &l_tile_x1, &l_tile_y1,
+                                       &l_nb_comps,
+                                       &l_go_on,
+                                       p_stream,
+                                       p_manager)) {
+            p_j2k->m_tcd = l_tcd;
+            l_ret = OPJ_FALSE;
+            break;
+        }
+        p_j2k->m_tcd = l_tcd;
+
+        if (! l_go_on) {
+            break;
+        }
+
+        l_tcp = &(p_j2k->m_cp.tcps[l_current_tile_no]);
+        if (! l_tcp->m_data) {
+            opj_j2k_tcp_destroy(l_tcp);
+            opj_event_msg(p_manager, EVT_ERROR, "Failed to decode tile %d/%d\n",
+                          l_current_tile_no + 1, l_nb_tiles);
+            l_ret = OPJ_FALSE;
+            break;
+        }
+
+        if (!l_output_allocated) {
+            if (!opj_j2k_alloc_output_image_data(p_j2k, p_j2k->m_output_image)) {
+                opj_event_msg(p_manager, EVT_ERROR,
+                              "Not enough memory to decode tiles\n");
+                l_ret = OPJ_FALSE;
+                break;
+            }
+            for (i = 0; i < l_nb_jobs; i++) {
+                OPJ_UINT32 compno;
+                opj_image_t* l_view = opj_image_create0();
+                if (l_view == NULL) {
+                    l_ret = OPJ_FALSE;
+                    break;
+                }
+                l_jobs[i].output_view = l_view;
+                opj_copy_image_header(p_j2k->m_output_image, l_view);
+                if (l_view->comps == NULL) {
+                    l_ret = OPJ_FALSE;
+                    break;
+                }
+                for (compno = 0; compno < l_view->numcomps; compno++) {
+                    l_view->comps[compno].data = p_j2k->m_output_image->comps[compno].data;
+                }
+            }
+            if (!l_ret) {
+                opj_event_msg(p_manager, EVT_ERROR,
+                              "Not enough memory to decode tiles\n");
+                break;
+            }
+            l_output_allocated = OPJ_TRUE;
+        }
+
+        /* The job takes ownership of the tile data, so that the tile */
+        /* is not considered again by opj_j2k_read_tile_header() */
+        job->tile_no = l_current_tile_no;
+        job->data = l_tcp->m_data;
+        job->data_size = l_tcp->m_data_size;
+        job->data_borrowed = l_tcp->m_data_borrowed;
+        job->packet_lengths = l_tcp->m_packet_lengths;
+        job->nb_packet_lengths = l_tcp->m_packet_lengths_invalid ? 0 :
+                                 l_tcp->m_nb_packet_lengths;
+        job->tcd->stats = opj_j2k_get_tile_stats(p_j2k, l_current_tile_no);
+        l_tcp->m_data = NULL;
+        l_tcp->m_data_size = 0;
+        l_tcp->m_data_borrowed = 0;
+        l_tcp->m_packet_lengths = NULL;
+        l_tcp->m_nb_packet_lengths = 0;
+        l_tcp->m_max_packet_lengths = 0;
+
+        if (! opj_j2k_move_to_next_tile_header(p_j2k, p_stream, p_manager)) {
+            opj_j2k_tile_decode_job_free_data(job);
+            opj_event_msg(p_manager, EVT_ERROR, "Failed to decode tile %d/%d\n",
+                          l_current_tile_no + 1, l_nb_tiles);
+            l_ret = OPJ_FALSE;
+            break;
+        }
+
+        job->busy = OPJ_TRUE;
+        job->has_result = OPJ_FALSE;
+        if (!opj_thread_pool_submit_job(p_j2k->m_tp, opj_j2k_decode_tile_job, job)) {
+            job->busy = OPJ_FALSE;
+            opj_j2k_tile_decode_job_free_data(job);
+            l_ret = OPJ_FALSE;
+            break;
+        }
+
+        if (opj_stream_get_number_byte_left(p_stream) == 0
+                && p_j2k->m_specific_param.m_decoder.m_state == J2K_STATE_NEOC) {
+            break;
+        }
+        if (++nr_tiles == l_nb_tiles) {
+            break;
+        }
+        if (p_j2k->m_specific_param.m_decoder.m_num_intersecting_tile_parts > 0 &&
+                p_j2k->m_specific_param.m_decoder.m_idx_intersecting_tile_parts ==
+                p_j2k->m_specific_param.m_decoder.m_num_intersecting_tile_parts) {
+            opj_stream_seek(p_stream, p_end_pos + 2, p_manager);
+            break;
+        }
+    }
+
+    /* Wait for all tiles in flight */
+    opj_mutex_lock(l_mutex);
+    for (;;) {
+        for (i = 0; i < l_nb_jobs; i++) {
+            if (l_jobs[i].busy) {
+                break;
+            }
+        }
+        if (i == l_nb_jobs) {
+            break;
+        }
+        opj_cond_wait(l_cond, l_mutex);
+    }
+    opj_mutex_unlock(l_mutex);
+    /* Make sure that the job functions have returned */
+    opj_thread_pool_wait_completion(p_j2k->m_tp, 0);
+
+    for (i = 0; i < l_nb_jobs; i++) {
+        if (l_jobs[i].has_result) {
+            if (!l_jobs[i].ret) {
+                l_ret = OPJ_FALSE;
+            } else if (l_jobs[i].output_view) {
+                OPJ_UINT32 compno;
+                for (compno = 0; compno < l_jobs[i].output_view->numcomps; compno++) {
+                    p_j2k->m_output_image->comps[compno].resno_decoded =
+                        l_jobs[i].output_view->comps[compno].resno_decoded;
+                }
+            }
+        }
+    }
+    if (!l_ret) {
+        p_j2k->m_specific_param.m_decoder.m_state |= J2K_STATE_ERR;
+    }
+
+    opj_j2k_destroy_tile_decode_jobs(l_jobs, l_nb_jobs);
+    opj_cond_destroy(l_cond);
+    opj_mutex_destroy(l_mutex);
+
+    if (!l_ret) {
+        return OPJ_FALSE;
+    }
+
+    if (! opj_j2k_are_all_used_components_decoded(p_j2k, p_manager)) {
+        return OPJ_FALSE;
+    }
+
+    return OPJ_TRUE;
+}
+
+/** Tile of the decoded area, in opj_j2k_decode_tiles_by_strips() */
+typedef struct opj_j2k_strip_tile {
+    /** Tile decoder whose decoding by strips has been started, or NULL */
+    /* if the tile has not been read */
+    opj_tcd_t *m_tcd;
+    /** Compressed data of the tile, which the code-blocks of m_tcd point */
+    /* to, or NULL if it is kept by the tile coding parameters */
+    OPJ_BYTE *m_data;
+    /** Whether m_data is borrowed from the stream */
+    OPJ_BOOL m_data_borrowed;
+} opj_j2k_strip_tile_t;
+
+/** State of opj_j2k_decode_tiles_by_strips() */
+typedef struct opj_j2k_strip_decoder {
+    opj_j2k_t *m_j2k;
+    opj_event_mgr_t *m_manager;
+    /** Strip passed to the user function. Its component buffers point to */
+    /* the ones of a band */
+    opj_image_t *m_strip;
+    /** Height of the strips, in the reference grid */
+    OPJ_UINT32 m_strip_height;
+    /** Number of tile columns and rows intersecting the decoded area */
+    OPJ_UINT32 m_nb_tile_cols;
+    OPJ_UINT32 m_nb_tile_rows;
+    /** Tiles intersecting the decoded area, row by row */
+    opj_j2k_strip_tile_t *m_tiles;
+    /** Number of tiles read in each tile row */
+    OPJ_UINT32 *m_rows_nb_tiles;
+    /** Tile decoders not used by a tile. The first one is m_j2k->m_tcd */
+    opj_tcd_t **m_free_tcds;
+    OPJ_UINT32 m_nb_free_tcds;
+    /** Number of tile decoders created by opj_j2k_get_strip_tcd() */
+    OPJ_UINT32 m_nb_tcds;
+    /** Index of the next tile row to emit */
+    OPJ_UINT32 m_next_row;
+} opj_j2k_strip_decoder_t;
+
+/**
+ * Returns the index of the codestream component that matches the given
+ * component of the strips.
+ */
+static OPJ_UINT32 opj_j2k_get_strip_compno(opj_j2k_t *p_j2k,
+        OPJ_UINT32 p_strip_compno)
+{
+    if (p_j2k->m_specific_param.m_decoder.m_numcomps_to_decode) {
+        return p_j2k->m_specific_param.m_decoder.m_comps_indices_to_decode[p_strip_compno];
+    }
+    return p_strip_compno;
+}
+
+/**
+ * Creates an image with the header of the output image, restricted to the
+ * given rows of the reference grid. Component buffers are not allocated.
+ */
+static opj_image_t* opj_j2k_create_strip_band(opj_j2k_t *p_j2k,
+        OPJ_UINT32 p_y0,
+        OPJ_UINT32 p_y1,
+        opj_event_mgr_t * p_manager)
+{
+    opj_image_t* l_band = opj_image_create0();
+    if (l_band == NULL) {
+        return NULL;
+    }
+    opj_copy_image_header(p_j2k->m_output_image, l_band);
+    if (l_band->comps == NULL) {
+        opj_image_destroy(l_band);
+        return NULL;
+    }
+    l_band->y0 = p_y0;
+    l_band->y1 = p_y1;
+    if (!opj_j2k_update_image_dimensions(l_band, p_manager)) {
+        opj_image_destroy(l_band);
+        return NULL;
+    }
+    return l_band;
+}
+
+/**
+ * Passes the rows of a band to the user function, by strips.
+ */
+static OPJ_BOOL opj_j2k_emit_strips(opj_j2k_strip_decoder_t *p_dec,
+                                    const opj_image_t *p_band)
+{
+    opj_j2k_t *l_j2k = p_dec->m_j2k;
+    opj_image_t *l_strip = p_dec->m_strip;
+    OPJ_UINT32 l_y0 = p_band->y0;
+    OPJ_UINT32 compno;
+
+    for (compno = 0; compno < l_strip->numcomps; compno++) {
+        OPJ_UINT32 l_band_compno = opj_j2k_get_strip_compno(l_j2k, compno);
+        l_j2k->m_output_image->comps[l_band_compno].resno_decoded =
+            p_band->comps[l_band_compno].resno_decoded;
+        l_strip->comps[compno].resno_decoded =
+            p_band->comps[l_band_compno].resno_decoded;
+    }
+
+    while (l_y0 < p_band->y1) {
+        /* Strips are aligned on the top of the decoded area */
+        OPJ_UINT32 l_y1 = opj_uint_adds(l_y0, p_dec->m_strip_height -
+                                        (l_y0 - l_j2k->m_output_image->y0) % p_dec->m_strip_height);
+        OPJ_BOOL l_empty = OPJ_TRUE;
+
+        l_y1 = opj_uint_min(l_y1, p_band->y1);
+        l_strip->y0 = l_y0;
+        l_strip->y1 = l_y1;
+        for (compno = 0; compno < l_strip->numcomps; compno++) {
+            opj_image_comp_t* l_strip_comp = &(l_strip->comps[compno]);
+            const opj_image_comp_t* l_band_comp =
+                &(p_band->comps[opj_j2k_get_strip_compno(l_j2k, compno)]);
+            OPJ_UINT32 l_band_row0 = opj_uint_ceildivpow2(l_band_comp->y0,
+                                     l_band_comp->factor);
+            OPJ_UINT32 l_row0, l_row1;
+
+            l_strip_comp->y0 = opj_uint_ceildiv(l_y0, l_strip_comp->dy);
+            l_row0 = opj_uint_ceildivpow2(l_strip_comp->y0, l_strip_comp->factor);
+            l_row1 = opj_uint_ceildivpow2(opj_uint_ceildiv(l_y1, l_strip_comp->dy),
+                                          l_strip_comp->factor);
+            l_strip_comp->h = l_row1 - l_row0;
+            l_strip_comp->data = NULL;
+            if (l_strip_comp->h > 0) {
+                assert(l_band_comp->data != NULL);
+                assert(l_row0 >= l_band_row0 &&
+                       l_row1 - l_band_row0 <= l_band_comp->h);
+                l_strip_comp->data = l_band_comp->data +
+                                     (OPJ_SIZE_T)(l_row0 - l_band_row0) * l_band_comp->w;
+                l_empty = OPJ_FALSE;
+            }
+        }
+
+        if (!l_empty &&
+                !l_j2k->m_specific_param.m_decoder.m_strip_fn(l_strip,
+                        l_j2k->m_specific_param.m_decoder.m_strip_user_data)) {
+            opj_event_msg(p_dec->m_manager, EVT_ERROR,
+                          "Decoding interrupted by the strip function\n");
+            return OPJ_FALSE;
+        }
+        l_y0 = l_y1;
+    }
+
+    return OPJ_TRUE;
+}
+
+/**
+ * Returns a tile decoder that is not used by a tile, creating one if needed.
+ */
+static opj_tcd_t* opj_j2k_get_strip_tcd(opj_j2k_strip_decoder_t *p_dec)
+{
+    opj_j2k_t *l_j2k = p_dec->m_j2k;
+    opj_tcd_t *l_tcd;
+    opj_tcd_t **l_new_free_tcds;
+    opj_image_t *l_image;
+
+    if (p_dec->m_nb_free_tcds > 0) {
+        return p_dec->m_free_tcds[--p_dec->m_nb_free_tcds];
+    }
+    /* Make room for the tile decoder when it is given back */
+    l_new_free_tcds = (opj_tcd_t **) opj_realloc(p_dec->m_free_tcds,
+                      (p_dec->m_nb_tcds + 2) * sizeof(opj_tcd_t*));
+    if (l_new_free_tcds == NULL) {
+        return NULL;
+    }
+    p_dec->m_free_tcds = l_new_free_tcds;
+    l_image = opj_image_create0();
+    if (l_image == NULL) {
+        return NULL;
+    }
+    opj_copy_image_header(l_j2k->m_private_image, l_image);
+    l_tcd = opj_tcd_create(OPJ_TRUE,
+                           &(l_j2k->m_specific_param.m_decoder.m_allocator),
+                           l_j2k->m_specific_param.m_decoder.m_mem_counter);
+    if (l_image->comps == NULL || l_tcd == NULL ||
+            !opj_tcd_init(l_tcd, l_image, &(l_j2k->m_cp), l_j2k->m_tp)) {
+        opj_tcd_destroy(l_tcd);
+        opj_image_destroy(l_image);
+        return NULL;
+    }
+    ++p_dec->m_nb_tcds;
+    return l_tcd;
+}
+
+/**
+ * Destroys a tile decoder created by opj_j2k_get_strip_tcd().
+ */
+static void opj_j2k_destroy_strip_tcd(opj_j2k_strip_decoder_t *p_dec,
+                                      opj_tcd_t *p_tcd)
+{
+    if (p_tcd == p_dec->m_j2k->m_tcd) {
+        opj_tcd_end_tile_strips(p_tcd);
+    } else {
+        opj_image_t *l_image = p_tcd->image;
+        opj_tcd_destroy(p_tcd);
+        opj_image_destroy(l_image);
+    }
+}
+
+/**
+ * Releases a tile once its tile row has been emitted.
+ */
+static void opj_j2k_release_strip_tile(opj_j2k_strip_decoder_t *p_dec,
+                                       opj_j2k_strip_tile_t *p_tile)
+{
+    if (p_tile->m_tcd != NULL) {
+        opj_tcd_end_tile_strips(p_tile->m_tcd);
+        p_tile->m_tcd->stats = NULL;
+        p_dec->m_free_tcds[p_dec->m_nb_free_tcds++] = p_tile->m_tcd;
+        p_tile->m_tcd = NULL;
+    }
+    if (!p_tile->m_data_borrowed) {
+        opj_free(p_tile->m_data);
+    }
+    p_tile->m_data = NULL;
+    p_tile->m_data_borrowed = OPJ_FALSE;
+}
+
+/**
+ * Decodes the tiles of a tile row strip after strip, all tiles of the row
+ * advancing together, and emits the strips. Missing tiles are left to zero.
+ */
+static OPJ_BOOL opj_j2k_decode_strip_row(opj_j2k_strip_decoder_t *p_dec,
+        OPJ_UINT32 p_row)
+{
+    opj_j2k_t *l_j2k = p_dec->m_j2k;
+    opj_j2k_strip_tile_t *l_tiles = p_dec->m_tiles + p_row * p_dec->m_nb_tile_cols;
+    OPJ_UINT32 l_tile_y = l_j2k->m_specific_param.m_decoder.m_start_tile_y + p_row;
+    OPJ_UINT32 l_y = opj_uint_max(l_j2k->m_output_image->y0,
+                                  l_j2k->m_cp.ty0 + l_tile_y * l_j2k->m_cp.tdy);
+    OPJ_UINT32 l_y1 = opj_uint_min(l_j2k->m_output_image->y1,
+                                   l_j2k->m_cp.ty0 + (l_tile_y + 1) * l_j2k->m_cp.tdy);
+    OPJ_UINT32 i;
+
+    while (l_y < l_y1) {
+        /* Strips are aligned on the top of the decoded area */
+        OPJ_UINT32 l_strip_y1 = opj_uint_adds(l_y, p_dec->m_strip_height -
+                                              (l_y - l_j2k->m_output_image->y0) % p_dec->m_strip_height);
+        opj_image_t *l_band;
+        OPJ_BOOL l_ret;
+
+        l_strip_y1 = opj_uint_min(l_strip_y1, l_y1);
+        l_band = opj_j2k_create_strip_band(l_j2k, l_y, l_strip_y1,
+                                           p_dec->m_manager);
+        l_ret = l_band != NULL && opj_j2k_alloc_output_image_data(l_j2k, l_band);
+        for (i = 0; l_ret && i < p_dec->m_nb_tile_cols; i++) {
+            opj_tcd_t *l_tcd = l_tiles[i].m_tcd;
+            if (l_tcd == NULL) {
+                continue;
+            }
+            if (!opj_tcd_decode_tile_strip(l_tcd, l_y, l_strip_y1,
+                                           p_dec->m_manager) ||
+                    !opj_j2k_update_image_data(l_tcd, l_band)) {
+                opj_event_msg(p_dec->m_manager, EVT_ERROR,
+                              "Failed to decode tile %d/%d\n",
+                              l_tcd->tcd_tileno + 1,
+                              l_j2k->m_cp.th * l_j2k->m_cp.tw);
+                l_ret = OPJ_FALSE;
+            }
+        }
+        l_ret = l_ret && opj_j2k_emit_strips(p_dec, l_band);
+        opj_image_destroy(l_band);
+        if (!l_ret) {
+            return OPJ_FALSE;
+        }
+        l_y = l_strip_y1;
+    }
+
+    for (i = 0; i < p_dec->m_nb_tile_cols; i++) {
+        opj_tcd_t *l_tcd = l_tiles[i].m_tcd;
+        if (l_tcd == NULL) {
+            continue;
+        }
+        if (l_tcd->stats) {
+            l_tcd->stats->decoded = OPJ_TRUE;
+        }
+        opj_event_msg(p_dec->m_manager, EVT_INFO, "Tile %d/%d has been decoded.\n",
+                      l_tcd->tcd_tileno + 1, l_j2k->m_cp.th * l_j2k->m_cp.tw);
+    }
+    return OPJ_TRUE;
+}
+
+/**
+ * Emits the tile rows that are ready, in order. If p_flush is set, all the
+ * remaining tile rows are emitted, the missing tiles being left to zero.
+ */
+static OPJ_BOOL opj_j2k_emit_strip_rows(opj_j2k_strip_decoder_t *p_dec,
+                                        OPJ_BOOL p_flush)
+{
+    while (p_dec->m_next_row < p_dec->m_nb_tile_rows) {
+        OPJ_UINT32 l_row = p_dec->m_next_row;
+        OPJ_BOOL l_ret;
+        OPJ_UINT32 i;
+
+        if (!p_flush && p_dec->m_rows_nb_tiles[l_row] != p_dec->m_nb_tile_cols) {
+            break;
+        }
+        l_ret = opj_j2k_decode_strip_row(p_dec, l_row);
+        for (i = 0; i < p_dec->m_nb_tile_cols; i++) {
+            opj_j2k_release_strip_tile(p_dec,
+                                       &p_dec->m_tiles[l_row * p_dec->m_nb_tile_cols + i]);
+        }
+        ++p_dec->m_next_row;
+        if (!l_ret) {
+            return OPJ_FALSE;
+        }
+    }
+    return OPJ_TRUE;
+}
+
+/**
+ * Reads the next tile of the codestream, and starts its decoding by strips
+ * with a tile decoder of its own, so that the tiles of a tile row can be
+ * decoded together. Tier-2 decoding is done there, in the order of the
+ * codestream.
+ */
+static OPJ_BOOL opj_j2k_read_strip_tile(opj_j2k_strip_decoder_t *p_dec,
+                                        OPJ_BOOL *p_go_on,
+                                        opj_stream_private_t *p_stream)
+{
+    opj_j2k_t *l_j2k = p_dec->m_j2k;
+    opj_event_mgr_t *l_manager = p_dec->m_manager;
+    opj_tcd_t *l_j2k_tcd = l_j2k->m_tcd;
+    opj_tcd_t *l_tcd;
+    opj_tcp_t *l_tcp;
+    opj_j2k_strip_tile_t *l_tile;
+    OPJ_UINT32 l_current_tile_no;
+    OPJ_INT32 l_tile_x0, l_tile_y0, l_tile_x1, l_tile_y1;
+    OPJ_UINT32 l_nb_comps;
+    OPJ_UINT32 l_col, l_row;
+    OPJ_BOOL l_keep_data;
+    OPJ_BOOL l_ret;
+
+    l_tcd = opj_j2k_get_strip_tcd(p_dec);
+    if (l_tcd == NULL) {
+        opj_event_msg(l_manager, EVT_ERROR, "Not enough memory to decode tiles\n");
+        return OPJ_FALSE;
+    }
+
+    if (l_j2k->m_cp.tw == 1 && l_j2k->m_cp.th == 1 &&
+            l_j2k->m_cp.tcps[0].m_data != NULL) {
+        /* Tile kept from a previous decoding, by the tile decoder of the */
+        /* codec */
+        assert(l_tcd == l_j2k_tcd);
+        l_current_tile_no = 0;
+        l_j2k->m_current_tile_number = 0;
+        l_j2k->m_specific_param.m_decoder.m_state |= J2K_STATE_DATA;
+    } else {
+        /* opj_j2k_read_tile_header() sets up the tile in m_tcd */
+        l_j2k->m_tcd = l_tcd;
+        l_ret = opj_j2k_read_tile_header(l_j2k,
+                                         &l_current_tile_no,
+                                         NULL,
+                                         &l_tile_x0, &l_tile_y0,
+                                         &l_tile_x1, &l_tile_y1,
+                                         &l_nb_comps,
+                                         p_go_on,
+                                         p_stream,
+                                         l_manager);
+        l_j2k->m_tcd = l_j2k_tcd;
+        if (!l_ret || !*p_go_on) {
+            p_dec->m_free_tcds[p_dec->m_nb_free_tcds++] = l_tcd;
+            return l_ret;
+        }
+    }
+
+    l_col = l_current_tile_no % l_j2k->m_cp.tw -
+            l_j2k->m_specific_param.m_decoder.m_start_tile_x;
+    l_row = l_current_tile_no / l_j2k->m_cp.tw -
+            l_j2k->m_specific_param.m_decoder.m_start_tile_y;
+    l_tcp = &(l_j2k->m_cp.tcps[l_current_tile_no]);
+    if (l_col >= p_dec->m_nb_tile_cols || l_row >= p_dec->m_nb_tile_rows ||
+            l_row < p_dec->m_next_row || l_tcp->m_data == NULL) {
+        p_dec->m_free_tcds[p_dec->m_nb_free_tcds++] = l_tcd;
+        opj_j2k_tcp_destroy(l_tcp);
+        opj_event_msg(l_manager, EVT_ERROR, "Failed to decode tile %d/%d\n",
+                      l_current_tile_no + 1, l_j2k->m_cp.th * l_j2k->m_cp.tw);
+        return OPJ_FALSE;
+    }
+    l_tile = &p_dec->m_tiles[l_row * p_dec->m_nb_tile_cols + l_col];
+    if (l_tile->m_tcd != NULL) {
+        opj_j2k_release_strip_tile(p_dec, l_tile);
+        --p_dec->m_rows_nb_tiles[l_row];
+    }
+
+    l_tcd->src_read_only = l_tcp->m_data_borrowed;
+    opj_j2k_set_tcd_packet_lengths(l_tcd, l_tcp);
+    l_tcd->stats = opj_j2k_get_tile_stats(l_j2k, l_current_tile_no);
+    if (!opj_tcd_begin_tile_strips(l_tcd,
+                                   l_j2k->m_output_image->x0,
+                                   l_j2k->m_output_image->y0,
+                                   l_j2k->m_output_image->x1,
+                                   l_j2k->m_output_image->y1,
+                                   l_j2k->m_specific_param.m_decoder.m_numcomps_to_decode,
+                                   l_j2k->m_specific_param.m_decoder.m_comps_indices_to_decode,
+                                   l_tcp->m_data,
+                                   l_tcp->m_data_size,
+                                   l_current_tile_no,
+                                   l_j2k->cstr_index,
+                                   l_manager)) {
+        opj_tcd_end_tile_strips(l_tcd);
+        p_dec->m_free_tcds[p_dec->m_nb_free_tcds++] = l_tcd;
+        opj_j2k_tcp_destroy(l_tcp);
+        l_j2k->m_specific_param.m_decoder.m_state |= J2K_STATE_ERR;
+        opj_event_msg(l_manager, EVT_ERROR, "Failed to decode tile %d/%d\n",
+                      l_current_tile_no + 1, l_j2k->m_cp.th * l_j2k->m_cp.tw);
+        return OPJ_FALSE;
+    }
+    l_tcd->packet_lengths = NULL;
+    l_tcd->nb_packet_lengths = 0;
+    l_tile->m_tcd = l_tcd;
+    ++p_dec->m_rows_nb_tiles[l_row];
+
+    /* The code-blocks point to the tile data, which is kept until the */
+    /* tile row is decoded. The data of a single tile is kept by its tile */
+    /* coding parameters when the image may be decoded again */
+    l_keep_data = l_j2k->m_cp.tw == 1 && l_j2k->m_cp.th == 1 &&
+                  (l_j2k->m_specific_param.m_decoder.m_refinable ||
+                   !(l_j2k->m_output_image->x0 == l_j2k->m_private_image->x0 &&
+                     l_j2k->m_output_image->y0 == l_j2k->m_private_image->y0 &&
+                     l_j2k->m_output_image->x1 == l_j2k->m_private_image->x1 &&
+                     l_j2k->m_output_image->y1 == l_j2k->m_private_image->y1));
+    if (!l_keep_data) {
+        l_tile->m_data = l_tcp->m_data;
+        l_tile->m_data_borrowed = l_tcp->m_data_borrowed;
+        l_tcp->m_data = NULL;
+        l_tcp->m_data_size = 0;
+        l_tcp->m_data_borrowed = 0;
+        opj_j2k_tcp_data_destroy(l_tcp);
+    }
+
+    return opj_j2k_move_to_next_tile_header(l_j2k, p_stream, l_manager);
+}
+
+static OPJ_BOOL opj_j2k_decode_tiles_by_strips(opj_j2k_t *p_j2k,
+        OPJ_OFF_T p_end_pos,
+        opj_stream_private_t *p_stream,
+        opj_event_mgr_t * p_manager)
+{
+    OPJ_BOOL l_go_on = OPJ_TRUE;
+    OPJ_BOOL l_ret = OPJ_TRUE;
+    OPJ_UINT32 nr_tiles = 0;
+    OPJ_UINT32 l_factor = p_j2k->m_output_image->comps[0].factor;
+    OPJ_UINT32 compno;
+    OPJ_UINT32 l_nb_tiles;
+    opj_j2k_strip_decoder_t l_dec;
+
+    memset(&l_dec, 0, sizeof(l_dec));
+    l_dec.m_j2k = p_j2k;
+    l_dec.m_manager = p_manager;
+    l_dec.m_nb_tile_cols = p_j2k->m_specific_param.m_decoder.m_end_tile_x -
+                           p_j2k->m_specific_param.m_decoder.m_start_tile_x;
+    l_dec.m_nb_tile_rows = p_j2k->m_specific_param.m_decoder.m_end_tile_y -
+                           p_j2k->m_specific_param.m_decoder.m_start_tile_y;
+    l_nb_tiles = l_dec.m_nb_tile_cols * l_dec.m_nb_tile_rows;
+    /* Strip height in the reference grid */
+    l_dec.m_strip_height = p_j2k->m_specific_param.m_decoder.m_strip_height;
+    if (l_factor >= 32 || l_dec.m_strip_height > (UINT_MAX >> l_factor)) {
+        l_dec.m_strip_height = UINT_MAX;
+    } else {
+        l_dec.m_strip_height <<= l_factor;
+    }
+
+    l_dec.m_tiles = (opj_j2k_strip_tile_t*) opj_calloc(l_nb_tiles,
+                    sizeof(opj_j2k_strip_tile_t));
+    l_dec.m_rows_nb_tiles = (OPJ_UINT32*) opj_calloc(l_dec.m_nb_tile_rows,
+                            sizeof(OPJ_UINT32));
+    l_dec.m_free_tcds = (opj_tcd_t**) opj_malloc(sizeof(opj_tcd_t*));
+    l_dec.m_strip = opj_j2k_create_strip_band(p_j2k,
+                    p_j2k->m_output_image->y0,
+                    p_j2k->m_output_image->y1,
+                    p_manager);
+    if (l_dec.m_tiles == NULL || l_dec.m_rows_nb_tiles == NULL ||
+            l_dec.m_free_tcds == NULL || l_dec.m_strip == NULL) {
+        opj_event_msg(p_manager, EVT_ERROR, "Not enough memory to decode tiles\n");
+        l_ret = OPJ_FALSE;
+        goto cleanup;
+    }
+    /* The tile decoder of the codec is used for the first tile */
+    l_dec.m_free_tcds[0] = p_j2k->m_tcd;
+    l_dec.m_nb_free_tcds = 1;
+    l_dec.m_nb_tcds = 1;
+    /* The strips only have the components to decode */
+    if (p_j2k->m_specific_param.m_decoder.m_numcomps_to_decode) {
+        for (compno = 0;
+                compno < p_j2k->m_specific_param.m_decoder.m_numcomps_to_decode; compno++) {
+            l_dec.m_strip->comps[compno] =
+                p_j2k->m_output_image->comps[opj_j2k_get_strip_compno(p_j2k, compno)];
+            l_dec.m_strip->comps[compno].data = NULL;
+        }
+        l_dec.m_strip->numcomps = p_j2k->m_specific_param.m_decoder.m_numcomps_to_decode;
+    }
+
+    for (;;) {
+        if (!opj_j2k_read_strip_tile(&l_dec, &l_go_on, p_stream)) {
+            l_ret = OPJ_FALSE;
+            goto cleanup;
+        }
+        if (! l_go_on) {
+            break;
+        }
+
+        /* Decode the tile rows whose tiles have all been read */
+        if (!opj_j2k_emit_strip_rows(&l_dec, OPJ_FALSE)) {
+            l_ret = OPJ_FALSE;
+            goto cleanup;
+        }
+
+        if (opj_stream_get_number_byte_left(p_stream) == 0
+                && p_j2k->m_specific_param.m_decoder.m_state == J2K_STATE_NEOC) {
+            break;
+        }
+        if (++nr_tiles ==  p_j2k->m_cp.th * p_j2k->m_cp.tw) {
+            break;
+        }
+        if (p_j2k->m_specific_param.m_decoder.m_num_intersecting_tile_parts > 0 &&
+                p_j2k->m_specific_param.m_decoder.m_idx_intersecting_tile_parts ==
+                p_j2k->m_specific_param.m_decoder.m_num_intersecting_tile_parts) {
+            opj_stream_seek(p_stream, p_end_pos + 2, p_manager);
+            break;
+        }
+    }
+
+    /* Emit the tile rows whose tiles are missing from the codestream */
+    l_ret = opj_j2k_emit_strip_rows(&l_dec, OPJ_TRUE);
+
+cleanup:
+    if (l_dec.m_tiles != NULL) {
+        OPJ_UINT32 i;
+        for (i = 0; i < l_nb_tiles; i++) {
+            opj_j2k_release_strip_tile(&l_dec, &l_dec.m_tiles[i]);
+        }
+        opj_free(l_dec.m_tiles);
+    }
+    if (l_dec.m_free_tcds != NULL) {
+        OPJ_UINT32 i;
+        for (i = 0; i < l_dec.m_nb_free_tcds; i++) {
+            opj_j2k_destroy_strip_tcd(&l_dec, l_dec.m_free_tcds[i]);
+        }
+        opj_free(l_dec.m_free_tcds);
+    }
+    opj_free(l_dec.m_rows_nb_tiles);
+    if (l_dec.m_strip != NULL) {
+        /* The strip does not own its component buffers */
+        for (compno = 0; compno < l_dec.m_strip->numcomps; compno++) {
+            l_dec.m_strip->comps[compno].data = NULL;
+        }
+        opj_image_destroy(l_dec.m_strip);
+    }
+    return l_ret;
+}
+
+/**
+ * Sets up the procedures to do on decoding data. Developers wanting to extend the library can add their own reading procedures.
+ */
+static OPJ_BOOL opj_j2k_setup_decoding(opj_j2k_t *p_j2k,
+                                       opj_event_mgr_t * p_manager)
+{
+    /* preconditions*/
+    assert(p_j2k != 00);
+    assert(p_manager != 00);
+
+    if (! opj_procedure_list_add_procedure(p_j2k->m_procedure_list,
+                                           (opj_procedure)opj_j2k_decode_tiles, p_manager)) {
+        return OPJ_FALSE;
+    }
+    /* DEVELOPER CORNER, add your custom procedures */
+
+    return OPJ_TRUE;
+}
+
+/*
+ * Read and decode one tile.
+ */
+static OPJ_BOOL opj_j2k_decode_one_tile(opj_j2k_t *p_j2k,
+                                        opj_stream_private_t *p_stream,
+                                        opj_event_mgr_t * p_manager)
+{
+    OPJ_BOOL l_go_on = OPJ_TRUE;
+    OPJ_UINT32 l_current_tile_no;
+    OPJ_UINT32 l_tile_no_to_dec;
+    OPJ_INT32 l_tile_x0, l_tile_y0, l_tile_x1, l_tile_y1;
+    OPJ_UINT32 l_nb_comps;
+    OPJ_UINT32 l_nb_tiles;
+    OPJ_UINT32 i;
+
+    /* Move into the codestream to the first SOT used to decode the desired tile */
+    l_tile_no_to_dec = (OPJ_UINT32)
                        p_j2k->m_specific_param.m_decoder.m_tile_ind_to_dec;
     if (p_j2k->cstr_index->tile_index)
         if (p_j2k->cstr_index->tile_index->tp_index) {
@@ -12383,6 +14288,53 @@ static OPJ_BOOL opj_j2k_move_data_from_codec_to_output_image(opj_j2k_t * p_j2k,
     return OPJ_TRUE;
 }
 
+static OPJ_BOOL opj_j2k_setup_cblk_cache(opj_j2k_t *p_j2k,
+        opj_event_mgr_t * p_manager)
+{
+    opj_j2k_dec_t* l_dec = &(p_j2k->m_specific_param.m_decoder);
+
+    if (p_j2k->m_tcd == NULL) {
+        return OPJ_TRUE;
+    }
+
+    /* Only a single-tiled image can be decoded several times with the same */
+    /* codec, see opj_set_decode_area() */
+    p_j2k->m_tcd->refinable = l_dec->m_refinable &&
+                              p_j2k->m_cp.tw == 1 && p_j2k->m_cp.th == 1;
+
+    if (l_dec->m_cblk_cache_size == 0 ||
+            p_j2k->m_cp.tw != 1 || p_j2k->m_cp.th != 1) {
+        p_j2k->m_tcd->cblk_cache = NULL;
+        return OPJ_TRUE;
+    }
+
+    if (l_dec->m_cblk_cache == NULL) {
+        l_dec->m_cblk_cache = opj_cblk_cache_create(l_dec->m_cblk_cache_size,
+                              l_dec->m_mem_counter);
+        if (l_dec->m_cblk_cache == NULL) {
+            opj_event_msg(p_manager, EVT_ERROR,
+                          "Not enough memory to create the code-block cache\n");
+            return OPJ_FALSE;
+        }
+    }
+    p_j2k->m_tcd->cblk_cache = l_dec->m_cblk_cache;
+    return OPJ_TRUE;
+}
+
+static OPJ_BOOL opj_j2k_check_refinement(opj_j2k_t *p_j2k,
+        opj_event_mgr_t * p_manager)
+{
+    if (p_j2k->m_specific_param.m_decoder.m_refinable &&
+            p_j2k->m_output_image != NULL &&
+            (p_j2k->m_cp.tw != 1 || p_j2k->m_cp.th != 1)) {
+        opj_event_msg(p_manager, EVT_ERROR,
+                      "Progressive refinement needs a single-tiled image: "
+                      "the tiles of this image are not kept once decoded.\n");
+        return OPJ_FALSE;
+    }
+    return OPJ_TRUE;
+}
+
 OPJ_BOOL opj_j2k_decode(opj_j2k_t * p_j2k,
                         opj_stream_private_t * p_stream,
                         opj_image_t * p_image,
@@ -12392,6 +14344,10 @@ OPJ_BOOL opj_j2k_decode(opj_j2k_t * p_j2k,
         return OPJ_FALSE;
     }
 
+    if (!opj_j2k_check_refinement(p_j2k, p_manager)) {
+        return OPJ_FALSE;
+    }
+
     /* Heuristics to detect sequence opj_read_header(), opj_set_decoded_resolution_factor() */
     /* and finally opj_decode_image() without manual setting of comps[].factor */
     /* We could potentially always execute it, if we don't allow people to do */
@@ -12425,6 +14381,10 @@ OPJ_BOOL opj_j2k_decode(opj_j2k_t * p_j2k,
     }
     opj_copy_image_header(p_image, p_j2k->m_output_image);
 
+    if (!opj_j2k_setup_cblk_cache(p_j2k, p_manager)) {
+        return OPJ_FALSE;
+    }
+
     /* customization of the decoding */
     if (!opj_j2k_setup_decoding(p_j2k, p_manager)) {
         return OPJ_FALSE;
@@ -12441,6 +14401,32 @@ OPJ_BOOL opj_j2k_decode(opj_j2k_t * p_j2k,
     return opj_j2k_move_data_from_codec_to_output_image(p_j2k, p_image);
 }
 
+OPJ_BOOL opj_j2k_decode_strips(opj_j2k_t * p_j2k,
+                               opj_stream_private_t * p_stream,
+                               opj_image_t * p_image,
+                               OPJ_UINT32 strip_height,
+                               opj_decode_strip_fn strip_fn,
+                               void * user_data,
+                               opj_event_mgr_t * p_manager)
+{
+    OPJ_BOOL l_ret;
+
+    if (!p_image || p_image->numcomps == 0 || p_image->comps[0].data != NULL) {
+        opj_event_msg(p_manager, EVT_ERROR,
+                      "Strip decoding needs an image header without data\n");
+        return OPJ_FALSE;
+    }
+
+    p_j2k->m_specific_param.m_decoder.m_strip_fn = strip_fn;
+    p_j2k->m_specific_param.m_decoder.m_strip_user_data = user_data;
+    p_j2k->m_specific_param.m_decoder.m_strip_height = strip_height;
+    l_ret = opj_j2k_decode(p_j2k, p_stream, p_image, p_manager);
+    p_j2k->m_specific_param.m_decoder.m_strip_fn = NULL;
+    p_j2k->m_specific_param.m_decoder.m_strip_user_data = NULL;
+    p_j2k->m_specific_param.m_decoder.m_strip_height = 0;
+    return l_ret;
+}
+
 OPJ_BOOL opj_j2k_get_tile(opj_j2k_t *p_j2k,
                           opj_stream_private_t *p_stream,
                           opj_image_t* p_image,
@@ -12585,6 +14571,61 @@ OPJ_BOOL opj_j2k_set_decoded_resolution_factor(opj_j2k_t *p_j2k,
     return OPJ_FALSE;
 }
 
+OPJ_BOOL opj_j2k_set_decoded_quality_layers(opj_j2k_t *p_j2k,
+        OPJ_UINT32 num_layers,
+        opj_event_mgr_t * p_manager)
+{
+    opj_cp_t* l_cp = &(p_j2k->m_cp);
+    opj_tcp_t* l_tcp;
+    OPJ_UINT32 l_nb_tiles;
+    OPJ_UINT32 i;
+
+    if (num_layers > 65535U) {
+        opj_event_msg(p_manager, EVT_ERROR,
+                      "Invalid number of quality layers: %u\n", num_layers);
+        return OPJ_FALSE;
+    }
+
+    l_nb_tiles = l_cp->tcps ? l_cp->tw * l_cp->th : 0;
+
+    /* The tiles of a multi-tiled image are not kept once decoded */
+    if (l_nb_tiles > 1 && p_j2k->m_output_image != NULL) {
+        opj_event_msg(p_manager, EVT_ERROR,
+                      "Decoding an image again with another number of "
+                      "quality layers needs a single-tiled image.\n");
+        return OPJ_FALSE;
+    }
+
+    /* The packets of the layers that were not decoded may not have been */
+    /* read with the data of a tile that is kept */
+    for (i = 0; i < l_nb_tiles; ++i) {
+        l_tcp = &l_cp->tcps[i];
+        if (l_tcp->m_data_truncated &&
+                (num_layers == 0 || num_layers > l_tcp->num_layers_to_decode)) {
+            opj_event_msg(p_manager, EVT_ERROR,
+                          "The data of the quality layers that were not decoded "
+                          "has not been read. opj_set_decoded_quality_layers() "
+                          "must be called before decoding.\n");
+            return OPJ_FALSE;
+        }
+    }
+
+    l_cp->m_specific_param.m_dec.m_layer = num_layers;
+    p_j2k->m_specific_param.m_decoder.m_refinable = OPJ_TRUE;
+
+    /* Same rule as in opj_j2k_read_cod() */
+    for (i = 0; i < l_nb_tiles; ++i) {
+        l_tcp = &l_cp->tcps[i];
+        l_tcp->num_layers_to_decode = num_layers ? num_layers : l_tcp->numlayers;
+    }
+    l_tcp = p_j2k->m_specific_param.m_decoder.m_default_tcp;
+    if (l_tcp) {
+        l_tcp->num_layers_to_decode = num_layers ? num_layers : l_tcp->numlayers;
+    }
+
+    return OPJ_TRUE;
+}
+
 /* ----------------------------------------------------------------------- */
 
 OPJ_BOOL opj_j2k_encoder_set_extra_options(
@@ -12638,6 +14679,16 @@ OPJ_BOOL opj_j2k_encoder_set_extra_options(
                     tccp->numgbits = (OPJ_UINT32)numgbits;
                 }
             }
+        } else if (strncmp(*p_option_iter, "TILES_IN_FLIGHT=",
+                           strlen("TILES_IN_FLIGHT=")) == 0) {
+            int tiles_in_flight = atoi(*p_option_iter + strlen("TILES_IN_FLIGHT="));
+            if (tiles_in_flight < 0) {
+                opj_event_msg(p_manager, EVT_ERROR,
+                              "Invalid value for option: %s.\n", *p_option_iter);
+                return OPJ_FALSE;
+            }
+            p_j2k->m_specific_param.m_encoder.m_max_tiles_in_flight =
+                (OPJ_UINT32)tiles_in_flight;
         } else {
             opj_event_msg(p_manager, EVT_ERROR,
                           "Invalid option: %s.\n", *p_option_iter);
@@ -12650,6 +14701,284 @@ OPJ_BOOL opj_j2k_encoder_set_extra_options(
 
 /* ----------------------------------------------------------------------- */
 
+/** Encoding context of one of the tiles encoded concurrently */
+typedef struct opj_j2k_tile_encode_job {
+    opj_j2k_t* j2k;
+    /** Tile coder owned by this job slot */
+    opj_tcd_t* tcd;
+    /** Thread pool with no worker, so that T1 and rate allocation run in
+     * the worker thread that encodes the tile */
+    opj_thread_pool_t* tp;
+    /** Image header used by tcd, so that resno_decoded is not shared. Its
+     * component data points to the buffers of j2k->m_private_image */
+    opj_image_t* tcd_image;
+    opj_event_mgr_t* p_manager;
+    /** Mutex protecting busy and has_result */
+    opj_mutex_t* mutex;
+    /** Signaled when a job is finished */
+    opj_cond_t* cond;
+    OPJ_UINT32 tile_no;
+    /** Tile samples, in the layout expected by opj_tcd_copy_tile_data() */
+    OPJ_BYTE* input_data;
+    OPJ_SIZE_T input_size;
+    /** Tile-parts of the tile, of m_encoded_tile_size bytes */
+    OPJ_BYTE* encoded_data;
+    OPJ_UINT32 encoded_size;
+    OPJ_BOOL busy;
+    OPJ_BOOL has_result;
+    OPJ_BOOL ret;
+} opj_j2k_tile_encode_job_t;
+
+static OPJ_BOOL opj_j2k_encode_tile_job_run(opj_j2k_tile_encode_job_t* job)
+{
+    opj_j2k_t* p_j2k = job->j2k;
+    opj_tcd_t* l_tcd = job->tcd;
+    OPJ_SIZE_T l_tile_size;
+    OPJ_UINT32 j;
+
+    opj_event_msg(job->p_manager, EVT_INFO, "tile number %d / %d\n",
+                  job->tile_no + 1, p_j2k->m_cp.tw * p_j2k->m_cp.th);
+
+    l_tcd->cur_totnum_tp = p_j2k->m_cp.tcps[job->tile_no].m_nb_tile_parts;
+    if (! opj_tcd_init_encode_tile(l_tcd, job->tile_no, job->p_manager)) {
+        return OPJ_FALSE;
+    }
+
+    for (j = 0; j < l_tcd->image->numcomps; ++j) {
+        opj_tcd_tilecomp_t* l_tilec = l_tcd->tcd_image->tiles->comps + j;
+        if (! opj_alloc_tile_component_data(l_tilec, NULL)) {
+            opj_event_msg(job->p_manager, EVT_ERROR,
+                          "Error allocating tile component data.");
+            return OPJ_FALSE;
+        }
+    }
+
+    l_tile_size = opj_tcd_get_encoder_input_buffer_size(l_tcd);
+    if (l_tile_size > job->input_size) {
+        OPJ_BYTE *l_new_data = (OPJ_BYTE *) opj_realloc(job->input_data,
+                               l_tile_size);
+        if (! l_new_data) {
+            opj_event_msg(job->p_manager, EVT_ERROR,
+                          "Not enough memory to encode all tiles\n");
+            return OPJ_FALSE;
+        }
+        job->input_data = l_new_data;
+        job->input_size = l_tile_size;
+    }
+
+    opj_j2k_get_tile_data(l_tcd, job->input_data);
+    if (! opj_tcd_copy_tile_data(l_tcd, job->input_data, l_tile_size)) {
+        opj_event_msg(job->p_manager, EVT_ERROR,
+                      "Size mismatch between tile data and sent data.");
+        return OPJ_FALSE;
+    }
+
+    job->encoded_size = 0;
+    return opj_j2k_write_tile_parts(p_j2k, l_tcd, job->tile_no,
+                                    job->encoded_data, &job->encoded_size,
+                                    p_j2k->m_specific_param.m_encoder.m_encoded_tile_size,
+                                    job->p_manager);
+}
+
+static void opj_j2k_encode_tile_job(void* user_data, opj_tls_t* tls)
+{
+    opj_j2k_tile_encode_job_t* job = (opj_j2k_tile_encode_job_t*)user_data;
+    OPJ_BOOL l_ret;
+
+    (void)tls;
+
+    l_ret = opj_j2k_encode_tile_job_run(job);
+
+    opj_mutex_lock(job->mutex);
+    job->ret = l_ret;
+    job->busy = OPJ_FALSE;
+    job->has_result = OPJ_TRUE;
+    opj_cond_signal(job->cond);
+    opj_mutex_unlock(job->mutex);
+}
+
+static void opj_j2k_destroy_tile_encode_jobs(opj_j2k_tile_encode_job_t* p_jobs,
+        OPJ_UINT32 p_nb_jobs)
+{
+    OPJ_UINT32 i;
+    for (i = 0; i < p_nb_jobs; i++) {
+        opj_j2k_tile_encode_job_t* job = &(p_jobs[i]);
+        opj_tcd_destroy(job->tcd);
+        opj_thread_pool_destroy(job->tp);
+        if (job->tcd_image) {
+            OPJ_UINT32 compno;
+            /* The buffers belong to m_private_image */
+            for (compno = 0; compno < job->tcd_image->numcomps; compno++) {
+                job->tcd_image->comps[compno].data = NULL;
+            }
+            opj_image_destroy(job->tcd_image);
+        }
+        opj_free(job->input_data);
+        opj_free(job->encoded_data);
+    }
+    opj_free(p_jobs);
+}
+
+static OPJ_BOOL opj_j2k_encode_tiles_parallel(opj_j2k_t *p_j2k,
+        opj_stream_private_t *p_stream,
+        opj_event_mgr_t * p_manager)
+{
+    OPJ_BOOL l_ret = OPJ_TRUE;
+    const OPJ_UINT32 l_nb_tiles = p_j2k->m_cp.tw * p_j2k->m_cp.th;
+    const OPJ_BOOL l_in_tile_order = !p_j2k->m_specific_param.m_encoder.m_TLM;
+    OPJ_UINT32 l_nb_jobs;
+    OPJ_UINT32 l_next_tile_to_encode = 0;
+    OPJ_UINT32 l_nb_tiles_written = 0;
+    OPJ_UINT32 i;
+    opj_j2k_tile_encode_job_t* l_jobs = NULL;
+    opj_mutex_t* l_mutex = NULL;
+    opj_cond_t* l_cond = NULL;
+    opj_locked_event_mgr_t l_locked_event_mgr;
+
+    l_nb_jobs = opj_uint_min(p_j2k->m_specific_param.m_encoder.m_max_tiles_in_flight,
+                             l_nb_tiles);
+
+    l_mutex = opj_mutex_create();
+    l_cond = opj_cond_create();
+    l_jobs = (opj_j2k_tile_encode_job_t*) opj_calloc(l_nb_jobs,
+             sizeof(opj_j2k_tile_encode_job_t));
+    if (l_mutex == NULL || l_cond == NULL || l_jobs == NULL) {
+        opj_free(l_jobs);
+        opj_cond_destroy(l_cond);
+        opj_mutex_destroy(l_mutex);
+        opj_event_msg(p_manager, EVT_ERROR, "Not enough memory to encode all tiles\n");
+        return OPJ_FALSE;
+    }
+    opj_locked_event_mgr_init(&l_locked_event_mgr, p_manager, l_mutex);
+
+    for (i = 0; i < l_nb_jobs; i++) {
+        opj_j2k_tile_encode_job_t* job = &(l_jobs[i]);
+        OPJ_UINT32 compno;
+        job->j2k = p_j2k;
+        job->p_manager = &(l_locked_event_mgr.m_event_mgr);
+        job->mutex = l_mutex;
+        job->cond = l_cond;
+        job->tp = opj_thread_pool_create(0);
+        job->tcd_image = opj_image_create0();
+        job->tcd = opj_tcd_create(OPJ_FALSE, NULL, NULL);
+        job->encoded_data = (OPJ_BYTE*) opj_malloc(
+                                p_j2k->m_specific_param.m_encoder.m_encoded_tile_size);
+        if (job->tp == NULL || job->tcd_image == NULL || job->tcd == NULL ||
+                job->encoded_data == NULL) {
+            l_ret = OPJ_FALSE;
+            break;
+        }
+        opj_copy_image_header(p_j2k->m_private_image, job->tcd_image);
+        if (job->tcd_image->comps == NULL) {
+            l_ret = OPJ_FALSE;
+            break;
+        }
+        for (compno = 0; compno < job->tcd_image->numcomps; compno++) {
+            job->tcd_image->comps[compno].data =
+                p_j2k->m_private_image->comps[compno].data;
+        }
+        if (!opj_tcd_init(job->tcd, job->tcd_image, &(p_j2k->m_cp), job->tp)) {
+            l_ret = OPJ_FALSE;
+            break;
+        }
+    }
+    if (!l_ret) {
+        opj_j2k_destroy_tile_encode_jobs(l_jobs, l_nb_jobs);
+        opj_cond_destroy(l_cond);
+        opj_mutex_destroy(l_mutex);
+        opj_event_msg(p_manager, EVT_ERROR, "Not enough memory to encode all tiles\n");
+        return OPJ_FALSE;
+    }
+
+    while (l_nb_tiles_written < l_nb_tiles) {
+        opj_j2k_tile_encode_job_t* l_free_job = NULL;
+        opj_j2k_tile_encode_job_t* l_done_job = NULL;
+        OPJ_BOOL l_failed = OPJ_FALSE;
+
+        /* Wait for a tile to write, or for a job slot to be available */
+        opj_mutex_lock(l_mutex);
+        for (;;) {
+            for (i = 0; i < l_nb_jobs; i++) {
+                opj_j2k_tile_encode_job_t* job = &(l_jobs[i]);
+                if (job->has_result) {
+                    if (!job->ret) {
+                        l_failed = OPJ_TRUE;
+                    } else if (l_done_job == NULL &&
+                               (!l_in_tile_order ||
+                                job->tile_no == l_nb_tiles_written)) {
+                        l_done_job = job;
+                    }
+                } else if (l_free_job == NULL && !job->busy &&
+                           l_next_tile_to_encode < l_nb_tiles) {
+                    l_free_job = job;
+                }
+            }
+            if (l_done_job != NULL || l_free_job != NULL || l_failed) {
+                break;
+            }
+            opj_cond_wait(l_cond, l_mutex);
+        }
+        opj_mutex_unlock(l_mutex);
+        if (l_failed) {
+            l_ret = OPJ_FALSE;
+            break;
+        }
+
+        if (l_done_job != NULL) {
+            if (p_j2k->m_specific_param.m_encoder.m_TLM) {
+                opj_j2k_update_tlm_with_tile_parts(p_j2k, l_done_job->tile_no,
+                                                   l_done_job->encoded_data,
+                                                   l_done_job->encoded_size);
+            }
+            if (opj_stream_write_data(p_stream, l_done_job->encoded_data,
+                                      l_done_job->encoded_size, p_manager) !=
+                    l_done_job->encoded_size) {
+                l_ret = OPJ_FALSE;
+                break;
+            }
+            l_done_job->has_result = OPJ_FALSE;
+            ++l_nb_tiles_written;
+            continue;
+        }
+
+        l_free_job->tile_no = l_next_tile_to_encode;
+        l_free_job->busy = OPJ_TRUE;
+        if (!opj_thread_pool_submit_job(p_j2k->m_tp, opj_j2k_encode_tile_job,
+                                        l_free_job)) {
+            l_free_job->busy = OPJ_FALSE;
+            l_ret = OPJ_FALSE;
+            break;
+        }
+        ++l_next_tile_to_encode;
+    }
+
+    /* Wait for all tiles in flight */
+    opj_mutex_lock(l_mutex);
+    for (;;) {
+        for (i = 0; i < l_nb_jobs; i++) {
+            if (l_jobs[i].busy) {
+                break;
+            }
+        }
+        if (i == l_nb_jobs) {
+            break;
+        }
+        opj_cond_wait(l_cond, l_mutex);
+    }
+    opj_mutex_unlock(l_mutex);
+    /* Make sure that the job functions have returned */
+    opj_thread_pool_wait_completion(p_j2k->m_tp, 0);
+
+    opj_j2k_destroy_tile_encode_jobs(l_jobs, l_nb_jobs);
+    opj_cond_destroy(l_cond);
+    opj_mutex_destroy(l_mutex);
+
+    if (l_ret) {
+        p_j2k->m_current_tile_number = l_nb_tiles;
+    }
+    return l_ret;
+}
+
 OPJ_BOOL opj_j2k_encode(opj_j2k_t * p_j2k,
                         opj_stream_private_t *p_stream,
                         opj_event_mgr_t * p_manager)
@@ -12669,6 +14998,14 @@ OPJ_BOOL opj_j2k_encode(opj_j2k_t * p_j2k,
     p_tcd = p_j2k->m_tcd;
 
     l_nb_tiles = p_j2k->m_cp.th * p_j2k->m_cp.tw;
+
+    /* Encode several tiles concurrently if asked to */
+    if (p_j2k->m_specific_param.m_encoder.m_max_tiles_in_flight > 1 &&
+            opj_thread_pool_get_thread_count(p_j2k->m_tp) > 1 &&
+            l_nb_tiles > 1) {
+        return opj_j2k_encode_tiles_parallel(p_j2k, p_stream, p_manager);
+    }
+
     if (l_nb_tiles == 1) {
         l_reuse_data = OPJ_TRUE;
 #ifdef __SSE__
@@ -12698,7 +15035,7 @@ OPJ_BOOL opj_j2k_encode(opj_j2k_t * p_j2k,
                 l_tilec->data  =  l_img_comp->data;
                 l_tilec->ownsData = OPJ_FALSE;
             } else {
-                if (! opj_alloc_tile_component_data(l_tilec)) {
+                if (! opj_alloc_tile_component_data(l_tilec, NULL)) {
                     opj_event_msg(p_manager, EVT_ERROR, "Error allocating tile component data.");
                     if (l_current_data) {
                         opj_free(l_current_data);
@@ -12840,9 +15177,7 @@ static OPJ_BOOL opj_j2k_pre_write_tile(opj_j2k_t * p_j2k,
     opj_event_msg(p_manager, EVT_INFO, "tile number %d / %d\n",
                   p_j2k->m_current_tile_number + 1, p_j2k->m_cp.tw * p_j2k->m_cp.th);
 
-    p_j2k->m_specific_param.m_encoder.m_current_tile_part_number = 0;
     p_j2k->m_tcd->cur_totnum_tp = p_j2k->m_cp.tcps[p_tile_index].m_nb_tile_parts;
-    p_j2k->m_specific_param.m_encoder.m_current_poc_tile_part_number = 0;
 
     /* initialisation before tile encoding  */
     if (! opj_tcd_init_encode_tile(p_j2k->m_tcd, p_j2k->m_current_tile_number,
@@ -12979,35 +15314,26 @@ static OPJ_BOOL opj_j2k_post_write_tile(opj_j2k_t * p_j2k,
                                         opj_stream_private_t *p_stream,
                                         opj_event_mgr_t * p_manager)
 {
-    OPJ_UINT32 l_nb_bytes_written;
-    OPJ_BYTE * l_current_data = 00;
-    OPJ_UINT32 l_tile_size = 0;
-    OPJ_UINT32 l_available_data;
+    OPJ_UINT32 l_nb_bytes_written = 0;
 
     /* preconditions */
     assert(p_j2k->m_specific_param.m_encoder.m_encoded_tile_data);
 
-    l_tile_size = p_j2k->m_specific_param.m_encoder.m_encoded_tile_size;
-    l_available_data = l_tile_size;
-    l_current_data = p_j2k->m_specific_param.m_encoder.m_encoded_tile_data;
-
-    l_nb_bytes_written = 0;
-    if (! opj_j2k_write_first_tile_part(p_j2k, l_current_data, &l_nb_bytes_written,
-                                        l_available_data, p_stream, p_manager)) {
+    if (! opj_j2k_write_tile_parts(p_j2k, p_j2k->m_tcd,
+                                   p_j2k->m_current_tile_number,
+                                   p_j2k->m_specific_param.m_encoder.m_encoded_tile_data,
+                                   &l_nb_bytes_written,
+                                   p_j2k->m_specific_param.m_encoder.m_encoded_tile_size,
+                                   p_manager)) {
         return OPJ_FALSE;
     }
-    l_current_data += l_nb_bytes_written;
-    l_available_data -= l_nb_bytes_written;
 
-    l_nb_bytes_written = 0;
-    if (! opj_j2k_write_all_tile_parts(p_j2k, l_current_data, &l_nb_bytes_written,
-                                       l_available_data, p_stream, p_manager)) {
-        return OPJ_FALSE;
+    if (p_j2k->m_specific_param.m_encoder.m_TLM) {
+        opj_j2k_update_tlm_with_tile_parts(p_j2k, p_j2k->m_current_tile_number,
+                                           p_j2k->m_specific_param.m_encoder.m_encoded_tile_data,
+                                           l_nb_bytes_written);
     }
 
-    l_available_data -= l_nb_bytes_written;
-    l_nb_bytes_written = l_tile_size - l_available_data;
-
     if (opj_stream_write_data(p_stream,
                               p_j2k->m_specific_param.m_encoder.m_encoded_tile_data,
                               l_nb_bytes_written, p_manager) != l_nb_bytes_written) {
@@ -13098,6 +15424,12 @@ static OPJ_BOOL opj_j2k_setup_header_writing(opj_j2k_t *p_j2k,
                                            (opj_procedure)opj_j2k_write_siz, p_manager)) {
         return OPJ_FALSE;
     }
+    if (OPJ_IS_PART15(p_j2k->m_cp.rsiz)) {
+        if (! opj_procedure_list_add_procedure(p_j2k->m_procedure_list,
+                                               (opj_procedure)opj_j2k_write_cap, p_manager)) {
+            return OPJ_FALSE;
+        }
+    }
     if (! opj_procedure_list_add_procedure(p_j2k->m_procedure_list,
                                            (opj_procedure)opj_j2k_write_cod, p_manager)) {
         return OPJ_FALSE;
@@ -13171,10 +15503,11 @@ static OPJ_BOOL opj_j2k_setup_header_writing(opj_j2k_t *p_j2k,
 }
 
 static OPJ_BOOL opj_j2k_write_first_tile_part(opj_j2k_t *p_j2k,
+        opj_tcd_t * p_tcd,
+        OPJ_UINT32 p_tile_no,
         OPJ_BYTE * p_data,
         OPJ_UINT32 * p_data_written,
         OPJ_UINT32 total_data_size,
-        opj_stream_private_t *p_stream,
         struct opj_event_mgr * p_manager)
 {
     OPJ_UINT32 l_nb_bytes_written = 0;
@@ -13184,21 +15517,23 @@ static OPJ_BOOL opj_j2k_write_first_tile_part(opj_j2k_t *p_j2k,
     opj_tcd_t * l_tcd = 00;
     opj_cp_t * l_cp = 00;
 
-    l_tcd = p_j2k->m_tcd;
+    l_tcd = p_tcd;
     l_cp = &(p_j2k->m_cp);
 
     l_tcd->cur_pino = 0;
 
     /*Get number of tile parts*/
-    p_j2k->m_specific_param.m_encoder.m_current_poc_tile_part_number = 0;
+    l_tcd->tp_num = 0;
+    l_tcd->cur_tp_num = 0;
 
     /* INDEX >> */
     /* << INDEX */
 
     l_current_nb_bytes_written = 0;
     l_begin_data = p_data;
-    if (! opj_j2k_write_sot(p_j2k, p_data, total_data_size,
-                            &l_current_nb_bytes_written, p_stream,
+    if (! opj_j2k_write_sot(p_j2k, p_tile_no, l_tcd->cur_tp_num,
+                            p_data, total_data_size,
+                            &l_current_nb_bytes_written,
                             p_manager)) {
         return OPJ_FALSE;
     }
@@ -13225,9 +15560,10 @@ static OPJ_BOOL opj_j2k_write_first_tile_part(opj_j2k_t *p_j2k,
             total_data_size -= l_current_nb_bytes_written;
         }
 #endif
-        if (l_cp->tcps[p_j2k->m_current_tile_number].POC) {
+        if (l_cp->tcps[p_tile_no].POC) {
             l_current_nb_bytes_written = 0;
-            opj_j2k_write_poc_in_memory(p_j2k, p_data, &l_current_nb_bytes_written,
+            opj_j2k_write_poc_in_memory(p_j2k, p_tile_no, p_data,
+                                        &l_current_nb_bytes_written,
                                         p_manager);
             l_nb_bytes_written += l_current_nb_bytes_written;
             p_data += l_current_nb_bytes_written;
@@ -13236,8 +15572,9 @@ static OPJ_BOOL opj_j2k_write_first_tile_part(opj_j2k_t *p_j2k,
     }
 
     l_current_nb_bytes_written = 0;
-    if (! opj_j2k_write_sod(p_j2k, l_tcd, p_data, &l_current_nb_bytes_written,
-                            total_data_size, p_stream, p_manager)) {
+    if (! opj_j2k_write_sod(p_j2k, l_tcd, p_tile_no, p_data,
+                            &l_current_nb_bytes_written,
+                            total_data_size, p_manager)) {
         return OPJ_FALSE;
     }
 
@@ -13248,18 +15585,15 @@ static OPJ_BOOL opj_j2k_write_first_tile_part(opj_j2k_t *p_j2k,
     opj_write_bytes(l_begin_data + 6, l_nb_bytes_written,
                     4);                                 /* PSOT */
 
-    if (p_j2k->m_specific_param.m_encoder.m_TLM) {
-        opj_j2k_update_tlm(p_j2k, l_nb_bytes_written);
-    }
-
     return OPJ_TRUE;
 }
 
 static OPJ_BOOL opj_j2k_write_all_tile_parts(opj_j2k_t *p_j2k,
+        opj_tcd_t * p_tcd,
+        OPJ_UINT32 p_tile_no,
         OPJ_BYTE * p_data,
         OPJ_UINT32 * p_data_written,
         OPJ_UINT32 total_data_size,
-        opj_stream_private_t *p_stream,
         struct opj_event_mgr * p_manager
                                             )
 {
@@ -13275,25 +15609,25 @@ static OPJ_BOOL opj_j2k_write_all_tile_parts(opj_j2k_t *p_j2k,
     opj_tcd_t * l_tcd = 00;
     opj_cp_t * l_cp = 00;
 
-    l_tcd = p_j2k->m_tcd;
+    l_tcd = p_tcd;
     l_cp = &(p_j2k->m_cp);
-    l_tcp = l_cp->tcps + p_j2k->m_current_tile_number;
+    l_tcp = l_cp->tcps + p_tile_no;
 
     /*Get number of tile parts*/
-    tot_num_tp = opj_j2k_get_num_tp(l_cp, 0, p_j2k->m_current_tile_number);
+    tot_num_tp = opj_j2k_get_num_tp(l_cp, 0, p_tile_no, NULL);
 
     /* start writing remaining tile parts */
-    ++p_j2k->m_specific_param.m_encoder.m_current_tile_part_number;
+    ++l_tcd->cur_tp_num;
     for (tilepartno = 1; tilepartno < tot_num_tp ; ++tilepartno) {
-        p_j2k->m_specific_param.m_encoder.m_current_poc_tile_part_number = tilepartno;
+        l_tcd->tp_num = tilepartno;
         l_current_nb_bytes_written = 0;
         l_part_tile_size = 0;
         l_begin_data = p_data;
 
-        if (! opj_j2k_write_sot(p_j2k, p_data,
+        if (! opj_j2k_write_sot(p_j2k, p_tile_no, l_tcd->cur_tp_num,
+                                p_data,
                                 total_data_size,
                                 &l_current_nb_bytes_written,
-                                p_stream,
                                 p_manager)) {
             return OPJ_FALSE;
         }
@@ -13304,8 +15638,9 @@ static OPJ_BOOL opj_j2k_write_all_tile_parts(opj_j2k_t *p_j2k,
         l_part_tile_size += l_current_nb_bytes_written;
 
         l_current_nb_bytes_written = 0;
-        if (! opj_j2k_write_sod(p_j2k, l_tcd, p_data, &l_current_nb_bytes_written,
-                                total_data_size, p_stream, p_manager)) {
+        if (! opj_j2k_write_sod(p_j2k, l_tcd, p_tile_no, p_data,
+                                &l_current_nb_bytes_written,
+                                total_data_size, p_manager)) {
             return OPJ_FALSE;
         }
 
@@ -13318,27 +15653,24 @@ static OPJ_BOOL opj_j2k_write_all_tile_parts(opj_j2k_t *p_j2k,
         opj_write_bytes(l_begin_data + 6, l_part_tile_size,
                         4);                                   /* PSOT */
 
-        if (p_j2k->m_specific_param.m_encoder.m_TLM) {
-            opj_j2k_update_tlm(p_j2k, l_part_tile_size);
-        }
-
-        ++p_j2k->m_specific_param.m_encoder.m_current_tile_part_number;
+        ++l_tcd->cur_tp_num;
     }
 
     for (pino = 1; pino <= l_tcp->numpocs; ++pino) {
         l_tcd->cur_pino = pino;
 
         /*Get number of tile parts*/
-        tot_num_tp = opj_j2k_get_num_tp(l_cp, pino, p_j2k->m_current_tile_number);
+        tot_num_tp = opj_j2k_get_num_tp(l_cp, pino, p_tile_no, NULL);
         for (tilepartno = 0; tilepartno < tot_num_tp ; ++tilepartno) {
-            p_j2k->m_specific_param.m_encoder.m_current_poc_tile_part_number = tilepartno;
+            l_tcd->tp_num = tilepartno;
             l_current_nb_bytes_written = 0;
             l_part_tile_size = 0;
             l_begin_data = p_data;
 
-            if (! opj_j2k_write_sot(p_j2k, p_data,
+            if (! opj_j2k_write_sot(p_j2k, p_tile_no, l_tcd->cur_tp_num,
+                                    p_data,
                                     total_data_size,
-                                    &l_current_nb_bytes_written, p_stream,
+                                    &l_current_nb_bytes_written,
                                     p_manager)) {
                 return OPJ_FALSE;
             }
@@ -13350,8 +15682,9 @@ static OPJ_BOOL opj_j2k_write_all_tile_parts(opj_j2k_t *p_j2k,
 
             l_current_nb_bytes_written = 0;
 
-            if (! opj_j2k_write_sod(p_j2k, l_tcd, p_data, &l_current_nb_bytes_written,
-                                    total_data_size, p_stream, p_manager)) {
+            if (! opj_j2k_write_sod(p_j2k, l_tcd, p_tile_no, p_data,
+                                    &l_current_nb_bytes_written,
+                                    total_data_size, p_manager)) {
                 return OPJ_FALSE;
             }
 
@@ -13364,11 +15697,7 @@ static OPJ_BOOL opj_j2k_write_all_tile_parts(opj_j2k_t *p_j2k,
             opj_write_bytes(l_begin_data + 6, l_part_tile_size,
                             4);                                   /* PSOT */
 
-            if (p_j2k->m_specific_param.m_encoder.m_TLM) {
-                opj_j2k_update_tlm(p_j2k, l_part_tile_size);
-            }
-
-            ++p_j2k->m_specific_param.m_encoder.m_current_tile_part_number;
+            ++l_tcd->cur_tp_num;
         }
     }
 
@@ -13377,6 +15706,38 @@ static OPJ_BOOL opj_j2k_write_all_tile_parts(opj_j2k_t *p_j2k,
     return OPJ_TRUE;
 }
 
+static OPJ_BOOL opj_j2k_write_tile_parts(opj_j2k_t *p_j2k,
+        opj_tcd_t * p_tcd,
+        OPJ_UINT32 p_tile_no,
+        OPJ_BYTE * p_data,
+        OPJ_UINT32 * p_data_written,
+        OPJ_UINT32 total_data_size,
+        struct opj_event_mgr * p_manager)
+{
+    OPJ_UINT32 l_nb_bytes_written = 0;
+    OPJ_UINT32 l_available_data = total_data_size;
+
+    if (! opj_j2k_write_first_tile_part(p_j2k, p_tcd, p_tile_no, p_data,
+                                        &l_nb_bytes_written, l_available_data,
+                                        p_manager)) {
+        return OPJ_FALSE;
+    }
+    p_data += l_nb_bytes_written;
+    l_available_data -= l_nb_bytes_written;
+
+    l_nb_bytes_written = 0;
+    if (! opj_j2k_write_all_tile_parts(p_j2k, p_tcd, p_tile_no, p_data,
+                                       &l_nb_bytes_written, l_available_data,
+                                       p_manager)) {
+        return OPJ_FALSE;
+    }
+    l_available_data -= l_nb_bytes_written;
+
+    *p_data_written = total_data_size - l_available_data;
+
+    return OPJ_TRUE;
+}
+
 static OPJ_BOOL opj_j2k_write_updated_tlm(opj_j2k_t *p_j2k,
         struct opj_stream_private *p_stream,
         struct opj_event_mgr * p_manager)
@@ -13547,7 +15908,7 @@ static OPJ_BOOL opj_j2k_create_tcd(opj_j2k_t *p_j2k,
 
     OPJ_UNUSED(p_stream);
 
-    p_j2k->m_tcd = opj_tcd_create(OPJ_FALSE);
+    p_j2k->m_tcd = opj_tcd_create(OPJ_FALSE, NULL, NULL);
 
     if (! p_j2k->m_tcd) {
         opj_event_msg(p_manager, EVT_ERROR, "Not enough memory to create Tile Coder\n");
@@ -13581,7 +15942,7 @@ OPJ_BOOL opj_j2k_write_tile(opj_j2k_t * p_j2k,
         for (j = 0; j < p_j2k->m_tcd->image->numcomps; ++j) {
             opj_tcd_tilecomp_t* l_tilec = p_j2k->m_tcd->tcd_image->tiles->comps + j;
 
-            if (! opj_alloc_tile_component_data(l_tilec)) {
+            if (! opj_alloc_tile_component_data(l_tilec, NULL)) {
                 opj_event_msg(p_manager, EVT_ERROR, "Error allocating tile component data.");
                 return OPJ_FALSE;
             }
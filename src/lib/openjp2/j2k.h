@@ -287,6 +287,15 @@ typedef struct opj_tcp {
     OPJ_BYTE *      m_data;
     /** size of data */
     OPJ_UINT32      m_data_size;
+    /** lengths of the packets of m_data in codestream order, read from the
+     * PLT markers. Only valid for decoding, and if m_packet_lengths_invalid == 0 */
+    OPJ_UINT32 *    m_packet_lengths;
+    /** number of packet lengths */
+    OPJ_UINT32      m_nb_packet_lengths;
+    /** allocated size of m_packet_lengths */
+    OPJ_UINT32      m_max_packet_lengths;
+    /** index of the first packet length of the current tile-part */
+    OPJ_UINT32      m_packet_lengths_tp_start;
     /** encoding norms */
     OPJ_FLOAT64 *   mct_norms;
     /** the mct decoding matrix */
@@ -314,6 +323,15 @@ typedef struct opj_tcp {
     OPJ_BITFIELD ppt : 1;
     /** indicates if a POC marker has been used O:NO, 1:YES */
     OPJ_BITFIELD POC : 1;
+    /** If m_data_borrowed == 1 --> m_data points into the memory of the stream,
+     * and must neither be freed nor written */
+    OPJ_BITFIELD m_data_borrowed : 1;
+    /** If m_packet_lengths_invalid == 1 --> a tile-part had no or inconsistent
+     * PLT markers, so packets must be skipped by parsing their header */
+    OPJ_BITFIELD m_packet_lengths_invalid : 1;
+    /** If m_data_truncated == 1 --> m_data only holds the packets of the
+     * num_layers_to_decode first quality layers */
+    OPJ_BITFIELD m_data_truncated : 1;
 } opj_tcp_t;
 
 
@@ -537,14 +555,55 @@ typedef struct opj_j2k_dec {
     OPJ_BITFIELD m_nb_tile_parts_correction_checked : 1;
     OPJ_BITFIELD m_nb_tile_parts_correction : 1;
 
+    /** Maximum number of tiles decoded concurrently by opj_j2k_decode_tiles().
+     * 0 or 1 means that tiles are decoded one after the other. */
+    OPJ_UINT32 m_max_tiles_in_flight;
+
+    /** Maximum size in bytes of m_cblk_cache, 0 to disable it */
+    OPJ_SIZE_T m_cblk_cache_size;
+    /** Code-blocks decoded by a previous partial decoding of a single-tiled
+     * image, created by opj_j2k_decode() when m_cblk_cache_size is set */
+    opj_cblk_cache_t* m_cblk_cache;
+
+    /** Whether a single-tiled image may be decoded again with more quality
+     * layers (see opj_j2k_set_decoded_quality_layers()) or a lower
+     * resolution factor (PROGRESSIVE_REFINEMENT option). The data of all
+     * the layers is then read, and the tile is kept with its decoded
+     * code-blocks and wavelet coefficients. */
+    OPJ_BOOL m_refinable;
+
+    /** Function receiving the strips decoded by opj_j2k_decode_strips(), or
+     * NULL when decoding into the output image. */
+    opj_decode_strip_fn m_strip_fn;
+    /** User data passed to m_strip_fn */
+    void * m_strip_user_data;
+    /** Maximum height of the strips, in rows of the decoded image */
+    OPJ_UINT32 m_strip_height;
+
+    /** Whether decoding statistics are collected, see opj_j2k_enable_stats() */
+    OPJ_BOOL m_stats_enabled;
+    /** Statistics returned by opj_j2k_get_stats(). The tiles array is
+     * allocated with the first tile, and the totals are computed from it */
+    opj_codec_stats_t m_stats;
+    /** Time spent in markers outside of tile-part headers */
+    opj_stage_time_t m_stats_header_time;
+    /** Number of bytes of the main header */
+    OPJ_UINT64 m_stats_header_size;
+
+    /** Allocator of the arenas of the tile decoders, see
+     * opj_j2k_set_allocator(). Its functions are NULL for the default one */
+    opj_allocator_t m_allocator;
+    /** Counter of the memory held by the tile decoders and the code-block
+     * cache, whose peak is reported by opj_j2k_get_stats() */
+    opj_mem_counter_t* m_mem_counter;
+
 } opj_j2k_dec_t;
 
 typedef struct opj_j2k_enc {
-    /** Tile part number, regardless of poc, for each new poc, tp is reset to 1*/
-    OPJ_UINT32 m_current_poc_tile_part_number; /* tp_num */
-
-    /** Tile part number currently coding, taking into account POC. m_current_tile_part_number holds the total number of tile parts while encoding the last tile part.*/
-    OPJ_UINT32 m_current_tile_part_number; /*cur_tp_num */
+    /** Unused, always 0. This must stay the first member: it overlaps
+     * m_decoder.m_state in opj_j2k_t::m_specific_param, which the encoding
+     * validation expects to be 0. */
+    OPJ_UINT32 m_reserved_state;
 
     /* whether to generate TLM markers */
     OPJ_BOOL   m_TLM;
@@ -592,6 +651,10 @@ typedef struct opj_j2k_enc {
     /** Number of components */
     OPJ_UINT32 m_nb_comps;
 
+    /** Maximum number of tiles encoded concurrently by opj_j2k_encode().
+     * 0 or 1 means that tiles are encoded one after the other. */
+    OPJ_UINT32 m_max_tiles_in_flight;
+
 } opj_j2k_enc_t;
 
 
@@ -666,8 +729,65 @@ void opj_j2k_setup_decoder(opj_j2k_t *j2k, opj_dparameters_t *parameters);
 
 void opj_j2k_decoder_set_strict_mode(opj_j2k_t *j2k, OPJ_BOOL strict);
 
+/**
+ * Specify extra options for the decoder.
+ *
+ * @param  p_j2k        the jpeg2000 codec.
+ * @param  p_options    options
+ * @param  p_manager    the user event manager
+ *
+ * @see opj_decoder_set_extra_options() for more details.
+ */
+OPJ_BOOL opj_j2k_decoder_set_extra_options(opj_j2k_t *p_j2k,
+        const char* const* p_options,
+        opj_event_mgr_t * p_manager);
+
 OPJ_BOOL opj_j2k_set_threads(opj_j2k_t *j2k, OPJ_UINT32 num_threads);
 
+/**
+ * Makes the codec use a shared thread pool.
+ *
+ * @param  j2k          the jpeg2000 codec.
+ * @param  tp           thread pool, or NULL to only use the main thread.
+ *
+ * @see opj_codec_set_thread_pool() for more details.
+ */
+OPJ_BOOL opj_j2k_set_thread_pool(opj_j2k_t *j2k, opj_thread_pool_t* tp);
+
+/**
+ * Enables or disables the collection of decoding statistics.
+ *
+ * @param p_j2k     the jpeg2000 codec.
+ * @param enable    whether statistics must be collected. Enabling them
+ *                  again resets them.
+ * @param p_manager the user event manager.
+ *
+ * @return OPJ_TRUE in case of success.
+ */
+OPJ_BOOL opj_j2k_enable_stats(opj_j2k_t *p_j2k,
+                              OPJ_BOOL enable,
+                              opj_event_mgr_t * p_manager);
+
+/**
+ * Returns the decoding statistics, or NULL if they are not collected.
+ *
+ * @param p_j2k     the jpeg2000 codec.
+ */
+const opj_codec_stats_t* opj_j2k_get_stats(opj_j2k_t *p_j2k);
+
+/**
+ * Sets the allocator of the coding structures of the tiles.
+ *
+ * @param p_j2k         the jpeg2000 codec.
+ * @param p_allocator   allocator, or NULL for the default one.
+ * @param p_manager     the user event manager
+ *
+ * @see opj_codec_set_allocator() for more details.
+ */
+OPJ_BOOL opj_j2k_set_allocator(opj_j2k_t *p_j2k,
+                               const opj_allocator_t* p_allocator,
+                               opj_event_mgr_t * p_manager);
+
 /**
  * Creates a J2K compression structure
  *
@@ -699,6 +819,18 @@ OPJ_BOOL opj_j2k_end_decompress(opj_j2k_t *j2k,
                                 opj_stream_private_t *p_stream,
                                 opj_event_mgr_t * p_manager);
 
+/**
+ * Prepares the decompressor to read another codestream, keeping the
+ * decoding parameters, the thread pool and the tile decoder.
+ *
+ * @param p_j2k         the jpeg2000 codec.
+ * @param p_manager     the user event manager
+ *
+ * @see opj_reset_decompress() for more details.
+ */
+OPJ_BOOL opj_j2k_reset_decompress(opj_j2k_t *p_j2k,
+                                  opj_event_mgr_t * p_manager);
+
 /**
  * Reads a jpeg2000 codestream header structure.
  *
@@ -729,6 +861,16 @@ void opj_j2k_destroy(opj_j2k_t *p_j2k);
  */
 void j2k_destroy_cstr_index(opj_codestream_index_t *p_cstr_ind);
 
+/**
+ * Copies the decoded samples of the current tile of the tile coder into the
+ * output image, allocating its component buffers if needed. The time spent
+ * is added to the statistics of the tile, if they are collected.
+ * @param   p_tcd           the tile coder, holding a decoded tile.
+ * @param   p_output_image  the image to copy the tile samples to.
+ */
+OPJ_BOOL opj_j2k_update_image_data(struct opj_tcd * p_tcd,
+                                   opj_image_t* p_output_image);
+
 /**
  * Decode tile data.
  * @param   p_j2k       the jpeg2000 codec.
@@ -877,6 +1019,26 @@ OPJ_BOOL opj_j2k_decode(opj_j2k_t *j2k,
                         opj_image_t *p_image,
                         opj_event_mgr_t *p_manager);
 
+/**
+ * Decode an image from a JPEG-2000 codestream, by horizontal strips passed
+ * to a user function, without allocating the component buffers of p_image.
+ * @param j2k J2K decompressor handle
+ * @param p_stream  the stream to read data from.
+ * @param p_image   the image header returned by opj_j2k_read_header()
+ * @param strip_height  maximum height of the strips, in rows of the decoded image
+ * @param strip_fn  function receiving the strips
+ * @param user_data user data passed to strip_fn
+ * @param p_manager the user event manager.
+ * @return OPJ_TRUE in case of success.
+*/
+OPJ_BOOL opj_j2k_decode_strips(opj_j2k_t *j2k,
+                               opj_stream_private_t *p_stream,
+                               opj_image_t *p_image,
+                               OPJ_UINT32 strip_height,
+                               opj_decode_strip_fn strip_fn,
+                               void *user_data,
+                               opj_event_mgr_t *p_manager);
+
 
 OPJ_BOOL opj_j2k_get_tile(opj_j2k_t *p_j2k,
                           opj_stream_private_t *p_stream,
@@ -888,6 +1050,18 @@ OPJ_BOOL opj_j2k_set_decoded_resolution_factor(opj_j2k_t *p_j2k,
         OPJ_UINT32 res_factor,
         opj_event_mgr_t * p_manager);
 
+/**
+ * Sets the number of quality layers to decode, and reads the data of all
+ * the layers from then on so that it can be raised between decodings.
+ *
+ * @param p_j2k         the jpeg2000 codec.
+ * @param num_layers    number of quality layers, or 0 for all of them.
+ * @param p_manager     the user event manager.
+ */
+OPJ_BOOL opj_j2k_set_decoded_quality_layers(opj_j2k_t *p_j2k,
+        OPJ_UINT32 num_layers,
+        opj_event_mgr_t * p_manager);
+
 /**
  * Specify extra options for the encoder.
  *
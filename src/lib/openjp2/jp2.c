@@ -279,6 +279,14 @@ static OPJ_BOOL opj_jp2_apply_pclr(opj_image_t *image,
 
 static void opj_jp2_free_pclr(opj_jp2_color_t *color);
 
+/**
+ * Free the data read from the boxes of a file (component information,
+ * ICC profile, palette, channel definitions).
+ *
+ * @param jp2 JP2 handle
+ */
+static void opj_jp2_free_boxes_data(opj_jp2_t *jp2);
+
 /**
  * Collect palette data
  *
@@ -1647,6 +1655,29 @@ OPJ_BOOL opj_jp2_decode(opj_jp2_t *jp2,
     return opj_jp2_apply_color_postprocessing(jp2, p_image, p_manager);
 }
 
+OPJ_BOOL opj_jp2_decode_strips(opj_jp2_t *jp2,
+                               opj_stream_private_t *p_stream,
+                               opj_image_t* p_image,
+                               OPJ_UINT32 strip_height,
+                               opj_decode_strip_fn strip_fn,
+                               void *user_data,
+                               opj_event_mgr_t * p_manager)
+{
+    if (!p_image) {
+        return OPJ_FALSE;
+    }
+
+    /* J2K decoding */
+    if (! opj_j2k_decode_strips(jp2->j2k, p_stream, p_image, strip_height,
+                                strip_fn, user_data, p_manager)) {
+        opj_event_msg(p_manager, EVT_ERROR,
+                      "Failed to decode the codestream in the JP2 file\n");
+        return OPJ_FALSE;
+    }
+
+    return OPJ_TRUE;
+}
+
 static OPJ_BOOL opj_jp2_write_jp2h(opj_jp2_t *jp2,
                                    opj_stream_private_t *stream,
                                    opj_event_mgr_t * p_manager
@@ -1892,11 +1923,42 @@ void opj_jp2_decoder_set_strict_mode(opj_jp2_t *jp2, OPJ_BOOL strict)
     opj_j2k_decoder_set_strict_mode(jp2->j2k, strict);
 }
 
+OPJ_BOOL opj_jp2_decoder_set_extra_options(opj_jp2_t *jp2,
+        const char* const* p_options,
+        opj_event_mgr_t * p_manager)
+{
+    return opj_j2k_decoder_set_extra_options(jp2->j2k, p_options, p_manager);
+}
+
 OPJ_BOOL opj_jp2_set_threads(opj_jp2_t *jp2, OPJ_UINT32 num_threads)
 {
     return opj_j2k_set_threads(jp2->j2k, num_threads);
 }
 
+OPJ_BOOL opj_jp2_set_thread_pool(opj_jp2_t *jp2, opj_thread_pool_t* tp)
+{
+    return opj_j2k_set_thread_pool(jp2->j2k, tp);
+}
+
+OPJ_BOOL opj_jp2_enable_stats(opj_jp2_t *jp2,
+                              OPJ_BOOL enable,
+                              opj_event_mgr_t * p_manager)
+{
+    return opj_j2k_enable_stats(jp2->j2k, enable, p_manager);
+}
+
+const opj_codec_stats_t* opj_jp2_get_stats(opj_jp2_t *jp2)
+{
+    return opj_j2k_get_stats(jp2->j2k);
+}
+
+OPJ_BOOL opj_jp2_set_allocator(opj_jp2_t *jp2,
+                               const opj_allocator_t* p_allocator,
+                               opj_event_mgr_t * p_manager)
+{
+    return opj_j2k_set_allocator(jp2->j2k, p_allocator, p_manager);
+}
+
 /* ----------------------------------------------------------------------- */
 /* JP2 encoder interface                                             */
 /* ----------------------------------------------------------------------- */
@@ -2128,6 +2190,39 @@ OPJ_BOOL opj_jp2_end_decompress(opj_jp2_t *jp2,
     return opj_j2k_end_decompress(jp2->j2k, cio, p_manager);
 }
 
+OPJ_BOOL opj_jp2_reset_decompress(opj_jp2_t *jp2,
+                                  opj_event_mgr_t * p_manager)
+{
+    /* preconditions */
+    assert(jp2 != 00);
+    assert(p_manager != 00);
+
+    opj_jp2_free_boxes_data(jp2);
+
+    jp2->w = 0;
+    jp2->h = 0;
+    jp2->numcomps = 0;
+    jp2->bpc = 0;
+    jp2->C = 0;
+    jp2->UnkC = 0;
+    jp2->IPR = 0;
+    jp2->meth = 0;
+    jp2->approx = 0;
+    jp2->enumcs = 0;
+    jp2->precedence = 0;
+    jp2->brand = 0;
+    jp2->minversion = 0;
+    jp2->numcl = 0;
+    jp2->jp2_state = JP2_STATE_NONE;
+    jp2->jp2_img_state = JP2_IMG_STATE_NONE;
+    jp2->color.icc_profile_len = 0;
+    jp2->color.jp2_has_colr = 0;
+    jp2->has_jp2h = 0;
+    jp2->has_ihdr = 0;
+
+    return opj_j2k_reset_decompress(jp2->j2k, p_manager);
+}
+
 OPJ_BOOL opj_jp2_end_compress(opj_jp2_t *jp2,
                               opj_stream_private_t *cio,
                               opj_event_mgr_t * p_manager
@@ -3036,59 +3131,64 @@ OPJ_BOOL opj_jp2_decode_tile(opj_jp2_t * p_jp2,
                                p_stream, p_manager);
 }
 
-void opj_jp2_destroy(opj_jp2_t *jp2)
+static void opj_jp2_free_boxes_data(opj_jp2_t *jp2)
 {
-    if (jp2) {
-        /* destroy the J2K codec */
-        opj_j2k_destroy(jp2->j2k);
-        jp2->j2k = 00;
+    if (jp2->comps) {
+        opj_free(jp2->comps);
+        jp2->comps = 00;
+    }
 
-        if (jp2->comps) {
-            opj_free(jp2->comps);
-            jp2->comps = 00;
-        }
+    if (jp2->cl) {
+        opj_free(jp2->cl);
+        jp2->cl = 00;
+    }
 
-        if (jp2->cl) {
-            opj_free(jp2->cl);
-            jp2->cl = 00;
-        }
+    if (jp2->color.icc_profile_buf) {
+        opj_free(jp2->color.icc_profile_buf);
+        jp2->color.icc_profile_buf = 00;
+    }
 
-        if (jp2->color.icc_profile_buf) {
-            opj_free(jp2->color.icc_profile_buf);
-            jp2->color.icc_profile_buf = 00;
+    if (jp2->color.jp2_cdef) {
+        if (jp2->color.jp2_cdef->info) {
+            opj_free(jp2->color.jp2_cdef->info);
+            jp2->color.jp2_cdef->info = NULL;
         }
 
-        if (jp2->color.jp2_cdef) {
-            if (jp2->color.jp2_cdef->info) {
-                opj_free(jp2->color.jp2_cdef->info);
-                jp2->color.jp2_cdef->info = NULL;
-            }
+        opj_free(jp2->color.jp2_cdef);
+        jp2->color.jp2_cdef = 00;
+    }
 
-            opj_free(jp2->color.jp2_cdef);
-            jp2->color.jp2_cdef = 00;
+    if (jp2->color.jp2_pclr) {
+        if (jp2->color.jp2_pclr->cmap) {
+            opj_free(jp2->color.jp2_pclr->cmap);
+            jp2->color.jp2_pclr->cmap = NULL;
+        }
+        if (jp2->color.jp2_pclr->channel_sign) {
+            opj_free(jp2->color.jp2_pclr->channel_sign);
+            jp2->color.jp2_pclr->channel_sign = NULL;
+        }
+        if (jp2->color.jp2_pclr->channel_size) {
+            opj_free(jp2->color.jp2_pclr->channel_size);
+            jp2->color.jp2_pclr->channel_size = NULL;
+        }
+        if (jp2->color.jp2_pclr->entries) {
+            opj_free(jp2->color.jp2_pclr->entries);
+            jp2->color.jp2_pclr->entries = NULL;
         }
 
-        if (jp2->color.jp2_pclr) {
-            if (jp2->color.jp2_pclr->cmap) {
-                opj_free(jp2->color.jp2_pclr->cmap);
-                jp2->color.jp2_pclr->cmap = NULL;
-            }
-            if (jp2->color.jp2_pclr->channel_sign) {
-                opj_free(jp2->color.jp2_pclr->channel_sign);
-                jp2->color.jp2_pclr->channel_sign = NULL;
-            }
-            if (jp2->color.jp2_pclr->channel_size) {
-                opj_free(jp2->color.jp2_pclr->channel_size);
-                jp2->color.jp2_pclr->channel_size = NULL;
-            }
-            if (jp2->color.jp2_pclr->entries) {
-                opj_free(jp2->color.jp2_pclr->entries);
-                jp2->color.jp2_pclr->entries = NULL;
-            }
+        opj_free(jp2->color.jp2_pclr);
+        jp2->color.jp2_pclr = 00;
+    }
+}
 
-            opj_free(jp2->color.jp2_pclr);
-            jp2->color.jp2_pclr = 00;
-        }
+void opj_jp2_destroy(opj_jp2_t *jp2)
+{
+    if (jp2) {
+        /* destroy the J2K codec */
+        opj_j2k_destroy(jp2->j2k);
+        jp2->j2k = 00;
+
+        opj_jp2_free_boxes_data(jp2);
 
         if (jp2->m_validation_list) {
             opj_procedure_list_destroy(jp2->m_validation_list);
@@ -3221,6 +3321,13 @@ OPJ_BOOL opj_jp2_set_decoded_resolution_factor(opj_jp2_t *p_jp2,
     return opj_j2k_set_decoded_resolution_factor(p_jp2->j2k, res_factor, p_manager);
 }
 
+OPJ_BOOL opj_jp2_set_decoded_quality_layers(opj_jp2_t *p_jp2,
+        OPJ_UINT32 num_layers,
+        opj_event_mgr_t * p_manager)
+{
+    return opj_j2k_set_decoded_quality_layers(p_jp2->j2k, num_layers, p_manager);
+}
+
 /* ----------------------------------------------------------------------- */
 
 OPJ_BOOL opj_jp2_encoder_set_extra_options(
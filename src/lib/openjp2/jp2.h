@@ -244,6 +244,19 @@ the decoder will decode partial bitstreams.
 */
 void opj_jp2_decoder_set_strict_mode(opj_jp2_t *jp2, OPJ_BOOL strict);
 
+/**
+ * Specify extra options for the decoder.
+ *
+ * @param  jp2          JP2 decompressor handle
+ * @param  p_options    Decompression options
+ * @param  p_manager    the user event manager
+ *
+ * @see opj_decoder_set_extra_options() for more details.
+ */
+OPJ_BOOL opj_jp2_decoder_set_extra_options(opj_jp2_t *jp2,
+        const char* const* p_options,
+        opj_event_mgr_t * p_manager);
+
 /** Allocates worker threads for the compressor/decompressor.
  *
  * @param jp2 JP2 decompressor handle
@@ -252,6 +265,46 @@ void opj_jp2_decoder_set_strict_mode(opj_jp2_t *jp2, OPJ_BOOL strict);
  */
 OPJ_BOOL opj_jp2_set_threads(opj_jp2_t *jp2, OPJ_UINT32 num_threads);
 
+/** Makes the compressor/decompressor use a shared thread pool.
+ *
+ * @param jp2 JP2 decompressor handle
+ * @param tp Thread pool, or NULL.
+ * @return OPJ_TRUE in case of success.
+ * @see opj_codec_set_thread_pool() for more details.
+ */
+OPJ_BOOL opj_jp2_set_thread_pool(opj_jp2_t *jp2, opj_thread_pool_t* tp);
+
+/** Enables or disables the collection of decoding statistics.
+ *
+ * @param jp2 JP2 decompressor handle
+ * @param enable Whether statistics must be collected.
+ * @param p_manager the user event manager
+ * @return OPJ_TRUE in case of success.
+ * @see opj_codec_enable_stats() for more details.
+ */
+OPJ_BOOL opj_jp2_enable_stats(opj_jp2_t *jp2,
+                              OPJ_BOOL enable,
+                              opj_event_mgr_t * p_manager);
+
+/** Returns the decoding statistics, or NULL if they are not collected.
+ *
+ * @param jp2 JP2 decompressor handle
+ * @see opj_codec_get_stats() for more details.
+ */
+const opj_codec_stats_t* opj_jp2_get_stats(opj_jp2_t *jp2);
+
+/** Sets the allocator of the coding structures of the tiles.
+ *
+ * @param jp2 JP2 decompressor handle
+ * @param p_allocator allocator, or NULL for the default one.
+ * @param p_manager the user event manager
+ * @return OPJ_TRUE in case of success.
+ * @see opj_codec_set_allocator() for more details.
+ */
+OPJ_BOOL opj_jp2_set_allocator(opj_jp2_t *jp2,
+                               const opj_allocator_t* p_allocator,
+                               opj_event_mgr_t * p_manager);
+
 /**
  * Decode an image from a JPEG-2000 file stream
  * @param jp2 JP2 decompressor handle
@@ -266,6 +319,28 @@ OPJ_BOOL opj_jp2_decode(opj_jp2_t *jp2,
                         opj_image_t* p_image,
                         opj_event_mgr_t * p_manager);
 
+/**
+ * Decode an image from a JPEG-2000 file stream, by horizontal strips passed
+ * to a user function. The strips contain the components of the codestream:
+ * palette and component mapping boxes are not applied.
+ * @param jp2 JP2 decompressor handle
+ * @param p_stream  the stream to read data from.
+ * @param p_image   the image header returned by opj_jp2_read_header()
+ * @param strip_height  maximum height of the strips, in rows of the decoded image
+ * @param strip_fn  function receiving the strips
+ * @param user_data user data passed to strip_fn
+ * @param p_manager the user event manager.
+ *
+ * @return OPJ_TRUE in case of success.
+*/
+OPJ_BOOL opj_jp2_decode_strips(opj_jp2_t *jp2,
+                               opj_stream_private_t *p_stream,
+                               opj_image_t* p_image,
+                               OPJ_UINT32 strip_height,
+                               opj_decode_strip_fn strip_fn,
+                               void *user_data,
+                               opj_event_mgr_t * p_manager);
+
 /**
  * Setup the encoder parameters using the current image and using user parameters.
  * Coding parameters are returned in jp2->j2k->cp.
@@ -327,6 +402,18 @@ OPJ_BOOL opj_jp2_end_decompress(opj_jp2_t *jp2,
                                 opj_stream_private_t *cio,
                                 opj_event_mgr_t * p_manager);
 
+/**
+ * Prepares the decompressor to read another file, keeping the decoding
+ * parameters, the thread pool and the tile decoder.
+ *
+ * @param jp2 JP2 decompressor handle
+ * @param p_manager the user event manager
+ * @return OPJ_TRUE in case of success.
+ * @see opj_reset_decompress() for more details.
+ */
+OPJ_BOOL opj_jp2_reset_decompress(opj_jp2_t *jp2,
+                                  opj_event_mgr_t * p_manager);
+
 /**
  * Reads a jpeg2000 file header structure.
  *
@@ -468,6 +555,17 @@ OPJ_BOOL opj_jp2_set_decoded_resolution_factor(opj_jp2_t *p_jp2,
         OPJ_UINT32 res_factor,
         opj_event_mgr_t * p_manager);
 
+/**
+ * Sets the number of quality layers to decode.
+ *
+ * @param p_jp2         the jpeg2000 codec.
+ * @param num_layers    number of quality layers, or 0 for all of them.
+ * @param p_manager     the user event manager.
+ */
+OPJ_BOOL opj_jp2_set_decoded_quality_layers(opj_jp2_t *p_jp2,
+        OPJ_UINT32 num_layers,
+        opj_event_mgr_t * p_manager);
+
 /**
  * Specify extra options for the encoder.
  *
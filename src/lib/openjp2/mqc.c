@@ -51,6 +51,17 @@ Fill mqc->c with 1's for flushing
 @param mqc MQC handle
 */
 static void opj_mqc_setbits(opj_mqc_t *mqc);
+/**
+Compute the c register of the decoder from a state saved by
+opj_mqc_save_dec(), with the bytes of the artificial marker read past the
+end of the segment replaced by the appended ones
+@param state State saved by opj_mqc_save_dec()
+@param appended The state->past_end first bytes appended to the segment
+@return c, which is negative if the symbols decoded from the appended bytes
+        would not have been the same
+*/
+static OPJ_INT64 opj_mqc_replace_past_end(const opj_mqc_dec_state_t *state,
+        const OPJ_BYTE *appended);
 /*@}*/
 
 /*@}*/
@@ -470,6 +481,101 @@ void opq_mqc_finish_dec(opj_mqc_t *mqc)
     memcpy(mqc->end, mqc->backup, OPJ_COMMON_CBLK_DATA_EXTRA);
 }
 
+OPJ_BOOL opj_mqc_save_dec(const opj_mqc_t *mqc, OPJ_BOOL raw,
+                          opj_mqc_dec_state_t *state)
+{
+    OPJ_UINT32 i;
+
+    state->offset = (OPJ_UINT32)(mqc->bp - mqc->start);
+    state->c = mqc->c;
+    state->a = mqc->a;
+    state->ct = mqc->ct;
+    for (i = 0; i < MQC_NUMCTXS; i++) {
+        state->ctxs[i] = (OPJ_BYTE)(mqc->ctxs[i] - mqc_states);
+    }
+
+    state->past_end = 0;
+    if (raw) {
+        /* bp is the next byte to read. A 0xFF byte read last might be */
+        /* followed by the artificial marker, or by a stuffed bit */
+        return mqc->bp < mqc->end ||
+               (mqc->bp == mqc->end && mqc->c != 0xff);
+    }
+    if (mqc->bp < mqc->end) {
+        /* The MQ decoder also reads the byte after bp without moving on a */
+        /* 0xFF followed by a byte > 0x8F, which end_of_byte_stream_counter */
+        /* counts */
+        return mqc->end_of_byte_stream_counter == 0;
+    }
+    /* bp, the last byte read, is the first byte of the marker. It has been */
+    /* read after a byte which is not 0xFF, as the appended byte will be, */
+    /* and then each increment of end_of_byte_stream_counter has read 8 */
+    /* more bits of the marker, as the next appended bytes will be unless */
+    /* they follow a 0xFF */
+    state->past_end = mqc->end_of_byte_stream_counter + 1;
+    return mqc->start < mqc->end && state->past_end <= MQC_MAX_PAST_END;
+}
+
+static OPJ_INT64 opj_mqc_replace_past_end(const opj_mqc_dec_state_t *state,
+        const OPJ_BYTE *appended)
+{
+    OPJ_INT64 c = (OPJ_INT64)state->c;
+    OPJ_UINT32 i;
+
+    /* The last byte read has been shifted by 8 - ct bits since it was */
+    /* added to c, and each previous one by 8 more bits */
+    for (i = 0; i < state->past_end; i++) {
+        c -= (OPJ_INT64)(0xff - appended[i]) <<
+             (8 * (state->past_end - i) + 8 - state->ct);
+    }
+    return c;
+}
+
+OPJ_BOOL opj_mqc_can_resume_dec(const opj_mqc_dec_state_t *state,
+                                const OPJ_BYTE *appended)
+{
+    OPJ_UINT32 i;
+
+    /* A 0xFF byte would be followed by a stuffed bit */
+    for (i = 0; i + 1 < state->past_end; i++) {
+        if (appended[i] == 0xff) {
+            return OPJ_FALSE;
+        }
+    }
+    /* The marker is the largest possible continuation, so the bytes */
+    /* appended can only make c smaller: a symbol decoded differently is */
+    /* one for which the decoder has subtracted the probability of the LPS */
+    /* from c, but should not have, which leaves it negative */
+    return opj_mqc_replace_past_end(state, appended) >= 0;
+}
+
+void opj_mqc_resume_dec(opj_mqc_t *mqc, OPJ_BYTE *bp, OPJ_UINT32 len,
+                        OPJ_UINT32 extra_writable_bytes,
+                        const opj_mqc_dec_state_t *state)
+{
+    assert(state->offset < len && state->offset + state->past_end <= len);
+    opj_mqc_init_dec_common(mqc, bp, len, extra_writable_bytes);
+    opj_mqc_setcurctx(mqc, 0);
+    mqc->end_of_byte_stream_counter = 0;
+    mqc->bp = bp + state->offset;
+    mqc->c = state->c;
+    mqc->a = state->a;
+    mqc->ct = state->ct;
+    if (state->past_end > 0) {
+        mqc->c = (OPJ_UINT32)opj_mqc_replace_past_end(state, mqc->bp);
+        mqc->bp += state->past_end - 1;
+    }
+    opj_mqc_restorestates(mqc, state);
+}
+
+void opj_mqc_restorestates(opj_mqc_t *mqc, const opj_mqc_dec_state_t *state)
+{
+    OPJ_UINT32 i;
+    for (i = 0; i < MQC_NUMCTXS; i++) {
+        mqc->ctxs[i] = &mqc_states[state->ctxs[i]];
+    }
+}
+
 void opj_mqc_resetstates(opj_mqc_t *mqc)
 {
     OPJ_UINT32 i;
@@ -67,6 +67,9 @@ typedef struct opj_mqc_state {
 } opj_mqc_state_t;
 
 #define MQC_NUMCTXS 19
+/** Maximum number of bytes read past the end of a segment by the MQ decoder
+for its decoding to be resumed with more bytes (see opj_mqc_save_dec()) */
+#define MQC_MAX_PAST_END 6
 
 /**
 MQ coder
@@ -96,6 +99,26 @@ typedef struct opj_mqc {
     OPJ_BYTE backup[OPJ_COMMON_CBLK_DATA_EXTRA];
 } opj_mqc_t;
 
+/**
+State of the MQ or RAW decoder at the end of a coding pass, from which the
+decoding of the segment can be resumed once more bytes have been appended to
+it (see opj_mqc_save_dec() and opj_mqc_resume_dec())
+*/
+typedef struct opj_mqc_dec_state {
+    /** offset of the current position from the start of the buffer */
+    OPJ_UINT32 offset;
+    /** number of bytes of the artificial 0xFF 0xFF marker read by the MQ
+    decoder (it reads ahead), at most MQC_MAX_PAST_END, which the bytes
+    appended to the segment must replace (see opj_mqc_can_resume_dec()) */
+    OPJ_UINT32 past_end;
+    /** saved c, a and ct registers */
+    OPJ_UINT32 c;
+    OPJ_UINT32 a;
+    OPJ_UINT32 ct;
+    /** index of the state of each context in the state table */
+    OPJ_BYTE ctxs[MQC_NUMCTXS];
+} opj_mqc_dec_state_t;
+
 #define BYPASS_CT_INIT  0xDEADBEEF
 
 #include "mqc_inl.h"
@@ -254,6 +277,66 @@ opj_mqc_raw_init_dec()
 */
 void opq_mqc_finish_dec(opj_mqc_t *mqc);
 
+/**
+Save the state of the decoder at the end of a coding pass.
+
+The decoding can only be resumed from that state if the bytes past the end
+of the segment read so far, that is those of the artificial 0xFF 0xFF marker,
+have been read as the bytes appended to the segment will be, and have been
+decoded as them (see opj_mqc_can_resume_dec()).
+
+@param mqc MQC handle
+@param raw OPJ_TRUE if the decoder has been initialized with
+           opj_mqc_raw_init_dec()
+@param state Saved state
+@return OPJ_TRUE if the decoding can be resumed from the saved state with more
+        bytes appended to the segment.
+*/
+OPJ_BOOL opj_mqc_save_dec(const opj_mqc_t *mqc, OPJ_BOOL raw,
+                          opj_mqc_dec_state_t *state);
+
+/**
+Check whether the decoding of a segment can be resumed from a state saved by
+opj_mqc_save_dec(), once bytes have been appended to the segment: the
+symbols decoded so far from the bytes of the artificial marker must be the
+same as from the appended bytes. The encoder does not always include enough
+bytes before a truncation point to guarantee it.
+
+@param state State saved by opj_mqc_save_dec()
+@param appended The state->past_end first bytes appended to the segment
+@return OPJ_TRUE if the decoding can be resumed
+*/
+OPJ_BOOL opj_mqc_can_resume_dec(const opj_mqc_dec_state_t *state,
+                                const OPJ_BYTE *appended);
+
+/**
+Resume the decoding of a segment from a state saved by opj_mqc_save_dec().
+
+opj_mqc_finish_dec() must be absolutely called after finishing the decoding
+passes, so as to restore the bytes temporarily overwritten.
+
+@param mqc MQC handle
+@param bp Pointer to the start of the segment, with the same requirements as
+          for opj_mqc_init_dec()
+@param len Length of the segment, which must be larger than state->offset
+           and at least state->offset + state->past_end. If state->past_end
+           is not 0, opj_mqc_can_resume_dec() must have returned OPJ_TRUE
+           for the bytes appended.
+@param extra_writable_bytes Indicate how many bytes after len are writable.
+@param state State saved by opj_mqc_save_dec()
+*/
+void opj_mqc_resume_dec(opj_mqc_t *mqc, OPJ_BYTE *bp, OPJ_UINT32 len,
+                        OPJ_UINT32 extra_writable_bytes,
+                        const opj_mqc_dec_state_t *state);
+
+/**
+Restore the contexts saved by opj_mqc_save_dec(), without touching the
+position in the buffer nor the registers.
+@param mqc MQC handle
+@param state State saved by opj_mqc_save_dec()
+*/
+void opj_mqc_restorestates(opj_mqc_t *mqc, const opj_mqc_dec_state_t *state);
+
 /**
 Decode a symbol
 @param mqc MQC handle
@@ -37,6 +37,13 @@
 
 #include "opj_includes.h"
 
+#if !defined(_WIN32) && defined(OPJ_HAVE_MMAP)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 
 /* ---------------------------------------------------------------------- */
 /* Functions to set the message handlers */
@@ -185,6 +192,9 @@ opj_codec_t* OPJ_CALLCONV opj_create_decompress(OPJ_CODEC_FORMAT p_format)
 {
     opj_codec_private_t *l_codec = 00;
 
+    /* Resolve the SIMD kernels now, rather than from worker threads */
+    opj_cpu_init();
+
     l_codec = (opj_codec_private_t*) opj_calloc(1, sizeof(opj_codec_private_t));
     if (!l_codec) {
         return 00;
@@ -207,6 +217,15 @@ opj_codec_t* OPJ_CALLCONV opj_create_decompress(OPJ_CODEC_FORMAT p_format)
                          struct opj_stream_private *,
                          opj_image_t*, struct opj_event_mgr *)) opj_j2k_decode;
 
+        l_codec->m_codec_data.m_decompression.opj_decode_strips =
+            (OPJ_BOOL(*)(void *,
+                         struct opj_stream_private *,
+                         opj_image_t*,
+                         OPJ_UINT32,
+                         opj_decode_strip_fn,
+                         void *,
+                         struct opj_event_mgr *)) opj_j2k_decode_strips;
+
         l_codec->m_codec_data.m_decompression.opj_end_decompress =
             (OPJ_BOOL(*)(void *,
                          struct opj_stream_private *,
@@ -227,6 +246,11 @@ opj_codec_t* OPJ_CALLCONV opj_create_decompress(OPJ_CODEC_FORMAT p_format)
         l_codec->m_codec_data.m_decompression.opj_decoder_set_strict_mode =
             (void (*)(void *, OPJ_BOOL)) opj_j2k_decoder_set_strict_mode;
 
+        l_codec->m_codec_data.m_decompression.opj_decoder_set_extra_options =
+            (OPJ_BOOL(*)(void *,
+                         const char* const*,
+                         struct opj_event_mgr *)) opj_j2k_decoder_set_extra_options;
+
 
         l_codec->m_codec_data.m_decompression.opj_read_tile_header =
             (OPJ_BOOL(*)(void *,
@@ -265,15 +289,40 @@ opj_codec_t* OPJ_CALLCONV opj_create_decompress(OPJ_CODEC_FORMAT p_format)
                          OPJ_UINT32 res_factor,
                          struct opj_event_mgr * p_manager)) opj_j2k_set_decoded_resolution_factor;
 
+        l_codec->m_codec_data.m_decompression.opj_set_decoded_quality_layers =
+            (OPJ_BOOL(*)(void * p_codec,
+                         OPJ_UINT32 num_layers,
+                         struct opj_event_mgr * p_manager)) opj_j2k_set_decoded_quality_layers;
+
         l_codec->m_codec_data.m_decompression.opj_set_decoded_components =
             (OPJ_BOOL(*)(void * p_codec,
                          OPJ_UINT32 numcomps,
                          const OPJ_UINT32 * comps_indices,
                          struct opj_event_mgr * p_manager)) opj_j2k_set_decoded_components;
 
+        l_codec->m_codec_data.m_decompression.opj_enable_stats =
+            (OPJ_BOOL(*)(void * p_codec,
+                         OPJ_BOOL enable,
+                         struct opj_event_mgr * p_manager)) opj_j2k_enable_stats;
+
+        l_codec->m_codec_data.m_decompression.opj_get_stats =
+            (const opj_codec_stats_t* (*)(void * p_codec)) opj_j2k_get_stats;
+
+        l_codec->m_codec_data.m_decompression.opj_set_allocator =
+            (OPJ_BOOL(*)(void * p_codec,
+                         const opj_allocator_t* p_allocator,
+                         struct opj_event_mgr * p_manager)) opj_j2k_set_allocator;
+
+        l_codec->m_codec_data.m_decompression.opj_reset_decompress =
+            (OPJ_BOOL(*)(void * p_codec,
+                         struct opj_event_mgr * p_manager)) opj_j2k_reset_decompress;
+
         l_codec->opj_set_threads =
             (OPJ_BOOL(*)(void * p_codec, OPJ_UINT32 num_threads)) opj_j2k_set_threads;
 
+        l_codec->opj_set_thread_pool =
+            (OPJ_BOOL(*)(void * p_codec, opj_thread_pool_t* tp)) opj_j2k_set_thread_pool;
+
         l_codec->m_codec = opj_j2k_create_decompress();
 
         if (! l_codec->m_codec) {
@@ -299,6 +348,15 @@ opj_codec_t* OPJ_CALLCONV opj_create_decompress(OPJ_CODEC_FORMAT p_format)
                          opj_image_t*,
                          struct opj_event_mgr *)) opj_jp2_decode;
 
+        l_codec->m_codec_data.m_decompression.opj_decode_strips =
+            (OPJ_BOOL(*)(void *,
+                         struct opj_stream_private *,
+                         opj_image_t*,
+                         OPJ_UINT32,
+                         opj_decode_strip_fn,
+                         void *,
+                         struct opj_event_mgr *)) opj_jp2_decode_strips;
+
         l_codec->m_codec_data.m_decompression.opj_end_decompress =
             (OPJ_BOOL(*)(void *,
                          struct opj_stream_private *,
@@ -338,6 +396,11 @@ opj_codec_t* OPJ_CALLCONV opj_create_decompress(OPJ_CODEC_FORMAT p_format)
         l_codec->m_codec_data.m_decompression.opj_decoder_set_strict_mode =
             (void (*)(void *, OPJ_BOOL)) opj_jp2_decoder_set_strict_mode;
 
+        l_codec->m_codec_data.m_decompression.opj_decoder_set_extra_options =
+            (OPJ_BOOL(*)(void *,
+                         const char* const*,
+                         struct opj_event_mgr *)) opj_jp2_decoder_set_extra_options;
+
         l_codec->m_codec_data.m_decompression.opj_set_decode_area =
             (OPJ_BOOL(*)(void *,
                          opj_image_t*,
@@ -356,15 +419,40 @@ opj_codec_t* OPJ_CALLCONV opj_create_decompress(OPJ_CODEC_FORMAT p_format)
                          OPJ_UINT32 res_factor,
                          opj_event_mgr_t * p_manager)) opj_jp2_set_decoded_resolution_factor;
 
+        l_codec->m_codec_data.m_decompression.opj_set_decoded_quality_layers =
+            (OPJ_BOOL(*)(void * p_codec,
+                         OPJ_UINT32 num_layers,
+                         opj_event_mgr_t * p_manager)) opj_jp2_set_decoded_quality_layers;
+
         l_codec->m_codec_data.m_decompression.opj_set_decoded_components =
             (OPJ_BOOL(*)(void * p_codec,
                          OPJ_UINT32 numcomps,
                          const OPJ_UINT32 * comps_indices,
                          struct opj_event_mgr * p_manager)) opj_jp2_set_decoded_components;
 
+        l_codec->m_codec_data.m_decompression.opj_enable_stats =
+            (OPJ_BOOL(*)(void * p_codec,
+                         OPJ_BOOL enable,
+                         struct opj_event_mgr * p_manager)) opj_jp2_enable_stats;
+
+        l_codec->m_codec_data.m_decompression.opj_get_stats =
+            (const opj_codec_stats_t* (*)(void * p_codec)) opj_jp2_get_stats;
+
+        l_codec->m_codec_data.m_decompression.opj_set_allocator =
+            (OPJ_BOOL(*)(void * p_codec,
+                         const opj_allocator_t* p_allocator,
+                         struct opj_event_mgr * p_manager)) opj_jp2_set_allocator;
+
+        l_codec->m_codec_data.m_decompression.opj_reset_decompress =
+            (OPJ_BOOL(*)(void * p_codec,
+                         struct opj_event_mgr * p_manager)) opj_jp2_reset_decompress;
+
         l_codec->opj_set_threads =
             (OPJ_BOOL(*)(void * p_codec, OPJ_UINT32 num_threads)) opj_jp2_set_threads;
 
+        l_codec->opj_set_thread_pool =
+            (OPJ_BOOL(*)(void * p_codec, opj_thread_pool_t* tp)) opj_jp2_set_thread_pool;
+
         l_codec->m_codec = opj_jp2_create(OPJ_TRUE);
 
         if (! l_codec->m_codec) {
@@ -418,6 +506,17 @@ OPJ_BOOL OPJ_CALLCONV opj_codec_set_threads(opj_codec_t *p_codec,
     return OPJ_FALSE;
 }
 
+OPJ_BOOL OPJ_CALLCONV opj_codec_set_thread_pool(opj_codec_t *p_codec,
+        opj_thread_pool_t* p_thread_pool)
+{
+    if (p_codec) {
+        opj_codec_private_t * l_codec = (opj_codec_private_t *) p_codec;
+
+        return l_codec->opj_set_thread_pool(l_codec->m_codec, p_thread_pool);
+    }
+    return OPJ_FALSE;
+}
+
 OPJ_BOOL OPJ_CALLCONV opj_setup_decoder(opj_codec_t *p_codec,
                                         opj_dparameters_t *parameters
                                        )
@@ -458,6 +557,26 @@ OPJ_BOOL OPJ_CALLCONV opj_decoder_set_strict_mode(opj_codec_t *p_codec,
     return OPJ_FALSE;
 }
 
+OPJ_BOOL OPJ_CALLCONV opj_decoder_set_extra_options(opj_codec_t *p_codec,
+        const char* const* options)
+{
+    if (p_codec) {
+        opj_codec_private_t * l_codec = (opj_codec_private_t *) p_codec;
+
+        if (! l_codec->is_decompressor) {
+            opj_event_msg(&(l_codec->m_event_mgr), EVT_ERROR,
+                          "Codec provided to the opj_decoder_set_extra_options function is not a decompressor handler.\n");
+            return OPJ_FALSE;
+        }
+
+        return l_codec->m_codec_data.m_decompression.opj_decoder_set_extra_options(
+                   l_codec->m_codec,
+                   options,
+                   &(l_codec->m_event_mgr));
+    }
+    return OPJ_FALSE;
+}
+
 OPJ_BOOL OPJ_CALLCONV opj_read_header(opj_stream_t *p_stream,
                                       opj_codec_t *p_codec,
                                       opj_image_t **p_image)
@@ -532,6 +651,168 @@ OPJ_BOOL OPJ_CALLCONV opj_decode(opj_codec_t *p_codec,
     return OPJ_FALSE;
 }
 
+OPJ_BOOL OPJ_CALLCONV opj_decode_strips(opj_codec_t *p_codec,
+                                        opj_stream_t *p_stream,
+                                        opj_image_t* p_image,
+                                        OPJ_UINT32 strip_height,
+                                        opj_decode_strip_fn strip_fn,
+                                        void *user_data)
+{
+    if (p_codec && p_stream && strip_fn) {
+        opj_codec_private_t * l_codec = (opj_codec_private_t *) p_codec;
+        opj_stream_private_t * l_stream = (opj_stream_private_t *) p_stream;
+
+        if (! l_codec->is_decompressor) {
+            return OPJ_FALSE;
+        }
+
+        if (strip_height == 0) {
+            opj_event_msg(&(l_codec->m_event_mgr), EVT_ERROR,
+                          "The strip height must be strictly positive\n");
+            return OPJ_FALSE;
+        }
+
+        return l_codec->m_codec_data.m_decompression.opj_decode_strips(
+                   l_codec->m_codec,
+                   l_stream,
+                   p_image,
+                   strip_height,
+                   strip_fn,
+                   user_data,
+                   &(l_codec->m_event_mgr));
+    }
+
+    return OPJ_FALSE;
+}
+
+/** State of opj_decode_rows() */
+typedef struct opj_rows_decoder {
+    /** event manager of the codec */
+    opj_event_mgr_t *m_event_mgr;
+    /** user function and data */
+    opj_decode_rows_fn m_rows_fn;
+    void *m_user_data;
+    /** current band. Its buffer is reused from a band to the next one */
+    opj_decoded_rows_t m_rows;
+    /** allocated size of m_rows.data */
+    OPJ_SIZE_T m_data_size;
+} opj_rows_decoder_t;
+
+/** Strip function of opj_decode_rows(): converts and forwards the strip */
+static OPJ_BOOL opj_decode_rows_strip(const opj_image_t* p_strip,
+                                      void* p_user_data)
+{
+    opj_rows_decoder_t *l_dec = (opj_rows_decoder_t *) p_user_data;
+    opj_decoded_rows_t *l_rows = &(l_dec->m_rows);
+    const opj_image_comp_t *l_comp0 = &(p_strip->comps[0]);
+    OPJ_SIZE_T l_sample_size = opj_image_sample_size(l_rows->type);
+    OPJ_SIZE_T l_data_size;
+    OPJ_UINT32 compno;
+
+    for (compno = 1; compno < p_strip->numcomps; compno++) {
+        const opj_image_comp_t *l_comp = &(p_strip->comps[compno]);
+        if (l_comp->dx != l_comp0->dx || l_comp->dy != l_comp0->dy ||
+                l_comp->w != l_comp0->w || l_comp->h != l_comp0->h) {
+            opj_event_msg(l_dec->m_event_mgr, EVT_ERROR,
+                          "Row decoding needs components of identical dimensions\n");
+            return OPJ_FALSE;
+        }
+    }
+
+    l_rows->w = l_comp0->w;
+    l_rows->h = l_comp0->h;
+    l_rows->numcomps = p_strip->numcomps;
+    if (l_rows->w > (SIZE_MAX / l_sample_size) / p_strip->numcomps ||
+            (l_rows->w > 0 &&
+             l_rows->h > SIZE_MAX / (l_rows->w * l_sample_size * p_strip->numcomps))) {
+        opj_event_msg(l_dec->m_event_mgr, EVT_ERROR,
+                      "Not enough memory to convert decoded rows\n");
+        return OPJ_FALSE;
+    }
+    l_data_size = (OPJ_SIZE_T)l_rows->w * l_rows->h * l_sample_size *
+                  p_strip->numcomps;
+    if (l_data_size > l_dec->m_data_size) {
+        opj_free(l_rows->data);
+        l_rows->data = opj_malloc(l_data_size);
+        if (l_rows->data == NULL) {
+            l_dec->m_data_size = 0;
+            opj_event_msg(l_dec->m_event_mgr, EVT_ERROR,
+                          "Not enough memory to convert decoded rows\n");
+            return OPJ_FALSE;
+        }
+        l_dec->m_data_size = l_data_size;
+    }
+
+    if (l_rows->interleaved) {
+        l_rows->sample_stride = l_sample_size * p_strip->numcomps;
+        l_rows->row_stride = l_rows->sample_stride * l_rows->w;
+        l_rows->comp_stride = l_sample_size;
+    } else {
+        l_rows->sample_stride = l_sample_size;
+        l_rows->row_stride = l_sample_size * l_rows->w;
+        l_rows->comp_stride = l_rows->row_stride * l_rows->h;
+    }
+    for (compno = 0; compno < p_strip->numcomps; compno++) {
+        opj_image_comp_pack(&(p_strip->comps[compno]), l_rows->type,
+                            (OPJ_BYTE *)l_rows->data + compno * l_rows->comp_stride,
+                            l_rows->sample_stride, l_rows->row_stride);
+    }
+
+    if (!l_dec->m_rows_fn(l_rows, l_dec->m_user_data)) {
+        return OPJ_FALSE;
+    }
+    l_rows->y += l_rows->h;
+    return OPJ_TRUE;
+}
+
+OPJ_BOOL OPJ_CALLCONV opj_decode_rows(opj_codec_t *p_codec,
+                                      opj_stream_t *p_stream,
+                                      opj_image_t* p_image,
+                                      OPJ_UINT32 band_height,
+                                      OPJ_SAMPLE_TYPE type,
+                                      OPJ_BOOL interleaved,
+                                      opj_decode_rows_fn rows_fn,
+                                      void *user_data)
+{
+    if (p_codec && p_stream && p_image && p_image->numcomps > 0 && rows_fn) {
+        opj_codec_private_t * l_codec = (opj_codec_private_t *) p_codec;
+        opj_rows_decoder_t l_dec;
+        OPJ_BOOL l_ret;
+
+        if (! l_codec->is_decompressor) {
+            return OPJ_FALSE;
+        }
+
+        if (opj_image_sample_size(type) == 0) {
+            opj_event_msg(&(l_codec->m_event_mgr), EVT_ERROR,
+                          "Unknown sample type\n");
+            return OPJ_FALSE;
+        }
+        if (band_height == 0 ||
+                band_height > UINT_MAX / p_image->comps[0].dy) {
+            opj_event_msg(&(l_codec->m_event_mgr), EVT_ERROR,
+                          "Invalid band height\n");
+            return OPJ_FALSE;
+        }
+
+        memset(&l_dec, 0, sizeof(l_dec));
+        l_dec.m_event_mgr = &(l_codec->m_event_mgr);
+        l_dec.m_rows_fn = rows_fn;
+        l_dec.m_user_data = user_data;
+        l_dec.m_rows.type = type;
+        l_dec.m_rows.interleaved = interleaved;
+
+        /* Strip heights are expressed in rows of a component with dy = 1 */
+        l_ret = opj_decode_strips(p_codec, p_stream, p_image,
+                                  band_height * p_image->comps[0].dy,
+                                  opj_decode_rows_strip, &l_dec);
+        opj_free(l_dec.m_rows.data);
+        return l_ret;
+    }
+
+    return OPJ_FALSE;
+}
+
 OPJ_BOOL OPJ_CALLCONV opj_set_decode_area(opj_codec_t *p_codec,
         opj_image_t* p_image,
         OPJ_INT32 p_start_x, OPJ_INT32 p_start_y,
@@ -651,6 +932,21 @@ OPJ_BOOL OPJ_CALLCONV opj_set_decoded_resolution_factor(opj_codec_t *p_codec,
                &(l_codec->m_event_mgr));
 }
 
+OPJ_BOOL OPJ_CALLCONV opj_set_decoded_quality_layers(opj_codec_t *p_codec,
+        OPJ_UINT32 num_layers)
+{
+    opj_codec_private_t * l_codec = (opj_codec_private_t *) p_codec;
+
+    if (!l_codec || !l_codec->is_decompressor) {
+        return OPJ_FALSE;
+    }
+
+    return l_codec->m_codec_data.m_decompression.opj_set_decoded_quality_layers(
+               l_codec->m_codec,
+               num_layers,
+               &(l_codec->m_event_mgr));
+}
+
 /* ---------------------------------------------------------------------- */
 /* COMPRESSION FUNCTIONS*/
 
@@ -658,6 +954,9 @@ opj_codec_t* OPJ_CALLCONV opj_create_compress(OPJ_CODEC_FORMAT p_format)
 {
     opj_codec_private_t *l_codec = 00;
 
+    /* Resolve the SIMD kernels now, rather than from worker threads */
+    opj_cpu_init();
+
     l_codec = (opj_codec_private_t*)opj_calloc(1, sizeof(opj_codec_private_t));
     if (!l_codec) {
         return 00;
@@ -703,6 +1002,9 @@ opj_codec_t* OPJ_CALLCONV opj_create_compress(OPJ_CODEC_FORMAT p_format)
         l_codec->opj_set_threads =
             (OPJ_BOOL(*)(void * p_codec, OPJ_UINT32 num_threads)) opj_j2k_set_threads;
 
+        l_codec->opj_set_thread_pool =
+            (OPJ_BOOL(*)(void * p_codec, opj_thread_pool_t* tp)) opj_j2k_set_thread_pool;
+
         l_codec->m_codec = opj_j2k_create_compress();
         if (! l_codec->m_codec) {
             opj_free(l_codec);
@@ -749,6 +1051,9 @@ opj_codec_t* OPJ_CALLCONV opj_create_compress(OPJ_CODEC_FORMAT p_format)
         l_codec->opj_set_threads =
             (OPJ_BOOL(*)(void * p_codec, OPJ_UINT32 num_threads)) opj_jp2_set_threads;
 
+        l_codec->opj_set_thread_pool =
+            (OPJ_BOOL(*)(void * p_codec, opj_thread_pool_t* tp)) opj_jp2_set_thread_pool;
+
         l_codec->m_codec = opj_jp2_create(OPJ_FALSE);
         if (! l_codec->m_codec) {
             opj_free(l_codec);
@@ -941,6 +1246,25 @@ OPJ_BOOL OPJ_CALLCONV opj_end_decompress(opj_codec_t *p_codec,
     return OPJ_FALSE;
 }
 
+OPJ_BOOL OPJ_CALLCONV opj_reset_decompress(opj_codec_t *p_codec)
+{
+    if (p_codec) {
+        opj_codec_private_t * l_codec = (opj_codec_private_t *) p_codec;
+
+        if (! l_codec->is_decompressor) {
+            opj_event_msg(&(l_codec->m_event_mgr), EVT_ERROR,
+                          "Codec provided to the opj_reset_decompress function is not a decompressor handler.\n");
+            return OPJ_FALSE;
+        }
+
+        return l_codec->m_codec_data.m_decompression.opj_reset_decompress(
+                   l_codec->m_codec,
+                   &(l_codec->m_event_mgr));
+    }
+
+    return OPJ_FALSE;
+}
+
 OPJ_BOOL OPJ_CALLCONV opj_set_MCT(opj_cparameters_t *parameters,
                                   OPJ_FLOAT32 * pEncodingMatrix,
                                   OPJ_INT32 * p_dc_shift, OPJ_UINT32 pNbComp)
@@ -1079,6 +1403,64 @@ void OPJ_CALLCONV opj_destroy_cstr_index(opj_codestream_index_t **p_cstr_index)
     }
 }
 
+OPJ_BOOL OPJ_CALLCONV opj_codec_enable_stats(opj_codec_t *p_codec,
+        OPJ_BOOL enable)
+{
+    if (p_codec) {
+        opj_codec_private_t * l_codec = (opj_codec_private_t *) p_codec;
+
+        if (! l_codec->is_decompressor) {
+            opj_event_msg(&(l_codec->m_event_mgr), EVT_ERROR,
+                          "Codec provided to the opj_codec_enable_stats function is not a decompressor handler.\n");
+            return OPJ_FALSE;
+        }
+
+        return l_codec->m_codec_data.m_decompression.opj_enable_stats(
+                   l_codec->m_codec, enable, &(l_codec->m_event_mgr));
+    }
+    return OPJ_FALSE;
+}
+
+const opj_codec_stats_t* OPJ_CALLCONV opj_codec_get_stats(
+    opj_codec_t *p_codec)
+{
+    if (p_codec) {
+        opj_codec_private_t * l_codec = (opj_codec_private_t *) p_codec;
+
+        if (! l_codec->is_decompressor) {
+            return NULL;
+        }
+
+        return l_codec->m_codec_data.m_decompression.opj_get_stats(
+                   l_codec->m_codec);
+    }
+    return NULL;
+}
+
+OPJ_BOOL OPJ_CALLCONV opj_codec_set_allocator(opj_codec_t *p_codec,
+        const opj_allocator_t* p_allocator)
+{
+    if (p_codec) {
+        opj_codec_private_t * l_codec = (opj_codec_private_t *) p_codec;
+
+        if (! l_codec->is_decompressor) {
+            opj_event_msg(&(l_codec->m_event_mgr), EVT_ERROR,
+                          "Codec provided to the opj_codec_set_allocator function is not a decompressor handler.\n");
+            return OPJ_FALSE;
+        }
+        if (p_allocator != NULL &&
+                (p_allocator->alloc_fn == NULL || p_allocator->free_fn == NULL)) {
+            opj_event_msg(&(l_codec->m_event_mgr), EVT_ERROR,
+                          "Both the allocation and deallocation functions must be set.\n");
+            return OPJ_FALSE;
+        }
+
+        return l_codec->m_codec_data.m_decompression.opj_set_allocator(
+                   l_codec->m_codec, p_allocator, &(l_codec->m_event_mgr));
+    }
+    return OPJ_FALSE;
+}
+
 opj_stream_t* OPJ_CALLCONV opj_stream_create_default_file_stream(
     const char *fname, OPJ_BOOL p_is_read_stream)
 {
@@ -1129,6 +1511,517 @@ opj_stream_t* OPJ_CALLCONV opj_stream_create_file_stream(
     return l_stream;
 }
 
+/** File mapped in memory by opj_stream_create_mapped_file_stream() */
+typedef struct opj_mapped_file {
+    void *m_data;
+    OPJ_SIZE_T m_size;
+} opj_mapped_file_t;
+
+static void opj_unmap_file(void* p_user_data)
+{
+    opj_mapped_file_t* l_file = (opj_mapped_file_t*)p_user_data;
+#if defined(_WIN32)
+    UnmapViewOfFile(l_file->m_data);
+#elif defined(OPJ_HAVE_MMAP)
+    munmap(l_file->m_data, l_file->m_size);
+#endif
+    opj_free(l_file);
+}
+
+/** Maps a whole file in memory. Returns NULL if this is not possible. */
+static opj_mapped_file_t* opj_map_file(const char *fname)
+{
+    opj_mapped_file_t* l_file;
+    OPJ_UINT64 l_size;
+
+    l_file = (opj_mapped_file_t*)opj_calloc(1, sizeof(opj_mapped_file_t));
+    if (l_file == NULL) {
+        return NULL;
+    }
+
+#if defined(_WIN32)
+    {
+        HANDLE l_handle, l_mapping;
+        LARGE_INTEGER l_file_size;
+
+        l_handle = CreateFileA(fname, GENERIC_READ, FILE_SHARE_READ, NULL,
+                               OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (l_handle != INVALID_HANDLE_VALUE) {
+            if (GetFileSizeEx(l_handle, &l_file_size) && l_file_size.QuadPart > 0) {
+                l_size = (OPJ_UINT64)l_file_size.QuadPart;
+                l_mapping = ((OPJ_UINT64)(OPJ_SIZE_T)l_size == l_size) ?
+                            CreateFileMappingA(l_handle, NULL, PAGE_READONLY, 0, 0, NULL) : NULL;
+                if (l_mapping != NULL) {
+                    /* The view keeps a reference on the mapping */
+                    l_file->m_data = MapViewOfFile(l_mapping, FILE_MAP_READ, 0, 0, 0);
+                    l_file->m_size = (OPJ_SIZE_T)l_size;
+                    CloseHandle(l_mapping);
+                }
+            }
+            CloseHandle(l_handle);
+        }
+    }
+#elif defined(OPJ_HAVE_MMAP)
+    {
+        struct stat l_stat;
+        int l_fd = open(fname, O_RDONLY);
+
+        if (l_fd >= 0) {
+            if (fstat(l_fd, &l_stat) == 0 && l_stat.st_size > 0) {
+                l_size = (OPJ_UINT64)l_stat.st_size;
+                if ((OPJ_UINT64)(OPJ_SIZE_T)l_size == l_size) {
+                    l_file->m_data = mmap(NULL, (OPJ_SIZE_T)l_size, PROT_READ, MAP_PRIVATE,
+                                          l_fd, 0);
+                    l_file->m_size = (OPJ_SIZE_T)l_size;
+                    if (l_file->m_data == MAP_FAILED) {
+                        l_file->m_data = NULL;
+                    }
+                }
+            }
+            close(l_fd);
+        }
+    }
+#else
+    OPJ_ARG_NOT_USED(fname);
+    OPJ_ARG_NOT_USED(l_size);
+#endif
+
+    if (l_file->m_data == NULL) {
+        opj_free(l_file);
+        return NULL;
+    }
+    return l_file;
+}
+
+opj_stream_t* OPJ_CALLCONV opj_stream_create_mapped_file_stream(
+    const char *fname)
+{
+    opj_mapped_file_t* l_file;
+    opj_stream_t* l_stream;
+
+    if (! fname) {
+        return NULL;
+    }
+
+    l_file = opj_map_file(fname);
+    if (l_file == NULL) {
+        return opj_stream_create_default_file_stream(fname, OPJ_TRUE);
+    }
+
+    l_stream = opj_stream_create_memory_stream(l_file->m_data, l_file->m_size);
+    if (! l_stream) {
+        opj_unmap_file(l_file);
+        return NULL;
+    }
+    opj_stream_set_user_data(l_stream, l_file, opj_unmap_file);
+
+    return l_stream;
+}
+
+/* ---------------------------------------------------------------------- */
+/* Prefetching file stream */
+
+/** Maximum size of the blocks read ahead by a prefetching file stream */
+#define OPJ_PREFETCH_BLOCK_SIZE     OPJ_J2K_STREAM_CHUNK_SIZE
+/** Default size of the read-ahead window of a prefetching file stream */
+#define OPJ_PREFETCH_DEFAULT_WINDOW (8 * OPJ_PREFETCH_BLOCK_SIZE)
+
+/** State of a block of a prefetching file stream */
+typedef enum {
+    OPJ_PREFETCH_QUEUED,    /**< waiting to be read by the prefetch thread */
+    OPJ_PREFETCH_LOADING,   /**< being read by the prefetch thread */
+    OPJ_PREFETCH_READY      /**< read, waiting to be consumed */
+} OPJ_PREFETCH_STATE;
+
+/** Block of a file read ahead of time */
+typedef struct opj_prefetch_block {
+    /** offset of the block in the file */
+    OPJ_OFF_T m_start;
+    /** number of bytes to read */
+    OPJ_SIZE_T m_size;
+    /** number of bytes actually read, less than m_size at the end of the file */
+    OPJ_SIZE_T m_len;
+    /** data of the block, once READY */
+    OPJ_BYTE *m_data;
+    OPJ_PREFETCH_STATE m_state;
+} opj_prefetch_block_t;
+
+/** User data of a stream created with opj_stream_create_prefetch_file_stream() */
+typedef struct opj_prefetch_file {
+    /** file handle of the decoder, for data that is not prefetched */
+    FILE *m_file;
+    /** file handle of the prefetch thread */
+    FILE *m_prefetch_file;
+    /** length of the file */
+    OPJ_UINT64 m_length;
+    /** current position of the decoder */
+    OPJ_OFF_T m_pos;
+    /** maximum number of bytes being read or waiting to be consumed */
+    OPJ_SIZE_T m_window;
+    /** number of bytes being read or waiting to be consumed */
+    OPJ_SIZE_T m_loaded_size;
+    /** whether the decoder gave the ranges it will read. Otherwise, the */
+    /** data following the current position is read ahead. */
+    OPJ_BOOL m_planned;
+    /** end of the data queued by sequential read-ahead */
+    OPJ_OFF_T m_readahead_end;
+    /** blocks, by increasing offset */
+    opj_prefetch_block_t *m_blocks;
+    OPJ_UINT32 m_nb_blocks;
+    OPJ_UINT32 m_nb_blocks_max;
+    /** Mutex protecting the members above, except the file handles. */
+    opj_mutex_t *m_mutex;
+    /** Signaled when a block is ready, or when the prefetch thread has */
+    /** something to do. There is at most one waiting thread: the decoder */
+    /** only waits for a block being loaded by the prefetch thread. */
+    opj_cond_t *m_cond;
+    opj_thread_t *m_thread;
+    OPJ_BOOL m_stop;
+} opj_prefetch_file_t;
+
+/** Removes a block which is not being loaded. Called with the mutex held */
+static void opj_prefetch_remove_block(opj_prefetch_file_t *p_file,
+                                      OPJ_UINT32 p_index)
+{
+    opj_prefetch_block_t *l_block = &(p_file->m_blocks[p_index]);
+
+    assert(l_block->m_state != OPJ_PREFETCH_LOADING);
+    if (l_block->m_state == OPJ_PREFETCH_READY) {
+        opj_free(l_block->m_data);
+        p_file->m_loaded_size -= l_block->m_size;
+    }
+    memmove(l_block, l_block + 1,
+            (p_file->m_nb_blocks - p_index - 1) * sizeof(opj_prefetch_block_t));
+    p_file->m_nb_blocks --;
+    /* The prefetch thread may be waiting for room in the window */
+    opj_cond_signal(p_file->m_cond);
+}
+
+/** Removes the blocks which are not being loaded and end before the current */
+/** position, or all of them if p_all is set. Called with the mutex held. */
+static void opj_prefetch_remove_blocks(opj_prefetch_file_t *p_file,
+                                       OPJ_BOOL p_all)
+{
+    OPJ_UINT32 i = 0;
+
+    while (i < p_file->m_nb_blocks) {
+        const opj_prefetch_block_t *l_block = &(p_file->m_blocks[i]);
+        if (l_block->m_state != OPJ_PREFETCH_LOADING &&
+                (p_all ||
+                 l_block->m_start + (OPJ_OFF_T)l_block->m_size <= p_file->m_pos)) {
+            opj_prefetch_remove_block(p_file, i);
+        } else {
+            i ++;
+        }
+    }
+}
+
+/** Queues the blocks of a range. Called with the mutex held. */
+static OPJ_BOOL opj_prefetch_queue_range(opj_prefetch_file_t *p_file,
+        OPJ_OFF_T p_start, OPJ_OFF_T p_end)
+{
+    if (p_end > (OPJ_OFF_T)p_file->m_length) {
+        p_end = (OPJ_OFF_T)p_file->m_length;
+    }
+    while (p_start < p_end) {
+        opj_prefetch_block_t *l_block;
+        OPJ_OFF_T l_size = p_end - p_start;
+
+        if (l_size > OPJ_PREFETCH_BLOCK_SIZE) {
+            l_size = OPJ_PREFETCH_BLOCK_SIZE;
+        }
+        if (p_file->m_nb_blocks == p_file->m_nb_blocks_max) {
+            OPJ_UINT32 l_nb_blocks_max = p_file->m_nb_blocks_max * 2 + 16;
+            opj_prefetch_block_t *l_blocks = (opj_prefetch_block_t *)
+                                             opj_realloc(p_file->m_blocks,
+                                                     l_nb_blocks_max * sizeof(opj_prefetch_block_t));
+            if (l_blocks == NULL) {
+                return OPJ_FALSE;
+            }
+            p_file->m_blocks = l_blocks;
+            p_file->m_nb_blocks_max = l_nb_blocks_max;
+        }
+        l_block = &(p_file->m_blocks[p_file->m_nb_blocks ++]);
+        l_block->m_start = p_start;
+        l_block->m_size = (OPJ_SIZE_T)l_size;
+        l_block->m_len = 0;
+        l_block->m_data = NULL;
+        l_block->m_state = OPJ_PREFETCH_QUEUED;
+        p_start += l_size;
+    }
+    opj_cond_signal(p_file->m_cond);
+    return OPJ_TRUE;
+}
+
+/** Body of the prefetch thread */
+static void opj_prefetch_thread(void *p_user_data)
+{
+    opj_prefetch_file_t *l_file = (opj_prefetch_file_t *)p_user_data;
+
+    opj_mutex_lock(l_file->m_mutex);
+    for (;;) {
+        opj_prefetch_block_t *l_block = NULL;
+        OPJ_OFF_T l_start;
+        OPJ_SIZE_T l_size, l_len = 0;
+        OPJ_BYTE *l_data;
+        OPJ_UINT32 i;
+
+        if (l_file->m_stop) {
+            break;
+        }
+        for (i = 0; i < l_file->m_nb_blocks; i++) {
+            if (l_file->m_blocks[i].m_state == OPJ_PREFETCH_QUEUED) {
+                l_block = &(l_file->m_blocks[i]);
+                break;
+            }
+        }
+        /* Always allow one block, whatever its size */
+        if (l_block == NULL || (l_file->m_loaded_size > 0 &&
+                                l_file->m_loaded_size + l_block->m_size > l_file->m_window)) {
+            opj_cond_wait(l_file->m_cond, l_file->m_mutex);
+            continue;
+        }
+
+        l_block->m_state = OPJ_PREFETCH_LOADING;
+        l_file->m_loaded_size += l_block->m_size;
+        l_start = l_block->m_start;
+        l_size = l_block->m_size;
+        opj_mutex_unlock(l_file->m_mutex);
+
+        l_data = (OPJ_BYTE *)opj_malloc(l_size);
+        if (l_data != NULL &&
+                OPJ_FSEEK(l_file->m_prefetch_file, l_start, SEEK_SET) == 0) {
+            l_len = fread(l_data, 1, l_size, l_file->m_prefetch_file);
+        }
+
+        opj_mutex_lock(l_file->m_mutex);
+        /* Loading blocks are never removed, but may have moved */
+        for (i = 0; i < l_file->m_nb_blocks; i++) {
+            l_block = &(l_file->m_blocks[i]);
+            if (l_block->m_state == OPJ_PREFETCH_LOADING &&
+                    l_block->m_start == l_start) {
+                break;
+            }
+        }
+        assert(i < l_file->m_nb_blocks);
+        l_block->m_data = l_data;
+        l_block->m_len = l_data ? l_len : 0;
+        l_block->m_state = OPJ_PREFETCH_READY;
+        opj_cond_signal(l_file->m_cond);
+    }
+    opj_mutex_unlock(l_file->m_mutex);
+}
+
+static OPJ_SIZE_T opj_prefetch_read(void * p_buffer, OPJ_SIZE_T p_nb_bytes,
+                                    void * p_user_data)
+{
+    opj_prefetch_file_t *l_file = (opj_prefetch_file_t *)p_user_data;
+    OPJ_BYTE *l_buffer = (OPJ_BYTE *)p_buffer;
+    OPJ_SIZE_T l_nb_read = 0;
+
+    opj_mutex_lock(l_file->m_mutex);
+    /* Blocks before the current position will not be read anymore */
+    opj_prefetch_remove_blocks(l_file, OPJ_FALSE);
+
+    while (l_nb_read < p_nb_bytes) {
+        opj_prefetch_block_t *l_block = NULL;
+        OPJ_SIZE_T l_offset, l_count;
+        OPJ_UINT32 i;
+
+        for (i = 0; i < l_file->m_nb_blocks; i++) {
+            if (l_file->m_blocks[i].m_start <= l_file->m_pos &&
+                    l_file->m_pos < l_file->m_blocks[i].m_start +
+                    (OPJ_OFF_T)l_file->m_blocks[i].m_size) {
+                l_block = &(l_file->m_blocks[i]);
+                break;
+            }
+        }
+        if (l_block == NULL || l_block->m_state == OPJ_PREFETCH_QUEUED) {
+            /* Not worth waiting: read it directly */
+            break;
+        }
+        if (l_block->m_state == OPJ_PREFETCH_LOADING) {
+            opj_cond_wait(l_file->m_cond, l_file->m_mutex);
+            continue;
+        }
+
+        l_offset = (OPJ_SIZE_T)(l_file->m_pos - l_block->m_start);
+        if (l_offset >= l_block->m_len) {
+            /* Short read of the prefetch thread */
+            break;
+        }
+        l_count = l_block->m_len - l_offset;
+        if (l_count > p_nb_bytes - l_nb_read) {
+            l_count = p_nb_bytes - l_nb_read;
+        }
+        memcpy(l_buffer + l_nb_read, l_block->m_data + l_offset, l_count);
+        l_nb_read += l_count;
+        l_file->m_pos += (OPJ_OFF_T)l_count;
+        if (l_offset + l_count == l_block->m_size) {
+            opj_prefetch_remove_block(l_file, i);
+        }
+    }
+    opj_mutex_unlock(l_file->m_mutex);
+
+    if (l_nb_read < p_nb_bytes &&
+            OPJ_FSEEK(l_file->m_file, l_file->m_pos, SEEK_SET) == 0) {
+        OPJ_SIZE_T l_direct = fread(l_buffer + l_nb_read, 1, p_nb_bytes - l_nb_read,
+                                    l_file->m_file);
+        l_nb_read += l_direct;
+        l_file->m_pos += (OPJ_OFF_T)l_direct;
+    }
+
+    opj_mutex_lock(l_file->m_mutex);
+    if (!l_file->m_planned) {
+        /* Read ahead the data following the current position */
+        OPJ_OFF_T l_start = l_file->m_readahead_end > l_file->m_pos ?
+                            l_file->m_readahead_end : l_file->m_pos;
+        OPJ_OFF_T l_end = l_file->m_pos + (OPJ_OFF_T)l_file->m_window;
+        if (l_start < l_end && opj_prefetch_queue_range(l_file, l_start, l_end)) {
+            l_file->m_readahead_end = l_end;
+        }
+    }
+    opj_mutex_unlock(l_file->m_mutex);
+
+    return l_nb_read ? l_nb_read : (OPJ_SIZE_T) - 1;
+}
+
+static OPJ_OFF_T opj_prefetch_skip(OPJ_OFF_T p_nb_bytes, void * p_user_data)
+{
+    opj_prefetch_file_t *l_file = (opj_prefetch_file_t *)p_user_data;
+    opj_mutex_lock(l_file->m_mutex);
+    l_file->m_pos += p_nb_bytes;
+    opj_mutex_unlock(l_file->m_mutex);
+    return p_nb_bytes;
+}
+
+static OPJ_BOOL opj_prefetch_seek(OPJ_OFF_T p_nb_bytes, void * p_user_data)
+{
+    opj_prefetch_file_t *l_file = (opj_prefetch_file_t *)p_user_data;
+    opj_mutex_lock(l_file->m_mutex);
+    if (!l_file->m_planned && (p_nb_bytes < l_file->m_pos ||
+                               p_nb_bytes > l_file->m_readahead_end)) {
+        /* Restart the sequential read-ahead from the new position */
+        opj_prefetch_remove_blocks(l_file, OPJ_TRUE);
+        l_file->m_readahead_end = p_nb_bytes;
+    }
+    l_file->m_pos = p_nb_bytes;
+    opj_mutex_unlock(l_file->m_mutex);
+    return OPJ_TRUE;
+}
+
+static void opj_prefetch_ranges(const OPJ_OFF_T * p_ranges,
+                                OPJ_UINT32 p_nb_ranges, void * p_user_data)
+{
+    opj_prefetch_file_t *l_file = (opj_prefetch_file_t *)p_user_data;
+    OPJ_UINT32 i;
+
+    opj_mutex_lock(l_file->m_mutex);
+    /* Forget the sequential read-ahead, and read the ranges instead */
+    l_file->m_planned = OPJ_TRUE;
+    opj_prefetch_remove_blocks(l_file, OPJ_TRUE);
+    for (i = 0; i < p_nb_ranges; i++) {
+        OPJ_OFF_T l_start = p_ranges[2 * i];
+        OPJ_OFF_T l_end = p_ranges[2 * i + 1];
+        /* Ranges may overlap a block still being loaded */
+        if (l_file->m_nb_blocks > 0) {
+            const opj_prefetch_block_t *l_last =
+                &(l_file->m_blocks[l_file->m_nb_blocks - 1]);
+            OPJ_OFF_T l_last_end = l_last->m_start + (OPJ_OFF_T)l_last->m_size;
+            if (l_start < l_last_end) {
+                l_start = l_last_end;
+            }
+        }
+        if (l_start >= 0 && l_start < l_end &&
+                !opj_prefetch_queue_range(l_file, l_start, l_end)) {
+            break;
+        }
+    }
+    opj_mutex_unlock(l_file->m_mutex);
+}
+
+static void opj_prefetch_close(void * p_user_data)
+{
+    opj_prefetch_file_t *l_file = (opj_prefetch_file_t *)p_user_data;
+    OPJ_UINT32 i;
+
+    if (l_file->m_thread) {
+        opj_mutex_lock(l_file->m_mutex);
+        l_file->m_stop = OPJ_TRUE;
+        opj_cond_signal(l_file->m_cond);
+        opj_mutex_unlock(l_file->m_mutex);
+        opj_thread_join(l_file->m_thread);
+    }
+    for (i = 0; i < l_file->m_nb_blocks; i++) {
+        opj_free(l_file->m_blocks[i].m_data);
+    }
+    opj_free(l_file->m_blocks);
+    if (l_file->m_cond) {
+        opj_cond_destroy(l_file->m_cond);
+    }
+    if (l_file->m_mutex) {
+        opj_mutex_destroy(l_file->m_mutex);
+    }
+    if (l_file->m_prefetch_file) {
+        fclose(l_file->m_prefetch_file);
+    }
+    if (l_file->m_file) {
+        fclose(l_file->m_file);
+    }
+    opj_free(l_file);
+}
+
+opj_stream_t* OPJ_CALLCONV opj_stream_create_prefetch_file_stream(
+    const char *fname, OPJ_SIZE_T p_window_size)
+{
+    opj_prefetch_file_t *l_file;
+    opj_stream_t *l_stream;
+
+    if (! fname) {
+        return NULL;
+    }
+    if (! opj_has_thread_support()) {
+        return opj_stream_create_default_file_stream(fname, OPJ_TRUE);
+    }
+
+    l_file = (opj_prefetch_file_t *)opj_calloc(1, sizeof(opj_prefetch_file_t));
+    if (! l_file) {
+        return NULL;
+    }
+    l_file->m_window = p_window_size ? p_window_size : OPJ_PREFETCH_DEFAULT_WINDOW;
+    l_file->m_file = fopen(fname, "rb");
+    l_file->m_prefetch_file = l_file->m_file ? fopen(fname, "rb") : NULL;
+    if (! l_file->m_prefetch_file) {
+        opj_prefetch_close(l_file);
+        return NULL;
+    }
+    l_file->m_length = opj_get_data_length_from_file(l_file->m_file);
+    l_file->m_mutex = opj_mutex_create();
+    l_file->m_cond = opj_cond_create();
+    if (l_file->m_mutex == NULL || l_file->m_cond == NULL) {
+        opj_prefetch_close(l_file);
+        return NULL;
+    }
+    l_file->m_thread = opj_thread_create(opj_prefetch_thread, l_file);
+    if (l_file->m_thread == NULL) {
+        opj_prefetch_close(l_file);
+        return NULL;
+    }
+
+    l_stream = opj_stream_create(OPJ_J2K_STREAM_CHUNK_SIZE, OPJ_TRUE);
+    if (! l_stream) {
+        opj_prefetch_close(l_file);
+        return NULL;
+    }
+    opj_stream_set_user_data(l_stream, l_file, opj_prefetch_close);
+    opj_stream_set_user_data_length(l_stream, l_file->m_length);
+    opj_stream_set_read_function(l_stream, opj_prefetch_read);
+    opj_stream_set_skip_function(l_stream, opj_prefetch_skip);
+    opj_stream_set_seek_function(l_stream, opj_prefetch_seek);
+    ((opj_stream_private_t *)l_stream)->m_prefetch_fn = opj_prefetch_ranges;
+
+    return l_stream;
+}
 
 void* OPJ_CALLCONV opj_image_data_alloc(OPJ_SIZE_T size)
 {
@@ -203,6 +203,7 @@ typedef size_t   OPJ_SIZE_T;
 #define OPJ_PROFILE_0           0x0001 /** Profile 0 as described in 15444-1,Table A.45 */
 #define OPJ_PROFILE_1           0x0002 /** Profile 1 as described in 15444-1,Table A.45 */
 #define OPJ_PROFILE_PART2       0x8000 /** At least 1 extension defined in 15444-2 (Part-2) */
+#define OPJ_PROFILE_PART15      0x4000 /** HT code-blocks defined in 15444-15 (Part-15), capabilities in CAP marker */
 #define OPJ_PROFILE_CINEMA_2K   0x0003 /** 2K cinema profile defined in 15444-1 AMD1 */
 #define OPJ_PROFILE_CINEMA_4K   0x0004 /** 4K cinema profile defined in 15444-1 AMD1 */
 #define OPJ_PROFILE_CINEMA_S2K  0x0005 /** Scalable 2K cinema profile defined in 15444-1 AMD2 */
@@ -232,6 +233,7 @@ typedef size_t   OPJ_SIZE_T;
 #define OPJ_IS_BROADCAST(v)  (((v) >= OPJ_PROFILE_BC_SINGLE)&&((v) <= ((OPJ_PROFILE_BC_MULTI_R) | (0x000b))))
 #define OPJ_IS_IMF(v)        (((v) >= OPJ_PROFILE_IMF_2K)&&((v) <= ((OPJ_PROFILE_IMF_8K_R) | (0x009b))))
 #define OPJ_IS_PART2(v)      ((v) & OPJ_PROFILE_PART2)
+#define OPJ_IS_PART15(v)     ((v) & OPJ_PROFILE_PART15)
 
 #define OPJ_GET_IMF_PROFILE(v)   ((v) & 0xff00)      /** Extract IMF profile without mainlevel/sublevel */
 #define OPJ_GET_IMF_MAINLEVEL(v) ((v) & 0xf)         /** Extract IMF main level */
@@ -436,7 +438,11 @@ typedef struct opj_cparameters {
     int cblockw_init;
     /** initial code block height, default to 64 */
     int cblockh_init;
-    /** mode switch (cblk_style) */
+    /** mode switch (cblk_style). 64 (HT) selects HTJ2K code-blocks (Part-15),
+     * and cannot be combined with other mode switches. HT code-blocks are
+     * truncated to the bit-plane that meets the rate or quality target,
+     * which may only be set for a single layer, and fixed layer allocation
+     * (cp_fixed_alloc) is not supported */
     int mode;
     /** 1 : use the irreversible DWT 9-7, 0 : use lossless compression (default) */
     int irreversible;
@@ -619,6 +625,51 @@ typedef struct opj_dparameters {
  * */
 typedef void * opj_codec_t;
 
+/**
+ * Pool of worker threads, that can be shared by several codecs.
+ * @see opj_create_thread_pool()
+ * @since 2.6.0
+ * */
+typedef struct opj_thread_pool_t opj_thread_pool_t;
+
+/**
+ * Decoder of a sequence of independent images, such as the frames of a
+ * Motion JPEG 2000 or digital cinema stream, that decodes several of them
+ * concurrently.
+ * @see opj_create_sequence_decoder()
+ * @since 2.6.0
+ * */
+typedef struct opj_sequence_decoder opj_sequence_decoder_t;
+
+/**
+ * Callback function prototype for the allocation function of an allocator.
+ * It must return a block of at least p_size bytes suitably aligned for any
+ * type (like malloc()), or NULL in case of failure.
+ * @since 2.6.0
+ */
+typedef void* (* opj_alloc_fn)(OPJ_SIZE_T p_size, void * p_user_data);
+
+/**
+ * Callback function prototype for the deallocation function of an allocator
+ * @since 2.6.0
+ */
+typedef void (* opj_free_fn)(void * p_ptr, void * p_user_data);
+
+/**
+ * Memory allocator, that can be set on a decompressor with
+ * opj_codec_set_allocator().
+ * Its functions may be called concurrently from several threads.
+ * @since 2.6.0
+ */
+typedef struct opj_allocator {
+    /** Allocation function */
+    opj_alloc_fn alloc_fn;
+    /** Deallocation function */
+    opj_free_fn free_fn;
+    /** User data passed to alloc_fn and free_fn */
+    void * user_data;
+} opj_allocator_t;
+
 /*
 ==========================================================
    I/O stream typedef definitions
@@ -731,6 +782,76 @@ typedef struct opj_image {
     OPJ_UINT32 icc_profile_len;
 } opj_image_t;
 
+/**
+ * Function receiving the horizontal strips of an image decoded with
+ * opj_decode_strips().
+ *
+ * The strip is described as an image: y0 and y1 are the bounds of the strip
+ * on the reference grid, and each component has the x0, y0, w and h members
+ * that an image decoded with opj_decode() restricted to that area would
+ * have. The component data buffers (with w samples per row) belong to the
+ * library and are only valid during the call.
+ *
+ * @param p_strip       the decoded strip
+ * @param p_user_data   the user data given to opj_decode_strips()
+ * @return OPJ_FALSE to stop decoding, OPJ_TRUE otherwise.
+ * @since 2.6.0
+ */
+typedef OPJ_BOOL(* opj_decode_strip_fn)(const opj_image_t* p_strip,
+                                        void* p_user_data);
+
+/**
+ * Sample types of the rows delivered by opj_decode_rows()
+ * @since 2.6.0
+ * */
+typedef enum SAMPLE_TYPE {
+    OPJ_SAMPLE_U8 = 0,    /**< 8-bit unsigned integer */
+    OPJ_SAMPLE_U16 = 1,   /**< 16-bit unsigned integer */
+    OPJ_SAMPLE_I16 = 2,   /**< 16-bit signed integer */
+    OPJ_SAMPLE_F32 = 3    /**< 32-bit floating point */
+} OPJ_SAMPLE_TYPE;
+
+/**
+ * Band of decoded rows passed to the function given to opj_decode_rows().
+ *
+ * The sample of component c at column x of row y of the band is at
+ * (OPJ_BYTE*)data + y * row_stride + x * sample_stride + c * comp_stride.
+ * @since 2.6.0
+ * */
+typedef struct opj_decoded_rows {
+    /** index of the first row of the band, from the top of the decoded area */
+    OPJ_UINT32 y;
+    /** number of samples per row */
+    OPJ_UINT32 w;
+    /** number of rows */
+    OPJ_UINT32 h;
+    /** number of components */
+    OPJ_UINT32 numcomps;
+    /** type of the samples */
+    OPJ_SAMPLE_TYPE type;
+    /** whether the components are interleaved (OPJ_TRUE) or planar */
+    OPJ_BOOL interleaved;
+    /** sample buffer. It belongs to the library and is only valid during the call */
+    void *data;
+    /** number of bytes between the start of two consecutive rows */
+    OPJ_SIZE_T row_stride;
+    /** number of bytes between two consecutive samples of a row */
+    OPJ_SIZE_T sample_stride;
+    /** number of bytes between the planes (or samples) of two consecutive components */
+    OPJ_SIZE_T comp_stride;
+} opj_decoded_rows_t;
+
+/**
+ * Function receiving the bands of rows decoded with opj_decode_rows().
+ *
+ * @param p_rows        the decoded rows
+ * @param p_user_data   the user data given to opj_decode_rows()
+ * @return OPJ_FALSE to stop decoding, OPJ_TRUE otherwise.
+ * @since 2.6.0
+ */
+typedef OPJ_BOOL(* opj_decode_rows_fn)(const opj_decoded_rows_t* p_rows,
+                                       void* p_user_data);
+
 
 /**
  * Component parameters structure used by the opj_image_create function
@@ -1064,6 +1185,104 @@ typedef struct opj_codestream_index {
 } opj_codestream_index_t;
 /* -----------------------------------------------------------> */
 
+/*
+==========================================================
+   Decoding statistics
+==========================================================
+*/
+
+/**
+ * Stages of the decoding of a codestream, whose time is reported by
+ * opj_codec_get_stats()
+ * @since 2.6.0
+ * */
+typedef enum DECODE_STAGE {
+    OPJ_STAGE_MARKERS = 0,   /**< parsing of the main and tile-part headers, and reading of the tile-part data */
+    OPJ_STAGE_T2 = 1,        /**< tier-2 decoding of the packets */
+    OPJ_STAGE_T1_MQ = 2,     /**< tier-1 decoding of MQ code-blocks */
+    OPJ_STAGE_T1_HT = 3,     /**< tier-1 decoding of HTJ2K code-blocks */
+    OPJ_STAGE_DWT = 4,       /**< inverse wavelet transform */
+    OPJ_STAGE_MCT = 5,       /**< inverse multi-component transform */
+    OPJ_STAGE_DC_SHIFT = 6,  /**< DC level shift and clamping */
+    OPJ_STAGE_OUTPUT = 7,    /**< copy of the tiles to the output image */
+    OPJ_NUM_DECODE_STAGES = 8
+} OPJ_DECODE_STAGE;
+
+/**
+ * Time spent in a decoding stage, in seconds
+ * @since 2.6.0
+ * */
+typedef struct opj_stage_time {
+    /** elapsed (wall clock) time */
+    OPJ_FLOAT64 wall_time;
+    /** CPU time spent in the stage by the thread that decodes the tile and
+     * by the worker threads running its jobs. 0 if the platform has no CPU
+     * clock per thread */
+    OPJ_FLOAT64 cpu_time;
+} opj_stage_time_t;
+
+/**
+ * Decoding statistics of a tile
+ * @since 2.6.0
+ * */
+typedef struct opj_tile_stats {
+    /** index of the tile */
+    OPJ_UINT32 tile_index;
+    /** whether the tile has been decoded */
+    OPJ_BOOL decoded;
+    /** time spent in each stage, indexed by OPJ_DECODE_STAGE */
+    opj_stage_time_t stages[OPJ_NUM_DECODE_STAGES];
+    /** number of compressed bytes of the tile */
+    OPJ_UINT64 bytes_read;
+    /** number of code-blocks decoded by tier-1 */
+    OPJ_UINT64 codeblocks_decoded;
+    /** number of code-blocks not decoded, because they are outside of the
+     * decoded area or were already decoded for a previous strip or area, or
+     * with the same coding passes for a previous number of quality layers */
+    OPJ_UINT64 codeblocks_skipped;
+    /** number of code-blocks not decoded, because they were taken from the
+     * code-block cache (see CODEBLOCK_CACHE_SIZE in
+     * opj_decoder_set_extra_options()) */
+    OPJ_UINT64 codeblocks_cached;
+    /** number of the code-blocks decoded by tier-1 whose decoding was
+     * resumed after the coding passes decoded for a lower number of quality
+     * layers (see opj_set_decoded_quality_layers()) */
+    OPJ_UINT64 codeblocks_resumed;
+} opj_tile_stats_t;
+
+/**
+ * Decoding statistics of a codec, returned by opj_codec_get_stats()
+ * @since 2.6.0
+ * */
+typedef struct opj_codec_stats {
+    /** time spent in each stage by all tiles, indexed by OPJ_DECODE_STAGE.
+     * The markers stage also includes the main header */
+    opj_stage_time_t stages[OPJ_NUM_DECODE_STAGES];
+    /** number of bytes of the main header and of the tiles */
+    OPJ_UINT64 bytes_read;
+    /** number of code-blocks decoded by tier-1 */
+    OPJ_UINT64 codeblocks_decoded;
+    /** number of code-blocks not decoded */
+    OPJ_UINT64 codeblocks_skipped;
+    /** number of code-blocks taken from the code-block cache */
+    OPJ_UINT64 codeblocks_cached;
+    /** number of the code-blocks decoded whose decoding was resumed */
+    OPJ_UINT64 codeblocks_resumed;
+    /** number of tiles decoded */
+    OPJ_UINT32 tiles_decoded;
+    /** peak number of bytes held by the decoding of this codec since the
+     * statistics were enabled: coding structures of the tiles (allocated
+     * through opj_codec_set_allocator()), sample buffers of the tile
+     * components and decoded coefficients of the code-blocks, including the
+     * code-block cache. The buffers of the worker threads, the compressed
+     * data and the returned image are not counted */
+    OPJ_UINT64 peak_allocated_bytes;
+    /** number of tiles of the image, and size of the tiles array */
+    OPJ_UINT32 nb_tiles;
+    /** statistics of each tile, indexed by tile index */
+    opj_tile_stats_t *tiles;
+} opj_codec_stats_t;
+
 /*
 ==========================================================
    Metadata from the JP2file
@@ -1265,6 +1484,61 @@ OPJ_API opj_stream_t* OPJ_CALLCONV opj_stream_create_file_stream(
     OPJ_SIZE_T p_buffer_size,
     OPJ_BOOL p_is_read_stream);
 
+/**
+ * Create a read stream from a buffer holding a whole JPEG 2000 file or
+ * codestream.
+ *
+ * The data is not copied: the codestream is parsed, and the compressed data
+ * of the tiles is decoded, directly from the buffer, which must therefore be
+ * kept unchanged until the stream is destroyed. The buffer is never written
+ * to, and is not freed by opj_stream_destroy().
+ *
+ * @param p_data    the data to read
+ * @param p_size    number of bytes of p_data
+ * @return a read stream, or NULL in case of error
+ * @since 2.6.0
+ */
+OPJ_API opj_stream_t* OPJ_CALLCONV opj_stream_create_memory_stream(
+    const void *p_data,
+    OPJ_SIZE_T p_size);
+
+/**
+ * Create a read stream from a file mapped in memory.
+ *
+ * The file is read in place as with opj_stream_create_memory_stream(), and
+ * unmapped by opj_stream_destroy(). If the file cannot be mapped, for
+ * instance on platforms without support for memory mapped files, a regular
+ * file stream is returned, as with opj_stream_create_default_file_stream().
+ *
+ * @param fname     the filename of the file to stream
+ * @return a read stream, or NULL in case of error
+ * @since 2.6.0
+ */
+OPJ_API opj_stream_t* OPJ_CALLCONV opj_stream_create_mapped_file_stream(
+    const char *fname);
+
+/**
+ * Create a read stream from a file, read ahead by a background thread.
+ *
+ * When the codestream has a TLM marker, the decoder gives the stream the
+ * tile-parts it is about to decode, and they are read ahead in that order,
+ * skipping the tile-parts outside of the decoded area. Otherwise, the data
+ * following the current position is read ahead. The data read ahead and not
+ * consumed yet never exceeds p_window_size bytes.
+ *
+ * Without thread support, a regular file stream is returned, as with
+ * opj_stream_create_default_file_stream().
+ *
+ * @param fname         the filename of the file to stream
+ * @param p_window_size maximum number of bytes read ahead, or 0 for the
+ *                      default (8 MB)
+ * @return a read stream, or NULL in case of error
+ * @since 2.6.0
+ */
+OPJ_API opj_stream_t* OPJ_CALLCONV opj_stream_create_prefetch_file_stream(
+    const char *fname,
+    OPJ_SIZE_T p_window_size);
+
 /*
 ==========================================================
    event manager functions definitions
@@ -1328,6 +1602,133 @@ OPJ_API void OPJ_CALLCONV opj_destroy_codec(opj_codec_t * p_codec);
 OPJ_API OPJ_BOOL OPJ_CALLCONV opj_end_decompress(opj_codec_t *p_codec,
         opj_stream_t *p_stream);
 
+/**
+ * Prepares a decompressor that has read a codestream to read another one,
+ * starting again with opj_read_header().
+ *
+ * Everything read from the previous codestream is discarded, as well as
+ * what was set for it with opj_set_decoded_components() and
+ * opj_set_decode_area(). What was set with opj_setup_decoder(),
+ * opj_decoder_set_strict_mode(), opj_decoder_set_extra_options(),
+ * opj_codec_set_threads(), opj_codec_set_thread_pool() and
+ * opj_codec_set_allocator() is kept, and so are the worker threads with
+ * their code-block decoders, and the tile decoder with the coding
+ * structures and sample buffers of its tiles. The tile decoder is reused
+ * by the next codestream as long as it has the same number of components,
+ * which is the case of the frames of a sequence that share their main
+ * header. Decoding such a sequence with a single decompressor thus avoids
+ * creating threads and allocating these structures for each frame.
+ *
+ * As the thread pool and the tile decoder are kept, opj_codec_set_threads(),
+ * opj_codec_set_thread_pool() and opj_codec_set_allocator() cannot be called
+ * after this function.
+ * Decoding statistics, when enabled, are restarted.
+ *
+ * @param p_codec       decompressor handle
+ * @return OPJ_TRUE in case of success.
+ * @since 2.6.0
+ */
+OPJ_API OPJ_BOOL OPJ_CALLCONV opj_reset_decompress(opj_codec_t *p_codec);
+
+/**
+ * Creates a decoder of a sequence of codestreams (or JP2 files), decoding
+ * up to p_frames_in_flight of them concurrently.
+ *
+ * Frames are given with opj_sequence_decoder_push() and retrieved, in the
+ * same order, with opj_sequence_decoder_pop(). Each frame in flight is
+ * decoded by a decompressor of its own, driven by a thread of its own,
+ * while the code-blocks and wavelet transforms of all frames are processed
+ * by the worker threads of p_thread_pool. The decompressors are reused
+ * from one frame to the next, as with opj_reset_decompress().
+ *
+ * Without thread support, frames are decoded one after the other by
+ * opj_sequence_decoder_push().
+ *
+ * @param format                codec of the frames (OPJ_CODEC_J2K or
+ *                              OPJ_CODEC_JP2).
+ * @param parameters            decompression parameters, as given to
+ *                              opj_setup_decoder(). They are copied.
+ * @param p_thread_pool         thread pool created with
+ *                              opj_create_thread_pool(), or NULL to decode
+ *                              each frame with its driving thread only.
+ * @param p_frames_in_flight    maximum number of frames pushed and not
+ *                              popped yet. Must be strictly positive.
+ *
+ * @return the sequence decoder, or NULL in case of failure.
+ * @since 2.6.0
+ */
+OPJ_API opj_sequence_decoder_t* OPJ_CALLCONV opj_create_sequence_decoder(
+    OPJ_CODEC_FORMAT format,
+    opj_dparameters_t *parameters,
+    opj_thread_pool_t* p_thread_pool,
+    OPJ_UINT32 p_frames_in_flight);
+
+/**
+ * Sets the function receiving the error messages of a sequence decoder and
+ * of its decompressors. As frames are decoded concurrently, it may be
+ * called from several threads at the same time.
+ *
+ * It must be called before the first frame is pushed.
+ *
+ * @param p_decoder     the sequence decoder
+ * @param p_callback    the callback function which will be used
+ * @param p_user_data   client object where will be returned the message
+ * @return OPJ_TRUE if successful.
+ * @since 2.6.0
+ */
+OPJ_API OPJ_BOOL OPJ_CALLCONV opj_sequence_decoder_set_error_handler(
+    opj_sequence_decoder_t* p_decoder,
+    opj_msg_callback p_callback,
+    void * p_user_data);
+
+/**
+ * Queues a frame for decoding, and returns without waiting for it to be
+ * decoded (except without thread support).
+ *
+ * The frame is read in place, as with opj_stream_create_memory_stream():
+ * p_data must be kept unchanged until the frame is popped.
+ *
+ * opj_sequence_decoder_push(), opj_sequence_decoder_pop() and
+ * opj_destroy_sequence_decoder() must be called from the same thread.
+ *
+ * @param p_decoder     the sequence decoder
+ * @param p_data        the codestream or JP2 file of the frame
+ * @param p_size        number of bytes of p_data
+ * @return OPJ_TRUE if the frame has been queued, OPJ_FALSE if
+ * p_frames_in_flight frames are already pushed and not popped yet.
+ * @since 2.6.0
+ */
+OPJ_API OPJ_BOOL OPJ_CALLCONV opj_sequence_decoder_push(
+    opj_sequence_decoder_t* p_decoder,
+    const void *p_data,
+    OPJ_SIZE_T p_size);
+
+/**
+ * Waits for the oldest frame pushed and not popped yet to be decoded, and
+ * returns it.
+ *
+ * @param p_decoder     the sequence decoder
+ * @param p_image       the decoded image, to be destroyed by the caller with
+ *                      opj_image_destroy(), or NULL if the frame could not
+ *                      be decoded.
+ * @return OPJ_TRUE if the frame has been decoded, OPJ_FALSE if it could not
+ * be, or if there is no frame to pop.
+ * @since 2.6.0
+ */
+OPJ_API OPJ_BOOL OPJ_CALLCONV opj_sequence_decoder_pop(
+    opj_sequence_decoder_t* p_decoder,
+    opj_image_t** p_image);
+
+/**
+ * Destroys a sequence decoder, after waiting for the frames in flight.
+ * The frames not popped yet are discarded.
+ *
+ * @param p_decoder     the sequence decoder to destroy. May be NULL.
+ * @since 2.6.0
+ */
+OPJ_API void OPJ_CALLCONV opj_destroy_sequence_decoder(
+    opj_sequence_decoder_t* p_decoder);
+
 
 /**
  * Set decoding parameters to default values
@@ -1366,6 +1767,66 @@ OPJ_API OPJ_BOOL OPJ_CALLCONV opj_setup_decoder(opj_codec_t *p_codec,
 OPJ_API OPJ_BOOL OPJ_CALLCONV opj_decoder_set_strict_mode(opj_codec_t *p_codec,
         OPJ_BOOL strict);
 
+/**
+ * Specify extra options for the decoder.
+ *
+ * This may be called after opj_setup_decoder() and before opj_decode().
+ *
+ * This is the way to add new options in a fully ABI compatible way, without
+ * extending the opj_dparameters_t structure.
+ *
+ * Currently supported options are:
+ * <ul>
+ * <li>TILES_IN_FLIGHT=value. Defaults to 0. If set to a value greater than 1,
+ *     and the codec has been given several worker threads with
+ *     opj_codec_set_threads(), opj_decode() decodes up to that number of
+ *     tiles concurrently, each tile being processed by a single worker
+ *     thread. The compressed data of tiles is still read sequentially from
+ *     the stream, and the value bounds the number of tiles whose data and
+ *     decoding buffers are held in memory at the same time.
+ *     This mode is only used for images made of several tiles.
+ *     Since 2.6.0</li>
+ * <li>CODEBLOCK_CACHE_SIZE=value. Defaults to 0. When an image made of a
+ *     single tile is decoded several times with opj_set_decode_area() and
+ *     opj_decode(), the code-blocks of the previous area that are also in
+ *     the new one are not decoded again. If this option is set to a value
+ *     greater than 0, the code-blocks that leave the decoded area are kept
+ *     as well, up to that number of megabytes, the least recently used ones
+ *     being released first, so that going back to a previous area or
+ *     resolution factor (see opj_set_decoded_resolution_factor()) only
+ *     decodes the code-blocks that were never decoded. This speeds up the
+ *     panning and zooming of interactive viewers. Code-blocks are only kept
+ *     when decoding an area smaller than the tile, or with the
+ *     PROGRESSIVE_REFINEMENT option, and the cache is emptied by
+ *     opj_reset_decompress().
+ *     Since 2.6.0</li>
+ * <li>PROGRESSIVE_REFINEMENT=YES/NO. Defaults to NO. If set to YES before
+ *     the first call to opj_decode(), an image made of a single tile can be
+ *     decoded again with a lower resolution factor (see
+ *     opj_set_decoded_resolution_factor()), for instance a thumbnail first
+ *     and then the full image. The tile is kept with its decoded
+ *     code-blocks and the wavelet coefficients of the decoded resolutions,
+ *     so that only the code-blocks of the new resolutions are decoded, and
+ *     only the remaining levels of the inverse wavelet transform are run,
+ *     as long as the decoded area and the number of quality layers do not
+ *     change. opj_set_decoded_quality_layers() enables this mode as well,
+ *     in which the tier-1 decoding of the code-blocks is resumed when more
+ *     quality layers are decoded. An image made of several tiles can only
+ *     be decoded once: opj_set_decode_area() and opj_decode() then fail.
+ *     Since 2.6.0</li>
+ * </ul>
+ *
+ * @param p_codec       Decompressor handle
+ * @param p_options     Decompression options. This should be a NULL terminated
+ *                      array of strings. Each string is of the form KEY=VALUE.
+ *
+ * @return OPJ_TRUE in case of success.
+ * @since 2.6.0
+ */
+OPJ_API OPJ_BOOL OPJ_CALLCONV opj_decoder_set_extra_options(
+    opj_codec_t *p_codec,
+    const char* const* p_options);
+
 /**
  * Allocates worker threads for the compressor/decompressor.
  *
@@ -1387,6 +1848,81 @@ OPJ_API OPJ_BOOL OPJ_CALLCONV opj_decoder_set_strict_mode(opj_codec_t *p_codec,
 OPJ_API OPJ_BOOL OPJ_CALLCONV opj_codec_set_threads(opj_codec_t *p_codec,
         int num_threads);
 
+/**
+ * Creates a pool of worker threads that can be shared by several
+ * compressors/decompressors with opj_codec_set_thread_pool().
+ *
+ * Creating a thread pool once and attaching it to short-lived codecs avoids
+ * creating and destroying worker threads for each codec, and prevents
+ * codecs used concurrently from spawning more threads than available CPUs.
+ *
+ * @param num_threads   Number of worker threads. Must be strictly positive.
+ *
+ * @return the thread pool, or NULL in case of failure (for example when the
+ * library is built without thread support)
+ * @since 2.6.0
+ */
+OPJ_API opj_thread_pool_t* OPJ_CALLCONV opj_create_thread_pool(
+    int num_threads);
+
+/**
+ * Destroys a thread pool created with opj_create_thread_pool().
+ *
+ * Codecs the thread pool is attached to keep a reference on it, so the
+ * worker threads are only stopped once those codecs are destroyed too.
+ *
+ * @param p_thread_pool the thread pool to destroy. May be NULL.
+ * @since 2.6.0
+ */
+OPJ_API void OPJ_CALLCONV opj_destroy_thread_pool(opj_thread_pool_t*
+        p_thread_pool);
+
+/**
+ * Makes the compressor/decompressor use the worker threads of a thread pool
+ * created with opj_create_thread_pool(), instead of its own ones.
+ *
+ * Jobs submitted by codecs sharing the same thread pool are interleaved
+ * on the worker threads, and each codec only waits for the completion of
+ * its own jobs. This replaces any previous call to opj_codec_set_threads(),
+ * and the same restrictions apply: it must be called after
+ * opj_setup_decoder() and before opj_read_header() for the decoding side,
+ * or after opj_setup_encoder() and before opj_start_compress() for the
+ * encoding side.
+ *
+ * @param p_codec       decompressor or compressor handler
+ * @param p_thread_pool thread pool, or NULL to stop using a shared thread
+ *                      pool and only use the main thread.
+ *
+ * @return OPJ_TRUE     if the function is successful.
+ * @since 2.6.0
+ */
+OPJ_API OPJ_BOOL OPJ_CALLCONV opj_codec_set_thread_pool(opj_codec_t *p_codec,
+        opj_thread_pool_t* p_thread_pool);
+
+/**
+ * Sets the allocator used by a decompressor for the coding structures of
+ * the tiles (resolutions, precincts, code-blocks, tag trees, segments).
+ *
+ * Those structures are allocated from an arena for each tile being decoded
+ * (one per tile in flight, see opj_decoder_set_extra_options()), that
+ * requests large chunks of memory from the allocator and releases them all
+ * at once. When no allocator is set, the chunks come from the library's
+ * default allocator. The sample buffers, and the image returned to the
+ * user, are always allocated with the default allocator.
+ *
+ * It must be called after opj_setup_decoder() and before opj_read_header().
+ * The allocator must remain usable until opj_destroy_codec() is called.
+ *
+ * @param p_codec       decompressor handler
+ * @param p_allocator   allocator, whose content is copied, or NULL to use
+ *                      the default allocator.
+ *
+ * @return OPJ_TRUE     if the function is successful.
+ * @since 2.6.0
+ */
+OPJ_API OPJ_BOOL OPJ_CALLCONV opj_codec_set_allocator(opj_codec_t *p_codec,
+        const opj_allocator_t* p_allocator);
+
 /**
  * Decodes an image header.
  *
@@ -1472,6 +2008,87 @@ OPJ_API OPJ_BOOL OPJ_CALLCONV opj_decode(opj_codec_t *p_decompressor,
         opj_stream_t *p_stream,
         opj_image_t *p_image);
 
+/**
+ * Decode an image from a JPEG-2000 codestream by horizontal strips, that
+ * are passed to a user function in top to bottom order, so that the image
+ * can be written to its destination without ever being held entirely in
+ * memory.
+ *
+ * The inverse wavelet transform is computed line by line, so that within
+ * a tile only the code-blocks intersecting the current rows and a few
+ * lines per resolution level are kept in memory. When several tiles of a
+ * tile row intersect the decoded area, their compressed data is read
+ * first, and each strip is then decoded across all of them.
+ *
+ * Strips start at the top of the decoded area plus a multiple of
+ * strip_height, and are also split at tile row boundaries, so they may be
+ * shorter than strip_height. The decode area, resolution factor and
+ * components to decode are taken into account as with opj_decode(). The
+ * component buffers of p_image are not allocated. For JP2 files, the strips
+ * contain the components of the codestream: palette and component mapping
+ * boxes are not applied.
+ *
+ * @param p_decompressor    decompressor handle
+ * @param p_stream          Input buffer stream
+ * @param p_image           the image header returned by opj_read_header()
+ * @param strip_height      maximum height of the strips, in rows of the
+ *                          decoded image. Must be strictly positive.
+ * @param strip_fn          function receiving the strips
+ * @param user_data         user data passed to strip_fn
+ * @return                  true if success, otherwise false
+ * @since 2.6.0
+ * */
+OPJ_API OPJ_BOOL OPJ_CALLCONV opj_decode_strips(opj_codec_t *p_decompressor,
+        opj_stream_t *p_stream,
+        opj_image_t *p_image,
+        OPJ_UINT32 strip_height,
+        opj_decode_strip_fn strip_fn,
+        void *user_data);
+
+/**
+ * Decode an image by bands of rows converted to a packed sample type.
+ *
+ * This is built on top of opj_decode_strips(), so the same memory
+ * considerations apply: the tile buffers are released as soon as their rows
+ * have been passed to rows_fn, and the converted samples of a single band
+ * are held at a time. The int32 samples of the whole image are never
+ * allocated.
+ *
+ * All the decoded components must have the same dimensions and
+ * subsampling. Samples are clamped to the range of their component
+ * precision, then converted as follows:
+ * <ul>
+ * <li>OPJ_SAMPLE_U8 and OPJ_SAMPLE_U16: signed samples are offset by
+ * 2^(prec-1) to become unsigned, and samples of a precision larger than 8
+ * or 16 bits are shifted right to fit.</li>
+ * <li>OPJ_SAMPLE_I16: samples of a precision larger than 16 bits (15 bits for
+ * unsigned components) are shifted right to fit.</li>
+ * <li>OPJ_SAMPLE_F32: samples are stored without scaling.</li>
+ * </ul>
+ *
+ * @param p_decompressor    decompressor handle
+ * @param p_stream          Input buffer stream
+ * @param p_image           the image header returned by opj_read_header()
+ * @param band_height       maximum number of rows of a band. Must be strictly
+ *                          positive. Bands are also split at tile row
+ *                          boundaries.
+ * @param type              type of the samples
+ * @param interleaved       OPJ_TRUE to interleave the components of a band,
+ *                          OPJ_FALSE to store them as consecutive planes
+ * @param rows_fn           function receiving the bands
+ * @param user_data         user data passed to rows_fn
+ * @return                  true if success, otherwise false
+ * @since 2.6.0
+ * */
+OPJ_API OPJ_BOOL OPJ_CALLCONV opj_decode_rows(opj_codec_t *p_decompressor,
+        opj_stream_t *p_stream,
+        opj_image_t *p_image,
+        OPJ_UINT32 band_height,
+        OPJ_SAMPLE_TYPE type,
+        OPJ_BOOL interleaved,
+        opj_decode_rows_fn rows_fn,
+        void *user_data);
+
 /**
  * Get the decoded tile from the codec
  *
@@ -1497,6 +2114,39 @@ OPJ_API OPJ_BOOL OPJ_CALLCONV opj_get_decoded_tile(opj_codec_t *p_codec,
 OPJ_API OPJ_BOOL OPJ_CALLCONV opj_set_decoded_resolution_factor(
     opj_codec_t *p_codec, OPJ_UINT32 res_factor);
 
+/**
+ * Set the number of quality layers to decode, which may be changed between
+ * two calls to opj_decode() to refine a single-tiled image progressively.
+ *
+ * Once this function has been called, the data of all the quality layers
+ * of the tiles is read. When decoding a single-tiled image (see
+ * PROGRESSIVE_REFINEMENT in opj_decoder_set_extra_options()), the packets
+ * of all the layers are read by the first decoding, and not read again for
+ * another number of layers as long as the decoded area and resolution
+ * factor do not change. The code-blocks that have no new coding pass in
+ * the added layers are not decoded again. The decoding of the other ones is
+ * resumed from the state saved after their last coding passes, so that
+ * only the new coding passes are decoded, unless the bytes read ahead by
+ * the MQ decoder past their data could have been decoded differently with
+ * the added data (they are then decoded again from their first pass).
+ * This state takes up to twice as much memory as the decoded code-blocks.
+ * The inverse wavelet transform is run again.
+ *
+ * It should be called after opj_read_header() and before the first call
+ * to opj_decode(): the data of the quality layers that were not decoded
+ * may not have been read otherwise. Once an image made of several tiles
+ * has been decoded, it fails, as the tiles are not kept.
+ *
+ * @param   p_codec         the jpeg2000 codec.
+ * @param   num_layers      number of quality layers to decode, or 0 to
+ *                          decode all of them.
+ *
+ * @return                  true if success, otherwise false
+ * @since 2.6.0
+ */
+OPJ_API OPJ_BOOL OPJ_CALLCONV opj_set_decoded_quality_layers(
+    opj_codec_t *p_codec, OPJ_UINT32 num_layers);
+
 /**
  * Writes a tile with the given data.
  *
@@ -1628,6 +2278,17 @@ OPJ_API OPJ_BOOL OPJ_CALLCONV opj_setup_encoder(opj_codec_t *p_codec,
  * <li>GUARD_BITS=value. Number of guard bits in [0,7] range. Default value is 2.
  *     1 may be used sometimes (like in SMPTE DCP Bv2.1 Application Profile for 2K images).
  *     Since 2.5.0</li>
+ * <li>TILES_IN_FLIGHT=value. Defaults to 0. If set to a value greater than 1,
+ *     and the codec has been given several worker threads with
+ *     opj_codec_set_threads(), opj_encode() encodes up to that number of
+ *     tiles concurrently, each tile being processed by a single worker
+ *     thread. Tiles are written to the stream in tile order, so that the
+ *     codestream is identical to the one produced without this option,
+ *     unless TLM markers are written, in which case tiles are written in the
+ *     order in which they are finished. The value bounds the number of tiles
+ *     whose encoding buffers are held in memory at the same time.
+ *     This mode is only used for images made of several tiles, and does not
+ *     apply to opj_write_tile(). Since 2.6.0</li>
  * </ul>
  *
  * @param p_codec       Compressor handle
@@ -1742,6 +2403,40 @@ OPJ_API opj_jp2_metadata_t* OPJ_CALLCONV opj_get_jp2_metadata(
  */
 OPJ_API opj_jp2_index_t* OPJ_CALLCONV opj_get_jp2_index(opj_codec_t *p_codec);
 
+/**
+ * Enables or disables the collection of decoding statistics.
+ *
+ * When enabled, the decompressor measures the time spent in each decoding
+ * stage and counts the bytes and code-blocks it processes, per tile. This
+ * costs a few clock readings per tile and stage, and nothing when disabled,
+ * which is the default, apart from the CPU clock the worker threads read
+ * around each job. Enabling again resets the statistics.
+ *
+ * This may be called at any time on a decompressor, typically before
+ * opj_read_header().
+ *
+ * @param p_codec       Decompressor handle
+ * @param enable        OPJ_TRUE to collect statistics, OPJ_FALSE to stop.
+ *
+ * @return OPJ_TRUE in case of success.
+ * @since 2.6.0
+ */
+OPJ_API OPJ_BOOL OPJ_CALLCONV opj_codec_enable_stats(opj_codec_t *p_codec,
+        OPJ_BOOL enable);
+
+/**
+ * Returns the decoding statistics collected since opj_codec_enable_stats().
+ *
+ * @param p_codec       Decompressor handle
+ *
+ * @return the statistics, that belong to the codec and are valid until the
+ * next call to a function of the codec, or NULL if their collection is not
+ * enabled.
+ * @since 2.6.0
+ */
+OPJ_API const opj_codec_stats_t* OPJ_CALLCONV opj_codec_get_stats(
+    opj_codec_t *p_codec);
+
 
 /*
 ==========================================================
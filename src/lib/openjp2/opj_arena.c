@@ -0,0 +1,260 @@
+/*
+ * The copyright in this software is being made available under the 2-clauses
+ * BSD License, included below. This software may be subject to other third
+ * party and contributor rights, including patent rights, and no such rights
+ * are granted under this license.
+ *
+ * Copyright (c) 2026, OpenJPEG contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS `AS IS'
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "opj_includes.h"
+
+/** Alignment of the blocks. The chunks are expected to be aligned for any */
+/** type by the allocator, and the blocks are aligned relatively to them */
+#define OPJ_ARENA_ALIGNMENT 16U
+
+/** Minimum size of a chunk */
+#define OPJ_ARENA_MIN_CHUNK_SIZE (64U * 1024U)
+
+/** Chunk of memory, followed by the blocks allocated from it */
+typedef struct opj_arena_chunk {
+    /** Chunk that was used before this one */
+    struct opj_arena_chunk* prev;
+    /** Number of bytes available for blocks */
+    size_t size;
+    /** Number of bytes used by blocks */
+    size_t used;
+} opj_arena_chunk_t;
+
+/** Size of the header of a chunk, rounded up to keep the blocks aligned */
+#define OPJ_ARENA_HEADER_SIZE \
+    ((sizeof(opj_arena_chunk_t) + OPJ_ARENA_ALIGNMENT - 1U) & \
+     ~(size_t)(OPJ_ARENA_ALIGNMENT - 1U))
+
+struct opj_arena {
+    /** Allocator of the chunks */
+    opj_allocator_t allocator;
+    /** Counter of the memory held by the chunks, or NULL */
+    opj_mem_counter_t* mem_counter;
+    /** Chunk the blocks are currently allocated from */
+    opj_arena_chunk_t* chunk;
+    /** Total size of the chunks */
+    size_t total_size;
+    /** Last block allocated, that can be grown in place */
+    void* last;
+};
+
+static void* opj_arena_default_alloc(OPJ_SIZE_T p_size, void* p_user_data)
+{
+    (void)p_user_data;
+    return opj_malloc(p_size);
+}
+
+static void opj_arena_default_free(void* p_ptr, void* p_user_data)
+{
+    (void)p_user_data;
+    opj_free(p_ptr);
+}
+
+static INLINE OPJ_BYTE* opj_arena_chunk_data(opj_arena_chunk_t* p_chunk)
+{
+    return (OPJ_BYTE*)p_chunk + OPJ_ARENA_HEADER_SIZE;
+}
+
+/** Rounds a size up to the alignment of the blocks, returns 0 on overflow */
+static INLINE size_t opj_arena_round_size(size_t p_size)
+{
+    if (p_size > SIZE_MAX - (OPJ_ARENA_ALIGNMENT - 1U)) {
+        return 0;
+    }
+    return (p_size + OPJ_ARENA_ALIGNMENT - 1U) &
+           ~(size_t)(OPJ_ARENA_ALIGNMENT - 1U);
+}
+
+/** Allocates a chunk of at least p_min_size bytes, and makes it current. */
+/** Chunks grow geometrically, so that few of them are needed. */
+static opj_arena_chunk_t* opj_arena_add_chunk(opj_arena_t* p_arena,
+        size_t p_min_size)
+{
+    opj_arena_chunk_t* l_chunk = NULL;
+    size_t l_size = OPJ_ARENA_MIN_CHUNK_SIZE;
+
+    if (l_size < p_arena->total_size) {
+        l_size = p_arena->total_size;
+    }
+    if (l_size < p_min_size) {
+        l_size = p_min_size;
+    }
+    if (l_size <= SIZE_MAX - OPJ_ARENA_HEADER_SIZE) {
+        l_chunk = (opj_arena_chunk_t*)p_arena->allocator.alloc_fn(
+                      OPJ_ARENA_HEADER_SIZE + l_size, p_arena->allocator.user_data);
+    }
+    if (l_chunk == NULL && l_size > p_min_size &&
+            p_min_size <= SIZE_MAX - OPJ_ARENA_HEADER_SIZE) {
+        l_size = p_min_size;
+        l_chunk = (opj_arena_chunk_t*)p_arena->allocator.alloc_fn(
+                      OPJ_ARENA_HEADER_SIZE + l_size, p_arena->allocator.user_data);
+    }
+    if (l_chunk == NULL) {
+        return NULL;
+    }
+    opj_mem_counter_add(p_arena->mem_counter, OPJ_ARENA_HEADER_SIZE + l_size);
+    l_chunk->prev = p_arena->chunk;
+    l_chunk->size = l_size;
+    l_chunk->used = 0;
+    p_arena->chunk = l_chunk;
+    p_arena->total_size += l_size;
+    return l_chunk;
+}
+
+static void opj_arena_free_chunks(opj_arena_t* p_arena)
+{
+    opj_arena_chunk_t* l_chunk = p_arena->chunk;
+    while (l_chunk != NULL) {
+        opj_arena_chunk_t* l_prev = l_chunk->prev;
+        opj_mem_counter_remove(p_arena->mem_counter,
+                               OPJ_ARENA_HEADER_SIZE + l_chunk->size);
+        p_arena->allocator.free_fn(l_chunk, p_arena->allocator.user_data);
+        l_chunk = l_prev;
+    }
+    p_arena->chunk = NULL;
+    p_arena->total_size = 0;
+    p_arena->last = NULL;
+}
+
+static void* opj_arena_alloc(opj_arena_t* p_arena, size_t p_size)
+{
+    opj_arena_chunk_t* l_chunk = p_arena->chunk;
+    size_t l_size = opj_arena_round_size(p_size);
+    void* l_ptr;
+
+    if (l_size == 0) {
+        return NULL;
+    }
+    if (l_chunk == NULL || l_chunk->size - l_chunk->used < l_size) {
+        l_chunk = opj_arena_add_chunk(p_arena, l_size);
+        if (l_chunk == NULL) {
+            return NULL;
+        }
+    }
+    l_ptr = opj_arena_chunk_data(l_chunk) + l_chunk->used;
+    l_chunk->used += l_size;
+    p_arena->last = l_ptr;
+    return l_ptr;
+}
+
+opj_arena_t* opj_arena_create(const opj_allocator_t* p_allocator,
+                              opj_mem_counter_t* p_mem_counter)
+{
+    opj_allocator_t l_allocator;
+    opj_arena_t* l_arena;
+
+    if (p_allocator != NULL && p_allocator->alloc_fn != NULL &&
+            p_allocator->free_fn != NULL) {
+        l_allocator = *p_allocator;
+    } else {
+        l_allocator.alloc_fn = opj_arena_default_alloc;
+        l_allocator.free_fn = opj_arena_default_free;
+        l_allocator.user_data = NULL;
+    }
+
+    l_arena = (opj_arena_t*)l_allocator.alloc_fn(sizeof(opj_arena_t),
+              l_allocator.user_data);
+    if (l_arena == NULL) {
+        return NULL;
+    }
+    memset(l_arena, 0, sizeof(opj_arena_t));
+    l_arena->allocator = l_allocator;
+    l_arena->mem_counter = p_mem_counter;
+    opj_mem_counter_add(p_mem_counter, sizeof(opj_arena_t));
+    return l_arena;
+}
+
+void opj_arena_destroy(opj_arena_t* p_arena)
+{
+    if (p_arena == NULL) {
+        return;
+    }
+    opj_arena_free_chunks(p_arena);
+    opj_mem_counter_remove(p_arena->mem_counter, sizeof(opj_arena_t));
+    p_arena->allocator.free_fn(p_arena, p_arena->allocator.user_data);
+}
+
+void* opj_arena_calloc(opj_arena_t* p_arena, size_t p_num_elements,
+                       size_t p_element_size)
+{
+    void* l_ptr;
+
+    if (p_num_elements == 0 || p_element_size == 0 ||
+            p_num_elements > SIZE_MAX / p_element_size) {
+        return NULL;
+    }
+    l_ptr = opj_arena_alloc(p_arena, p_num_elements * p_element_size);
+    if (l_ptr != NULL) {
+        memset(l_ptr, 0, p_num_elements * p_element_size);
+    }
+    return l_ptr;
+}
+
+void* opj_arena_realloc(opj_arena_t* p_arena, void* p_ptr,
+                        size_t p_old_size, size_t p_new_size)
+{
+    void* l_ptr;
+
+    if (p_ptr == NULL) {
+        return opj_arena_alloc(p_arena, p_new_size);
+    }
+    if (p_new_size <= p_old_size) {
+        return p_ptr;
+    }
+    if (p_ptr == p_arena->last) {
+        opj_arena_chunk_t* l_chunk = p_arena->chunk;
+        size_t l_offset = (size_t)((OPJ_BYTE*)p_ptr - opj_arena_chunk_data(l_chunk));
+        size_t l_size = opj_arena_round_size(p_new_size);
+
+        if (l_size != 0 && l_chunk->size - l_offset >= l_size) {
+            l_chunk->used = l_offset + l_size;
+            return p_ptr;
+        }
+    }
+    l_ptr = opj_arena_alloc(p_arena, p_new_size);
+    if (l_ptr != NULL) {
+        memcpy(l_ptr, p_ptr, p_old_size);
+    }
+    return l_ptr;
+}
+
+void opj_arena_reset(opj_arena_t* p_arena)
+{
+    if (p_arena->chunk != NULL && p_arena->chunk->prev != NULL) {
+        /* Merge the chunks into a single one for the next use. If that */
+        /* fails, chunks will be allocated again on demand */
+        size_t l_total_size = p_arena->total_size;
+        opj_arena_free_chunks(p_arena);
+        opj_arena_add_chunk(p_arena, l_total_size);
+    } else if (p_arena->chunk != NULL) {
+        p_arena->chunk->used = 0;
+    }
+    p_arena->last = NULL;
+}
@@ -0,0 +1,110 @@
+/*
+ * The copyright in this software is being made available under the 2-clauses
+ * BSD License, included below. This software may be subject to other third
+ * party and contributor rights, including patent rights, and no such rights
+ * are granted under this license.
+ *
+ * Copyright (c) 2026, OpenJPEG contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS `AS IS'
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef OPJ_ARENA_H
+#define OPJ_ARENA_H
+/**
+@file opj_arena.h
+@brief Arena allocator
+
+An arena hands out memory blocks carved out of large chunks, which are
+requested from an allocator (see opj_allocator_t). Blocks cannot be freed
+individually: they are all released at once by opj_arena_reset(). The
+chunks are kept for the next use of the arena, merged in a single one, so
+that once an arena has reached its working size, allocating from it does
+not involve the allocator anymore.
+
+An arena must not be used concurrently by several threads.
+*/
+
+/** @defgroup ARENA ARENA - Arena allocator */
+/*@{*/
+
+/** Opaque type for arenas */
+typedef struct opj_arena opj_arena_t;
+
+/** @name Exported functions */
+/*@{*/
+/* ----------------------------------------------------------------------- */
+
+/**
+Creates an arena.
+@param p_allocator allocator of the chunks, whose content is copied, or
+NULL to use opj_malloc() and opj_free()
+@param p_mem_counter counter of the memory held by the chunks, or NULL
+@return a new arena, or NULL in case of failure
+*/
+opj_arena_t* opj_arena_create(const opj_allocator_t* p_allocator,
+                              opj_mem_counter_t* p_mem_counter);
+
+/**
+Destroys an arena, and all the blocks allocated from it.
+@param p_arena arena, may be NULL
+*/
+void opj_arena_destroy(opj_arena_t* p_arena);
+
+/**
+Allocates a block initialized to 0 from an arena. The block is aligned
+for any type.
+@param p_arena arena
+@param p_num_elements number of elements
+@param p_element_size size of an element
+@return the block, or NULL in case of failure
+*/
+void* opj_arena_calloc(opj_arena_t* p_arena, size_t p_num_elements,
+                       size_t p_element_size);
+
+/**
+Grows a block allocated from an arena. The block is extended in place if
+it is the last one allocated, and otherwise copied to a new block. The
+added bytes are not initialized.
+@param p_arena arena
+@param p_ptr block, or NULL
+@param p_old_size current size of the block
+@param p_new_size new size of the block
+@return the new block, or NULL in case of failure (in which case p_ptr is
+left unchanged)
+*/
+void* opj_arena_realloc(opj_arena_t* p_arena, void* p_ptr,
+                        size_t p_old_size, size_t p_new_size);
+
+/**
+Releases all the blocks allocated from an arena. Its memory is kept for
+later allocations.
+@param p_arena arena
+*/
+void opj_arena_reset(opj_arena_t* p_arena);
+
+/* ----------------------------------------------------------------------- */
+/*@}*/
+
+/*@}*/
+
+#endif /* OPJ_ARENA_H */
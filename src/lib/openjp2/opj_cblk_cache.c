@@ -0,0 +1,281 @@
+/*
+ * The copyright in this software is being made available under the 2-clauses
+ * BSD License, included below. This software may be subject to other third
+ * party and contributor rights, including patent rights, and no such rights
+ * are granted under this license.
+ *
+ * Copyright (c) 2026, OpenJPEG contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS `AS IS'
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "opj_includes.h"
+
+/** Initial number of buckets of the hash table, a power of 2 */
+#define OPJ_CBLK_CACHE_MIN_BUCKETS 256U
+
+/** Code-block held by the cache */
+typedef struct opj_cblk_cache_entry {
+    opj_cblk_cache_key_t key;
+    /** Decoded coefficients */
+    OPJ_INT32* data;
+    /** Number of coefficients */
+    OPJ_SIZE_T nb_samples;
+    /** Next entry in the same bucket */
+    struct opj_cblk_cache_entry* next_in_bucket;
+    /** Entry put just before this one, or NULL for the oldest one */
+    struct opj_cblk_cache_entry* older;
+    /** Entry put just after this one, or NULL for the newest one */
+    struct opj_cblk_cache_entry* newer;
+} opj_cblk_cache_entry_t;
+
+struct opj_cblk_cache {
+    /** Maximum number of bytes held */
+    OPJ_SIZE_T max_size;
+    /** Number of bytes held, counting the entries */
+    OPJ_SIZE_T size;
+    /** Hash table of the entries */
+    opj_cblk_cache_entry_t** buckets;
+    /** Number of buckets, a power of 2 */
+    OPJ_UINT32 nb_buckets;
+    /** Number of entries */
+    OPJ_UINT32 nb_entries;
+    /** Least recently put entry, evicted first */
+    opj_cblk_cache_entry_t* oldest;
+    /** Most recently put entry */
+    opj_cblk_cache_entry_t* newest;
+    /** Counter of the buffers of the entries, or NULL */
+    opj_mem_counter_t* mem_counter;
+};
+
+static OPJ_UINT32 opj_cblk_cache_hash(const opj_cblk_cache_key_t* p_key)
+{
+    OPJ_UINT32 h = p_key->tileno;
+    h = h * 31U + p_key->compno;
+    h = h * 31U + p_key->resno;
+    h = h * 31U + p_key->bandno;
+    h = h * 31U + p_key->precno;
+    h = h * 31U + p_key->cblkno;
+    h = h * 31U + p_key->numpasses;
+    /* Mix the high bits into the low ones, that select the bucket */
+    h ^= h >> 16;
+    h *= 0x45d9f3bU;
+    h ^= h >> 16;
+    return h;
+}
+
+static OPJ_BOOL opj_cblk_cache_key_equals(const opj_cblk_cache_key_t* a,
+        const opj_cblk_cache_key_t* b)
+{
+    return a->tileno == b->tileno && a->compno == b->compno &&
+           a->resno == b->resno && a->bandno == b->bandno &&
+           a->precno == b->precno && a->cblkno == b->cblkno &&
+           a->numpasses == b->numpasses;
+}
+
+static OPJ_SIZE_T opj_cblk_cache_entry_size(OPJ_SIZE_T p_nb_samples)
+{
+    return sizeof(opj_cblk_cache_entry_t) + p_nb_samples * sizeof(OPJ_INT32);
+}
+
+/** Frees a buffer of decoded coefficients, if any */
+static void opj_cblk_cache_free_data(opj_cblk_cache_t* p_cache,
+                                     OPJ_INT32* p_data,
+                                     OPJ_SIZE_T p_nb_samples)
+{
+    if (p_data != NULL) {
+        opj_mem_counter_remove(p_cache->mem_counter,
+                               p_nb_samples * sizeof(OPJ_INT32));
+        opj_aligned_free(p_data);
+    }
+}
+
+/** Unlinks an entry from the hash table and from the LRU list */
+static void opj_cblk_cache_unlink(opj_cblk_cache_t* p_cache,
+                                  opj_cblk_cache_entry_t* p_entry)
+{
+    opj_cblk_cache_entry_t** l_link = &p_cache->buckets[
+                                         opj_cblk_cache_hash(&p_entry->key) & (p_cache->nb_buckets - 1U)];
+    while (*l_link != p_entry) {
+        l_link = &(*l_link)->next_in_bucket;
+    }
+    *l_link = p_entry->next_in_bucket;
+
+    if (p_entry->older) {
+        p_entry->older->newer = p_entry->newer;
+    } else {
+        p_cache->oldest = p_entry->newer;
+    }
+    if (p_entry->newer) {
+        p_entry->newer->older = p_entry->older;
+    } else {
+        p_cache->newest = p_entry->older;
+    }
+
+    p_cache->nb_entries --;
+    p_cache->size -= opj_cblk_cache_entry_size(p_entry->nb_samples);
+}
+
+/** Unlinks an entry and frees it, with its buffer */
+static void opj_cblk_cache_evict(opj_cblk_cache_t* p_cache,
+                                 opj_cblk_cache_entry_t* p_entry)
+{
+    opj_cblk_cache_unlink(p_cache, p_entry);
+    opj_cblk_cache_free_data(p_cache, p_entry->data, p_entry->nb_samples);
+    opj_free(p_entry);
+}
+
+/** Doubles the number of buckets. The table is left as is on failure. */
+static void opj_cblk_cache_grow(opj_cblk_cache_t* p_cache)
+{
+    OPJ_UINT32 l_nb_buckets = p_cache->nb_buckets * 2U;
+    OPJ_UINT32 i;
+    opj_cblk_cache_entry_t** l_buckets = (opj_cblk_cache_entry_t**) opj_calloc(
+            l_nb_buckets, sizeof(opj_cblk_cache_entry_t*));
+    if (l_buckets == NULL) {
+        return;
+    }
+    for (i = 0; i < p_cache->nb_buckets; ++i) {
+        opj_cblk_cache_entry_t* l_entry = p_cache->buckets[i];
+        while (l_entry != NULL) {
+            opj_cblk_cache_entry_t* l_next = l_entry->next_in_bucket;
+            OPJ_UINT32 l_idx = opj_cblk_cache_hash(&l_entry->key) &
+                               (l_nb_buckets - 1U);
+            l_entry->next_in_bucket = l_buckets[l_idx];
+            l_buckets[l_idx] = l_entry;
+            l_entry = l_next;
+        }
+    }
+    opj_free(p_cache->buckets);
+    p_cache->buckets = l_buckets;
+    p_cache->nb_buckets = l_nb_buckets;
+}
+
+opj_cblk_cache_t* opj_cblk_cache_create(OPJ_SIZE_T p_max_size,
+                                        opj_mem_counter_t* p_mem_counter)
+{
+    opj_cblk_cache_t* l_cache = (opj_cblk_cache_t*) opj_calloc(1,
+                                sizeof(opj_cblk_cache_t));
+    if (l_cache == NULL) {
+        return NULL;
+    }
+    l_cache->buckets = (opj_cblk_cache_entry_t**) opj_calloc(
+                           OPJ_CBLK_CACHE_MIN_BUCKETS, sizeof(opj_cblk_cache_entry_t*));
+    if (l_cache->buckets == NULL) {
+        opj_free(l_cache);
+        return NULL;
+    }
+    l_cache->nb_buckets = OPJ_CBLK_CACHE_MIN_BUCKETS;
+    l_cache->max_size = p_max_size;
+    l_cache->mem_counter = p_mem_counter;
+    return l_cache;
+}
+
+void opj_cblk_cache_destroy(opj_cblk_cache_t* p_cache)
+{
+    if (p_cache == NULL) {
+        return;
+    }
+    opj_cblk_cache_clear(p_cache);
+    opj_free(p_cache->buckets);
+    opj_free(p_cache);
+}
+
+void opj_cblk_cache_clear(opj_cblk_cache_t* p_cache)
+{
+    while (p_cache->oldest != NULL) {
+        opj_cblk_cache_evict(p_cache, p_cache->oldest);
+    }
+}
+
+OPJ_INT32* opj_cblk_cache_take(opj_cblk_cache_t* p_cache,
+                               const opj_cblk_cache_key_t* p_key,
+                               OPJ_SIZE_T p_nb_samples)
+{
+    opj_cblk_cache_entry_t* l_entry = p_cache->buckets[
+                                          opj_cblk_cache_hash(p_key) & (p_cache->nb_buckets - 1U)];
+    OPJ_INT32* l_data;
+
+    while (l_entry != NULL && !opj_cblk_cache_key_equals(&l_entry->key, p_key)) {
+        l_entry = l_entry->next_in_bucket;
+    }
+    if (l_entry == NULL) {
+        return NULL;
+    }
+    if (l_entry->nb_samples != p_nb_samples) {
+        /* Should not happen, as the key identifies the code-block */
+        opj_cblk_cache_evict(p_cache, l_entry);
+        return NULL;
+    }
+    opj_cblk_cache_unlink(p_cache, l_entry);
+    l_data = l_entry->data;
+    opj_free(l_entry);
+    return l_data;
+}
+
+void opj_cblk_cache_put(opj_cblk_cache_t* p_cache,
+                        const opj_cblk_cache_key_t* p_key,
+                        OPJ_INT32* p_data,
+                        OPJ_SIZE_T p_nb_samples)
+{
+    OPJ_SIZE_T l_size = opj_cblk_cache_entry_size(p_nb_samples);
+    opj_cblk_cache_entry_t* l_entry;
+    OPJ_UINT32 l_idx;
+
+    /* Replace a previous version of the code-block */
+    opj_cblk_cache_free_data(p_cache,
+                             opj_cblk_cache_take(p_cache, p_key, p_nb_samples),
+                             p_nb_samples);
+
+    if (l_size > p_cache->max_size) {
+        opj_cblk_cache_free_data(p_cache, p_data, p_nb_samples);
+        return;
+    }
+    while (p_cache->size > p_cache->max_size - l_size) {
+        opj_cblk_cache_evict(p_cache, p_cache->oldest);
+    }
+
+    l_entry = (opj_cblk_cache_entry_t*) opj_malloc(sizeof(opj_cblk_cache_entry_t));
+    if (l_entry == NULL) {
+        opj_cblk_cache_free_data(p_cache, p_data, p_nb_samples);
+        return;
+    }
+    if (p_cache->nb_entries >= p_cache->nb_buckets) {
+        opj_cblk_cache_grow(p_cache);
+    }
+    l_entry->key = *p_key;
+    l_entry->data = p_data;
+    l_entry->nb_samples = p_nb_samples;
+    l_idx = opj_cblk_cache_hash(p_key) & (p_cache->nb_buckets - 1U);
+    l_entry->next_in_bucket = p_cache->buckets[l_idx];
+    p_cache->buckets[l_idx] = l_entry;
+    l_entry->older = p_cache->newest;
+    l_entry->newer = NULL;
+    if (p_cache->newest) {
+        p_cache->newest->newer = l_entry;
+    } else {
+        p_cache->oldest = l_entry;
+    }
+    p_cache->newest = l_entry;
+    p_cache->nb_entries ++;
+    p_cache->size += l_size;
+}
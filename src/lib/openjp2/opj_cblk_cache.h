@@ -0,0 +1,125 @@
+/*
+ * The copyright in this software is being made available under the 2-clauses
+ * BSD License, included below. This software may be subject to other third
+ * party and contributor rights, including patent rights, and no such rights
+ * are granted under this license.
+ *
+ * Copyright (c) 2026, OpenJPEG contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS `AS IS'
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef OPJ_CBLK_CACHE_H
+#define OPJ_CBLK_CACHE_H
+/**
+@file opj_cblk_cache.h
+@brief Cache of decoded code-blocks
+
+The cache keeps the coefficients of code-blocks decoded by tier-1 for a
+partial decoding of a tile (see opj_tcd_cblk_dec_t::decoded_data) once they
+are outside of the decoded area, so that they are not decoded again if a
+later decoding of the tile needs them. The buffers are moved in and out of the cache: a buffer taken
+from the cache belongs to the code-block until it is put back. When the
+total size of the buffers held by the cache exceeds its maximum size, the
+least recently put ones are freed.
+
+A cache must not be used concurrently by several threads.
+*/
+
+/** @defgroup CBLK_CACHE CBLK_CACHE - Cache of decoded code-blocks */
+/*@{*/
+
+/** Identifies the decoded coefficients of a code-block */
+typedef struct opj_cblk_cache_key {
+    OPJ_UINT32 tileno;
+    OPJ_UINT32 compno;
+    OPJ_UINT32 resno;
+    /** Band number (0 for the lowest resolution, 1 to 3 for the others) */
+    OPJ_UINT32 bandno;
+    OPJ_UINT32 precno;
+    OPJ_UINT32 cblkno;
+    /** Number of coding passes that have been decoded */
+    OPJ_UINT32 numpasses;
+} opj_cblk_cache_key_t;
+
+/** Opaque type for code-block caches */
+typedef struct opj_cblk_cache opj_cblk_cache_t;
+
+/** @name Exported functions */
+/*@{*/
+/* ----------------------------------------------------------------------- */
+
+/**
+Creates a code-block cache.
+@param p_max_size maximum number of bytes held by the cache
+@param p_mem_counter counter the buffers freed by the cache are removed
+from, or NULL. Buffers stay counted while they are moved in and out of the
+cache.
+@return a new cache, or NULL in case of failure
+*/
+opj_cblk_cache_t* opj_cblk_cache_create(OPJ_SIZE_T p_max_size,
+                                        opj_mem_counter_t* p_mem_counter);
+
+/**
+Destroys a code-block cache, and the buffers it holds.
+@param p_cache cache, may be NULL
+*/
+void opj_cblk_cache_destroy(opj_cblk_cache_t* p_cache);
+
+/**
+Frees all the buffers held by a code-block cache.
+@param p_cache cache
+*/
+void opj_cblk_cache_clear(opj_cblk_cache_t* p_cache);
+
+/**
+Takes the decoded coefficients of a code-block out of the cache.
+@param p_cache cache
+@param p_key code-block
+@param p_nb_samples number of coefficients of the code-block
+@return a buffer allocated with opj_aligned_malloc(), that the caller
+owns, or NULL if the code-block is not in the cache
+*/
+OPJ_INT32* opj_cblk_cache_take(opj_cblk_cache_t* p_cache,
+                               const opj_cblk_cache_key_t* p_key,
+                               OPJ_SIZE_T p_nb_samples);
+
+/**
+Puts the decoded coefficients of a code-block in the cache, which takes
+ownership of them. The buffer is freed at once if it is larger than the
+cache, or if memory is lacking.
+@param p_cache cache
+@param p_key code-block
+@param p_data buffer allocated with opj_aligned_malloc()
+@param p_nb_samples number of coefficients of the code-block
+*/
+void opj_cblk_cache_put(opj_cblk_cache_t* p_cache,
+                        const opj_cblk_cache_key_t* p_key,
+                        OPJ_INT32* p_data,
+                        OPJ_SIZE_T p_nb_samples);
+
+/* ----------------------------------------------------------------------- */
+/*@}*/
+
+/*@}*/
+
+#endif /* OPJ_CBLK_CACHE_H */
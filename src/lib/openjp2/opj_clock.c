@@ -37,6 +37,7 @@
 #include <sys/time.h>
 #include <sys/resource.h>
 #include <sys/times.h>
+#include <time.h>
 #endif /* _WIN32 */
 
 OPJ_FLOAT64 opj_clock(void)
@@ -65,3 +66,53 @@ OPJ_FLOAT64 opj_clock(void)
 #endif
 }
 
+OPJ_FLOAT64 opj_wallclock(void)
+{
+#ifdef _WIN32
+    return opj_clock();
+#else
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (OPJ_FLOAT64)tv.tv_sec + 1e-6 * (OPJ_FLOAT64)tv.tv_usec;
+#endif
+}
+
+OPJ_FLOAT64 opj_thread_clock(void)
+{
+#ifdef _WIN32
+    FILETIME l_creation, l_exit, l_kernel, l_user;
+    ULARGE_INTEGER l_kernel_time, l_user_time;
+    if (!GetThreadTimes(GetCurrentThread(), &l_creation, &l_exit, &l_kernel,
+                        &l_user)) {
+        return 0;
+    }
+    l_kernel_time.LowPart = l_kernel.dwLowDateTime;
+    l_kernel_time.HighPart = l_kernel.dwHighDateTime;
+    l_user_time.LowPart = l_user.dwLowDateTime;
+    l_user_time.HighPart = l_user.dwHighDateTime;
+    /* In units of 100 nanoseconds */
+    return 1e-7 * ((OPJ_FLOAT64)l_kernel_time.QuadPart +
+                   (OPJ_FLOAT64)l_user_time.QuadPart);
+#elif defined(CLOCK_THREAD_CPUTIME_ID)
+    struct timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0) {
+        return 0;
+    }
+    return (OPJ_FLOAT64)ts.tv_sec + 1e-9 * (OPJ_FLOAT64)ts.tv_nsec;
+#else
+    return 0;
+#endif
+}
+
+void opj_stage_time_start(opj_stage_time_t* p_start)
+{
+    p_start->wall_time = opj_wallclock();
+    p_start->cpu_time = opj_thread_clock();
+}
+
+void opj_stage_time_add_since(opj_stage_time_t* p_time,
+                              const opj_stage_time_t* p_start)
+{
+    p_time->wall_time += opj_wallclock() - p_start->wall_time;
+    p_time->cpu_time += opj_thread_clock() - p_start->cpu_time;
+}
@@ -50,6 +50,36 @@ Difference in successive opj_clock() calls tells you the elapsed time
 */
 OPJ_FLOAT64 opj_clock(void);
 
+/**
+Difference in successive opj_wallclock() calls tells you the elapsed time,
+whatever the activity of the process
+@return Returns time in seconds
+*/
+OPJ_FLOAT64 opj_wallclock(void);
+
+/**
+Difference in successive opj_thread_clock() calls tells you the CPU time
+spent by the calling thread
+@return Returns time in seconds, or 0 if the platform has no CPU clock per
+thread
+*/
+OPJ_FLOAT64 opj_thread_clock(void);
+
+/**
+Reads the clocks at the start of a stage
+@param p_start Receives the wall clock time, and the CPU time of the calling
+thread
+*/
+void opj_stage_time_start(opj_stage_time_t* p_start);
+
+/**
+Adds the time elapsed since opj_stage_time_start() to the time of a stage
+@param p_time  Time of the stage
+@param p_start Clocks read by opj_stage_time_start()
+*/
+void opj_stage_time_add_since(opj_stage_time_t* p_time,
+                              const opj_stage_time_t* p_start);
+
 /* ----------------------------------------------------------------------- */
 /*@}*/
 
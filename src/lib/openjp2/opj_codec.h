@@ -58,6 +58,15 @@ typedef struct opj_codec_private {
                                   opj_image_t * p_image,
                                   struct opj_event_mgr * p_manager);
 
+            /** Strip decoding function */
+            OPJ_BOOL(*opj_decode_strips)(void * p_codec,
+                                         struct opj_stream_private * p_cio,
+                                         opj_image_t * p_image,
+                                         OPJ_UINT32 strip_height,
+                                         opj_decode_strip_fn strip_fn,
+                                         void * user_data,
+                                         struct opj_event_mgr * p_manager);
+
             /** FIXME DOC */
             OPJ_BOOL(*opj_read_tile_header)(void * p_codec,
                                             OPJ_UINT32 * p_tile_index,
@@ -93,6 +102,11 @@ typedef struct opj_codec_private {
             /** Strict mode function handler */
             void (*opj_decoder_set_strict_mode)(void * p_codec, OPJ_BOOL strict);
 
+            /** Extra options function handler */
+            OPJ_BOOL(*opj_decoder_set_extra_options)(void * p_codec,
+                    const char* const* p_options,
+                    struct opj_event_mgr * p_manager);
+
             /** Set decode area function handler */
             OPJ_BOOL(*opj_set_decode_area)(void * p_codec,
                                            opj_image_t * p_image,
@@ -114,11 +128,33 @@ typedef struct opj_codec_private {
                     OPJ_UINT32 res_factor,
                     opj_event_mgr_t * p_manager);
 
+            /** Set the number of decoded quality layers */
+            OPJ_BOOL(*opj_set_decoded_quality_layers)(void * p_codec,
+                    OPJ_UINT32 num_layers,
+                    opj_event_mgr_t * p_manager);
+
             /** Set the decoded components */
             OPJ_BOOL(*opj_set_decoded_components)(void * p_codec,
                                                   OPJ_UINT32 num_comps,
                                                   const OPJ_UINT32* comps_indices,
                                                   opj_event_mgr_t * p_manager);
+
+            /** Enable or disable the decoding statistics */
+            OPJ_BOOL(*opj_enable_stats)(void * p_codec,
+                                        OPJ_BOOL enable,
+                                        opj_event_mgr_t * p_manager);
+
+            /** Get the decoding statistics */
+            const opj_codec_stats_t* (*opj_get_stats)(void * p_codec);
+
+            /** Set the allocator of the coding structures of the tiles */
+            OPJ_BOOL(*opj_set_allocator)(void * p_codec,
+                                         const opj_allocator_t* p_allocator,
+                                         opj_event_mgr_t * p_manager);
+
+            /** Prepare the decoder to read another codestream */
+            OPJ_BOOL(*opj_reset_decompress)(void * p_codec,
+                                            opj_event_mgr_t * p_manager);
         } m_decompression;
 
         /**
@@ -171,6 +207,9 @@ typedef struct opj_codec_private {
 
     /** Set number of threads */
     OPJ_BOOL(*opj_set_threads)(void * p_codec, OPJ_UINT32 num_threads);
+
+    /** Set shared thread pool */
+    OPJ_BOOL(*opj_set_thread_pool)(void * p_codec, opj_thread_pool_t* tp);
 }
 opj_codec_private_t;
 
@@ -0,0 +1,222 @@
+/*
+ * The copyright in this software is being made available under the 2-clauses
+ * BSD License, included below. This software may be subject to other third
+ * party and contributor rights, including patent rights, and no such rights
+ * are granted under this license.
+ *
+ * Copyright (c) 2026, OpenJPEG contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS `AS IS'
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "opj_includes.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#if defined(OPJ_HAVE_AVX2_KERNELS)
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define OPJ_X86_CPUID
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <cpuid.h>
+#define OPJ_X86_CPUID
+#endif
+#endif
+
+/* -1 until opj_cpu_init() has run. Only accessed with the atomic */
+/* operations below, since the kernels of worker threads read it. */
+#if defined(_WIN32)
+static volatile LONG opj_simd_level = -1;
+#else
+static volatile OPJ_INT32 opj_simd_level = -1;
+#endif
+
+static OPJ_INT32 opj_simd_level_load(void)
+{
+#if defined(_WIN32)
+    return (OPJ_INT32)InterlockedCompareExchange(&opj_simd_level, -1, -1);
+#elif defined(__ATOMIC_ACQUIRE)
+    return __atomic_load_n(&opj_simd_level, __ATOMIC_ACQUIRE);
+#elif defined(__GNUC__)
+    return __sync_val_compare_and_swap(&opj_simd_level, -1, -1);
+#else
+    return opj_simd_level;
+#endif
+}
+
+/* Stores level if no level has been stored yet */
+static void opj_simd_level_publish(OPJ_INT32 level)
+{
+#if defined(_WIN32)
+    InterlockedCompareExchange(&opj_simd_level, (LONG)level, -1);
+#elif defined(__ATOMIC_ACQ_REL)
+    OPJ_INT32 expected = -1;
+    __atomic_compare_exchange_n(&opj_simd_level, &expected, level, 0,
+                                __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+#elif defined(__GNUC__)
+    __sync_val_compare_and_swap(&opj_simd_level, -1, level);
+#else
+    opj_simd_level = level;
+#endif
+}
+
+#ifdef OPJ_X86_CPUID
+
+static void opj_cpuid(OPJ_UINT32 leaf, OPJ_UINT32 subleaf, OPJ_UINT32 regs[4])
+{
+#if defined(_MSC_VER)
+    int r[4];
+    __cpuidex(r, (int)leaf, (int)subleaf);
+    regs[0] = (OPJ_UINT32)r[0];
+    regs[1] = (OPJ_UINT32)r[1];
+    regs[2] = (OPJ_UINT32)r[2];
+    regs[3] = (OPJ_UINT32)r[3];
+#else
+    __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+/* Returns the XCR0 register, that tells which register states the */
+/* operating system saves on context switches */
+static OPJ_UINT64 opj_xgetbv0(void)
+{
+#if defined(_MSC_VER)
+    return (OPJ_UINT64)_xgetbv(0);
+#else
+    OPJ_UINT32 eax, edx;
+    /* xgetbv, spelled out for assemblers that do not know it */
+    __asm__ __volatile__(".byte 0x0f, 0x01, 0xd0"
+                         : "=a"(eax), "=d"(edx) : "c"(0));
+    return ((OPJ_UINT64)edx << 32) | eax;
+#endif
+}
+
+static OPJ_SIMD_LEVEL opj_cpu_detect(void)
+{
+    OPJ_UINT32 regs[4];
+    OPJ_UINT64 xcr0;
+
+    opj_cpuid(0, 0, regs);
+    if (regs[0] < 7) {
+        return OPJ_SIMD_BASELINE;
+    }
+
+    /* OSXSAVE (bit 27) and AVX (bit 28) */
+    opj_cpuid(1, 0, regs);
+    if ((regs[2] & (3U << 27)) != (3U << 27)) {
+        return OPJ_SIMD_BASELINE;
+    }
+    /* XMM and YMM states */
+    xcr0 = opj_xgetbv0();
+    if ((xcr0 & 0x6) != 0x6) {
+        return OPJ_SIMD_BASELINE;
+    }
+
+    opj_cpuid(7, 0, regs);
+#ifdef OPJ_HAVE_AVX512_KERNELS
+    /* AVX512F (bit 16), and opmask, ZMM_Hi256 and Hi16_ZMM states */
+    if ((regs[1] & (1U << 16)) && (xcr0 & 0xe6) == 0xe6) {
+        return OPJ_SIMD_AVX512;
+    }
+#endif
+    /* AVX2 (bit 5) */
+    if (regs[1] & (1U << 5)) {
+        return OPJ_SIMD_AVX2;
+    }
+    return OPJ_SIMD_BASELINE;
+}
+
+#else
+
+static OPJ_SIMD_LEVEL opj_cpu_detect(void)
+{
+#if defined(__SSE2__) || defined(__ARM_NEON)
+    return OPJ_SIMD_BASELINE;
+#else
+    return OPJ_SIMD_GENERIC;
+#endif
+}
+
+#endif /* OPJ_X86_CPUID */
+
+const char* opj_cpu_simd_level_name(OPJ_SIMD_LEVEL level)
+{
+    switch (level) {
+    case OPJ_SIMD_BASELINE:
+#ifdef __ARM_NEON
+        return "neon";
+#else
+        return "sse2";
+#endif
+    case OPJ_SIMD_AVX2:
+        return "avx2";
+    case OPJ_SIMD_AVX512:
+        return "avx512";
+    default:
+        return "generic";
+    }
+}
+
+void opj_cpu_init(void)
+{
+    OPJ_SIMD_LEVEL level;
+    const char* env;
+
+    if (opj_simd_level_load() >= 0) {
+        return;
+    }
+
+    level = opj_cpu_detect();
+    env = getenv("OPJ_SIMD_LEVEL");
+    if (env != NULL) {
+        OPJ_SIMD_LEVEL requested = level;
+        if (strcmp(env, "generic") == 0) {
+            requested = OPJ_SIMD_GENERIC;
+        } else if (strcmp(env, "sse2") == 0 || strcmp(env, "neon") == 0) {
+            requested = OPJ_SIMD_BASELINE;
+        } else if (strcmp(env, "avx2") == 0) {
+            requested = OPJ_SIMD_AVX2;
+        } else if (strcmp(env, "avx512") == 0) {
+            requested = OPJ_SIMD_AVX512;
+        }
+        /* Never go above what the build and the host support */
+        if (requested < level) {
+            level = requested;
+        }
+    }
+
+    opj_simd_level_publish((OPJ_INT32)level);
+}
+
+OPJ_SIMD_LEVEL opj_cpu_get_simd_level(void)
+{
+    OPJ_INT32 level = opj_simd_level_load();
+    if (level < 0) {
+        /* Only for internal callers that do not go through a codec */
+        opj_cpu_init();
+        level = opj_simd_level_load();
+    }
+    return (OPJ_SIMD_LEVEL)level;
+}
@@ -0,0 +1,89 @@
+/*
+ * The copyright in this software is being made available under the 2-clauses
+ * BSD License, included below. This software may be subject to other third
+ * party and contributor rights, including patent rights, and no such rights
+ * are granted under this license.
+ *
+ * Copyright (c) 2026, OpenJPEG contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS `AS IS'
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef OPJ_CPU_H
+#define OPJ_CPU_H
+/**
+@file opj_cpu.h
+@brief Runtime detection of the SIMD instruction sets of the host CPU
+
+The SIMD kernels of the DWT and T1 modules are gathered in function tables,
+one per instruction set level. The level used is the best one supported by
+both the build and the host CPU, unless the OPJ_SIMD_LEVEL environment
+variable requests a lower one ("generic", "sse2", "neon", "avx2" or
+"avx512"), for testing and benchmarking purposes.
+*/
+
+/** @defgroup CPU CPU - Runtime CPU feature detection */
+/*@{*/
+
+/** SIMD instruction set levels, in increasing order of capabilities */
+typedef enum {
+    /** Plain C code */
+    OPJ_SIMD_GENERIC = 0,
+    /** Instruction set enabled by the compiler baseline (SSE2 or NEON) */
+    OPJ_SIMD_BASELINE = 1,
+    /** x86 AVX2 */
+    OPJ_SIMD_AVX2 = 2,
+    /** x86 AVX-512 Foundation */
+    OPJ_SIMD_AVX512 = 3
+} OPJ_SIMD_LEVEL;
+
+/** @name Exported functions */
+/*@{*/
+/* ----------------------------------------------------------------------- */
+
+/**
+Resolves the SIMD level to use for the kernels, from the host CPU and the
+OPJ_SIMD_LEVEL environment variable. Called when a codec is created, before
+any job is submitted to worker threads; later calls do nothing.
+*/
+void opj_cpu_init(void);
+
+/**
+Returns the SIMD level resolved by opj_cpu_init(), which is called first if
+needed. The result is the same for all the callers.
+@return the SIMD level
+*/
+OPJ_SIMD_LEVEL opj_cpu_get_simd_level(void);
+
+/**
+Returns the name of a SIMD level, as accepted by OPJ_SIMD_LEVEL.
+@param level SIMD level
+@return the name of the level
+*/
+const char* opj_cpu_simd_level_name(OPJ_SIMD_LEVEL level);
+
+/* ----------------------------------------------------------------------- */
+/*@}*/
+
+/*@}*/
+
+#endif /* OPJ_CPU_H */
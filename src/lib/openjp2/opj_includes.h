@@ -221,7 +221,11 @@ typedef unsigned int OPJ_BITFIELD;
 #define OPJ_UNUSED(x) (void)x
 
 #include "opj_clock.h"
+#include "opj_cpu.h"
 #include "opj_malloc.h"
+#include "opj_mem_counter.h"
+#include "opj_arena.h"
+#include "opj_cblk_cache.h"
 #include "event.h"
 #include "function_list.h"
 #include "bio.h"
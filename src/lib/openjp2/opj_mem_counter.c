@@ -0,0 +1,131 @@
+/*
+ * The copyright in this software is being made available under the 2-clauses
+ * BSD License, included below. This software may be subject to other third
+ * party and contributor rights, including patent rights, and no such rights
+ * are granted under this license.
+ *
+ * Copyright (c) 2026, OpenJPEG contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS `AS IS'
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "opj_includes.h"
+
+struct opj_mem_counter {
+    /** Protects the counts, or NULL without thread support */
+    opj_mutex_t* mutex;
+    /** Number of bytes currently allocated */
+    size_t allocated;
+    /** Peak of allocated */
+    size_t peak;
+};
+
+opj_mem_counter_t* opj_mem_counter_create(void)
+{
+    opj_mem_counter_t* l_counter = (opj_mem_counter_t*) opj_calloc(1,
+                                   sizeof(opj_mem_counter_t));
+    if (l_counter == NULL) {
+        return NULL;
+    }
+    if (opj_has_thread_support()) {
+        l_counter->mutex = opj_mutex_create();
+        if (l_counter->mutex == NULL) {
+            opj_free(l_counter);
+            return NULL;
+        }
+    }
+    return l_counter;
+}
+
+void opj_mem_counter_destroy(opj_mem_counter_t* p_counter)
+{
+    if (p_counter == NULL) {
+        return;
+    }
+    if (p_counter->mutex) {
+        opj_mutex_destroy(p_counter->mutex);
+    }
+    opj_free(p_counter);
+}
+
+void opj_mem_counter_add(opj_mem_counter_t* p_counter, size_t p_size)
+{
+    if (p_counter == NULL) {
+        return;
+    }
+    if (p_counter->mutex) {
+        opj_mutex_lock(p_counter->mutex);
+    }
+    p_counter->allocated += p_size;
+    if (p_counter->peak < p_counter->allocated) {
+        p_counter->peak = p_counter->allocated;
+    }
+    if (p_counter->mutex) {
+        opj_mutex_unlock(p_counter->mutex);
+    }
+}
+
+void opj_mem_counter_remove(opj_mem_counter_t* p_counter, size_t p_size)
+{
+    if (p_counter == NULL) {
+        return;
+    }
+    if (p_counter->mutex) {
+        opj_mutex_lock(p_counter->mutex);
+    }
+    assert(p_counter->allocated >= p_size);
+    p_counter->allocated -= p_size;
+    if (p_counter->mutex) {
+        opj_mutex_unlock(p_counter->mutex);
+    }
+}
+
+void opj_mem_counter_reset_peak(opj_mem_counter_t* p_counter)
+{
+    if (p_counter == NULL) {
+        return;
+    }
+    if (p_counter->mutex) {
+        opj_mutex_lock(p_counter->mutex);
+    }
+    p_counter->peak = p_counter->allocated;
+    if (p_counter->mutex) {
+        opj_mutex_unlock(p_counter->mutex);
+    }
+}
+
+size_t opj_mem_counter_get_peak(opj_mem_counter_t* p_counter)
+{
+    size_t l_peak;
+
+    if (p_counter == NULL) {
+        return 0;
+    }
+    if (p_counter->mutex) {
+        opj_mutex_lock(p_counter->mutex);
+    }
+    l_peak = p_counter->peak;
+    if (p_counter->mutex) {
+        opj_mutex_unlock(p_counter->mutex);
+    }
+    return l_peak;
+}
@@ -0,0 +1,101 @@
+/*
+ * The copyright in this software is being made available under the 2-clauses
+ * BSD License, included below. This software may be subject to other third
+ * party and contributor rights, including patent rights, and no such rights
+ * are granted under this license.
+ *
+ * Copyright (c) 2026, OpenJPEG contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS `AS IS'
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef OPJ_MEM_COUNTER_H
+#define OPJ_MEM_COUNTER_H
+/**
+@file opj_mem_counter.h
+@brief Counter of the memory held by a codec
+
+A memory counter accounts for the bytes allocated on behalf of a codec,
+whichever thread allocates or frees them, and keeps their peak. The
+allocations register themselves with opj_mem_counter_add() and
+opj_mem_counter_remove(), with their size.
+
+A counter may be updated concurrently by several threads. All the
+functions accept a NULL counter, and do nothing then.
+*/
+
+/** @defgroup MEM_COUNTER MEM_COUNTER - Counter of the memory held by a codec */
+/*@{*/
+
+/** Opaque type for memory counters */
+typedef struct opj_mem_counter opj_mem_counter_t;
+
+/** @name Exported functions */
+/*@{*/
+/* ----------------------------------------------------------------------- */
+
+/**
+Creates a memory counter, counting no byte.
+@return a new counter, or NULL in case of failure
+*/
+opj_mem_counter_t* opj_mem_counter_create(void);
+
+/**
+Destroys a memory counter.
+@param p_counter counter, may be NULL
+*/
+void opj_mem_counter_destroy(opj_mem_counter_t* p_counter);
+
+/**
+Accounts for an allocation.
+@param p_counter counter, may be NULL
+@param p_size size of the allocated block
+*/
+void opj_mem_counter_add(opj_mem_counter_t* p_counter, size_t p_size);
+
+/**
+Accounts for the release of a block given to opj_mem_counter_add().
+@param p_counter counter, may be NULL
+@param p_size size of the released block
+*/
+void opj_mem_counter_remove(opj_mem_counter_t* p_counter, size_t p_size);
+
+/**
+Restarts the peak from the number of bytes currently allocated.
+@param p_counter counter, may be NULL
+*/
+void opj_mem_counter_reset_peak(opj_mem_counter_t* p_counter);
+
+/**
+Returns the peak number of bytes allocated since the creation of the
+counter or the last opj_mem_counter_reset_peak().
+@param p_counter counter, may be NULL
+@return the peak, or 0 for a NULL counter
+*/
+size_t opj_mem_counter_get_peak(opj_mem_counter_t* p_counter);
+
+/* ----------------------------------------------------------------------- */
+/*@}*/
+
+/*@}*/
+
+#endif /* OPJ_MEM_COUNTER_H */
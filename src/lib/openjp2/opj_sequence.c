@@ -0,0 +1,366 @@
+/*
+ * The copyright in this software is being made available under the 2-clauses
+ * BSD License, included below. This software may be subject to other third
+ * party and contributor rights, including patent rights, and no such rights
+ * are granted under this license.
+ *
+ * Copyright (c) 2026, OpenJPEG contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS `AS IS'
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "opj_includes.h"
+
+/** State of a slot of a sequence decoder */
+typedef enum {
+    OPJ_SEQUENCE_SLOT_EMPTY,    /**< no frame, or frame popped */
+    OPJ_SEQUENCE_SLOT_QUEUED,   /**< frame pushed, being decoded */
+    OPJ_SEQUENCE_SLOT_DECODED   /**< frame decoded (or failed), to be popped */
+} opj_sequence_slot_state_t;
+
+/** Slot of a sequence decoder, decoding one frame at a time */
+typedef struct opj_sequence_slot {
+    /** Sequence decoder the slot belongs to */
+    struct opj_sequence_decoder* decoder;
+    /** Thread driving the decoding of the frames of the slot, or NULL */
+    /** without thread support */
+    opj_thread_t* thread;
+    /** Signaled when the state of the slot changes */
+    opj_cond_t* cond;
+    /** Decompressor of the slot, reused from one frame to the next */
+    opj_codec_t* codec;
+    /** Whether codec has read a frame, and must be reset before the next */
+    OPJ_BOOL codec_used;
+    /** Codestream of the frame */
+    const void* data;
+    /** Number of bytes of data */
+    OPJ_SIZE_T size;
+    /** Decoded image, or NULL */
+    opj_image_t* image;
+    /** Whether the frame has been decoded */
+    OPJ_BOOL ok;
+    /** State, protected by the mutex of the decoder */
+    opj_sequence_slot_state_t state;
+} opj_sequence_slot_t;
+
+struct opj_sequence_decoder {
+    /** Codec of the frames */
+    OPJ_CODEC_FORMAT format;
+    /** Decompression parameters given to the decompressors */
+    opj_dparameters_t parameters;
+    /** View of the thread pool of the user, or NULL */
+    opj_thread_pool_t* tp;
+    /** Receives the error messages */
+    opj_event_mgr_t event_mgr;
+    /** Protects the state of the slots, and stop */
+    opj_mutex_t* mutex;
+    /** Set when the threads of the slots must exit */
+    OPJ_BOOL stop;
+    /** Number of slots, which is the maximum number of frames in flight */
+    OPJ_UINT32 nb_slots;
+    /** Slots, used in turn by the frames */
+    opj_sequence_slot_t* slots;
+    /** Slot of the next frame pushed */
+    OPJ_UINT32 next_push;
+    /** Slot of the next frame popped */
+    OPJ_UINT32 next_pop;
+    /** Number of frames pushed and not popped yet */
+    OPJ_UINT32 nb_pending;
+};
+
+/**
+ * Decodes the frame of a slot, with the decompressor of the slot, which is
+ * created the first time, and reset for the next frames.
+ */
+static void opj_sequence_decode_frame(opj_sequence_decoder_t* p_decoder,
+                                      opj_sequence_slot_t* p_slot)
+{
+    opj_stream_t* l_stream;
+    opj_image_t* l_image = NULL;
+    OPJ_BOOL l_ok = OPJ_FALSE;
+
+    p_slot->image = NULL;
+    p_slot->ok = OPJ_FALSE;
+
+    if (p_slot->codec != NULL && p_slot->codec_used &&
+            !opj_reset_decompress(p_slot->codec)) {
+        opj_destroy_codec(p_slot->codec);
+        p_slot->codec = NULL;
+    }
+    if (p_slot->codec == NULL) {
+        p_slot->codec = opj_create_decompress(p_decoder->format);
+        if (p_slot->codec == NULL) {
+            opj_event_msg(&(p_decoder->event_mgr), EVT_ERROR,
+                          "Cannot create the decompressor of a frame\n");
+            return;
+        }
+        opj_set_error_handler(p_slot->codec, p_decoder->event_mgr.error_handler,
+                              p_decoder->event_mgr.m_error_data);
+        if (!opj_setup_decoder(p_slot->codec, &(p_decoder->parameters)) ||
+                (opj_has_thread_support() &&
+                 !opj_codec_set_thread_pool(p_slot->codec, p_decoder->tp))) {
+            opj_event_msg(&(p_decoder->event_mgr), EVT_ERROR,
+                          "Cannot set up the decompressor of a frame\n");
+            opj_destroy_codec(p_slot->codec);
+            p_slot->codec = NULL;
+            return;
+        }
+        p_slot->codec_used = OPJ_FALSE;
+    }
+
+    l_stream = opj_stream_create_memory_stream(p_slot->data, p_slot->size);
+    if (l_stream == NULL) {
+        opj_event_msg(&(p_decoder->event_mgr), EVT_ERROR,
+                      "Cannot create the stream of a frame\n");
+        return;
+    }
+    p_slot->codec_used = OPJ_TRUE;
+    l_ok = opj_read_header(l_stream, p_slot->codec, &l_image) &&
+           opj_decode(p_slot->codec, l_stream, l_image) &&
+           opj_end_decompress(p_slot->codec, l_stream);
+    opj_stream_destroy(l_stream);
+
+    if (!l_ok) {
+        opj_image_destroy(l_image);
+        /* Start again from a new decompressor for the next frame */
+        opj_destroy_codec(p_slot->codec);
+        p_slot->codec = NULL;
+        return;
+    }
+    p_slot->image = l_image;
+    p_slot->ok = OPJ_TRUE;
+}
+
+/** Function of the thread of a slot, decoding the frames queued in it */
+static void opj_sequence_slot_thread(void* p_user_data)
+{
+    opj_sequence_slot_t* l_slot = (opj_sequence_slot_t*) p_user_data;
+    opj_sequence_decoder_t* l_decoder = l_slot->decoder;
+
+    opj_mutex_lock(l_decoder->mutex);
+    for (;;) {
+        while (l_slot->state != OPJ_SEQUENCE_SLOT_QUEUED && !l_decoder->stop) {
+            opj_cond_wait(l_slot->cond, l_decoder->mutex);
+        }
+        if (l_slot->state != OPJ_SEQUENCE_SLOT_QUEUED) {
+            break;
+        }
+        opj_mutex_unlock(l_decoder->mutex);
+
+        opj_sequence_decode_frame(l_decoder, l_slot);
+
+        opj_mutex_lock(l_decoder->mutex);
+        l_slot->state = OPJ_SEQUENCE_SLOT_DECODED;
+        opj_cond_signal(l_slot->cond);
+    }
+    opj_mutex_unlock(l_decoder->mutex);
+}
+
+opj_sequence_decoder_t* OPJ_CALLCONV opj_create_sequence_decoder(
+    OPJ_CODEC_FORMAT format,
+    opj_dparameters_t *parameters,
+    opj_thread_pool_t* p_thread_pool,
+    OPJ_UINT32 p_frames_in_flight)
+{
+    opj_sequence_decoder_t* l_decoder;
+    OPJ_UINT32 i;
+
+    if (parameters == NULL || p_frames_in_flight == 0 ||
+            (format != OPJ_CODEC_J2K && format != OPJ_CODEC_JP2)) {
+        return NULL;
+    }
+
+    l_decoder = (opj_sequence_decoder_t*) opj_calloc(1,
+                sizeof(opj_sequence_decoder_t));
+    if (l_decoder == NULL) {
+        return NULL;
+    }
+    l_decoder->format = format;
+    l_decoder->parameters = *parameters;
+    opj_set_default_event_handler(&(l_decoder->event_mgr));
+
+    l_decoder->slots = (opj_sequence_slot_t*) opj_calloc(p_frames_in_flight,
+                       sizeof(opj_sequence_slot_t));
+    if (l_decoder->slots == NULL) {
+        opj_free(l_decoder);
+        return NULL;
+    }
+    l_decoder->nb_slots = p_frames_in_flight;
+
+    /* The decoder holds its own reference on the thread pool, as the */
+    /* decompressors only get theirs with their first frame */
+    if (p_thread_pool != NULL) {
+        l_decoder->tp = opj_thread_pool_create_view(p_thread_pool);
+        if (l_decoder->tp == NULL) {
+            opj_destroy_sequence_decoder(l_decoder);
+            return NULL;
+        }
+    }
+
+    if (opj_has_thread_support()) {
+        l_decoder->mutex = opj_mutex_create();
+        if (l_decoder->mutex == NULL) {
+            opj_destroy_sequence_decoder(l_decoder);
+            return NULL;
+        }
+        for (i = 0; i < p_frames_in_flight; i++) {
+            opj_sequence_slot_t* l_slot = &(l_decoder->slots[i]);
+            l_slot->decoder = l_decoder;
+            l_slot->cond = opj_cond_create();
+            if (l_slot->cond == NULL) {
+                opj_destroy_sequence_decoder(l_decoder);
+                return NULL;
+            }
+            l_slot->thread = opj_thread_create(opj_sequence_slot_thread, l_slot);
+            if (l_slot->thread == NULL) {
+                opj_destroy_sequence_decoder(l_decoder);
+                return NULL;
+            }
+        }
+    } else {
+        for (i = 0; i < p_frames_in_flight; i++) {
+            l_decoder->slots[i].decoder = l_decoder;
+        }
+    }
+
+    return l_decoder;
+}
+
+OPJ_BOOL OPJ_CALLCONV opj_sequence_decoder_set_error_handler(
+    opj_sequence_decoder_t* p_decoder,
+    opj_msg_callback p_callback,
+    void * p_user_data)
+{
+    if (p_decoder == NULL) {
+        return OPJ_FALSE;
+    }
+    p_decoder->event_mgr.error_handler = p_callback;
+    p_decoder->event_mgr.m_error_data = p_user_data;
+    return OPJ_TRUE;
+}
+
+OPJ_BOOL OPJ_CALLCONV opj_sequence_decoder_push(
+    opj_sequence_decoder_t* p_decoder,
+    const void *p_data,
+    OPJ_SIZE_T p_size)
+{
+    opj_sequence_slot_t* l_slot;
+
+    if (p_decoder == NULL || p_data == NULL) {
+        return OPJ_FALSE;
+    }
+    if (p_decoder->nb_pending == p_decoder->nb_slots) {
+        opj_event_msg(&(p_decoder->event_mgr), EVT_ERROR,
+                      "%u frames are already in flight\n", p_decoder->nb_slots);
+        return OPJ_FALSE;
+    }
+
+    l_slot = &(p_decoder->slots[p_decoder->next_push]);
+    l_slot->data = p_data;
+    l_slot->size = p_size;
+    p_decoder->next_push = (p_decoder->next_push + 1) % p_decoder->nb_slots;
+    p_decoder->nb_pending ++;
+
+    if (l_slot->thread == NULL) {
+        opj_sequence_decode_frame(p_decoder, l_slot);
+        l_slot->state = OPJ_SEQUENCE_SLOT_DECODED;
+        return OPJ_TRUE;
+    }
+
+    opj_mutex_lock(p_decoder->mutex);
+    l_slot->state = OPJ_SEQUENCE_SLOT_QUEUED;
+    opj_cond_signal(l_slot->cond);
+    opj_mutex_unlock(p_decoder->mutex);
+    return OPJ_TRUE;
+}
+
+OPJ_BOOL OPJ_CALLCONV opj_sequence_decoder_pop(
+    opj_sequence_decoder_t* p_decoder,
+    opj_image_t** p_image)
+{
+    opj_sequence_slot_t* l_slot;
+    OPJ_BOOL l_ok;
+
+    if (p_image == NULL) {
+        return OPJ_FALSE;
+    }
+    *p_image = NULL;
+    if (p_decoder == NULL || p_decoder->nb_pending == 0) {
+        return OPJ_FALSE;
+    }
+
+    l_slot = &(p_decoder->slots[p_decoder->next_pop]);
+    if (l_slot->thread != NULL) {
+        opj_mutex_lock(p_decoder->mutex);
+        while (l_slot->state != OPJ_SEQUENCE_SLOT_DECODED) {
+            opj_cond_wait(l_slot->cond, p_decoder->mutex);
+        }
+        l_slot->state = OPJ_SEQUENCE_SLOT_EMPTY;
+        opj_mutex_unlock(p_decoder->mutex);
+    } else {
+        l_slot->state = OPJ_SEQUENCE_SLOT_EMPTY;
+    }
+
+    *p_image = l_slot->image;
+    l_ok = l_slot->ok;
+    l_slot->image = NULL;
+    l_slot->data = NULL;
+    p_decoder->next_pop = (p_decoder->next_pop + 1) % p_decoder->nb_slots;
+    p_decoder->nb_pending --;
+    return l_ok;
+}
+
+void OPJ_CALLCONV opj_destroy_sequence_decoder(opj_sequence_decoder_t*
+        p_decoder)
+{
+    OPJ_UINT32 i;
+
+    if (p_decoder == NULL) {
+        return;
+    }
+
+    /* The threads decode the frames already queued before exiting */
+    if (p_decoder->mutex != NULL) {
+        opj_mutex_lock(p_decoder->mutex);
+        p_decoder->stop = OPJ_TRUE;
+        for (i = 0; i < p_decoder->nb_slots; i++) {
+            if (p_decoder->slots[i].cond != NULL) {
+                opj_cond_signal(p_decoder->slots[i].cond);
+            }
+        }
+        opj_mutex_unlock(p_decoder->mutex);
+    }
+
+    for (i = 0; i < p_decoder->nb_slots; i++) {
+        opj_sequence_slot_t* l_slot = &(p_decoder->slots[i]);
+        if (l_slot->thread != NULL) {
+            opj_thread_join(l_slot->thread);
+        }
+        opj_cond_destroy(l_slot->cond);
+        opj_image_destroy(l_slot->image);
+        opj_destroy_codec(l_slot->codec);
+    }
+    opj_free(p_decoder->slots);
+    opj_mutex_destroy(p_decoder->mutex);
+    opj_thread_pool_destroy(p_decoder->tp);
+    opj_free(p_decoder);
+}
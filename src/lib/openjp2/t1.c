@@ -40,6 +40,7 @@
 
 #define OPJ_SKIP_POISON
 #include "opj_includes.h"
+#include "t1_kernels.h"
 
 #ifdef __SSE__
 #include <xmmintrin.h>
@@ -47,9 +48,6 @@
 #ifdef __SSE2__
 #include <emmintrin.h>
 #endif
-#if (defined(__AVX2__) || defined(__AVX512F__))
-#include <immintrin.h>
-#endif
 
 #if defined(__GNUC__)
 #pragma GCC poison malloc calloc realloc free
@@ -200,6 +198,57 @@ static double opj_t1_encode_cblk(opj_t1_t *t1,
                                  const OPJ_FLOAT64 * mct_norms,
                                  OPJ_UINT32 mct_numcomps);
 
+/**
+Encode 1 code-block with the HT block coder.
+The code-block gets a single cleanup pass. When it may be truncated, the
+cleanup pass is coded from each of its bit-planes, and cblk->passes[i]
+describes the truncation point coded from bit-plane (totalpasses - 1 - i).
+Its data is at offset passes[0].len + ... + passes[i - 1].len of cblk->data.
+@param t1 T1 handle
+@param cblk Code-block coding parameters
+@param band Band to which the code-block belongs
+@param tiledp Samples of the code-block in the tile-component data
+@param tile_w Width of the tile-component data
+@param compno Component number
+@param level Decomposition level
+@param qmfbid Wavelet transform (1: reversible, 0: irreversible)
+@param truncate Whether the rate allocation may truncate the code-block
+@param numcomps Number of components of the tile
+@param mct_norms Norms of the multi-component transform
+@param mct_numcomps Number of components used for MCT
+@param p_cumwmsedec Receives the value to increase tile->distotile
+@return OPJ_FALSE if the code-block could not be encoded
+*/
+static OPJ_BOOL opj_t1_encode_ht_cblk(opj_t1_t *t1,
+                                      opj_tcd_cblk_enc_t* cblk,
+                                      const opj_tcd_band_t* band,
+                                      const OPJ_INT32* tiledp,
+                                      OPJ_UINT32 tile_w,
+                                      OPJ_UINT32 compno,
+                                      OPJ_UINT32 level,
+                                      OPJ_UINT32 qmfbid,
+                                      OPJ_BOOL truncate,
+                                      OPJ_UINT32 numcomps,
+                                      const OPJ_FLOAT64 * mct_norms,
+                                      OPJ_UINT32 mct_numcomps,
+                                      OPJ_FLOAT64 *p_cumwmsedec);
+
+/**
+Encode the quantization indices held in t1->data, in raster order, into a
+single HT cleanup pass (implemented in ht_enc.c)
+@param t1 T1 handle
+@param bpno Bit-plane of the cleanup pass
+@param dest Buffer receiving the cleanup segment
+@param dest_size Size of dest
+@param p_len Receives the length of the cleanup segment
+@return OPJ_FALSE if the code-block could not be encoded
+*/
+OPJ_BOOL opj_t1_ht_encode_cblk(opj_t1_t *t1,
+                               OPJ_UINT32 bpno,
+                               OPJ_BYTE* dest,
+                               OPJ_UINT32 dest_size,
+                               OPJ_UINT32* p_len);
+
 /**
 Decode 1 code-block
 @param t1 T1 handle
@@ -245,6 +294,35 @@ static OPJ_BOOL opj_t1_allocate_buffers(opj_t1_t *t1,
                                         OPJ_UINT32 w,
                                         OPJ_UINT32 h);
 
+/**
+Whether the decoding of a code-block can be resumed from its saved state
+@param cblk Code-block
+@param numpasses Number of coding passes of the code-block to decode
+*/
+static OPJ_BOOL opj_t1_can_resume_dec(const opj_tcd_cblk_dec_t* cblk,
+                                      OPJ_UINT32 numpasses);
+
+/**
+Save the state of the decoding of a code-block after a coding pass, if it can
+be resumed from there.
+@param t1 T1 handle
+@param cblk Code-block
+@param numpasses Number of coding passes decoded
+@param segno Segment of the last pass decoded
+@param passno Number of passes of segment segno decoded
+@param raw Whether segment segno is decoded with the RAW decoder
+@param bpno_plus_one Bit-plane of the next pass, plus one
+@param passtype Type of the next pass
+*/
+static void opj_t1_save_dec_state(opj_t1_t *t1,
+                                  opj_tcd_cblk_dec_t* cblk,
+                                  OPJ_UINT32 numpasses,
+                                  OPJ_UINT32 segno,
+                                  OPJ_UINT32 passno,
+                                  OPJ_BOOL raw,
+                                  OPJ_INT32 bpno_plus_one,
+                                  OPJ_UINT32 passtype);
+
 /*@}*/
 
 /*@}*/
@@ -1588,26 +1666,170 @@ void opj_t1_destroy(opj_t1_t *p_t1)
     opj_free(p_t1);
 }
 
+/** Code-block to be decoded by a opj_t1_cblk_decode_processing_job_t */
 typedef struct {
-    OPJ_BOOL whole_tile_decoding;
-    OPJ_UINT32 resno;
     opj_tcd_cblk_dec_t* cblk;
     opj_tcd_band_t* band;
+    OPJ_UINT32 resno;
+    /** Estimated decoding cost. See opj_t1_estimate_cblk_decode_cost() */
+    OPJ_UINT64 cost;
+} opj_t1_cblk_decode_item_t;
+
+/** Job decoding a batch of code-blocks of the same band */
+typedef struct {
+    OPJ_BOOL whole_tile_decoding;
     opj_tcd_tilecomp_t* tilec;
     opj_tccp_t* tccp;
     OPJ_BOOL mustuse_cblkdatabuffer;
+    OPJ_BOOL keep_dec_state;
     volatile OPJ_BOOL* pret;
     opj_event_mgr_t *p_manager;
     opj_mutex_t* p_manager_mutex;
     OPJ_BOOL check_pterm;
+    /** Counter of the decoded data of the code-blocks, or NULL */
+    opj_mem_counter_t* mem_counter;
+    /** Number of code-blocks of the batch */
+    OPJ_UINT32 nb_cblks;
+    /** Code-blocks of the batch. Allocated in the same block as the job */
+    opj_t1_cblk_decode_item_t* cblks;
 } opj_t1_cblk_decode_processing_job_t;
 
+/** Minimum estimated cost of a batch of code-blocks submitted as a single */
+/** job, roughly the one of a 64x64 code-block with a dozen coding passes */
+#define OPJ_T1_MIN_BATCH_COST (64 * 64 * 4)
+
+/** Number of jobs per thread aimed at for each tile-component, so that */
+/** threads stay balanced even if the cost estimation is inaccurate */
+#define OPJ_T1_BATCHES_PER_THREAD 4
+
 static void opj_t1_destroy_wrapper(void* t1)
 {
     opj_t1_destroy((opj_t1_t*) t1);
 }
 
-static void opj_t1_clbl_decode_processor(void* user_data, opj_tls_t* tls)
+static void opj_t1_decode_rev_row(OPJ_INT32* OPJ_RESTRICT dst,
+                                  const OPJ_INT32* OPJ_RESTRICT src,
+                                  OPJ_UINT32 len)
+{
+    OPJ_UINT32 i = 0;
+    for (; i < (len & ~(OPJ_UINT32)3U); i += 4U) {
+        OPJ_INT32 tmp0 = src[i + 0U];
+        OPJ_INT32 tmp1 = src[i + 1U];
+        OPJ_INT32 tmp2 = src[i + 2U];
+        OPJ_INT32 tmp3 = src[i + 3U];
+        dst[i + 0U] = tmp0 / 2;
+        dst[i + 1U] = tmp1 / 2;
+        dst[i + 2U] = tmp2 / 2;
+        dst[i + 3U] = tmp3 / 2;
+    }
+    for (; i < len; ++i) {
+        OPJ_INT32 tmp = src[i];
+        dst[i] = tmp / 2;
+    }
+}
+
+static void opj_t1_decode_irrev_dequant(OPJ_INT32* data,
+                                        OPJ_UINT32 len,
+                                        OPJ_FLOAT32 stepsize)
+{
+    OPJ_UINT32 i;
+    for (i = 0; i < len; ++i) {
+        OPJ_FLOAT32 tmp = ((OPJ_FLOAT32)(*data)) * stepsize;
+        memcpy(data, &tmp, sizeof(tmp));
+        data++;
+    }
+}
+
+#ifdef __SSE2__
+static void opj_t1_decode_irrev_dequant_sse2(OPJ_INT32* data,
+        OPJ_UINT32 len,
+        OPJ_FLOAT32 stepsize)
+{
+    const __m128 xmm_stepsize = _mm_set1_ps(stepsize);
+    OPJ_UINT32 i = 0;
+    for (; i < (len & ~15U); i += 16) {
+        __m128 xmm0_data = _mm_cvtepi32_ps(_mm_load_si128((__m128i * const)(
+                                               data + 0)));
+        __m128 xmm1_data = _mm_cvtepi32_ps(_mm_load_si128((__m128i * const)(
+                                               data + 4)));
+        __m128 xmm2_data = _mm_cvtepi32_ps(_mm_load_si128((__m128i * const)(
+                                               data + 8)));
+        __m128 xmm3_data = _mm_cvtepi32_ps(_mm_load_si128((__m128i * const)(
+                                               data + 12)));
+        _mm_store_ps((float*)(data +  0), _mm_mul_ps(xmm0_data, xmm_stepsize));
+        _mm_store_ps((float*)(data +  4), _mm_mul_ps(xmm1_data, xmm_stepsize));
+        _mm_store_ps((float*)(data +  8), _mm_mul_ps(xmm2_data, xmm_stepsize));
+        _mm_store_ps((float*)(data + 12), _mm_mul_ps(xmm3_data, xmm_stepsize));
+        data += 16;
+    }
+    opj_t1_decode_irrev_dequant(data, len - i, stepsize);
+}
+#endif
+
+static void opj_t1_encode_rev_stripe(OPJ_UINT32* OPJ_RESTRICT t1data,
+                                     const OPJ_UINT32* OPJ_RESTRICT tiledp,
+                                     OPJ_UINT32 w,
+                                     OPJ_SIZE_T stride)
+{
+    OPJ_UINT32 i;
+    for (i = 0; i < w; ++i) {
+        t1data[0] = tiledp[0 * stride + i] << T1_NMSEDEC_FRACBITS;
+        t1data[1] = tiledp[1 * stride + i] << T1_NMSEDEC_FRACBITS;
+        t1data[2] = tiledp[2 * stride + i] << T1_NMSEDEC_FRACBITS;
+        t1data[3] = tiledp[3 * stride + i] << T1_NMSEDEC_FRACBITS;
+        t1data += 4;
+    }
+}
+
+/** Plain C kernels */
+static const opj_t1_kernels_t opj_t1_kernels_generic = {
+    opj_t1_decode_rev_row,
+    opj_t1_decode_irrev_dequant,
+    opj_t1_encode_rev_stripe
+};
+
+#ifdef __SSE2__
+/** Kernels for the instruction set enabled by the compiler flags */
+static const opj_t1_kernels_t opj_t1_kernels_baseline = {
+    opj_t1_decode_rev_row,
+    opj_t1_decode_irrev_dequant_sse2,
+    opj_t1_encode_rev_stripe
+};
+#endif
+
+/** Returns the tier-1 kernels for the SIMD level of the host CPU */
+static const opj_t1_kernels_t* opj_t1_get_kernels(void)
+{
+    switch (opj_cpu_get_simd_level()) {
+#ifdef OPJ_HAVE_AVX512_KERNELS
+    case OPJ_SIMD_AVX512:
+        return &opj_t1_kernels_avx512;
+#endif
+#ifdef OPJ_HAVE_AVX2_KERNELS
+    case OPJ_SIMD_AVX2:
+        return &opj_t1_kernels_avx2;
+#endif
+    case OPJ_SIMD_GENERIC:
+        return &opj_t1_kernels_generic;
+    default:
+#ifdef __SSE2__
+        return &opj_t1_kernels_baseline;
+#else
+        return &opj_t1_kernels_generic;
+#endif
+    }
+}
+
+/** Decodes a code-block of a batch.
+ * On error, *(job->pret) is set to OPJ_FALSE.
+ * @param job the batch
+ * @param item the code-block to decode
+ * @param t1 Tier 1 handle of the current thread
+ */
+static void opj_t1_clbl_decode_processor_cblk(
+    opj_t1_cblk_decode_processing_job_t* job,
+    const opj_t1_cblk_decode_item_t* item,
+    opj_t1_t* t1)
 {
     opj_tcd_cblk_dec_t* cblk;
     opj_tcd_band_t* band;
@@ -1617,14 +1839,11 @@ static void opj_t1_clbl_decode_processor(void* user_data, opj_tls_t* tls)
     OPJ_UINT32 cblk_w, cblk_h;
     OPJ_INT32 x, y;
     OPJ_UINT32 i, j;
-    opj_t1_cblk_decode_processing_job_t* job;
-    opj_t1_t* t1;
     OPJ_UINT32 resno;
     OPJ_UINT32 tile_w;
+    const opj_t1_kernels_t* kernels = opj_t1_get_kernels();
 
-    job = (opj_t1_cblk_decode_processing_job_t*) user_data;
-
-    cblk = job->cblk;
+    cblk = item->cblk;
 
     if (!job->whole_tile_decoding) {
         cblk_w = (OPJ_UINT32)(cblk->x1 - cblk->x0);
@@ -1642,20 +1861,20 @@ static void opj_t1_clbl_decode_processor(void* user_data, opj_tls_t* tls)
                 opj_mutex_unlock(job->p_manager_mutex);
             }
             *(job->pret) = OPJ_FALSE;
-            opj_free(job);
             return;
         }
+        opj_mem_counter_add(job->mem_counter,
+                            sizeof(OPJ_INT32) * cblk_w * cblk_h);
         /* Zero-init required */
         memset(cblk->decoded_data, 0, sizeof(OPJ_INT32) * cblk_w * cblk_h);
     } else if (cblk->decoded_data) {
         /* Not sure if that code path can happen, but better be */
         /* safe than sorry */
-        opj_aligned_free(cblk->decoded_data);
-        cblk->decoded_data = NULL;
+        opj_tcd_free_cblk_decoded_data(job->mem_counter, cblk);
     }
 
-    resno = job->resno;
-    band = job->band;
+    resno = item->resno;
+    band = item->band;
     tilec = job->tilec;
     tccp = job->tccp;
     tile_w = (OPJ_UINT32)(tilec->resolutions[tilec->minimum_num_resolutions - 1].x1
@@ -1663,31 +1882,9 @@ static void opj_t1_clbl_decode_processor(void* user_data, opj_tls_t* tls)
                           tilec->resolutions[tilec->minimum_num_resolutions - 1].x0);
 
     if (!*(job->pret)) {
-        opj_free(job);
         return;
     }
 
-    t1 = (opj_t1_t*) opj_tls_get(tls, OPJ_TLS_KEY_T1);
-    if (t1 == NULL) {
-        t1 = opj_t1_create(OPJ_FALSE);
-        if (t1 == NULL) {
-            opj_event_msg(job->p_manager, EVT_ERROR,
-                          "Cannot allocate Tier 1 handle\n");
-            *(job->pret) = OPJ_FALSE;
-            opj_free(job);
-            return;
-        }
-        if (!opj_tls_set(tls, OPJ_TLS_KEY_T1, t1, opj_t1_destroy_wrapper)) {
-            opj_event_msg(job->p_manager, EVT_ERROR,
-                          "Unable to set t1 handle as TLS\n");
-            opj_t1_destroy(t1);
-            *(job->pret) = OPJ_FALSE;
-            opj_free(job);
-            return;
-        }
-    }
-    t1->mustuse_cblkdatabuffer = job->mustuse_cblkdatabuffer;
-
     if ((tccp->cblksty & J2K_CCP_CBLKSTY_HT) != 0) {
         if (OPJ_FALSE == opj_t1_ht_decode_cblk(
                     t1,
@@ -1699,7 +1896,6 @@ static void opj_t1_clbl_decode_processor(void* user_data, opj_tls_t* tls)
                     job->p_manager_mutex,
                     job->check_pterm)) {
             *(job->pret) = OPJ_FALSE;
-            opj_free(job);
             return;
         }
     } else {
@@ -1713,7 +1909,6 @@ static void opj_t1_clbl_decode_processor(void* user_data, opj_tls_t* tls)
                     job->p_manager_mutex,
                     job->check_pterm)) {
             *(job->pret) = OPJ_FALSE;
-            opj_free(job);
             return;
         }
     }
@@ -1768,32 +1963,7 @@ static void opj_t1_clbl_decode_processor(void* user_data, opj_tls_t* tls)
             }
         } else {        /* if (tccp->qmfbid == 0) */
             const float stepsize = 0.5f * band->stepsize;
-            i = 0;
-#ifdef __SSE2__
-            {
-                const __m128 xmm_stepsize = _mm_set1_ps(stepsize);
-                for (; i < (cblk_size & ~15U); i += 16) {
-                    __m128 xmm0_data = _mm_cvtepi32_ps(_mm_load_si128((__m128i * const)(
-                                                           datap + 0)));
-                    __m128 xmm1_data = _mm_cvtepi32_ps(_mm_load_si128((__m128i * const)(
-                                                           datap + 4)));
-                    __m128 xmm2_data = _mm_cvtepi32_ps(_mm_load_si128((__m128i * const)(
-                                                           datap + 8)));
-                    __m128 xmm3_data = _mm_cvtepi32_ps(_mm_load_si128((__m128i * const)(
-                                                           datap + 12)));
-                    _mm_store_ps((float*)(datap +  0), _mm_mul_ps(xmm0_data, xmm_stepsize));
-                    _mm_store_ps((float*)(datap +  4), _mm_mul_ps(xmm1_data, xmm_stepsize));
-                    _mm_store_ps((float*)(datap +  8), _mm_mul_ps(xmm2_data, xmm_stepsize));
-                    _mm_store_ps((float*)(datap + 12), _mm_mul_ps(xmm3_data, xmm_stepsize));
-                    datap += 16;
-                }
-            }
-#endif
-            for (; i < cblk_size; ++i) {
-                OPJ_FLOAT32 tmp = ((OPJ_FLOAT32)(*datap)) * stepsize;
-                memcpy(datap, &tmp, sizeof(tmp));
-                datap++;
-            }
+            kernels->decode_irrev_dequant(datap, cblk_size, stepsize);
         }
     } else if (tccp->qmfbid == 1) {
         OPJ_INT32* OPJ_RESTRICT tiledp = &tilec->data[(OPJ_SIZE_T)y * tile_w +
@@ -1801,53 +1971,8 @@ static void opj_t1_clbl_decode_processor(void* user_data, opj_tls_t* tls)
         for (j = 0; j < cblk_h; ++j) {
             //positive -> round down aka.  (83)/2 =  41.5 ->  41
             //negative -> round up   aka. (-83)/2 = -41.5 -> -41
-#if defined(__AVX512F__)
-            OPJ_INT32* ptr_in = datap + (j * cblk_w);
-            OPJ_INT32* ptr_out = tiledp + (j * (OPJ_SIZE_T)tile_w);
-            for (i = 0; i < cblk_w / 16; ++i) {
-                __m512i in_avx = _mm512_loadu_si512((__m512i*)(ptr_in));
-                const __m512i add_avx = _mm512_srli_epi32(in_avx, 31);
-                in_avx = _mm512_add_epi32(in_avx, add_avx);
-                _mm512_storeu_si512((__m512i*)(ptr_out), _mm512_srai_epi32(in_avx, 1));
-                ptr_in += 16;
-                ptr_out += 16;
-            }
-
-            for (i = 0; i < cblk_w % 16; ++i) {
-                ptr_out[i] = ptr_in[i] / 2;
-            }
-#elif defined(__AVX2__)
-            OPJ_INT32* ptr_in = datap + (j * cblk_w);
-            OPJ_INT32* ptr_out = tiledp + (j * (OPJ_SIZE_T)tile_w);
-            for (i = 0; i < cblk_w / 8; ++i) {
-                __m256i in_avx = _mm256_loadu_si256((__m256i*)(ptr_in));
-                const __m256i add_avx = _mm256_srli_epi32(in_avx, 31);
-                in_avx = _mm256_add_epi32(in_avx, add_avx);
-                _mm256_storeu_si256((__m256i*)(ptr_out), _mm256_srai_epi32(in_avx, 1));
-                ptr_in += 8;
-                ptr_out += 8;
-            }
-
-            for (i = 0; i < cblk_w % 8; ++i) {
-                ptr_out[i] = ptr_in[i] / 2;
-            }
-#else
-            i = 0;
-            for (; i < (cblk_w & ~(OPJ_UINT32)3U); i += 4U) {
-                OPJ_INT32 tmp0 = datap[(j * cblk_w) + i + 0U];
-                OPJ_INT32 tmp1 = datap[(j * cblk_w) + i + 1U];
-                OPJ_INT32 tmp2 = datap[(j * cblk_w) + i + 2U];
-                OPJ_INT32 tmp3 = datap[(j * cblk_w) + i + 3U];
-                ((OPJ_INT32*)tiledp)[(j * (OPJ_SIZE_T)tile_w) + i + 0U] = tmp0 / 2;
-                ((OPJ_INT32*)tiledp)[(j * (OPJ_SIZE_T)tile_w) + i + 1U] = tmp1 / 2;
-                ((OPJ_INT32*)tiledp)[(j * (OPJ_SIZE_T)tile_w) + i + 2U] = tmp2 / 2;
-                ((OPJ_INT32*)tiledp)[(j * (OPJ_SIZE_T)tile_w) + i + 3U] = tmp3 / 2;
-            }
-            for (; i < cblk_w; ++i) {
-                OPJ_INT32 tmp = datap[(j * cblk_w) + i];
-                ((OPJ_INT32*)tiledp)[(j * (OPJ_SIZE_T)tile_w) + i] = tmp / 2;
-            }
-#endif
+            kernels->decode_rev_row(tiledp + (j * (OPJ_SIZE_T)tile_w),
+                                    datap + (j * cblk_w), cblk_w);
         }
     } else {        /* if (tccp->qmfbid == 0) */
         const float stepsize = 0.5f * band->stepsize;
@@ -1864,29 +1989,335 @@ static void opj_t1_clbl_decode_processor(void* user_data, opj_tls_t* tls)
             tiledp += tile_w;
         }
     }
+}
+
+static void opj_t1_clbl_decode_processor(void* user_data, opj_tls_t* tls)
+{
+    opj_t1_cblk_decode_processing_job_t* job;
+    opj_t1_t* t1;
+    OPJ_UINT32 i;
+
+    job = (opj_t1_cblk_decode_processing_job_t*) user_data;
+
+    if (!*(job->pret)) {
+        opj_free(job);
+        return;
+    }
+
+    t1 = (opj_t1_t*) opj_tls_get(tls, OPJ_TLS_KEY_T1);
+    if (t1 == NULL) {
+        t1 = opj_t1_create(OPJ_FALSE);
+        if (t1 == NULL) {
+            opj_event_msg(job->p_manager, EVT_ERROR,
+                          "Cannot allocate Tier 1 handle\n");
+            *(job->pret) = OPJ_FALSE;
+            opj_free(job);
+            return;
+        }
+        if (!opj_tls_set(tls, OPJ_TLS_KEY_T1, t1, opj_t1_destroy_wrapper)) {
+            opj_event_msg(job->p_manager, EVT_ERROR,
+                          "Unable to set t1 handle as TLS\n");
+            opj_t1_destroy(t1);
+            *(job->pret) = OPJ_FALSE;
+            opj_free(job);
+            return;
+        }
+    }
+    t1->mustuse_cblkdatabuffer = job->mustuse_cblkdatabuffer;
+    t1->keep_dec_state = job->keep_dec_state;
+
+    for (i = 0; i < job->nb_cblks && *(job->pret); ++i) {
+        opj_t1_clbl_decode_processor_cblk(job, &(job->cblks[i]), t1);
+    }
 
     opj_free(job);
 }
 
+opj_tcd_cblk_dec_state_t* opj_t1_get_cblk_dec_state(opj_tcd_cblk_dec_t*
+        cblk, OPJ_UINT32 flagssize)
+{
+    if (cblk->dec_state == NULL) {
+        OPJ_SIZE_T datasize = (OPJ_SIZE_T)(OPJ_UINT32)(cblk->x1 - cblk->x0) *
+                              (OPJ_UINT32)(cblk->y1 - cblk->y0);
+        opj_tcd_cblk_dec_state_t* state = (opj_tcd_cblk_dec_state_t*)opj_malloc(
+                                              sizeof(opj_tcd_cblk_dec_state_t) +
+                                              datasize * sizeof(OPJ_INT32) +
+                                              flagssize * sizeof(opj_flag_t));
+        if (state == NULL) {
+            return NULL;
+        }
+        state->numpasses = 0;
+        state->data = (OPJ_INT32*)(state + 1);
+        state->flags = (OPJ_UINT32*)(state->data + datasize);
+        cblk->dec_state = state;
+    }
+    return cblk->dec_state;
+}
 
-void opj_t1_decode_cblks(opj_tcd_t* tcd,
-                         volatile OPJ_BOOL* pret,
-                         opj_tcd_tilecomp_t* tilec,
-                         opj_tccp_t* tccp,
-                         opj_event_mgr_t *p_manager,
-                         opj_mutex_t* p_manager_mutex,
-                         OPJ_BOOL check_pterm
-                        )
+static OPJ_BOOL opj_t1_can_resume_dec(const opj_tcd_cblk_dec_t* cblk,
+                                      OPJ_UINT32 numpasses)
+{
+    const opj_tcd_cblk_dec_state_t* state = cblk->dec_state;
+    OPJ_BYTE appended[MQC_MAX_PAST_END];
+    OPJ_UINT32 seglen, pos, count, i;
+
+    if (state == NULL || state->numpasses >= numpasses || cblk->corrupted) {
+        return OPJ_FALSE;
+    }
+    /* The passes of the saved state are the first ones of the code-block, */
+    /* so the segments before the one of the next pass are complete, and */
+    /* the decoding of that segment is resumed after the bytes it has read */
+    if (state->passno == 0) {
+        return OPJ_TRUE;
+    }
+    seglen = cblk->segs[state->segno].len;
+    if (state->mqc.offset >= seglen ||
+            state->mqc.offset + state->mqc.past_end > seglen) {
+        return OPJ_FALSE;
+    }
+    if (state->mqc.past_end == 0) {
+        return OPJ_TRUE;
+    }
+    /* Gather the bytes appended to the segment which replace the ones */
+    /* read past its end */
+    pos = state->mqc.offset;
+    for (i = 0; i < state->segno; ++i) {
+        pos += cblk->segs[i].len;
+    }
+    count = 0;
+    for (i = 0; count < state->mqc.past_end && i < cblk->numchunks; ++i) {
+        const opj_tcd_seg_data_chunk_t* chunk = &cblk->chunks[i];
+        if (pos >= chunk->len) {
+            pos -= chunk->len;
+            continue;
+        }
+        for (; count < state->mqc.past_end && pos < chunk->len; ++pos) {
+            appended[count++] = chunk->data[pos];
+        }
+        pos = 0;
+    }
+    return opj_mqc_can_resume_dec(&(state->mqc), appended);
+}
+
+static void opj_t1_save_dec_state(opj_t1_t *t1,
+                                  opj_tcd_cblk_dec_t* cblk,
+                                  OPJ_UINT32 numpasses,
+                                  OPJ_UINT32 segno,
+                                  OPJ_UINT32 passno,
+                                  OPJ_BOOL raw,
+                                  OPJ_INT32 bpno_plus_one,
+                                  OPJ_UINT32 passtype)
+{
+    opj_mqc_dec_state_t l_mqc;
+    opj_tcd_cblk_dec_state_t* state;
+
+    if (passno == cblk->segs[segno].maxpasses) {
+        /* The segment is terminated: only the contexts are needed to */
+        /* start the next one */
+        opj_mqc_save_dec(&(t1->mqc), raw, &l_mqc);
+        ++segno;
+        passno = 0;
+    } else if (!opj_mqc_save_dec(&(t1->mqc), raw, &l_mqc)) {
+        return;
+    }
+
+    state = opj_t1_get_cblk_dec_state(cblk, t1->flagssize);
+    if (state == NULL) {
+        return;
+    }
+    state->numpasses = numpasses;
+    state->segno = segno;
+    state->passno = passno;
+    state->bpno_plus_one = bpno_plus_one;
+    state->passtype = passtype;
+    state->raw = raw;
+    state->mqc = l_mqc;
+    memcpy(state->data, t1->data, (OPJ_SIZE_T)t1->w * t1->h * sizeof(OPJ_INT32));
+    memcpy(state->flags, t1->flags, t1->flagssize * sizeof(opj_flag_t));
+}
+
+/** Estimates the time needed to decode a code-block, in arbitrary units.
+ * It accounts for a fixed cost per sample (zero-initialization,
+ * dequantization and copy to the tile buffer), a cost per sample and per
+ * coding pass (each pass scans the whole code-block) and a cost per
+ * compressed byte (symbol decoding).
+ */
+static OPJ_UINT64 opj_t1_estimate_cblk_decode_cost(const opj_tcd_cblk_dec_t*
+        cblk)
+{
+    OPJ_UINT64 area = (OPJ_UINT64)(OPJ_UINT32)(cblk->x1 - cblk->x0) *
+                      (OPJ_UINT32)(cblk->y1 - cblk->y0);
+    OPJ_UINT64 passes = 0;
+    OPJ_UINT64 bytes = 0;
+    OPJ_UINT32 i;
+
+    for (i = 0; i < cblk->real_num_segs; ++i) {
+        passes += cblk->segs[i].real_num_passes;
+    }
+    for (i = 0; i < cblk->numchunks; ++i) {
+        bytes += cblk->chunks[i].len;
+    }
+    /* Only the passes after those of the saved state are decoded */
+    if (opj_t1_can_resume_dec(cblk, (OPJ_UINT32)passes)) {
+        passes -= cblk->dec_state->numpasses;
+    }
+    return area + (area * passes) / 4 + bytes * 8;
+}
+
+/** Submits a job decoding items[0..nb_items-1].
+ * @return OPJ_FALSE in case of memory allocation failure.
+ */
+static OPJ_BOOL opj_t1_submit_cblk_decode_batch(
+    opj_thread_pool_t* tp,
+    const opj_t1_cblk_decode_processing_job_t* job_template,
+    const opj_t1_cblk_decode_item_t* items,
+    OPJ_UINT32 nb_items)
+{
+    opj_t1_cblk_decode_processing_job_t* job;
+
+    job = (opj_t1_cblk_decode_processing_job_t*) opj_malloc(
+              sizeof(opj_t1_cblk_decode_processing_job_t) +
+              nb_items * sizeof(opj_t1_cblk_decode_item_t));
+    if (!job) {
+        return OPJ_FALSE;
+    }
+    *job = *job_template;
+    job->nb_cblks = nb_items;
+    job->cblks = (opj_t1_cblk_decode_item_t*)(job + 1);
+    memcpy(job->cblks, items, nb_items * sizeof(opj_t1_cblk_decode_item_t));
+    return opj_thread_pool_submit_job(tp, opj_t1_clbl_decode_processor, job);
+}
+
+/** Returns the number of coding passes of a code-block to decode */
+static OPJ_UINT32 opj_t1_get_cblk_numpasses(const opj_tcd_cblk_dec_t* cblk)
+{
+    OPJ_UINT32 numpasses = 0;
+    OPJ_UINT32 i;
+
+    for (i = 0; i < cblk->real_num_segs; ++i) {
+        numpasses += cblk->segs[i].real_num_passes;
+    }
+    return numpasses;
+}
+
+/** Releases the decoded data of a code-block that is not needed by the */
+/** current decoding, keeping it in the code-block cache if there is one */
+static void opj_t1_release_decoded_data(opj_tcd_t* tcd,
+                                        opj_tcd_cblk_dec_t* cblk,
+                                        OPJ_UINT32 compno,
+                                        OPJ_UINT32 resno,
+                                        OPJ_UINT32 bandno,
+                                        OPJ_UINT32 precno,
+                                        OPJ_UINT32 cblkno)
+{
+    if (tcd->cblk_cache != NULL) {
+        opj_cblk_cache_key_t key;
+        opj_tcd_get_cblk_cache_key(tcd, compno, resno, bandno, precno, cblkno,
+                                   cblk->decoded_numpasses, &key);
+        opj_cblk_cache_put(tcd->cblk_cache, &key, cblk->decoded_data,
+                           (OPJ_SIZE_T)(cblk->x1 - cblk->x0) *
+                           (OPJ_SIZE_T)(cblk->y1 - cblk->y0));
+        cblk->decoded_data = NULL;
+    } else {
+        opj_tcd_free_cblk_decoded_data(tcd->mem_counter, cblk);
+    }
+}
+
+/** Submits jobs decoding items[0..nb_items-1] to tp. Consecutive */
+/** code-blocks of the same band are grouped in jobs, so that small */
+/** code-blocks do not pay the cost of a job each, while keeping enough */
+/** jobs to balance the load between threads */
+static void opj_t1_submit_cblk_decode_items(opj_tcd_t* tcd,
+        opj_thread_pool_t* tp,
+        const opj_t1_cblk_decode_item_t* items,
+        OPJ_UINT32 nb_items,
+        OPJ_UINT64 total_cost,
+        volatile OPJ_BOOL* pret,
+        opj_tcd_tilecomp_t* tilec,
+        opj_tccp_t* tccp,
+        opj_event_mgr_t *p_manager,
+        opj_mutex_t* p_manager_mutex,
+        OPJ_BOOL check_pterm)
+{
+    opj_t1_cblk_decode_processing_job_t job_template;
+    OPJ_UINT64 batch_cost;
+    OPJ_UINT64 max_batch_cost;
+    OPJ_UINT32 first_item;
+    OPJ_UINT32 i;
+    int num_threads;
+
+    memset(&job_template, 0, sizeof(job_template));
+    job_template.whole_tile_decoding = tcd->whole_tile_decoding;
+    job_template.tilec = tilec;
+    job_template.tccp = tccp;
+    job_template.pret = pret;
+    job_template.p_manager_mutex = p_manager_mutex;
+    job_template.p_manager = p_manager;
+    job_template.check_pterm = check_pterm;
+    job_template.mem_counter = tcd->mem_counter;
+    num_threads = opj_thread_pool_get_thread_count(tp);
+    /* The MQ decoder temporarily writes a marker after the code-block data */
+    job_template.mustuse_cblkdatabuffer = num_threads > 1 || tcd->src_read_only;
+    job_template.keep_dec_state = tcd->refinable;
+
+    if (num_threads < 1) {
+        num_threads = 1;
+    }
+    max_batch_cost = total_cost / ((OPJ_UINT64)num_threads *
+                                   OPJ_T1_BATCHES_PER_THREAD);
+    if (max_batch_cost < OPJ_T1_MIN_BATCH_COST) {
+        max_batch_cost = OPJ_T1_MIN_BATCH_COST;
+    }
+
+    first_item = 0;
+    batch_cost = 0;
+    for (i = 0; i < nb_items; ++i) {
+        batch_cost += items[i].cost;
+        if (i + 1 == nb_items || items[i + 1].band != items[i].band ||
+                batch_cost + items[i + 1].cost > max_batch_cost) {
+            if (!opj_t1_submit_cblk_decode_batch(tp, &job_template,
+                                                 items + first_item,
+                                                 i + 1 - first_item)) {
+                *pret = OPJ_FALSE;
+                break;
+            }
+            if (!(*pret)) {
+                break;
+            }
+            first_item = i + 1;
+            batch_cost = 0;
+        }
+    }
+}
+
+/** Decode the code-blocks of resolutions [resno_start, resno_end[ of a */
+/** tile component, submitting the jobs to tp */
+static void opj_t1_decode_cblks_internal(opj_tcd_t* tcd,
+        opj_thread_pool_t* tp,
+        OPJ_UINT32 resno_start,
+        OPJ_UINT32 resno_end,
+        volatile OPJ_BOOL* pret,
+        opj_tcd_tilecomp_t* tilec,
+        opj_tccp_t* tccp,
+        opj_event_mgr_t *p_manager,
+        opj_mutex_t* p_manager_mutex,
+        OPJ_BOOL check_pterm)
 {
-    opj_thread_pool_t* tp = tcd->thread_pool;
     OPJ_UINT32 resno, bandno, precno, cblkno;
+    opj_t1_cblk_decode_item_t* items = NULL;
+    OPJ_UINT32 nb_items = 0;
+    OPJ_UINT32 nb_items_alloc = 0;
+    OPJ_UINT32 nb_skipped = 0;
+    OPJ_UINT32 nb_cached = 0;
+    OPJ_UINT32 nb_resumed = 0;
+    OPJ_UINT64 total_cost = 0;
 
 #ifdef DEBUG_VERBOSE
-    OPJ_UINT32 codeblocks_decoded = 0;
     printf("Enter opj_t1_decode_cblks()\n");
 #endif
 
-    for (resno = 0; resno < tilec->minimum_num_resolutions; ++resno) {
+    /* Collect the code-blocks to decode */
+    for (resno = resno_start; resno < resno_end; ++resno) {
         opj_tcd_resolution_t* res = &tilec->resolutions[resno];
 
         for (bandno = 0; bandno < res->numbands; ++bandno) {
@@ -1903,6 +2334,7 @@ void opj_t1_decode_cblks(opj_tcd_t* tcd,
                         (OPJ_UINT32)precinct->y0,
                         (OPJ_UINT32)precinct->x1,
                         (OPJ_UINT32)precinct->y1)) {
+                    nb_skipped += precinct->cw * precinct->ch;
                     for (cblkno = 0; cblkno < precinct->cw * precinct->ch; ++cblkno) {
                         opj_tcd_cblk_dec_t* cblk = &precinct->cblks.dec[cblkno];
                         if (cblk->decoded_data) {
@@ -1910,8 +2342,9 @@ void opj_t1_decode_cblks(opj_tcd_t* tcd,
                             printf("Discarding codeblock %d,%d at resno=%d, bandno=%d\n",
                                    cblk->x0, cblk->y0, resno, bandno);
 #endif
-                            opj_aligned_free(cblk->decoded_data);
-                            cblk->decoded_data = NULL;
+                            opj_t1_release_decoded_data(tcd, cblk, tilec->compno,
+                                                        resno, band->bandno,
+                                                        precno, cblkno);
                         }
                     }
                     continue;
@@ -1919,7 +2352,6 @@ void opj_t1_decode_cblks(opj_tcd_t* tcd,
 
                 for (cblkno = 0; cblkno < precinct->cw * precinct->ch; ++cblkno) {
                     opj_tcd_cblk_dec_t* cblk = &precinct->cblks.dec[cblkno];
-                    opj_t1_cblk_decode_processing_job_t* job;
 
                     if (!opj_tcd_is_subband_area_of_interest(tcd,
                             tilec->compno,
@@ -1929,71 +2361,204 @@ void opj_t1_decode_cblks(opj_tcd_t* tcd,
                             (OPJ_UINT32)cblk->y0,
                             (OPJ_UINT32)cblk->x1,
                             (OPJ_UINT32)cblk->y1)) {
+                        nb_skipped ++;
                         if (cblk->decoded_data) {
 #ifdef DEBUG_VERBOSE
                             printf("Discarding codeblock %d,%d at resno=%d, bandno=%d\n",
                                    cblk->x0, cblk->y0, resno, bandno);
 #endif
-                            opj_aligned_free(cblk->decoded_data);
-                            cblk->decoded_data = NULL;
+                            opj_t1_release_decoded_data(tcd, cblk, tilec->compno,
+                                                        resno, band->bandno,
+                                                        precno, cblkno);
                         }
                         continue;
                     }
 
-                    if (!tcd->whole_tile_decoding) {
+                    if (tcd->whole_tile_decoding) {
+                        if (cblk->decoded_data) {
+                            /* Left by a previous decoding of an area */
+                            opj_t1_release_decoded_data(tcd, cblk, tilec->compno,
+                                                        resno, band->bandno,
+                                                        precno, cblkno);
+                        }
+                    } else {
                         OPJ_UINT32 cblk_w = (OPJ_UINT32)(cblk->x1 - cblk->x0);
                         OPJ_UINT32 cblk_h = (OPJ_UINT32)(cblk->y1 - cblk->y0);
+                        OPJ_UINT32 numpasses = opj_t1_get_cblk_numpasses(cblk);
                         if (cblk->decoded_data != NULL) {
+                            if (cblk->decoded_numpasses == numpasses) {
 #ifdef DEBUG_VERBOSE
-                            printf("Reusing codeblock %d,%d at resno=%d, bandno=%d\n",
-                                   cblk->x0, cblk->y0, resno, bandno);
+                                printf("Reusing codeblock %d,%d at resno=%d, bandno=%d\n",
+                                       cblk->x0, cblk->y0, resno, bandno);
 #endif
-                            continue;
+                                nb_skipped ++;
+                                continue;
+                            }
+                            /* Decoded with another number of quality layers */
+                            opj_t1_release_decoded_data(tcd, cblk, tilec->compno,
+                                                        resno, band->bandno,
+                                                        precno, cblkno);
                         }
                         if (cblk_w == 0 || cblk_h == 0) {
+                            nb_skipped ++;
                             continue;
                         }
+                        cblk->decoded_numpasses = numpasses;
+                        /* The coefficients kept by the inverse wavelet */
+                        /* transform are not valid anymore */
+                        if (resno < tilec->dwt_numres) {
+                            opj_tcd_release_dwt_state(tilec);
+                        }
+                        if (tcd->cblk_cache != NULL) {
+                            opj_cblk_cache_key_t key;
+                            opj_tcd_get_cblk_cache_key(tcd, tilec->compno, resno,
+                                                       band->bandno, precno,
+                                                       cblkno, numpasses, &key);
+                            cblk->decoded_data = opj_cblk_cache_take(
+                                                     tcd->cblk_cache, &key,
+                                                     (OPJ_SIZE_T)cblk_w * cblk_h);
+                            if (cblk->decoded_data != NULL) {
+                                nb_cached ++;
+                                continue;
+                            }
+                        }
+                        if (tcd->refinable && opj_t1_can_resume_dec(cblk, numpasses)) {
+                            nb_resumed ++;
+                        }
 #ifdef DEBUG_VERBOSE
                         printf("Decoding codeblock %d,%d at resno=%d, bandno=%d\n",
                                cblk->x0, cblk->y0, resno, bandno);
 #endif
                     }
 
-                    job = (opj_t1_cblk_decode_processing_job_t*) opj_calloc(1,
-                            sizeof(opj_t1_cblk_decode_processing_job_t));
-                    if (!job) {
-                        *pret = OPJ_FALSE;
-                        return;
-                    }
-                    job->whole_tile_decoding = tcd->whole_tile_decoding;
-                    job->resno = resno;
-                    job->cblk = cblk;
-                    job->band = band;
-                    job->tilec = tilec;
-                    job->tccp = tccp;
-                    job->pret = pret;
-                    job->p_manager_mutex = p_manager_mutex;
-                    job->p_manager = p_manager;
-                    job->check_pterm = check_pterm;
-                    job->mustuse_cblkdatabuffer = opj_thread_pool_get_thread_count(tp) > 1;
-                    opj_thread_pool_submit_job(tp, opj_t1_clbl_decode_processor, job);
-#ifdef DEBUG_VERBOSE
-                    codeblocks_decoded ++;
-#endif
-                    if (!(*pret)) {
-                        return;
+                    if (nb_items == nb_items_alloc) {
+                        opj_t1_cblk_decode_item_t* new_items;
+                        nb_items_alloc = nb_items_alloc ? 2 * nb_items_alloc : 64;
+                        new_items = (opj_t1_cblk_decode_item_t*) opj_realloc(items,
+                                    nb_items_alloc * sizeof(opj_t1_cblk_decode_item_t));
+                        if (!new_items) {
+                            opj_free(items);
+                            *pret = OPJ_FALSE;
+                            return;
+                        }
+                        items = new_items;
                     }
+                    items[nb_items].cblk = cblk;
+                    items[nb_items].band = band;
+                    items[nb_items].resno = resno;
+                    items[nb_items].cost = opj_t1_estimate_cblk_decode_cost(cblk);
+                    total_cost += items[nb_items].cost;
+                    nb_items ++;
                 } /* cblkno */
             } /* precno */
         } /* bandno */
     } /* resno */
 
+    if (tcd->stats) {
+        tcd->stats->codeblocks_decoded += nb_items;
+        tcd->stats->codeblocks_skipped += nb_skipped;
+        tcd->stats->codeblocks_cached += nb_cached;
+        tcd->stats->codeblocks_resumed += nb_resumed;
+    }
+
+    opj_t1_submit_cblk_decode_items(tcd, tp, items, nb_items, total_cost,
+                                    pret, tilec, tccp, p_manager,
+                                    p_manager_mutex, check_pterm);
+
+    opj_free(items);
+
 #ifdef DEBUG_VERBOSE
-    printf("Leave opj_t1_decode_cblks(). Number decoded: %d\n", codeblocks_decoded);
+    printf("Leave opj_t1_decode_cblks(). Number decoded: %d\n", nb_items);
 #endif
     return;
 }
 
+void opj_t1_decode_cblks(opj_tcd_t* tcd,
+                         volatile OPJ_BOOL* pret,
+                         opj_tcd_tilecomp_t* tilec,
+                         opj_tccp_t* tccp,
+                         opj_event_mgr_t *p_manager,
+                         opj_mutex_t* p_manager_mutex,
+                         OPJ_BOOL check_pterm
+                        )
+{
+    opj_t1_decode_cblks_internal(tcd, tcd->thread_pool,
+                                 0, tilec->minimum_num_resolutions,
+                                 pret, tilec, tccp,
+                                 p_manager, p_manager_mutex, check_pterm);
+}
+
+void opj_t1_decode_cblks_resolution(opj_tcd_t* tcd,
+                                    opj_thread_pool_t* tp,
+                                    OPJ_UINT32 resno,
+                                    volatile OPJ_BOOL* pret,
+                                    opj_tcd_tilecomp_t* tilec,
+                                    opj_tccp_t* tccp,
+                                    opj_event_mgr_t *p_manager,
+                                    opj_mutex_t* p_manager_mutex,
+                                    OPJ_BOOL check_pterm)
+{
+    opj_t1_decode_cblks_internal(tcd, tp, resno, resno + 1,
+                                 pret, tilec, tccp,
+                                 p_manager, p_manager_mutex, check_pterm);
+}
+
+void opj_t1_decode_cblks_list(opj_tcd_t* tcd,
+                              volatile OPJ_BOOL* pret,
+                              opj_tcd_tilecomp_t* tilec,
+                              opj_tccp_t* tccp,
+                              OPJ_UINT32 resno,
+                              opj_tcd_band_t* band,
+                              opj_tcd_cblk_dec_t** cblks,
+                              OPJ_UINT32 nb_cblks,
+                              opj_event_mgr_t *p_manager,
+                              opj_mutex_t* p_manager_mutex,
+                              OPJ_BOOL check_pterm)
+{
+    opj_t1_cblk_decode_item_t* items;
+    OPJ_UINT32 nb_items = 0;
+    OPJ_UINT32 nb_skipped = 0;
+    OPJ_UINT64 total_cost = 0;
+    OPJ_UINT32 i;
+
+    assert(!tcd->whole_tile_decoding);
+    if (nb_cblks == 0) {
+        return;
+    }
+    items = (opj_t1_cblk_decode_item_t*) opj_malloc(nb_cblks *
+            sizeof(opj_t1_cblk_decode_item_t));
+    if (!items) {
+        *pret = OPJ_FALSE;
+        return;
+    }
+    for (i = 0; i < nb_cblks; ++i) {
+        opj_tcd_cblk_dec_t* cblk = cblks[i];
+
+        assert(cblk->decoded_data == NULL);
+        if (cblk->x1 == cblk->x0 || cblk->y1 == cblk->y0) {
+            nb_skipped ++;
+            continue;
+        }
+        cblk->decoded_numpasses = opj_t1_get_cblk_numpasses(cblk);
+        items[nb_items].cblk = cblk;
+        items[nb_items].band = band;
+        items[nb_items].resno = resno;
+        items[nb_items].cost = opj_t1_estimate_cblk_decode_cost(cblk);
+        total_cost += items[nb_items].cost;
+        nb_items ++;
+    }
+
+    if (tcd->stats) {
+        tcd->stats->codeblocks_decoded += nb_items;
+        tcd->stats->codeblocks_skipped += nb_skipped;
+    }
+
+    opj_t1_submit_cblk_decode_items(tcd, tcd->thread_pool, items, nb_items,
+                                    total_cost, pret, tilec, tccp, p_manager,
+                                    p_manager_mutex, check_pterm);
+    opj_free(items);
+}
+
 
 static OPJ_BOOL opj_t1_decode_cblk(opj_t1_t *t1,
                                    opj_tcd_cblk_dec_t* cblk,
@@ -2013,6 +2578,11 @@ static OPJ_BOOL opj_t1_decode_cblk(opj_t1_t *t1,
     OPJ_UINT32 cblkdataindex = 0;
     OPJ_BYTE type = T1_TYPE_MQ; /* BYPASS mode */
     OPJ_INT32* original_t1_data = NULL;
+    /* Number of passes decoded, and of passes to decode */
+    OPJ_UINT32 numpasses = 0;
+    OPJ_UINT32 totalpasses = 0;
+    const opj_tcd_cblk_dec_state_t* state = NULL;
+    OPJ_BOOL keep_dec_state = t1->keep_dec_state && cblk->decoded_data != NULL;
 
     mqc->lut_ctxno_zc_orient = lut_ctxno_zc + (orient << 9);
 
@@ -2096,23 +2666,51 @@ static OPJ_BOOL opj_t1_decode_cblk(opj_t1_t *t1,
         t1->data = cblk->decoded_data;
     }
 
-    for (segno = 0; segno < cblk->real_num_segs; ++segno) {
+    segno = 0;
+    passno = 0;
+    if (keep_dec_state) {
+        totalpasses = opj_t1_get_cblk_numpasses(cblk);
+        if (opj_t1_can_resume_dec(cblk, totalpasses)) {
+            /* Resume from the state left by the previous decoding */
+            state = cblk->dec_state;
+            memcpy(t1->data, state->data,
+                   (OPJ_SIZE_T)t1->w * t1->h * sizeof(OPJ_INT32));
+            memcpy(t1->flags, state->flags, t1->flagssize * sizeof(opj_flag_t));
+            opj_mqc_restorestates(mqc, &(state->mqc));
+            numpasses = state->numpasses;
+            passno = state->passno;
+            bpno_plus_one = state->bpno_plus_one;
+            passtype = state->passtype;
+            for (; segno < state->segno; ++segno) {
+                cblkdataindex += cblk->segs[segno].len;
+            }
+        }
+    }
+
+    for (; segno < cblk->real_num_segs; ++segno, passno = 0) {
         opj_tcd_seg_t *seg = &cblk->segs[segno];
 
-        /* BYPASS mode */
-        type = ((bpno_plus_one <= ((OPJ_INT32)(cblk->numbps)) - 4) && (passtype < 2) &&
-                (cblksty & J2K_CCP_CBLKSTY_LAZY)) ? T1_TYPE_RAW : T1_TYPE_MQ;
+        if (passno > 0) {
+            /* Resume the segment after the bytes read by its first passes */
+            type = state->raw ? T1_TYPE_RAW : T1_TYPE_MQ;
+            opj_mqc_resume_dec(mqc, cblkdata + cblkdataindex, seg->len,
+                               OPJ_COMMON_CBLK_DATA_EXTRA, &(state->mqc));
+        } else {
+            /* BYPASS mode */
+            type = ((bpno_plus_one <= ((OPJ_INT32)(cblk->numbps)) - 4) && (passtype < 2) &&
+                    (cblksty & J2K_CCP_CBLKSTY_LAZY)) ? T1_TYPE_RAW : T1_TYPE_MQ;
 
-        if (type == T1_TYPE_RAW) {
-            opj_mqc_raw_init_dec(mqc, cblkdata + cblkdataindex, seg->len,
+            if (type == T1_TYPE_RAW) {
+                opj_mqc_raw_init_dec(mqc, cblkdata + cblkdataindex, seg->len,
+                                     OPJ_COMMON_CBLK_DATA_EXTRA);
+            } else {
+                opj_mqc_init_dec(mqc, cblkdata + cblkdataindex, seg->len,
                                  OPJ_COMMON_CBLK_DATA_EXTRA);
-        } else {
-            opj_mqc_init_dec(mqc, cblkdata + cblkdataindex, seg->len,
-                             OPJ_COMMON_CBLK_DATA_EXTRA);
+            }
         }
         cblkdataindex += seg->len;
 
-        for (passno = 0; (passno < seg->real_num_passes) &&
+        for (; (passno < seg->real_num_passes) &&
                 (bpno_plus_one >= 1); ++passno) {
             switch (passtype) {
             case 0:
@@ -2144,6 +2742,14 @@ static OPJ_BOOL opj_t1_decode_cblk(opj_t1_t *t1,
                 passtype = 0;
                 bpno_plus_one--;
             }
+
+            /* Save the state after the last pass, so that the decoding */
+            /* can be resumed from there with more quality layers */
+            if (keep_dec_state && ++numpasses == totalpasses) {
+                opj_t1_save_dec_state(t1, cblk, numpasses, segno, passno + 1,
+                                      type == T1_TYPE_RAW, bpno_plus_one,
+                                      passtype);
+            }
         }
 
         opq_mqc_finish_dec(mqc);
@@ -2194,6 +2800,8 @@ typedef struct {
     opj_tccp_t* tccp;
     const OPJ_FLOAT64 * mct_norms;
     OPJ_UINT32 mct_numcomps;
+    /** Whether the rate allocation may truncate the code-block */
+    OPJ_BOOL truncate;
     volatile OPJ_BOOL* pret;
     opj_mutex_t* mutex;
 } opj_t1_cblk_encode_processing_job_t;
@@ -2257,7 +2865,34 @@ static void opj_t1_cblk_encode_processor(void* user_data, opj_tls_t* tls)
 
     tiledp = &tilec->data[(OPJ_SIZE_T)y * tile_w + (OPJ_SIZE_T)x];
 
+    if (tccp->cblksty & J2K_CCP_CBLKSTY_HT) {
+        OPJ_FLOAT64 cumwmsedec = 0.0;
+        if (!opj_t1_encode_ht_cblk(t1, cblk, band, tiledp, tile_w,
+                                   job->compno,
+                                   tilec->numresolutions - 1 - resno,
+                                   tccp->qmfbid,
+                                   job->truncate,
+                                   job->tile->numcomps,
+                                   job->mct_norms,
+                                   job->mct_numcomps,
+                                   &cumwmsedec)) {
+            *(job->pret) = OPJ_FALSE;
+            opj_free(job);
+            return;
+        }
+        if (job->mutex) {
+            opj_mutex_lock(job->mutex);
+        }
+        job->tile->distotile += cumwmsedec;
+        if (job->mutex) {
+            opj_mutex_unlock(job->mutex);
+        }
+        opj_free(job);
+        return;
+    }
+
     if (tccp->qmfbid == 1) {
+        const opj_t1_kernels_t* kernels = opj_t1_get_kernels();
         /* Do multiplication on unsigned type, even if the
             * underlying type is signed, to avoid potential
             * int overflow on large value (the output will be
@@ -2270,119 +2905,9 @@ static void opj_t1_cblk_encode_processor(void* user_data, opj_tls_t* tls)
         OPJ_UINT32* OPJ_RESTRICT t1data = (OPJ_UINT32*) t1->data;
         /* Change from "natural" order to "zigzag" order of T1 passes */
         for (j = 0; j < (cblk_h & ~3U); j += 4) {
-#if defined(__AVX512F__)
-            const __m512i perm1 = _mm512_setr_epi64(2, 3, 10, 11, 4, 5, 12, 13);
-            const __m512i perm2 = _mm512_setr_epi64(6, 7, 14, 15, 0, 0, 0, 0);
-            OPJ_UINT32* ptr = tiledp_u;
-            for (i = 0; i < cblk_w / 16; ++i) {
-                //                      INPUT                                        OUTPUT
-                // 00 01 02 03 04 05 06 07 08 09 0A 0B 0C 0D 0E 0F   00 10 20 30 01 11 21 31 02 12 22 32 03 13 23 33
-                // 10 11 12 13 14 15 16 17 18 19 1A 1B 1C 1D 1E 1F   04 14 24 34 05 15 25 35 06 16 26 36 07 17 27 37
-                // 20 21 22 23 24 25 26 27 28 29 2A 2B 2C 2D 2E 2F   08 18 28 38 09 19 29 39 0A 1A 2A 3A 0B 1B 2B 3B
-                // 30 31 32 33 34 35 36 37 38 39 3A 3B 3C 3D 3E 3F   0C 1C 2C 3C 0D 1D 2D 3D 0E 1E 2E 3E 0F 1F 2F 3F
-                __m512i in1 = _mm512_slli_epi32(_mm512_loadu_si512((__m512i*)(ptr +
-                                                (j + 0) * tile_w)), T1_NMSEDEC_FRACBITS);
-                __m512i in2 = _mm512_slli_epi32(_mm512_loadu_si512((__m512i*)(ptr +
-                                                (j + 1) * tile_w)), T1_NMSEDEC_FRACBITS);
-                __m512i in3 = _mm512_slli_epi32(_mm512_loadu_si512((__m512i*)(ptr +
-                                                (j + 2) * tile_w)), T1_NMSEDEC_FRACBITS);
-                __m512i in4 = _mm512_slli_epi32(_mm512_loadu_si512((__m512i*)(ptr +
-                                                (j + 3) * tile_w)), T1_NMSEDEC_FRACBITS);
-
-                __m512i tmp1 = _mm512_unpacklo_epi32(in1, in2);
-                __m512i tmp2 = _mm512_unpacklo_epi32(in3, in4);
-                __m512i tmp3 = _mm512_unpackhi_epi32(in1, in2);
-                __m512i tmp4 = _mm512_unpackhi_epi32(in3, in4);
-
-                in1 = _mm512_unpacklo_epi64(tmp1, tmp2);
-                in2 = _mm512_unpacklo_epi64(tmp3, tmp4);
-                in3 = _mm512_unpackhi_epi64(tmp1, tmp2);
-                in4 = _mm512_unpackhi_epi64(tmp3, tmp4);
-
-                _mm_storeu_si128((__m128i*)(t1data + 0), _mm512_castsi512_si128(in1));
-                _mm_storeu_si128((__m128i*)(t1data + 4), _mm512_castsi512_si128(in3));
-                _mm_storeu_si128((__m128i*)(t1data + 8), _mm512_castsi512_si128(in2));
-                _mm_storeu_si128((__m128i*)(t1data + 12), _mm512_castsi512_si128(in4));
-
-                tmp1 = _mm512_permutex2var_epi64(in1, perm1, in3);
-                tmp2 = _mm512_permutex2var_epi64(in2, perm1, in4);
-
-                _mm256_storeu_si256((__m256i*)(t1data + 16), _mm512_castsi512_si256(tmp1));
-                _mm256_storeu_si256((__m256i*)(t1data + 24), _mm512_castsi512_si256(tmp2));
-                _mm256_storeu_si256((__m256i*)(t1data + 32), _mm512_extracti64x4_epi64(tmp1,
-                                    0x1));
-                _mm256_storeu_si256((__m256i*)(t1data + 40), _mm512_extracti64x4_epi64(tmp2,
-                                    0x1));
-                _mm256_storeu_si256((__m256i*)(t1data + 48),
-                                    _mm512_castsi512_si256(_mm512_permutex2var_epi64(in1, perm2, in3)));
-                _mm256_storeu_si256((__m256i*)(t1data + 56),
-                                    _mm512_castsi512_si256(_mm512_permutex2var_epi64(in2, perm2, in4)));
-                t1data += 64;
-                ptr += 16;
-            }
-            for (i = 0; i < cblk_w % 16; ++i) {
-                t1data[0] = ptr[(j + 0) * tile_w] << T1_NMSEDEC_FRACBITS;
-                t1data[1] = ptr[(j + 1) * tile_w] << T1_NMSEDEC_FRACBITS;
-                t1data[2] = ptr[(j + 2) * tile_w] << T1_NMSEDEC_FRACBITS;
-                t1data[3] = ptr[(j + 3) * tile_w] << T1_NMSEDEC_FRACBITS;
-                t1data += 4;
-                ptr += 1;
-            }
-#elif defined(__AVX2__)
-            OPJ_UINT32* ptr = tiledp_u;
-            for (i = 0; i < cblk_w / 8; ++i) {
-                //          INPUT                  OUTPUT
-                // 00 01 02 03 04 05 06 07   00 10 20 30 01 11 21 31
-                // 10 11 12 13 14 15 16 17   02 12 22 32 03 13 23 33
-                // 20 21 22 23 24 25 26 27   04 14 24 34 05 15 25 35
-                // 30 31 32 33 34 35 36 37   06 16 26 36 07 17 27 37
-                __m256i in1 = _mm256_slli_epi32(_mm256_loadu_si256((__m256i*)(ptr +
-                                                (j + 0) * tile_w)), T1_NMSEDEC_FRACBITS);
-                __m256i in2 = _mm256_slli_epi32(_mm256_loadu_si256((__m256i*)(ptr +
-                                                (j + 1) * tile_w)), T1_NMSEDEC_FRACBITS);
-                __m256i in3 = _mm256_slli_epi32(_mm256_loadu_si256((__m256i*)(ptr +
-                                                (j + 2) * tile_w)), T1_NMSEDEC_FRACBITS);
-                __m256i in4 = _mm256_slli_epi32(_mm256_loadu_si256((__m256i*)(ptr +
-                                                (j + 3) * tile_w)), T1_NMSEDEC_FRACBITS);
-
-                __m256i tmp1 = _mm256_unpacklo_epi32(in1, in2);
-                __m256i tmp2 = _mm256_unpacklo_epi32(in3, in4);
-                __m256i tmp3 = _mm256_unpackhi_epi32(in1, in2);
-                __m256i tmp4 = _mm256_unpackhi_epi32(in3, in4);
-
-                in1 = _mm256_unpacklo_epi64(tmp1, tmp2);
-                in2 = _mm256_unpacklo_epi64(tmp3, tmp4);
-                in3 = _mm256_unpackhi_epi64(tmp1, tmp2);
-                in4 = _mm256_unpackhi_epi64(tmp3, tmp4);
-
-                _mm_storeu_si128((__m128i*)(t1data + 0), _mm256_castsi256_si128(in1));
-                _mm_storeu_si128((__m128i*)(t1data + 4), _mm256_castsi256_si128(in3));
-                _mm_storeu_si128((__m128i*)(t1data + 8), _mm256_castsi256_si128(in2));
-                _mm_storeu_si128((__m128i*)(t1data + 12), _mm256_castsi256_si128(in4));
-                _mm256_storeu_si256((__m256i*)(t1data + 16), _mm256_permute2x128_si256(in1, in3,
-                                    0x31));
-                _mm256_storeu_si256((__m256i*)(t1data + 24), _mm256_permute2x128_si256(in2, in4,
-                                    0x31));
-                t1data += 32;
-                ptr += 8;
-            }
-            for (i = 0; i < cblk_w % 8; ++i) {
-                t1data[0] = ptr[(j + 0) * tile_w] << T1_NMSEDEC_FRACBITS;
-                t1data[1] = ptr[(j + 1) * tile_w] << T1_NMSEDEC_FRACBITS;
-                t1data[2] = ptr[(j + 2) * tile_w] << T1_NMSEDEC_FRACBITS;
-                t1data[3] = ptr[(j + 3) * tile_w] << T1_NMSEDEC_FRACBITS;
-                t1data += 4;
-                ptr += 1;
-            }
-#else
-            for (i = 0; i < cblk_w; ++i) {
-                t1data[0] = tiledp_u[(j + 0) * tile_w + i] << T1_NMSEDEC_FRACBITS;
-                t1data[1] = tiledp_u[(j + 1) * tile_w + i] << T1_NMSEDEC_FRACBITS;
-                t1data[2] = tiledp_u[(j + 2) * tile_w + i] << T1_NMSEDEC_FRACBITS;
-                t1data[3] = tiledp_u[(j + 3) * tile_w + i] << T1_NMSEDEC_FRACBITS;
-                t1data += 4;
-            }
-#endif
+            kernels->encode_rev_stripe(t1data, tiledp_u + j * tile_w, cblk_w,
+                                       tile_w);
+            t1data += 4 * cblk_w;
         }
         if (j < cblk_h) {
             for (i = 0; i < cblk_w; ++i) {
@@ -2448,6 +2973,23 @@ static void opj_t1_cblk_encode_processor(void* user_data, opj_tls_t* tls)
     opj_free(job);
 }
 
+/** Returns whether the rate allocation may truncate the code-blocks, that */
+/** is whether a layer has a rate or a quality target */
+static OPJ_BOOL opj_t1_enc_may_truncate(const opj_cp_t* cp,
+                                        const opj_tcp_t* tcp)
+{
+    OPJ_UINT32 layno;
+
+    for (layno = 0; layno < tcp->numlayers; ++layno) {
+        if ((cp->m_specific_param.m_enc.m_quality_layer_alloc_strategy ==
+                RATE_DISTORTION_RATIO && tcp->rates[layno] > 0.0f) ||
+                (cp->m_specific_param.m_enc.m_quality_layer_alloc_strategy ==
+                 FIXED_DISTORTION_RATIO && tcp->distoratio[layno] > 0.0f)) {
+            return OPJ_TRUE;
+        }
+    }
+    return OPJ_FALSE;
+}
 
 OPJ_BOOL opj_t1_encode_cblks(opj_tcd_t* tcd,
                              opj_tcd_tile_t *tile,
@@ -2460,6 +3002,7 @@ OPJ_BOOL opj_t1_encode_cblks(opj_tcd_t* tcd,
     opj_thread_pool_t* tp = tcd->thread_pool;
     OPJ_UINT32 compno, resno, bandno, precno, cblkno;
     opj_mutex_t* mutex = opj_mutex_create();
+    const OPJ_BOOL truncate = opj_t1_enc_may_truncate(tcd->cp, tcp);
 
     tile->distotile = 0;
 
@@ -2499,6 +3042,7 @@ OPJ_BOOL opj_t1_encode_cblks(opj_tcd_t* tcd,
                         job->tccp = tccp;
                         job->mct_norms = mct_norms;
                         job->mct_numcomps = mct_numcomps;
+                        job->truncate = truncate;
                         job->pret = &ret;
                         job->mutex = mutex;
                         opj_thread_pool_submit_job(tp, opj_t1_cblk_encode_processor, job);
@@ -2518,6 +3062,138 @@ end:
     return ret;
 }
 
+/** Grows the data buffer of a code-block to at least size bytes, keeping */
+/** its content */
+static OPJ_BOOL opj_t1_enc_grow_data(opj_tcd_cblk_enc_t* cblk,
+                                     OPJ_UINT32 size)
+{
+    OPJ_BYTE* data;
+
+    if (size <= cblk->data_size) {
+        return OPJ_TRUE;
+    }
+    size = opj_uint_max(size, 2 * cblk->data_size);
+    /* The byte before data is reserved, see */
+    /* opj_tcd_code_block_enc_allocate_data() */
+    data = (OPJ_BYTE*) opj_realloc(cblk->data - 1, (size_t)size + 1);
+    if (!data) {
+        return OPJ_FALSE;
+    }
+    cblk->data = data + 1;
+    cblk->data_size = size;
+    return OPJ_TRUE;
+}
+
+static OPJ_BOOL opj_t1_encode_ht_cblk(opj_t1_t *t1,
+                                      opj_tcd_cblk_enc_t* cblk,
+                                      const opj_tcd_band_t* band,
+                                      const OPJ_INT32* tiledp,
+                                      OPJ_UINT32 tile_w,
+                                      OPJ_UINT32 compno,
+                                      OPJ_UINT32 level,
+                                      OPJ_UINT32 qmfbid,
+                                      OPJ_BOOL truncate,
+                                      OPJ_UINT32 numcomps,
+                                      const OPJ_FLOAT64 * mct_norms,
+                                      OPJ_UINT32 mct_numcomps,
+                                      OPJ_FLOAT64 *p_cumwmsedec)
+{
+    OPJ_INT32* OPJ_RESTRICT t1data = t1->data;
+    /* Decrease of the squared error, in quantization step units, when the */
+    /* samples are coded from each bit-plane */
+    OPJ_FLOAT64 gain[32];
+    OPJ_FLOAT64 weight;
+    /* Size reserved for each truncation point, as for a whole MQ code-block */
+    const OPJ_UINT32 max_len = cblk->data_size;
+    OPJ_UINT32 max_mu = 0;
+    OPJ_UINT32 offset = 0;
+    OPJ_UINT32 numbps, bpno, passno;
+    OPJ_UINT32 i, j;
+
+    *p_cumwmsedec = 0.0;
+    memset(gain, 0, sizeof(gain));
+
+    /* Unlike the MQ coder, the HT coder works on raster-ordered integer */
+    /* quantization indices. */
+    for (j = 0; j < t1->h; ++j) {
+        for (i = 0; i < t1->w; ++i) {
+            OPJ_INT32 tmp;
+            OPJ_UINT32 mu;
+            OPJ_FLOAT64 a;
+
+            if (qmfbid == 1) {
+                tmp = tiledp[(OPJ_SIZE_T)j * tile_w + i];
+                mu = (OPJ_UINT32)(tmp < 0 ? -tmp : tmp);
+                a = (OPJ_FLOAT64)mu;
+            } else {
+                const OPJ_FLOAT32* tiledp_f = (const OPJ_FLOAT32*) tiledp;
+                tmp = (OPJ_INT32)opj_lrintf((tiledp_f[(OPJ_SIZE_T)j * tile_w + i] /
+                                             band->stepsize) * (1 << T1_NMSEDEC_FRACBITS));
+                mu = (OPJ_UINT32)(tmp < 0 ? -tmp : tmp);
+                a = (OPJ_FLOAT64)mu / (1 << T1_NMSEDEC_FRACBITS);
+                mu >>= T1_NMSEDEC_FRACBITS;
+            }
+            max_mu = opj_uint_max(max_mu, mu);
+            /* The decoder reconstructs the samples coded from bit-plane */
+            /* bpno at the mid-point of their bin, except for reversible */
+            /* samples coded from bit-plane 0 */
+            for (bpno = 0; (mu >> bpno) != 0; ++bpno) {
+                OPJ_FLOAT64 r = (OPJ_FLOAT64)(mu >> bpno);
+                if (qmfbid != 1 || bpno != 0) {
+                    r = (r + 0.5) * (OPJ_FLOAT64)(1U << bpno);
+                }
+                gain[bpno] += a * a - (a - r) * (a - r);
+            }
+            *t1data++ = tmp < 0 ? -(OPJ_INT32)mu : (OPJ_INT32)mu;
+        }
+    }
+
+    if (max_mu == 0) {
+        cblk->numbps = 0;
+        cblk->totalpasses = 0;
+        return OPJ_TRUE;
+    }
+    /* 2 * mu + 1 must fit in 31 bits for the decoder */
+    if (max_mu >= (1U << 30)) {
+        return OPJ_FALSE;
+    }
+    numbps = opj_uint_floorlog2(max_mu) + 1;
+
+    /* opj_t1_getwmsedec() divides nmsedec by 8192 */
+    weight = 8192.0 * opj_t1_getwmsedec(1, compno, level, band->bandno, 0,
+                                        qmfbid, band->stepsize, numcomps,
+                                        mct_norms, mct_numcomps);
+
+    /* One truncation point per bit-plane, from the most significant one. */
+    /* Without rate allocation, only bit-plane 0 is coded. */
+    passno = 0;
+    for (bpno = truncate ? numbps : 1; bpno-- > 0;) {
+        opj_tcd_pass_t* pass = &cblk->passes[passno];
+        OPJ_UINT32 len;
+
+        if (!opj_t1_enc_grow_data(cblk, offset + max_len) ||
+                !opj_t1_ht_encode_cblk(t1, bpno, cblk->data + offset,
+                                       cblk->data_size - offset, &len)) {
+            return OPJ_FALSE;
+        }
+        /* The truncation points are alternatives: the rate of each one is */
+        /* its own length, kept non-decreasing for the rate allocation */
+        pass->rate = passno ? opj_uint_max(len, cblk->passes[passno - 1].rate) :
+                     len;
+        pass->len = len;
+        pass->term = 1;
+        pass->distortiondec = gain[bpno] * weight;
+        offset += len;
+        ++passno;
+    }
+    cblk->totalpasses = passno;
+    /* Set by the rate allocation to the bit-plane of the truncation point, */
+    /* plus 1 */
+    cblk->numbps = 1;
+    *p_cumwmsedec = cblk->passes[passno - 1].distortiondec;
+    return OPJ_TRUE;
+}
+
 /* Returns whether the pass (bpno, passtype) is terminated */
 static int opj_t1_enc_is_term_pass(opj_tcd_cblk_enc_t* cblk,
                                    OPJ_UINT32 cblksty,
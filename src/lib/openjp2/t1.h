@@ -200,13 +200,16 @@ typedef struct opj_t1 {
     OPJ_UINT32 flagssize;
     OPJ_BOOL   encoder;
 
-    /* The 3 variables below are only used by the decoder */
+    /* The 4 variables below are only used by the decoder */
     /* set to TRUE in multithreaded context */
     OPJ_BOOL     mustuse_cblkdatabuffer;
     /* Temporary buffer to concatenate all chunks of a codebock */
     OPJ_BYTE    *cblkdatabuffer;
     /* Maximum size available in cblkdatabuffer */
     OPJ_UINT32   cblkdatabuffersize;
+    /* set to TRUE to save the decoding state of the code-blocks decoded */
+    /* into their decoded_data, and to resume from it */
+    OPJ_BOOL     keep_dec_state;
 } opj_t1_t;
 
 /** @name Exported functions */
@@ -245,7 +248,69 @@ void opj_t1_decode_cblks(opj_tcd_t* tcd,
                          opj_mutex_t* p_manager_mutex,
                          OPJ_BOOL check_pterm);
 
+/**
+Decode the code-blocks of a resolution level of a tile, when decoding a whole
+tile. The jobs are submitted to tp, which is typically a view of the thread
+pool of the TCD, so that the caller can wait for the completion of that
+resolution level only.
+@param tcd TCD handle
+@param tp Thread pool to which decoding jobs are submitted
+@param resno Resolution level
+@param pret Pointer to return value
+@param tilec The tile to decode
+@param tccp Tile coding parameters
+@param p_manager the event manager
+@param p_manager_mutex mutex for the event manager
+@param check_pterm whether PTERM correct termination should be checked
+*/
+void opj_t1_decode_cblks_resolution(opj_tcd_t* tcd,
+                                    opj_thread_pool_t* tp,
+                                    OPJ_UINT32 resno,
+                                    volatile OPJ_BOOL* pret,
+                                    opj_tcd_tilecomp_t* tilec,
+                                    opj_tccp_t* tccp,
+                                    opj_event_mgr_t *p_manager,
+                                    opj_mutex_t* p_manager_mutex,
+                                    OPJ_BOOL check_pterm);
+
+/**
+Decode some code-blocks of a band, when not decoding a whole tile. The jobs
+are submitted to the thread pool of the TCD, and the caller must wait for
+their completion. The decoded samples are in the decoded_data of the
+code-blocks.
+@param tcd TCD handle
+@param pret Pointer to return value
+@param tilec The tile to decode
+@param tccp Tile coding parameters
+@param resno Resolution level of the band
+@param band Band of the code-blocks
+@param cblks Code-blocks to decode, without decoded_data
+@param nb_cblks Number of code-blocks
+@param p_manager the event manager
+@param p_manager_mutex mutex for the event manager
+@param check_pterm whether PTERM correct termination should be checked
+*/
+void opj_t1_decode_cblks_list(opj_tcd_t* tcd,
+                              volatile OPJ_BOOL* pret,
+                              opj_tcd_tilecomp_t* tilec,
+                              opj_tccp_t* tccp,
+                              OPJ_UINT32 resno,
+                              opj_tcd_band_t* band,
+                              opj_tcd_cblk_dec_t** cblks,
+                              OPJ_UINT32 nb_cblks,
+                              opj_event_mgr_t *p_manager,
+                              opj_mutex_t* p_manager_mutex,
+                              OPJ_BOOL check_pterm);
+
 
+/**
+Get the decoding state of a code-block, allocating it if it has none.
+@param cblk Code-block
+@param flagssize Number of opj_flag_t of the flags of the decoder to save
+@return the decoding state, or NULL in case of memory allocation failure
+*/
+opj_tcd_cblk_dec_state_t* opj_t1_get_cblk_dec_state(opj_tcd_cblk_dec_t*
+        cblk, OPJ_UINT32 flagssize);
 
 /**
  * Creates a new Tier 1 handle
@@ -0,0 +1,157 @@
+/*
+ * The copyright in this software is being made available under the 2-clauses
+ * BSD License, included below. This software may be subject to other third
+ * party and contributor rights, including patent rights, and no such rights
+ * are granted under this license.
+ *
+ * Copyright (c) 2002-2014, Universite catholique de Louvain (UCL), Belgium
+ * Copyright (c) 2002-2014, Professor Benoit Macq
+ * Copyright (c) 2001-2003, David Janssens
+ * Copyright (c) 2002-2003, Yannick Verschueren
+ * Copyright (c) 2003-2007, Francois-Olivier Devaux
+ * Copyright (c) 2003-2014, Antonin Descampe
+ * Copyright (c) 2005, Herve Drolon, FreeImage Team
+ * Copyright (c) 2007, Callum Lerwick <seg@haxxed.com>
+ * Copyright (c) 2012, Carl Hetherington
+ * Copyright (c) 2017, IntoPIX SA <support@intopix.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS `AS IS'
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#define OPJ_SKIP_POISON
+#include "opj_includes.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#if defined(__GNUC__)
+#pragma GCC poison malloc calloc realloc free
+#endif
+
+#include "t1_kernels.h"
+
+/*
+ * Tier-1 kernels built with the AVX2 compiler flags, and selected at
+ * runtime by t1.c when the host CPU supports them.
+ */
+
+static void opj_t1_decode_rev_row_avx2(OPJ_INT32* OPJ_RESTRICT dst,
+                                       const OPJ_INT32* OPJ_RESTRICT src,
+                                       OPJ_UINT32 len)
+{
+    OPJ_UINT32 i;
+    for (i = 0; i < len / 8; ++i) {
+        __m256i in_avx = _mm256_loadu_si256((const __m256i*)(src));
+        const __m256i add_avx = _mm256_srli_epi32(in_avx, 31);
+        in_avx = _mm256_add_epi32(in_avx, add_avx);
+        _mm256_storeu_si256((__m256i*)(dst), _mm256_srai_epi32(in_avx, 1));
+        src += 8;
+        dst += 8;
+    }
+
+    for (i = 0; i < len % 8; ++i) {
+        dst[i] = src[i] / 2;
+    }
+}
+
+void opj_t1_decode_irrev_dequant_avx2(OPJ_INT32* data,
+                                      OPJ_UINT32 len,
+                                      OPJ_FLOAT32 stepsize)
+{
+    const __m256 ymm_stepsize = _mm256_set1_ps(stepsize);
+    OPJ_UINT32 i = 0;
+    for (; i < (len & ~15U); i += 16) {
+        __m256 ymm0_data = _mm256_cvtepi32_ps(_mm256_loadu_si256((const __m256i*)(
+                                                  data + 0)));
+        __m256 ymm1_data = _mm256_cvtepi32_ps(_mm256_loadu_si256((const __m256i*)(
+                                                  data + 8)));
+        _mm256_storeu_ps((float*)(data + 0), _mm256_mul_ps(ymm0_data, ymm_stepsize));
+        _mm256_storeu_ps((float*)(data + 8), _mm256_mul_ps(ymm1_data, ymm_stepsize));
+        data += 16;
+    }
+    for (; i < len; ++i) {
+        OPJ_FLOAT32 tmp = ((OPJ_FLOAT32)(*data)) * stepsize;
+        memcpy(data, &tmp, sizeof(tmp));
+        data++;
+    }
+}
+
+static void opj_t1_encode_rev_stripe_avx2(OPJ_UINT32* OPJ_RESTRICT t1data,
+        const OPJ_UINT32* OPJ_RESTRICT tiledp,
+        OPJ_UINT32 w,
+        OPJ_SIZE_T stride)
+{
+    const OPJ_UINT32* ptr = tiledp;
+    OPJ_UINT32 i;
+    for (i = 0; i < w / 8; ++i) {
+        //          INPUT                  OUTPUT
+        // 00 01 02 03 04 05 06 07   00 10 20 30 01 11 21 31
+        // 10 11 12 13 14 15 16 17   02 12 22 32 03 13 23 33
+        // 20 21 22 23 24 25 26 27   04 14 24 34 05 15 25 35
+        // 30 31 32 33 34 35 36 37   06 16 26 36 07 17 27 37
+        __m256i in1 = _mm256_slli_epi32(_mm256_loadu_si256((const __m256i*)(ptr +
+                                        0 * stride)), T1_NMSEDEC_FRACBITS);
+        __m256i in2 = _mm256_slli_epi32(_mm256_loadu_si256((const __m256i*)(ptr +
+                                        1 * stride)), T1_NMSEDEC_FRACBITS);
+        __m256i in3 = _mm256_slli_epi32(_mm256_loadu_si256((const __m256i*)(ptr +
+                                        2 * stride)), T1_NMSEDEC_FRACBITS);
+        __m256i in4 = _mm256_slli_epi32(_mm256_loadu_si256((const __m256i*)(ptr +
+                                        3 * stride)), T1_NMSEDEC_FRACBITS);
+
+        __m256i tmp1 = _mm256_unpacklo_epi32(in1, in2);
+        __m256i tmp2 = _mm256_unpacklo_epi32(in3, in4);
+        __m256i tmp3 = _mm256_unpackhi_epi32(in1, in2);
+        __m256i tmp4 = _mm256_unpackhi_epi32(in3, in4);
+
+        in1 = _mm256_unpacklo_epi64(tmp1, tmp2);
+        in2 = _mm256_unpacklo_epi64(tmp3, tmp4);
+        in3 = _mm256_unpackhi_epi64(tmp1, tmp2);
+        in4 = _mm256_unpackhi_epi64(tmp3, tmp4);
+
+        _mm_storeu_si128((__m128i*)(t1data + 0), _mm256_castsi256_si128(in1));
+        _mm_storeu_si128((__m128i*)(t1data + 4), _mm256_castsi256_si128(in3));
+        _mm_storeu_si128((__m128i*)(t1data + 8), _mm256_castsi256_si128(in2));
+        _mm_storeu_si128((__m128i*)(t1data + 12), _mm256_castsi256_si128(in4));
+        _mm256_storeu_si256((__m256i*)(t1data + 16), _mm256_permute2x128_si256(in1, in3,
+                            0x31));
+        _mm256_storeu_si256((__m256i*)(t1data + 24), _mm256_permute2x128_si256(in2, in4,
+                            0x31));
+        t1data += 32;
+        ptr += 8;
+    }
+    for (i = 0; i < w % 8; ++i) {
+        t1data[0] = ptr[0 * stride] << T1_NMSEDEC_FRACBITS;
+        t1data[1] = ptr[1 * stride] << T1_NMSEDEC_FRACBITS;
+        t1data[2] = ptr[2 * stride] << T1_NMSEDEC_FRACBITS;
+        t1data[3] = ptr[3 * stride] << T1_NMSEDEC_FRACBITS;
+        t1data += 4;
+        ptr += 1;
+    }
+}
+
+const opj_t1_kernels_t opj_t1_kernels_avx2 = {
+    opj_t1_decode_rev_row_avx2,
+    opj_t1_decode_irrev_dequant_avx2,
+    opj_t1_encode_rev_stripe_avx2
+};
@@ -0,0 +1,148 @@
+/*
+ * The copyright in this software is being made available under the 2-clauses
+ * BSD License, included below. This software may be subject to other third
+ * party and contributor rights, including patent rights, and no such rights
+ * are granted under this license.
+ *
+ * Copyright (c) 2002-2014, Universite catholique de Louvain (UCL), Belgium
+ * Copyright (c) 2002-2014, Professor Benoit Macq
+ * Copyright (c) 2001-2003, David Janssens
+ * Copyright (c) 2002-2003, Yannick Verschueren
+ * Copyright (c) 2003-2007, Francois-Olivier Devaux
+ * Copyright (c) 2003-2014, Antonin Descampe
+ * Copyright (c) 2005, Herve Drolon, FreeImage Team
+ * Copyright (c) 2007, Callum Lerwick <seg@haxxed.com>
+ * Copyright (c) 2012, Carl Hetherington
+ * Copyright (c) 2017, IntoPIX SA <support@intopix.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS `AS IS'
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#define OPJ_SKIP_POISON
+#include "opj_includes.h"
+
+#if defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+#if defined(__GNUC__)
+#pragma GCC poison malloc calloc realloc free
+#endif
+
+#include "t1_kernels.h"
+
+/*
+ * Tier-1 kernels built with the AVX-512 compiler flags, and selected at
+ * runtime by t1.c when the host CPU supports them. The dequantization
+ * kernel is shared with t1_avx2.c.
+ */
+
+static void opj_t1_decode_rev_row_avx512(OPJ_INT32* OPJ_RESTRICT dst,
+        const OPJ_INT32* OPJ_RESTRICT src,
+        OPJ_UINT32 len)
+{
+    OPJ_UINT32 i;
+    for (i = 0; i < len / 16; ++i) {
+        __m512i in_avx = _mm512_loadu_si512((const __m512i*)(src));
+        const __m512i add_avx = _mm512_srli_epi32(in_avx, 31);
+        in_avx = _mm512_add_epi32(in_avx, add_avx);
+        _mm512_storeu_si512((__m512i*)(dst), _mm512_srai_epi32(in_avx, 1));
+        src += 16;
+        dst += 16;
+    }
+
+    for (i = 0; i < len % 16; ++i) {
+        dst[i] = src[i] / 2;
+    }
+}
+
+static void opj_t1_encode_rev_stripe_avx512(OPJ_UINT32* OPJ_RESTRICT t1data,
+        const OPJ_UINT32* OPJ_RESTRICT tiledp,
+        OPJ_UINT32 w,
+        OPJ_SIZE_T stride)
+{
+    const __m512i perm1 = _mm512_setr_epi64(2, 3, 10, 11, 4, 5, 12, 13);
+    const __m512i perm2 = _mm512_setr_epi64(6, 7, 14, 15, 0, 0, 0, 0);
+    const OPJ_UINT32* ptr = tiledp;
+    OPJ_UINT32 i;
+    for (i = 0; i < w / 16; ++i) {
+        //                      INPUT                                        OUTPUT
+        // 00 01 02 03 04 05 06 07 08 09 0A 0B 0C 0D 0E 0F   00 10 20 30 01 11 21 31 02 12 22 32 03 13 23 33
+        // 10 11 12 13 14 15 16 17 18 19 1A 1B 1C 1D 1E 1F   04 14 24 34 05 15 25 35 06 16 26 36 07 17 27 37
+        // 20 21 22 23 24 25 26 27 28 29 2A 2B 2C 2D 2E 2F   08 18 28 38 09 19 29 39 0A 1A 2A 3A 0B 1B 2B 3B
+        // 30 31 32 33 34 35 36 37 38 39 3A 3B 3C 3D 3E 3F   0C 1C 2C 3C 0D 1D 2D 3D 0E 1E 2E 3E 0F 1F 2F 3F
+        __m512i in1 = _mm512_slli_epi32(_mm512_loadu_si512((const __m512i*)(ptr +
+                                        0 * stride)), T1_NMSEDEC_FRACBITS);
+        __m512i in2 = _mm512_slli_epi32(_mm512_loadu_si512((const __m512i*)(ptr +
+                                        1 * stride)), T1_NMSEDEC_FRACBITS);
+        __m512i in3 = _mm512_slli_epi32(_mm512_loadu_si512((const __m512i*)(ptr +
+                                        2 * stride)), T1_NMSEDEC_FRACBITS);
+        __m512i in4 = _mm512_slli_epi32(_mm512_loadu_si512((const __m512i*)(ptr +
+                                        3 * stride)), T1_NMSEDEC_FRACBITS);
+
+        __m512i tmp1 = _mm512_unpacklo_epi32(in1, in2);
+        __m512i tmp2 = _mm512_unpacklo_epi32(in3, in4);
+        __m512i tmp3 = _mm512_unpackhi_epi32(in1, in2);
+        __m512i tmp4 = _mm512_unpackhi_epi32(in3, in4);
+
+        in1 = _mm512_unpacklo_epi64(tmp1, tmp2);
+        in2 = _mm512_unpacklo_epi64(tmp3, tmp4);
+        in3 = _mm512_unpackhi_epi64(tmp1, tmp2);
+        in4 = _mm512_unpackhi_epi64(tmp3, tmp4);
+
+        _mm_storeu_si128((__m128i*)(t1data + 0), _mm512_castsi512_si128(in1));
+        _mm_storeu_si128((__m128i*)(t1data + 4), _mm512_castsi512_si128(in3));
+        _mm_storeu_si128((__m128i*)(t1data + 8), _mm512_castsi512_si128(in2));
+        _mm_storeu_si128((__m128i*)(t1data + 12), _mm512_castsi512_si128(in4));
+
+        tmp1 = _mm512_permutex2var_epi64(in1, perm1, in3);
+        tmp2 = _mm512_permutex2var_epi64(in2, perm1, in4);
+
+        _mm256_storeu_si256((__m256i*)(t1data + 16), _mm512_castsi512_si256(tmp1));
+        _mm256_storeu_si256((__m256i*)(t1data + 24), _mm512_castsi512_si256(tmp2));
+        _mm256_storeu_si256((__m256i*)(t1data + 32), _mm512_extracti64x4_epi64(tmp1,
+                            0x1));
+        _mm256_storeu_si256((__m256i*)(t1data + 40), _mm512_extracti64x4_epi64(tmp2,
+                            0x1));
+        _mm256_storeu_si256((__m256i*)(t1data + 48),
+                            _mm512_castsi512_si256(_mm512_permutex2var_epi64(in1, perm2, in3)));
+        _mm256_storeu_si256((__m256i*)(t1data + 56),
+                            _mm512_castsi512_si256(_mm512_permutex2var_epi64(in2, perm2, in4)));
+        t1data += 64;
+        ptr += 16;
+    }
+    for (i = 0; i < w % 16; ++i) {
+        t1data[0] = ptr[0 * stride] << T1_NMSEDEC_FRACBITS;
+        t1data[1] = ptr[1 * stride] << T1_NMSEDEC_FRACBITS;
+        t1data[2] = ptr[2 * stride] << T1_NMSEDEC_FRACBITS;
+        t1data[3] = ptr[3 * stride] << T1_NMSEDEC_FRACBITS;
+        t1data += 4;
+        ptr += 1;
+    }
+}
+
+const opj_t1_kernels_t opj_t1_kernels_avx512 = {
+    opj_t1_decode_rev_row_avx512,
+    opj_t1_decode_irrev_dequant_avx2,
+    opj_t1_encode_rev_stripe_avx512
+};
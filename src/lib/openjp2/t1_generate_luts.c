@@ -44,6 +44,9 @@ extern OPJ_BOOL vlc_init_tables();
 extern OPJ_BOOL vlc_tables_initialized;
 extern int vlc_tbl0[1024];
 extern int vlc_tbl1[1024];
+extern OPJ_BOOL vlc_init_enc_tables();
+extern int vlc_enc_tbl0[2048];
+extern int vlc_enc_tbl1[2048];
 
 static int t1_init_ctxno_zc(OPJ_UINT32 f, OPJ_UINT32 orient)
 {
@@ -319,5 +322,11 @@ int main(int argc, char **argv)
     printf("static const OPJ_UINT16 vlc_tbl1[1024] = {\n    ");
     dump_array16(vlc_tbl1, 1024);
 
+    vlc_init_enc_tables();
+    printf("static const OPJ_UINT16 vlc_enc_tbl0[2048] = {\n    ");
+    dump_array16(vlc_enc_tbl0, 2048);
+    printf("static const OPJ_UINT16 vlc_enc_tbl1[2048] = {\n    ");
+    dump_array16(vlc_enc_tbl1, 2048);
+
     return 0;
 }
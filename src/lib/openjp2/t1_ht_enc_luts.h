@@ -0,0 +1,517 @@
+static const OPJ_UINT16 vlc_enc_tbl0[2048] = {
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0640, 0x3f71, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0030, 0x0000, 0x7f72, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x1150, 0x1f73, 0x5f72, 0x5f72, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0230, 0x0000, 0x0000, 0x0000, 0x1364, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0e50, 0x0f75, 0x0000, 0x0000, 0x2364, 0x2364, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0360, 0x0000, 0x6f70, 0x0000, 0x6f70, 0x0000, 0x6f70, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x2f70, 0x0d62, 0x4f72, 0x4f72, 0x0d62, 0x0d62, 0x4f72, 0x4f72,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0430, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x3d68, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x1d60, 0x2d60, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x2d60, 0x2d60, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0150, 0x0000, 0x777a, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x3568, 0x0000, 0x3568, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x3770, 0x5771, 0x0961, 0x5771, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0961, 0x5771, 0x0961, 0x5771, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x1e50, 0x0000, 0x0000, 0x0000, 0x156c, 0x0000, 0x0000, 0x0000,
+    0x256c, 0x0000, 0x0000, 0x0000, 0x177c, 0x0000, 0x0000, 0x0000,
+    0x6770, 0x2771, 0x0000, 0x0000, 0x4775, 0x2771, 0x0000, 0x0000,
+    0x077d, 0x2771, 0x0000, 0x0000, 0x4775, 0x2771, 0x0000, 0x0000,
+    0x7b70, 0x0000, 0x4b72, 0x0000, 0x3b7e, 0x0000, 0x4b72, 0x0000,
+    0x056a, 0x0000, 0x4b72, 0x0000, 0x056a, 0x0000, 0x4b72, 0x0000,
+    0x5b70, 0x337f, 0x196e, 0x196e, 0x296f, 0x0b7f, 0x737e, 0x737e,
+    0x396f, 0x1b79, 0x6b7b, 0x1b79, 0x2b7f, 0x1b79, 0x6b7b, 0x1b79,
+    0x0020, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0e40, 0x1f71, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0640, 0x0000, 0x3b62, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x1b60, 0x3d60, 0x3d60, 0x3d60, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0a40, 0x0000, 0x0000, 0x0000, 0x2b64, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0b60, 0x7f75, 0x0000, 0x0000, 0x3364, 0x3364, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x1360, 0x0000, 0x2360, 0x0000, 0x2360, 0x0000, 0x2360, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x3f70, 0x0362, 0x5f72, 0x5f72, 0x0362, 0x0362, 0x5f72, 0x5f72,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0240, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x1d68, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x2d60, 0x0d60, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0d60, 0x0d60, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x3560, 0x0000, 0x6f7a, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x1568, 0x0000, 0x1568, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x2f70, 0x4f71, 0x1161, 0x4f71, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x1161, 0x4f71, 0x1161, 0x4f71, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0150, 0x0000, 0x0000, 0x0000, 0x056c, 0x0000, 0x0000, 0x0000,
+    0x2568, 0x0000, 0x0000, 0x0000, 0x2568, 0x0000, 0x0000, 0x0000,
+    0x0f70, 0x1771, 0x0000, 0x0000, 0x3965, 0x1771, 0x0000, 0x0000,
+    0x777d, 0x1771, 0x0000, 0x0000, 0x3965, 0x1771, 0x0000, 0x0000,
+    0x3770, 0x0000, 0x5772, 0x0000, 0x677e, 0x0000, 0x5772, 0x0000,
+    0x196a, 0x0000, 0x5772, 0x0000, 0x196a, 0x0000, 0x5772, 0x0000,
+    0x0770, 0x477f, 0x096a, 0x096a, 0x316e, 0x316e, 0x096a, 0x096a,
+    0x296b, 0x2778, 0x2778, 0x2778, 0x296b, 0x2778, 0x2778, 0x2778,
+    0x0020, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0e40, 0x1b61, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0640, 0x0000, 0x3f72, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x2b60, 0x3361, 0x7f73, 0x3361, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0a40, 0x0000, 0x0000, 0x0000, 0x0b64, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0150, 0x1365, 0x0000, 0x0000, 0x2365, 0x2f75, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0360, 0x0000, 0x5f70, 0x0000, 0x5f70, 0x0000, 0x5f70, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x1f70, 0x1163, 0x6f72, 0x6f72, 0x3777, 0x1163, 0x6f72, 0x6f72,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0240, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x4f78, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x3d60, 0x1d60, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x1d60, 0x1d60, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x2d60, 0x0000, 0x0d60, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0d60, 0x0000, 0x0d60, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0f70, 0x3562, 0x7772, 0x7772, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x3562, 0x3562, 0x7772, 0x7772, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x1560, 0x0000, 0x0000, 0x0000, 0x2564, 0x0000, 0x0000, 0x0000,
+    0x577c, 0x0000, 0x0000, 0x0000, 0x2564, 0x0000, 0x0000, 0x0000,
+    0x1770, 0x677d, 0x0000, 0x0000, 0x396c, 0x396c, 0x0000, 0x0000,
+    0x0568, 0x0568, 0x0000, 0x0000, 0x0568, 0x0568, 0x0000, 0x0000,
+    0x2770, 0x0000, 0x7b72, 0x0000, 0x1962, 0x0000, 0x7b72, 0x0000,
+    0x1962, 0x0000, 0x7b72, 0x0000, 0x1962, 0x0000, 0x7b72, 0x0000,
+    0x4770, 0x296f, 0x0773, 0x0961, 0x3167, 0x0961, 0x0773, 0x0961,
+    0x3b7f, 0x0961, 0x0773, 0x0961, 0x3167, 0x0961, 0x0773, 0x0961,
+    0x0030, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0440, 0x3d61, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0c50, 0x0000, 0x4f72, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x1d60, 0x0561, 0x7f73, 0x0561, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x1650, 0x0000, 0x0000, 0x0000, 0x2d64, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0650, 0x0d65, 0x0000, 0x0000, 0x3565, 0x1a55, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x3f70, 0x0000, 0x1f76, 0x0000, 0x5f74, 0x0000, 0x5f74, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x6f70, 0x2567, 0x0f77, 0x7777, 0x1566, 0x1566, 0x2f76, 0x2f76,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0a50, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0778, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x3960, 0x3771, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x5779, 0x3771, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x1960, 0x0000, 0x177a, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x2968, 0x0000, 0x2968, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x6770, 0x277b, 0x0963, 0x4771, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x7b7b, 0x4771, 0x0963, 0x4771, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x3160, 0x0000, 0x0000, 0x0000, 0x1164, 0x0000, 0x0000, 0x0000,
+    0x3b7c, 0x0000, 0x0000, 0x0000, 0x1164, 0x0000, 0x0000, 0x0000,
+    0x5b70, 0x216d, 0x0000, 0x0000, 0x016d, 0x2b7d, 0x0000, 0x0000,
+    0x4b7d, 0x1b79, 0x0000, 0x0000, 0x6b7d, 0x1b79, 0x0000, 0x0000,
+    0x0b70, 0x0000, 0x337e, 0x0000, 0x737e, 0x0000, 0x1374, 0x0000,
+    0x3e6c, 0x0000, 0x3e6c, 0x0000, 0x1374, 0x0000, 0x1374, 0x0000,
+    0x5370, 0x1c5f, 0x2e6f, 0x437f, 0x025f, 0x1e6f, 0x237e, 0x237e,
+    0x125f, 0x637b, 0x0e6a, 0x0e6a, 0x037f, 0x637b, 0x0e6a, 0x0e6a,
+    0x0020, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0e40, 0x3f71, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0640, 0x0000, 0x1b62, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x2b60, 0x7f73, 0x3d62, 0x3d62, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0a40, 0x0000, 0x0000, 0x0000, 0x5f74, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0b60, 0x3360, 0x0000, 0x0000, 0x3360, 0x3360, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x1360, 0x0000, 0x2360, 0x0000, 0x2360, 0x0000, 0x2360, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x1f70, 0x0364, 0x0364, 0x0364, 0x6f74, 0x6f74, 0x6f74, 0x6f74,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0240, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x1d68, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x1160, 0x7770, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x7770, 0x7770, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0150, 0x0000, 0x2d6a, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0d6a, 0x0000, 0x2f7a, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x4f70, 0x3560, 0x0f7b, 0x3560, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x3560, 0x3560, 0x3560, 0x3560, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x1560, 0x0000, 0x0000, 0x0000, 0x377c, 0x0000, 0x0000, 0x0000,
+    0x2568, 0x0000, 0x0000, 0x0000, 0x2568, 0x0000, 0x0000, 0x0000,
+    0x5770, 0x0771, 0x0000, 0x0000, 0x0561, 0x0771, 0x0000, 0x0000,
+    0x0561, 0x0771, 0x0000, 0x0000, 0x0561, 0x0771, 0x0000, 0x0000,
+    0x1770, 0x0000, 0x677e, 0x0000, 0x3964, 0x0000, 0x3964, 0x0000,
+    0x196c, 0x0000, 0x196c, 0x0000, 0x3964, 0x0000, 0x3964, 0x0000,
+    0x2770, 0x2969, 0x0967, 0x2969, 0x3b7f, 0x2969, 0x7b77, 0x2969,
+    0x316b, 0x4779, 0x0967, 0x4779, 0x316b, 0x4779, 0x7b77, 0x4779,
+    0x0030, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x1a50, 0x7f71, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0a50, 0x0000, 0x1d62, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x2d60, 0x3f73, 0x3963, 0x5f73, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x1250, 0x0000, 0x0000, 0x0000, 0x1f74, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0d60, 0x6f75, 0x0000, 0x0000, 0x3564, 0x3564, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x1560, 0x0000, 0x2562, 0x0000, 0x2f76, 0x0000, 0x2562, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x4f70, 0x3777, 0x7777, 0x0f77, 0x0566, 0x0566, 0x5776, 0x5776,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0250, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x1968, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x2660, 0x6779, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x1778, 0x1778, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x1c50, 0x0000, 0x096a, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x316a, 0x0000, 0x296a, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x2770, 0x7b7b, 0x216b, 0x477b, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x1169, 0x0779, 0x1169, 0x0779, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0160, 0x0000, 0x0000, 0x0000, 0x3b7c, 0x0000, 0x0000, 0x0000,
+    0x3e68, 0x0000, 0x0000, 0x0000, 0x3e68, 0x0000, 0x0000, 0x0000,
+    0x5b70, 0x2b7d, 0x0000, 0x0000, 0x2e6d, 0x1b7d, 0x0000, 0x0000,
+    0x1e69, 0x6b79, 0x0000, 0x0000, 0x1e69, 0x6b79, 0x0000, 0x0000,
+    0x4b70, 0x0000, 0x0e6e, 0x0000, 0x537e, 0x0000, 0x0b76, 0x0000,
+    0x366e, 0x0000, 0x337e, 0x0000, 0x737e, 0x0000, 0x0b76, 0x0000,
+    0x1370, 0x066f, 0x045f, 0x7d7f, 0x0c5f, 0x6377, 0x1667, 0x4377,
+    0x145f, 0x037d, 0x3d7f, 0x037d, 0x237f, 0x6377, 0x1667, 0x4377,
+    0x0030, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0440, 0x0361, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0c50, 0x0000, 0x0d62, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x1a50, 0x1d63, 0x2d63, 0x3d63, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0a50, 0x0000, 0x0000, 0x0000, 0x3f74, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x3560, 0x1561, 0x0000, 0x0000, 0x7f75, 0x1561, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x2560, 0x0000, 0x5f72, 0x0000, 0x1f76, 0x0000, 0x5f72, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x6f70, 0x3667, 0x7777, 0x2f77, 0x0566, 0x0566, 0x4f76, 0x4f76,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x1250, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0f78, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x3960, 0x3771, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x5779, 0x3771, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x1960, 0x0000, 0x2962, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x177a, 0x0000, 0x2962, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x6770, 0x0969, 0x316b, 0x0969, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x7b7b, 0x4779, 0x277b, 0x4779, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x1160, 0x0000, 0x0000, 0x0000, 0x3b7c, 0x0000, 0x0000, 0x0000,
+    0x216c, 0x0000, 0x0000, 0x0000, 0x077c, 0x0000, 0x0000, 0x0000,
+    0x5b70, 0x6b7d, 0x0000, 0x0000, 0x0165, 0x3375, 0x0000, 0x0000,
+    0x1b7c, 0x1b7c, 0x0000, 0x0000, 0x0165, 0x3375, 0x0000, 0x0000,
+    0x2b70, 0x0000, 0x4b7e, 0x0000, 0x537e, 0x0000, 0x0b72, 0x0000,
+    0x3e6e, 0x0000, 0x0b72, 0x0000, 0x737e, 0x0000, 0x0b72, 0x0000,
+    0x1370, 0x1c5f, 0x025f, 0x0e6f, 0x266f, 0x237f, 0x1e66, 0x1e66,
+    0x066f, 0x637b, 0x2e6e, 0x2e6e, 0x166f, 0x637b, 0x1e66, 0x1e66,
+    0x1250, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0560, 0x7f71, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x3960, 0x0000, 0x3f72, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x5f70, 0x2f73, 0x6f73, 0x1f73, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x4f70, 0x0000, 0x0000, 0x0000, 0x0f74, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x5770, 0x1961, 0x0000, 0x0000, 0x7775, 0x1961, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x3770, 0x0000, 0x2960, 0x0000, 0x2960, 0x0000, 0x2960, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x1770, 0x0967, 0x4777, 0x2777, 0x0777, 0x1b77, 0x6776, 0x6776,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x7b70, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x3b78, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x5b70, 0x3160, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x3160, 0x3160, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x5370, 0x0000, 0x1162, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x6b7a, 0x0000, 0x1162, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x2b70, 0x737b, 0x216b, 0x0b7b, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x137b, 0x4b79, 0x337b, 0x4b79, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x6370, 0x0000, 0x0000, 0x0000, 0x437c, 0x0000, 0x0000, 0x0000,
+    0x2378, 0x0000, 0x0000, 0x0000, 0x2378, 0x0000, 0x0000, 0x0000,
+    0x0370, 0x016d, 0x0000, 0x0000, 0x3e6d, 0x5d7d, 0x0000, 0x0000,
+    0x1d7d, 0x7d79, 0x0000, 0x0000, 0x3d7d, 0x7d79, 0x0000, 0x0000,
+    0x6d70, 0x0000, 0x1e6e, 0x0000, 0x757e, 0x0000, 0x2d76, 0x0000,
+    0x0e6e, 0x0000, 0x0d7e, 0x0000, 0x4d7e, 0x0000, 0x2d76, 0x0000,
+    0x1570, 0x004f, 0x0c4f, 0x0a5f, 0x084f, 0x1a5f, 0x366f, 0x557f,
+    0x044f, 0x2e6f, 0x025f, 0x257f, 0x166f, 0x357f, 0x657f, 0x065f
+};
+
+static const OPJ_UINT16 vlc_enc_tbl1[2048] = {
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0030, 0x2761, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0630, 0x0000, 0x1762, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0d50, 0x3b60, 0x3b60, 0x3b60, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0230, 0x0000, 0x0000, 0x0000, 0x0764, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x1550, 0x2b60, 0x0000, 0x0000, 0x2b60, 0x2b60, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0150, 0x0000, 0x7f70, 0x0000, 0x7f70, 0x0000, 0x7f70, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x1f70, 0x1b60, 0x1b60, 0x1b60, 0x1b60, 0x1b60, 0x1b60, 0x1b60,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0430, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0558, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x1950, 0x1360, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x1360, 0x1360, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0950, 0x0000, 0x3f7a, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0b68, 0x0000, 0x0b68, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x5f70, 0x3360, 0x3360, 0x3360, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x3360, 0x3360, 0x3360, 0x3360, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x1150, 0x0000, 0x0000, 0x0000, 0x6f7c, 0x0000, 0x0000, 0x0000,
+    0x2368, 0x0000, 0x0000, 0x0000, 0x2368, 0x0000, 0x0000, 0x0000,
+    0x0f70, 0x0360, 0x0000, 0x0000, 0x0360, 0x0360, 0x0000, 0x0000,
+    0x0360, 0x0360, 0x0000, 0x0000, 0x0360, 0x0360, 0x0000, 0x0000,
+    0x2f70, 0x0000, 0x3d64, 0x0000, 0x4f74, 0x0000, 0x4f74, 0x0000,
+    0x3d64, 0x0000, 0x3d64, 0x0000, 0x4f74, 0x0000, 0x4f74, 0x0000,
+    0x7770, 0x3771, 0x1d61, 0x3771, 0x1d61, 0x3771, 0x1d61, 0x3771,
+    0x1d61, 0x3771, 0x1d61, 0x3771, 0x1d61, 0x3771, 0x1d61, 0x3771,
+    0x0010, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0540, 0x7f71, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0940, 0x0000, 0x1f72, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x1d50, 0x3f71, 0x5f73, 0x3f71, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0d50, 0x0000, 0x0000, 0x0000, 0x3774, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0360, 0x6f70, 0x0000, 0x0000, 0x6f70, 0x6f70, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x2f70, 0x0000, 0x4f70, 0x0000, 0x4f70, 0x0000, 0x4f70, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0f70, 0x7770, 0x7770, 0x7770, 0x7770, 0x7770, 0x7770, 0x7770,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0140, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x1778, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0b60, 0x5770, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x5770, 0x5770, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x3360, 0x0000, 0x6770, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x6770, 0x0000, 0x6770, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x2770, 0x2b70, 0x2b70, 0x2b70, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x2b70, 0x2b70, 0x2b70, 0x2b70, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x1360, 0x0000, 0x0000, 0x0000, 0x4770, 0x0000, 0x0000, 0x0000,
+    0x4770, 0x0000, 0x0000, 0x0000, 0x4770, 0x0000, 0x0000, 0x0000,
+    0x0770, 0x7b70, 0x0000, 0x0000, 0x7b70, 0x7b70, 0x0000, 0x0000,
+    0x7b70, 0x7b70, 0x0000, 0x0000, 0x7b70, 0x7b70, 0x0000, 0x0000,
+    0x3b70, 0x0000, 0x5b70, 0x0000, 0x5b70, 0x0000, 0x5b70, 0x0000,
+    0x5b70, 0x0000, 0x5b70, 0x0000, 0x5b70, 0x0000, 0x5b70, 0x0000,
+    0x1b70, 0x2364, 0x2364, 0x2364, 0x6b74, 0x6b74, 0x6b74, 0x6b74,
+    0x2364, 0x2364, 0x2364, 0x2364, 0x6b74, 0x6b74, 0x6b74, 0x6b74,
+    0x0010, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0940, 0x7f71, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0140, 0x0000, 0x2362, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x3d60, 0x1f73, 0x3f72, 0x3f72, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x1550, 0x0000, 0x0000, 0x0000, 0x5f74, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0360, 0x6f70, 0x0000, 0x0000, 0x6f70, 0x6f70, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x2f70, 0x0000, 0x4f70, 0x0000, 0x4f70, 0x0000, 0x4f70, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0f70, 0x1770, 0x1770, 0x1770, 0x1770, 0x1770, 0x1770, 0x1770,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0550, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x7778, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x3770, 0x5770, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x5770, 0x5770, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x1d60, 0x0000, 0x2d6a, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x677a, 0x0000, 0x7b7a, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x2770, 0x0770, 0x477b, 0x0770, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0770, 0x0770, 0x0770, 0x0770, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0d60, 0x0000, 0x0000, 0x0000, 0x3b70, 0x0000, 0x0000, 0x0000,
+    0x3b70, 0x0000, 0x0000, 0x0000, 0x3b70, 0x0000, 0x0000, 0x0000,
+    0x5b70, 0x1b70, 0x0000, 0x0000, 0x1b70, 0x1b70, 0x0000, 0x0000,
+    0x1b70, 0x1b70, 0x0000, 0x0000, 0x1b70, 0x1b70, 0x0000, 0x0000,
+    0x6b70, 0x0000, 0x4b74, 0x0000, 0x2b74, 0x0000, 0x2b74, 0x0000,
+    0x4b74, 0x0000, 0x4b74, 0x0000, 0x2b74, 0x0000, 0x2b74, 0x0000,
+    0x0b70, 0x3375, 0x5377, 0x3375, 0x7374, 0x7374, 0x7374, 0x7374,
+    0x137f, 0x3375, 0x5377, 0x3375, 0x7374, 0x7374, 0x7374, 0x7374,
+    0x0020, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0a40, 0x0b61, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0240, 0x0000, 0x2362, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0e50, 0x1363, 0x3363, 0x7f73, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x1650, 0x0000, 0x0000, 0x0000, 0x3f74, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0360, 0x3d61, 0x0000, 0x0000, 0x1f75, 0x3d61, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x1d60, 0x0000, 0x5f70, 0x0000, 0x5f70, 0x0000, 0x5f70, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x2d60, 0x1e65, 0x6f77, 0x1e65, 0x2f74, 0x2f74, 0x2f74, 0x2f74,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0650, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x4f78, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0d60, 0x3560, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x3560, 0x3560, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x1560, 0x0000, 0x2562, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0f7a, 0x0000, 0x2562, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0560, 0x777b, 0x196b, 0x177b, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x3968, 0x3968, 0x3968, 0x3968, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x2960, 0x0000, 0x0000, 0x0000, 0x0960, 0x0000, 0x0000, 0x0000,
+    0x0960, 0x0000, 0x0000, 0x0000, 0x0960, 0x0000, 0x0000, 0x0000,
+    0x3770, 0x3164, 0x0000, 0x0000, 0x5774, 0x5774, 0x0000, 0x0000,
+    0x3164, 0x3164, 0x0000, 0x0000, 0x5774, 0x5774, 0x0000, 0x0000,
+    0x6770, 0x0000, 0x6b7e, 0x0000, 0x2774, 0x0000, 0x2774, 0x0000,
+    0x477c, 0x0000, 0x477c, 0x0000, 0x2774, 0x0000, 0x2774, 0x0000,
+    0x1160, 0x3e6f, 0x216f, 0x7b77, 0x2b7f, 0x1b7f, 0x0776, 0x0776,
+    0x016f, 0x5b7a, 0x3b7f, 0x7b77, 0x5b7a, 0x5b7a, 0x0776, 0x0776,
+    0x0010, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0d50, 0x7f71, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x1550, 0x0000, 0x3f72, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x5f70, 0x6f70, 0x6f70, 0x6f70, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0940, 0x0000, 0x0000, 0x0000, 0x2364, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x3360, 0x1f70, 0x0000, 0x0000, 0x1f70, 0x1f70, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x1360, 0x0000, 0x2f70, 0x0000, 0x2f70, 0x0000, 0x2f70, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x4f70, 0x5770, 0x5770, 0x5770, 0x5770, 0x5770, 0x5770, 0x5770,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0140, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0f78, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x7770, 0x3770, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x3770, 0x3770, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x1d60, 0x0000, 0x1770, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x1770, 0x0000, 0x1770, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x6770, 0x6b70, 0x6b70, 0x6b70, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x6b70, 0x6b70, 0x6b70, 0x6b70, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0550, 0x0000, 0x0000, 0x0000, 0x077c, 0x0000, 0x0000, 0x0000,
+    0x477c, 0x0000, 0x0000, 0x0000, 0x277c, 0x0000, 0x0000, 0x0000,
+    0x7b70, 0x3b70, 0x0000, 0x0000, 0x3b70, 0x3b70, 0x0000, 0x0000,
+    0x3b70, 0x3b70, 0x0000, 0x0000, 0x3b70, 0x3b70, 0x0000, 0x0000,
+    0x5b70, 0x0000, 0x1b72, 0x0000, 0x0362, 0x0000, 0x1b72, 0x0000,
+    0x0362, 0x0000, 0x1b72, 0x0000, 0x0362, 0x0000, 0x1b72, 0x0000,
+    0x2b70, 0x4b71, 0x0b73, 0x4b71, 0x3d63, 0x4b71, 0x0b73, 0x4b71,
+    0x3d63, 0x4b71, 0x0b73, 0x4b71, 0x3d63, 0x4b71, 0x0b73, 0x4b71,
+    0x0020, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x1e50, 0x3b61, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0a50, 0x0000, 0x3f72, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x1b60, 0x0b60, 0x0b60, 0x0b60, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0240, 0x0000, 0x0000, 0x0000, 0x2b64, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0e50, 0x7f75, 0x0000, 0x0000, 0x3364, 0x3364, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x1360, 0x0000, 0x6f70, 0x0000, 0x6f70, 0x0000, 0x6f70, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x2360, 0x1562, 0x5f72, 0x5f72, 0x1562, 0x1562, 0x5f72, 0x5f72,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x1650, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0368, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x3d60, 0x1f70, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x1f70, 0x1f70, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x1d60, 0x0000, 0x2d60, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x2d60, 0x0000, 0x2d60, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0d60, 0x4f71, 0x3561, 0x4f71, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x3561, 0x4f71, 0x3561, 0x4f71, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0650, 0x0000, 0x0000, 0x0000, 0x2564, 0x0000, 0x0000, 0x0000,
+    0x2f7c, 0x0000, 0x0000, 0x0000, 0x2564, 0x0000, 0x0000, 0x0000,
+    0x0560, 0x7771, 0x0000, 0x0000, 0x3965, 0x7771, 0x0000, 0x0000,
+    0x0f7d, 0x7771, 0x0000, 0x0000, 0x3965, 0x7771, 0x0000, 0x0000,
+    0x1960, 0x0000, 0x5772, 0x0000, 0x377e, 0x0000, 0x5772, 0x0000,
+    0x016a, 0x0000, 0x5772, 0x0000, 0x016a, 0x0000, 0x5772, 0x0000,
+    0x1a50, 0x296f, 0x216f, 0x077f, 0x316f, 0x677d, 0x2777, 0x677d,
+    0x116f, 0x1779, 0x477f, 0x1779, 0x096f, 0x1779, 0x2777, 0x1779,
+    0x0030, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0240, 0x0361, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0c40, 0x0000, 0x3d62, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x1d60, 0x7f73, 0x0d62, 0x0d62, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0440, 0x0000, 0x0000, 0x0000, 0x2d64, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0a50, 0x2f75, 0x0000, 0x0000, 0x3564, 0x3564, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x1560, 0x0000, 0x3f72, 0x0000, 0x5f76, 0x0000, 0x3f72, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x2560, 0x1f73, 0x2962, 0x2962, 0x6f77, 0x1f73, 0x2962, 0x2962,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x1650, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0568, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x3960, 0x1960, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x1960, 0x1960, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0650, 0x0000, 0x096a, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x4f7a, 0x0000, 0x0f7a, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0e60, 0x477b, 0x777b, 0x3772, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x577a, 0x577a, 0x3772, 0x3772, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x1a50, 0x0000, 0x0000, 0x0000, 0x277c, 0x0000, 0x0000, 0x0000,
+    0x677c, 0x0000, 0x0000, 0x0000, 0x177c, 0x0000, 0x0000, 0x0000,
+    0x3160, 0x2b7d, 0x0000, 0x0000, 0x077d, 0x7b74, 0x0000, 0x0000,
+    0x3b7c, 0x3b7c, 0x0000, 0x0000, 0x7b74, 0x7b74, 0x0000, 0x0000,
+    0x1160, 0x0000, 0x337e, 0x0000, 0x5b7e, 0x0000, 0x1b74, 0x0000,
+    0x216e, 0x0000, 0x6b7e, 0x0000, 0x1b74, 0x0000, 0x1b74, 0x0000,
+    0x0160, 0x237f, 0x3e6f, 0x4b73, 0x2e6f, 0x137f, 0x0b77, 0x4b73,
+    0x1e6f, 0x537b, 0x737f, 0x4b73, 0x637f, 0x537b, 0x0b77, 0x4b73,
+    0x0440, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x3360, 0x1361, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x2360, 0x0000, 0x7f72, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0360, 0x3f71, 0x6f73, 0x3f71, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x2d60, 0x0000, 0x0000, 0x0000, 0x5f74, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x1650, 0x3d61, 0x0000, 0x0000, 0x1f75, 0x3d61, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x1d60, 0x0000, 0x7770, 0x0000, 0x7770, 0x0000, 0x7770, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0650, 0x0d67, 0x5777, 0x0f77, 0x2f77, 0x4f74, 0x4f74, 0x4f74,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x3560, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x3778, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x1560, 0x2770, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x2770, 0x2770, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x2560, 0x0000, 0x2960, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x2960, 0x0000, 0x2960, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x1a50, 0x177b, 0x0563, 0x6771, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x7b7b, 0x6771, 0x0563, 0x6771, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x3960, 0x0000, 0x0000, 0x0000, 0x1960, 0x0000, 0x0000, 0x0000,
+    0x1960, 0x0000, 0x0000, 0x0000, 0x1960, 0x0000, 0x0000, 0x0000,
+    0x0c50, 0x477d, 0x0000, 0x0000, 0x0965, 0x0771, 0x0000, 0x0000,
+    0x1b7d, 0x0771, 0x0000, 0x0000, 0x0965, 0x0771, 0x0000, 0x0000,
+    0x3160, 0x0000, 0x3b7e, 0x0000, 0x0b7e, 0x0000, 0x5b72, 0x0000,
+    0x3e6a, 0x0000, 0x5b72, 0x0000, 0x3e6a, 0x0000, 0x5b72, 0x0000,
+    0x0030, 0x025f, 0x0a5f, 0x116f, 0x1c5f, 0x2e6f, 0x2167, 0x2b7f,
+    0x125f, 0x1e6b, 0x016f, 0x4b7f, 0x0e6f, 0x1e6b, 0x2167, 0x6b7f
+};
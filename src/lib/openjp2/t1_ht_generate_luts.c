@@ -969,3 +969,85 @@ OPJ_BOOL vlc_init_tables()
   */
 OPJ_BOOL vlc_tables_initialized = OPJ_FALSE;
 
+//************************************************************************/
+/** @defgroup vlc_encoding_tables_grp VLC encoding tables
+  *  @{
+  *  VLC tables to encode a quad into a VLC codeword; each entry holds
+  *  these fields: (from LSB)                                             \n
+  *  \li \c e_k     : 4bits -> EMB e_k of the selected codeword            \n
+  *  \li \c cwd_len : 4bits -> the codeword length                         \n
+  *  \li \c cwd     : 8bits -> the VLC codeword, to be emitted LSB first   \n
+  *                                                                       \n
+  *  The table index is 11 bits and composed of three parts:              \n
+  *  The 4 LSBs contain emb, the samples of the quad whose exponent is
+  *  equal to U_q; emb is 0 when u_q is 0.                                \n
+  *  The next 4 bits contain rho, the significance pattern of the quad.   \n
+  *  The 3 MSBs contain the context of the quad.                          \n
+  *  An entry of 0 denotes a combination that cannot occur.               \n
+  */
+
+/// @brief vlc_enc_tbl0 contains encoding information for initial row of
+///        quads
+int vlc_enc_tbl0[2048] = { 0 };
+/// @brief vlc_enc_tbl1 contains encoding information for non-initial row
+///        of quads
+int vlc_enc_tbl1[2048] = { 0 };
+/// @}
+
+//************************************************************************/
+/** @ingroup vlc_encoding_tables_grp
+  *  @brief Fills one VLC encoding table from a source table
+  *
+  *  Among the codewords that can represent a (c_q, rho, emb) triplet,
+  *  the one that minimizes the number of bits spent in the VLC and
+  *  MagSgn streams is selected; each bit of e_k saves one MagSgn bit.
+  */
+static void vlc_init_enc_table(int *enc_tbl, const vlc_src_table_t *src,
+                               size_t src_size)
+{
+    for (int i = 0; i < 2048; ++i) {
+        int emb = i & 0xF;
+        int rho = (i >> 4) & 0xF;
+        int c_q = i >> 8;
+        int best_cost = 1000;
+
+        enc_tbl[i] = 0;
+        if ((emb & rho) != emb || (rho == 0 && c_q == 0)) {
+            continue;
+        }
+        for (size_t j = 0; j < src_size; ++j) {
+            int cost, e_k;
+            if (src[j].c_q != c_q || src[j].rho != rho) {
+                continue;
+            }
+            if (src[j].u_off != (emb != 0 ? 1 : 0)) {
+                continue;
+            }
+            if ((emb & src[j].e_k) != src[j].e_1) {
+                continue;
+            }
+            e_k = src[j].e_k;
+            cost = src[j].cwd_len - ((e_k & 1) + ((e_k >> 1) & 1) +
+                                     ((e_k >> 2) & 1) + ((e_k >> 3) & 1));
+            if (cost < best_cost) {
+                best_cost = cost;
+                enc_tbl[i] = (src[j].cwd << 8) | (src[j].cwd_len << 4) | e_k;
+            }
+        }
+    }
+}
+
+//************************************************************************/
+/** @ingroup vlc_encoding_tables_grp
+  *  @brief Initializes vlc_enc_tbl0 and vlc_enc_tbl1 tables, from table0.h
+  *         and table1.h
+  */
+OPJ_BOOL vlc_init_enc_tables()
+{
+    vlc_init_enc_table(vlc_enc_tbl0, tbl0,
+                       sizeof(tbl0) / sizeof(vlc_src_table_t));
+    vlc_init_enc_table(vlc_enc_tbl1, tbl1,
+                       sizeof(tbl1) / sizeof(vlc_src_table_t));
+    return OPJ_TRUE;
+}
+
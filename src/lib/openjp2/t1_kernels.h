@@ -0,0 +1,95 @@
+/*
+ * The copyright in this software is being made available under the 2-clauses
+ * BSD License, included below. This software may be subject to other third
+ * party and contributor rights, including patent rights, and no such rights
+ * are granted under this license.
+ *
+ * Copyright (c) 2026, OpenJPEG contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS `AS IS'
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef OPJ_T1_KERNELS_H
+#define OPJ_T1_KERNELS_H
+/**
+@file t1_kernels.h
+@brief SIMD kernels of the tier-1 coding
+
+These kernels move the code-block samples between the tile and the T1
+buffers. t1.c holds the generic and baseline (SSE2) tables, t1_avx2.c and
+t1_avx512.c the ones that are compiled with the AVX2 and AVX-512 compiler
+flags. The HT block decoder of ht_dec.c is also built as a whole with the
+AVX2 flags, by ht_dec_avx2.c.
+*/
+
+/** @defgroup T1 T1 - Implementation of the tier-1 coding */
+/*@{*/
+
+/** Tier-1 kernels for a given instruction set */
+typedef struct opj_t1_kernels {
+    /** Writes len decoded reversible samples to the tile, divided by 2 */
+    void (*decode_rev_row)(OPJ_INT32* OPJ_RESTRICT dst,
+                           const OPJ_INT32* OPJ_RESTRICT src,
+                           OPJ_UINT32 len);
+
+    /** Converts len decoded irreversible samples, in place, to floats
+     * multiplied by stepsize. data is aligned on 16 bytes. */
+    void (*decode_irrev_dequant)(OPJ_INT32* data,
+                                 OPJ_UINT32 len,
+                                 OPJ_FLOAT32 stepsize);
+
+    /** Reads 4 rows of w reversible tile samples, separated by stride
+     * samples, and writes them in the T1 "zigzag" order (one column of 4
+     * samples after the other), shifted by T1_NMSEDEC_FRACBITS. */
+    void (*encode_rev_stripe)(OPJ_UINT32* OPJ_RESTRICT t1data,
+                              const OPJ_UINT32* OPJ_RESTRICT tiledp,
+                              OPJ_UINT32 w,
+                              OPJ_SIZE_T stride);
+} opj_t1_kernels_t;
+
+#ifdef OPJ_HAVE_AVX2_KERNELS
+/** Kernels of t1_avx2.c */
+extern const opj_t1_kernels_t opj_t1_kernels_avx2;
+
+/** AVX2 version of opj_t1_kernels_t::decode_irrev_dequant */
+void opj_t1_decode_irrev_dequant_avx2(OPJ_INT32* data,
+                                      OPJ_UINT32 len,
+                                      OPJ_FLOAT32 stepsize);
+
+/** HT code-block decoder of ht_dec_avx2.c, see opj_t1_ht_decode_cblk() */
+OPJ_BOOL opj_t1_ht_decode_cblk_avx2(opj_t1_t *t1,
+                                    opj_tcd_cblk_dec_t* cblk,
+                                    OPJ_UINT32 orient,
+                                    OPJ_UINT32 roishift,
+                                    OPJ_UINT32 cblksty,
+                                    opj_event_mgr_t *p_manager,
+                                    opj_mutex_t* p_manager_mutex,
+                                    OPJ_BOOL check_pterm);
+#endif
+#ifdef OPJ_HAVE_AVX512_KERNELS
+/** Kernels of t1_avx512.c */
+extern const opj_t1_kernels_t opj_t1_kernels_avx512;
+#endif
+
+/*@}*/
+
+#endif /* OPJ_T1_KERNELS_H */
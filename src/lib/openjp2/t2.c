@@ -59,6 +59,18 @@ Variable length code for signalling delta Zil (truncation point)
 static void opj_t2_putnumpasses(opj_bio_t *bio, OPJ_UINT32 n);
 static OPJ_UINT32 opj_t2_getnumpasses(opj_bio_t *bio);
 
+/**
+Copy the coding state of the tag trees and code-blocks of a tile that
+opj_t2_encode_packet() updates, to or from a buffer.
+@param tile     Tile whose state is copied
+@param state    Buffer of the state, or NULL to only compute its size
+@param save     OPJ_TRUE to copy the state to the buffer, OPJ_FALSE to restore it
+@return the size of the state in bytes
+*/
+static OPJ_SIZE_T opj_t2_copy_encoding_state(opj_tcd_tile_t *tile,
+        OPJ_BYTE *state,
+        OPJ_BOOL save);
+
 /**
 Encode a packet of a tile to a destination buffer
 @param tileno Number of the tile encoded
@@ -129,6 +141,16 @@ static OPJ_BOOL opj_t2_read_packet_header(opj_t2_t* p_t2,
         opj_packet_info_t *p_pack_info,
         opj_event_mgr_t *p_manager);
 
+/**
+Mark a code-block as corrupted from a layer on
+@param p_t2 T2 handle
+@param p_cblk Code-block whose data cannot be read
+@param p_layno Layer of the packet the data of the code-block is missing from
+*/
+static void opj_t2_set_cblk_corrupted(opj_t2_t* p_t2,
+                                      opj_tcd_cblk_dec_t* p_cblk,
+                                      OPJ_UINT32 p_layno);
+
 static OPJ_BOOL opj_t2_read_packet_data(opj_t2_t* p_t2,
                                         opj_tcd_tile_t *p_tile,
                                         opj_pi_iterator_t *p_pi,
@@ -151,11 +173,68 @@ static OPJ_BOOL opj_t2_skip_packet_data(opj_t2_t* p_t2,
 @param index
 @param cblksty
 @param first
+@param p_arena arena the segments are allocated from, or NULL
 */
 static OPJ_BOOL opj_t2_init_seg(opj_tcd_cblk_dec_t* cblk,
                                 OPJ_UINT32 index,
                                 OPJ_UINT32 cblksty,
-                                OPJ_UINT32 first);
+                                OPJ_UINT32 first,
+                                opj_arena_t* p_arena);
+
+/** Packet whose header is read by one of the jobs of
+ * opj_t2_decode_packets_concurrently() */
+typedef struct opj_t2_packet {
+    OPJ_UINT32 compno;
+    OPJ_UINT32 resno;
+    OPJ_UINT32 precno;
+    OPJ_UINT32 layno;
+    /** offset of the packet in the data of the tile */
+    OPJ_UINT32 offset;
+    /** length of the packet, from the PLT markers */
+    OPJ_UINT32 length;
+} opj_t2_packet_t;
+
+/** Packets of a set of precincts, decoded in codestream order by one of the
+ * jobs of opj_t2_decode_packets_concurrently() */
+typedef struct opj_t2_decode_packets_job {
+    /** T2 handle of the job, with its own arena */
+    opj_t2_t t2;
+    opj_tcd_tile_t *tile;
+    opj_tcp_t *tcp;
+    /** data of the tile */
+    OPJ_BYTE *src;
+    /** packets of the tile */
+    const opj_t2_packet_t *packets;
+    /** indices in packets of the packets of the job */
+    const OPJ_UINT32 *packet_indices;
+    OPJ_UINT32 nb_packets;
+    opj_event_mgr_t *p_manager;
+    OPJ_BOOL ret;
+} opj_t2_decode_packets_job_t;
+
+/**
+Decodes packets of a tile whose position is known from the PLT markers.
+The packets of different precincts do not share any state, so they are
+distributed among jobs run by the thread pool of the tile decoder, each
+job decoding the packets of its precincts in codestream order.
+@param tcd tile decoder
+@param p_t2 T2 handle
+@param p_tile tile
+@param p_tcp tile coding parameters
+@param p_src data of the tile
+@param p_packets packets to decode, in codestream order
+@param p_nb_packets number of packets
+@param p_manager the user event manager
+@return OPJ_TRUE if all the packets could be decoded
+*/
+static OPJ_BOOL opj_t2_decode_packets_concurrently(opj_tcd_t* tcd,
+        opj_t2_t *p_t2,
+        opj_tcd_tile_t *p_tile,
+        opj_tcp_t *p_tcp,
+        OPJ_BYTE *p_src,
+        const opj_t2_packet_t *p_packets,
+        OPJ_UINT32 p_nb_packets,
+        opj_event_mgr_t *p_manager);
 
 /*@}*/
 
@@ -377,6 +456,189 @@ OPJ_BOOL opj_t2_encode_packets(opj_t2_t* p_t2,
     return OPJ_TRUE;
 }
 
+static void opj_t2_copy_state_item(OPJ_BYTE *state, OPJ_SIZE_T *offset,
+                                   void *item, OPJ_SIZE_T size, OPJ_BOOL save)
+{
+    if (state) {
+        if (save) {
+            memcpy(state + *offset, item, size);
+        } else {
+            memcpy(item, state + *offset, size);
+        }
+    }
+    *offset += size;
+}
+
+static OPJ_SIZE_T opj_t2_copy_encoding_state(opj_tcd_tile_t *tile,
+        OPJ_BYTE *state,
+        OPJ_BOOL save)
+{
+    OPJ_SIZE_T l_offset = 0;
+    OPJ_UINT32 compno, resno, bandno, precno, cblkno;
+
+    for (compno = 0; compno < tile->numcomps; ++compno) {
+        opj_tcd_tilecomp_t *tilec = &tile->comps[compno];
+
+        for (resno = 0; resno < tilec->numresolutions; ++resno) {
+            opj_tcd_resolution_t *res = &tilec->resolutions[resno];
+
+            for (bandno = 0; bandno < res->numbands; ++bandno) {
+                opj_tcd_band_t *band = &res->bands[bandno];
+
+                /* Skip empty bands */
+                if (opj_tcd_is_band_empty(band)) {
+                    continue;
+                }
+
+                for (precno = 0; precno < res->pw * res->ph; ++precno) {
+                    opj_tcd_precinct_t *prc = &band->precincts[precno];
+
+                    if (prc->incltree) {
+                        opj_t2_copy_state_item(state, &l_offset, prc->incltree->nodes,
+                                               prc->incltree->numnodes * sizeof(opj_tgt_node_t), save);
+                    }
+                    if (prc->imsbtree) {
+                        opj_t2_copy_state_item(state, &l_offset, prc->imsbtree->nodes,
+                                               prc->imsbtree->numnodes * sizeof(opj_tgt_node_t), save);
+                    }
+                    for (cblkno = 0; cblkno < prc->cw * prc->ch; ++cblkno) {
+                        opj_tcd_cblk_enc_t *cblk = &prc->cblks.enc[cblkno];
+
+                        opj_t2_copy_state_item(state, &l_offset, &cblk->numpasses,
+                                               sizeof(cblk->numpasses), save);
+                        opj_t2_copy_state_item(state, &l_offset, &cblk->numlenbits,
+                                               sizeof(cblk->numlenbits), save);
+                    }
+                }
+            }
+        }
+    }
+
+    return l_offset;
+}
+
+OPJ_BOOL opj_t2_can_estimate_layer_size(const opj_t2_t* p_t2)
+{
+    const opj_cp_t *l_cp = p_t2->cp;
+
+    /* Those profiles restrict the threshold calculation to tile-parts, */
+    /* to the first POC, or to the size of each component */
+    return !OPJ_IS_CINEMA(l_cp->rsiz) && !OPJ_IS_IMF(l_cp->rsiz) &&
+           l_cp->m_specific_param.m_enc.m_max_comp_size == 0;
+}
+
+OPJ_BOOL opj_t2_init_layer_size_estimation(opj_t2_t* p_t2,
+        OPJ_UINT32 p_tile_no,
+        opj_tcd_tile_t *p_tile,
+        OPJ_UINT32 p_layno,
+        OPJ_BYTE *p_dest,
+        OPJ_UINT32 p_max_len,
+        opj_event_mgr_t *p_manager)
+{
+    OPJ_SIZE_T l_state_size;
+
+    assert(opj_t2_can_estimate_layer_size(p_t2));
+
+    p_t2->est_layno = p_layno;
+    p_t2->est_max_len = p_max_len;
+    p_t2->est_prev_len = 0;
+    p_t2->est_prev_ok = OPJ_TRUE;
+
+    if (!p_t2->est_pi) {
+        p_t2->est_pi = opj_pi_initialise_encode(p_t2->image, p_t2->cp, p_tile_no,
+                                                THRESH_CALC, p_manager);
+        if (!p_t2->est_pi) {
+            return OPJ_FALSE;
+        }
+        p_t2->est_nb_pocs = p_t2->cp->tcps[p_tile_no].numpocs + 1;
+    }
+
+    if (p_layno == 0) {
+        /* opj_t2_encode_packet() resets the coding state for the first layer */
+        return OPJ_TRUE;
+    }
+
+    /* The truncation points of the previous layers are final: the size */
+    /* and the coding state after their packets do not change anymore */
+    if (!opj_t2_encode_packets(p_t2, p_tile_no, p_tile, p_layno, p_dest,
+                               &p_t2->est_prev_len, p_max_len, NULL, NULL, 0, 0, 0,
+                               THRESH_CALC, p_manager)) {
+        p_t2->est_prev_ok = OPJ_FALSE;
+        return OPJ_TRUE;
+    }
+
+    l_state_size = opj_t2_copy_encoding_state(p_tile, NULL, OPJ_TRUE);
+    if (l_state_size > p_t2->est_state_size) {
+        OPJ_BYTE *l_new_state = (OPJ_BYTE*) opj_realloc(p_t2->est_state,
+                                l_state_size);
+        if (!l_new_state) {
+            opj_event_msg(p_manager, EVT_ERROR,
+                          "Not enough memory to allocate the rate allocation state\n");
+            return OPJ_FALSE;
+        }
+        p_t2->est_state = l_new_state;
+        p_t2->est_state_size = l_state_size;
+    }
+    opj_t2_copy_encoding_state(p_tile, p_t2->est_state, OPJ_TRUE);
+
+    return OPJ_TRUE;
+}
+
+OPJ_BOOL opj_t2_estimate_layer_size(opj_t2_t* p_t2,
+                                    OPJ_UINT32 p_tile_no,
+                                    opj_tcd_tile_t *p_tile,
+                                    OPJ_BYTE *p_dest,
+                                    OPJ_UINT32 * p_data_written,
+                                    opj_event_mgr_t *p_manager)
+{
+    opj_pi_iterator_t *l_pi = p_t2->est_pi;
+    opj_tcp_t *l_tcp = &p_t2->cp->tcps[p_tile_no];
+    OPJ_BYTE *l_current_data = p_dest + p_t2->est_prev_len;
+    OPJ_UINT32 l_max_len;
+    OPJ_UINT32 l_nb_bytes;
+
+    * p_data_written = 0;
+
+    if (!p_t2->est_prev_ok) {
+        return OPJ_FALSE;
+    }
+    l_max_len = p_t2->est_max_len - p_t2->est_prev_len;
+
+    if (p_t2->est_layno > 0) {
+        opj_t2_copy_encoding_state(p_tile, p_t2->est_state, OPJ_FALSE);
+    }
+
+    opj_pi_create_encode(l_pi, p_t2->cp, p_tile_no, 0, 0, 0, THRESH_CALC);
+    if (l_pi->poc.prg == OPJ_PROG_UNKNOWN) {
+        return OPJ_FALSE;
+    }
+    if (l_pi->include) {
+        memset(l_pi->include, 0, l_pi->include_size * sizeof(OPJ_INT16));
+    }
+
+    /* Only the packets of the layer are encoded. They only depend on the */
+    /* state of their own precinct, and come after the packets of the */
+    /* previous layers of that precinct whatever the progression order */
+    while (opj_pi_next(l_pi)) {
+        if (l_pi->layno == p_t2->est_layno) {
+            l_nb_bytes = 0;
+
+            if (! opj_t2_encode_packet(p_tile_no, p_tile, l_tcp, l_pi,
+                                       l_current_data, &l_nb_bytes, l_max_len, NULL,
+                                       THRESH_CALC, p_manager)) {
+                return OPJ_FALSE;
+            }
+
+            l_current_data += l_nb_bytes;
+            l_max_len -= l_nb_bytes;
+        }
+    }
+
+    * p_data_written = (OPJ_UINT32)(l_current_data - p_dest);
+
+    return OPJ_TRUE;
+}
+
 /* see issue 80 */
 #if 0
 #define JAS_FPRINTF fprintf
@@ -390,6 +652,152 @@ static void opj_null_jas_fprintf(FILE* file, const char * format, ...)
 #define JAS_FPRINTF opj_null_jas_fprintf
 #endif
 
+static void opj_t2_decode_packets_job(void* user_data, opj_tls_t* tls)
+{
+    opj_t2_decode_packets_job_t* job = (opj_t2_decode_packets_job_t*)user_data;
+    opj_pi_iterator_t l_pi;
+    OPJ_UINT32 i;
+
+    (void)tls;
+
+    memset(&l_pi, 0, sizeof(l_pi));
+    for (i = 0; i < job->nb_packets; ++i) {
+        const opj_t2_packet_t* l_packet = &(job->packets[job->packet_indices[i]]);
+        OPJ_UINT32 l_nb_bytes_read = 0;
+
+        l_pi.compno = l_packet->compno;
+        l_pi.resno = l_packet->resno;
+        l_pi.precno = l_packet->precno;
+        l_pi.layno = l_packet->layno;
+        if (! opj_t2_decode_packet(&(job->t2), job->tile, job->tcp, &l_pi,
+                                   job->src + l_packet->offset, &l_nb_bytes_read,
+                                   l_packet->length, NULL, job->p_manager)) {
+            job->ret = OPJ_FALSE;
+            return;
+        }
+    }
+    job->ret = OPJ_TRUE;
+}
+
+static OPJ_BOOL opj_t2_decode_packets_concurrently(opj_tcd_t* tcd,
+        opj_t2_t *p_t2,
+        opj_tcd_tile_t *p_tile,
+        opj_tcp_t *p_tcp,
+        OPJ_BYTE *p_src,
+        const opj_t2_packet_t *p_packets,
+        OPJ_UINT32 p_nb_packets,
+        opj_event_mgr_t *p_manager)
+{
+    const OPJ_UINT32 l_nb_jobs = (OPJ_UINT32)opj_thread_pool_get_thread_count(
+                                     tcd->thread_pool);
+    opj_t2_decode_packets_job_t* l_jobs = NULL;
+    OPJ_UINT32* l_prec_offsets = NULL;
+    OPJ_UINT32* l_job_of_packet = NULL;
+    OPJ_UINT32* l_packet_indices = NULL;
+    OPJ_UINT32* l_job_starts = NULL;
+    opj_arena_t** l_arenas = NULL;
+    opj_mutex_t* l_mutex = NULL;
+    opj_locked_event_mgr_t l_locked_event_mgr;
+    OPJ_UINT32 l_nb_offsets = 0;
+    OPJ_UINT32 compno, resno, i;
+    OPJ_BOOL l_ret = OPJ_FALSE;
+
+    if (p_nb_packets == 0) {
+        return OPJ_TRUE;
+    }
+
+    /* Number the precincts of the tile, so as to distribute them among */
+    /* the jobs */
+    for (compno = 0; compno < p_tile->numcomps; ++compno) {
+        l_nb_offsets += p_tile->comps[compno].numresolutions;
+    }
+    l_prec_offsets = (OPJ_UINT32*)opj_malloc(l_nb_offsets * sizeof(OPJ_UINT32));
+    l_job_of_packet = (OPJ_UINT32*)opj_malloc(p_nb_packets * sizeof(OPJ_UINT32));
+    l_packet_indices = (OPJ_UINT32*)opj_malloc(p_nb_packets * sizeof(OPJ_UINT32));
+    l_job_starts = (OPJ_UINT32*)opj_calloc(l_nb_jobs + 1, sizeof(OPJ_UINT32));
+    l_jobs = (opj_t2_decode_packets_job_t*)opj_calloc(l_nb_jobs,
+             sizeof(opj_t2_decode_packets_job_t));
+    l_mutex = opj_mutex_create();
+    if (tcd->arena) {
+        l_arenas = opj_tcd_get_t2_arenas(tcd, l_nb_jobs);
+    }
+    if (!l_prec_offsets || !l_job_of_packet || !l_packet_indices ||
+            !l_job_starts || !l_jobs || !l_mutex || (tcd->arena && !l_arenas)) {
+        opj_event_msg(p_manager, EVT_ERROR,
+                      "Not enough memory to decode packets\n");
+        goto cleanup;
+    }
+    l_nb_offsets = 0;
+    {
+        OPJ_UINT32 l_nb_precincts = 0;
+        for (compno = 0; compno < p_tile->numcomps; ++compno) {
+            const opj_tcd_tilecomp_t* l_tilec = &(p_tile->comps[compno]);
+            for (resno = 0; resno < l_tilec->numresolutions; ++resno) {
+                const opj_tcd_resolution_t* l_res = &(l_tilec->resolutions[resno]);
+                l_prec_offsets[l_nb_offsets++] = l_nb_precincts;
+                l_nb_precincts += l_res->pw * l_res->ph;
+            }
+        }
+    }
+
+    /* Sort the packets by job, keeping the codestream order */
+    for (i = 0; i < p_nb_packets; ++i) {
+        const opj_t2_packet_t* l_packet = &(p_packets[i]);
+        OPJ_UINT32 l_offset_index = l_packet->resno;
+
+        for (compno = 0; compno < l_packet->compno; ++compno) {
+            l_offset_index += p_tile->comps[compno].numresolutions;
+        }
+        l_job_of_packet[i] = (l_prec_offsets[l_offset_index] + l_packet->precno) %
+                             l_nb_jobs;
+        ++l_job_starts[l_job_of_packet[i] + 1];
+    }
+    for (i = 0; i < l_nb_jobs; ++i) {
+        l_job_starts[i + 1] += l_job_starts[i];
+    }
+    for (i = 0; i < p_nb_packets; ++i) {
+        opj_t2_decode_packets_job_t* job = &(l_jobs[l_job_of_packet[i]]);
+        l_packet_indices[l_job_starts[l_job_of_packet[i]] + job->nb_packets] = i;
+        ++job->nb_packets;
+    }
+
+    opj_locked_event_mgr_init(&l_locked_event_mgr, p_manager, l_mutex);
+    for (i = 0; i < l_nb_jobs; ++i) {
+        opj_t2_decode_packets_job_t* job = &(l_jobs[i]);
+        job->t2 = *p_t2;
+        job->t2.arena = l_arenas ? l_arenas[i] : NULL;
+        job->tile = p_tile;
+        job->tcp = p_tcp;
+        job->src = p_src;
+        job->packets = p_packets;
+        job->packet_indices = l_packet_indices + l_job_starts[i];
+        job->p_manager = &(l_locked_event_mgr.m_event_mgr);
+        job->ret = OPJ_TRUE;
+        if (job->nb_packets > 0 &&
+                !opj_thread_pool_submit_job(tcd->thread_pool,
+                                            opj_t2_decode_packets_job, job)) {
+            opj_t2_decode_packets_job(job, NULL);
+        }
+    }
+    opj_thread_pool_wait_completion(tcd->thread_pool, 0);
+
+    l_ret = OPJ_TRUE;
+    for (i = 0; i < l_nb_jobs; ++i) {
+        if (! l_jobs[i].ret) {
+            l_ret = OPJ_FALSE;
+        }
+    }
+
+cleanup:
+    opj_mutex_destroy(l_mutex);
+    opj_free(l_jobs);
+    opj_free(l_job_starts);
+    opj_free(l_packet_indices);
+    opj_free(l_job_of_packet);
+    opj_free(l_prec_offsets);
+    return l_ret;
+}
+
 OPJ_BOOL opj_t2_decode_packets(opj_tcd_t* tcd,
                                opj_t2_t *p_t2,
                                OPJ_UINT32 p_tile_no,
@@ -415,6 +823,12 @@ OPJ_BOOL opj_t2_decode_packets(opj_tcd_t* tcd,
 #endif
     opj_packet_info_t *l_pack_info = 00;
     opj_image_comp_t* l_img_comp = 00;
+    /* Index of the current packet in codestream order */
+    OPJ_UINT32 l_packet_no = 0;
+    /* Packets to decode concurrently, or NULL if they are decoded one */
+    /* after the other */
+    opj_t2_packet_t *l_packets = NULL;
+    OPJ_UINT32 l_nb_packets = 0;
 
     OPJ_ARG_NOT_USED(p_cstr_index);
 
@@ -430,6 +844,17 @@ OPJ_BOOL opj_t2_decode_packets(opj_tcd_t* tcd,
         return OPJ_FALSE;
     }
 
+    /* When the position of the packets is known from the PLT markers, */
+    /* their headers are not needed to find the next packet. Packets are */
+    /* then only listed here, and decoded concurrently afterwards. If the */
+    /* list cannot be allocated, they are decoded one after the other */
+    if (tcd->packet_lengths && tcd->nb_packet_lengths > 1 &&
+            tcd->thread_pool &&
+            opj_thread_pool_get_thread_count(tcd->thread_pool) > 1) {
+        l_packets = (opj_t2_packet_t*)opj_malloc(tcd->nb_packet_lengths * sizeof(
+                        opj_t2_packet_t));
+    }
+
 
     l_current_pi = l_pi;
 
@@ -445,12 +870,14 @@ OPJ_BOOL opj_t2_decode_packets(opj_tcd_t* tcd,
         if (l_current_pi->poc.prg == OPJ_PROG_UNKNOWN) {
             /* TODO ADE : add an error */
             opj_pi_destroy(l_pi, l_nb_pocs);
+            opj_free(l_packets);
             return OPJ_FALSE;
         }
 
         first_pass_failed = (OPJ_BOOL*)opj_malloc(l_image->numcomps * sizeof(OPJ_BOOL));
         if (!first_pass_failed) {
             opj_pi_destroy(l_pi, l_nb_pocs);
+            opj_free(l_packets);
             return OPJ_FALSE;
         }
         memset(first_pass_failed, OPJ_TRUE, l_image->numcomps * sizeof(OPJ_BOOL));
@@ -464,7 +891,8 @@ OPJ_BOOL opj_t2_decode_packets(opj_tcd_t* tcd,
 
             /* If the packet layer is greater or equal than the maximum */
             /* number of layers, skip the packet */
-            if (l_current_pi->layno >= l_tcp->num_layers_to_decode) {
+            if (l_current_pi->layno >= l_tcp->num_layers_to_decode &&
+                    !p_t2->all_layers) {
                 skip_packet = OPJ_TRUE;
             }
             /* If the packet resolution number is greater than the minimum */
@@ -507,8 +935,34 @@ OPJ_BOOL opj_t2_decode_packets(opj_tcd_t* tcd,
 
                 first_pass_failed[l_current_pi->compno] = OPJ_FALSE;
 
-                if (! opj_t2_decode_packet(p_t2, p_tile, l_tcp, l_current_pi, l_current_data,
-                                           &l_nb_bytes_read, p_max_len, l_pack_info, p_manager)) {
+                if (l_packets && l_packet_no >= tcd->nb_packet_lengths) {
+                    /* The position of the next packets is not known: */
+                    /* decode the listed ones, then carry on one after */
+                    /* the other */
+                    OPJ_BOOL l_ok = opj_t2_decode_packets_concurrently(tcd, p_t2, p_tile,
+                                    l_tcp, p_src, l_packets, l_nb_packets, p_manager);
+                    opj_free(l_packets);
+                    l_packets = NULL;
+                    if (! l_ok) {
+                        opj_pi_destroy(l_pi, l_nb_pocs);
+                        opj_free(first_pass_failed);
+                        return OPJ_FALSE;
+                    }
+                }
+
+                if (l_packets) {
+                    opj_t2_packet_t* l_packet = &(l_packets[l_nb_packets++]);
+                    l_packet->compno = l_current_pi->compno;
+                    l_packet->resno = l_current_pi->resno;
+                    l_packet->precno = l_current_pi->precno;
+                    l_packet->layno = l_current_pi->layno;
+                    l_packet->offset = (OPJ_UINT32)(l_current_data - p_src);
+                    l_packet->length = opj_uint_min(tcd->packet_lengths[l_packet_no],
+                                                    p_max_len);
+                    l_nb_bytes_read = l_packet->length;
+                } else if (! opj_t2_decode_packet(p_t2, p_tile, l_tcp, l_current_pi,
+                                                  l_current_data, &l_nb_bytes_read, p_max_len,
+                                                  l_pack_info, p_manager)) {
                     opj_pi_destroy(l_pi, l_nb_pocs);
                     opj_free(first_pass_failed);
                     return OPJ_FALSE;
@@ -517,12 +971,20 @@ OPJ_BOOL opj_t2_decode_packets(opj_tcd_t* tcd,
                 l_img_comp = &(l_image->comps[l_current_pi->compno]);
                 l_img_comp->resno_decoded = opj_uint_max(l_current_pi->resno,
                                             l_img_comp->resno_decoded);
+            } else if (tcd->packet_lengths && l_packet_no < tcd->nb_packet_lengths) {
+                /* The length of the packet is known from the PLT markers: */
+                /* jump over it without parsing its header. The following */
+                /* packets of its precinct are skipped as well, so the state */
+                /* of the code-blocks of the precinct is no longer needed */
+                l_nb_bytes_read = opj_uint_min(tcd->packet_lengths[l_packet_no],
+                                               p_max_len);
             } else {
                 l_nb_bytes_read = 0;
                 if (! opj_t2_skip_packet(p_t2, p_tile, l_tcp, l_current_pi, l_current_data,
                                          &l_nb_bytes_read, p_max_len, l_pack_info, p_manager)) {
                     opj_pi_destroy(l_pi, l_nb_pocs);
                     opj_free(first_pass_failed);
+                    opj_free(l_packets);
                     return OPJ_FALSE;
                 }
             }
@@ -537,6 +999,7 @@ OPJ_BOOL opj_t2_decode_packets(opj_tcd_t* tcd,
 
             l_current_data += l_nb_bytes_read;
             p_max_len -= l_nb_bytes_read;
+            ++l_packet_no;
 
             /* INDEX >> */
 #ifdef TODO_MSD
@@ -583,6 +1046,16 @@ OPJ_BOOL opj_t2_decode_packets(opj_tcd_t* tcd,
 
     /* don't forget to release pi */
     opj_pi_destroy(l_pi, l_nb_pocs);
+
+    if (l_packets) {
+        OPJ_BOOL l_ok = opj_t2_decode_packets_concurrently(tcd, p_t2, p_tile, l_tcp,
+                        p_src, l_packets, l_nb_packets, p_manager);
+        opj_free(l_packets);
+        if (! l_ok) {
+            return OPJ_FALSE;
+        }
+    }
+
     *p_data_read = (OPJ_UINT32)(l_current_data - p_src);
     return OPJ_TRUE;
 }
@@ -613,6 +1086,10 @@ opj_t2_t* opj_t2_create(opj_image_t *p_image, opj_cp_t *p_cp)
 void opj_t2_destroy(opj_t2_t *t2)
 {
     if (t2) {
+        if (t2->est_pi) {
+            opj_pi_destroy(t2->est_pi, t2->est_nb_pocs);
+        }
+        opj_free(t2->est_state);
         opj_free(t2);
     }
 }
@@ -684,6 +1161,8 @@ static OPJ_BOOL opj_t2_encode_packet(OPJ_UINT32 tileno,
 
     opj_tcd_tilecomp_t *tilec = &tile->comps[compno];
     opj_tcd_resolution_t *res = &tilec->resolutions[resno];
+    const OPJ_BOOL l_is_ht = (tcp->tccps[compno].cblksty &
+                              J2K_CCP_CBLKSTY_HT) != 0;
 
     opj_bio_t *bio = 00;    /* BIO component */
 #ifdef ENABLE_EMPTY_PACKET_OPTIMIZATION
@@ -843,7 +1322,7 @@ static OPJ_BOOL opj_t2_encode_packet(OPJ_UINT32 tileno,
             OPJ_UINT32 increment = 0;
             OPJ_UINT32 nump = 0;
             OPJ_UINT32 len = 0, passno;
-            OPJ_UINT32 l_nb_passes;
+            OPJ_UINT32 l_first_pass, l_nb_passes;
 
             /* cblk inclusion bits */
             if (!cblk->numpasses) {
@@ -865,16 +1344,24 @@ static OPJ_BOOL opj_t2_encode_packet(OPJ_UINT32 tileno,
             }
 
             /* number of coding passes included */
-            opj_t2_putnumpasses(bio, layer->numpasses);
-            l_nb_passes = cblk->numpasses + layer->numpasses;
-            pass = cblk->passes +  cblk->numpasses;
+            if (l_is_ht) {
+                /* A single cleanup pass, the truncation point chosen by */
+                /* opj_tcd_makelayer_comp() */
+                l_first_pass = layer->numpasses - 1;
+                l_nb_passes = layer->numpasses;
+            } else {
+                l_first_pass = cblk->numpasses;
+                l_nb_passes = cblk->numpasses + layer->numpasses;
+            }
+            opj_t2_putnumpasses(bio, l_nb_passes - l_first_pass);
+            pass = cblk->passes + l_first_pass;
 
             /* computation of the increase of the length indicator and insertion in the header     */
-            for (passno = cblk->numpasses; passno < l_nb_passes; ++passno) {
+            for (passno = l_first_pass; passno < l_nb_passes; ++passno) {
                 ++nump;
                 len += pass->len;
 
-                if (pass->term || passno == (cblk->numpasses + layer->numpasses) - 1) {
+                if (pass->term || passno == l_nb_passes - 1) {
                     increment = (OPJ_UINT32)opj_int_max((OPJ_INT32)increment,
                                                         opj_int_floorlog2((OPJ_INT32)len) + 1
                                                         - ((OPJ_INT32)cblk->numlenbits + opj_int_floorlog2((OPJ_INT32)nump)));
@@ -889,13 +1376,13 @@ static OPJ_BOOL opj_t2_encode_packet(OPJ_UINT32 tileno,
             /* computation of the new Length indicator */
             cblk->numlenbits += increment;
 
-            pass = cblk->passes +  cblk->numpasses;
+            pass = cblk->passes + l_first_pass;
             /* insertion of the codeword segment length */
-            for (passno = cblk->numpasses; passno < l_nb_passes; ++passno) {
+            for (passno = l_first_pass; passno < l_nb_passes; ++passno) {
                 nump++;
                 len += pass->len;
 
-                if (pass->term || passno == (cblk->numpasses + layer->numpasses) - 1) {
+                if (pass->term || passno == l_nb_passes - 1) {
                     opj_bio_write(bio, (OPJ_UINT32)len,
                                   cblk->numlenbits + (OPJ_UINT32)opj_int_floorlog2((OPJ_INT32)nump));
                     len = 0;
@@ -1100,6 +1587,9 @@ static OPJ_BOOL opj_t2_read_packet_header(opj_t2_t* p_t2,
                 for (cblkno = 0; cblkno < l_nb_code_blocks; ++cblkno) {
                     l_cblk->numsegs = 0;
                     l_cblk->real_num_segs = 0;
+                    /* Chunks left by a previous decoding of the tile */
+                    l_cblk->numchunks = 0;
+                    l_cblk->corrupted = OPJ_FALSE;
                     ++l_cblk;
                 }
             }
@@ -1256,7 +1746,8 @@ static OPJ_BOOL opj_t2_read_packet_header(opj_t2_t* p_t2,
             l_segno = 0;
 
             if (!l_cblk->numsegs) {
-                if (! opj_t2_init_seg(l_cblk, l_segno, p_tcp->tccps[p_pi->compno].cblksty, 1)) {
+                if (! opj_t2_init_seg(l_cblk, l_segno, p_tcp->tccps[p_pi->compno].cblksty, 1,
+                                      p_t2->arena)) {
                     opj_bio_destroy(l_bio);
                     return OPJ_FALSE;
                 }
@@ -1264,7 +1755,8 @@ static OPJ_BOOL opj_t2_read_packet_header(opj_t2_t* p_t2,
                 l_segno = l_cblk->numsegs - 1;
                 if (l_cblk->segs[l_segno].numpasses == l_cblk->segs[l_segno].maxpasses) {
                     ++l_segno;
-                    if (! opj_t2_init_seg(l_cblk, l_segno, p_tcp->tccps[p_pi->compno].cblksty, 0)) {
+                    if (! opj_t2_init_seg(l_cblk, l_segno, p_tcp->tccps[p_pi->compno].cblksty, 0,
+                                          p_t2->arena)) {
                         opj_bio_destroy(l_bio);
                         return OPJ_FALSE;
                     }
@@ -1294,7 +1786,8 @@ static OPJ_BOOL opj_t2_read_packet_header(opj_t2_t* p_t2,
                     if (n > 0) {
                         ++l_segno;
 
-                        if (! opj_t2_init_seg(l_cblk, l_segno, p_tcp->tccps[p_pi->compno].cblksty, 0)) {
+                        if (! opj_t2_init_seg(l_cblk, l_segno, p_tcp->tccps[p_pi->compno].cblksty, 0,
+                                              p_t2->arena)) {
                             opj_bio_destroy(l_bio);
                             return OPJ_FALSE;
                         }
@@ -1323,7 +1816,8 @@ static OPJ_BOOL opj_t2_read_packet_header(opj_t2_t* p_t2,
                     if (n > 0) {
                         ++l_segno;
 
-                        if (! opj_t2_init_seg(l_cblk, l_segno, p_tcp->tccps[p_pi->compno].cblksty, 0)) {
+                        if (! opj_t2_init_seg(l_cblk, l_segno, p_tcp->tccps[p_pi->compno].cblksty, 0,
+                                              p_t2->arena)) {
                             opj_bio_destroy(l_bio);
                             return OPJ_FALSE;
                         }
@@ -1381,6 +1875,21 @@ static OPJ_BOOL opj_t2_read_packet_header(opj_t2_t* p_t2,
     return OPJ_TRUE;
 }
 
+static void opj_t2_set_cblk_corrupted(opj_t2_t* p_t2,
+                                      opj_tcd_cblk_dec_t* p_cblk,
+                                      OPJ_UINT32 p_layno)
+{
+    if (!p_cblk->corrupted) {
+        p_cblk->corrupted = OPJ_TRUE;
+        p_cblk->corrupted_layno = p_layno;
+    }
+    /* When all the layers are read, the chunks of the layers before the */
+    /* corrupted one are kept for decoding fewer layers */
+    if (!p_t2->all_layers) {
+        p_cblk->numchunks = 0;
+    }
+}
+
 static OPJ_BOOL opj_t2_read_packet_data(opj_t2_t* p_t2,
                                         opj_tcd_tile_t *p_tile,
                                         opj_pi_iterator_t *p_pi,
@@ -1427,8 +1936,7 @@ static OPJ_BOOL opj_t2_read_packet_data(opj_t2_t* p_t2,
                  * or if this code block was corrupted in a previous layer,
                  * then mark it as corrupted.
                  */
-                l_cblk->numchunks = 0;
-                l_cblk->corrupted = OPJ_TRUE;
+                opj_t2_set_cblk_corrupted(p_t2, l_cblk, p_pi->layno);
                 continue;
             }
 
@@ -1465,8 +1973,7 @@ static OPJ_BOOL opj_t2_read_packet_data(opj_t2_t* p_t2,
                          * packet) since it is a partial read
                          */
                         partial_buffer = OPJ_TRUE;
-                        l_cblk->corrupted = OPJ_TRUE;
-                        l_cblk->numchunks = 0;
+                        opj_t2_set_cblk_corrupted(p_t2, l_cblk, p_pi->layno);
                         break;
                     }
                 }
@@ -1494,9 +2001,16 @@ static OPJ_BOOL opj_t2_read_packet_data(opj_t2_t* p_t2,
 
                 if (l_cblk->numchunks == l_cblk->numchunksalloc) {
                     OPJ_UINT32 l_numchunksalloc = l_cblk->numchunksalloc * 2 + 1;
-                    opj_tcd_seg_data_chunk_t* l_chunks =
-                        (opj_tcd_seg_data_chunk_t*)opj_realloc(l_cblk->chunks,
-                                l_numchunksalloc * sizeof(opj_tcd_seg_data_chunk_t));
+                    opj_tcd_seg_data_chunk_t* l_chunks;
+                    if (p_t2->arena) {
+                        l_chunks = (opj_tcd_seg_data_chunk_t*)opj_arena_realloc(p_t2->arena,
+                                   l_cblk->chunks,
+                                   l_cblk->numchunksalloc * sizeof(opj_tcd_seg_data_chunk_t),
+                                   l_numchunksalloc * sizeof(opj_tcd_seg_data_chunk_t));
+                    } else {
+                        l_chunks = (opj_tcd_seg_data_chunk_t*)opj_realloc(l_cblk->chunks,
+                                   l_numchunksalloc * sizeof(opj_tcd_seg_data_chunk_t));
+                    }
                     if (l_chunks == NULL) {
                         opj_event_msg(p_manager, EVT_ERROR,
                                       "cannot allocate opj_tcd_seg_data_chunk_t* array");
@@ -1508,6 +2022,10 @@ static OPJ_BOOL opj_t2_read_packet_data(opj_t2_t* p_t2,
 
                 l_cblk->chunks[l_cblk->numchunks].data = l_current_data;
                 l_cblk->chunks[l_cblk->numchunks].len = l_seg->newlen;
+                l_cblk->chunks[l_cblk->numchunks].layno = p_pi->layno;
+                l_cblk->chunks[l_cblk->numchunks].segno =
+                    (OPJ_UINT32)(l_seg - l_cblk->segs);
+                l_cblk->chunks[l_cblk->numchunks].numpasses = l_seg->numnewpasses;
                 l_cblk->numchunks ++;
 
                 l_current_data += l_seg->newlen;
@@ -1659,7 +2177,8 @@ static OPJ_BOOL opj_t2_skip_packet_data(opj_t2_t* p_t2,
 static OPJ_BOOL opj_t2_init_seg(opj_tcd_cblk_dec_t* cblk,
                                 OPJ_UINT32 index,
                                 OPJ_UINT32 cblksty,
-                                OPJ_UINT32 first)
+                                OPJ_UINT32 first,
+                                opj_arena_t* p_arena)
 {
     opj_tcd_seg_t* seg = 00;
     OPJ_UINT32 l_nb_segs = index + 1;
@@ -1669,8 +2188,14 @@ static OPJ_BOOL opj_t2_init_seg(opj_tcd_cblk_dec_t* cblk,
         OPJ_UINT32 l_m_current_max_segs = cblk->m_current_max_segs +
                                           OPJ_J2K_DEFAULT_NB_SEGS;
 
-        new_segs = (opj_tcd_seg_t*) opj_realloc(cblk->segs,
-                                                l_m_current_max_segs * sizeof(opj_tcd_seg_t));
+        if (p_arena) {
+            new_segs = (opj_tcd_seg_t*) opj_arena_realloc(p_arena, cblk->segs,
+                       cblk->m_current_max_segs * sizeof(opj_tcd_seg_t),
+                       l_m_current_max_segs * sizeof(opj_tcd_seg_t));
+        } else {
+            new_segs = (opj_tcd_seg_t*) opj_realloc(cblk->segs,
+                       l_m_current_max_segs * sizeof(opj_tcd_seg_t));
+        }
         if (! new_segs) {
             /* opj_event_msg(p_manager, EVT_ERROR, "Not enough memory to initialize segment %d\n", l_nb_segs); */
             return OPJ_FALSE;
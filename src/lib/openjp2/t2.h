@@ -57,6 +57,26 @@ typedef struct opj_t2 {
     opj_image_t *image;
     /** pointer to the image coding parameters */
     opj_cp_t *cp;
+    /** Decoding: arena the segments and chunks of the code-blocks are allocated from, or NULL */
+    opj_arena_t *arena;
+    /** Decoding: whether the packets of all the quality layers are read, and not only those of the first tcp->num_layers_to_decode ones, so that their chunks can be selected afterwards without reading the packets again */
+    OPJ_BOOL all_layers;
+    /** Encoding: layer whose size is estimated by opj_t2_estimate_layer_size() */
+    OPJ_UINT32 est_layno;
+    /** Encoding: size limit of the packets of the layers up to est_layno */
+    OPJ_UINT32 est_max_len;
+    /** Encoding: size of the packets of the layers before est_layno */
+    OPJ_UINT32 est_prev_len;
+    /** Encoding: whether the packets of the layers before est_layno fit in the size limit */
+    OPJ_BOOL est_prev_ok;
+    /** Encoding: packet iterator reused by opj_t2_estimate_layer_size() */
+    opj_pi_iterator_t *est_pi;
+    /** Encoding: number of packet iterators of est_pi */
+    OPJ_UINT32 est_nb_pocs;
+    /** Encoding: coding state of the tag trees and code-blocks after the layers before est_layno */
+    OPJ_BYTE *est_state;
+    /** Encoding: size in bytes of est_state */
+    OPJ_SIZE_T est_state_size;
 } opj_t2_t;
 
 /** @name Exported functions */
@@ -95,6 +115,59 @@ OPJ_BOOL opj_t2_encode_packets(opj_t2_t* t2,
                                J2K_T2_MODE t2_mode,
                                opj_event_mgr_t *p_manager);
 
+/**
+Tell whether opj_t2_init_layer_size_estimation() and opj_t2_estimate_layer_size()
+can replace opj_t2_encode_packets() in THRESH_CALC mode for a tile. This is
+not the case when the threshold calculation is restricted to tile-parts or
+to the size of components (cinema and IMF profiles).
+@param t2               T2 handle
+@return OPJ_TRUE if the size of the layers can be estimated incrementally
+*/
+OPJ_BOOL opj_t2_can_estimate_layer_size(const opj_t2_t* t2);
+
+/**
+Prepare the estimation of the size of the packets of the layers up to layno,
+while the code-block truncation points of layno are searched. The packets of
+the layers before layno, whose truncation points are final, are encoded once,
+and the resulting coding state of the tag trees and code-blocks is saved so
+that opj_t2_estimate_layer_size() only has to encode the packets of layno.
+@param t2               T2 handle
+@param tileno           number of the tile encoded
+@param tile             the tile for which to estimate the packets
+@param layno            the layer whose truncation points are searched
+@param dest             the destination buffer
+@param len              the size limit of the packets of the layers up to layno
+@param p_manager        the user event manager
+@return OPJ_FALSE in case of error
+*/
+OPJ_BOOL opj_t2_init_layer_size_estimation(opj_t2_t* t2,
+        OPJ_UINT32 tileno,
+        opj_tcd_tile_t *tile,
+        OPJ_UINT32 layno,
+        OPJ_BYTE *dest,
+        OPJ_UINT32 len,
+        opj_event_mgr_t *p_manager);
+
+/**
+Check that the packets of the layers up to the one given to
+opj_t2_init_layer_size_estimation() fit in its size limit, with the current
+truncation points of that layer. This gives the same result as
+opj_t2_encode_packets() in THRESH_CALC mode.
+@param t2               T2 handle
+@param tileno           number of the tile encoded
+@param tile             the tile for which to estimate the packets
+@param dest             the destination buffer
+@param p_data_written   size of the packets of the layers up to layno
+@param p_manager        the user event manager
+@return OPJ_TRUE if the packets fit in the size limit
+*/
+OPJ_BOOL opj_t2_estimate_layer_size(opj_t2_t* t2,
+                                    OPJ_UINT32 tileno,
+                                    opj_tcd_tile_t *tile,
+                                    OPJ_BYTE *dest,
+                                    OPJ_UINT32 * p_data_written,
+                                    opj_event_mgr_t *p_manager);
+
 /**
 Decode the packets of a tile from a source buffer
 @param tcd TCD handle
@@ -120,13 +120,14 @@ static INLINE OPJ_BOOL opj_tcd_init_tile(opj_tcd_t *p_tcd, OPJ_UINT32 p_tile_no,
 /**
 * Allocates memory for a decoding code block.
 */
-static OPJ_BOOL opj_tcd_code_block_dec_allocate(opj_tcd_cblk_dec_t *
-        p_code_block);
+static OPJ_BOOL opj_tcd_code_block_dec_allocate(opj_tcd_t *p_tcd,
+        opj_tcd_cblk_dec_t * p_code_block);
 
 /**
  * Deallocates the decoding data of the given precinct.
  */
-static void opj_tcd_code_block_dec_deallocate(opj_tcd_precinct_t * p_precinct);
+static void opj_tcd_code_block_dec_deallocate(opj_tcd_t *p_tcd,
+        opj_tcd_precinct_t * p_precinct);
 
 /**
  * Allocates memory for an encoding code block (but not data).
@@ -155,6 +156,59 @@ Free the memory allocated for encoding
 */
 static void opj_tcd_free_tile(opj_tcd_t *tcd);
 
+/**
+Free the coding structures of the tile (resolutions, precincts, code-blocks).
+When they are allocated from the arena of the tile decoder, they are all
+released at once by resetting it.
+@param p_tcd TCD handle
+*/
+static void opj_tcd_free_tile_structures(opj_tcd_t *p_tcd);
+
+/**
+Allocate a coding structure of the tile, initialized to 0, from the arena of
+the tile decoder if there is one.
+*/
+static void* opj_tcd_calloc_structure(opj_tcd_t *p_tcd, size_t p_size);
+
+
+/**
+Set the tile, the window of interest and the components to decode, and
+determine whether the whole tile is decoded.
+*/
+static OPJ_BOOL opj_tcd_decode_tile_init(opj_tcd_t *p_tcd,
+        OPJ_UINT32 win_x0,
+        OPJ_UINT32 win_y0,
+        OPJ_UINT32 win_x1,
+        OPJ_UINT32 win_y1,
+        OPJ_UINT32 numcomps_to_decode,
+        const OPJ_UINT32 *comps_indices,
+        OPJ_UINT32 p_tile_no);
+
+/**
+Compute the restricted tile-component and tile-resolution coordinates of the
+window of interest, for subtile decoding.
+*/
+static OPJ_BOOL opj_tcd_set_decode_window(opj_tcd_t *p_tcd,
+        opj_event_mgr_t *p_manager);
+
+/**
+Allocate the data buffers of the tile components, for whole tile decoding.
+*/
+static OPJ_BOOL opj_tcd_alloc_whole_tile_data(opj_tcd_t *p_tcd,
+        opj_event_mgr_t *p_manager);
+
+/**
+Allocate the data_win buffers of the tile components, for subtile decoding,
+once the resno_decoded is known.
+*/
+static OPJ_BOOL opj_tcd_alloc_decode_window_data(opj_tcd_t *p_tcd,
+        opj_event_mgr_t *p_manager);
+
+/**
+Free the data_win buffer of a tile component, if any.
+*/
+static void opj_tcd_free_decode_window_data(opj_tcd_t *p_tcd,
+        opj_tcd_tilecomp_t *p_tilec);
 
 static OPJ_BOOL opj_tcd_t2_decode(opj_tcd_t *p_tcd,
                                   OPJ_BYTE * p_src_data,
@@ -163,6 +217,22 @@ static OPJ_BOOL opj_tcd_t2_decode(opj_tcd_t *p_tcd,
                                   opj_codestream_index_t *p_cstr_index,
                                   opj_event_mgr_t *p_manager);
 
+/**
+Whether the packets read by the previous tier-2 decoding of the tile, for all
+its quality layers, can be used for the current decoding.
+*/
+static OPJ_BOOL opj_tcd_is_t2_reusable(opj_tcd_t *p_tcd,
+                                       OPJ_BYTE * p_src_data,
+                                       OPJ_UINT32 p_max_src_size);
+
+/**
+Select the chunks of the code-blocks for the quality layers to decode, among
+those of all the layers read by the tier-2 decoding.
+@param p_tcd TCD handle
+@param p_t2_done Whether the packets have just been read
+*/
+static void opj_tcd_select_layers(opj_tcd_t *p_tcd, OPJ_BOOL p_t2_done);
+
 static OPJ_BOOL opj_tcd_t1_decode(opj_tcd_t *p_tcd,
                                   opj_event_mgr_t *p_manager);
 
@@ -173,6 +243,28 @@ static OPJ_BOOL opj_tcd_mct_decode(opj_tcd_t *p_tcd,
 
 static OPJ_BOOL opj_tcd_dc_level_shift_decode(opj_tcd_t *p_tcd);
 
+/**
+Decode the code-blocks and apply the inverse DWT, when decoding a whole tile
+with several threads. The inverse DWT of a resolution level is started as
+soon as the code-blocks of that resolution are decoded, while the worker
+threads decode the code-blocks of the higher resolutions.
+@param p_tcd TCD handle
+@param p_manager the event manager
+*/
+static OPJ_BOOL opj_tcd_t1_dwt_decode_pipelined(opj_tcd_t *p_tcd,
+        opj_event_mgr_t *p_manager);
+
+/**
+Apply the MCT and the DC level shift, when decoding a whole tile. Both are
+applied on strips of rows, that are processed by the threads of the thread
+pool, so that the samples are still in cache when the DC level shift is
+applied.
+@param p_tcd TCD handle
+@param p_manager the event manager
+*/
+static OPJ_BOOL opj_tcd_mct_dc_level_shift_decode_strips(opj_tcd_t *p_tcd,
+        opj_event_mgr_t *p_manager);
+
 
 static OPJ_BOOL opj_tcd_dc_level_shift_encode(opj_tcd_t *p_tcd);
 
@@ -200,12 +292,51 @@ static OPJ_BOOL opj_tcd_rate_allocate_encode(opj_tcd_t *p_tcd,
 static OPJ_BOOL opj_tcd_is_whole_tilecomp_decoding(opj_tcd_t *tcd,
         OPJ_UINT32 compno);
 
+/** Reads the clocks at the start of a decoding stage, if statistics are */
+/** collected. The CPU time of the stage is the one of this thread, plus */
+/** the one of the jobs it submits to the thread pool of the tile decoder */
+#define OPJ_TCD_STAGE_BEGIN(p_tcd, l_start) \
+    do { \
+        if ((p_tcd)->stats) { \
+            opj_stage_time_start(&(l_start)); \
+            (l_start).cpu_time += opj_thread_pool_get_jobs_cpu_time( \
+                                      (p_tcd)->thread_pool); \
+        } \
+    } while (0)
+
+/** Adds the time elapsed since OPJ_TCD_STAGE_BEGIN() to *p_time. Must */
+/** only be called if statistics are collected */
+#define OPJ_TCD_STAGE_ADD_SINCE(p_tcd, l_start, p_time) \
+    do { \
+        (l_start).cpu_time -= opj_thread_pool_get_jobs_cpu_time( \
+                                  (p_tcd)->thread_pool); \
+        opj_stage_time_add_since(p_time, &(l_start)); \
+    } while (0)
+
+/** Adds the time elapsed since OPJ_TCD_STAGE_BEGIN() to a decoding stage */
+#define OPJ_TCD_STAGE_END(p_tcd, l_start, stage) \
+    do { \
+        if ((p_tcd)->stats) { \
+            OPJ_TCD_STAGE_ADD_SINCE(p_tcd, l_start, \
+                                    &((p_tcd)->stats->stages[stage])); \
+        } \
+    } while (0)
+
+/** Returns the tier-1 decoding stage of the code-blocks of the tile */
+static OPJ_DECODE_STAGE opj_tcd_t1_stage(const opj_tcd_t *p_tcd)
+{
+    return (p_tcd->tcp->tccps->cblksty & J2K_CCP_CBLKSTY_HT) ?
+           OPJ_STAGE_T1_HT : OPJ_STAGE_T1_MQ;
+}
+
 /* ----------------------------------------------------------------------- */
 
 /**
 Create a new TCD handle
 */
-opj_tcd_t* opj_tcd_create(OPJ_BOOL p_is_decoder)
+opj_tcd_t* opj_tcd_create(OPJ_BOOL p_is_decoder,
+                          const opj_allocator_t *p_allocator,
+                          opj_mem_counter_t *p_mem_counter)
 {
     opj_tcd_t *l_tcd = 00;
 
@@ -223,6 +354,18 @@ opj_tcd_t* opj_tcd_create(OPJ_BOOL p_is_decoder)
         return 00;
     }
 
+    if (p_is_decoder) {
+        if (p_allocator) {
+            l_tcd->allocator = *p_allocator;
+        }
+        l_tcd->mem_counter = p_mem_counter;
+        l_tcd->arena = opj_arena_create(p_allocator, p_mem_counter);
+        if (!l_tcd->arena) {
+            opj_tcd_destroy(l_tcd);
+            return 00;
+        }
+    }
+
     return l_tcd;
 }
 
@@ -242,25 +385,279 @@ void opj_tcd_rateallocate_fixed(opj_tcd_t *tcd)
 
 /* ----------------------------------------------------------------------- */
 
+/** Work of the rate allocation on one tile component, run by a job of the */
+/** thread pool of the tile coder */
+typedef struct {
+    opj_tcd_t* tcd;
+    OPJ_UINT32 compno;
+    /** Layer whose truncation points are computed by opj_tcd_makelayer_comp() */
+    OPJ_UINT32 layno;
+    /** Threshold given to opj_tcd_makelayer_comp() */
+    OPJ_FLOAT64 thresh;
+    /** Whether the truncation points computed by opj_tcd_makelayer_comp() are final */
+    OPJ_UINT32 final;
+    /** Result of opj_tcd_makelayer_comp() */
+    OPJ_BOOL is_same;
+    /** Minimum and maximum rate-distortion slopes found by opj_tcd_rate_slopes_comp() */
+    OPJ_FLOAT64 min;
+    OPJ_FLOAT64 max;
+} opj_tcd_rateallocate_job_t;
+
+/** Computes the number of pixels of a tile component, and the minimum and
+ * maximum rate-distortion slopes of the coding passes of its code-blocks */
+static void opj_tcd_rate_slopes_comp(opj_tcd_t *tcd,
+                                     OPJ_UINT32 compno,
+                                     OPJ_FLOAT64* p_min,
+                                     OPJ_FLOAT64* p_max)
+{
+    OPJ_UINT32 resno, bandno, precno, cblkno;
+    OPJ_UINT32 passno;
+    OPJ_FLOAT64 min = DBL_MAX;
+    OPJ_FLOAT64 max = 0;
+
+    opj_tcd_tilecomp_t *tilec = &tcd->tcd_image->tiles->comps[compno];
+    tilec->numpix = 0;
+
+    for (resno = 0; resno < tilec->numresolutions; resno++) {
+        opj_tcd_resolution_t *res = &tilec->resolutions[resno];
+
+        for (bandno = 0; bandno < res->numbands; bandno++) {
+            opj_tcd_band_t *band = &res->bands[bandno];
+
+            /* Skip empty bands */
+            if (opj_tcd_is_band_empty(band)) {
+                continue;
+            }
+
+            for (precno = 0; precno < res->pw * res->ph; precno++) {
+                opj_tcd_precinct_t *prc = &band->precincts[precno];
+
+                for (cblkno = 0; cblkno < prc->cw * prc->ch; cblkno++) {
+                    opj_tcd_cblk_enc_t *cblk = &prc->cblks.enc[cblkno];
+
+                    for (passno = 0; passno < cblk->totalpasses; passno++) {
+                        opj_tcd_pass_t *pass = &cblk->passes[passno];
+                        OPJ_INT32 dr;
+                        OPJ_FLOAT64 dd, rdslope;
+
+                        if (passno == 0) {
+                            dr = (OPJ_INT32)pass->rate;
+                            dd = pass->distortiondec;
+                        } else {
+                            dr = (OPJ_INT32)(pass->rate - cblk->passes[passno - 1].rate);
+                            dd = pass->distortiondec - cblk->passes[passno - 1].distortiondec;
+                        }
+
+                        if (dr == 0) {
+                            continue;
+                        }
+
+                        rdslope = dd / dr;
+                        if (rdslope < min) {
+                            min = rdslope;
+                        }
+
+                        if (rdslope > max) {
+                            max = rdslope;
+                        }
+                    } /* passno */
+
+                    tilec->numpix += (OPJ_SIZE_T)((cblk->x1 - cblk->x0) *
+                                                  (cblk->y1 - cblk->y0));
+                } /* cbklno */
+            } /* precno */
+        } /* bandno */
+    } /* resno */
+
+    *p_min = min;
+    *p_max = max;
+}
+
+/** Computes the truncation points of the code-blocks of a tile component for
+ * a layer. The distortion of the included passes is added to *p_disto if
+ * p_disto is not NULL.
+ * Returns OPJ_TRUE if the layer allocation of the component is unchanged
+ * w.r.t to the previous invocation with a different threshold */
+static OPJ_BOOL opj_tcd_makelayer_comp(opj_tcd_t *tcd,
+                                       OPJ_UINT32 compno,
+                                       OPJ_UINT32 layno,
+                                       OPJ_FLOAT64 thresh,
+                                       OPJ_UINT32 final,
+                                       OPJ_FLOAT64* p_disto)
+{
+    OPJ_UINT32 resno, bandno, precno, cblkno;
+    OPJ_UINT32 passno;
+
+    opj_tcd_tilecomp_t *tilec = &tcd->tcd_image->tiles->comps[compno];
+    OPJ_BOOL layer_allocation_is_same = OPJ_TRUE;
+    /* The truncation points of HT code-blocks are alternative cleanup */
+    /* passes (see opj_t1_encode_ht_cblk()), and only one of them can be */
+    /* included, in a single layer */
+    const OPJ_BOOL is_ht = (tcd->tcp->tccps[compno].cblksty &
+                            J2K_CCP_CBLKSTY_HT) != 0;
+
+    for (resno = 0; resno < tilec->numresolutions; resno++) {
+        opj_tcd_resolution_t *res = &tilec->resolutions[resno];
+
+        for (bandno = 0; bandno < res->numbands; bandno++) {
+            opj_tcd_band_t *band = &res->bands[bandno];
+
+            /* Skip empty bands */
+            if (opj_tcd_is_band_empty(band)) {
+                continue;
+            }
+
+            for (precno = 0; precno < res->pw * res->ph; precno++) {
+                opj_tcd_precinct_t *prc = &band->precincts[precno];
+
+                for (cblkno = 0; cblkno < prc->cw * prc->ch; cblkno++) {
+                    opj_tcd_cblk_enc_t *cblk = &prc->cblks.enc[cblkno];
+                    opj_tcd_layer_t *layer = &cblk->layers[layno];
+                    OPJ_UINT32 n;
+
+                    if (layno == 0) {
+                        cblk->numpassesinlayers = 0;
+                    }
+
+                    n = cblk->numpassesinlayers;
+
+                    if (is_ht && n != 0) {
+                        /* Already included in a previous layer */
+                    } else if (thresh < 0) {
+                        /* Special value to indicate to use all passes */
+                        n = cblk->totalpasses;
+                    } else {
+                        for (passno = cblk->numpassesinlayers; passno < cblk->totalpasses; passno++) {
+                            OPJ_UINT32 dr;
+                            OPJ_FLOAT64 dd;
+                            opj_tcd_pass_t *pass = &cblk->passes[passno];
+
+                            if (n == 0) {
+                                dr = pass->rate;
+                                dd = pass->distortiondec;
+                            } else {
+                                dr = pass->rate - cblk->passes[n - 1].rate;
+                                dd = pass->distortiondec - cblk->passes[n - 1].distortiondec;
+                            }
+
+                            if (!dr) {
+                                if (dd != 0) {
+                                    n = passno + 1;
+                                }
+                                continue;
+                            }
+                            if (thresh - (dd / dr) <
+                                    DBL_EPSILON) { /* do not rely on float equality, check with DBL_EPSILON margin */
+                                n = passno + 1;
+                            }
+                        }
+                    }
+
+                    if (layer->numpasses != n - cblk->numpassesinlayers) {
+                        layer_allocation_is_same = OPJ_FALSE;
+                        layer->numpasses = n - cblk->numpassesinlayers;
+                    }
+
+                    if (!layer->numpasses) {
+                        layer->disto = 0;
+                        continue;
+                    }
+
+                    if (is_ht) {
+                        layer->data = cblk->data;
+                        for (passno = 0; passno < n - 1; passno++) {
+                            layer->data += cblk->passes[passno].len;
+                        }
+                        layer->len = cblk->passes[n - 1].len;
+                        layer->disto = cblk->passes[n - 1].distortiondec;
+                        cblk->numbps = cblk->totalpasses - (n - 1);
+                    } else if (cblk->numpassesinlayers == 0) {
+                        layer->len = cblk->passes[n - 1].rate;
+                        layer->data = cblk->data;
+                        layer->disto = cblk->passes[n - 1].distortiondec;
+                    } else {
+                        layer->len = cblk->passes[n - 1].rate - cblk->passes[cblk->numpassesinlayers -
+                                     1].rate;
+                        layer->data = cblk->data + cblk->passes[cblk->numpassesinlayers - 1].rate;
+                        layer->disto = cblk->passes[n - 1].distortiondec -
+                                       cblk->passes[cblk->numpassesinlayers - 1].distortiondec;
+                    }
+
+                    if (p_disto) {
+                        *p_disto += layer->disto;
+                    }
+
+                    if (final) {
+                        cblk->numpassesinlayers = n;
+                    }
+                }
+            }
+        }
+    }
+    return layer_allocation_is_same;
+}
+
+static void opj_tcd_rate_slopes_func(void* user_data, opj_tls_t* tls)
+{
+    opj_tcd_rateallocate_job_t* job = (opj_tcd_rateallocate_job_t*)user_data;
+    (void)tls;
+    opj_tcd_rate_slopes_comp(job->tcd, job->compno, &job->min, &job->max);
+}
+
+static void opj_tcd_makelayer_func(void* user_data, opj_tls_t* tls)
+{
+    opj_tcd_rateallocate_job_t* job = (opj_tcd_rateallocate_job_t*)user_data;
+    (void)tls;
+    job->is_same = opj_tcd_makelayer_comp(job->tcd, job->compno, job->layno,
+                                          job->thresh, job->final, NULL);
+}
+
 /** Returns OPJ_TRUE if the layer allocation is unchanged w.r.t to the previous
- * invocation with a different threshold */
+ * invocation with a different threshold.
+ * If jobs is not NULL, the components are processed in parallel by jobs
+ * of the thread pool of the tile coder, using its numcomps items */
 static
 OPJ_BOOL opj_tcd_makelayer(opj_tcd_t *tcd,
                            OPJ_UINT32 layno,
                            OPJ_FLOAT64 thresh,
-                           OPJ_UINT32 final)
+                           OPJ_UINT32 final,
+                           opj_tcd_rateallocate_job_t* jobs)
 {
     OPJ_UINT32 compno, resno, bandno, precno, cblkno;
-    OPJ_UINT32 passno;
 
     opj_tcd_tile_t *tcd_tile = tcd->tcd_image->tiles;
     OPJ_BOOL layer_allocation_is_same = OPJ_TRUE;
 
     tcd_tile->distolayer[layno] = 0;
 
+    if (!jobs) {
+        for (compno = 0; compno < tcd_tile->numcomps; compno++) {
+            if (!opj_tcd_makelayer_comp(tcd, compno, layno, thresh, final,
+                                        &tcd_tile->distolayer[layno])) {
+                layer_allocation_is_same = OPJ_FALSE;
+            }
+        }
+        return layer_allocation_is_same;
+    }
+
+    for (compno = 0; compno < tcd_tile->numcomps; compno++) {
+        jobs[compno].layno = layno;
+        jobs[compno].thresh = thresh;
+        jobs[compno].final = final;
+        opj_thread_pool_submit_job(tcd->thread_pool, opj_tcd_makelayer_func,
+                                   &jobs[compno]);
+    }
+    opj_thread_pool_wait_completion(tcd->thread_pool, 0);
+
     for (compno = 0; compno < tcd_tile->numcomps; compno++) {
         opj_tcd_tilecomp_t *tilec = &tcd_tile->comps[compno];
 
+        if (!jobs[compno].is_same) {
+            layer_allocation_is_same = OPJ_FALSE;
+        }
+
+        /* Sum the distortion in the same order as the serial code, so that */
+        /* the allocation does not depend on the number of threads */
         for (resno = 0; resno < tilec->numresolutions; resno++) {
             opj_tcd_resolution_t *res = &tilec->resolutions[resno];
 
@@ -276,72 +673,10 @@ OPJ_BOOL opj_tcd_makelayer(opj_tcd_t *tcd,
                     opj_tcd_precinct_t *prc = &band->precincts[precno];
 
                     for (cblkno = 0; cblkno < prc->cw * prc->ch; cblkno++) {
-                        opj_tcd_cblk_enc_t *cblk = &prc->cblks.enc[cblkno];
-                        opj_tcd_layer_t *layer = &cblk->layers[layno];
-                        OPJ_UINT32 n;
-
-                        if (layno == 0) {
-                            cblk->numpassesinlayers = 0;
-                        }
-
-                        n = cblk->numpassesinlayers;
-
-                        if (thresh < 0) {
-                            /* Special value to indicate to use all passes */
-                            n = cblk->totalpasses;
-                        } else {
-                            for (passno = cblk->numpassesinlayers; passno < cblk->totalpasses; passno++) {
-                                OPJ_UINT32 dr;
-                                OPJ_FLOAT64 dd;
-                                opj_tcd_pass_t *pass = &cblk->passes[passno];
-
-                                if (n == 0) {
-                                    dr = pass->rate;
-                                    dd = pass->distortiondec;
-                                } else {
-                                    dr = pass->rate - cblk->passes[n - 1].rate;
-                                    dd = pass->distortiondec - cblk->passes[n - 1].distortiondec;
-                                }
-
-                                if (!dr) {
-                                    if (dd != 0) {
-                                        n = passno + 1;
-                                    }
-                                    continue;
-                                }
-                                if (thresh - (dd / dr) <
-                                        DBL_EPSILON) { /* do not rely on float equality, check with DBL_EPSILON margin */
-                                    n = passno + 1;
-                                }
-                            }
-                        }
-
-                        if (layer->numpasses != n - cblk->numpassesinlayers) {
-                            layer_allocation_is_same = OPJ_FALSE;
-                            layer->numpasses = n - cblk->numpassesinlayers;
-                        }
-
-                        if (!layer->numpasses) {
-                            layer->disto = 0;
-                            continue;
-                        }
-
-                        if (cblk->numpassesinlayers == 0) {
-                            layer->len = cblk->passes[n - 1].rate;
-                            layer->data = cblk->data;
-                            layer->disto = cblk->passes[n - 1].distortiondec;
-                        } else {
-                            layer->len = cblk->passes[n - 1].rate - cblk->passes[cblk->numpassesinlayers -
-                                         1].rate;
-                            layer->data = cblk->data + cblk->passes[cblk->numpassesinlayers - 1].rate;
-                            layer->disto = cblk->passes[n - 1].distortiondec -
-                                           cblk->passes[cblk->numpassesinlayers - 1].distortiondec;
-                        }
+                        opj_tcd_layer_t *layer = &prc->cblks.enc[cblkno].layers[layno];
 
-                        tcd_tile->distolayer[layno] += layer->disto;
-
-                        if (final) {
-                            cblk->numpassesinlayers = n;
+                        if (layer->numpasses) {
+                            tcd_tile->distolayer[layno] += layer->disto;
                         }
                     }
                 }
@@ -458,6 +793,41 @@ void opj_tcd_makelayer_fixed(opj_tcd_t *tcd, OPJ_UINT32 layno,
     }
 }
 
+/** Checks with a trial Tier-2 encoding whether the packets of the layers up
+ * to layno fit in maxlen bytes, with the current truncation points.
+ * When possible, the packets of the previous layers, whose truncation points
+ * are final, are only encoded by the first call for a layer, made with
+ * *p_estimation_ready == OPJ_FALSE, and the next calls only encode the
+ * packets of layno */
+static OPJ_BOOL opj_tcd_rate_check(opj_tcd_t *tcd,
+                                   opj_t2_t *t2,
+                                   OPJ_UINT32 layno,
+                                   OPJ_BOOL* p_estimation_ready,
+                                   OPJ_BYTE *dest,
+                                   OPJ_UINT32 * p_data_written,
+                                   OPJ_UINT32 maxlen,
+                                   opj_codestream_info_t *cstr_info,
+                                   opj_event_mgr_t *p_manager)
+{
+    opj_tcd_tile_t *tcd_tile = tcd->tcd_image->tiles;
+
+    if (opj_t2_can_estimate_layer_size(t2)) {
+        if (!*p_estimation_ready) {
+            *p_estimation_ready = opj_t2_init_layer_size_estimation(t2,
+                                  tcd->tcd_tileno, tcd_tile, layno, dest, maxlen, p_manager);
+        }
+        if (*p_estimation_ready) {
+            return opj_t2_estimate_layer_size(t2, tcd->tcd_tileno, tcd_tile, dest,
+                                              p_data_written, p_manager);
+        }
+    }
+
+    return opj_t2_encode_packets(t2, tcd->tcd_tileno, tcd_tile, layno + 1, dest,
+                                 p_data_written, maxlen, cstr_info, NULL, tcd->cur_tp_num, tcd->tp_pos,
+                                 tcd->cur_pino,
+                                 THRESH_CALC, p_manager);
+}
+
 /** Rate allocation for the following methods:
  * - allocation by rate/distortio (m_quality_layer_alloc_strategy == RATE_DISTORTION_RATIO)
  * - allocation by fixed quality  (m_quality_layer_alloc_strategy == FIXED_DISTORTION_RATIO)
@@ -470,12 +840,12 @@ OPJ_BOOL opj_tcd_rateallocate(opj_tcd_t *tcd,
                               opj_codestream_info_t *cstr_info,
                               opj_event_mgr_t *p_manager)
 {
-    OPJ_UINT32 compno, resno, bandno, precno, cblkno, layno;
-    OPJ_UINT32 passno;
+    OPJ_UINT32 compno, layno;
     OPJ_FLOAT64 min, max;
     OPJ_FLOAT64 cumdisto[100];
     const OPJ_FLOAT64 K = 1;
     OPJ_FLOAT64 maxSE = 0;
+    opj_tcd_rateallocate_job_t* l_jobs = NULL;
 
     opj_cp_t *cp = tcd->cp;
     opj_tcd_tile_t *tcd_tile = tcd->tcd_image->tiles;
@@ -486,64 +856,43 @@ OPJ_BOOL opj_tcd_rateallocate(opj_tcd_t *tcd,
 
     tcd_tile->numpix = 0;
 
-    for (compno = 0; compno < tcd_tile->numcomps; compno++) {
-        opj_tcd_tilecomp_t *tilec = &tcd_tile->comps[compno];
-        tilec->numpix = 0;
-
-        for (resno = 0; resno < tilec->numresolutions; resno++) {
-            opj_tcd_resolution_t *res = &tilec->resolutions[resno];
-
-            for (bandno = 0; bandno < res->numbands; bandno++) {
-                opj_tcd_band_t *band = &res->bands[bandno];
-
-                /* Skip empty bands */
-                if (opj_tcd_is_band_empty(band)) {
-                    continue;
-                }
-
-                for (precno = 0; precno < res->pw * res->ph; precno++) {
-                    opj_tcd_precinct_t *prc = &band->precincts[precno];
-
-                    for (cblkno = 0; cblkno < prc->cw * prc->ch; cblkno++) {
-                        opj_tcd_cblk_enc_t *cblk = &prc->cblks.enc[cblkno];
-
-                        for (passno = 0; passno < cblk->totalpasses; passno++) {
-                            opj_tcd_pass_t *pass = &cblk->passes[passno];
-                            OPJ_INT32 dr;
-                            OPJ_FLOAT64 dd, rdslope;
-
-                            if (passno == 0) {
-                                dr = (OPJ_INT32)pass->rate;
-                                dd = pass->distortiondec;
-                            } else {
-                                dr = (OPJ_INT32)(pass->rate - cblk->passes[passno - 1].rate);
-                                dd = pass->distortiondec - cblk->passes[passno - 1].distortiondec;
-                            }
-
-                            if (dr == 0) {
-                                continue;
-                            }
+    /* The code-blocks of the components are independent: process them */
+    /* in parallel. The threshold is still searched for the whole tile, */
+    /* since the rate constraint applies to all its components */
+    if (tcd_tile->numcomps > 1 &&
+            opj_thread_pool_get_thread_count(tcd->thread_pool) > 1) {
+        l_jobs = (opj_tcd_rateallocate_job_t*) opj_calloc(tcd_tile->numcomps,
+                 sizeof(opj_tcd_rateallocate_job_t));
+        /* Fall back to the serial code if the allocation fails */
+    }
 
-                            rdslope = dd / dr;
-                            if (rdslope < min) {
-                                min = rdslope;
-                            }
+    if (l_jobs) {
+        for (compno = 0; compno < tcd_tile->numcomps; compno++) {
+            l_jobs[compno].tcd = tcd;
+            l_jobs[compno].compno = compno;
+            opj_thread_pool_submit_job(tcd->thread_pool, opj_tcd_rate_slopes_func,
+                                       &l_jobs[compno]);
+        }
+        opj_thread_pool_wait_completion(tcd->thread_pool, 0);
+    }
 
-                            if (rdslope > max) {
-                                max = rdslope;
-                            }
-                        } /* passno */
+    for (compno = 0; compno < tcd_tile->numcomps; compno++) {
+        opj_tcd_tilecomp_t *tilec = &tcd_tile->comps[compno];
+        OPJ_FLOAT64 comp_min, comp_max;
 
-                        {
-                            const OPJ_SIZE_T cblk_pix_count = (OPJ_SIZE_T)((cblk->x1 - cblk->x0) *
-                                                              (cblk->y1 - cblk->y0));
-                            tcd_tile->numpix += cblk_pix_count;
-                            tilec->numpix += cblk_pix_count;
-                        }
-                    } /* cbklno */
-                } /* precno */
-            } /* bandno */
-        } /* resno */
+        if (l_jobs) {
+            comp_min = l_jobs[compno].min;
+            comp_max = l_jobs[compno].max;
+        } else {
+            opj_tcd_rate_slopes_comp(tcd, compno, &comp_min, &comp_max);
+        }
+        if (comp_min < min) {
+            min = comp_min;
+        }
+        if (comp_max > max) {
+            max = comp_max;
+        }
+        tcd_tile->numpix += tilec->numpix;
 
         maxSE += (((OPJ_FLOAT64)(1 << tcd->image->comps[compno].prec) - 1.0)
                   * ((OPJ_FLOAT64)(1 << tcd->image->comps[compno].prec) - 1.0))
@@ -559,6 +908,7 @@ OPJ_BOOL opj_tcd_rateallocate(opj_tcd_t *tcd,
                                 OPJ_FLOAT64));
         if (!tile_info->thresh) {
             /* FIXME event manager error callback */
+            opj_free(l_jobs);
             return OPJ_FALSE;
         }
     }
@@ -589,8 +939,10 @@ OPJ_BOOL opj_tcd_rateallocate(opj_tcd_t *tcd,
             opj_t2_t*t2 = opj_t2_create(tcd->image, cp);
             OPJ_FLOAT64 thresh = 0;
             OPJ_BOOL last_layer_allocation_ok = OPJ_FALSE;
+            OPJ_BOOL estimation_ready = OPJ_FALSE;
 
             if (t2 == 00) {
+                opj_free(l_jobs);
                 return OPJ_FALSE;
             }
 
@@ -612,7 +964,8 @@ OPJ_BOOL opj_tcd_rateallocate(opj_tcd_t *tcd,
                               layno, i, new_thresh);
 #endif
 
-                layer_allocation_is_same = opj_tcd_makelayer(tcd, layno, thresh, 0) && i != 0;
+                layer_allocation_is_same = opj_tcd_makelayer(tcd, layno, thresh, 0,
+                                           l_jobs) && i != 0;
 #ifdef DEBUG_RATE_ALLOC
                 opj_event_msg(p_manager, EVT_INFO, "--> layer_allocation_is_same = %d",
                               layer_allocation_is_same);
@@ -620,10 +973,8 @@ OPJ_BOOL opj_tcd_rateallocate(opj_tcd_t *tcd,
                 if (cp->m_specific_param.m_enc.m_quality_layer_alloc_strategy ==
                         FIXED_DISTORTION_RATIO) {
                     if (OPJ_IS_CINEMA(cp->rsiz) || OPJ_IS_IMF(cp->rsiz)) {
-                        if (! opj_t2_encode_packets(t2, tcd->tcd_tileno, tcd_tile, layno + 1, dest,
-                                                    p_data_written, maxlen, cstr_info, NULL, tcd->cur_tp_num, tcd->tp_pos,
-                                                    tcd->cur_pino,
-                                                    THRESH_CALC, p_manager)) {
+                        if (! opj_tcd_rate_check(tcd, t2, layno, &estimation_ready, dest,
+                                                 p_data_written, maxlen, cstr_info, p_manager)) {
 
                             lo = thresh;
                             continue;
@@ -655,15 +1006,13 @@ OPJ_BOOL opj_tcd_rateallocate(opj_tcd_t *tcd,
                      * is compatible of the maximum rate allocation. If not,
                      * retry with a higher threshold.
                      * If OK, try with a lower threshold.
-                     * Call opj_t2_encode_packets() only if opj_tcd_makelayer()
+                     * Call opj_tcd_rate_check() only if opj_tcd_makelayer()
                      * has resulted in different truncation points since its last
                      * call. */
                     if ((layer_allocation_is_same && !last_layer_allocation_ok) ||
                             (!layer_allocation_is_same &&
-                             ! opj_t2_encode_packets(t2, tcd->tcd_tileno, tcd_tile, layno + 1, dest,
-                                                     p_data_written, maxlen, cstr_info, NULL, tcd->cur_tp_num, tcd->tp_pos,
-                                                     tcd->cur_pino,
-                                                     THRESH_CALC, p_manager))) {
+                             ! opj_tcd_rate_check(tcd, t2, layno, &estimation_ready, dest,
+                                                  p_data_written, maxlen, cstr_info, p_manager))) {
 
 #ifdef DEBUG_RATE_ALLOC
                         if (!layer_allocation_is_same) {
@@ -702,12 +1051,13 @@ OPJ_BOOL opj_tcd_rateallocate(opj_tcd_t *tcd,
             cstr_info->tile[tcd->tcd_tileno].thresh[layno] = goodthresh;
         }
 
-        opj_tcd_makelayer(tcd, layno, goodthresh, 1);
+        opj_tcd_makelayer(tcd, layno, goodthresh, 1, l_jobs);
 
         cumdisto[layno] = (layno == 0) ? tcd_tile->distolayer[0] :
                           (cumdisto[layno - 1] + tcd_tile->distolayer[layno]);
     }
 
+    opj_free(l_jobs);
     return OPJ_TRUE;
 }
 
@@ -744,6 +1094,7 @@ Destroy a previously created TCD handle
 void opj_tcd_destroy(opj_tcd_t *tcd)
 {
     if (tcd) {
+        opj_tcd_end_tile_strips(tcd);
         opj_tcd_free_tile(tcd);
 
         if (tcd->tcd_image) {
@@ -753,11 +1104,80 @@ void opj_tcd_destroy(opj_tcd_t *tcd)
 
         opj_free(tcd->used_component);
 
+        opj_arena_destroy(tcd->arena);
+        if (tcd->t2_arenas) {
+            OPJ_UINT32 i;
+            for (i = 0; i < tcd->nb_t2_arenas; ++i) {
+                opj_arena_destroy(tcd->t2_arenas[i]);
+            }
+            opj_free(tcd->t2_arenas);
+        }
+
         opj_free(tcd);
     }
 }
 
-OPJ_BOOL opj_alloc_tile_component_data(opj_tcd_tilecomp_t *l_tilec)
+opj_arena_t** opj_tcd_get_t2_arenas(opj_tcd_t *p_tcd,
+                                    OPJ_UINT32 p_nb_arenas)
+{
+    if (p_nb_arenas > p_tcd->nb_t2_arenas) {
+        opj_arena_t** l_new_arenas = (opj_arena_t**) opj_realloc(p_tcd->t2_arenas,
+                                     p_nb_arenas * sizeof(opj_arena_t*));
+        if (! l_new_arenas) {
+            return NULL;
+        }
+        p_tcd->t2_arenas = l_new_arenas;
+        while (p_tcd->nb_t2_arenas < p_nb_arenas) {
+            l_new_arenas[p_tcd->nb_t2_arenas] = opj_arena_create(&(p_tcd->allocator),
+                                                p_tcd->mem_counter);
+            if (! l_new_arenas[p_tcd->nb_t2_arenas]) {
+                return NULL;
+            }
+            ++p_tcd->nb_t2_arenas;
+        }
+    }
+    return p_tcd->t2_arenas;
+}
+
+void opj_tcd_release_dwt_state(opj_tcd_tilecomp_t *p_tilec)
+{
+    opj_sparse_array_int32_free(p_tilec->dwt_sa);
+    p_tilec->dwt_sa = NULL;
+    p_tilec->dwt_numres = 0;
+}
+
+void opj_tcd_free_cblk_decoded_data(opj_mem_counter_t *p_mem_counter,
+                                    opj_tcd_cblk_dec_t *p_cblk)
+{
+    if (p_cblk->decoded_data != NULL) {
+        opj_mem_counter_remove(p_mem_counter, sizeof(OPJ_INT32) *
+                               (OPJ_SIZE_T)(p_cblk->x1 - p_cblk->x0) *
+                               (OPJ_SIZE_T)(p_cblk->y1 - p_cblk->y0));
+        opj_aligned_free(p_cblk->decoded_data);
+        p_cblk->decoded_data = NULL;
+    }
+}
+
+void opj_tcd_get_cblk_cache_key(const opj_tcd_t *p_tcd,
+                                OPJ_UINT32 p_compno,
+                                OPJ_UINT32 p_resno,
+                                OPJ_UINT32 p_bandno,
+                                OPJ_UINT32 p_precno,
+                                OPJ_UINT32 p_cblkno,
+                                OPJ_UINT32 p_numpasses,
+                                opj_cblk_cache_key_t *p_key)
+{
+    p_key->tileno = p_tcd->tcd_tileno;
+    p_key->compno = p_compno;
+    p_key->resno = p_resno;
+    p_key->bandno = p_bandno;
+    p_key->precno = p_precno;
+    p_key->cblkno = p_cblkno;
+    p_key->numpasses = p_numpasses;
+}
+
+OPJ_BOOL opj_alloc_tile_component_data(opj_tcd_tilecomp_t *l_tilec,
+                                       opj_mem_counter_t *p_mem_counter)
 {
     if ((l_tilec->data == 00) ||
             ((l_tilec->data_size_needed > l_tilec->data_size) &&
@@ -769,8 +1189,10 @@ OPJ_BOOL opj_alloc_tile_component_data(opj_tcd_tilecomp_t *l_tilec)
         /*fprintf(stderr, "tAllocate data of tilec (int): %d x OPJ_UINT32n",l_data_size);*/
         l_tilec->data_size = l_tilec->data_size_needed;
         l_tilec->ownsData = OPJ_TRUE;
+        opj_mem_counter_add(p_mem_counter, l_tilec->data_size);
     } else if (l_tilec->data_size_needed > l_tilec->data_size) {
         /* We don't need to keep old data */
+        opj_mem_counter_remove(p_mem_counter, l_tilec->data_size);
         opj_image_data_free(l_tilec->data);
         l_tilec->data = (OPJ_INT32 *) opj_image_data_alloc(l_tilec->data_size_needed);
         if (! l_tilec->data) {
@@ -782,6 +1204,7 @@ OPJ_BOOL opj_alloc_tile_component_data(opj_tcd_tilecomp_t *l_tilec)
         /*fprintf(stderr, "tReallocate data of tilec (int): from %d to %d x OPJ_UINT32n", l_tilec->data_size, l_data_size);*/
         l_tilec->data_size = l_tilec->data_size_needed;
         l_tilec->ownsData = OPJ_TRUE;
+        opj_mem_counter_add(p_mem_counter, l_tilec->data_size);
     }
     return OPJ_TRUE;
 }
@@ -822,6 +1245,14 @@ static INLINE OPJ_BOOL opj_tcd_init_tile(opj_tcd_t *p_tcd, OPJ_UINT32 p_tile_no,
     /* size of data for a tile */
     OPJ_UINT32 l_data_size;
 
+    if (p_tcd->arena) {
+        /* Release the structures of the previous tile at once, so that */
+        /* they are all allocated again below */
+        opj_tcd_free_tile_structures(p_tcd);
+    }
+    /* The packets read for the previous tile cannot be selected from */
+    p_tcd->t2_numlayers = 0;
+
     l_cp = p_tcd->cp;
     l_tcp = &(l_cp->tcps[p_tile_no]);
     l_tile = p_tcd->tcd_image->tiles;
@@ -910,21 +1341,21 @@ static INLINE OPJ_BOOL opj_tcd_init_tile(opj_tcd_t *p_tcd, OPJ_UINT32 p_tile_no,
         l_data_size = l_tilec->numresolutions * (OPJ_UINT32)sizeof(
                           opj_tcd_resolution_t);
 
-        opj_image_data_free(l_tilec->data_win);
-        l_tilec->data_win = NULL;
+        opj_tcd_free_decode_window_data(p_tcd, l_tilec);
+        opj_tcd_release_dwt_state(l_tilec);
         l_tilec->win_x0 = 0;
         l_tilec->win_y0 = 0;
         l_tilec->win_x1 = 0;
         l_tilec->win_y1 = 0;
 
         if (l_tilec->resolutions == 00) {
-            l_tilec->resolutions = (opj_tcd_resolution_t *) opj_malloc(l_data_size);
+            l_tilec->resolutions = (opj_tcd_resolution_t *) opj_tcd_calloc_structure(
+                                       p_tcd, l_data_size);
             if (! l_tilec->resolutions) {
                 return OPJ_FALSE;
             }
             /*fprintf(stderr, "\tAllocate resolutions of tilec (opj_tcd_resolution_t): %d\n",l_data_size);*/
             l_tilec->resolutions_size = l_data_size;
-            memset(l_tilec->resolutions, 0, l_data_size);
         } else if (l_data_size > l_tilec->resolutions_size) {
             opj_tcd_resolution_t* new_resolutions = (opj_tcd_resolution_t *) opj_realloc(
                     l_tilec->resolutions, l_data_size);
@@ -1090,15 +1521,14 @@ static INLINE OPJ_BOOL opj_tcd_init_tile(opj_tcd_t *p_tcd, OPJ_UINT32 p_tile_no,
                                  1;
 
                 if (!l_band->precincts && (l_nb_precincts > 0U)) {
-                    l_band->precincts = (opj_tcd_precinct_t *) opj_malloc(/*3 * */
-                                            l_nb_precinct_size);
+                    l_band->precincts = (opj_tcd_precinct_t *) opj_tcd_calloc_structure(
+                                            p_tcd, /*3 * */ l_nb_precinct_size);
                     if (! l_band->precincts) {
                         opj_event_msg(manager, EVT_ERROR,
                                       "Not enough memory to handle band precints\n");
                         return OPJ_FALSE;
                     }
                     /*fprintf(stderr, "\t\t\t\tAllocate precincts of a band (opj_tcd_precinct_t): %d\n",l_nb_precinct_size);     */
-                    memset(l_band->precincts, 0, l_nb_precinct_size);
                     l_band->precincts_data_size = l_nb_precinct_size;
                 } else if (l_band->precincts_data_size < l_nb_precinct_size) {
 
@@ -1168,14 +1598,13 @@ static INLINE OPJ_BOOL opj_tcd_init_tile(opj_tcd_t *p_tcd, OPJ_UINT32 p_tile_no,
                     l_nb_code_blocks_size = l_nb_code_blocks * (OPJ_UINT32)sizeof_block;
 
                     if (!l_current_precinct->cblks.blocks && (l_nb_code_blocks > 0U)) {
-                        l_current_precinct->cblks.blocks = opj_malloc(l_nb_code_blocks_size);
+                        l_current_precinct->cblks.blocks = opj_tcd_calloc_structure(p_tcd,
+                                                           l_nb_code_blocks_size);
                         if (! l_current_precinct->cblks.blocks) {
                             return OPJ_FALSE;
                         }
                         /*fprintf(stderr, "\t\t\t\tAllocate cblks of a precinct (opj_tcd_cblk_dec_t): %d\n",l_nb_code_blocks_size);*/
 
-                        memset(l_current_precinct->cblks.blocks, 0, l_nb_code_blocks_size);
-
                         l_current_precinct->block_size = l_nb_code_blocks_size;
                     } else if (l_nb_code_blocks_size > l_current_precinct->block_size) {
                         void *new_blocks = opj_realloc(l_current_precinct->cblks.blocks,
@@ -1201,7 +1630,7 @@ static INLINE OPJ_BOOL opj_tcd_init_tile(opj_tcd_t *p_tcd, OPJ_UINT32 p_tile_no,
 
                     if (! l_current_precinct->incltree) {
                         l_current_precinct->incltree = opj_tgt_create(l_current_precinct->cw,
-                                                       l_current_precinct->ch, manager);
+                                                       l_current_precinct->ch, p_tcd->arena, manager);
                     } else {
                         l_current_precinct->incltree = opj_tgt_init(l_current_precinct->incltree,
                                                        l_current_precinct->cw, l_current_precinct->ch, manager);
@@ -1209,7 +1638,7 @@ static INLINE OPJ_BOOL opj_tcd_init_tile(opj_tcd_t *p_tcd, OPJ_UINT32 p_tile_no,
 
                     if (! l_current_precinct->imsbtree) {
                         l_current_precinct->imsbtree = opj_tgt_create(l_current_precinct->cw,
-                                                       l_current_precinct->ch, manager);
+                                                       l_current_precinct->ch, p_tcd->arena, manager);
                     } else {
                         l_current_precinct->imsbtree = opj_tgt_init(l_current_precinct->imsbtree,
                                                        l_current_precinct->cw, l_current_precinct->ch, manager);
@@ -1241,7 +1670,7 @@ static INLINE OPJ_BOOL opj_tcd_init_tile(opj_tcd_t *p_tcd, OPJ_UINT32 p_tile_no,
                         } else {
                             opj_tcd_cblk_dec_t* l_code_block = l_current_precinct->cblks.dec + cblkno;
 
-                            if (! opj_tcd_code_block_dec_allocate(l_code_block)) {
+                            if (! opj_tcd_code_block_dec_allocate(p_tcd, l_code_block)) {
                                 return OPJ_FALSE;
                             }
                             /* code-block size (global) */
@@ -1273,6 +1702,8 @@ OPJ_BOOL opj_tcd_init_encode_tile(opj_tcd_t *p_tcd, OPJ_UINT32 p_tile_no,
 OPJ_BOOL opj_tcd_init_decode_tile(opj_tcd_t *p_tcd, OPJ_UINT32 p_tile_no,
                                   opj_event_mgr_t* p_manager)
 {
+    /* The code-blocks of a tile decoded by strips are about to be reset */
+    opj_tcd_end_tile_strips(p_tcd);
     return opj_tcd_init_tile(p_tcd, p_tile_no, OPJ_FALSE,
                              sizeof(opj_tcd_cblk_dec_t), p_manager);
 }
@@ -1353,13 +1784,13 @@ void opj_tcd_reinit_segment(opj_tcd_seg_t* seg)
 /**
  * Allocates memory for a decoding code block.
  */
-static OPJ_BOOL opj_tcd_code_block_dec_allocate(opj_tcd_cblk_dec_t *
-        p_code_block)
+static OPJ_BOOL opj_tcd_code_block_dec_allocate(opj_tcd_t *p_tcd,
+        opj_tcd_cblk_dec_t * p_code_block)
 {
     if (! p_code_block->segs) {
 
-        p_code_block->segs = (opj_tcd_seg_t *) opj_calloc(OPJ_J2K_DEFAULT_NB_SEGS,
-                             sizeof(opj_tcd_seg_t));
+        p_code_block->segs = (opj_tcd_seg_t *) opj_tcd_calloc_structure(p_tcd,
+                             OPJ_J2K_DEFAULT_NB_SEGS * sizeof(opj_tcd_seg_t));
         if (! p_code_block->segs) {
             return OPJ_FALSE;
         }
@@ -1375,8 +1806,8 @@ static OPJ_BOOL opj_tcd_code_block_dec_allocate(opj_tcd_cblk_dec_t *
         OPJ_UINT32 l_numchunksalloc = p_code_block->numchunksalloc;
         OPJ_UINT32 i;
 
-        opj_aligned_free(p_code_block->decoded_data);
-        p_code_block->decoded_data = 00;
+        opj_tcd_free_cblk_decoded_data(p_tcd->mem_counter, p_code_block);
+        opj_free(p_code_block->dec_state);
 
         memset(p_code_block, 0, sizeof(opj_tcd_cblk_dec_t));
         p_code_block->segs = l_segs;
@@ -1542,21 +1973,15 @@ OPJ_BOOL opj_tcd_encode_tile(opj_tcd_t *p_tcd,
     return OPJ_TRUE;
 }
 
-OPJ_BOOL opj_tcd_decode_tile(opj_tcd_t *p_tcd,
-                             OPJ_UINT32 win_x0,
-                             OPJ_UINT32 win_y0,
-                             OPJ_UINT32 win_x1,
-                             OPJ_UINT32 win_y1,
-                             OPJ_UINT32 numcomps_to_decode,
-                             const OPJ_UINT32 *comps_indices,
-                             OPJ_BYTE *p_src,
-                             OPJ_UINT32 p_max_length,
-                             OPJ_UINT32 p_tile_no,
-                             opj_codestream_index_t *p_cstr_index,
-                             opj_event_mgr_t *p_manager
-                            )
+static OPJ_BOOL opj_tcd_decode_tile_init(opj_tcd_t *p_tcd,
+        OPJ_UINT32 win_x0,
+        OPJ_UINT32 win_y0,
+        OPJ_UINT32 win_x1,
+        OPJ_UINT32 win_y1,
+        OPJ_UINT32 numcomps_to_decode,
+        const OPJ_UINT32 *comps_indices,
+        OPJ_UINT32 p_tile_no)
 {
-    OPJ_UINT32 l_data_read;
     OPJ_UINT32 compno;
 
     p_tcd->tcd_tileno = p_tile_no;
@@ -1583,104 +2008,223 @@ OPJ_BOOL opj_tcd_decode_tile(opj_tcd_t *p_tcd,
         p_tcd->used_component = used_component;
     }
 
+    /* The tile of a single-tiled image is kept between several decodings, */
+    /* for which the resolution factor may have changed */
+    for (compno = 0; compno < p_tcd->image->numcomps; compno++) {
+        opj_tcd_tilecomp_t* tilec = &(p_tcd->tcd_image->tiles->comps[compno]);
+        OPJ_UINT32 l_reduce = p_tcd->cp->m_specific_param.m_dec.m_reduce;
+
+        tilec->minimum_num_resolutions = (tilec->numresolutions < l_reduce) ? 1 :
+                                         tilec->numresolutions - l_reduce;
+        p_tcd->image->comps[compno].resno_decoded = 0;
+    }
+
     for (compno = 0; compno < p_tcd->image->numcomps; compno++) {
         if (p_tcd->used_component != NULL && !p_tcd->used_component[compno]) {
             continue;
         }
 
-        if (!opj_tcd_is_whole_tilecomp_decoding(p_tcd, compno)) {
+        if (p_tcd->refinable ||
+                !opj_tcd_is_whole_tilecomp_decoding(p_tcd, compno)) {
             p_tcd->whole_tile_decoding = OPJ_FALSE;
             break;
         }
     }
 
-    if (p_tcd->whole_tile_decoding) {
-        for (compno = 0; compno < p_tcd->image->numcomps; compno++) {
-            opj_tcd_tilecomp_t* tilec = &(p_tcd->tcd_image->tiles->comps[compno]);
-            opj_tcd_resolution_t *l_res = &
-                                          (tilec->resolutions[tilec->minimum_num_resolutions - 1]);
-            OPJ_SIZE_T l_data_size;
+    return OPJ_TRUE;
+}
 
-            /* compute l_data_size with overflow check */
-            OPJ_SIZE_T res_w = (OPJ_SIZE_T)(l_res->x1 - l_res->x0);
-            OPJ_SIZE_T res_h = (OPJ_SIZE_T)(l_res->y1 - l_res->y0);
+static OPJ_BOOL opj_tcd_set_decode_window(opj_tcd_t *p_tcd,
+        opj_event_mgr_t *p_manager)
+{
+    OPJ_UINT32 compno;
 
-            if (p_tcd->used_component != NULL && !p_tcd->used_component[compno]) {
-                continue;
-            }
+    /* Compute restricted tile-component and tile-resolution coordinates */
+    /* of the window of interest, but defer the memory allocation until */
+    /* we know the resno_decoded */
+    for (compno = 0; compno < p_tcd->image->numcomps; compno++) {
+        OPJ_UINT32 resno;
+        opj_tcd_tilecomp_t* tilec = &(p_tcd->tcd_image->tiles->comps[compno]);
+        opj_image_comp_t* image_comp = &(p_tcd->image->comps[compno]);
 
-            /* issue 733, l_data_size == 0U, probably something wrong should be checked before getting here */
-            if (res_h > 0 && res_w > SIZE_MAX / res_h) {
+        if (p_tcd->used_component != NULL && !p_tcd->used_component[compno]) {
+            continue;
+        }
+
+        /* Compute the intersection of the area of interest, expressed in tile coordinates */
+        /* with the tile coordinates */
+        tilec->win_x0 = opj_uint_max(
+                            (OPJ_UINT32)tilec->x0,
+                            opj_uint_ceildiv(p_tcd->win_x0, image_comp->dx));
+        tilec->win_y0 = opj_uint_max(
+                            (OPJ_UINT32)tilec->y0,
+                            opj_uint_ceildiv(p_tcd->win_y0, image_comp->dy));
+        tilec->win_x1 = opj_uint_min(
+                            (OPJ_UINT32)tilec->x1,
+                            opj_uint_ceildiv(p_tcd->win_x1, image_comp->dx));
+        tilec->win_y1 = opj_uint_min(
+                            (OPJ_UINT32)tilec->y1,
+                            opj_uint_ceildiv(p_tcd->win_y1, image_comp->dy));
+        if (tilec->win_x1 < tilec->win_x0 ||
+                tilec->win_y1 < tilec->win_y0) {
+            /* We should not normally go there. The circumstance is when */
+            /* the tile coordinates do not intersect the area of interest */
+            /* Upper level logic should not even try to decode that tile */
+            opj_event_msg(p_manager, EVT_ERROR,
+                          "Invalid tilec->win_xxx values\n");
+            return OPJ_FALSE;
+        }
+
+        for (resno = 0; resno < tilec->numresolutions; ++resno) {
+            opj_tcd_resolution_t *res = tilec->resolutions + resno;
+            res->win_x0 = opj_uint_ceildivpow2(tilec->win_x0,
+                                               tilec->numresolutions - 1 - resno);
+            res->win_y0 = opj_uint_ceildivpow2(tilec->win_y0,
+                                               tilec->numresolutions - 1 - resno);
+            res->win_x1 = opj_uint_ceildivpow2(tilec->win_x1,
+                                               tilec->numresolutions - 1 - resno);
+            res->win_y1 = opj_uint_ceildivpow2(tilec->win_y1,
+                                               tilec->numresolutions - 1 - resno);
+        }
+    }
+
+    return OPJ_TRUE;
+}
+
+static OPJ_BOOL opj_tcd_alloc_whole_tile_data(opj_tcd_t *p_tcd,
+        opj_event_mgr_t *p_manager)
+{
+    OPJ_UINT32 compno;
+
+    for (compno = 0; compno < p_tcd->image->numcomps; compno++) {
+        opj_tcd_tilecomp_t* tilec = &(p_tcd->tcd_image->tiles->comps[compno]);
+        opj_tcd_resolution_t *l_res = &
+                                      (tilec->resolutions[tilec->minimum_num_resolutions - 1]);
+        OPJ_SIZE_T l_data_size;
+
+        /* compute l_data_size with overflow check */
+        OPJ_SIZE_T res_w = (OPJ_SIZE_T)(l_res->x1 - l_res->x0);
+        OPJ_SIZE_T res_h = (OPJ_SIZE_T)(l_res->y1 - l_res->y0);
+
+        if (p_tcd->used_component != NULL && !p_tcd->used_component[compno]) {
+            continue;
+        }
+
+        /* issue 733, l_data_size == 0U, probably something wrong should be checked before getting here */
+        if (res_h > 0 && res_w > SIZE_MAX / res_h) {
+            opj_event_msg(p_manager, EVT_ERROR,
+                          "Size of tile data exceeds system limits\n");
+            return OPJ_FALSE;
+        }
+        l_data_size = res_w * res_h;
+
+        if (SIZE_MAX / sizeof(OPJ_UINT32) < l_data_size) {
+            opj_event_msg(p_manager, EVT_ERROR,
+                          "Size of tile data exceeds system limits\n");
+            return OPJ_FALSE;
+        }
+        l_data_size *= sizeof(OPJ_UINT32);
+
+        tilec->data_size_needed = l_data_size;
+
+        if (!opj_alloc_tile_component_data(tilec, p_tcd->mem_counter)) {
+            opj_event_msg(p_manager, EVT_ERROR,
+                          "Size of tile data exceeds system limits\n");
+            return OPJ_FALSE;
+        }
+    }
+
+    return OPJ_TRUE;
+}
+
+static OPJ_BOOL opj_tcd_alloc_decode_window_data(opj_tcd_t *p_tcd,
+        opj_event_mgr_t *p_manager)
+{
+    OPJ_UINT32 compno;
+
+    for (compno = 0; compno < p_tcd->image->numcomps; compno++) {
+        opj_tcd_tilecomp_t* tilec = &(p_tcd->tcd_image->tiles->comps[compno]);
+        opj_image_comp_t* image_comp = &(p_tcd->image->comps[compno]);
+        opj_tcd_resolution_t *res = tilec->resolutions + image_comp->resno_decoded;
+        OPJ_SIZE_T w = res->win_x1 - res->win_x0;
+        OPJ_SIZE_T h = res->win_y1 - res->win_y0;
+        OPJ_SIZE_T l_data_size;
+
+        opj_tcd_free_decode_window_data(p_tcd, tilec);
+
+        if (p_tcd->used_component != NULL && !p_tcd->used_component[compno]) {
+            continue;
+        }
+
+        if (w > 0 && h > 0) {
+            if (w > SIZE_MAX / h) {
                 opj_event_msg(p_manager, EVT_ERROR,
                               "Size of tile data exceeds system limits\n");
                 return OPJ_FALSE;
             }
-            l_data_size = res_w * res_h;
-
-            if (SIZE_MAX / sizeof(OPJ_UINT32) < l_data_size) {
+            l_data_size = w * h;
+            if (l_data_size > SIZE_MAX / sizeof(OPJ_INT32)) {
                 opj_event_msg(p_manager, EVT_ERROR,
                               "Size of tile data exceeds system limits\n");
                 return OPJ_FALSE;
             }
-            l_data_size *= sizeof(OPJ_UINT32);
-
-            tilec->data_size_needed = l_data_size;
+            l_data_size *= sizeof(OPJ_INT32);
 
-            if (!opj_alloc_tile_component_data(tilec)) {
+            tilec->data_win = (OPJ_INT32*) opj_image_data_alloc(l_data_size);
+            if (tilec->data_win == NULL) {
                 opj_event_msg(p_manager, EVT_ERROR,
                               "Size of tile data exceeds system limits\n");
                 return OPJ_FALSE;
             }
+            tilec->data_win_size = l_data_size;
+            opj_mem_counter_add(p_tcd->mem_counter, l_data_size);
         }
-    } else {
-        /* Compute restricted tile-component and tile-resolution coordinates */
-        /* of the window of interest, but defer the memory allocation until */
-        /* we know the resno_decoded */
-        for (compno = 0; compno < p_tcd->image->numcomps; compno++) {
-            OPJ_UINT32 resno;
-            opj_tcd_tilecomp_t* tilec = &(p_tcd->tcd_image->tiles->comps[compno]);
-            opj_image_comp_t* image_comp = &(p_tcd->image->comps[compno]);
+    }
 
-            if (p_tcd->used_component != NULL && !p_tcd->used_component[compno]) {
-                continue;
-            }
+    return OPJ_TRUE;
+}
 
-            /* Compute the intersection of the area of interest, expressed in tile coordinates */
-            /* with the tile coordinates */
-            tilec->win_x0 = opj_uint_max(
-                                (OPJ_UINT32)tilec->x0,
-                                opj_uint_ceildiv(p_tcd->win_x0, image_comp->dx));
-            tilec->win_y0 = opj_uint_max(
-                                (OPJ_UINT32)tilec->y0,
-                                opj_uint_ceildiv(p_tcd->win_y0, image_comp->dy));
-            tilec->win_x1 = opj_uint_min(
-                                (OPJ_UINT32)tilec->x1,
-                                opj_uint_ceildiv(p_tcd->win_x1, image_comp->dx));
-            tilec->win_y1 = opj_uint_min(
-                                (OPJ_UINT32)tilec->y1,
-                                opj_uint_ceildiv(p_tcd->win_y1, image_comp->dy));
-            if (tilec->win_x1 < tilec->win_x0 ||
-                    tilec->win_y1 < tilec->win_y0) {
-                /* We should not normally go there. The circumstance is when */
-                /* the tile coordinates do not intersect the area of interest */
-                /* Upper level logic should not even try to decode that tile */
-                opj_event_msg(p_manager, EVT_ERROR,
-                              "Invalid tilec->win_xxx values\n");
-                return OPJ_FALSE;
-            }
+static void opj_tcd_free_decode_window_data(opj_tcd_t *p_tcd,
+        opj_tcd_tilecomp_t *p_tilec)
+{
+    if (p_tilec->data_win != NULL) {
+        opj_mem_counter_remove(p_tcd->mem_counter, p_tilec->data_win_size);
+        opj_image_data_free(p_tilec->data_win);
+        p_tilec->data_win = NULL;
+        p_tilec->data_win_size = 0;
+    }
+}
 
-            for (resno = 0; resno < tilec->numresolutions; ++resno) {
-                opj_tcd_resolution_t *res = tilec->resolutions + resno;
-                res->win_x0 = opj_uint_ceildivpow2(tilec->win_x0,
-                                                   tilec->numresolutions - 1 - resno);
-                res->win_y0 = opj_uint_ceildivpow2(tilec->win_y0,
-                                                   tilec->numresolutions - 1 - resno);
-                res->win_x1 = opj_uint_ceildivpow2(tilec->win_x1,
-                                                   tilec->numresolutions - 1 - resno);
-                res->win_y1 = opj_uint_ceildivpow2(tilec->win_y1,
-                                                   tilec->numresolutions - 1 - resno);
-            }
+OPJ_BOOL opj_tcd_decode_tile(opj_tcd_t *p_tcd,
+                             OPJ_UINT32 win_x0,
+                             OPJ_UINT32 win_y0,
+                             OPJ_UINT32 win_x1,
+                             OPJ_UINT32 win_y1,
+                             OPJ_UINT32 numcomps_to_decode,
+                             const OPJ_UINT32 *comps_indices,
+                             OPJ_BYTE *p_src,
+                             OPJ_UINT32 p_max_length,
+                             OPJ_UINT32 p_tile_no,
+                             opj_codestream_index_t *p_cstr_index,
+                             opj_event_mgr_t *p_manager
+                            )
+{
+    OPJ_UINT32 l_data_read;
+    OPJ_BOOL l_pipelined;
+    opj_stage_time_t l_start;
+
+    if (!opj_tcd_decode_tile_init(p_tcd, win_x0, win_y0, win_x1, win_y1,
+                                  numcomps_to_decode, comps_indices,
+                                  p_tile_no)) {
+        return OPJ_FALSE;
+    }
+
+    if (p_tcd->whole_tile_decoding) {
+        if (!opj_tcd_alloc_whole_tile_data(p_tcd, p_manager)) {
+            return OPJ_FALSE;
         }
+    } else if (!opj_tcd_set_decode_window(p_tcd, p_manager)) {
+        return OPJ_FALSE;
     }
 
 #ifdef TODO_MSD /* FIXME */
@@ -1708,91 +2252,537 @@ OPJ_BOOL opj_tcd_decode_tile(opj_tcd_t *p_tcd,
 #endif
 
     /*--------------TIER2------------------*/
-    /* FIXME _ProfStart(PGROUP_T2); */
+    OPJ_TCD_STAGE_BEGIN(p_tcd, l_start);
     l_data_read = 0;
     if (! opj_tcd_t2_decode(p_tcd, p_src, &l_data_read, p_max_length, p_cstr_index,
                             p_manager)) {
         return OPJ_FALSE;
     }
-    /* FIXME _ProfStop(PGROUP_T2); */
+    OPJ_TCD_STAGE_END(p_tcd, l_start, OPJ_STAGE_T2);
+    if (p_tcd->stats) {
+        p_tcd->stats->bytes_read += p_max_length;
+    }
 
     /*------------------TIER1-----------------*/
 
-    /* FIXME _ProfStart(PGROUP_T1); */
-    if (! opj_tcd_t1_decode(p_tcd, p_manager)) {
+    OPJ_TCD_STAGE_BEGIN(p_tcd, l_start);
+    /* When decoding a whole tile with several threads, Tier-1 decoding */
+    /* and DWT are pipelined, per resolution level */
+    l_pipelined = p_tcd->whole_tile_decoding &&
+                  opj_thread_pool_get_thread_count(p_tcd->thread_pool) > 1;
+    if (l_pipelined) {
+        opj_stage_time_t l_dwt_time = {0, 0};
+        if (p_tcd->stats) {
+            l_dwt_time = p_tcd->stats->stages[OPJ_STAGE_DWT];
+        }
+        if (! opj_tcd_t1_dwt_decode_pipelined(p_tcd, p_manager)) {
+            return OPJ_FALSE;
+        }
+        if (p_tcd->stats) {
+            /* Leave out the inverse DWT run by this thread meanwhile, */
+            /* that has been accounted for by the pipeline */
+            l_start.wall_time += p_tcd->stats->stages[OPJ_STAGE_DWT].wall_time -
+                                 l_dwt_time.wall_time;
+            l_start.cpu_time += p_tcd->stats->stages[OPJ_STAGE_DWT].cpu_time -
+                                l_dwt_time.cpu_time;
+        }
+    } else if (! opj_tcd_t1_decode(p_tcd, p_manager)) {
         return OPJ_FALSE;
     }
-    /* FIXME _ProfStop(PGROUP_T1); */
+    OPJ_TCD_STAGE_END(p_tcd, l_start, opj_tcd_t1_stage(p_tcd));
 
 
     /* For subtile decoding, now we know the resno_decoded, we can allocate */
     /* the tile data buffer */
-    if (!p_tcd->whole_tile_decoding) {
-        for (compno = 0; compno < p_tcd->image->numcomps; compno++) {
-            opj_tcd_tilecomp_t* tilec = &(p_tcd->tcd_image->tiles->comps[compno]);
-            opj_image_comp_t* image_comp = &(p_tcd->image->comps[compno]);
-            opj_tcd_resolution_t *res = tilec->resolutions + image_comp->resno_decoded;
-            OPJ_SIZE_T w = res->win_x1 - res->win_x0;
-            OPJ_SIZE_T h = res->win_y1 - res->win_y0;
-            OPJ_SIZE_T l_data_size;
-
-            opj_image_data_free(tilec->data_win);
-            tilec->data_win = NULL;
+    if (!p_tcd->whole_tile_decoding &&
+            !opj_tcd_alloc_decode_window_data(p_tcd, p_manager)) {
+        return OPJ_FALSE;
+    }
 
-            if (p_tcd->used_component != NULL && !p_tcd->used_component[compno]) {
-                continue;
+    /*----------------DWT---------------------*/
+
+    if (! l_pipelined) {
+        OPJ_TCD_STAGE_BEGIN(p_tcd, l_start);
+        if (! opj_tcd_dwt_decode(p_tcd)) {
+            return OPJ_FALSE;
+        }
+        OPJ_TCD_STAGE_END(p_tcd, l_start, OPJ_STAGE_DWT);
+    }
+
+    /*----------------MCT-------------------*/
+    if (p_tcd->whole_tile_decoding) {
+        /* MCT and DC level shift, on strips */
+        return opj_tcd_mct_dc_level_shift_decode_strips(p_tcd, p_manager);
+    }
+
+    OPJ_TCD_STAGE_BEGIN(p_tcd, l_start);
+    if
+    (! opj_tcd_mct_decode(p_tcd, p_manager)) {
+        return OPJ_FALSE;
+    }
+    OPJ_TCD_STAGE_END(p_tcd, l_start, OPJ_STAGE_MCT);
+
+    OPJ_TCD_STAGE_BEGIN(p_tcd, l_start);
+    if
+    (! opj_tcd_dc_level_shift_decode(p_tcd)) {
+        return OPJ_FALSE;
+    }
+    OPJ_TCD_STAGE_END(p_tcd, l_start, OPJ_STAGE_DC_SHIFT);
+
+
+    /*---------------TILE-------------------*/
+    return OPJ_TRUE;
+}
+
+OPJ_BOOL opj_tcd_decode_tile_stage(opj_tcd_t *p_tcd,
+                                   OPJ_TCD_DECODE_STAGE p_stage,
+                                   OPJ_BYTE *p_src,
+                                   OPJ_UINT32 p_max_length,
+                                   OPJ_UINT32 p_tile_no,
+                                   opj_event_mgr_t *p_manager)
+{
+    OPJ_UINT32 l_data_read;
+
+    switch (p_stage) {
+    case OPJ_TCD_STAGE_INIT:
+        /* Reset the code-blocks, so that the stages can be run again */
+        if (!opj_tcd_init_decode_tile(p_tcd, p_tile_no, p_manager)) {
+            return OPJ_FALSE;
+        }
+        /* The window of interest is the whole image, hence the whole tile */
+        if (!opj_tcd_decode_tile_init(p_tcd, p_tcd->image->x0, p_tcd->image->y0,
+                                      p_tcd->image->x1, p_tcd->image->y1,
+                                      0, NULL, p_tile_no)) {
+            return OPJ_FALSE;
+        }
+        if (!p_tcd->whole_tile_decoding) {
+            opj_event_msg(p_manager, EVT_ERROR,
+                          "Tile %d cannot be decoded as a whole\n", p_tile_no);
+            return OPJ_FALSE;
+        }
+        return opj_tcd_alloc_whole_tile_data(p_tcd, p_manager);
+    case OPJ_TCD_STAGE_T2:
+        l_data_read = 0;
+        return opj_tcd_t2_decode(p_tcd, p_src, &l_data_read, p_max_length, NULL,
+                                 p_manager);
+    case OPJ_TCD_STAGE_T1:
+        return opj_tcd_t1_decode(p_tcd, p_manager);
+    case OPJ_TCD_STAGE_DWT:
+        return opj_tcd_dwt_decode(p_tcd);
+    case OPJ_TCD_STAGE_MCT:
+        return opj_tcd_mct_decode(p_tcd, p_manager);
+    case OPJ_TCD_STAGE_DC_SHIFT:
+        return opj_tcd_dc_level_shift_decode(p_tcd);
+    default:
+        break;
+    }
+    return OPJ_FALSE;
+}
+
+/** Code-blocks of a band decoded by opj_tcd_decode_tile_strip() */
+typedef struct opj_tcd_strip_band {
+    opj_tcd_band_t* band;
+    /** Code-blocks of the window of interest, sorted by rows */
+    opj_tcd_cblk_dec_t** cblks;
+    OPJ_UINT32 nb_cblks;
+    /** Code-blocks [first, next[ are decoded. The ones before were */
+    /** released, and the ones after are not decoded yet */
+    OPJ_UINT32 first;
+    OPJ_UINT32 next;
+} opj_tcd_strip_band_t;
+
+/** Tile component decoded by opj_tcd_decode_tile_strip() */
+typedef struct opj_tcd_strip_comp {
+    struct opj_tcd_strips* strips;
+    opj_tcd_tilecomp_t* tilec;
+    opj_tccp_t* tccp;
+    /** Inverse wavelet transform, or NULL if the component is not decoded */
+    opj_dwt_lines_t* lines;
+    /** Bands of resolution r at index 3 * r + bandno - 2 (r > 0), and the */
+    /** LL band at index 0 */
+    opj_tcd_strip_band_t* bands;
+    OPJ_UINT32 nb_bands;
+    /** Next row returned by lines, relative to the top of the resolution */
+    OPJ_UINT32 next_row;
+} opj_tcd_strip_comp_t;
+
+/** State of the decoding of a tile by strips */
+struct opj_tcd_strips {
+    opj_tcd_t* tcd;
+    opj_event_mgr_t* manager;
+    opj_mutex_t* manager_mutex;
+    OPJ_BOOL check_pterm;
+    volatile OPJ_BOOL ret;
+    /** One entry per component of the tile */
+    opj_tcd_strip_comp_t* comps;
+};
+
+/** Compares two code-blocks of a band by rows, then columns */
+static int opj_tcd_compare_cblks(const void* a, const void* b)
+{
+    const opj_tcd_cblk_dec_t* cblk_a = *(const opj_tcd_cblk_dec_t * const*)a;
+    const opj_tcd_cblk_dec_t* cblk_b = *(const opj_tcd_cblk_dec_t * const*)b;
+    if (cblk_a->y0 != cblk_b->y0) {
+        return cblk_a->y0 < cblk_b->y0 ? -1 : 1;
+    }
+    if (cblk_a->x0 != cblk_b->x0) {
+        return cblk_a->x0 < cblk_b->x0 ? -1 : 1;
+    }
+    return 0;
+}
+
+/** Lists the code-blocks of a band that intersect the window of interest */
+static OPJ_BOOL opj_tcd_init_strip_band(opj_tcd_t *p_tcd,
+                                        opj_tcd_tilecomp_t* tilec,
+                                        OPJ_UINT32 resno,
+                                        opj_tcd_band_t* band,
+                                        opj_tcd_strip_band_t* sb)
+{
+    opj_tcd_resolution_t* res = &tilec->resolutions[resno];
+    OPJ_UINT32 precno, cblkno;
+    OPJ_UINT32 nb_cblks = 0;
+
+    sb->band = band;
+    if (opj_tcd_is_band_empty(band)) {
+        return OPJ_TRUE;
+    }
+    for (precno = 0; precno < res->pw * res->ph; ++precno) {
+        nb_cblks += band->precincts[precno].cw * band->precincts[precno].ch;
+    }
+    if (nb_cblks == 0) {
+        return OPJ_TRUE;
+    }
+    sb->cblks = (opj_tcd_cblk_dec_t**) opj_malloc(nb_cblks *
+                sizeof(opj_tcd_cblk_dec_t*));
+    if (sb->cblks == NULL) {
+        return OPJ_FALSE;
+    }
+    for (precno = 0; precno < res->pw * res->ph; ++precno) {
+        opj_tcd_precinct_t* precinct = &band->precincts[precno];
+        for (cblkno = 0; cblkno < precinct->cw * precinct->ch; ++cblkno) {
+            opj_tcd_cblk_dec_t* cblk = &precinct->cblks.dec[cblkno];
+            /* Left by a previous decoding of the tile */
+            opj_tcd_free_cblk_decoded_data(p_tcd->mem_counter, cblk);
+            if (opj_tcd_is_subband_area_of_interest(p_tcd, tilec->compno, resno,
+                                                    band->bandno,
+                                                    (OPJ_UINT32)cblk->x0,
+                                                    (OPJ_UINT32)cblk->y0,
+                                                    (OPJ_UINT32)cblk->x1,
+                                                    (OPJ_UINT32)cblk->y1)) {
+                sb->cblks[sb->nb_cblks++] = cblk;
             }
+        }
+    }
+    if (p_tcd->stats) {
+        p_tcd->stats->codeblocks_skipped += nb_cblks - sb->nb_cblks;
+    }
+    qsort(sb->cblks, sb->nb_cblks, sizeof(opj_tcd_cblk_dec_t*),
+          opj_tcd_compare_cblks);
+    return OPJ_TRUE;
+}
 
-            if (w > 0 && h > 0) {
-                if (w > SIZE_MAX / h) {
-                    opj_event_msg(p_manager, EVT_ERROR,
-                                  "Size of tile data exceeds system limits\n");
-                    return OPJ_FALSE;
-                }
-                l_data_size = w * h;
-                if (l_data_size > SIZE_MAX / sizeof(OPJ_INT32)) {
-                    opj_event_msg(p_manager, EVT_ERROR,
-                                  "Size of tile data exceeds system limits\n");
-                    return OPJ_FALSE;
+/** Callback of opj_dwt_lines_create(). Code-blocks are decoded when their */
+/** first row is needed, and released after their last row */
+static OPJ_BOOL opj_tcd_strip_band_row(void* user_data,
+                                       OPJ_UINT32 resno,
+                                       OPJ_UINT32 bandno,
+                                       OPJ_UINT32 y,
+                                       OPJ_INT32* row,
+                                       OPJ_UINT32 width)
+{
+    opj_tcd_strip_comp_t* comp = (opj_tcd_strip_comp_t*)user_data;
+    struct opj_tcd_strips* strips = comp->strips;
+    opj_tcd_t* p_tcd = strips->tcd;
+    opj_tcd_strip_band_t* sb = &comp->bands[resno == 0 ? 0 : 3 * resno + bandno -
+                                                2];
+    opj_tcd_band_t* band = sb->band;
+    OPJ_INT32 l_y = band->y0 + (OPJ_INT32)y;
+    OPJ_UINT32 i, end;
+
+    memset(row, 0, width * sizeof(OPJ_INT32));
+
+    while (sb->first < sb->next && sb->cblks[sb->first]->y1 <= l_y) {
+        opj_tcd_free_cblk_decoded_data(p_tcd->mem_counter,
+                                       sb->cblks[sb->first]);
+        ++sb->first;
+    }
+    /* Code-blocks above the first computed row are not needed */
+    while (sb->first == sb->next && sb->next < sb->nb_cblks &&
+            sb->cblks[sb->next]->y1 <= l_y) {
+        ++sb->first;
+        ++sb->next;
+        if (p_tcd->stats) {
+            p_tcd->stats->codeblocks_skipped ++;
+        }
+    }
+    for (end = sb->next; end < sb->nb_cblks && sb->cblks[end]->y0 <= l_y;
+            ++end) {
+    }
+    if (end > sb->next) {
+        opj_stage_time_t l_start;
+        OPJ_TCD_STAGE_BEGIN(p_tcd, l_start);
+        opj_t1_decode_cblks_list(p_tcd, &strips->ret, comp->tilec, comp->tccp,
+                                 resno, band, sb->cblks + sb->next,
+                                 end - sb->next, strips->manager,
+                                 strips->manager_mutex, strips->check_pterm);
+        opj_thread_pool_wait_completion(p_tcd->thread_pool, 0);
+        OPJ_TCD_STAGE_END(p_tcd, l_start, opj_tcd_t1_stage(p_tcd));
+        sb->next = end;
+        if (!strips->ret) {
+            return OPJ_FALSE;
+        }
+    }
+
+    for (i = sb->first; i < sb->next; ++i) {
+        const opj_tcd_cblk_dec_t* cblk = sb->cblks[i];
+        OPJ_UINT32 cblk_w = (OPJ_UINT32)(cblk->x1 - cblk->x0);
+        OPJ_UINT32 x0 = (OPJ_UINT32)(cblk->x0 - band->x0);
+        OPJ_UINT32 w;
+
+        if (cblk->y0 > l_y || cblk->decoded_data == NULL || x0 >= width) {
+            continue;
+        }
+        w = opj_uint_min(cblk_w, width - x0);
+        memcpy(row + x0,
+               cblk->decoded_data + (OPJ_SIZE_T)(l_y - cblk->y0) * cblk_w,
+               w * sizeof(OPJ_INT32));
+    }
+    return OPJ_TRUE;
+}
+
+void opj_tcd_end_tile_strips(opj_tcd_t *p_tcd)
+{
+    struct opj_tcd_strips* strips = p_tcd->strips;
+    OPJ_UINT32 compno, i, j;
+
+    if (strips == NULL) {
+        return;
+    }
+    if (strips->comps != NULL) {
+        for (compno = 0; compno < p_tcd->tcd_image->tiles->numcomps; compno++) {
+            opj_tcd_strip_comp_t* comp = &strips->comps[compno];
+            opj_tcd_tilecomp_t* tilec = &p_tcd->tcd_image->tiles->comps[compno];
+
+            opj_dwt_lines_destroy(comp->lines);
+            for (i = 0; i < comp->nb_bands; i++) {
+                opj_tcd_strip_band_t* sb = &comp->bands[i];
+                for (j = sb->first; j < sb->next; j++) {
+                    opj_tcd_free_cblk_decoded_data(p_tcd->mem_counter,
+                                                   sb->cblks[j]);
                 }
-                l_data_size *= sizeof(OPJ_INT32);
+                opj_free(sb->cblks);
+            }
+            opj_free(comp->bands);
+            opj_tcd_free_decode_window_data(p_tcd, tilec);
+        }
+        opj_free(strips->comps);
+    }
+    if (strips->manager_mutex) {
+        opj_mutex_destroy(strips->manager_mutex);
+    }
+    opj_free(strips);
+    p_tcd->strips = NULL;
+}
+
+OPJ_BOOL opj_tcd_begin_tile_strips(opj_tcd_t *p_tcd,
+                                   OPJ_UINT32 win_x0,
+                                   OPJ_UINT32 win_y0,
+                                   OPJ_UINT32 win_x1,
+                                   OPJ_UINT32 win_y1,
+                                   OPJ_UINT32 numcomps_to_decode,
+                                   const OPJ_UINT32 *comps_indices,
+                                   OPJ_BYTE *p_src,
+                                   OPJ_UINT32 p_max_length,
+                                   OPJ_UINT32 p_tile_no,
+                                   opj_codestream_index_t *p_cstr_index,
+                                   opj_event_mgr_t *p_manager)
+{
+    opj_tcd_tile_t * l_tile = p_tcd->tcd_image->tiles;
+    struct opj_tcd_strips* strips;
+    OPJ_UINT32 l_data_read;
+    OPJ_UINT32 compno;
+    opj_stage_time_t l_start;
+
+    opj_tcd_end_tile_strips(p_tcd);
 
-                tilec->data_win = (OPJ_INT32*) opj_image_data_alloc(l_data_size);
-                if (tilec->data_win == NULL) {
+    if (!opj_tcd_decode_tile_init(p_tcd, win_x0, win_y0, win_x1, win_y1,
+                                  numcomps_to_decode, comps_indices,
+                                  p_tile_no)) {
+        return OPJ_FALSE;
+    }
+    /* The inverse DWT is computed row by row, and only needs the */
+    /* code-blocks of the window of interest */
+    p_tcd->whole_tile_decoding = OPJ_FALSE;
+
+    /*--------------TIER2------------------*/
+    if (!opj_tcd_set_decode_window(p_tcd, p_manager)) {
+        return OPJ_FALSE;
+    }
+    OPJ_TCD_STAGE_BEGIN(p_tcd, l_start);
+    l_data_read = 0;
+    if (! opj_tcd_t2_decode(p_tcd, p_src, &l_data_read, p_max_length, p_cstr_index,
+                            p_manager)) {
+        return OPJ_FALSE;
+    }
+    OPJ_TCD_STAGE_END(p_tcd, l_start, OPJ_STAGE_T2);
+    if (p_tcd->stats) {
+        p_tcd->stats->bytes_read += p_max_length;
+    }
+
+    strips = (struct opj_tcd_strips*) opj_calloc(1, sizeof(struct opj_tcd_strips));
+    if (strips == NULL) {
+        opj_event_msg(p_manager, EVT_ERROR, "Not enough memory to decode tile\n");
+        return OPJ_FALSE;
+    }
+    p_tcd->strips = strips;
+    strips->tcd = p_tcd;
+    strips->manager = p_manager;
+    strips->manager_mutex = opj_mutex_create();
+    strips->ret = OPJ_TRUE;
+    /* Only enable PTERM check if we decode all layers */
+    strips->check_pterm = p_tcd->tcp->num_layers_to_decode ==
+                          p_tcd->tcp->numlayers &&
+                          (p_tcd->tcp->tccps->cblksty & J2K_CCP_CBLKSTY_PTERM) != 0;
+    strips->comps = (opj_tcd_strip_comp_t*) opj_calloc(l_tile->numcomps,
+                    sizeof(opj_tcd_strip_comp_t));
+    if (strips->comps == NULL) {
+        opj_tcd_end_tile_strips(p_tcd);
+        opj_event_msg(p_manager, EVT_ERROR, "Not enough memory to decode tile\n");
+        return OPJ_FALSE;
+    }
+
+    for (compno = 0; compno < l_tile->numcomps; compno++) {
+        opj_tcd_strip_comp_t* comp = &strips->comps[compno];
+        opj_tcd_tilecomp_t* tilec = &l_tile->comps[compno];
+        OPJ_UINT32 numres = p_tcd->image->comps[compno].resno_decoded + 1;
+        opj_tcd_resolution_t* res = &tilec->resolutions[numres - 1];
+        OPJ_UINT32 resno, bandno;
+
+        comp->strips = strips;
+        comp->tilec = tilec;
+        comp->tccp = &p_tcd->tcp->tccps[compno];
+        if (p_tcd->used_component != NULL && !p_tcd->used_component[compno]) {
+            continue;
+        }
+        /* The coefficients kept by the inverse wavelet transform of a */
+        /* previous decoding are not valid anymore */
+        opj_tcd_release_dwt_state(tilec);
+        if (res->win_x0 == res->win_x1 || res->win_y0 == res->win_y1) {
+            continue;
+        }
+
+        comp->nb_bands = 3 * numres - 2;
+        comp->bands = (opj_tcd_strip_band_t*) opj_calloc(comp->nb_bands,
+                      sizeof(opj_tcd_strip_band_t));
+        if (comp->bands == NULL) {
+            opj_tcd_end_tile_strips(p_tcd);
+            opj_event_msg(p_manager, EVT_ERROR, "Not enough memory to decode tile\n");
+            return OPJ_FALSE;
+        }
+        for (resno = 0; resno < numres; resno++) {
+            opj_tcd_resolution_t* l_res = &tilec->resolutions[resno];
+            for (bandno = 0; bandno < l_res->numbands; bandno++) {
+                if (!opj_tcd_init_strip_band(p_tcd, tilec, resno,
+                                             &l_res->bands[bandno],
+                                             &comp->bands[resno == 0 ? 0 :
+                                                                 3 * resno + bandno - 2])) {
+                    opj_tcd_end_tile_strips(p_tcd);
                     opj_event_msg(p_manager, EVT_ERROR,
-                                  "Size of tile data exceeds system limits\n");
+                                  "Not enough memory to decode tile\n");
                     return OPJ_FALSE;
                 }
             }
         }
+
+        comp->next_row = res->win_y0 - (OPJ_UINT32)res->y0;
+        comp->lines = opj_dwt_lines_create(tilec, numres, comp->tccp->qmfbid == 1,
+                                           comp->next_row,
+                                           res->win_y1 - (OPJ_UINT32)res->y0,
+                                           opj_tcd_strip_band_row, comp);
+        if (comp->lines == NULL) {
+            opj_tcd_end_tile_strips(p_tcd);
+            opj_event_msg(p_manager, EVT_ERROR, "Not enough memory to decode tile\n");
+            return OPJ_FALSE;
+        }
     }
+    return OPJ_TRUE;
+}
 
-    /*----------------DWT---------------------*/
+OPJ_BOOL opj_tcd_decode_tile_strip(opj_tcd_t *p_tcd,
+                                   OPJ_UINT32 win_y0,
+                                   OPJ_UINT32 win_y1,
+                                   opj_event_mgr_t *p_manager)
+{
+    struct opj_tcd_strips* strips = p_tcd->strips;
+    opj_tcd_tile_t * l_tile = p_tcd->tcd_image->tiles;
+    OPJ_UINT32 compno;
+    opj_stage_time_t l_start;
+    opj_stage_time_t l_t1_time = {0, 0};
 
-    /* FIXME _ProfStart(PGROUP_DWT); */
-    if
-    (! opj_tcd_dwt_decode(p_tcd)) {
+    assert(strips != NULL);
+    strips->manager = p_manager;
+    p_tcd->win_y0 = win_y0;
+    p_tcd->win_y1 = win_y1;
+    if (!opj_tcd_set_decode_window(p_tcd, p_manager) ||
+            !opj_tcd_alloc_decode_window_data(p_tcd, p_manager)) {
         return OPJ_FALSE;
     }
-    /* FIXME _ProfStop(PGROUP_DWT); */
+
+    /*----------------DWT---------------------*/
+    OPJ_TCD_STAGE_BEGIN(p_tcd, l_start);
+    if (p_tcd->stats) {
+        l_t1_time = p_tcd->stats->stages[opj_tcd_t1_stage(p_tcd)];
+    }
+    for (compno = 0; compno < l_tile->numcomps; compno++) {
+        opj_tcd_strip_comp_t* comp = &strips->comps[compno];
+        opj_tcd_tilecomp_t* tilec = &l_tile->comps[compno];
+        opj_tcd_resolution_t* res = tilec->resolutions +
+                                    p_tcd->image->comps[compno].resno_decoded;
+        OPJ_UINT32 l_width = res->win_x1 - res->win_x0;
+        OPJ_UINT32 l_x0 = res->win_x0 - (OPJ_UINT32)res->x0;
+        OPJ_INT32* l_dst = tilec->data_win;
+        OPJ_UINT32 y;
+
+        if (tilec->data_win == NULL) {
+            continue;
+        }
+        if (comp->lines == NULL ||
+                res->win_y0 - (OPJ_UINT32)res->y0 != comp->next_row) {
+            opj_event_msg(p_manager, EVT_ERROR,
+                          "Strips of a tile must be decoded in order\n");
+            return OPJ_FALSE;
+        }
+        for (y = res->win_y0; y < res->win_y1; y++) {
+            const OPJ_INT32* l_row;
+            if (!opj_dwt_lines_next(comp->lines, &l_row)) {
+                return OPJ_FALSE;
+            }
+            memcpy(l_dst, l_row + l_x0, l_width * sizeof(OPJ_INT32));
+            l_dst += l_width;
+        }
+        comp->next_row += res->win_y1 - res->win_y0;
+    }
+    if (p_tcd->stats) {
+        /* Leave out the tier-1 decoding of the code-blocks reached by the */
+        /* transform, that has been accounted for by opj_tcd_strip_band_row() */
+        const opj_stage_time_t* l_t1 =
+            &p_tcd->stats->stages[opj_tcd_t1_stage(p_tcd)];
+        l_start.wall_time += l_t1->wall_time - l_t1_time.wall_time;
+        l_start.cpu_time += l_t1->cpu_time - l_t1_time.cpu_time;
+    }
+    OPJ_TCD_STAGE_END(p_tcd, l_start, OPJ_STAGE_DWT);
 
     /*----------------MCT-------------------*/
-    /* FIXME _ProfStart(PGROUP_MCT); */
-    if
-    (! opj_tcd_mct_decode(p_tcd, p_manager)) {
+    OPJ_TCD_STAGE_BEGIN(p_tcd, l_start);
+    if (!opj_tcd_mct_decode(p_tcd, p_manager)) {
         return OPJ_FALSE;
     }
-    /* FIXME _ProfStop(PGROUP_MCT); */
-
-    /* FIXME _ProfStart(PGROUP_DC_SHIFT); */
-    if
-    (! opj_tcd_dc_level_shift_decode(p_tcd)) {
+    OPJ_TCD_STAGE_END(p_tcd, l_start, OPJ_STAGE_MCT);
+    OPJ_TCD_STAGE_BEGIN(p_tcd, l_start);
+    if (!opj_tcd_dc_level_shift_decode(p_tcd)) {
         return OPJ_FALSE;
     }
-    /* FIXME _ProfStop(PGROUP_DC_SHIFT); */
-
-
-    /*---------------TILE-------------------*/
+    OPJ_TCD_STAGE_END(p_tcd, l_start, OPJ_STAGE_DC_SHIFT);
     return OPJ_TRUE;
 }
 
@@ -1919,7 +2909,15 @@ OPJ_BOOL opj_tcd_update_tile_data(opj_tcd_t *p_tcd,
 
 
 
-static void opj_tcd_free_tile(opj_tcd_t *p_tcd)
+static void* opj_tcd_calloc_structure(opj_tcd_t *p_tcd, size_t p_size)
+{
+    if (p_tcd->arena) {
+        return opj_arena_calloc(p_tcd->arena, 1, p_size);
+    }
+    return opj_calloc(1, p_size);
+}
+
+static void opj_tcd_free_tile_structures(opj_tcd_t *p_tcd)
 {
     OPJ_UINT32 compno, resno, bandno, precno;
     opj_tcd_tile_t *l_tile = 00;
@@ -1928,21 +2926,6 @@ static void opj_tcd_free_tile(opj_tcd_t *p_tcd)
     opj_tcd_band_t *l_band = 00;
     opj_tcd_precinct_t *l_precinct = 00;
     OPJ_UINT32 l_nb_resolutions, l_nb_precincts;
-    void (* l_tcd_code_block_deallocate)(opj_tcd_precinct_t *) = 00;
-
-    if (! p_tcd) {
-        return;
-    }
-
-    if (! p_tcd->tcd_image) {
-        return;
-    }
-
-    if (p_tcd->m_is_decoder) {
-        l_tcd_code_block_deallocate = opj_tcd_code_block_dec_deallocate;
-    } else {
-        l_tcd_code_block_deallocate = opj_tcd_code_block_enc_deallocate;
-    }
 
     l_tile = p_tcd->tcd_image->tiles;
     if (! l_tile) {
@@ -1970,23 +2953,69 @@ static void opj_tcd_free_tile(opj_tcd_t *p_tcd)
                             l_precinct->incltree = 00;
                             opj_tgt_destroy(l_precinct->imsbtree);
                             l_precinct->imsbtree = 00;
-                            (*l_tcd_code_block_deallocate)(l_precinct);
+                            if (p_tcd->m_is_decoder) {
+                                opj_tcd_code_block_dec_deallocate(p_tcd, l_precinct);
+                            } else {
+                                opj_tcd_code_block_enc_deallocate(l_precinct);
+                            }
                             ++l_precinct;
                         }
 
-                        opj_free(l_band->precincts);
-                        l_band->precincts = 00;
-                    }
-                    ++l_band;
-                } /* for (resno */
-                ++l_res;
-            }
+                        if (! p_tcd->arena) {
+                            opj_free(l_band->precincts);
+                        }
+                        l_band->precincts = 00;
+                        l_band->precincts_data_size = 0;
+                    }
+                    ++l_band;
+                } /* for (resno */
+                ++l_res;
+            }
+
+            if (! p_tcd->arena) {
+                opj_free(l_tile_comp->resolutions);
+            }
+            l_tile_comp->resolutions = 00;
+            l_tile_comp->resolutions_size = 0;
+        }
+        ++l_tile_comp;
+    }
+
+    if (p_tcd->arena) {
+        OPJ_UINT32 i;
+        opj_arena_reset(p_tcd->arena);
+        for (i = 0; i < p_tcd->nb_t2_arenas; ++i) {
+            opj_arena_reset(p_tcd->t2_arenas[i]);
+        }
+    }
+}
+
+static void opj_tcd_free_tile(opj_tcd_t *p_tcd)
+{
+    OPJ_UINT32 compno;
+    opj_tcd_tile_t *l_tile = 00;
+    opj_tcd_tilecomp_t *l_tile_comp = 00;
+
+    if (! p_tcd) {
+        return;
+    }
+
+    if (! p_tcd->tcd_image) {
+        return;
+    }
+
+    l_tile = p_tcd->tcd_image->tiles;
+    if (! l_tile) {
+        return;
+    }
 
-            opj_free(l_tile_comp->resolutions);
-            l_tile_comp->resolutions = 00;
-        }
+    opj_tcd_free_tile_structures(p_tcd);
+
+    l_tile_comp = l_tile->comps;
 
+    for (compno = 0; compno < l_tile->numcomps; ++compno) {
         if (l_tile_comp->ownsData && l_tile_comp->data) {
+            opj_mem_counter_remove(p_tcd->mem_counter, l_tile_comp->data_size);
             opj_image_data_free(l_tile_comp->data);
             l_tile_comp->data = 00;
             l_tile_comp->ownsData = 0;
@@ -1994,7 +3023,8 @@ static void opj_tcd_free_tile(opj_tcd_t *p_tcd)
             l_tile_comp->data_size_needed = 0;
         }
 
-        opj_image_data_free(l_tile_comp->data_win);
+        opj_tcd_free_decode_window_data(p_tcd, l_tile_comp);
+        opj_tcd_release_dwt_state(l_tile_comp);
 
         ++l_tile_comp;
     }
@@ -2006,6 +3036,91 @@ static void opj_tcd_free_tile(opj_tcd_t *p_tcd)
 }
 
 
+static OPJ_BOOL opj_tcd_is_t2_reusable(opj_tcd_t *p_tcd,
+                                       OPJ_BYTE * p_src_data,
+                                       OPJ_UINT32 p_max_src_size)
+{
+    OPJ_UINT32 compno;
+    opj_tcd_tile_t * l_tile = p_tcd->tcd_image->tiles;
+
+    if (p_tcd->t2_numlayers < p_tcd->tcp->num_layers_to_decode ||
+            p_tcd->t2_src != p_src_data ||
+            p_tcd->t2_src_size != p_max_src_size ||
+            p_tcd->t2_win_x0 != p_tcd->win_x0 ||
+            p_tcd->t2_win_y0 != p_tcd->win_y0 ||
+            p_tcd->t2_win_x1 != p_tcd->win_x1 ||
+            p_tcd->t2_win_y1 != p_tcd->win_y1) {
+        return OPJ_FALSE;
+    }
+    for (compno = 0; compno < l_tile->numcomps; ++compno) {
+        if (l_tile->comps[compno].t2_numres !=
+                l_tile->comps[compno].minimum_num_resolutions) {
+            return OPJ_FALSE;
+        }
+    }
+    return OPJ_TRUE;
+}
+
+static void opj_tcd_select_layers(opj_tcd_t *p_tcd, OPJ_BOOL p_t2_done)
+{
+    OPJ_UINT32 compno, resno, bandno, precno, cblkno, i;
+    opj_tcd_tile_t * l_tile = p_tcd->tcd_image->tiles;
+    OPJ_UINT32 l_numlayers = p_tcd->tcp->num_layers_to_decode;
+
+    for (compno = 0; compno < l_tile->numcomps; ++compno) {
+        opj_tcd_tilecomp_t* l_tilec = &(l_tile->comps[compno]);
+
+        for (resno = 0; resno < l_tilec->minimum_num_resolutions; ++resno) {
+            opj_tcd_resolution_t* l_res = &(l_tilec->resolutions[resno]);
+
+            for (bandno = 0; bandno < l_res->numbands; ++bandno) {
+                opj_tcd_band_t* l_band = &(l_res->bands[bandno]);
+
+                if (opj_tcd_is_band_empty(l_band)) {
+                    continue;
+                }
+                for (precno = 0; precno < l_res->pw * l_res->ph; ++precno) {
+                    opj_tcd_precinct_t* l_prc = &(l_band->precincts[precno]);
+                    opj_tcd_cblk_dec_t* l_cblk = l_prc->cblks.dec;
+
+                    for (cblkno = 0; cblkno < l_prc->cw * l_prc->ch;
+                            ++cblkno, ++l_cblk) {
+                        OPJ_UINT32 l_layers;
+
+                        if (p_t2_done) {
+                            l_cblk->numchunksread = l_cblk->numchunks;
+                            if (!l_cblk->corrupted) {
+                                l_cblk->corrupted_layno = (OPJ_UINT32)(-1);
+                            }
+                        }
+
+                        /* Use the chunks of the layers before the first */
+                        /* corrupted one, as if the packets of the others */
+                        /* had been skipped */
+                        l_layers = opj_uint_min(l_numlayers, l_cblk->corrupted_layno);
+                        l_cblk->corrupted = l_cblk->corrupted_layno < l_numlayers;
+                        for (i = 0; i < l_cblk->numsegs; ++i) {
+                            l_cblk->segs[i].len = 0;
+                            l_cblk->segs[i].real_num_passes = 0;
+                        }
+                        l_cblk->real_num_segs = 0;
+                        for (i = 0; i < l_cblk->numchunksread &&
+                                l_cblk->chunks[i].layno < l_layers; ++i) {
+                            const opj_tcd_seg_data_chunk_t* l_chunk =
+                                &(l_cblk->chunks[i]);
+                            l_cblk->segs[l_chunk->segno].len += l_chunk->len;
+                            l_cblk->segs[l_chunk->segno].real_num_passes +=
+                                l_chunk->numpasses;
+                            l_cblk->real_num_segs = l_chunk->segno + 1;
+                        }
+                        l_cblk->numchunks = l_cblk->corrupted ? 0 : i;
+                    }
+                }
+            }
+        }
+    }
+}
+
 static OPJ_BOOL opj_tcd_t2_decode(opj_tcd_t *p_tcd,
                                   OPJ_BYTE * p_src_data,
                                   OPJ_UINT32 * p_data_read,
@@ -2015,11 +3130,31 @@ static OPJ_BOOL opj_tcd_t2_decode(opj_tcd_t *p_tcd,
                                  )
 {
     opj_t2_t * l_t2;
+    OPJ_UINT32 compno;
+    opj_tcd_tile_t * l_tile = p_tcd->tcd_image->tiles;
+
+    if (p_tcd->refinable &&
+            opj_tcd_is_t2_reusable(p_tcd, p_src_data, p_max_src_size)) {
+        /* All the packets of the window of interest have already been */
+        /* read: only select the chunks of the layers to decode */
+        for (compno = 0; compno < l_tile->numcomps; ++compno) {
+            p_tcd->image->comps[compno].resno_decoded =
+                l_tile->comps[compno].t2_resno_decoded;
+        }
+        *p_data_read = p_tcd->t2_data_read;
+        opj_tcd_select_layers(p_tcd, OPJ_FALSE);
+        return OPJ_TRUE;
+    }
+    p_tcd->t2_numlayers = 0;
 
     l_t2 = opj_t2_create(p_tcd->image, p_tcd->cp);
     if (l_t2 == 00) {
         return OPJ_FALSE;
     }
+    l_t2->arena = p_tcd->arena;
+    /* When the tile may be decoded again with more quality layers, the */
+    /* packets of all of them are read now */
+    l_t2->all_layers = p_tcd->refinable && !p_tcd->tcp->m_data_truncated;
 
     if (! opj_t2_decode_packets(
                 p_tcd,
@@ -2035,6 +3170,24 @@ static OPJ_BOOL opj_tcd_t2_decode(opj_tcd_t *p_tcd,
         return OPJ_FALSE;
     }
 
+    if (l_t2->all_layers) {
+        p_tcd->t2_numlayers = p_tcd->tcp->numlayers;
+        p_tcd->t2_src = p_src_data;
+        p_tcd->t2_src_size = p_max_src_size;
+        p_tcd->t2_win_x0 = p_tcd->win_x0;
+        p_tcd->t2_win_y0 = p_tcd->win_y0;
+        p_tcd->t2_win_x1 = p_tcd->win_x1;
+        p_tcd->t2_win_y1 = p_tcd->win_y1;
+        p_tcd->t2_data_read = *p_data_read;
+        for (compno = 0; compno < l_tile->numcomps; ++compno) {
+            l_tile->comps[compno].t2_numres =
+                l_tile->comps[compno].minimum_num_resolutions;
+            l_tile->comps[compno].t2_resno_decoded =
+                p_tcd->image->comps[compno].resno_decoded;
+        }
+        opj_tcd_select_layers(p_tcd, OPJ_TRUE);
+    }
+
     opj_t2_destroy(l_t2);
 
     /*---------------CLEAN-------------------*/
@@ -2111,18 +3264,153 @@ static OPJ_BOOL opj_tcd_dwt_decode(opj_tcd_t *p_tcd)
     return OPJ_TRUE;
 }
 
-static OPJ_BOOL opj_tcd_mct_decode(opj_tcd_t *p_tcd, opj_event_mgr_t *p_manager)
+static OPJ_BOOL opj_tcd_t1_dwt_decode_pipelined(opj_tcd_t *p_tcd,
+        opj_event_mgr_t *p_manager)
 {
+    OPJ_UINT32 compno, resno;
     opj_tcd_tile_t * l_tile = p_tcd->tcd_image->tiles;
-    opj_tcp_t * l_tcp = p_tcd->tcp;
-    opj_tcd_tilecomp_t * l_tile_comp = l_tile->comps;
-    OPJ_SIZE_T l_samples;
-    OPJ_UINT32 i;
+    opj_tccp_t * l_tccp = p_tcd->tcp->tccps;
+    volatile OPJ_BOOL ret = OPJ_TRUE;
+    OPJ_BOOL check_pterm = OPJ_FALSE;
+    opj_mutex_t* p_manager_mutex = NULL;
+    /* One view of the thread pool per resolution level, to be able to */
+    /* wait for the code-blocks of a given resolution level */
+    opj_thread_pool_t** l_res_tp = NULL;
+    /* Thread pool without threads, to run the inverse DWT in this thread */
+    opj_thread_pool_t* l_serial_tp = NULL;
+    OPJ_UINT32 l_numres = 0;
 
-    if (l_tcp->mct == 0 || p_tcd->used_component != NULL) {
+    for (compno = 0; compno < l_tile->numcomps; ++compno) {
+        if (p_tcd->used_component != NULL && !p_tcd->used_component[compno]) {
+            continue;
+        }
+        l_numres = opj_uint_max(l_numres,
+                                l_tile->comps[compno].minimum_num_resolutions);
+    }
+    if (l_numres == 0) {
         return OPJ_TRUE;
     }
 
+    /* Only enable PTERM check if we decode all layers */
+    if (p_tcd->tcp->num_layers_to_decode == p_tcd->tcp->numlayers &&
+            (l_tccp->cblksty & J2K_CCP_CBLKSTY_PTERM) != 0) {
+        check_pterm = OPJ_TRUE;
+    }
+
+    p_manager_mutex = opj_mutex_create();
+    l_serial_tp = opj_thread_pool_create(0);
+    l_res_tp = (opj_thread_pool_t**) opj_calloc(l_numres,
+               sizeof(opj_thread_pool_t*));
+    if (l_serial_tp == NULL || l_res_tp == NULL) {
+        ret = OPJ_FALSE;
+    }
+    for (resno = 0; ret && resno < l_numres; ++resno) {
+        l_res_tp[resno] = opj_thread_pool_create_view(p_tcd->thread_pool);
+        if (l_res_tp[resno] == NULL) {
+            ret = OPJ_FALSE;
+        }
+    }
+    if (!ret) {
+        opj_event_msg(p_manager, EVT_ERROR,
+                      "Not enough memory to decode tile\n");
+    }
+
+    /* Submit the decoding of all code-blocks, lowest resolutions first */
+    for (resno = 0; ret && resno < l_numres; ++resno) {
+        for (compno = 0; compno < l_tile->numcomps; ++compno) {
+            opj_tcd_tilecomp_t* tilec = &(l_tile->comps[compno]);
+            if (p_tcd->used_component != NULL && !p_tcd->used_component[compno]) {
+                continue;
+            }
+            if (resno >= tilec->minimum_num_resolutions) {
+                continue;
+            }
+            opj_t1_decode_cblks_resolution(p_tcd, l_res_tp[resno], resno, &ret,
+                                           tilec, &(l_tccp[compno]),
+                                           p_manager, p_manager_mutex,
+                                           check_pterm);
+            if (!ret) {
+                break;
+            }
+        }
+    }
+
+    /* Reconstruct each resolution level as soon as its code-blocks are */
+    /* decoded. The inverse DWT of the intermediate resolution levels is */
+    /* run by this thread, while the worker threads are still busy with the */
+    /* code-blocks of the higher resolutions. The last one uses all threads */
+    for (resno = 0; ret && resno < l_numres; ++resno) {
+        opj_thread_pool_t* l_dwt_tp = (resno + 1 == l_numres) ?
+                                      p_tcd->thread_pool : l_serial_tp;
+        opj_stage_time_t l_start;
+
+        opj_thread_pool_wait_completion(l_res_tp[resno], 0);
+        if (!ret || resno == 0) {
+            continue;
+        }
+
+        OPJ_TCD_STAGE_BEGIN(p_tcd, l_start);
+        for (compno = 0; compno < l_tile->numcomps; ++compno) {
+            opj_tcd_tilecomp_t* tilec = &(l_tile->comps[compno]);
+            OPJ_BOOL l_dwt_ret;
+
+            if (p_tcd->used_component != NULL && !p_tcd->used_component[compno]) {
+                continue;
+            }
+            if (resno > p_tcd->image->comps[compno].resno_decoded) {
+                continue;
+            }
+            if (l_tccp[compno].qmfbid == 1) {
+                l_dwt_ret = opj_dwt_decode_tile_resolution(l_dwt_tp, tilec, resno);
+            } else {
+                l_dwt_ret = opj_dwt_decode_tile_resolution_real(l_dwt_tp, tilec,
+                            resno);
+            }
+            if (!l_dwt_ret) {
+                ret = OPJ_FALSE;
+                break;
+            }
+        }
+        OPJ_TCD_STAGE_END(p_tcd, l_start, OPJ_STAGE_DWT);
+    }
+
+    if (l_res_tp) {
+        /* Destroying a view waits for the completion of its jobs */
+        for (resno = 0; resno < l_numres; ++resno) {
+            if (l_res_tp[resno] != NULL && p_tcd->stats) {
+                /* The CPU time of the tier-1 jobs is not accounted for by */
+                /* p_tcd->thread_pool */
+                opj_thread_pool_wait_completion(l_res_tp[resno], 0);
+                p_tcd->stats->stages[opj_tcd_t1_stage(p_tcd)].cpu_time +=
+                    opj_thread_pool_get_jobs_cpu_time(l_res_tp[resno]);
+            }
+            opj_thread_pool_destroy(l_res_tp[resno]);
+        }
+        opj_free(l_res_tp);
+    }
+    opj_thread_pool_destroy(l_serial_tp);
+    if (p_manager_mutex) {
+        opj_mutex_destroy(p_manager_mutex);
+    }
+    return ret;
+}
+
+/**
+Compute the number of samples to which the MCT applies, and check that the
+components to which it applies have the same dimensions.
+@param p_tcd TCD handle
+@param p_manager the event manager
+@param p_samples pointer to the number of samples
+@return OPJ_FALSE if the MCT cannot be applied
+*/
+static OPJ_BOOL opj_tcd_mct_decode_get_samples(opj_tcd_t *p_tcd,
+        opj_event_mgr_t *p_manager,
+        OPJ_SIZE_T* p_samples)
+{
+    opj_tcd_tile_t * l_tile = p_tcd->tcd_image->tiles;
+    opj_tcd_tilecomp_t * l_tile_comp = l_tile->comps;
+    OPJ_SIZE_T l_samples;
+
     if (p_tcd->whole_tile_decoding) {
         opj_tcd_resolution_t* res_comp0 = l_tile->comps[0].resolutions +
                                           l_tile_comp->minimum_num_resolutions - 1;
@@ -2188,6 +3476,26 @@ static OPJ_BOOL opj_tcd_mct_decode(opj_tcd_t *p_tcd, opj_event_mgr_t *p_manager)
         }
     }
 
+    *p_samples = l_samples;
+    return OPJ_TRUE;
+}
+
+static OPJ_BOOL opj_tcd_mct_decode(opj_tcd_t *p_tcd, opj_event_mgr_t *p_manager)
+{
+    opj_tcd_tile_t * l_tile = p_tcd->tcd_image->tiles;
+    opj_tcp_t * l_tcp = p_tcd->tcp;
+    opj_tcd_tilecomp_t * l_tile_comp = l_tile->comps;
+    OPJ_SIZE_T l_samples;
+    OPJ_UINT32 i;
+
+    if (l_tcp->mct == 0 || p_tcd->used_component != NULL) {
+        return OPJ_TRUE;
+    }
+
+    if (!opj_tcd_mct_decode_get_samples(p_tcd, p_manager, &l_samples)) {
+        return OPJ_FALSE;
+    }
+
     if (l_tile->numcomps >= 3) {
         if (l_tcp->mct == 2) {
             OPJ_BYTE ** l_data;
@@ -2262,6 +3570,70 @@ static OPJ_BOOL opj_tcd_mct_decode(opj_tcd_t *p_tcd, opj_event_mgr_t *p_manager)
 }
 
 
+/**
+Apply the DC level shift, and clamp to the range of the image component, to
+a block of samples.
+@param l_tccp Tile-component coding parameters
+@param l_img_comp Image component
+@param l_current_ptr Pointer to the first sample of the block
+@param l_width Width of the block
+@param l_height Height of the block
+@param l_stride Number of samples between the end of a row and the start of
+the next one
+*/
+static void opj_tcd_dc_level_shift_decode_block(const opj_tccp_t * l_tccp,
+        const opj_image_comp_t * l_img_comp,
+        OPJ_INT32 * l_current_ptr,
+        OPJ_UINT32 l_width,
+        OPJ_UINT32 l_height,
+        OPJ_UINT32 l_stride)
+{
+    OPJ_UINT32 i, j;
+    OPJ_INT32 l_min, l_max;
+
+    if (l_img_comp->sgnd) {
+        l_min = -(1 << (l_img_comp->prec - 1));
+        l_max = (1 << (l_img_comp->prec - 1)) - 1;
+    } else {
+        l_min = 0;
+        l_max = (OPJ_INT32)((1U << l_img_comp->prec) - 1);
+    }
+
+    if (l_width == 0 || l_height == 0) {
+        return;
+    }
+
+    if (l_tccp->qmfbid == 1) {
+        for (j = 0; j < l_height; ++j) {
+            for (i = 0; i < l_width; ++i) {
+                /* TODO: do addition on int64 ? */
+                *l_current_ptr = opj_int_clamp(*l_current_ptr + l_tccp->m_dc_level_shift, l_min,
+                                               l_max);
+                ++l_current_ptr;
+            }
+            l_current_ptr += l_stride;
+        }
+    } else {
+        for (j = 0; j < l_height; ++j) {
+            for (i = 0; i < l_width; ++i) {
+                OPJ_FLOAT32 l_value = *((OPJ_FLOAT32 *) l_current_ptr);
+                if (l_value > (OPJ_FLOAT32)INT_MAX) {
+                    *l_current_ptr = l_max;
+                } else if (l_value < INT_MIN) {
+                    *l_current_ptr = l_min;
+                } else {
+                    /* Do addition on int64 to avoid overflows */
+                    OPJ_INT64 l_value_int = (OPJ_INT64)opj_lrintf(l_value);
+                    *l_current_ptr = (OPJ_INT32)opj_int64_clamp(
+                                         l_value_int + l_tccp->m_dc_level_shift, l_min, l_max);
+                }
+                ++l_current_ptr;
+            }
+            l_current_ptr += l_stride;
+        }
+    }
+}
+
 static OPJ_BOOL opj_tcd_dc_level_shift_decode(opj_tcd_t *p_tcd)
 {
     OPJ_UINT32 compno;
@@ -2270,9 +3642,8 @@ static OPJ_BOOL opj_tcd_dc_level_shift_decode(opj_tcd_t *p_tcd)
     opj_image_comp_t * l_img_comp = 00;
     opj_tcd_resolution_t* l_res = 00;
     opj_tcd_tile_t * l_tile;
-    OPJ_UINT32 l_width, l_height, i, j;
+    OPJ_UINT32 l_width, l_height;
     OPJ_INT32 * l_current_ptr;
-    OPJ_INT32 l_min, l_max;
     OPJ_UINT32 l_stride;
 
     l_tile = p_tcd->tcd_image->tiles;
@@ -2307,47 +3678,258 @@ static OPJ_BOOL opj_tcd_dc_level_shift_decode(opj_tcd_t *p_tcd)
                    l_width + l_stride <= l_tile_comp->data_size / l_height); /*MUPDF*/
         }
 
-        if (l_img_comp->sgnd) {
-            l_min = -(1 << (l_img_comp->prec - 1));
-            l_max = (1 << (l_img_comp->prec - 1)) - 1;
-        } else {
-            l_min = 0;
-            l_max = (OPJ_INT32)((1U << l_img_comp->prec) - 1);
-        }
+        opj_tcd_dc_level_shift_decode_block(l_tccp, l_img_comp, l_current_ptr,
+                                            l_width, l_height, l_stride);
+    }
 
-        if (l_width == 0 || l_height == 0) {
-            continue;
+    return OPJ_TRUE;
+}
+
+/** Width of the buffer of a tile component, when decoding a whole tile */
+static OPJ_UINT32 opj_tcd_get_buffer_width(const opj_tcd_tilecomp_t* tilec)
+{
+    const opj_tcd_resolution_t* l_res = tilec->resolutions +
+                                        tilec->minimum_num_resolutions - 1;
+    return (OPJ_UINT32)(l_res->x1 - l_res->x0);
+}
+
+/** Target size in bytes of the samples of all components of a strip */
+/** processed by opj_tcd_mct_dc_level_shift_decode_strips() */
+#define OPJ_TCD_STRIP_SIZE (256 * 1024)
+
+typedef struct {
+    opj_tcd_t* tcd;
+    /** Whether the reversible or irreversible MCT must be applied */
+    OPJ_BOOL mct;
+    /** Number of rows of a strip. A multiple of 8 */
+    OPJ_UINT32 strip_height;
+    /** First row of the range of rows processed by the job */
+    OPJ_UINT32 min_y;
+    /** Last row (excluded) of the range of rows processed by the job */
+    OPJ_UINT32 max_y;
+    /** Where to add the time spent by the job in the MCT and in the DC */
+    /** level shift, or NULL if statistics are not collected */
+    OPJ_FLOAT64* durations;
+} opj_tcd_mct_dc_level_shift_job_t;
+
+static void opj_tcd_mct_dc_level_shift_decode_func(void* user_data,
+        opj_tls_t* tls)
+{
+    opj_tcd_mct_dc_level_shift_job_t* job =
+        (opj_tcd_mct_dc_level_shift_job_t*)user_data;
+    opj_tcd_t* p_tcd = job->tcd;
+    opj_tcd_tile_t * l_tile = p_tcd->tcd_image->tiles;
+    OPJ_UINT32 compno;
+    OPJ_UINT32 y, y_end;
+    OPJ_FLOAT64 l_t0 = 0, l_t1;
+
+    (void)tls;
+
+    for (y = job->min_y; y < job->max_y; y = y_end) {
+        y_end = opj_uint_min(y + job->strip_height, job->max_y);
+
+        if (job->durations) {
+            l_t0 = opj_wallclock();
         }
 
-        if (l_tccp->qmfbid == 1) {
-            for (j = 0; j < l_height; ++j) {
-                for (i = 0; i < l_width; ++i) {
-                    /* TODO: do addition on int64 ? */
-                    *l_current_ptr = opj_int_clamp(*l_current_ptr + l_tccp->m_dc_level_shift, l_min,
-                                                   l_max);
-                    ++l_current_ptr;
+        if (job->mct) {
+            /* The MCT applies to all samples of the tile component buffers, */
+            /* that are checked to have the same dimensions. Strips start on */
+            /* a multiple of 8 rows, and thus of 8 samples, so that the */
+            /* alignment requirements of opj_mct_decode() are satisfied */
+            opj_tcd_tilecomp_t* l_tile_comp = l_tile->comps;
+            opj_tcd_resolution_t* l_res = l_tile_comp->resolutions +
+                                          l_tile_comp->minimum_num_resolutions - 1;
+            OPJ_SIZE_T l_w = (OPJ_SIZE_T)(l_res->x1 - l_res->x0);
+            OPJ_UINT32 l_h = (OPJ_UINT32)(l_res->y1 - l_res->y0);
+
+            if (y < l_h) {
+                OPJ_SIZE_T l_offset = (OPJ_SIZE_T)y * l_w;
+                OPJ_SIZE_T l_samples = (OPJ_SIZE_T)(opj_uint_min(y_end, l_h) - y) * l_w;
+                if (p_tcd->tcp->tccps->qmfbid == 1) {
+                    opj_mct_decode(l_tile->comps[0].data + l_offset,
+                                   l_tile->comps[1].data + l_offset,
+                                   l_tile->comps[2].data + l_offset,
+                                   l_samples);
+                } else {
+                    opj_mct_decode_real((OPJ_FLOAT32*)l_tile->comps[0].data + l_offset,
+                                        (OPJ_FLOAT32*)l_tile->comps[1].data + l_offset,
+                                        (OPJ_FLOAT32*)l_tile->comps[2].data + l_offset,
+                                        l_samples);
                 }
-                l_current_ptr += l_stride;
             }
-        } else {
-            for (j = 0; j < l_height; ++j) {
-                for (i = 0; i < l_width; ++i) {
-                    OPJ_FLOAT32 l_value = *((OPJ_FLOAT32 *) l_current_ptr);
-                    if (l_value > (OPJ_FLOAT32)INT_MAX) {
-                        *l_current_ptr = l_max;
-                    } else if (l_value < INT_MIN) {
-                        *l_current_ptr = l_min;
-                    } else {
-                        /* Do addition on int64 to avoid overflows */
-                        OPJ_INT64 l_value_int = (OPJ_INT64)opj_lrintf(l_value);
-                        *l_current_ptr = (OPJ_INT32)opj_int64_clamp(
-                                             l_value_int + l_tccp->m_dc_level_shift, l_min, l_max);
-                    }
-                    ++l_current_ptr;
-                }
-                l_current_ptr += l_stride;
+        }
+
+        if (job->durations) {
+            l_t1 = opj_wallclock();
+            job->durations[0] += l_t1 - l_t0;
+            l_t0 = l_t1;
+        }
+
+        for (compno = 0; compno < l_tile->numcomps; ++compno) {
+            opj_tcd_tilecomp_t* l_tile_comp = &(l_tile->comps[compno]);
+            opj_image_comp_t* l_img_comp = &(p_tcd->image->comps[compno]);
+            opj_tcd_resolution_t* l_res = l_tile_comp->resolutions +
+                                          l_img_comp->resno_decoded;
+            OPJ_UINT32 l_width = (OPJ_UINT32)(l_res->x1 - l_res->x0);
+            OPJ_UINT32 l_height = (OPJ_UINT32)(l_res->y1 - l_res->y0);
+            OPJ_UINT32 l_w = opj_tcd_get_buffer_width(l_tile_comp);
+
+            if (p_tcd->used_component != NULL && !p_tcd->used_component[compno]) {
+                continue;
+            }
+            if (y >= l_height) {
+                continue;
             }
+            opj_tcd_dc_level_shift_decode_block(&(p_tcd->tcp->tccps[compno]),
+                                                l_img_comp,
+                                                l_tile_comp->data + (OPJ_SIZE_T)y * l_w,
+                                                l_width,
+                                                opj_uint_min(y_end, l_height) - y,
+                                                l_w - l_width);
+        }
+
+        if (job->durations) {
+            job->durations[1] += opj_wallclock() - l_t0;
+        }
+    }
+
+    opj_free(job);
+}
+
+static OPJ_BOOL opj_tcd_mct_dc_level_shift_decode_strips(opj_tcd_t *p_tcd,
+        opj_event_mgr_t *p_manager)
+{
+    opj_tcd_tile_t * l_tile = p_tcd->tcd_image->tiles;
+    opj_tcp_t * l_tcp = p_tcd->tcp;
+    OPJ_BOOL l_mct = (l_tcp->mct != 0 && p_tcd->used_component == NULL);
+    OPJ_UINT32 compno;
+    OPJ_UINT32 l_height = 0;
+    OPJ_SIZE_T l_row_size = 0;
+    OPJ_UINT32 l_strip_height;
+    OPJ_UINT32 l_job_height;
+    OPJ_UINT32 l_nb_jobs;
+    OPJ_UINT32 y;
+    int num_threads;
+    opj_stage_time_t l_start;
+    OPJ_FLOAT64* l_durations = NULL;
+
+    if (l_mct && (l_tcp->mct == 2 || l_tile->numcomps < 3 ||
+                  opj_tcd_get_buffer_width(&(l_tile->comps[0])) !=
+                  opj_tcd_get_buffer_width(&(l_tile->comps[1])) ||
+                  opj_tcd_get_buffer_width(&(l_tile->comps[0])) !=
+                  opj_tcd_get_buffer_width(&(l_tile->comps[2])))) {
+        /* Custom MCT, or components whose rows do not match: process */
+        /* whole tile components */
+        OPJ_TCD_STAGE_BEGIN(p_tcd, l_start);
+        if (!opj_tcd_mct_decode(p_tcd, p_manager)) {
+            return OPJ_FALSE;
+        }
+        OPJ_TCD_STAGE_END(p_tcd, l_start, OPJ_STAGE_MCT);
+        OPJ_TCD_STAGE_BEGIN(p_tcd, l_start);
+        if (!opj_tcd_dc_level_shift_decode(p_tcd)) {
+            return OPJ_FALSE;
+        }
+        OPJ_TCD_STAGE_END(p_tcd, l_start, OPJ_STAGE_DC_SHIFT);
+        return OPJ_TRUE;
+    }
+    OPJ_TCD_STAGE_BEGIN(p_tcd, l_start);
+    if (l_mct) {
+        OPJ_SIZE_T l_samples;
+        if (!opj_tcd_mct_decode_get_samples(p_tcd, p_manager, &l_samples)) {
+            return OPJ_FALSE;
+        }
+    }
+
+    for (compno = 0; compno < l_tile->numcomps; ++compno) {
+        opj_tcd_tilecomp_t* l_tile_comp = &(l_tile->comps[compno]);
+        opj_tcd_resolution_t* l_res = l_tile_comp->resolutions +
+                                      l_tile_comp->minimum_num_resolutions - 1;
+        if (p_tcd->used_component != NULL && !p_tcd->used_component[compno]) {
+            continue;
+        }
+        l_height = opj_uint_max(l_height, (OPJ_UINT32)(l_res->y1 - l_res->y0));
+        l_row_size += (OPJ_SIZE_T)(l_res->x1 - l_res->x0) * sizeof(OPJ_INT32);
+    }
+    if (l_height == 0 || l_row_size == 0) {
+        return OPJ_TRUE;
+    }
+
+    /* Strips are a multiple of 8 rows */
+    l_strip_height = (OPJ_UINT32)opj_uint_max(8U,
+                     (OPJ_UINT32)((OPJ_TCD_STRIP_SIZE / l_row_size) & ~(OPJ_SIZE_T)7));
+    if (l_strip_height > l_height) {
+        l_strip_height = (l_height + 7U) & ~7U;
+    }
+
+    /* Each job processes a range of strips */
+    num_threads = opj_thread_pool_get_thread_count(p_tcd->thread_pool);
+    if (num_threads <= 1) {
+        l_job_height = l_height;
+    } else {
+        OPJ_UINT32 l_nb_strips = (l_height + l_strip_height - 1) / l_strip_height;
+        l_job_height = ((l_nb_strips + (OPJ_UINT32)num_threads - 1) /
+                        (OPJ_UINT32)num_threads) * l_strip_height;
+    }
+    l_nb_jobs = (l_height + l_job_height - 1) / l_job_height;
+
+    if (p_tcd->stats) {
+        /* Each job measures its own MCT and DC level shift durations */
+        l_durations = (OPJ_FLOAT64*) opj_calloc(2 * (OPJ_SIZE_T)l_nb_jobs,
+                      sizeof(OPJ_FLOAT64));
+        if (!l_durations) {
+            opj_event_msg(p_manager, EVT_ERROR,
+                          "Not enough memory to decode tile\n");
+            return OPJ_FALSE;
+        }
+    }
+
+    for (y = 0; y < l_height; y += l_job_height) {
+        opj_tcd_mct_dc_level_shift_job_t* job;
+
+        job = (opj_tcd_mct_dc_level_shift_job_t*) opj_malloc(sizeof(
+                    opj_tcd_mct_dc_level_shift_job_t));
+        if (!job) {
+            opj_thread_pool_wait_completion(p_tcd->thread_pool, 0);
+            opj_free(l_durations);
+            opj_event_msg(p_manager, EVT_ERROR,
+                          "Not enough memory to decode tile\n");
+            return OPJ_FALSE;
+        }
+        job->tcd = p_tcd;
+        job->mct = l_mct;
+        job->strip_height = l_strip_height;
+        job->min_y = y;
+        job->max_y = opj_uint_min(y + l_job_height, l_height);
+        job->durations = l_durations ? l_durations + 2 * (y / l_job_height) : NULL;
+        opj_thread_pool_submit_job(p_tcd->thread_pool,
+                                   opj_tcd_mct_dc_level_shift_decode_func, job);
+    }
+    opj_thread_pool_wait_completion(p_tcd->thread_pool, 0);
+
+    if (l_durations) {
+        /* Split the time of the fused processing between both stages, */
+        /* in proportion to the durations measured by the jobs */
+        opj_stage_time_t l_time = {0, 0};
+        OPJ_FLOAT64 l_mct_time = 0, l_dc_time = 0;
+        OPJ_FLOAT64 l_mct_ratio;
+        OPJ_UINT32 i;
+
+        for (i = 0; i < l_nb_jobs; i++) {
+            l_mct_time += l_durations[2 * i];
+            l_dc_time += l_durations[2 * i + 1];
         }
+        opj_free(l_durations);
+        l_mct_ratio = (l_mct_time + l_dc_time > 0) ?
+                      l_mct_time / (l_mct_time + l_dc_time) : 0;
+
+        OPJ_TCD_STAGE_ADD_SINCE(p_tcd, l_start, &l_time);
+        p_tcd->stats->stages[OPJ_STAGE_MCT].wall_time += l_time.wall_time * l_mct_ratio;
+        p_tcd->stats->stages[OPJ_STAGE_MCT].cpu_time += l_time.cpu_time * l_mct_ratio;
+        p_tcd->stats->stages[OPJ_STAGE_DC_SHIFT].wall_time += l_time.wall_time *
+                (1 - l_mct_ratio);
+        p_tcd->stats->stages[OPJ_STAGE_DC_SHIFT].cpu_time += l_time.cpu_time *
+                (1 - l_mct_ratio);
     }
 
     return OPJ_TRUE;
@@ -2358,7 +3940,8 @@ static OPJ_BOOL opj_tcd_dc_level_shift_decode(opj_tcd_t *p_tcd)
 /**
  * Deallocates the encoding data of the given precinct.
  */
-static void opj_tcd_code_block_dec_deallocate(opj_tcd_precinct_t * p_precinct)
+static void opj_tcd_code_block_dec_deallocate(opj_tcd_t *p_tcd,
+        opj_tcd_precinct_t * p_precinct)
 {
     OPJ_UINT32 cblkno, l_nb_code_blocks;
 
@@ -2376,24 +3959,34 @@ static void opj_tcd_code_block_dec_deallocate(opj_tcd_precinct_t * p_precinct)
 
         for (cblkno = 0; cblkno < l_nb_code_blocks; ++cblkno) {
 
+            /* The segments and chunks allocated from the arena are */
+            /* released with it */
             if (l_code_block->segs) {
-                opj_free(l_code_block->segs);
+                if (! p_tcd->arena) {
+                    opj_free(l_code_block->segs);
+                }
                 l_code_block->segs = 00;
             }
 
             if (l_code_block->chunks) {
-                opj_free(l_code_block->chunks);
+                if (! p_tcd->arena) {
+                    opj_free(l_code_block->chunks);
+                }
                 l_code_block->chunks = 00;
             }
 
-            opj_aligned_free(l_code_block->decoded_data);
-            l_code_block->decoded_data = NULL;
+            opj_tcd_free_cblk_decoded_data(p_tcd->mem_counter, l_code_block);
+            opj_free(l_code_block->dec_state);
+            l_code_block->dec_state = NULL;
 
             ++l_code_block;
         }
 
-        opj_free(p_precinct->cblks.dec);
+        if (! p_tcd->arena) {
+            opj_free(p_precinct->cblks.dec);
+        }
         p_precinct->cblks.dec = 00;
+        p_precinct->block_size = 0;
     }
 }
 
@@ -2786,15 +4379,13 @@ OPJ_BOOL opj_tcd_is_subband_area_of_interest(opj_tcd_t *tcd,
         OPJ_UINT32 band_x1,
         OPJ_UINT32 band_y1)
 {
-    /* Note: those values for filter_margin are in part the result of */
-    /* experimentation. The value 2 for QMFBID=1 (5x3 filter) can be linked */
-    /* to the maximum left/right extension given in tables F.2 and F.3 of the */
-    /* standard. The value 3 for QMFBID=0 (9x7 filter) is more suspicious, */
-    /* since F.2 and F.3 would lead to 4 instead, so the current 3 might be */
-    /* needed to be bumped to 4, in case inconsistencies are found while */
-    /* decoding parts of irreversible coded images. */
+    /* Note: those values for filter_margin are the maximum left/right */
+    /* extension given in tables F.2 and F.3 of the standard: 2 for QMFBID=1 */
+    /* (5x3 filter) and 4 for QMFBID=0 (9x7 filter). The value 3 that was */
+    /* previously used for the 9x7 filter caused differences with the whole */
+    /* tile decoding for windows of a few rows. */
     /* See opj_dwt_decode_partial_53 and opj_dwt_decode_partial_97 as well */
-    OPJ_UINT32 filter_margin = (tcd->tcp->tccps[compno].qmfbid == 1) ? 2 : 3;
+    OPJ_UINT32 filter_margin = (tcd->tcp->tccps[compno].qmfbid == 1) ? 2 : 4;
     opj_tcd_tilecomp_t *tilec = &(tcd->tcd_image->tiles->comps[compno]);
     opj_image_comp_t* image_comp = &(tcd->image->comps[compno]);
     /* Compute the intersection of the area of interest, expressed in tile coordinates */
@@ -97,6 +97,9 @@ typedef struct opj_tcd_seg_data_chunk {
        as long as we need to decode the codeblocks */
     OPJ_BYTE * data;
     OPJ_UINT32 len;                 /* Usable length of data */
+    OPJ_UINT32 layno;               /* Quality layer of the chunk */
+    OPJ_UINT32 segno;               /* Segment the chunk is part of */
+    OPJ_UINT32 numpasses;           /* Number of passes of the chunk */
 } opj_tcd_seg_data_chunk_t;
 
 /** Segment of a code-block.
@@ -116,6 +119,29 @@ typedef struct opj_tcd_seg {
     OPJ_UINT32 newlen;
 } opj_tcd_seg_t;
 
+/** State of the tier-1 decoding of a code-block after some of its coding
+ * passes, from which the decoding is resumed when more passes are decoded.
+ * Only used if tcd->refinable is set */
+typedef struct opj_tcd_cblk_dec_state {
+    /* Number of coding passes decoded */
+    OPJ_UINT32 numpasses;
+    /* Segment of the next coding pass, and number of its passes decoded */
+    OPJ_UINT32 segno;
+    OPJ_UINT32 passno;
+    /* State of the pass loop of opj_t1_decode_cblk() */
+    OPJ_INT32 bpno_plus_one;
+    OPJ_UINT32 passtype;
+    /* Whether the segment is decoded with the RAW decoder */
+    OPJ_BOOL raw;
+    /* State of the MQ or RAW decoder of the segment. For HT code-blocks, */
+    /* only mqc.offset is used, as the length of the cleanup segment */
+    opj_mqc_dec_state_t mqc;
+    /* Decoded coefficients, before any ROI shift or dequantization */
+    OPJ_INT32* data;
+    /* Flags of the decoder */
+    OPJ_UINT32* flags;
+} opj_tcd_cblk_dec_state_t;
+
 /** Code-block for decoding */
 typedef struct opj_tcd_cblk_dec {
     opj_tcd_seg_t* segs;            /* segments information */
@@ -141,7 +167,18 @@ typedef struct opj_tcd_cblk_dec {
     OPJ_UINT32 numchunksalloc;      /* Number of chunks item allocated */
     /* Decoded code-block. Only used for subtile decoding. Otherwise tilec->data is directly updated */
     OPJ_INT32* decoded_data;
+    /* Number of coding passes decoded into decoded_data */
+    OPJ_UINT32 decoded_numpasses;
     OPJ_BOOL corrupted; /* whether the code block data is corrupted */
+    /* Layer from which the code block data is corrupted, if tcd->refinable */
+    /* is set. Chunks are then kept for the layers before it */
+    OPJ_UINT32 corrupted_layno;
+    /* Number of chunks read by tier-2 for all the layers, if tcd->refinable */
+    /* is set. The first numchunks ones are used for decoding */
+    OPJ_UINT32 numchunksread;
+    /* Decoding state after the passes decoded into decoded_data, or NULL. */
+    /* Only used if tcd->refinable is set */
+    opj_tcd_cblk_dec_state_t* dec_state;
 } opj_tcd_cblk_dec_t;
 
 /** Precinct structure */
@@ -217,12 +254,28 @@ typedef struct opj_tcd_tilecomp {
 
     /** data of the component limited to window of interest. Only valid for decoding and if tcd->whole_tile_decoding is NOT set (so exclusive of data member) */
     OPJ_INT32 *data_win;
+    /** size of data_win in bytes. Only valid for decoding */
+    size_t data_win_size;
     /* dimension of the component limited to window of interest. Only valid for decoding and  if tcd->whole_tile_decoding is NOT set */
     OPJ_UINT32 win_x0;
     OPJ_UINT32 win_y0;
     OPJ_UINT32 win_x1;
     OPJ_UINT32 win_y1;
 
+    /** Only valid for decoding, if tcd->refinable is set. Coefficients left by the inverse wavelet transform of the previous partial decoding, in which the resolutions up to dwt_numres - 1 have been reconstructed for the window dwt_win_x0/dwt_win_y0/dwt_win_x1/dwt_win_y1. NULL if there are none, or if the code-blocks of those resolutions have changed since */
+    struct opj_sparse_array_int32* dwt_sa;
+    /** Number of resolutions reconstructed in dwt_sa */
+    OPJ_UINT32 dwt_numres;
+    /** Window dwt_sa has been reconstructed for, in the coordinates of win_x0/win_y0/win_x1/win_y1 */
+    OPJ_UINT32 dwt_win_x0;
+    OPJ_UINT32 dwt_win_y0;
+    OPJ_UINT32 dwt_win_x1;
+    OPJ_UINT32 dwt_win_y1;
+
+    /** Only valid for decoding, if tcd->refinable is set. Number of resolutions whose packets have been read by the last tier-2 decoding, and resno_decoded of the image component after it */
+    OPJ_UINT32 t2_numres;
+    OPJ_UINT32 t2_resno_decoded;
+
     /* number of pixels */
     OPJ_SIZE_T numpix;
 } opj_tcd_tilecomp_t;
@@ -288,6 +341,40 @@ typedef struct opj_tcd {
     OPJ_BOOL   whole_tile_decoding;
     /* Array of size image->numcomps indicating if a component must be decoded. NULL if all components must be decoded */
     OPJ_BOOL* used_component;
+    /** Only valid for decoding. Whether the compressed data given to opj_tcd_decode_tile() must not be written, in which case code-blocks are copied before being decoded */
+    OPJ_BOOL   src_read_only;
+    /** Only valid for decoding. Lengths of the packets of the compressed data given to opj_tcd_decode_tile(), in codestream order, used to skip packets without parsing their header. NULL if unknown */
+    const OPJ_UINT32* packet_lengths;
+    /** Only valid for decoding. Number of entries of packet_lengths */
+    OPJ_UINT32 nb_packet_lengths;
+    /** Only valid for decoding. Statistics of the decoded tile, updated by opj_tcd_decode_tile() and the decoding by strips, or NULL if they are not collected */
+    opj_tile_stats_t* stats;
+    /** Only valid for decoding. Arena the coding structures of the tile (resolutions, precincts, code-blocks, tag trees, segments and chunks) are allocated from. It is reset when the next tile is set up. */
+    opj_arena_t* arena;
+    /** Only valid for decoding. Arenas the segments and chunks of the code-blocks are allocated from by the jobs of opj_t2_decode_packets() that read packet headers concurrently. They are reset with arena. */
+    opj_arena_t** t2_arenas;
+    /** Only valid for decoding. Number of entries of t2_arenas */
+    OPJ_UINT32 nb_t2_arenas;
+    /** Only valid for decoding. Allocator of arena and t2_arenas */
+    opj_allocator_t allocator;
+    /** Only valid for decoding. Counter of the memory held by the decoding of the tile (arenas, sample buffers of the tile components and decoded data of the code-blocks), or NULL. It is not owned by the tcd. */
+    opj_mem_counter_t* mem_counter;
+    /** Only valid for decoding. Cache tier-1 moves the decoded data of code-blocks to when they leave the decoded area, and takes it back from when they enter it again, or NULL. It is not owned by the tcd. */
+    opj_cblk_cache_t* cblk_cache;
+    /** Only valid for decoding. Whether the decoded data of the code-blocks and the wavelet coefficients of the decoded resolutions are kept for the next decoding of the tile, even when the whole tile is decoded, so that the code-blocks that have no new coding pass with more quality layers are not decoded again, and that only the new resolution levels are transformed with a lower resolution factor */
+    OPJ_BOOL   refinable;
+    /** Only valid for decoding, if refinable is set. Number of quality layers whose packets have been read by the last tier-2 decoding of the tile, or 0 if the packets must be read again */
+    OPJ_UINT32 t2_numlayers;
+    /** Only valid for decoding, if refinable is set. Compressed data, window of interest and number of bytes read by the last tier-2 decoding */
+    OPJ_BYTE*  t2_src;
+    OPJ_UINT32 t2_src_size;
+    OPJ_UINT32 t2_win_x0;
+    OPJ_UINT32 t2_win_y0;
+    OPJ_UINT32 t2_win_x1;
+    OPJ_UINT32 t2_win_y1;
+    OPJ_UINT32 t2_data_read;
+    /** Only valid for decoding. State of the decoding by strips started by opj_tcd_begin_tile_strips(), or NULL */
+    struct opj_tcd_strips* strips;
 } opj_tcd_t;
 
 /**
@@ -318,9 +405,15 @@ Dump the content of a tcd structure
 /**
 Create a new TCD handle
 @param p_is_decoder FIXME DOC
+@param p_allocator Only used for decoding. Allocator of the arena of the
+coding structures of the tiles, or NULL for the default allocator.
+@param p_mem_counter Only used for decoding. Counter of the memory held by
+the decoding of the tiles, or NULL. It must outlive the TCD handle.
 @return Returns a new TCD handle if successful returns NULL otherwise
 */
-opj_tcd_t* opj_tcd_create(OPJ_BOOL p_is_decoder);
+opj_tcd_t* opj_tcd_create(OPJ_BOOL p_is_decoder,
+                          const opj_allocator_t *p_allocator,
+                          opj_mem_counter_t *p_mem_counter);
 
 /**
 Destroy a previously created TCD handle
@@ -328,6 +421,53 @@ Destroy a previously created TCD handle
 */
 void opj_tcd_destroy(opj_tcd_t *tcd);
 
+/**
+Returns the arenas used by the jobs of opj_t2_decode_packets() that read
+packet headers concurrently, and creates them if needed. They are reset when
+the next tile is set up.
+@param p_tcd TCD handle
+@param p_nb_arenas number of arenas
+@return an array of p_nb_arenas arenas, or NULL in case of failure
+*/
+opj_arena_t** opj_tcd_get_t2_arenas(opj_tcd_t *p_tcd,
+                                    OPJ_UINT32 p_nb_arenas);
+
+/**
+Frees the coefficients kept by the inverse wavelet transform of a tile
+component (see opj_tcd_tilecomp_t::dwt_sa).
+@param p_tilec tile component
+*/
+void opj_tcd_release_dwt_state(opj_tcd_tilecomp_t *p_tilec);
+
+/**
+Frees the decoded data of a code-block, if any, and removes it from a memory
+counter.
+@param p_mem_counter counter of the memory held by the decoding, or NULL
+@param p_cblk code-block
+*/
+void opj_tcd_free_cblk_decoded_data(opj_mem_counter_t *p_mem_counter,
+                                    opj_tcd_cblk_dec_t *p_cblk);
+
+/**
+Fills the key of a code-block of the current tile in the code-block cache.
+@param p_tcd TCD handle
+@param p_compno component number
+@param p_resno resolution number
+@param p_bandno band number (*not* band index, ie 0, 1, 2 or 3)
+@param p_precno precinct number
+@param p_cblkno code-block number in the precinct
+@param p_numpasses number of coding passes decoded
+@param p_key key to fill
+*/
+void opj_tcd_get_cblk_cache_key(const opj_tcd_t *p_tcd,
+                                OPJ_UINT32 p_compno,
+                                OPJ_UINT32 p_resno,
+                                OPJ_UINT32 p_bandno,
+                                OPJ_UINT32 p_precno,
+                                OPJ_UINT32 p_cblkno,
+                                OPJ_UINT32 p_numpasses,
+                                opj_cblk_cache_key_t *p_key);
+
 
 /**
  * Create a new opj_tcd_marker_info_t* structure
@@ -428,6 +568,97 @@ OPJ_BOOL opj_tcd_decode_tile(opj_tcd_t *tcd,
                              opj_codestream_index_t *cstr_info,
                              opj_event_mgr_t *manager);
 
+/**
+Stages of the decoding of a tile, run one at a time by
+opj_tcd_decode_tile_stage()
+*/
+typedef enum TCD_DECODE_STAGE {
+    OPJ_TCD_STAGE_INIT = 0,     /**< Tile initialization and allocation of the tile buffers */
+    OPJ_TCD_STAGE_T2,           /**< Tier-2 decoding (packet headers) */
+    OPJ_TCD_STAGE_T1,           /**< Tier-1 decoding of the code-blocks */
+    OPJ_TCD_STAGE_DWT,          /**< Inverse wavelet transform */
+    OPJ_TCD_STAGE_MCT,          /**< Inverse multi-component transform */
+    OPJ_TCD_STAGE_DC_SHIFT,     /**< DC level shift and clamping */
+    OPJ_TCD_NUM_STAGES
+} OPJ_TCD_DECODE_STAGE;
+
+/**
+Run one stage of the decoding of a whole tile, with all its components.
+Calling the stages in the order of OPJ_TCD_DECODE_STAGE gives the same
+samples as opj_tcd_decode_tile(), but Tier-1 decoding and the inverse DWT
+are not pipelined, and the MCT and the DC level shift are not fused on
+strips, so that each stage can be timed on its own. This is used by the
+bench_codec benchmark.
+@param tcd TCD handle
+@param stage Stage to run
+@param src Source buffer (used by OPJ_TCD_STAGE_T2)
+@param len Length of source buffer
+@param tileno Number that identifies the tile to be decoded
+@param manager the event manager.
+*/
+OPJ_BOOL opj_tcd_decode_tile_stage(opj_tcd_t *tcd,
+                                   OPJ_TCD_DECODE_STAGE stage,
+                                   OPJ_BYTE *src,
+                                   OPJ_UINT32 len,
+                                   OPJ_UINT32 tileno,
+                                   opj_event_mgr_t *manager);
+
+/**
+Start decoding a tile from a buffer by horizontal strips, which are then
+decoded with opj_tcd_decode_tile_strip(). Tier-2 decoding is done for the
+whole window of interest. Code-blocks are decoded when the inverse DWT, which
+is computed row by row, reaches them, and released when it leaves them, so
+that only a few rows of each resolution level and the code-blocks they
+intersect are kept in memory. The samples are the same as with
+opj_tcd_decode_tile().
+@param tcd TCD handle
+@param win_x0 Upper left x of region to decode (in grid coordinates)
+@param win_y0 Upper left y of region to decode (in grid coordinates)
+@param win_x1 Lower right x of region to decode (in grid coordinates)
+@param win_y1 Lower right y of region to decode (in grid coordinates)
+@param numcomps_to_decode  Size of the comps_indices array, or 0 if decoding all components.
+@param comps_indices   Array of numcomps values representing the indices
+                       of the components to decode (relative to the
+                       codestream, starting at 0). Or NULL if decoding all components.
+@param src Source buffer, which must be kept until opj_tcd_end_tile_strips()
+@param len Length of source buffer
+@param tileno Number that identifies one of the tiles to be decoded
+@param cstr_info  FIXME DOC
+@param manager the event manager.
+*/
+OPJ_BOOL opj_tcd_begin_tile_strips(opj_tcd_t *tcd,
+                                   OPJ_UINT32 win_x0,
+                                   OPJ_UINT32 win_y0,
+                                   OPJ_UINT32 win_x1,
+                                   OPJ_UINT32 win_y1,
+                                   OPJ_UINT32 numcomps_to_decode,
+                                   const OPJ_UINT32 *comps_indices,
+                                   OPJ_BYTE *src,
+                                   OPJ_UINT32 len,
+                                   OPJ_UINT32 tileno,
+                                   opj_codestream_index_t *cstr_info,
+                                   opj_event_mgr_t *manager);
+
+/**
+Decode the next strip of a tile started with opj_tcd_begin_tile_strips().
+Strips must follow each other from the top of the window of interest. The
+samples of the strip are in the data_win buffer of the tile components, and
+cover the res->win_* area of their resno_decoded resolution.
+@param tcd TCD handle
+@param win_y0 Upper y of the strip (in grid coordinates)
+@param win_y1 Lower y of the strip (in grid coordinates)
+@param manager the event manager.
+*/
+OPJ_BOOL opj_tcd_decode_tile_strip(opj_tcd_t *tcd,
+                                   OPJ_UINT32 win_y0,
+                                   OPJ_UINT32 win_y1,
+                                   opj_event_mgr_t *manager);
+
+/**
+Release the state of the decoding of a tile by strips, if any.
+@param tcd TCD handle
+*/
+void opj_tcd_end_tile_strips(opj_tcd_t *tcd);
 
 /**
  * Copies tile data from the system onto the given memory block.
@@ -467,9 +698,11 @@ OPJ_BOOL opj_tcd_copy_tile_data(opj_tcd_t *p_tcd,
 /**
  * Allocates tile component data
  *
- *
+ * @param l_tilec tile component
+ * @param p_mem_counter counter of the memory held by the decoding, or NULL
  */
-OPJ_BOOL opj_alloc_tile_component_data(opj_tcd_tilecomp_t *l_tilec);
+OPJ_BOOL opj_alloc_tile_component_data(opj_tcd_tilecomp_t *l_tilec,
+                                       opj_mem_counter_t *p_mem_counter);
 
 /** Returns whether a sub-band is empty (i.e. whether it has a null area)
  * @param band Sub-band handle.
@@ -46,6 +46,7 @@
 */
 
 opj_tgt_tree_t *opj_tgt_create(OPJ_UINT32 numleafsh, OPJ_UINT32 numleafsv,
+                               opj_arena_t *p_arena,
                                opj_event_mgr_t *p_manager)
 {
     OPJ_INT32 nplh[32];
@@ -59,7 +60,12 @@ opj_tgt_tree_t *opj_tgt_create(OPJ_UINT32 numleafsh, OPJ_UINT32 numleafsv,
     OPJ_UINT32 numlvls;
     OPJ_UINT32 n;
 
-    tree = (opj_tgt_tree_t *) opj_calloc(1, sizeof(opj_tgt_tree_t));
+    if (p_arena) {
+        tree = (opj_tgt_tree_t *) opj_arena_calloc(p_arena, 1,
+                sizeof(opj_tgt_tree_t));
+    } else {
+        tree = (opj_tgt_tree_t *) opj_calloc(1, sizeof(opj_tgt_tree_t));
+    }
     if (!tree) {
         opj_event_msg(p_manager, EVT_ERROR, "Not enough memory to create Tag-tree\n");
         return 00;
@@ -67,6 +73,7 @@ opj_tgt_tree_t *opj_tgt_create(OPJ_UINT32 numleafsh, OPJ_UINT32 numleafsv,
 
     tree->numleafsh = numleafsh;
     tree->numleafsv = numleafsv;
+    tree->arena = p_arena;
 
     numlvls = 0;
     nplh[0] = (OPJ_INT32)numleafsh;
@@ -82,16 +89,21 @@ opj_tgt_tree_t *opj_tgt_create(OPJ_UINT32 numleafsh, OPJ_UINT32 numleafsv,
 
     /* ADD */
     if (tree->numnodes == 0) {
-        opj_free(tree);
+        opj_tgt_destroy(tree);
         return 00;
     }
 
-    tree->nodes = (opj_tgt_node_t*) opj_calloc(tree->numnodes,
-                  sizeof(opj_tgt_node_t));
+    if (p_arena) {
+        tree->nodes = (opj_tgt_node_t*) opj_arena_calloc(p_arena, tree->numnodes,
+                      sizeof(opj_tgt_node_t));
+    } else {
+        tree->nodes = (opj_tgt_node_t*) opj_calloc(tree->numnodes,
+                      sizeof(opj_tgt_node_t));
+    }
     if (!tree->nodes) {
         opj_event_msg(p_manager, EVT_ERROR,
                       "Not enough memory to create Tag-tree nodes\n");
-        opj_free(tree);
+        opj_tgt_destroy(tree);
         return 00;
     }
     tree->nodes_size = tree->numnodes * (OPJ_UINT32)sizeof(opj_tgt_node_t);
@@ -176,8 +188,13 @@ opj_tgt_tree_t *opj_tgt_init(opj_tgt_tree_t * p_tree, OPJ_UINT32 p_num_leafs_h,
         l_node_size = p_tree->numnodes * (OPJ_UINT32)sizeof(opj_tgt_node_t);
 
         if (l_node_size > p_tree->nodes_size) {
-            opj_tgt_node_t* new_nodes = (opj_tgt_node_t*) opj_realloc(p_tree->nodes,
-                                        l_node_size);
+            opj_tgt_node_t* new_nodes;
+            if (p_tree->arena) {
+                new_nodes = (opj_tgt_node_t*) opj_arena_realloc(p_tree->arena,
+                            p_tree->nodes, p_tree->nodes_size, l_node_size);
+            } else {
+                new_nodes = (opj_tgt_node_t*) opj_realloc(p_tree->nodes, l_node_size);
+            }
             if (! new_nodes) {
                 opj_event_msg(p_manager, EVT_ERROR,
                               "Not enough memory to reinitialize the tag tree\n");
@@ -226,6 +243,11 @@ void opj_tgt_destroy(opj_tgt_tree_t *p_tree)
         return;
     }
 
+    if (p_tree->arena) {
+        /* Released with the arena */
+        return;
+    }
+
     if (p_tree->nodes) {
         opj_free(p_tree->nodes);
         p_tree->nodes = 00;
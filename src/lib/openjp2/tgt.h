@@ -70,6 +70,7 @@ typedef struct opj_tgt_tree {
     OPJ_UINT32 numnodes;
     opj_tgt_node_t *nodes;
     OPJ_UINT32  nodes_size;     /* maximum size taken by nodes */
+    opj_arena_t *arena;         /* arena the tree is allocated from, or NULL */
 } opj_tgt_tree_t;
 
 
@@ -80,10 +81,13 @@ typedef struct opj_tgt_tree {
 Create a tag-tree
 @param numleafsh Width of the array of leafs of the tree
 @param numleafsv Height of the array of leafs of the tree
+@param p_arena Arena to allocate the tree from, or NULL to allocate it with
+opj_malloc(). A tree allocated from an arena is released with it.
 @param p_manager the event manager
 @return Returns a new tag-tree if successful, returns NULL otherwise
 */
 opj_tgt_tree_t *opj_tgt_create(OPJ_UINT32 numleafsh, OPJ_UINT32 numleafsv,
+                               opj_arena_t *p_arena,
                                opj_event_mgr_t *p_manager);
 
 /**
@@ -570,18 +570,59 @@ OPJ_BOOL opj_tls_set(opj_tls_t* tls, int key, void* value,
 }
 
 
+/* Atomic integer operations used by the thread pool.
+ * When the compiler does not expose them, they are emulated with a mutex
+ * owned by the thread pool, which is correct but slower. */
+#if defined(MUTEX_win32)
+#if HAVE_INTERLOCKED_COMPARE_EXCHANGE
+#define OPJ_HAVE_ATOMICS 1
+typedef volatile LONG opj_atomic_int;
+#endif
+#elif defined(__ATOMIC_SEQ_CST) || (defined(__GNUC__) && \
+      (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 1)))
+#define OPJ_HAVE_ATOMICS 1
+typedef volatile int opj_atomic_int;
+#endif
+
+#ifndef OPJ_HAVE_ATOMICS
+#define OPJ_HAVE_ATOMICS 0
+typedef volatile int opj_atomic_int;
+#endif
+
+/** Size of a cache line, used to keep hot counters apart */
+#define OPJ_CACHE_LINE_SIZE 64
+
+/** Number of job slots of the queue of each worker thread.
+ * Must be a power of two. */
+#define OPJ_JOB_QUEUE_SIZE 256
+
+/** A job slot, part of the ring buffer of a job queue */
 typedef struct {
+    /** Sequence number, used to synchronize producers and consumers */
+    opj_atomic_int      seq;
     opj_job_fn          job_fn;
     void               *user_data;
-} opj_worker_thread_job_t;
+    /** Thread pool (or view) the job has been submitted to */
+    opj_thread_pool_t  *owner;
+} opj_job_slot_t;
+
+/** Bounded lock-free multi-producer multi-consumer job queue.
+ * Each worker thread owns one, from which it dequeues first, before
+ * stealing jobs from the queues of the other workers. Job descriptors are
+ * stored in place in the ring buffer, so no allocation is done per job. */
+typedef struct {
+    opj_atomic_int      enqueue_pos;
+    char                pad0[OPJ_CACHE_LINE_SIZE - sizeof(opj_atomic_int)];
+    opj_atomic_int      dequeue_pos;
+    char                pad1[OPJ_CACHE_LINE_SIZE - sizeof(opj_atomic_int)];
+    opj_job_slot_t      slots[OPJ_JOB_QUEUE_SIZE];
+} opj_job_queue_t;
 
 typedef struct {
     opj_thread_pool_t   *tp;
     opj_thread_t        *thread;
-    int                  marked_as_waiting;
-
-    opj_mutex_t         *mutex;
-    opj_cond_t          *cond;
+    /** Index of the job queue owned by this worker thread */
+    int                  index;
 } opj_worker_thread_t;
 
 typedef enum {
@@ -590,37 +631,223 @@ typedef enum {
     OPJWTS_ERROR
 } opj_worker_thread_state;
 
-struct opj_job_list_t {
-    opj_worker_thread_job_t* job;
-    struct opj_job_list_t* next;
-};
-typedef struct opj_job_list_t opj_job_list_t;
-
-struct opj_worker_thread_list_t {
-    opj_worker_thread_t* worker_thread;
-    struct opj_worker_thread_list_t* next;
-};
-typedef struct opj_worker_thread_list_t opj_worker_thread_list_t;
-
 struct opj_thread_pool_t {
+    /** Thread pool whose worker threads run the jobs, if this is a view */
+    opj_thread_pool_t*               parent;
+    /** Number of references to the thread pool. Each view holds one on */
+    /** its parent. */
+    opj_atomic_int                   ref_count;
     opj_worker_thread_t*             worker_threads;
     int                              worker_threads_count;
+    /** One job queue per worker thread */
+    opj_job_queue_t*                 job_queues;
+    int                              job_queues_count;
+    /** Counter used to distribute submitted jobs among queues */
+    opj_atomic_int                   next_queue;
+    /** Signaled when jobs complete, or when a worker thread is started */
     opj_cond_t*                      cond;
+    /** Signaled to wake up an idle worker thread */
+    opj_cond_t*                      worker_cond;
     opj_mutex_t*                     mutex;
+    /** Used to emulate atomic operations when !OPJ_HAVE_ATOMICS */
+    opj_mutex_t*                     atomic_mutex;
     volatile opj_worker_thread_state state;
-    opj_job_list_t*                  job_queue;
-    volatile int                     pending_jobs_count;
-    opj_worker_thread_list_t*        waiting_worker_thread_list;
-    int                              waiting_worker_thread_count;
+    /** Number of jobs submitted and not completed yet */
+    opj_atomic_int                   pending_jobs_count;
+    /** Number of worker threads waiting on worker_cond */
+    opj_atomic_int                   idle_worker_thread_count;
+    /** Number of threads waiting on cond for jobs to complete */
+    opj_atomic_int                   completion_waiter_count;
+    /** Value of pending_jobs_count under which waiters must be signaled. */
+    /** This is the highest threshold of the current waiters, so that none */
+    /** of them misses its wake-up. */
+    opj_atomic_int                   signaling_threshold;
+    int                              started_worker_thread_count;
     opj_tls_t*                       tls;
-    int                              signaling_threshold;
+    /** CPU time spent by the worker threads in the jobs submitted to this */
+    /** thread pool (or view). Protected by mutex */
+    OPJ_FLOAT64                      jobs_cpu_time;
 };
 
 static OPJ_BOOL opj_thread_pool_setup(opj_thread_pool_t* tp, int num_threads);
-static opj_worker_thread_job_t* opj_thread_pool_get_next_job(
-    opj_thread_pool_t* tp,
-    opj_worker_thread_t* worker_thread,
-    OPJ_BOOL signal_job_finished);
+static OPJ_BOOL opj_thread_pool_get_next_job(opj_thread_pool_t* tp,
+        opj_worker_thread_t* worker_thread,
+        opj_job_fn* p_job_fn,
+        void** p_user_data,
+        opj_thread_pool_t** p_owner);
+static void opj_thread_pool_wait_pending_jobs(opj_thread_pool_t* tp,
+        int max_remaining_jobs);
+
+static int opj_atomic_load(opj_thread_pool_t* tp, opj_atomic_int* p)
+{
+#if !OPJ_HAVE_ATOMICS
+    int v;
+    opj_mutex_lock(tp->atomic_mutex);
+    v = *p;
+    opj_mutex_unlock(tp->atomic_mutex);
+    return v;
+#elif defined(MUTEX_win32)
+    (void)tp;
+    return (int)InterlockedCompareExchange(p, 0, 0);
+#elif defined(__ATOMIC_SEQ_CST)
+    (void)tp;
+    return __atomic_load_n(p, __ATOMIC_SEQ_CST);
+#else
+    int v;
+    (void)tp;
+    __sync_synchronize();
+    v = *p;
+    __sync_synchronize();
+    return v;
+#endif
+}
+
+static void opj_atomic_store(opj_thread_pool_t* tp, opj_atomic_int* p, int v)
+{
+#if !OPJ_HAVE_ATOMICS
+    opj_mutex_lock(tp->atomic_mutex);
+    *p = v;
+    opj_mutex_unlock(tp->atomic_mutex);
+#elif defined(MUTEX_win32)
+    (void)tp;
+    InterlockedExchange(p, (LONG)v);
+#elif defined(__ATOMIC_SEQ_CST)
+    (void)tp;
+    __atomic_store_n(p, v, __ATOMIC_SEQ_CST);
+#else
+    (void)tp;
+    __sync_synchronize();
+    *p = v;
+    __sync_synchronize();
+#endif
+}
+
+/** Adds v to *p and returns the new value */
+static int opj_atomic_add(opj_thread_pool_t* tp, opj_atomic_int* p, int v)
+{
+#if !OPJ_HAVE_ATOMICS
+    int ret;
+    opj_mutex_lock(tp->atomic_mutex);
+    ret = (int)((unsigned int) * p + (unsigned int)v);
+    *p = ret;
+    opj_mutex_unlock(tp->atomic_mutex);
+    return ret;
+#elif defined(MUTEX_win32)
+    (void)tp;
+    return (int)((unsigned int)InterlockedExchangeAdd(p, (LONG)v) +
+                 (unsigned int)v);
+#elif defined(__ATOMIC_SEQ_CST)
+    (void)tp;
+    return __atomic_add_fetch(p, v, __ATOMIC_SEQ_CST);
+#else
+    (void)tp;
+    return __sync_add_and_fetch(p, v);
+#endif
+}
+
+/** Sets *p to new_val if it is equal to old_val. Returns OPJ_TRUE in that case */
+static OPJ_BOOL opj_atomic_compare_exchange(opj_thread_pool_t* tp,
+        opj_atomic_int* p,
+        int old_val,
+        int new_val)
+{
+#if !OPJ_HAVE_ATOMICS
+    OPJ_BOOL ret = OPJ_FALSE;
+    opj_mutex_lock(tp->atomic_mutex);
+    if (*p == old_val) {
+        *p = new_val;
+        ret = OPJ_TRUE;
+    }
+    opj_mutex_unlock(tp->atomic_mutex);
+    return ret;
+#elif defined(MUTEX_win32)
+    (void)tp;
+    return InterlockedCompareExchange(p, (LONG)new_val,
+                                      (LONG)old_val) == (LONG)old_val;
+#elif defined(__ATOMIC_SEQ_CST)
+    (void)tp;
+    return __atomic_compare_exchange_n(p, &old_val, new_val, 0,
+                                       __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST) != 0;
+#else
+    (void)tp;
+    return __sync_bool_compare_and_swap(p, old_val, new_val);
+#endif
+}
+
+static void opj_job_queue_init(opj_job_queue_t* queue)
+{
+    int i;
+    queue->enqueue_pos = 0;
+    queue->dequeue_pos = 0;
+    for (i = 0; i < OPJ_JOB_QUEUE_SIZE; i++) {
+        queue->slots[i].seq = i;
+    }
+}
+
+/** Pushes a job to the queue. Returns OPJ_FALSE if the queue is full. */
+static OPJ_BOOL opj_job_queue_push(opj_thread_pool_t* tp,
+                                   opj_job_queue_t* queue,
+                                   opj_job_fn job_fn,
+                                   void* user_data,
+                                   opj_thread_pool_t* owner)
+{
+    opj_job_slot_t* slot;
+    unsigned int pos = (unsigned int)opj_atomic_load(tp, &queue->enqueue_pos);
+
+    while (OPJ_TRUE) {
+        int dif;
+        slot = &queue->slots[pos & (OPJ_JOB_QUEUE_SIZE - 1)];
+        dif = (int)((unsigned int)opj_atomic_load(tp, &slot->seq) - pos);
+        if (dif == 0) {
+            if (opj_atomic_compare_exchange(tp, &queue->enqueue_pos, (int)pos,
+                                            (int)(pos + 1U))) {
+                break;
+            }
+        } else if (dif < 0) {
+            /* The slot still holds a job that has not been dequeued yet */
+            return OPJ_FALSE;
+        }
+        pos = (unsigned int)opj_atomic_load(tp, &queue->enqueue_pos);
+    }
+
+    slot->job_fn = job_fn;
+    slot->user_data = user_data;
+    slot->owner = owner;
+    opj_atomic_store(tp, &slot->seq, (int)(pos + 1U));
+    return OPJ_TRUE;
+}
+
+/** Pops a job from the queue. Returns OPJ_FALSE if the queue is empty. */
+static OPJ_BOOL opj_job_queue_pop(opj_thread_pool_t* tp,
+                                  opj_job_queue_t* queue,
+                                  opj_job_fn* p_job_fn,
+                                  void** p_user_data,
+                                  opj_thread_pool_t** p_owner)
+{
+    opj_job_slot_t* slot;
+    unsigned int pos = (unsigned int)opj_atomic_load(tp, &queue->dequeue_pos);
+
+    while (OPJ_TRUE) {
+        int dif;
+        slot = &queue->slots[pos & (OPJ_JOB_QUEUE_SIZE - 1)];
+        dif = (int)((unsigned int)opj_atomic_load(tp, &slot->seq) - (pos + 1U));
+        if (dif == 0) {
+            if (opj_atomic_compare_exchange(tp, &queue->dequeue_pos, (int)pos,
+                                            (int)(pos + 1U))) {
+                break;
+            }
+        } else if (dif < 0) {
+            return OPJ_FALSE;
+        }
+        pos = (unsigned int)opj_atomic_load(tp, &queue->dequeue_pos);
+    }
+
+    *p_job_fn = slot->job_fn;
+    *p_user_data = slot->user_data;
+    *p_owner = slot->owner;
+    opj_atomic_store(tp, &slot->seq, (int)(pos + OPJ_JOB_QUEUE_SIZE));
+    return OPJ_TRUE;
+}
 
 opj_thread_pool_t* opj_thread_pool_create(int num_threads)
 {
@@ -631,6 +858,7 @@ opj_thread_pool_t* opj_thread_pool_create(int num_threads)
         return NULL;
     }
     tp->state = OPJWTS_OK;
+    tp->ref_count = 1;
 
     if (num_threads <= 0) {
         tp->tls = opj_tls_new();
@@ -653,29 +881,146 @@ opj_thread_pool_t* opj_thread_pool_create(int num_threads)
     return tp;
 }
 
+opj_thread_pool_t* opj_thread_pool_create_view(opj_thread_pool_t* parent)
+{
+    opj_thread_pool_t* tp;
+
+    if (parent->mutex == NULL) {
+        return NULL;
+    }
+    if (parent->parent != NULL) {
+        parent = parent->parent;
+    }
+
+    tp = (opj_thread_pool_t*) opj_calloc(1, sizeof(opj_thread_pool_t));
+    if (!tp) {
+        return NULL;
+    }
+    tp->state = OPJWTS_OK;
+    tp->ref_count = 1;
+    tp->worker_threads_count = parent->worker_threads_count;
+
+    tp->mutex = opj_mutex_create();
+    tp->cond = opj_cond_create();
+#if !OPJ_HAVE_ATOMICS
+    tp->atomic_mutex = opj_mutex_create();
+    if (tp->atomic_mutex == NULL) {
+        opj_mutex_destroy(tp->mutex);
+        tp->mutex = NULL;
+    }
+#endif
+    if (tp->mutex == NULL || tp->cond == NULL) {
+        opj_cond_destroy(tp->cond);
+        opj_mutex_destroy(tp->mutex);
+        opj_free(tp);
+        return NULL;
+    }
+
+    opj_atomic_add(parent, &parent->ref_count, 1);
+    tp->parent = parent;
+    return tp;
+}
+
+/** Wakes up the threads waiting for jobs of tp to complete. */
+/** Must be called with tp->mutex held. */
+static void opj_thread_pool_signal_waiters(opj_thread_pool_t* tp)
+{
+    int i;
+    int waiter_count = opj_atomic_load(tp, &tp->completion_waiter_count);
+    for (i = 0; i < waiter_count; i++) {
+        opj_cond_signal(tp->cond);
+    }
+}
+
+/** Called by a worker thread once it has run a job submitted to tp */
+static void opj_thread_pool_job_finished(opj_thread_pool_t* tp)
+{
+    int remaining_jobs;
+
+    if (tp->parent) {
+        /* The view might be destroyed as soon as its pending job count */
+        /* reaches zero, so account the job on the parent first, and */
+        /* update the view with its mutex held: opj_thread_pool_destroy() */
+        /* takes it before freeing the view */
+        opj_thread_pool_job_finished(tp->parent);
+        opj_mutex_lock(tp->mutex);
+        remaining_jobs = opj_atomic_add(tp, &tp->pending_jobs_count, -1);
+        if (opj_atomic_load(tp, &tp->completion_waiter_count) > 0 &&
+                remaining_jobs <= opj_atomic_load(tp, &tp->signaling_threshold)) {
+            opj_thread_pool_signal_waiters(tp);
+        }
+        opj_mutex_unlock(tp->mutex);
+        return;
+    }
+
+    remaining_jobs = opj_atomic_add(tp, &tp->pending_jobs_count, -1);
+    /*printf("tp=%p, remaining jobs: %d\n", tp, remaining_jobs);*/
+    if (opj_atomic_load(tp, &tp->completion_waiter_count) > 0 &&
+            remaining_jobs <= opj_atomic_load(tp, &tp->signaling_threshold)) {
+        opj_mutex_lock(tp->mutex);
+        opj_thread_pool_signal_waiters(tp);
+        opj_mutex_unlock(tp->mutex);
+    }
+}
+
 static void opj_worker_thread_function(void* user_data)
 {
     opj_worker_thread_t* worker_thread;
     opj_thread_pool_t* tp;
     opj_tls_t* tls;
-    OPJ_BOOL job_finished = OPJ_FALSE;
 
     worker_thread = (opj_worker_thread_t*) user_data;
     tp = worker_thread->tp;
     tls = opj_tls_new();
 
-    while (OPJ_TRUE) {
-        opj_worker_thread_job_t* job = opj_thread_pool_get_next_job(tp, worker_thread,
-                                       job_finished);
-        if (job == NULL) {
-            break;
-        }
+    /* printf("signaling that worker thread is ready\n"); */
+    opj_mutex_lock(tp->mutex);
+    if (tls == NULL) {
+        tp->state = OPJWTS_ERROR;
+    }
+    tp->started_worker_thread_count ++;
+    opj_cond_signal(tp->cond);
+    opj_mutex_unlock(tp->mutex);
 
-        if (job->job_fn) {
-            job->job_fn(job->user_data, tls);
+    while (tls != NULL) {
+        opj_job_fn job_fn;
+        void* job_user_data;
+        opj_thread_pool_t* job_owner;
+        OPJ_FLOAT64 job_start;
+
+        if (!opj_thread_pool_get_next_job(tp, worker_thread, &job_fn,
+                                          &job_user_data, &job_owner)) {
+            OPJ_BOOL got_job = OPJ_FALSE;
+
+            /* No job in any queue: go idle. The queues must be checked */
+            /* again once registered as idle, since a job might have been */
+            /* submitted in the meantime by a thread that saw no idle worker */
+            opj_mutex_lock(tp->mutex);
+            opj_atomic_add(tp, &tp->idle_worker_thread_count, 1);
+            while (tp->state == OPJWTS_OK) {
+                got_job = opj_thread_pool_get_next_job(tp, worker_thread, &job_fn,
+                                                       &job_user_data, &job_owner);
+                if (got_job) {
+                    break;
+                }
+                /* printf("waiting for job\n"); */
+                opj_cond_wait(tp->worker_cond, tp->mutex);
+            }
+            opj_atomic_add(tp, &tp->idle_worker_thread_count, -1);
+            opj_mutex_unlock(tp->mutex);
+
+            if (!got_job) {
+                break;
+            }
         }
-        opj_free(job);
-        job_finished = OPJ_TRUE;
+
+        job_start = opj_thread_clock();
+        job_fn(job_user_data, tls);
+        /* Before the job is finished, after which a view may be destroyed */
+        opj_mutex_lock(job_owner->mutex);
+        job_owner->jobs_cpu_time += opj_thread_clock() - job_start;
+        opj_mutex_unlock(job_owner->mutex);
+        opj_thread_pool_job_finished(job_owner);
     }
 
     opj_tls_destroy(tls);
@@ -693,6 +1038,28 @@ static OPJ_BOOL opj_thread_pool_setup(opj_thread_pool_t* tp, int num_threads)
         return OPJ_FALSE;
     }
 
+    tp->worker_cond = opj_cond_create();
+    if (tp->worker_cond == NULL) {
+        return OPJ_FALSE;
+    }
+
+#if !OPJ_HAVE_ATOMICS
+    tp->atomic_mutex = opj_mutex_create();
+    if (tp->atomic_mutex == NULL) {
+        return OPJ_FALSE;
+    }
+#endif
+
+    tp->job_queues = (opj_job_queue_t*) opj_malloc((size_t)num_threads *
+                     sizeof(opj_job_queue_t));
+    if (tp->job_queues == NULL) {
+        return OPJ_FALSE;
+    }
+    for (i = 0; i < num_threads; i++) {
+        opj_job_queue_init(&(tp->job_queues[i]));
+    }
+    tp->job_queues_count = num_threads;
+
     tp->worker_threads = (opj_worker_thread_t*) opj_calloc((size_t)num_threads,
                          sizeof(opj_worker_thread_t));
     if (tp->worker_threads == NULL) {
@@ -702,29 +1069,11 @@ static OPJ_BOOL opj_thread_pool_setup(opj_thread_pool_t* tp, int num_threads)
 
     for (i = 0; i < num_threads; i++) {
         tp->worker_threads[i].tp = tp;
-
-        tp->worker_threads[i].mutex = opj_mutex_create();
-        if (tp->worker_threads[i].mutex == NULL) {
-            tp->worker_threads_count = i;
-            bRet = OPJ_FALSE;
-            break;
-        }
-
-        tp->worker_threads[i].cond = opj_cond_create();
-        if (tp->worker_threads[i].cond == NULL) {
-            opj_mutex_destroy(tp->worker_threads[i].mutex);
-            tp->worker_threads_count = i;
-            bRet = OPJ_FALSE;
-            break;
-        }
-
-        tp->worker_threads[i].marked_as_waiting = OPJ_FALSE;
+        tp->worker_threads[i].index = i;
 
         tp->worker_threads[i].thread = opj_thread_create(opj_worker_thread_function,
                                        &(tp->worker_threads[i]));
         if (tp->worker_threads[i].thread == NULL) {
-            opj_mutex_destroy(tp->worker_threads[i].mutex);
-            opj_cond_destroy(tp->worker_threads[i].cond);
             tp->worker_threads_count = i;
             bRet = OPJ_FALSE;
             break;
@@ -734,7 +1083,7 @@ static OPJ_BOOL opj_thread_pool_setup(opj_thread_pool_t* tp, int num_threads)
     /* Wait all threads to be started */
     /* printf("waiting for all threads to be started\n"); */
     opj_mutex_lock(tp->mutex);
-    while (tp->waiting_worker_thread_count < tp->worker_threads_count) {
+    while (tp->started_worker_thread_count < tp->worker_threads_count) {
         opj_cond_wait(tp->cond, tp->mutex);
     }
     opj_mutex_unlock(tp->mutex);
@@ -747,148 +1096,114 @@ static OPJ_BOOL opj_thread_pool_setup(opj_thread_pool_t* tp, int num_threads)
     return bRet;
 }
 
-/*
-void opj_waiting()
-{
-    printf("waiting!\n");
-}
-*/
-
-static opj_worker_thread_job_t* opj_thread_pool_get_next_job(
-    opj_thread_pool_t* tp,
-    opj_worker_thread_t* worker_thread,
-    OPJ_BOOL signal_job_finished)
+/** Fetches a job, first from the queue owned by the worker thread, and then */
+/** by stealing from the queues of the other worker threads. */
+static OPJ_BOOL opj_thread_pool_get_next_job(opj_thread_pool_t* tp,
+        opj_worker_thread_t* worker_thread,
+        opj_job_fn* p_job_fn,
+        void** p_user_data,
+        opj_thread_pool_t** p_owner)
 {
-    while (OPJ_TRUE) {
-        opj_job_list_t* top_job_iter;
-
-        opj_mutex_lock(tp->mutex);
-
-        if (signal_job_finished) {
-            signal_job_finished = OPJ_FALSE;
-            tp->pending_jobs_count --;
-            /*printf("tp=%p, remaining jobs: %d\n", tp, tp->pending_jobs_count);*/
-            if (tp->pending_jobs_count <= tp->signaling_threshold) {
-                opj_cond_signal(tp->cond);
-            }
-        }
-
-        if (tp->state == OPJWTS_STOP) {
-            opj_mutex_unlock(tp->mutex);
-            return NULL;
-        }
-        top_job_iter = tp->job_queue;
-        if (top_job_iter) {
-            opj_worker_thread_job_t* job;
-            tp->job_queue = top_job_iter->next;
+    int i;
+    int index = worker_thread->index;
 
-            job = top_job_iter->job;
-            opj_mutex_unlock(tp->mutex);
-            opj_free(top_job_iter);
-            return job;
+    for (i = 0; i < tp->job_queues_count; i++) {
+        if (opj_job_queue_pop(tp, &(tp->job_queues[index]), p_job_fn,
+                              p_user_data, p_owner)) {
+            return OPJ_TRUE;
         }
-
-        /* opj_waiting(); */
-        if (!worker_thread->marked_as_waiting) {
-            opj_worker_thread_list_t* item;
-
-            worker_thread->marked_as_waiting = OPJ_TRUE;
-            tp->waiting_worker_thread_count ++;
-            assert(tp->waiting_worker_thread_count <= tp->worker_threads_count);
-
-            item = (opj_worker_thread_list_t*) opj_malloc(sizeof(opj_worker_thread_list_t));
-            if (item == NULL) {
-                tp->state = OPJWTS_ERROR;
-                opj_cond_signal(tp->cond);
-
-                opj_mutex_unlock(tp->mutex);
-                return NULL;
-            }
-
-            item->worker_thread = worker_thread;
-            item->next = tp->waiting_worker_thread_list;
-            tp->waiting_worker_thread_list = item;
+        index ++;
+        if (index == tp->job_queues_count) {
+            index = 0;
         }
-
-        /* printf("signaling that worker thread is ready\n"); */
-        opj_cond_signal(tp->cond);
-
-        opj_mutex_lock(worker_thread->mutex);
-        opj_mutex_unlock(tp->mutex);
-
-        /* printf("waiting for job\n"); */
-        opj_cond_wait(worker_thread->cond, worker_thread->mutex);
-
-        opj_mutex_unlock(worker_thread->mutex);
-        /* printf("got job\n"); */
     }
+    return OPJ_FALSE;
 }
 
 OPJ_BOOL opj_thread_pool_submit_job(opj_thread_pool_t* tp,
                                     opj_job_fn job_fn,
                                     void* user_data)
 {
-    opj_worker_thread_job_t* job;
-    opj_job_list_t* item;
+    /* Thread pool owning the worker threads and the job queues */
+    opj_thread_pool_t* wtp;
+    int max_pending_jobs;
+    int first_queue;
 
     if (tp->mutex == NULL) {
         job_fn(user_data, tp->tls);
         return OPJ_TRUE;
     }
 
-    job = (opj_worker_thread_job_t*)opj_malloc(sizeof(opj_worker_thread_job_t));
-    if (job == NULL) {
-        return OPJ_FALSE;
-    }
-    job->job_fn = job_fn;
-    job->user_data = user_data;
-
-    item = (opj_job_list_t*) opj_malloc(sizeof(opj_job_list_t));
-    if (item == NULL) {
-        opj_free(job);
-        return OPJ_FALSE;
-    }
-    item->job = job;
+    wtp = tp->parent ? tp->parent : tp;
 
-    opj_mutex_lock(tp->mutex);
+    /* Do not let the queues grow too much. For a view, this also prevents */
+    /* a single codec from queuing too many jobs ahead of other codecs */
+    /* sharing the same worker threads */
+    max_pending_jobs = 100 * wtp->worker_threads_count;
+    opj_thread_pool_wait_pending_jobs(tp, max_pending_jobs);
 
-    tp->signaling_threshold = 100 * tp->worker_threads_count;
-    while (tp->pending_jobs_count > tp->signaling_threshold) {
-        /* printf("%d jobs enqueued. Waiting\n", tp->pending_jobs_count); */
-        opj_cond_wait(tp->cond, tp->mutex);
-        /* printf("...%d jobs enqueued.\n", tp->pending_jobs_count); */
+    opj_atomic_add(tp, &tp->pending_jobs_count, 1);
+    if (wtp != tp) {
+        opj_atomic_add(wtp, &wtp->pending_jobs_count, 1);
     }
 
-    item->next = tp->job_queue;
-    tp->job_queue = item;
-    tp->pending_jobs_count ++;
-
-    if (tp->waiting_worker_thread_list) {
-        opj_worker_thread_t* worker_thread;
-        opj_worker_thread_list_t* next;
-        opj_worker_thread_list_t* to_opj_free;
-
-        worker_thread = tp->waiting_worker_thread_list->worker_thread;
-
-        assert(worker_thread->marked_as_waiting);
-        worker_thread->marked_as_waiting = OPJ_FALSE;
+    /* Distribute jobs among worker queues in a round-robin way. If the */
+    /* selected queue is full, try the next ones. */
+    first_queue = (int)((unsigned int)opj_atomic_add(wtp, &wtp->next_queue, 1) %
+                        (unsigned int)wtp->job_queues_count);
+    while (OPJ_TRUE) {
+        int i;
+        int index = first_queue;
+        for (i = 0; i < wtp->job_queues_count; i++) {
+            if (opj_job_queue_push(wtp, &(wtp->job_queues[index]), job_fn, user_data,
+                                   tp)) {
+                break;
+            }
+            index ++;
+            if (index == wtp->job_queues_count) {
+                index = 0;
+            }
+        }
+        if (i < wtp->job_queues_count) {
+            break;
+        }
+        /* All queues are full, which can only happen if several threads */
+        /* submit jobs concurrently. Wait for some of them to complete. */
+        opj_thread_pool_wait_pending_jobs(wtp, max_pending_jobs);
+    }
 
-        next = tp->waiting_worker_thread_list->next;
-        to_opj_free = tp->waiting_worker_thread_list;
-        tp->waiting_worker_thread_list = next;
-        tp->waiting_worker_thread_count --;
+    /* Wake up an idle worker thread if there is one */
+    if (opj_atomic_load(wtp, &wtp->idle_worker_thread_count) > 0) {
+        opj_mutex_lock(wtp->mutex);
+        opj_cond_signal(wtp->worker_cond);
+        opj_mutex_unlock(wtp->mutex);
+    }
 
-        opj_mutex_lock(worker_thread->mutex);
-        opj_mutex_unlock(tp->mutex);
-        opj_cond_signal(worker_thread->cond);
-        opj_mutex_unlock(worker_thread->mutex);
+    return OPJ_TRUE;
+}
 
-        opj_free(to_opj_free);
-    } else {
-        opj_mutex_unlock(tp->mutex);
+/** Waits until pending_jobs_count <= max_remaining_jobs */
+static void opj_thread_pool_wait_pending_jobs(opj_thread_pool_t* tp,
+        int max_remaining_jobs)
+{
+    if (opj_atomic_load(tp, &tp->pending_jobs_count) <= max_remaining_jobs) {
+        return;
     }
 
-    return OPJ_TRUE;
+    opj_mutex_lock(tp->mutex);
+    /* Several threads may wait with different thresholds: signal as soon */
+    /* as the highest one is reached, and let the others wait again */
+    if (opj_atomic_add(tp, &tp->completion_waiter_count, 1) == 1 ||
+            max_remaining_jobs > opj_atomic_load(tp, &tp->signaling_threshold)) {
+        opj_atomic_store(tp, &tp->signaling_threshold, max_remaining_jobs);
+    }
+    while (opj_atomic_load(tp, &tp->pending_jobs_count) > max_remaining_jobs) {
+        /*printf("tp=%p, jobs before wait = %d, max_remaining_jobs = %d\n", tp, tp->pending_jobs_count, max_remaining_jobs);*/
+        opj_cond_wait(tp->cond, tp->mutex);
+        /*printf("tp=%p, jobs after wait = %d\n", tp, tp->pending_jobs_count);*/
+    }
+    opj_atomic_add(tp, &tp->completion_waiter_count, -1);
+    opj_mutex_unlock(tp->mutex);
 }
 
 void opj_thread_pool_wait_completion(opj_thread_pool_t* tp,
@@ -901,14 +1216,7 @@ void opj_thread_pool_wait_completion(opj_thread_pool_t* tp,
     if (max_remaining_jobs < 0) {
         max_remaining_jobs = 0;
     }
-    opj_mutex_lock(tp->mutex);
-    tp->signaling_threshold = max_remaining_jobs;
-    while (tp->pending_jobs_count > max_remaining_jobs) {
-        /*printf("tp=%p, jobs before wait = %d, max_remaining_jobs = %d\n", tp, tp->pending_jobs_count, max_remaining_jobs);*/
-        opj_cond_wait(tp->cond, tp->mutex);
-        /*printf("tp=%p, jobs after wait = %d\n", tp, tp->pending_jobs_count);*/
-    }
-    opj_mutex_unlock(tp->mutex);
+    opj_thread_pool_wait_pending_jobs(tp, max_remaining_jobs);
 }
 
 int opj_thread_pool_get_thread_count(opj_thread_pool_t* tp)
@@ -916,39 +1224,129 @@ int opj_thread_pool_get_thread_count(opj_thread_pool_t* tp)
     return tp->worker_threads_count;
 }
 
+OPJ_FLOAT64 opj_thread_pool_get_jobs_cpu_time(opj_thread_pool_t* tp)
+{
+    OPJ_FLOAT64 cpu_time;
+
+    if (tp->mutex == NULL) {
+        return 0;
+    }
+    opj_mutex_lock(tp->mutex);
+    cpu_time = tp->jobs_cpu_time;
+    opj_mutex_unlock(tp->mutex);
+    return cpu_time;
+}
+
 void opj_thread_pool_destroy(opj_thread_pool_t* tp)
 {
     if (!tp) {
         return;
     }
+    if (tp->mutex != NULL &&
+            opj_atomic_add(tp, &tp->ref_count, -1) > 0) {
+        /* Still referenced by a view */
+        return;
+    }
+    if (tp->parent) {
+        opj_thread_pool_t* parent = tp->parent;
+        opj_thread_pool_wait_completion(tp, 0);
+        /* The worker thread that completed the last job might still hold */
+        /* the mutex of the view, after having signaled tp->cond */
+        opj_mutex_lock(tp->mutex);
+        opj_mutex_unlock(tp->mutex);
+        opj_cond_destroy(tp->cond);
+        opj_mutex_destroy(tp->atomic_mutex);
+        opj_mutex_destroy(tp->mutex);
+        opj_free(tp);
+        opj_thread_pool_destroy(parent);
+        return;
+    }
     if (tp->cond) {
         int i;
         opj_thread_pool_wait_completion(tp, 0);
 
         opj_mutex_lock(tp->mutex);
         tp->state = OPJWTS_STOP;
+        for (i = 0; i < tp->worker_threads_count; i++) {
+            opj_cond_signal(tp->worker_cond);
+        }
         opj_mutex_unlock(tp->mutex);
 
         for (i = 0; i < tp->worker_threads_count; i++) {
-            opj_mutex_lock(tp->worker_threads[i].mutex);
-            opj_cond_signal(tp->worker_threads[i].cond);
-            opj_mutex_unlock(tp->worker_threads[i].mutex);
             opj_thread_join(tp->worker_threads[i].thread);
-            opj_cond_destroy(tp->worker_threads[i].cond);
-            opj_mutex_destroy(tp->worker_threads[i].mutex);
         }
 
         opj_free(tp->worker_threads);
+        opj_free(tp->job_queues);
 
-        while (tp->waiting_worker_thread_list != NULL) {
-            opj_worker_thread_list_t* next = tp->waiting_worker_thread_list->next;
-            opj_free(tp->waiting_worker_thread_list);
-            tp->waiting_worker_thread_list = next;
-        }
-
+        opj_cond_destroy(tp->worker_cond);
         opj_cond_destroy(tp->cond);
     }
+    opj_mutex_destroy(tp->atomic_mutex);
     opj_mutex_destroy(tp->mutex);
     opj_tls_destroy(tp->tls);
     opj_free(tp);
 }
+
+static void opj_locked_error_callback(const char *msg, void *client_data)
+{
+    opj_locked_event_mgr_t* l_mgr = (opj_locked_event_mgr_t*)client_data;
+    opj_mutex_lock(l_mgr->m_mutex);
+    l_mgr->m_user_event_mgr->error_handler(msg,
+                                           l_mgr->m_user_event_mgr->m_error_data);
+    opj_mutex_unlock(l_mgr->m_mutex);
+}
+
+static void opj_locked_warning_callback(const char *msg, void *client_data)
+{
+    opj_locked_event_mgr_t* l_mgr = (opj_locked_event_mgr_t*)client_data;
+    opj_mutex_lock(l_mgr->m_mutex);
+    l_mgr->m_user_event_mgr->warning_handler(msg,
+            l_mgr->m_user_event_mgr->m_warning_data);
+    opj_mutex_unlock(l_mgr->m_mutex);
+}
+
+static void opj_locked_info_callback(const char *msg, void *client_data)
+{
+    opj_locked_event_mgr_t* l_mgr = (opj_locked_event_mgr_t*)client_data;
+    opj_mutex_lock(l_mgr->m_mutex);
+    l_mgr->m_user_event_mgr->info_handler(msg,
+                                          l_mgr->m_user_event_mgr->m_info_data);
+    opj_mutex_unlock(l_mgr->m_mutex);
+}
+
+void opj_locked_event_mgr_init(opj_locked_event_mgr_t* p_mgr,
+                               opj_event_mgr_t* p_user_event_mgr,
+                               opj_mutex_t* p_mutex)
+{
+    memset(p_mgr, 0, sizeof(opj_locked_event_mgr_t));
+    p_mgr->m_user_event_mgr = p_user_event_mgr;
+    p_mgr->m_mutex = p_mutex;
+    /* Keep the callbacks unset when the user did not set them, so that */
+    /* opj_event_msg() does not format messages nobody will read */
+    if (p_user_event_mgr->error_handler) {
+        p_mgr->m_event_mgr.error_handler = opj_locked_error_callback;
+        p_mgr->m_event_mgr.m_error_data = p_mgr;
+    }
+    if (p_user_event_mgr->warning_handler) {
+        p_mgr->m_event_mgr.warning_handler = opj_locked_warning_callback;
+        p_mgr->m_event_mgr.m_warning_data = p_mgr;
+    }
+    if (p_user_event_mgr->info_handler) {
+        p_mgr->m_event_mgr.info_handler = opj_locked_info_callback;
+        p_mgr->m_event_mgr.m_info_data = p_mgr;
+    }
+}
+
+opj_thread_pool_t* OPJ_CALLCONV opj_create_thread_pool(int num_threads)
+{
+    if (num_threads <= 0 || !opj_has_thread_support()) {
+        return NULL;
+    }
+    return opj_thread_pool_create(num_threads);
+}
+
+void OPJ_CALLCONV opj_destroy_thread_pool(opj_thread_pool_t* p_thread_pool)
+{
+    opj_thread_pool_destroy(p_thread_pool);
+}
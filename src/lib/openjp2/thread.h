@@ -74,6 +74,29 @@ void opj_mutex_destroy(opj_mutex_t* mutex);
 
 /*@}*/
 
+/** @name Event manager shared by threads */
+/*@{*/
+
+/** Event manager forwarding messages emitted from worker threads to the
+ * user event manager, one message at a time. */
+typedef struct opj_locked_event_mgr {
+    opj_event_mgr_t  m_event_mgr;
+    opj_event_mgr_t *m_user_event_mgr;
+    opj_mutex_t     *m_mutex;
+} opj_locked_event_mgr_t;
+
+/** Initializes an event manager that forwards the messages to another one
+ * while holding a mutex. The messages are to be emitted to m_event_mgr.
+ * @param p_mgr the event manager to initialize.
+ * @param p_user_event_mgr the event manager the messages are forwarded to.
+ * @param p_mutex the mutex held while forwarding a message.
+ */
+void opj_locked_event_mgr_init(opj_locked_event_mgr_t* p_mgr,
+                               opj_event_mgr_t* p_user_event_mgr,
+                               opj_mutex_t* p_mutex);
+
+/*@}*/
+
 /** @name Condition */
 /*@{*/
 
@@ -191,8 +214,7 @@ OPJ_BOOL opj_tls_set(opj_tls_t* tls, int key, void* value,
 /** @name Thread pool */
 /*@{*/
 
-/** Opaque type for a thread pool */
-typedef struct opj_thread_pool_t opj_thread_pool_t;
+/* Opaque type for a thread pool, opj_thread_pool_t, is declared in openjpeg.h */
 
 /** Create a new thread pool.
  * num_thread must nominally be >= 1 to create a real thread pool. If num_threads
@@ -206,6 +228,22 @@ typedef struct opj_thread_pool_t opj_thread_pool_t;
  */
 opj_thread_pool_t* opj_thread_pool_create(int num_threads);
 
+/** Create a view of a thread pool.
+ * A view has no worker threads of its own: jobs submitted to it are run by
+ * the worker threads of the parent thread pool, but
+ * opj_thread_pool_wait_completion() on the view only waits for the jobs
+ * submitted to it. This enables several codecs to share the same worker
+ * threads. The view holds a reference on the parent thread pool, which is
+ * only destroyed once all its views have been destroyed.
+ *
+ * @param tp the parent thread pool handle. Must not be a dummy thread pool.
+ * If it is a view, the new view is a view of its parent thread pool: jobs
+ * submitted to the new view are not waited for by
+ * opj_thread_pool_wait_completion() on tp.
+ * @return a thread pool handle, or NULL in case of failure.
+ */
+opj_thread_pool_t* opj_thread_pool_create_view(opj_thread_pool_t* tp);
+
 /** User function to execute in a thread
  * @param user_data user data provided with opj_thread_create()
  * @param tls handle to thread local storage
@@ -244,7 +282,19 @@ void opj_thread_pool_wait_completion(opj_thread_pool_t* tp,
  */
 int opj_thread_pool_get_thread_count(opj_thread_pool_t* tp);
 
+/** Return the CPU time spent by the worker threads in the jobs submitted to
+ * the thread pool, or to the view, since its creation. The jobs of a view
+ * are not accounted for by its parent, and jobs run by the calling thread,
+ * when the thread pool has no worker thread, are not accounted for at all.
+ *
+ * @param tp the thread pool handle.
+ * @return CPU time in seconds, 0 if the platform has no CPU clock per thread.
+ */
+OPJ_FLOAT64 opj_thread_pool_get_jobs_cpu_time(opj_thread_pool_t* tp);
+
 /** Destroy a thread pool.
+ * If the thread pool is still referenced by views, it is only destroyed
+ * when the last one is destroyed.
  * @param tp the thread pool handle.
  */
 void opj_thread_pool_destroy(opj_thread_pool_t* tp);
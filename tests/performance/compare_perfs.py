@@ -27,6 +27,7 @@
 # POSSIBILITY OF SUCH DAMAGE.
 #
 
+import json
 import sys
 
 
@@ -35,9 +36,47 @@ def Usage():
     print('                        [-warning_threshold val_in_pct]')
     print('                        [-error_threshold val_in_pct]')
     print('                        [-global_error_threshold val_in_pct]')
-    print('                        ref.csv new.csv')
+    print('                        ref.csv|ref.json new.csv|new.json')
+    print('')
+    print('.csv files are written by perf_test.py, .json files by bench_codec')
     sys.exit(1)
 
+
+def ReadCSV(filename):
+    """ Returns the rows of a perf_test.py CSV file, as tuples of
+        (filename, iterations, threads, command, time_ms) """
+    rows = []
+    for line in open(filename, 'rt').readlines()[1:]:
+        line = line.replace('\n', '')
+        filename, num_iterations, num_threads, command, \
+            _, time_ms = line.split(',')
+        rows.append((filename, num_iterations, num_threads, command,
+                     int(time_ms)))
+    return rows
+
+
+def ReadJSON(filename):
+    """ Returns the measures of a bench_codec JSON file, as tuples of
+        (codestream, iterations, threads, stage, time_ms), followed by a
+        TOTAL row """
+    rows = []
+    total = 0
+    for result in json.load(open(filename, 'rt'))['results']:
+        rows.append((result['codestream'], str(result['iterations']),
+                     str(result['threads']), result['stage'],
+                     result['time_ms']))
+        # The whole decoding is already the sum of the stages
+        if result['stage'] != 'decode':
+            total += result['time_ms']
+    rows.append(('TOTAL', '', '', '', total))
+    return rows
+
+
+def ReadFile(filename):
+    if filename.endswith('.json'):
+        return ReadJSON(filename)
+    return ReadCSV(filename)
+
 ref_filename = None
 new_filename = None
 noise_threshold = 2
@@ -75,31 +114,37 @@ assert warning_threshold < error_threshold
 assert global_error_threshold >= noise_threshold
 assert global_error_threshold <= error_threshold
 
-ref_lines = open(ref_filename, 'rt').readlines()[1:]
-new_lines = open(new_filename, 'rt').readlines()[1:]
-if len(ref_lines) != len(new_lines):
+ref_rows = ReadFile(ref_filename)
+new_rows = ReadFile(new_filename)
+if len(ref_rows) != len(new_rows):
     raise Exception('files are not comparable')
 
 ret_code = 0
-for i in range(len(ref_lines)):
-    line = ref_lines[i].replace('\n', '')
+for i in range(len(ref_rows)):
     filename_ref, num_iterations_ref, num_threads_ref, command_ref, \
-        _, time_ms_ref = line.split(',')
-    line = new_lines[i].replace('\n', '')
+        time_ms_ref = ref_rows[i]
     filename_new, num_iterations_new, num_threads_new, command_new, \
-        _, time_ms_new = line.split(',')
+        time_ms_new = new_rows[i]
     assert filename_ref == filename_new
     assert num_iterations_ref == num_iterations_new
     assert num_threads_ref == num_threads_new
     assert command_ref == command_new
-    time_ms_ref = int(time_ms_ref)
-    time_ms_new = int(time_ms_new)
     if filename_ref == 'TOTAL':
         display = 'TOTAL'
     else:
         display = '%s, %s iterations, %s threads, %s' % \
             (filename_ref, num_iterations_ref, num_threads_ref, command_ref)
-    display += ': ref_time %d ms, new_time %d ms' % (time_ms_ref, time_ms_new)
+    if isinstance(time_ms_ref, int):
+        display += ': ref_time %d ms, new_time %d ms' % \
+            (time_ms_ref, time_ms_new)
+    else:
+        display += ': ref_time %.3f ms, new_time %.3f ms' % \
+            (time_ms_ref, time_ms_new)
+    if time_ms_ref == 0:
+        # Too fast to be measured
+        display += ', (stable)'
+        print(display)
+        continue
     var_pct = 100.0 * (time_ms_new - time_ms_ref) / time_ms_ref
     if abs(var_pct) <= noise_threshold:
         display += ', (stable) %0.1f %%' % var_pct
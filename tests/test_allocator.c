@@ -0,0 +1,254 @@
+/*
+ * Copyright (c) 2026, OpenJPEG contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS `AS IS'
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Test of opj_codec_set_allocator().
+ *
+ * A tiled image, whose first tile is smaller than the next ones, is decoded
+ * with a counting allocator, sequentially and with several threads, in
+ * whole and for an area. The decoded samples must be the ones obtained
+ * with the default allocator, the allocator must be used for a handful of
+ * chunks only, whatever the number of tiles, and everything it allocated
+ * must have been freed once the codec is destroyed.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "test_common.h"
+
+#define IMAGE_X0     100
+#define IMAGE_Y0     100
+#define IMAGE_X1     400
+#define IMAGE_Y1     300
+#define TILE_W       128
+#define TILE_H       128
+
+/* Allocations of a counting allocator, with the first tile being */
+/* smaller than the next ones, so that the arena needs to grow */
+#define MAX_ALLOCATIONS 8
+
+static const char *tmpfile_name = "test_allocator_tmp.j2k";
+
+typedef struct {
+    int nb_allocs;
+    int nb_frees;
+    size_t bytes_in_use;
+} counting_allocator_t;
+
+/* Blocks are preceded by their size, in a header keeping the alignment */
+typedef union {
+    size_t size;
+    double d;
+    void *p;
+} block_header_t;
+
+static void* counting_alloc(OPJ_SIZE_T size, void *user_data)
+{
+    counting_allocator_t *counter = (counting_allocator_t *)user_data;
+    block_header_t *header = (block_header_t *)malloc(sizeof(block_header_t) +
+                             size);
+    if (!header) {
+        return NULL;
+    }
+    header->size = size;
+    counter->nb_allocs ++;
+    counter->bytes_in_use += size;
+    return header + 1;
+}
+
+static void counting_free(void *ptr, void *user_data)
+{
+    counting_allocator_t *counter = (counting_allocator_t *)user_data;
+    block_header_t *header;
+    if (!ptr) {
+        return;
+    }
+    header = (block_header_t *)ptr - 1;
+    counter->nb_frees ++;
+    counter->bytes_in_use -= header->size;
+    free(header);
+}
+
+static int encode(OPJ_BOOL ht)
+{
+    opj_cparameters_t parameters;
+    opj_image_t *image;
+    opj_codec_t *codec;
+    opj_allocator_t allocator;
+    counting_allocator_t counter;
+    int ret = 1;
+
+    image = test_create_image_ex(3, 8, OPJ_FALSE, IMAGE_X0, IMAGE_Y0,
+                                 IMAGE_X1 - IMAGE_X0, IMAGE_Y1 - IMAGE_Y0, 1);
+    if (!image) {
+        return 1;
+    }
+
+    opj_set_default_encoder_parameters(&parameters);
+    parameters.tcp_numlayers = 1;
+    parameters.cp_disto_alloc = 1;
+    parameters.tcp_rates[0] = 0;
+    parameters.tcp_mct = 1;
+    parameters.tile_size_on = OPJ_TRUE;
+    parameters.cp_tdx = TILE_W;
+    parameters.cp_tdy = TILE_H;
+    parameters.cblockw_init = 16;
+    parameters.cblockh_init = 16;
+    if (ht) {
+        parameters.mode = 64;
+    }
+
+    memset(&counter, 0, sizeof(counter));
+    allocator.alloc_fn = counting_alloc;
+    allocator.free_fn = counting_free;
+    allocator.user_data = &counter;
+
+    codec = test_create_compress(OPJ_CODEC_J2K, &parameters, image, NULL);
+    if (codec != NULL) {
+        if (opj_codec_set_allocator(codec, &allocator)) {
+            fprintf(stderr, "Allocator set on a compressor\n");
+        } else if (test_compress(codec, image, tmpfile_name)) {
+            ret = 0;
+        }
+    }
+    opj_destroy_codec(codec);
+    opj_image_destroy(image);
+    return ret;
+}
+
+/* Decodes the area (x0,y0,x1,y1), with the counting allocator if counter */
+/* is not NULL */
+static opj_image_t* decode(int nb_threads, counting_allocator_t *counter,
+                           OPJ_UINT32 x0, OPJ_UINT32 y0,
+                           OPJ_UINT32 x1, OPJ_UINT32 y1)
+{
+    opj_codec_t *codec;
+    opj_stream_t *stream = NULL;
+    opj_image_t *image = NULL;
+    opj_allocator_t allocator;
+    OPJ_BOOL ok = OPJ_FALSE;
+
+    codec = test_create_decompress(OPJ_CODEC_J2K, NULL, NULL);
+    if (!codec) {
+        return NULL;
+    }
+
+    allocator.alloc_fn = counting_alloc;
+    allocator.free_fn = NULL;
+    allocator.user_data = counter;
+
+    if (opj_codec_set_allocator(codec, &allocator)) {
+        fprintf(stderr, "Allocator without free function accepted\n");
+    } else if (opj_codec_set_threads(codec, nb_threads)) {
+        allocator.free_fn = counting_free;
+        if (counter == NULL || opj_codec_set_allocator(codec, &allocator)) {
+            if (test_read_header(codec, tmpfile_name, &stream, &image)) {
+                if (counter != NULL && opj_codec_set_allocator(codec, NULL)) {
+                    fprintf(stderr, "Allocator changed after the header\n");
+                } else {
+                    ok = opj_set_decode_area(codec, image, (OPJ_INT32)x0,
+                                             (OPJ_INT32)y0, (OPJ_INT32)x1,
+                                             (OPJ_INT32)y1) &&
+                         opj_decode(codec, stream, image) &&
+                         opj_end_decompress(codec, stream);
+                }
+            }
+        }
+    }
+    opj_destroy_codec(codec);
+    opj_stream_destroy(stream);
+    if (!ok) {
+        opj_image_destroy(image);
+        return NULL;
+    }
+    return image;
+}
+
+static int test_decode(OPJ_BOOL ht, int nb_threads,
+                       OPJ_UINT32 x0, OPJ_UINT32 y0,
+                       OPJ_UINT32 x1, OPJ_UINT32 y1)
+{
+    counting_allocator_t counter;
+    opj_image_t *ref;
+    opj_image_t *image;
+    int ret = 0;
+    char name[128];
+
+    sprintf(name, "%s threads=%d area=%u,%u,%u,%u", ht ? "HT" : "MQ",
+            nb_threads, x0, y0, x1, y1);
+
+    memset(&counter, 0, sizeof(counter));
+    ref = decode(nb_threads, NULL, x0, y0, x1, y1);
+    image = decode(nb_threads, &counter, x0, y0, x1, y1);
+    if (!ref || !image) {
+        fprintf(stderr, "%s: decoding failed\n", name);
+        ret = 1;
+    } else if (!test_same_images(ref, image)) {
+        fprintf(stderr, "%s: decoded images differ\n", name);
+        ret = 1;
+    }
+    if (counter.nb_allocs == 0 || counter.nb_allocs > MAX_ALLOCATIONS) {
+        fprintf(stderr, "%s: %d allocations\n", name, counter.nb_allocs);
+        ret = 1;
+    }
+    if (counter.nb_frees != counter.nb_allocs || counter.bytes_in_use != 0) {
+        fprintf(stderr, "%s: %d blocks, %lu bytes not freed\n", name,
+                counter.nb_allocs - counter.nb_frees,
+                (unsigned long)counter.bytes_in_use);
+        ret = 1;
+    }
+    opj_image_destroy(ref);
+    opj_image_destroy(image);
+    return ret;
+}
+
+int main(int argc, char *argv[])
+{
+    int ret = 0;
+    int ht;
+
+    (void)argc;
+    (void)argv;
+
+    for (ht = 0; ht <= 1; ++ht) {
+        if (encode(ht) != 0) {
+            fprintf(stderr, "Encoding failed\n");
+            return 1;
+        }
+        ret |= test_decode(ht, 0, IMAGE_X0, IMAGE_Y0, IMAGE_X1, IMAGE_Y1);
+        ret |= test_decode(ht, 2, IMAGE_X0, IMAGE_Y0, IMAGE_X1, IMAGE_Y1);
+        ret |= test_decode(ht, 0, 150, 120, 300, 250);
+        ret |= test_decode(ht, 2, 150, 120, 300, 250);
+    }
+
+    remove(tmpfile_name);
+    if (ret == 0) {
+        printf("All tests passed\n");
+    }
+    return ret;
+}
@@ -0,0 +1,283 @@
+/*
+ * Copyright (c) 2026, OpenJPEG contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS `AS IS'
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Test of opj_codec_enable_stats() and opj_codec_get_stats().
+ *
+ * Tiled images with MQ and HT code-blocks are decoded with statistics
+ * enabled, sequentially, with several threads and with several tiles in
+ * flight. The per-tile statistics must be consistent with the codestream,
+ * and the totals must be the sums of the ones of the tiles.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "test_common.h"
+
+#define IMAGE_W      300
+#define IMAGE_H      200
+#define TILE_W       64
+#define TILE_H       64
+#define NB_TILES     (((IMAGE_W + TILE_W - 1) / TILE_W) * \
+                      ((IMAGE_H + TILE_H - 1) / TILE_H))
+
+static const char *tmpfile_name = "test_codec_stats_tmp.j2k";
+
+static int encode(OPJ_BOOL ht)
+{
+    opj_cparameters_t parameters;
+    opj_image_t *image;
+    opj_codec_t *codec;
+    int ret = 1;
+
+    image = test_create_image(3, IMAGE_W, IMAGE_H, 1);
+    if (!image) {
+        return 1;
+    }
+
+    opj_set_default_encoder_parameters(&parameters);
+    parameters.tcp_numlayers = 1;
+    parameters.cp_disto_alloc = 1;
+    parameters.tcp_rates[0] = 0;
+    parameters.tcp_mct = 1;
+    parameters.tile_size_on = OPJ_TRUE;
+    parameters.cp_tdx = TILE_W;
+    parameters.cp_tdy = TILE_H;
+    parameters.cblockw_init = 16;
+    parameters.cblockh_init = 16;
+    if (ht) {
+        parameters.mode = 64;
+    }
+
+    codec = test_create_compress(OPJ_CODEC_J2K, &parameters, image, NULL);
+    if (codec != NULL) {
+        if (opj_codec_enable_stats(codec, OPJ_TRUE)) {
+            fprintf(stderr, "Statistics enabled on a compressor\n");
+        } else if (test_compress(codec, image, tmpfile_name)) {
+            ret = 0;
+        }
+    }
+    opj_destroy_codec(codec);
+    opj_image_destroy(image);
+    return ret;
+}
+
+/* Checks the statistics of a decoding of the area (x0,y0,x1,y1) */
+static int check_stats(const opj_codec_stats_t *stats, OPJ_BOOL ht,
+                       OPJ_UINT32 x0, OPJ_UINT32 y0,
+                       OPJ_UINT32 x1, OPJ_UINT32 y1,
+                       OPJ_UINT64 file_size, const char *name)
+{
+    opj_stage_time_t sums[OPJ_NUM_DECODE_STAGES];
+    OPJ_UINT64 bytes_read = 0, decoded = 0, skipped = 0;
+    OPJ_UINT32 tiles_decoded = 0, expected_tiles = 0;
+    OPJ_UINT32 i, stage;
+    const int t1_used = ht ? OPJ_STAGE_T1_HT : OPJ_STAGE_T1_MQ;
+    const int t1_unused = ht ? OPJ_STAGE_T1_MQ : OPJ_STAGE_T1_HT;
+
+    if (stats->nb_tiles != NB_TILES || stats->tiles == NULL) {
+        fprintf(stderr, "%s: %u tiles instead of %u\n", name, stats->nb_tiles,
+                NB_TILES);
+        return 1;
+    }
+
+    memset(sums, 0, sizeof(sums));
+    for (i = 0; i < stats->nb_tiles; i++) {
+        const opj_tile_stats_t *tile = &(stats->tiles[i]);
+        OPJ_UINT32 tx0 = (i % ((IMAGE_W + TILE_W - 1) / TILE_W)) * TILE_W;
+        OPJ_UINT32 ty0 = (i / ((IMAGE_W + TILE_W - 1) / TILE_W)) * TILE_H;
+        OPJ_BOOL intersects = tx0 < x1 && tx0 + TILE_W > x0 &&
+                              ty0 < y1 && ty0 + TILE_H > y0;
+
+        if (tile->tile_index != i || tile->decoded != intersects) {
+            fprintf(stderr, "%s: tile %u: index %u, decoded %d\n", name, i,
+                    tile->tile_index, tile->decoded);
+            return 1;
+        }
+        if (intersects) {
+            expected_tiles++;
+            if (tile->bytes_read == 0 || tile->codeblocks_decoded == 0 ||
+                    tile->stages[t1_unused].wall_time != 0) {
+                fprintf(stderr, "%s: tile %u: unexpected statistics\n", name, i);
+                return 1;
+            }
+        }
+        for (stage = 0; stage < OPJ_NUM_DECODE_STAGES; stage++) {
+            if (tile->stages[stage].wall_time < 0 ||
+                    tile->stages[stage].cpu_time < 0) {
+                fprintf(stderr, "%s: tile %u: negative time\n", name, i);
+                return 1;
+            }
+            sums[stage].wall_time += tile->stages[stage].wall_time;
+        }
+        bytes_read += tile->bytes_read;
+        decoded += tile->codeblocks_decoded;
+        skipped += tile->codeblocks_skipped;
+        tiles_decoded += tile->decoded ? 1 : 0;
+    }
+
+    if (stats->tiles_decoded != expected_tiles ||
+            tiles_decoded != expected_tiles) {
+        fprintf(stderr, "%s: %u tiles decoded instead of %u\n", name,
+                stats->tiles_decoded, expected_tiles);
+        return 1;
+    }
+    if (stats->codeblocks_decoded != decoded ||
+            stats->codeblocks_skipped != skipped) {
+        fprintf(stderr, "%s: code-block totals do not match the tiles\n", name);
+        return 1;
+    }
+    if (x1 - x0 < IMAGE_W && skipped == 0) {
+        fprintf(stderr, "%s: no code-block skipped outside the area\n", name);
+        return 1;
+    }
+    /* The totals also include the main header */
+    if (stats->bytes_read <= bytes_read || stats->bytes_read > file_size) {
+        fprintf(stderr, "%s: %u bytes read, %u in tiles, file of %u bytes\n",
+                name, (unsigned)stats->bytes_read, (unsigned)bytes_read,
+                (unsigned)file_size);
+        return 1;
+    }
+    for (stage = OPJ_STAGE_T2; stage < OPJ_NUM_DECODE_STAGES; stage++) {
+        double diff = stats->stages[stage].wall_time - sums[stage].wall_time;
+        if (diff > 1e-9 || diff < -1e-9) {
+            fprintf(stderr, "%s: stage %u total does not match the tiles\n",
+                    name, stage);
+            return 1;
+        }
+    }
+    if (stats->stages[t1_used].wall_time <= 0 ||
+            stats->stages[t1_unused].wall_time != 0) {
+        fprintf(stderr, "%s: unexpected tier-1 times\n", name);
+        return 1;
+    }
+#ifdef CLOCK_THREAD_CPUTIME_ID
+    /* Counted in whichever thread decoded the code-blocks */
+    if (x1 - x0 == IMAGE_W && stats->stages[t1_used].cpu_time <= 0) {
+        fprintf(stderr, "%s: no tier-1 CPU time\n", name);
+        return 1;
+    }
+#endif
+    if (stats->peak_allocated_bytes == 0) {
+        fprintf(stderr, "%s: no allocated bytes\n", name);
+        return 1;
+    }
+    return 0;
+}
+
+static int test_decode(OPJ_BOOL ht, int num_threads, int tiles_in_flight,
+                       OPJ_UINT32 x0, OPJ_UINT32 y0,
+                       OPJ_UINT32 x1, OPJ_UINT32 y1, OPJ_UINT64 file_size)
+{
+    opj_codec_t *codec;
+    opj_stream_t *stream = NULL;
+    opj_image_t *image = NULL;
+    char name[128];
+    char option[32];
+    const char* options[2];
+    int ret = 1;
+
+    sprintf(name, "%s threads=%d tiles_in_flight=%d area=%u,%u,%u,%u",
+            ht ? "HT" : "MQ", num_threads, tiles_in_flight, x0, y0, x1, y1);
+    sprintf(option, "TILES_IN_FLIGHT=%d", tiles_in_flight);
+    options[0] = option;
+    options[1] = NULL;
+
+    codec = test_create_decompress(OPJ_CODEC_J2K, NULL, options);
+    if (!codec || !opj_codec_set_threads(codec, num_threads)) {
+        fprintf(stderr, "%s: cannot set up the decoder\n", name);
+        goto end;
+    }
+    if (opj_codec_get_stats(codec) != NULL) {
+        fprintf(stderr, "%s: statistics collected by default\n", name);
+        goto end;
+    }
+    if (!opj_codec_enable_stats(codec, OPJ_TRUE) ||
+            !test_read_header(codec, tmpfile_name, &stream, &image) ||
+            !opj_set_decode_area(codec, image, (OPJ_INT32)x0, (OPJ_INT32)y0,
+                                 (OPJ_INT32)x1, (OPJ_INT32)y1) ||
+            !opj_decode(codec, stream, image) ||
+            !opj_end_decompress(codec, stream)) {
+        fprintf(stderr, "%s: decoding failed\n", name);
+        goto end;
+    }
+    if (opj_codec_get_stats(codec) == NULL ||
+            check_stats(opj_codec_get_stats(codec), ht, x0, y0, x1, y1,
+                        file_size, name) != 0) {
+        goto end;
+    }
+
+    /* Enabling again resets the statistics, disabling drops them */
+    if (!opj_codec_enable_stats(codec, OPJ_TRUE) ||
+            opj_codec_get_stats(codec) == NULL ||
+            opj_codec_get_stats(codec)->tiles_decoded != 0 ||
+            !opj_codec_enable_stats(codec, OPJ_FALSE) ||
+            opj_codec_get_stats(codec) != NULL) {
+        fprintf(stderr, "%s: statistics not reset\n", name);
+        goto end;
+    }
+    ret = 0;
+
+end:
+    opj_image_destroy(image);
+    opj_stream_destroy(stream);
+    opj_destroy_codec(codec);
+    return ret;
+}
+
+int main(int argc, char **argv)
+{
+    int ret = 0;
+    int i;
+
+    (void)argc;
+    (void)argv;
+
+    for (i = 0; i < 2 && ret == 0; i++) {
+        OPJ_BOOL ht = (i == 1);
+        OPJ_UINT64 file_size;
+
+        if (encode(ht) != 0) {
+            fprintf(stderr, "Encoding failed\n");
+            return 1;
+        }
+        file_size = test_file_size(tmpfile_name);
+
+        ret |= test_decode(ht, 0, 0, 0, 0, IMAGE_W, IMAGE_H, file_size);
+        ret |= test_decode(ht, 2, 0, 0, 0, IMAGE_W, IMAGE_H, file_size);
+        ret |= test_decode(ht, 2, 4, 0, 0, IMAGE_W, IMAGE_H, file_size);
+        ret |= test_decode(ht, 0, 0, 66, 66, 72, 72, file_size);
+    }
+
+    remove(tmpfile_name);
+    if (ret == 0) {
+        printf("All tests passed\n");
+    }
+    return ret;
+}
@@ -0,0 +1,303 @@
+/*
+ * Copyright (c) 2026, OpenJPEG contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS `AS IS'
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "test_common.h"
+
+void test_quiet_callback(const char *msg, void *client_data)
+{
+    (void)msg;
+    (void)client_data;
+}
+
+static void test_error_callback(const char *msg, void *client_data)
+{
+    (void)client_data;
+    fprintf(stderr, "[ERROR] %s", msg);
+}
+
+void test_set_handlers(opj_codec_t *codec, OPJ_BOOL quiet_errors)
+{
+    opj_set_info_handler(codec, test_quiet_callback, NULL);
+    opj_set_warning_handler(codec, test_quiet_callback, NULL);
+    opj_set_error_handler(codec, quiet_errors ? test_quiet_callback :
+                          test_error_callback, NULL);
+}
+
+opj_image_t* test_create_image(OPJ_UINT32 numcomps, OPJ_UINT32 w,
+                               OPJ_UINT32 h, OPJ_UINT32 seed)
+{
+    return test_create_image_ex(numcomps, 8, OPJ_FALSE, 0, 0, w, h, seed);
+}
+
+opj_image_t* test_create_image_ex(OPJ_UINT32 numcomps, OPJ_UINT32 prec,
+                                  OPJ_BOOL sgnd, OPJ_UINT32 x0, OPJ_UINT32 y0,
+                                  OPJ_UINT32 w, OPJ_UINT32 h, OPJ_UINT32 seed)
+{
+    opj_image_cmptparm_t cmptparm[4];
+    opj_image_t *image;
+    OPJ_UINT32 compno, x, y;
+
+    if (numcomps == 0 || numcomps > 4 || prec < 8 || prec > 16) {
+        return NULL;
+    }
+    memset(cmptparm, 0, sizeof(cmptparm));
+    for (compno = 0; compno < numcomps; ++compno) {
+        cmptparm[compno].dx = 1;
+        cmptparm[compno].dy = 1;
+        cmptparm[compno].x0 = x0;
+        cmptparm[compno].y0 = y0;
+        cmptparm[compno].w = w;
+        cmptparm[compno].h = h;
+        cmptparm[compno].prec = prec;
+        cmptparm[compno].sgnd = (OPJ_UINT32)sgnd;
+    }
+    image = opj_image_create(numcomps, cmptparm,
+                             numcomps == 3 ? OPJ_CLRSPC_SRGB : OPJ_CLRSPC_GRAY);
+    if (!image) {
+        return NULL;
+    }
+    image->x0 = x0;
+    image->y0 = y0;
+    image->x1 = x0 + w;
+    image->y1 = y0 + h;
+    for (compno = 0; compno < numcomps; ++compno) {
+        for (y = 0; y < h; ++y) {
+            for (x = 0; x < w; ++x) {
+                OPJ_INT32 v;
+                seed = seed * 1103515245U + 12345U;
+                v = (OPJ_INT32)((x * (compno + 1) + y * 3 +
+                                 ((x / 16 + y / 16) % 2) * 64 +
+                                 ((seed >> 16) % 32)) % 256);
+                /* The bits below the 8 most significant ones are noise */
+                v = (OPJ_INT32)(((OPJ_UINT32)v << (prec - 8)) |
+                                ((seed >> 8) & ((1U << (prec - 8)) - 1)));
+                if (sgnd) {
+                    v -= 1 << (prec - 1);
+                }
+                image->comps[compno].data[y * w + x] = v;
+            }
+        }
+    }
+    return image;
+}
+
+opj_codec_t* test_create_compress(OPJ_CODEC_FORMAT format,
+                                  opj_cparameters_t *parameters,
+                                  opj_image_t *image,
+                                  const char* const* options)
+{
+    opj_codec_t *codec = opj_create_compress(format);
+
+    if (!codec) {
+        return NULL;
+    }
+    test_set_handlers(codec, OPJ_FALSE);
+    if (!opj_setup_encoder(codec, parameters, image) ||
+            (options != NULL && !opj_encoder_set_extra_options(codec, options))) {
+        opj_destroy_codec(codec);
+        return NULL;
+    }
+    return codec;
+}
+
+OPJ_BOOL test_compress(opj_codec_t *codec, opj_image_t *image,
+                       const char *filename)
+{
+    opj_stream_t *stream;
+    OPJ_BOOL ret;
+
+    stream = opj_stream_create_default_file_stream(filename, OPJ_FALSE);
+    if (!stream) {
+        return OPJ_FALSE;
+    }
+    ret = opj_start_compress(codec, image, stream) &&
+          opj_encode(codec, stream) &&
+          opj_end_compress(codec, stream);
+    opj_stream_destroy(stream);
+    return ret;
+}
+
+OPJ_BOOL test_encode(OPJ_CODEC_FORMAT format, opj_cparameters_t *parameters,
+                     opj_image_t *image, const char* const* options,
+                     const char *filename)
+{
+    opj_codec_t *codec = test_create_compress(format, parameters, image,
+                         options);
+    OPJ_BOOL ret;
+
+    if (!codec) {
+        return OPJ_FALSE;
+    }
+    ret = test_compress(codec, image, filename);
+    opj_destroy_codec(codec);
+    return ret;
+}
+
+opj_codec_t* test_create_decompress(OPJ_CODEC_FORMAT format,
+                                    opj_dparameters_t *parameters,
+                                    const char* const* options)
+{
+    opj_dparameters_t default_parameters;
+    opj_codec_t *codec = opj_create_decompress(format);
+
+    if (!codec) {
+        return NULL;
+    }
+    test_set_handlers(codec, OPJ_FALSE);
+    if (parameters == NULL) {
+        opj_set_default_decoder_parameters(&default_parameters);
+        parameters = &default_parameters;
+    }
+    if (!opj_setup_decoder(codec, parameters) ||
+            (options != NULL && !opj_decoder_set_extra_options(codec, options))) {
+        opj_destroy_codec(codec);
+        return NULL;
+    }
+    return codec;
+}
+
+OPJ_BOOL test_read_header(opj_codec_t *codec, const char *filename,
+                          opj_stream_t **p_stream, opj_image_t **p_image)
+{
+    *p_image = NULL;
+    *p_stream = opj_stream_create_default_file_stream(filename, OPJ_TRUE);
+    if (!*p_stream) {
+        return OPJ_FALSE;
+    }
+    if (!opj_read_header(*p_stream, codec, p_image)) {
+        opj_stream_destroy(*p_stream);
+        opj_image_destroy(*p_image);
+        *p_stream = NULL;
+        *p_image = NULL;
+        return OPJ_FALSE;
+    }
+    return OPJ_TRUE;
+}
+
+opj_image_t* test_decode_file(const char *filename, OPJ_CODEC_FORMAT format)
+{
+    opj_codec_t *codec = test_create_decompress(format, NULL, NULL);
+    opj_stream_t *stream;
+    opj_image_t *image = NULL;
+
+    if (!codec) {
+        return NULL;
+    }
+    if (test_read_header(codec, filename, &stream, &image)) {
+        if (!opj_decode(codec, stream, image) ||
+                !opj_end_decompress(codec, stream)) {
+            opj_image_destroy(image);
+            image = NULL;
+        }
+        opj_stream_destroy(stream);
+    }
+    opj_destroy_codec(codec);
+    return image;
+}
+
+int test_same_images(const opj_image_t *a, const opj_image_t *b)
+{
+    OPJ_UINT32 compno;
+
+    if (a->numcomps != b->numcomps) {
+        return 0;
+    }
+    for (compno = 0; compno < a->numcomps; ++compno) {
+        const opj_image_comp_t *ca = &a->comps[compno];
+        const opj_image_comp_t *cb = &b->comps[compno];
+        if (ca->w != cb->w || ca->h != cb->h ||
+                memcmp(ca->data, cb->data,
+                       (size_t)ca->w * ca->h * sizeof(OPJ_INT32)) != 0) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int test_same_files(const char *name1, const char *name2)
+{
+    FILE *f1 = fopen(name1, "rb");
+    FILE *f2 = fopen(name2, "rb");
+    int ret = f1 != NULL && f2 != NULL;
+
+    while (ret) {
+        int c1 = fgetc(f1);
+        int c2 = fgetc(f2);
+        if (c1 != c2) {
+            ret = 0;
+        } else if (c1 == EOF) {
+            break;
+        }
+    }
+    if (f1) {
+        fclose(f1);
+    }
+    if (f2) {
+        fclose(f2);
+    }
+    return ret;
+}
+
+OPJ_BYTE* test_read_file(const char *filename, OPJ_SIZE_T *p_size)
+{
+    FILE *f = fopen(filename, "rb");
+    OPJ_BYTE *data = NULL;
+    long size;
+
+    if (!f) {
+        return NULL;
+    }
+    if (fseek(f, 0, SEEK_END) == 0 && (size = ftell(f)) > 0 &&
+            fseek(f, 0, SEEK_SET) == 0) {
+        data = (OPJ_BYTE *)malloc((size_t)size);
+        if (data && fread(data, 1, (size_t)size, f) != (size_t)size) {
+            free(data);
+            data = NULL;
+        }
+        *p_size = (OPJ_SIZE_T)size;
+    }
+    fclose(f);
+    return data;
+}
+
+OPJ_SIZE_T test_file_size(const char *filename)
+{
+    FILE *f = fopen(filename, "rb");
+    long size = 0;
+
+    if (!f) {
+        return 0;
+    }
+    if (fseek(f, 0, SEEK_END) == 0) {
+        size = ftell(f);
+    }
+    fclose(f);
+    return size > 0 ? (OPJ_SIZE_T)size : 0;
+}
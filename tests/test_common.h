@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2026, OpenJPEG contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS `AS IS'
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Fixtures shared by the self-contained tests, which encode their own
+ * images instead of relying on the conformance data.
+ */
+
+#ifndef _OPJ_TEST_COMMON_H_
+#define _OPJ_TEST_COMMON_H_
+
+#include "openjpeg.h"
+
+/** Message handler discarding the messages */
+void test_quiet_callback(const char *msg, void *client_data);
+
+/** Discards the info and warning messages of codec, and prints its error
+    messages to stderr unless quiet_errors is set */
+void test_set_handlers(opj_codec_t *codec, OPJ_BOOL quiet_errors);
+
+/** Creates an image of numcomps 8-bit components of w x h samples: slopes
+    over a checkerboard, with noise seeded by seed, so that all the coding
+    passes have different rate-distortion slopes */
+opj_image_t* test_create_image(OPJ_UINT32 numcomps, OPJ_UINT32 w,
+                               OPJ_UINT32 h, OPJ_UINT32 seed);
+
+/** Same as test_create_image() for components of prec bits, signed if sgnd
+    is set, at the origin (x0, y0) of the reference grid */
+opj_image_t* test_create_image_ex(OPJ_UINT32 numcomps, OPJ_UINT32 prec,
+                                  OPJ_BOOL sgnd, OPJ_UINT32 x0, OPJ_UINT32 y0,
+                                  OPJ_UINT32 w, OPJ_UINT32 h, OPJ_UINT32 seed);
+
+/** Creates a compressor set up for image, with the NULL-terminated extra
+    options if not NULL. Returns NULL in case of failure */
+opj_codec_t* test_create_compress(OPJ_CODEC_FORMAT format,
+                                  opj_cparameters_t *parameters,
+                                  opj_image_t *image,
+                                  const char* const* options);
+
+/** Encodes image to filename with a compressor set up for it. The encoder
+    may work in place on the samples of image */
+OPJ_BOOL test_compress(opj_codec_t *codec, opj_image_t *image,
+                       const char *filename);
+
+/** Encodes image to filename, as test_create_compress() and
+    test_compress() do */
+OPJ_BOOL test_encode(OPJ_CODEC_FORMAT format, opj_cparameters_t *parameters,
+                     opj_image_t *image, const char* const* options,
+                     const char *filename);
+
+/** Creates a decompressor set up with parameters, or the default ones if
+    NULL, and the NULL-terminated extra options if not NULL. Returns NULL in
+    case of failure */
+opj_codec_t* test_create_decompress(OPJ_CODEC_FORMAT format,
+                                    opj_dparameters_t *parameters,
+                                    const char* const* options);
+
+/** Opens a file stream on filename and reads its header with codec. On
+    failure, *p_stream and *p_image are set to NULL */
+OPJ_BOOL test_read_header(opj_codec_t *codec, const char *filename,
+                          opj_stream_t **p_stream, opj_image_t **p_image);
+
+/** Decodes the whole of filename with the default parameters. Returns NULL
+    in case of failure */
+opj_image_t* test_decode_file(const char *filename, OPJ_CODEC_FORMAT format);
+
+/** Whether two images have the same components and samples */
+int test_same_images(const opj_image_t *a, const opj_image_t *b);
+
+/** Whether two files have the same content */
+int test_same_files(const char *name1, const char *name2);
+
+/** Reads a whole file in a buffer to free(). Returns NULL in case of
+    failure */
+OPJ_BYTE* test_read_file(const char *filename, OPJ_SIZE_T *p_size);
+
+/** Size of a file, or 0 in case of failure */
+OPJ_SIZE_T test_file_size(const char *filename);
+
+#endif /* _OPJ_TEST_COMMON_H_ */
@@ -73,6 +73,9 @@ static int infile_format(const char *fname)
 
 /* -------------------------------------------------------------------------- */
 
+/** Number of tiles decoded concurrently for the full image reference decode */
+static OPJ_UINT32 tiles_in_flight = 0;
+
 /**
   sample error debug callback expecting no client object
  */
@@ -184,6 +187,21 @@ opj_image_t* decode(
         return NULL;
     }
 
+    if (tiles_in_flight > 0 && x0 == 0 && x1 == 0 && y0 == 0 && y1 == 0) {
+        char option[64];
+        const char* options[2];
+        sprintf(option, "TILES_IN_FLIGHT=%u", tiles_in_flight);
+        options[0] = option;
+        options[1] = NULL;
+        if (!opj_codec_set_threads(l_codec, (int)tiles_in_flight) ||
+                !opj_decoder_set_extra_options(l_codec, options)) {
+            fprintf(stderr, "ERROR -> failed to enable tile-parallel decoding\n");
+            opj_stream_destroy(l_stream);
+            opj_destroy_codec(l_codec);
+            return NULL;
+        }
+    }
+
     /* Read the main header of the codestream and if necessary the JP2 boxes*/
     if (! opj_read_header(l_stream, l_codec, &l_image)) {
         fprintf(stderr, "ERROR -> failed to read the header\n");
@@ -376,6 +394,140 @@ int decode_by_strip(OPJ_BOOL quiet,
     return 0;
 }
 
+/** State of decode_strips() */
+typedef struct {
+    opj_image_t* ref_image;
+    OPJ_UINT32 strip_height;
+    /* Bottom of the last strip, on the reference grid */
+    OPJ_UINT32 next_y;
+    /* Next row expected in each component */
+    OPJ_UINT32* next_rows;
+    OPJ_BOOL failed;
+} strip_check_t;
+
+static OPJ_BOOL strip_callback(const opj_image_t* strip, void* user_data)
+{
+    strip_check_t* check = (strip_check_t*)user_data;
+    opj_image_t* ref_image = check->ref_image;
+    OPJ_UINT32 compno;
+
+    /* Strips without rows are skipped */
+    if (strip->y0 < check->next_y || strip->y1 <= strip->y0 ||
+            strip->y1 - strip->y0 > check->strip_height ||
+            strip->numcomps != ref_image->numcomps) {
+        fprintf(stderr, "Unexpected strip %u...%u (expected start: %u)\n",
+                strip->y0, strip->y1, check->next_y);
+        check->failed = OPJ_TRUE;
+        return OPJ_FALSE;
+    }
+    check->next_y = strip->y1;
+
+    for (compno = 0; compno < strip->numcomps; compno ++) {
+        const opj_image_comp_t* comp = &(strip->comps[compno]);
+        const opj_image_comp_t* ref_comp = &(ref_image->comps[compno]);
+        OPJ_UINT32 y;
+
+        if (comp->w != ref_comp->w || comp->x0 != ref_comp->x0 ||
+                comp->y0 < ref_comp->y0) {
+            fprintf(stderr, "Unexpected dimensions for compno=%u\n", compno);
+            check->failed = OPJ_TRUE;
+            return OPJ_FALSE;
+        }
+        if (comp->h > 0 && comp->y0 - ref_comp->y0 != check->next_rows[compno]) {
+            fprintf(stderr, "Strip %u...%u starts at row %u of compno=%u "
+                    "instead of %u\n", strip->y0, strip->y1,
+                    comp->y0 - ref_comp->y0, compno, check->next_rows[compno]);
+            check->failed = OPJ_TRUE;
+            return OPJ_FALSE;
+        }
+        check->next_rows[compno] += comp->h;
+        for (y = 0; y < comp->h; y++) {
+            OPJ_UINT32 ref_y = y + (comp->y0 - ref_comp->y0);
+            if (ref_y >= ref_comp->h ||
+                    memcmp(comp->data + y * comp->w,
+                           ref_comp->data + ref_y * ref_comp->w,
+                           comp->w * sizeof(OPJ_INT32)) != 0) {
+                fprintf(stderr,
+                        "Difference found at row %u of compno=%u in strip %u...%u\n",
+                        ref_y, compno, strip->y0, strip->y1);
+                check->failed = OPJ_TRUE;
+                return OPJ_FALSE;
+            }
+        }
+    }
+    return OPJ_TRUE;
+}
+
+/* Decodes the image with opj_decode_strips(), and checks the strips against */
+/* ref_image, decoded with opj_decode() */
+int decode_strips(OPJ_BOOL quiet,
+                  const char* input_file,
+                  OPJ_UINT32 strip_height,
+                  OPJ_INT32 da_x0,
+                  OPJ_INT32 da_y0,
+                  OPJ_INT32 da_x1,
+                  OPJ_INT32 da_y1,
+                  opj_image_t* ref_image)
+{
+    opj_codec_t * l_codec = NULL;
+    opj_image_t * l_image = NULL;
+    opj_stream_t * l_stream = NULL;
+    strip_check_t check;
+    OPJ_UINT32 compno;
+    int ret = 1;
+
+    if (!quiet) {
+        printf("Decoding by strips of %u rows\n", strip_height);
+    }
+
+    l_codec = create_codec_and_stream(input_file, &l_stream);
+    if (l_codec == NULL) {
+        return 1;
+    }
+
+    if (! opj_read_header(l_stream, l_codec, &l_image)) {
+        fprintf(stderr, "ERROR -> failed to read the header\n");
+        opj_stream_destroy(l_stream);
+        opj_destroy_codec(l_codec);
+        return 1;
+    }
+
+    if ((da_x0 != 0 || da_y0 != 0 || da_x1 != 0 || da_y1 != 0) &&
+            !opj_set_decode_area(l_codec, l_image, da_x0, da_y0, da_x1, da_y1)) {
+        fprintf(stderr, "ERROR -> failed to set the decoded area\n");
+    } else {
+        check.ref_image = ref_image;
+        check.strip_height = strip_height;
+        check.next_y = l_image->y0;
+        check.next_rows = (OPJ_UINT32*)calloc(ref_image->numcomps,
+                                              sizeof(OPJ_UINT32));
+        check.failed = OPJ_FALSE;
+        if (check.next_rows == NULL) {
+            fprintf(stderr, "ERROR -> out of memory\n");
+        } else if (!opj_decode_strips(l_codec, l_stream, l_image, strip_height,
+                               strip_callback, &check) ||
+                !opj_end_decompress(l_codec, l_stream)) {
+            fprintf(stderr, "ERROR -> failed to decode image by strips!\n");
+        } else if (!check.failed) {
+            ret = 0;
+            for (compno = 0; compno < ref_image->numcomps; compno ++) {
+                if (check.next_rows[compno] != ref_image->comps[compno].h) {
+                    fprintf(stderr, "Strips end at row %u of compno=%u "
+                            "instead of %u\n", check.next_rows[compno], compno,
+                            ref_image->comps[compno].h);
+                    ret = 1;
+                }
+            }
+        }
+        free(check.next_rows);
+    }
+
+    opj_stream_destroy(l_stream);
+    opj_destroy_codec(l_codec);
+    opj_image_destroy(l_image);
+    return ret;
+}
+
 OPJ_BOOL check_consistency(opj_image_t* p_image, opj_image_t* p_sub_image)
 {
     OPJ_UINT32 compno;
@@ -425,11 +577,13 @@ int main(int argc, char** argv)
     OPJ_UINT32 nsteps = 100;
     OPJ_UINT32 strip_height = 0;
     OPJ_BOOL strip_check = OPJ_FALSE;
+    OPJ_UINT32 decode_strips_height = 0;
 
     if (argc < 2) {
         fprintf(stderr,
-                "Usage: test_decode_area [-q] [-steps n] input_file_jp2_or_jk2 [x0 y0 x1 y1]\n"
-                "or   : test_decode_area [-q] [-strip_height h] [-strip_check] input_file_jp2_or_jk2 [x0 y0 x1 y1]\n");
+                "Usage: test_decode_area [-q] [-steps n] [-tiles_in_flight n] input_file_jp2_or_jk2 [x0 y0 x1 y1]\n"
+                "or   : test_decode_area [-q] [-strip_height h] [-strip_check] input_file_jp2_or_jk2 [x0 y0 x1 y1]\n"
+                "or   : test_decode_area [-q] [-decode_strips h] input_file_jp2_or_jk2 [x0 y0 x1 y1]\n");
         return 1;
     }
 
@@ -444,6 +598,14 @@ int main(int argc, char** argv)
             } else if (strcmp(argv[iarg], "-strip_height") == 0 && iarg + 1 < argc) {
                 strip_height = (OPJ_UINT32)atoi(argv[iarg + 1]);
                 iarg ++;
+            } else if (strcmp(argv[iarg], "-tiles_in_flight") == 0 &&
+                       iarg + 1 < argc) {
+                tiles_in_flight = (OPJ_UINT32)atoi(argv[iarg + 1]);
+                iarg ++;
+            } else if (strcmp(argv[iarg], "-decode_strips") == 0 &&
+                       iarg + 1 < argc) {
+                decode_strips_height = (OPJ_UINT32)atoi(argv[iarg + 1]);
+                iarg ++;
             } else if (strcmp(argv[iarg], "-strip_check") == 0) {
                 strip_check = OPJ_TRUE;
             } else if (input_file == NULL) {
@@ -462,6 +624,19 @@ int main(int argc, char** argv)
         }
     }
 
+    if (decode_strips_height) {
+        int ret;
+        l_image = decode(quiet, input_file, da_x0, da_y0, da_x1, da_y1,
+                         NULL, NULL, NULL, NULL);
+        if (!l_image) {
+            return 1;
+        }
+        ret = decode_strips(quiet, input_file, decode_strips_height,
+                            da_x0, da_y0, da_x1, da_y1, l_image);
+        opj_image_destroy(l_image);
+        return ret;
+    }
+
     if (!strip_height || strip_check) {
         l_image = decode(quiet, input_file, 0, 0, 0, 0,
                          &tilew, &tileh, &cblkw, &cblkh);
@@ -0,0 +1,689 @@
+/*
+ * Copyright (c) 2026, OpenJPEG contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS `AS IS'
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Test of the reuse of decoded data by a codec decoding an image several
+ * times, as a viewer would do. Each image decoded by the codec must be the
+ * same as the one decoded by a new codec, and fewer code-blocks must be
+ * decoded in total.
+ *
+ * Usage: test_decode_reuse cblk_cache|quality_layers|progressive_refinement
+ *
+ * - cblk_cache: CODEBLOCK_CACHE_SIZE decoder option. A sequence of areas
+ *   and resolution factors is decoded, as a viewer panning and zooming
+ *   would do. With a cache large enough, going back to the first area must
+ *   not decode any code-block, while without cache the code-blocks that
+ *   have left the decoded area must be decoded again.
+ * - quality_layers: opj_set_decoded_quality_layers(). More and more
+ *   quality layers are decoded, and then fewer again. A multi-tiled image
+ *   cannot be decoded again.
+ * - progressive_refinement: PROGRESSIVE_REFINEMENT decoder option. Lower
+ *   and lower resolution factors are decoded, from a thumbnail to the full
+ *   image, and then a higher one again. Each code-block must have been
+ *   decoded only once when the full image is reached. A multi-tiled image
+ *   cannot be decoded again.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "test_common.h"
+
+/* One codestream per test, as the tests may run concurrently */
+static char tmpfile_name[64];
+
+/* Creates a decompressor with statistics, decoding cp_layer layers with */
+/* the option if not NULL, and reads the header of the test file */
+static opj_codec_t* open_codec(OPJ_UINT32 cp_layer, const char *option,
+                               OPJ_BOOL quiet_errors,
+                               opj_stream_t **p_stream, opj_image_t **p_image)
+{
+    opj_dparameters_t parameters;
+    opj_codec_t *codec;
+    const char* options[2] = { NULL, NULL };
+
+    options[0] = option;
+    opj_set_default_decoder_parameters(&parameters);
+    parameters.cp_layer = cp_layer;
+    codec = test_create_decompress(OPJ_CODEC_J2K, &parameters, options);
+    if (!codec) {
+        return NULL;
+    }
+    test_set_handlers(codec, quiet_errors);
+    if (!opj_codec_enable_stats(codec, OPJ_TRUE) ||
+            !test_read_header(codec, tmpfile_name, p_stream, p_image)) {
+        opj_destroy_codec(codec);
+        return NULL;
+    }
+    return codec;
+}
+
+static void close_codec(opj_codec_t *codec, opj_stream_t *stream,
+                        opj_image_t *image)
+{
+    opj_destroy_codec(codec);
+    opj_stream_destroy(stream);
+    opj_image_destroy(image);
+}
+
+/* -------------------------------------------------------------------------- */
+/* cblk_cache */
+
+typedef enum {
+    NO_CACHE,
+    /* Cache too small for all the code-blocks, so that some are evicted */
+    SMALL_CACHE,
+    LARGE_CACHE
+} cache_kind_t;
+
+typedef struct {
+    /* Whether the 5-3 reversible wavelet is used */
+    OPJ_BOOL reversible;
+    /* Cache size option */
+    const char *cache_option;
+    cache_kind_t cache_kind;
+} cache_config_t;
+
+static const cache_config_t cache_configs[] = {
+    { OPJ_FALSE, "CODEBLOCK_CACHE_SIZE=0", NO_CACHE },
+    { OPJ_FALSE, "CODEBLOCK_CACHE_SIZE=64", LARGE_CACHE },
+    { OPJ_TRUE, "CODEBLOCK_CACHE_SIZE=64", LARGE_CACHE },
+    { OPJ_FALSE, "CODEBLOCK_CACHE_SIZE=1", SMALL_CACHE }
+};
+
+typedef struct {
+    OPJ_UINT32 reduce;
+    OPJ_INT32 x0, y0, x1, y1;
+} view_t;
+
+/* The last view is the first one */
+static const view_t views[] = {
+    { 0, 0, 0, 200, 150 },
+    { 0, 40, 20, 240, 170 },
+    { 0, 80, 40, 280, 190 },
+    { 1, 20, 20, 400, 300 },
+    { 2, 0, 0, 500, 380 },
+    { 1, 60, 30, 300, 250 },
+    { 0, 100, 60, 300, 210 },
+    { 0, 300, 0, 512, 200 },
+    { 0, 280, 180, 512, 384 },
+    { 0, 0, 200, 300, 384 },
+    { 0, 0, 0, 200, 150 }
+};
+
+#define NB_VIEWS (sizeof(views) / sizeof(views[0]))
+
+static OPJ_BOOL encode_cache_config(const cache_config_t *config)
+{
+    opj_cparameters_t parameters;
+    opj_image_t *image = test_create_image(3, 512, 384, 4321);
+    OPJ_BOOL ret;
+
+    opj_set_default_encoder_parameters(&parameters);
+    parameters.cblockw_init = 32;
+    parameters.cblockh_init = 32;
+    parameters.numresolution = 5;
+    parameters.irreversible = config->reversible ? 0 : 1;
+    parameters.tcp_mct = 1;
+    parameters.tcp_numlayers = 2;
+    parameters.tcp_rates[0] = 20;
+    parameters.tcp_rates[1] = config->reversible ? 0 : 4;
+    parameters.cp_disto_alloc = 1;
+
+    ret = image != NULL && test_encode(OPJ_CODEC_J2K, &parameters, image, NULL,
+                                       tmpfile_name);
+    opj_image_destroy(image);
+    return ret;
+}
+
+static OPJ_BOOL decode_view(opj_codec_t *codec, opj_stream_t *stream,
+                            opj_image_t *image, const view_t *view)
+{
+    return opj_set_decoded_resolution_factor(codec, view->reduce) &&
+           opj_set_decode_area(codec, image, view->x0, view->y0,
+                               view->x1, view->y1) &&
+           opj_decode(codec, stream, image);
+}
+
+/* Decodes the views with one codec. Returns 0 on success */
+static int test_cache_config(const cache_config_t *config)
+{
+    opj_stream_t *stream;
+    opj_image_t *image;
+    opj_codec_t *codec = open_codec(0, config->cache_option, OPJ_FALSE,
+                                    &stream, &image);
+    OPJ_UINT64 decoded = 0, cached = 0;
+    size_t i;
+    int ret = 0;
+
+    if (!codec) {
+        fprintf(stderr, "Cannot open %s\n", tmpfile_name);
+        return 1;
+    }
+    for (i = 0; i < NB_VIEWS && ret == 0; ++i) {
+        const view_t *view = &views[i];
+        opj_stream_t *ref_stream;
+        opj_image_t *ref_image;
+        opj_codec_t *ref_codec = open_codec(0, NULL, OPJ_FALSE, &ref_stream,
+                                            &ref_image);
+        const opj_codec_stats_t *stats;
+        const opj_codec_stats_t *ref_stats;
+        OPJ_UINT64 new_decoded, new_cached;
+
+        if (!ref_codec) {
+            fprintf(stderr, "Cannot open %s\n", tmpfile_name);
+            ret = 1;
+            break;
+        }
+        if (!decode_view(codec, stream, image, view) ||
+                !decode_view(ref_codec, ref_stream, ref_image, view)) {
+            fprintf(stderr, "View %d: decoding failed\n", (int)i);
+            ret = 1;
+        } else if (!test_same_images(image, ref_image)) {
+            fprintf(stderr, "View %d: images differ\n", (int)i);
+            ret = 1;
+        } else {
+            stats = opj_codec_get_stats(codec);
+            ref_stats = opj_codec_get_stats(ref_codec);
+            new_decoded = stats->codeblocks_decoded - decoded;
+            new_cached = stats->codeblocks_cached - cached;
+            decoded = stats->codeblocks_decoded;
+            cached = stats->codeblocks_cached;
+            if (new_decoded > ref_stats->codeblocks_decoded ||
+                    ref_stats->codeblocks_cached != 0 ||
+                    (config->cache_kind == NO_CACHE && new_cached != 0) ||
+                    (i + 1 == NB_VIEWS &&
+                     (config->cache_kind == LARGE_CACHE) != (new_decoded == 0))) {
+                fprintf(stderr, "View %d: %u code-blocks decoded and %u cached, "
+                        "%u decoded by a new codec\n", (int)i,
+                        (unsigned)new_decoded, (unsigned)new_cached,
+                        (unsigned)ref_stats->codeblocks_decoded);
+                ret = 1;
+            }
+        }
+        close_codec(ref_codec, ref_stream, ref_image);
+    }
+    if (ret == 0 && (cached == 0) != (config->cache_kind == NO_CACHE)) {
+        fprintf(stderr, "No code-block taken from the cache\n");
+        ret = 1;
+    }
+    close_codec(codec, stream, image);
+    return ret;
+}
+
+static int test_cblk_cache(void)
+{
+    size_t i;
+    int ret = 0;
+
+    for (i = 0; i < sizeof(cache_configs) / sizeof(cache_configs[0]); ++i) {
+        if (!encode_cache_config(&cache_configs[i])) {
+            fprintf(stderr, "Config %d: encoding failed\n", (int)i);
+            ret = 1;
+        } else if (test_cache_config(&cache_configs[i]) != 0) {
+            fprintf(stderr, "Config %d failed\n", (int)i);
+            ret = 1;
+        }
+    }
+    return ret;
+}
+
+/* -------------------------------------------------------------------------- */
+/* quality_layers */
+
+#define NB_LAYERS   6
+
+typedef struct {
+    /* Whether the 5-3 reversible wavelet is used */
+    OPJ_BOOL reversible;
+    OPJ_PROG_ORDER prog_order;
+    /* Cache size option */
+    const char *cache_option;
+    /* Whether a code-block cache large enough for the image is used */
+    OPJ_BOOL large_cache;
+    /* Whether only an area of the image is decoded */
+    OPJ_BOOL area;
+} layers_config_t;
+
+static const layers_config_t layers_configs[] = {
+    { OPJ_FALSE, OPJ_LRCP, "CODEBLOCK_CACHE_SIZE=0", OPJ_FALSE, OPJ_FALSE },
+    { OPJ_FALSE, OPJ_LRCP, "CODEBLOCK_CACHE_SIZE=64", OPJ_TRUE, OPJ_FALSE },
+    { OPJ_TRUE, OPJ_RPCL, "CODEBLOCK_CACHE_SIZE=64", OPJ_TRUE, OPJ_FALSE },
+    { OPJ_TRUE, OPJ_LRCP, "CODEBLOCK_CACHE_SIZE=0", OPJ_FALSE, OPJ_TRUE }
+};
+
+/* Numbers of layers decoded one after the other, 0 meaning all of them */
+static const OPJ_UINT32 layers_steps[] = { 1, 2, 4, 0, 2 };
+
+#define NB_LAYERS_STEPS (sizeof(layers_steps) / sizeof(layers_steps[0]))
+
+/* Encodes the test image with PLT markers, in 4 tiles if tiled is set */
+static OPJ_BOOL encode_layers_config(const layers_config_t *config,
+                                     OPJ_BOOL tiled)
+{
+    const char* const options[] = { "PLT=YES", NULL };
+    opj_cparameters_t parameters;
+    opj_image_t *image = test_create_image(3, 256, 192, 1234);
+    OPJ_UINT32 layno;
+    OPJ_BOOL ret;
+
+    opj_set_default_encoder_parameters(&parameters);
+    parameters.cblockw_init = 32;
+    parameters.cblockh_init = 32;
+    parameters.numresolution = 4;
+    parameters.irreversible = config->reversible ? 0 : 1;
+    parameters.prog_order = config->prog_order;
+    parameters.tcp_mct = 1;
+    parameters.tcp_numlayers = NB_LAYERS;
+    for (layno = 0; layno < NB_LAYERS; ++layno) {
+        parameters.tcp_rates[layno] = (float)(80 >> layno);
+    }
+    if (config->reversible) {
+        parameters.tcp_rates[NB_LAYERS - 1] = 0;
+    }
+    parameters.cp_disto_alloc = 1;
+    if (tiled) {
+        parameters.tile_size_on = OPJ_TRUE;
+        parameters.cp_tdx = 128;
+        parameters.cp_tdy = 96;
+    }
+
+    ret = image != NULL && test_encode(OPJ_CODEC_J2K, &parameters, image,
+                                       options, tmpfile_name);
+    opj_image_destroy(image);
+    return ret;
+}
+
+static OPJ_BOOL decode_layers(const layers_config_t *config,
+                              opj_codec_t *codec, opj_stream_t *stream,
+                              opj_image_t *image)
+{
+    if (config->area &&
+            !opj_set_decode_area(codec, image, 40, 30, 180, 150)) {
+        return OPJ_FALSE;
+    }
+    return opj_decode(codec, stream, image);
+}
+
+/* Decodes the steps with one codec. Returns 0 on success */
+static int test_layers_config(const layers_config_t *config)
+{
+    opj_stream_t *stream;
+    opj_image_t *image;
+    opj_codec_t *codec = open_codec(0, config->cache_option, OPJ_FALSE,
+                                    &stream, &image);
+    OPJ_UINT64 decoded = 0, ref_decoded = 0, resumed = 0;
+    size_t i;
+    int ret = 0;
+
+    if (!codec) {
+        fprintf(stderr, "Cannot open %s\n", tmpfile_name);
+        return 1;
+    }
+    for (i = 0; i < NB_LAYERS_STEPS && ret == 0; ++i) {
+        opj_stream_t *ref_stream;
+        opj_image_t *ref_image;
+        opj_codec_t *ref_codec = open_codec(layers_steps[i], NULL, OPJ_FALSE,
+                                            &ref_stream, &ref_image);
+        const opj_codec_stats_t *stats;
+        const opj_codec_stats_t *ref_stats;
+        OPJ_UINT64 new_decoded;
+
+        if (!ref_codec) {
+            fprintf(stderr, "Cannot open %s\n", tmpfile_name);
+            ret = 1;
+            break;
+        }
+        if (!opj_set_decoded_quality_layers(codec, layers_steps[i]) ||
+                !decode_layers(config, codec, stream, image) ||
+                !decode_layers(config, ref_codec, ref_stream, ref_image)) {
+            fprintf(stderr, "Step %d: decoding failed\n", (int)i);
+            ret = 1;
+        } else if (!test_same_images(image, ref_image)) {
+            fprintf(stderr, "Step %d: images differ\n", (int)i);
+            ret = 1;
+        } else {
+            stats = opj_codec_get_stats(codec);
+            ref_stats = opj_codec_get_stats(ref_codec);
+            new_decoded = stats->codeblocks_decoded - decoded;
+            decoded = stats->codeblocks_decoded;
+            ref_decoded += ref_stats->codeblocks_decoded;
+            /* The decoding of the code-blocks refined by the added layers */
+            /* is resumed where the previous step stopped */
+            if (i > 0 && !config->large_cache &&
+                    (layers_steps[i] == 0 ||
+                     layers_steps[i] > layers_steps[i - 1]) &&
+                    layers_steps[i - 1] != 0 &&
+                    stats->codeblocks_resumed == resumed) {
+                fprintf(stderr, "Step %d: no code-block decoding resumed\n",
+                        (int)i);
+                ret = 1;
+            }
+            resumed = stats->codeblocks_resumed;
+            /* Going back to a number of layers decoded before */
+            if (new_decoded > ref_stats->codeblocks_decoded ||
+                    (i + 1 == NB_LAYERS_STEPS &&
+                     config->large_cache && new_decoded != 0)) {
+                fprintf(stderr, "Step %d: %u code-blocks decoded, "
+                        "%u decoded by a new codec\n", (int)i,
+                        (unsigned)new_decoded,
+                        (unsigned)ref_stats->codeblocks_decoded);
+                ret = 1;
+            }
+        }
+        close_codec(ref_codec, ref_stream, ref_image);
+    }
+    if (ret == 0 && decoded >= ref_decoded) {
+        fprintf(stderr, "%u code-blocks decoded, %u decoded by new codecs\n",
+                (unsigned)decoded, (unsigned)ref_decoded);
+        ret = 1;
+    }
+    close_codec(codec, stream, image);
+    return ret;
+}
+
+/* The packets of the layers that are not decoded are not read when the */
+/* number of layers is set with cp_layer, so more layers cannot be decoded */
+/* afterwards. Returns 0 on success */
+static int test_layers_too_late(void)
+{
+    opj_stream_t *stream;
+    opj_image_t *image;
+    opj_codec_t *codec = open_codec(2, NULL, OPJ_TRUE, &stream, &image);
+    int ret = 0;
+
+    if (!codec) {
+        fprintf(stderr, "Cannot open %s\n", tmpfile_name);
+        return 1;
+    }
+    if (!opj_decode(codec, stream, image)) {
+        fprintf(stderr, "Decoding failed\n");
+        ret = 1;
+    } else if (opj_set_decoded_quality_layers(codec, 4) ||
+               !opj_set_decoded_quality_layers(codec, 1)) {
+        fprintf(stderr, "Layers not read accepted, or read layers refused\n");
+        ret = 1;
+    }
+    close_codec(codec, stream, image);
+    return ret;
+}
+
+/* The tiles of a multi-tiled image are not kept, so it cannot be decoded */
+/* again with more layers. Returns 0 on success */
+static int test_layers_multi_tile(void)
+{
+    opj_stream_t *stream;
+    opj_image_t *image;
+    opj_codec_t *codec;
+    int ret = 0;
+
+    if (!encode_layers_config(&layers_configs[0], OPJ_TRUE)) {
+        fprintf(stderr, "Multi-tile: encoding failed\n");
+        return 1;
+    }
+    codec = open_codec(0, NULL, OPJ_TRUE, &stream, &image);
+    if (!codec) {
+        fprintf(stderr, "Cannot open %s\n", tmpfile_name);
+        return 1;
+    }
+    if (!opj_set_decoded_quality_layers(codec, 2) ||
+            !opj_decode(codec, stream, image)) {
+        fprintf(stderr, "Multi-tile: decoding failed\n");
+        ret = 1;
+    } else if (opj_set_decoded_quality_layers(codec, 4)) {
+        fprintf(stderr, "Multi-tile: decoding again accepted\n");
+        ret = 1;
+    }
+    close_codec(codec, stream, image);
+    return ret;
+}
+
+static int test_quality_layers(void)
+{
+    size_t i;
+    int ret = 0;
+
+    for (i = 0; i < sizeof(layers_configs) / sizeof(layers_configs[0]); ++i) {
+        if (!encode_layers_config(&layers_configs[i], OPJ_FALSE)) {
+            fprintf(stderr, "Config %d: encoding failed\n", (int)i);
+            ret = 1;
+        } else if (test_layers_config(&layers_configs[i]) != 0) {
+            fprintf(stderr, "Config %d failed\n", (int)i);
+            ret = 1;
+        } else if (layers_configs[i].prog_order == OPJ_LRCP &&
+                   test_layers_too_late() != 0) {
+            fprintf(stderr, "Config %d: too late change failed\n", (int)i);
+            ret = 1;
+        }
+    }
+    ret |= test_layers_multi_tile();
+    return ret;
+}
+
+/* -------------------------------------------------------------------------- */
+/* progressive_refinement */
+
+typedef struct {
+    /* Whether the 5-3 reversible wavelet is used */
+    OPJ_BOOL reversible;
+    /* Whether only an area of the image is decoded */
+    OPJ_BOOL area;
+} refinement_config_t;
+
+static const refinement_config_t refinement_configs[] = {
+    { OPJ_FALSE, OPJ_FALSE },
+    { OPJ_TRUE, OPJ_FALSE },
+    { OPJ_FALSE, OPJ_TRUE },
+    { OPJ_TRUE, OPJ_TRUE }
+};
+
+/* Resolution factors decoded one after the other. The last one goes back */
+/* to a lower resolution */
+static const OPJ_UINT32 refinement_steps[] = { 4, 3, 2, 1, 0, 2 };
+#define NB_REFINING_STEPS 5
+
+/* Encodes the test image, in 4 tiles if tiled is set */
+static OPJ_BOOL encode_refinement_config(const refinement_config_t *config,
+        OPJ_BOOL tiled)
+{
+    opj_cparameters_t parameters;
+    opj_image_t *image = test_create_image(3, 400, 300, 987);
+    OPJ_BOOL ret;
+
+    opj_set_default_encoder_parameters(&parameters);
+    parameters.cblockw_init = 32;
+    parameters.cblockh_init = 32;
+    parameters.numresolution = 6;
+    parameters.irreversible = config->reversible ? 0 : 1;
+    parameters.tcp_mct = 1;
+    parameters.tcp_numlayers = 1;
+    parameters.tcp_rates[0] = config->reversible ? 0 : 8;
+    parameters.cp_disto_alloc = 1;
+    if (tiled) {
+        parameters.tile_size_on = OPJ_TRUE;
+        parameters.cp_tdx = 200;
+        parameters.cp_tdy = 150;
+    }
+
+    ret = image != NULL && test_encode(OPJ_CODEC_J2K, &parameters, image, NULL,
+                                       tmpfile_name);
+    opj_image_destroy(image);
+    return ret;
+}
+
+static OPJ_BOOL decode_resolution(const refinement_config_t *config,
+                                  opj_codec_t *codec, opj_stream_t *stream,
+                                  opj_image_t *image, OPJ_UINT32 reduce)
+{
+    if (!opj_set_decoded_resolution_factor(codec, reduce)) {
+        return OPJ_FALSE;
+    }
+    if (config->area) {
+        if (!opj_set_decode_area(codec, image, 70, 50, 330, 210)) {
+            return OPJ_FALSE;
+        }
+    } else if (!opj_set_decode_area(codec, image, 0, 0, 0, 0)) {
+        return OPJ_FALSE;
+    }
+    return opj_decode(codec, stream, image);
+}
+
+/* Decodes the steps with one codec. Returns 0 on success */
+static int test_refinement_config(const refinement_config_t *config)
+{
+    opj_stream_t *stream;
+    opj_image_t *image;
+    opj_codec_t *codec = open_codec(0, "PROGRESSIVE_REFINEMENT=YES", OPJ_FALSE,
+                                    &stream, &image);
+    size_t i;
+    int ret = 0;
+
+    if (!codec) {
+        fprintf(stderr, "Cannot open %s\n", tmpfile_name);
+        return 1;
+    }
+    for (i = 0; i < sizeof(refinement_steps) / sizeof(refinement_steps[0]) &&
+            ret == 0; ++i) {
+        opj_stream_t *ref_stream;
+        opj_image_t *ref_image;
+        opj_codec_t *ref_codec = open_codec(0, NULL, OPJ_FALSE, &ref_stream,
+                                            &ref_image);
+        const opj_codec_stats_t *stats;
+        const opj_codec_stats_t *ref_stats;
+
+        if (!ref_codec) {
+            fprintf(stderr, "Cannot open %s\n", tmpfile_name);
+            ret = 1;
+            break;
+        }
+        if (!decode_resolution(config, codec, stream, image,
+                               refinement_steps[i]) ||
+                !decode_resolution(config, ref_codec, ref_stream, ref_image,
+                                   refinement_steps[i])) {
+            fprintf(stderr, "Step %d: decoding failed\n", (int)i);
+            ret = 1;
+        } else if (!test_same_images(image, ref_image)) {
+            fprintf(stderr, "Step %d: images differ\n", (int)i);
+            ret = 1;
+        } else if (i + 1 == NB_REFINING_STEPS) {
+            /* All the code-blocks have been decoded once */
+            stats = opj_codec_get_stats(codec);
+            ref_stats = opj_codec_get_stats(ref_codec);
+            if (stats->codeblocks_decoded != ref_stats->codeblocks_decoded) {
+                fprintf(stderr, "Step %d: %u code-blocks decoded, "
+                        "%u decoded by a new codec\n", (int)i,
+                        (unsigned)stats->codeblocks_decoded,
+                        (unsigned)ref_stats->codeblocks_decoded);
+                ret = 1;
+            }
+        }
+        close_codec(ref_codec, ref_stream, ref_image);
+    }
+    close_codec(codec, stream, image);
+    return ret;
+}
+
+/* The tiles of a multi-tiled image are not kept, so it cannot be decoded */
+/* again. Returns 0 on success */
+static int test_refinement_multi_tile(void)
+{
+    opj_stream_t *stream;
+    opj_image_t *image;
+    opj_codec_t *codec;
+    int ret = 0;
+
+    if (!encode_refinement_config(&refinement_configs[0], OPJ_TRUE)) {
+        fprintf(stderr, "Multi-tile: encoding failed\n");
+        return 1;
+    }
+    codec = open_codec(0, "PROGRESSIVE_REFINEMENT=YES", OPJ_TRUE, &stream,
+                       &image);
+    if (!codec) {
+        fprintf(stderr, "Cannot open %s\n", tmpfile_name);
+        return 1;
+    }
+    if (!decode_resolution(&refinement_configs[0], codec, stream, image, 2)) {
+        fprintf(stderr, "Multi-tile: decoding failed\n");
+        ret = 1;
+    } else if (decode_resolution(&refinement_configs[0], codec, stream, image,
+                                 1) ||
+               opj_decode(codec, stream, image)) {
+        fprintf(stderr, "Multi-tile: decoding again accepted\n");
+        ret = 1;
+    }
+    close_codec(codec, stream, image);
+    return ret;
+}
+
+static int test_progressive_refinement(void)
+{
+    size_t i;
+    int ret = 0;
+
+    for (i = 0; i < sizeof(refinement_configs) / sizeof(refinement_configs[0]);
+            ++i) {
+        if (!encode_refinement_config(&refinement_configs[i], OPJ_FALSE)) {
+            fprintf(stderr, "Config %d: encoding failed\n", (int)i);
+            ret = 1;
+        } else if (test_refinement_config(&refinement_configs[i]) != 0) {
+            fprintf(stderr, "Config %d failed\n", (int)i);
+            ret = 1;
+        }
+    }
+    ret |= test_refinement_multi_tile();
+    return ret;
+}
+
+/* -------------------------------------------------------------------------- */
+
+int main(int argc, char *argv[])
+{
+    int ret;
+
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s cblk_cache|quality_layers|"
+                "progressive_refinement\n", argv[0]);
+        return 1;
+    }
+    sprintf(tmpfile_name, "test_decode_reuse_%.24s_tmp.j2k", argv[1]);
+    if (strcmp(argv[1], "cblk_cache") == 0) {
+        ret = test_cblk_cache();
+    } else if (strcmp(argv[1], "quality_layers") == 0) {
+        ret = test_quality_layers();
+    } else if (strcmp(argv[1], "progressive_refinement") == 0) {
+        ret = test_progressive_refinement();
+    } else {
+        fprintf(stderr, "unknown test %s\n", argv[1]);
+        return 1;
+    }
+
+    remove(tmpfile_name);
+    if (ret == 0) {
+        printf("All tests passed\n");
+    }
+    return ret;
+}
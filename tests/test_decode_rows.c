@@ -0,0 +1,274 @@
+/*
+ * Copyright (c) 2026, OpenJPEG contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS `AS IS'
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Test of opj_decode_rows().
+ *
+ * Images are encoded, decoded with opj_decode() as a reference, then
+ * decoded with opj_decode_rows() for every sample type, both interleaved
+ * and planar. The rows must cover the image in order and hold the
+ * converted reference samples.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "test_common.h"
+
+#define IMAGE_W      300
+#define IMAGE_H      200
+#define TILE_W       64
+#define TILE_H       64
+
+static const char *tmpfile_name = "test_decode_rows_tmp.j2k";
+
+typedef struct {
+    const opj_image_t *ref;
+    OPJ_UINT32 band_height;
+    OPJ_SAMPLE_TYPE type;
+    OPJ_BOOL interleaved;
+    OPJ_UINT32 next_y;
+    OPJ_BOOL failed;
+} rows_check_t;
+
+static int encode(OPJ_UINT32 numcomps, OPJ_UINT32 prec, OPJ_BOOL sgnd,
+                  OPJ_BOOL irreversible)
+{
+    opj_cparameters_t parameters;
+    opj_image_t *image;
+    OPJ_BOOL ok;
+
+    image = test_create_image_ex(numcomps, prec, sgnd, 0, 0, IMAGE_W, IMAGE_H,
+                                 1);
+    if (!image) {
+        return 1;
+    }
+
+    opj_set_default_encoder_parameters(&parameters);
+    parameters.tcp_numlayers = 1;
+    parameters.cp_disto_alloc = 1;
+    parameters.tcp_rates[0] = irreversible ? 4 : 0;
+    parameters.irreversible = irreversible;
+    parameters.tile_size_on = OPJ_TRUE;
+    parameters.cp_tdx = TILE_W;
+    parameters.cp_tdy = TILE_H;
+
+    ok = test_encode(OPJ_CODEC_J2K, &parameters, image, NULL, tmpfile_name);
+    opj_image_destroy(image);
+    return ok ? 0 : 1;
+}
+
+static opj_codec_t *open_decoder(opj_stream_t **p_stream,
+                                 opj_image_t **p_image)
+{
+    opj_codec_t *codec = test_create_decompress(OPJ_CODEC_J2K, NULL, NULL);
+
+    if (codec != NULL &&
+            !test_read_header(codec, tmpfile_name, p_stream, p_image)) {
+        opj_destroy_codec(codec);
+        return NULL;
+    }
+    return codec;
+}
+
+/* Expected value of a reference sample, converted to the type of the rows */
+static double expected_sample(const opj_image_comp_t *comp, OPJ_INT32 v,
+                              OPJ_SAMPLE_TYPE type)
+{
+    OPJ_INT32 min = comp->sgnd ? -(1 << (comp->prec - 1)) : 0;
+    OPJ_INT32 max = comp->sgnd ? (1 << (comp->prec - 1)) - 1 :
+                    (1 << comp->prec) - 1;
+    OPJ_UINT32 bits;
+
+    v = v < min ? min : (v > max ? max : v);
+    switch (type) {
+    case OPJ_SAMPLE_U8:
+    case OPJ_SAMPLE_U16:
+        bits = (type == OPJ_SAMPLE_U8) ? 8 : 16;
+        v -= min;
+        return comp->prec > bits ? (double)(v >> (comp->prec - bits)) : v;
+    case OPJ_SAMPLE_I16:
+        bits = comp->sgnd ? 16 : 15;
+        return comp->prec > bits ? (double)(v >> (comp->prec - bits)) : v;
+    default:
+        return v;
+    }
+}
+
+static double read_sample(const void *p, OPJ_SAMPLE_TYPE type)
+{
+    switch (type) {
+    case OPJ_SAMPLE_U8:
+        return *(const OPJ_BYTE *)p;
+    case OPJ_SAMPLE_U16: {
+        OPJ_UINT16 v;
+        memcpy(&v, p, sizeof(v));
+        return v;
+    }
+    case OPJ_SAMPLE_I16: {
+        OPJ_INT16 v;
+        memcpy(&v, p, sizeof(v));
+        return v;
+    }
+    default: {
+        OPJ_FLOAT32 v;
+        memcpy(&v, p, sizeof(v));
+        return v;
+    }
+    }
+}
+
+static OPJ_BOOL rows_callback(const opj_decoded_rows_t *rows, void *user_data)
+{
+    rows_check_t *check = (rows_check_t *)user_data;
+    const opj_image_t *ref = check->ref;
+    OPJ_UINT32 compno, x, y;
+
+    if (rows->y != check->next_y || rows->h == 0 ||
+            rows->h > check->band_height ||
+            rows->y + rows->h > ref->comps[0].h ||
+            rows->w != ref->comps[0].w || rows->numcomps != ref->numcomps ||
+            rows->type != check->type ||
+            rows->interleaved != check->interleaved) {
+        fprintf(stderr, "Unexpected band %u...%u (expected start: %u)\n",
+                rows->y, rows->y + rows->h, check->next_y);
+        check->failed = OPJ_TRUE;
+        return OPJ_FALSE;
+    }
+    for (compno = 0; compno < rows->numcomps; compno++) {
+        const opj_image_comp_t *comp = &(ref->comps[compno]);
+        for (y = 0; y < rows->h; y++) {
+            for (x = 0; x < rows->w; x++) {
+                const OPJ_BYTE *p = (const OPJ_BYTE *)rows->data +
+                                    y * rows->row_stride + x * rows->sample_stride +
+                                    compno * rows->comp_stride;
+                OPJ_INT32 v = comp->data[(rows->y + y) * comp->w + x];
+                if (read_sample(p, rows->type) !=
+                        expected_sample(comp, v, rows->type)) {
+                    fprintf(stderr, "Mismatch at x=%u, y=%u, compno=%u\n",
+                            x, rows->y + y, compno);
+                    check->failed = OPJ_TRUE;
+                    return OPJ_FALSE;
+                }
+            }
+        }
+    }
+    check->next_y += rows->h;
+    return OPJ_TRUE;
+}
+
+static int check_rows(const opj_image_t *ref, OPJ_UINT32 band_height,
+                      OPJ_SAMPLE_TYPE type, OPJ_BOOL interleaved)
+{
+    opj_codec_t *codec;
+    opj_stream_t *stream;
+    opj_image_t *image = NULL;
+    rows_check_t check;
+    int ret = 1;
+
+    codec = open_decoder(&stream, &image);
+    if (!codec) {
+        return 1;
+    }
+    check.ref = ref;
+    check.band_height = band_height;
+    check.type = type;
+    check.interleaved = interleaved;
+    check.next_y = 0;
+    check.failed = OPJ_FALSE;
+    if (opj_decode_rows(codec, stream, image, band_height, type, interleaved,
+                        rows_callback, &check) &&
+            opj_end_decompress(codec, stream) && !check.failed) {
+        if (check.next_y == ref->comps[0].h) {
+            ret = 0;
+        } else {
+            fprintf(stderr, "Bands end at %u instead of %u\n",
+                    check.next_y, ref->comps[0].h);
+        }
+    }
+    if (ret != 0) {
+        fprintf(stderr, "opj_decode_rows() failed for band_height=%u, "
+                "type=%d, interleaved=%d\n", band_height, (int)type,
+                (int)interleaved);
+    }
+    opj_stream_destroy(stream);
+    opj_destroy_codec(codec);
+    opj_image_destroy(image);
+    return ret;
+}
+
+static int test_image(OPJ_UINT32 numcomps, OPJ_UINT32 prec, OPJ_BOOL sgnd,
+                      OPJ_BOOL irreversible)
+{
+    static const OPJ_UINT32 band_heights[] = { 1, 16, 100000 };
+    opj_codec_t *codec;
+    opj_stream_t *stream;
+    opj_image_t *ref = NULL;
+    int type, interleaved;
+    size_t i;
+    int ret = 0;
+
+    if (encode(numcomps, prec, sgnd, irreversible) != 0) {
+        fprintf(stderr, "encoding failed\n");
+        return 1;
+    }
+    codec = open_decoder(&stream, &ref);
+    if (!codec) {
+        return 1;
+    }
+    if (!opj_decode(codec, stream, ref) ||
+            !opj_end_decompress(codec, stream)) {
+        fprintf(stderr, "reference decoding failed\n");
+        ret = 1;
+    }
+    opj_stream_destroy(stream);
+    opj_destroy_codec(codec);
+
+    for (type = OPJ_SAMPLE_U8; ret == 0 && type <= OPJ_SAMPLE_F32; type++) {
+        for (interleaved = 0; ret == 0 && interleaved <= 1; interleaved++) {
+            for (i = 0; ret == 0 &&
+                    i < sizeof(band_heights) / sizeof(band_heights[0]); i++) {
+                ret = check_rows(ref, band_heights[i], (OPJ_SAMPLE_TYPE)type,
+                                 (OPJ_BOOL)interleaved);
+            }
+        }
+    }
+    opj_image_destroy(ref);
+    remove(tmpfile_name);
+    return ret;
+}
+
+int main(void)
+{
+    if (test_image(3, 8, OPJ_FALSE, OPJ_FALSE) != 0 ||
+            test_image(3, 8, OPJ_FALSE, OPJ_TRUE) != 0 ||
+            test_image(1, 12, OPJ_TRUE, OPJ_FALSE) != 0 ||
+            test_image(2, 16, OPJ_FALSE, OPJ_FALSE) != 0) {
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,391 @@
+/*
+ * Copyright (c) 2026, OpenJPEG contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS `AS IS'
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Test of the HTJ2K block encoder (cblk_sty = 64 / J2K_CCP_CBLKSTY_HT).
+ *
+ * Images are encoded with HT code-blocks of various sizes, with and
+ * without tiles, and decoded back with the HT decoder. Reversible
+ * codestreams must decode to the original samples, irreversible ones must
+ * be close to them, also when only an area is decoded. The codestream must
+ * advertise Part-15 in Rsiz and carry a CAP marker. Rate and quality
+ * targets must be met by truncating the code-blocks.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "test_common.h"
+
+#define IMAGE_W      203
+#define IMAGE_H      117
+
+static const char *tmpfile_name = "test_ht_encode_tmp.j2k";
+
+/* Creates an image made of a smooth gradient, a noisy band and a flat */
+/* area, so that both significant and all-zero code-blocks are coded */
+static opj_image_t *create_test_image(OPJ_UINT32 numcomps, OPJ_UINT32 prec)
+{
+    opj_image_cmptparm_t cmptparm[3];
+    opj_image_t *image;
+    OPJ_UINT32 compno, x, y;
+    OPJ_UINT32 seed = 12345;
+    OPJ_INT32 maxval = (OPJ_INT32)((1U << prec) - 1);
+
+    memset(cmptparm, 0, sizeof(cmptparm));
+    for (compno = 0; compno < numcomps; ++compno) {
+        cmptparm[compno].dx = 1;
+        cmptparm[compno].dy = 1;
+        cmptparm[compno].w = IMAGE_W;
+        cmptparm[compno].h = IMAGE_H;
+        cmptparm[compno].prec = prec;
+    }
+
+    image = opj_image_create(numcomps, cmptparm,
+                             numcomps == 3 ? OPJ_CLRSPC_SRGB : OPJ_CLRSPC_GRAY);
+    if (!image) {
+        return NULL;
+    }
+    image->x1 = IMAGE_W;
+    image->y1 = IMAGE_H;
+
+    for (compno = 0; compno < numcomps; ++compno) {
+        for (y = 0; y < IMAGE_H; ++y) {
+            for (x = 0; x < IMAGE_W; ++x) {
+                OPJ_INT32 v;
+                if (y < IMAGE_H / 3) {
+                    v = (OPJ_INT32)((((x + compno * 17) % IMAGE_W) *
+                                     (OPJ_UINT32)maxval) / IMAGE_W);
+                } else if (y < 2 * IMAGE_H / 3) {
+                    seed = seed * 1103515245U + 12345U;
+                    v = (OPJ_INT32)((seed >> 8) & (OPJ_UINT32)maxval);
+                } else {
+                    v = maxval / 2;
+                }
+                image->comps[compno].data[y * IMAGE_W + x] = v;
+            }
+        }
+    }
+    return image;
+}
+
+static int encode(opj_image_t *image, int irreversible, int cblk_size,
+                  int tile_size)
+{
+    opj_cparameters_t parameters;
+
+    opj_set_default_encoder_parameters(&parameters);
+    parameters.mode = 64;
+    parameters.irreversible = irreversible;
+    parameters.cblockw_init = cblk_size;
+    parameters.cblockh_init = cblk_size;
+    if (tile_size) {
+        parameters.tile_size_on = OPJ_TRUE;
+        parameters.cp_tdx = tile_size;
+        parameters.cp_tdy = tile_size;
+    }
+    return test_encode(OPJ_CODEC_J2K, &parameters, image, NULL,
+                       tmpfile_name) ? 0 : 1;
+}
+
+/* Checks that Rsiz has the Part-15 bit and that a CAP marker follows SIZ */
+static int check_main_header(void)
+{
+    unsigned char buf[512];
+    size_t len, pos;
+    FILE *f = fopen(tmpfile_name, "rb");
+
+    if (!f) {
+        return 1;
+    }
+    len = fread(buf, 1, sizeof(buf), f);
+    fclose(f);
+    if (len < 8 || buf[0] != 0xff || buf[1] != 0x4f ||
+            buf[2] != 0xff || buf[3] != 0x51) {
+        return 1;
+    }
+    if (!(((buf[6] << 8) | buf[7]) & 0x4000)) {
+        fprintf(stderr, "Rsiz does not advertise Part-15\n");
+        return 1;
+    }
+    pos = 4 + (size_t)((buf[4] << 8) | buf[5]);
+    if (pos + 2 > len || buf[pos] != 0xff || buf[pos + 1] != 0x50) {
+        fprintf(stderr, "missing CAP marker\n");
+        return 1;
+    }
+    return 0;
+}
+
+/* Returns the PSNR of b against a, or 1000 if they are identical */
+static double psnr(const opj_image_t *a, const opj_image_t *b)
+{
+    OPJ_UINT32 compno;
+    size_t i, n = 0;
+    double sse = 0, maxval;
+
+    for (compno = 0; compno < a->numcomps; ++compno) {
+        size_t count = (size_t)a->comps[compno].w * a->comps[compno].h;
+        for (i = 0; i < count; ++i) {
+            double d = (double)a->comps[compno].data[i] -
+                       (double)b->comps[compno].data[i];
+            sse += d * d;
+        }
+        n += count;
+    }
+    if (sse == 0) {
+        return 1000;
+    }
+    maxval = (double)((1U << a->comps[0].prec) - 1);
+    return 10 * log10(maxval * maxval * (double)n / sse);
+}
+
+/* Decodes the area (x0, y0, x1, y1) of the encoded file and checks that */
+/* it matches the same area of the whole decoded image */
+static int check_area(const opj_image_t *decoded, OPJ_UINT32 x0,
+                      OPJ_UINT32 y0, OPJ_UINT32 x1, OPJ_UINT32 y1)
+{
+    opj_codec_t *codec = test_create_decompress(OPJ_CODEC_J2K, NULL, NULL);
+    opj_stream_t *stream = NULL;
+    opj_image_t *area = NULL;
+    OPJ_UINT32 compno, y;
+    int ret = 1;
+
+    if (codec && test_read_header(codec, tmpfile_name, &stream, &area) &&
+            opj_set_decode_area(codec, area, (OPJ_INT32)x0, (OPJ_INT32)y0,
+                                (OPJ_INT32)x1, (OPJ_INT32)y1) &&
+            opj_decode(codec, stream, area) &&
+            opj_end_decompress(codec, stream)) {
+        ret = 0;
+        for (compno = 0; ret == 0 && compno < area->numcomps; ++compno) {
+            const opj_image_comp_t *comp = &area->comps[compno];
+            if (comp->w != x1 - x0 || comp->h != y1 - y0) {
+                ret = 1;
+            }
+            for (y = 0; ret == 0 && y < comp->h; ++y) {
+                if (memcmp(comp->data + (size_t)y * comp->w,
+                           decoded->comps[compno].data +
+                           (size_t)(y0 + y) * IMAGE_W + x0,
+                           comp->w * sizeof(OPJ_INT32)) != 0) {
+                    ret = 1;
+                }
+            }
+        }
+    }
+    if (ret) {
+        fprintf(stderr, "decoding of the area %u,%u,%u,%u differs\n",
+                x0, y0, x1, y1);
+    }
+    opj_stream_destroy(stream);
+    opj_destroy_codec(codec);
+    opj_image_destroy(area);
+    return ret;
+}
+
+static int test_round_trip(OPJ_UINT32 numcomps, OPJ_UINT32 prec,
+                           int irreversible, int cblk_size, int tile_size)
+{
+    opj_image_t *image, *decoded;
+    OPJ_UINT32 compno;
+    double p;
+    int ret = 1;
+
+    image = create_test_image(numcomps, prec);
+    if (!image) {
+        return 1;
+    }
+    if (encode(image, irreversible, cblk_size, tile_size) != 0) {
+        fprintf(stderr, "encoding failed\n");
+    } else if (opj_image_destroy(image),
+               (image = create_test_image(numcomps, prec)) == NULL) {
+        /* the encoder may release the sample buffers it consumed */
+        return 1;
+    } else if (check_main_header() != 0) {
+        fprintf(stderr, "invalid main header\n");
+    } else if ((decoded = test_decode_file(tmpfile_name,
+                                           OPJ_CODEC_J2K)) == NULL) {
+        fprintf(stderr, "decoding failed\n");
+    } else {
+        ret = 0;
+        if (decoded->numcomps != numcomps) {
+            ret = 1;
+        }
+        for (compno = 0; ret == 0 && compno < numcomps; ++compno) {
+            if (decoded->comps[compno].w != IMAGE_W ||
+                    decoded->comps[compno].h != IMAGE_H) {
+                ret = 1;
+            }
+        }
+        if (ret == 0) {
+            p = psnr(image, decoded);
+            if (irreversible ? p < 30 : p != 1000) {
+                fprintf(stderr, "unexpected PSNR %.2f\n", p);
+                ret = 1;
+            }
+        }
+        if (ret == 0) {
+            ret = check_area(decoded, 37, 21, 150, 101);
+        }
+        opj_image_destroy(decoded);
+    }
+    if (ret) {
+        fprintf(stderr, "failure with numcomps=%u prec=%u irreversible=%d "
+                "cblk=%d tile=%d\n", numcomps, prec, irreversible,
+                cblk_size, tile_size);
+    }
+    opj_image_destroy(image);
+    return ret;
+}
+
+/* Encodes a 3-component image with a single layer, with a compression */
+/* ratio if rate > 0, or a PSNR target otherwise, and checks that the */
+/* target is met */
+static int test_rate_control(int irreversible, float rate, float quality)
+{
+    opj_cparameters_t parameters;
+    opj_image_t *image, *decoded = NULL;
+    const size_t raw_size = (size_t)IMAGE_W * IMAGE_H * 3;
+    size_t size = 0;
+    double p = 0;
+    int ret = 1;
+
+    opj_set_default_encoder_parameters(&parameters);
+    parameters.mode = 64;
+    parameters.irreversible = irreversible;
+    parameters.tcp_numlayers = 1;
+    if (rate > 0) {
+        parameters.tcp_rates[0] = rate;
+        parameters.cp_disto_alloc = 1;
+    } else {
+        parameters.tcp_distoratio[0] = quality;
+        parameters.cp_fixed_quality = 1;
+    }
+
+    image = create_test_image(3, 8);
+    if (image && test_encode(OPJ_CODEC_J2K, &parameters, image, NULL,
+                             tmpfile_name)) {
+        opj_image_destroy(image);
+        image = create_test_image(3, 8);
+        decoded = test_decode_file(tmpfile_name, OPJ_CODEC_J2K);
+        size = (size_t)test_file_size(tmpfile_name);
+    }
+    if (image && decoded) {
+        p = psnr(image, decoded);
+        /* Truncated code-blocks are needed to meet the targets */
+        if (rate > 0 ? size <= (size_t)((float)raw_size / rate) :
+                (p >= quality - 0.5 && p < quality + 3)) {
+            ret = 0;
+        }
+    }
+    if (ret) {
+        fprintf(stderr, "rate control failure with irreversible=%d "
+                "rate=%.1f quality=%.1f: %u bytes, PSNR %.2f\n", irreversible,
+                rate, quality, (unsigned)size, p);
+    }
+    opj_image_destroy(decoded);
+    opj_image_destroy(image);
+    return ret;
+}
+
+/* Returns 0 if opj_setup_encoder() rejects the parameters */
+static int check_rejected(opj_cparameters_t *parameters, const char *what)
+{
+    opj_codec_t *codec;
+    opj_image_t *image;
+    OPJ_BOOL ok;
+
+    image = create_test_image(1, 8);
+    if (!image) {
+        return 1;
+    }
+    codec = opj_create_compress(OPJ_CODEC_J2K);
+    test_set_handlers(codec, OPJ_TRUE);
+    ok = opj_setup_encoder(codec, parameters, image);
+    opj_destroy_codec(codec);
+    opj_image_destroy(image);
+    if (ok) {
+        fprintf(stderr, "HT combined with %s was accepted\n", what);
+        return 1;
+    }
+    return 0;
+}
+
+/* HT cannot be combined with the other code-block styles, with fixed */
+/* layer allocation, nor with several layers with rate or quality targets */
+static int test_invalid_parameters(void)
+{
+    opj_cparameters_t parameters;
+    int ret = 0;
+
+    opj_set_default_encoder_parameters(&parameters);
+    parameters.mode = 64 | 1;
+    ret |= check_rejected(&parameters, "BYPASS");
+
+    opj_set_default_encoder_parameters(&parameters);
+    parameters.mode = 64;
+    parameters.tcp_numlayers = 2;
+    parameters.tcp_rates[0] = 20;
+    parameters.tcp_rates[1] = 0;
+    parameters.cp_disto_alloc = 1;
+    ret |= check_rejected(&parameters, "several rate layers");
+
+    opj_set_default_encoder_parameters(&parameters);
+    parameters.mode = 64;
+    parameters.tcp_numlayers = 2;
+    parameters.tcp_distoratio[0] = 30;
+    parameters.tcp_distoratio[1] = 40;
+    parameters.cp_fixed_quality = 1;
+    ret |= check_rejected(&parameters, "several quality layers");
+
+    opj_set_default_encoder_parameters(&parameters);
+    parameters.mode = 64;
+    parameters.tcp_numlayers = 1;
+    parameters.cp_fixed_alloc = 1;
+    ret |= check_rejected(&parameters, "fixed layer allocation");
+
+    return ret;
+}
+
+int main(void)
+{
+    int ret = 0;
+
+    ret |= test_round_trip(1, 8, 0, 64, 0);
+    ret |= test_round_trip(3, 8, 0, 32, 64);
+    ret |= test_round_trip(1, 8, 0, 4, 0);
+    ret |= test_round_trip(1, 16, 0, 16, 64);
+    ret |= test_round_trip(3, 8, 1, 64, 0);
+    ret |= test_round_trip(1, 12, 1, 8, 64);
+    ret |= test_rate_control(1, 20, 0);
+    ret |= test_rate_control(0, 8, 0);
+    ret |= test_rate_control(1, 0, 35);
+    ret |= test_rate_control(0, 0, 30);
+    ret |= test_invalid_parameters();
+
+    remove(tmpfile_name);
+    return ret;
+}
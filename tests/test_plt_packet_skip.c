@@ -0,0 +1,248 @@
+/*
+ * Copyright (c) 2026, OpenJPEG contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS `AS IS'
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Test of the skipping of packets with the lengths of PLT markers.
+ *
+ * Images are encoded with and without PLT markers, and decoded with a
+ * reduced resolution, fewer quality layers and/or a decoding area. The
+ * decoded images must be the same, whether packets are skipped by parsing
+ * their header or by using their length. When only the first layers of a
+ * tile made of a single LRCP tile-part are decoded, the packets of the
+ * other layers must not be read.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "test_common.h"
+
+#define IMAGE_W     257
+#define IMAGE_H     193
+#define NB_COMPS    3
+
+typedef struct {
+    /* 0 for a single tile */
+    int tile_w;
+    int tile_h;
+    OPJ_PROG_ORDER prog_order;
+    /* Tile-part division: 0, 'R', 'L' or 'C' */
+    char tp_flag;
+    /* Whether SOP and EPH markers are written */
+    OPJ_BOOL sop_eph;
+} config_t;
+
+static const config_t configs[] = {
+    { 0, 0, OPJ_LRCP, 0, OPJ_FALSE },
+    { 64, 64, OPJ_RPCL, 'R', OPJ_FALSE },
+    { 128, 96, OPJ_LRCP, 'L', OPJ_FALSE },
+    { 100, 100, OPJ_CPRL, 0, OPJ_TRUE }
+};
+
+typedef struct {
+    OPJ_UINT32 reduce;
+    /* 0 to decode all the layers */
+    OPJ_UINT32 layers;
+    /* Decoding area, or 0,0,0,0 for the whole image */
+    OPJ_INT32 x0, y0, x1, y1;
+    int num_threads;
+} decode_params_t;
+
+static const decode_params_t decode_params[] = {
+    { 0, 1, 0, 0, 0, 0, 0 },
+    { 0, 2, 0, 0, 0, 0, 0 },
+    { 1, 0, 0, 0, 0, 0, 0 },
+    { 2, 2, 0, 0, 0, 0, 0 },
+    { 0, 0, 70, 30, 150, 110, 0 },
+    { 1, 1, 10, 90, 200, 180, 0 },
+    { 0, 2, 70, 30, 150, 110, 2 },
+    { 0, 0, 0, 0, 0, 0, 4 },
+    { 1, 2, 0, 0, 0, 0, 3 }
+};
+
+/* Encodes the test image to a file. Returns OPJ_FALSE in case of failure */
+static OPJ_BOOL encode(const config_t *config, OPJ_BOOL plt, const char *name)
+{
+    opj_cparameters_t parameters;
+    opj_image_t *image = test_create_image(NB_COMPS, IMAGE_W, IMAGE_H, 1234);
+    const char* options[2] = { NULL, NULL };
+    OPJ_BOOL ret;
+
+    opj_set_default_encoder_parameters(&parameters);
+    if (config->tile_w) {
+        parameters.tile_size_on = OPJ_TRUE;
+        parameters.cp_tdx = config->tile_w;
+        parameters.cp_tdy = config->tile_h;
+    }
+    /* Small precincts, so that there are many packets */
+    parameters.csty |= 0x01;
+    parameters.res_spec = 1;
+    parameters.prcw_init[0] = 32;
+    parameters.prch_init[0] = 32;
+    parameters.cblockw_init = 16;
+    parameters.cblockh_init = 16;
+    parameters.numresolution = 4;
+    parameters.prog_order = config->prog_order;
+    parameters.tcp_mct = 1;
+    parameters.tcp_numlayers = 3;
+    parameters.tcp_rates[0] = 40;
+    parameters.tcp_rates[1] = 12;
+    parameters.tcp_rates[2] = 4;
+    parameters.cp_disto_alloc = 1;
+    if (config->tp_flag) {
+        parameters.tp_on = 1;
+        parameters.tp_flag = config->tp_flag;
+    }
+    if (config->sop_eph) {
+        parameters.csty |= 0x02 | 0x04;
+    }
+    if (plt) {
+        options[0] = "PLT=YES";
+    }
+
+    ret = image != NULL && test_encode(OPJ_CODEC_J2K, &parameters, image,
+                                       options, name);
+    opj_image_destroy(image);
+    return ret;
+}
+
+/* Decodes a file, from a file stream or from memory. The number of bytes */
+/* of compressed tile data read is returned in p_bytes_read. Returns NULL */
+/* in case of failure */
+static opj_image_t* decode(const char *name, OPJ_BOOL from_memory,
+                           const decode_params_t *params,
+                           OPJ_UINT64 *p_bytes_read)
+{
+    opj_dparameters_t parameters;
+    opj_codec_t *codec;
+    opj_stream_t *stream = NULL;
+    opj_image_t *image = NULL;
+    OPJ_BYTE *data = NULL;
+    OPJ_SIZE_T size = 0;
+    OPJ_BOOL ok = OPJ_FALSE;
+
+    if (from_memory) {
+        data = test_read_file(name, &size);
+        if (data) {
+            stream = opj_stream_create_memory_stream(data, size);
+        }
+    } else {
+        stream = opj_stream_create_default_file_stream(name, OPJ_TRUE);
+    }
+    if (!stream) {
+        free(data);
+        return NULL;
+    }
+    opj_set_default_decoder_parameters(&parameters);
+    parameters.cp_reduce = params->reduce;
+    parameters.cp_layer = params->layers;
+    codec = test_create_decompress(OPJ_CODEC_J2K, &parameters, NULL);
+    if (codec &&
+            opj_codec_set_threads(codec, params->num_threads) &&
+            opj_codec_enable_stats(codec, OPJ_TRUE) &&
+            opj_read_header(stream, codec, &image) &&
+            opj_set_decode_area(codec, image, params->x0, params->y0,
+                                params->x1, params->y1) &&
+            opj_decode(codec, stream, image) &&
+            opj_end_decompress(codec, stream)) {
+        const opj_codec_stats_t *stats = opj_codec_get_stats(codec);
+        OPJ_UINT32 i;
+
+        *p_bytes_read = 0;
+        for (i = 0; i < stats->nb_tiles; ++i) {
+            *p_bytes_read += stats->tiles[i].bytes_read;
+        }
+        ok = OPJ_TRUE;
+    }
+    opj_destroy_codec(codec);
+    opj_stream_destroy(stream);
+    free(data);
+    if (!ok) {
+        opj_image_destroy(image);
+        return NULL;
+    }
+    return image;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *ref_name = "test_plt_packet_skip_tmp0.j2k";
+    const char *plt_name = "test_plt_packet_skip_tmp1.j2k";
+    size_t i, j;
+    int ret = 0;
+
+    (void)argc;
+    (void)argv;
+
+    for (i = 0; i < sizeof(configs) / sizeof(configs[0]); ++i) {
+        const config_t *config = &configs[i];
+
+        if (!encode(config, OPJ_FALSE, ref_name) ||
+                !encode(config, OPJ_TRUE, plt_name)) {
+            fprintf(stderr, "Config %d: encoding failed\n", (int)i);
+            ret = 1;
+            continue;
+        }
+        for (j = 0; j < sizeof(decode_params) / sizeof(decode_params[0]); ++j) {
+            const decode_params_t *params = &decode_params[j];
+            OPJ_UINT64 ref_bytes = 0, plt_bytes = 0, mem_bytes = 0;
+            opj_image_t *ref = decode(ref_name, OPJ_FALSE, params, &ref_bytes);
+            opj_image_t *plt = decode(plt_name, OPJ_FALSE, params, &plt_bytes);
+            opj_image_t *mem = decode(plt_name, OPJ_TRUE, params, &mem_bytes);
+
+            if (!ref || !plt || !mem) {
+                fprintf(stderr, "Config %d, decoding %d: decoding failed\n",
+                        (int)i, (int)j);
+                ret = 1;
+            } else if (!test_same_images(ref, plt) || !test_same_images(ref, mem)) {
+                fprintf(stderr, "Config %d, decoding %d: images differ\n",
+                        (int)i, (int)j);
+                ret = 1;
+            } else if (plt_bytes != mem_bytes || plt_bytes > ref_bytes ||
+                       (config->tile_w == 0 && params->layers != 0 &&
+                        plt_bytes >= ref_bytes)) {
+                /* Only the tile made of a single LRCP tile-part is read */
+                /* partially */
+                fprintf(stderr, "Config %d, decoding %d: %u bytes read with PLT, "
+                        "%u from memory, %u without\n", (int)i, (int)j,
+                        (unsigned)plt_bytes, (unsigned)mem_bytes,
+                        (unsigned)ref_bytes);
+                ret = 1;
+            }
+            opj_image_destroy(ref);
+            opj_image_destroy(plt);
+            opj_image_destroy(mem);
+        }
+    }
+
+    remove(ref_name);
+    remove(plt_name);
+    if (ret == 0) {
+        printf("All tests passed\n");
+    }
+    return ret;
+}
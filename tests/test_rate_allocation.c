@@ -0,0 +1,176 @@
+/*
+ * Copyright (c) 2026, OpenJPEG contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS `AS IS'
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Test of the rate allocation of the encoder.
+ *
+ * Images are encoded with quality layers allocated by rate or by fixed
+ * quality, for all progression orders, with and without tiles, precincts
+ * and SOP/EPH markers. The codestreams encoded with several threads, whose
+ * rate allocation processes the components in parallel, must be identical
+ * to the ones encoded with a single thread, and the rate targets must be
+ * satisfied.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "test_common.h"
+
+#define IMAGE_W     333
+#define IMAGE_H     251
+#define NB_COMPS    3
+
+typedef struct {
+    OPJ_PROG_ORDER prog_order;
+    /* Whether the layers are allocated by fixed quality instead of by rate */
+    OPJ_BOOL fixed_quality;
+    int numlayers;
+    float targets[4];
+    OPJ_BOOL tiles;
+    OPJ_BOOL precincts;
+    OPJ_BOOL sop_eph;
+} config_t;
+
+static const config_t configs[] = {
+    { OPJ_LRCP, OPJ_FALSE, 3, { 40, 20, 10, 0 }, OPJ_FALSE, OPJ_FALSE, OPJ_FALSE },
+    { OPJ_RLCP, OPJ_FALSE, 4, { 80, 30, 12, 5 }, OPJ_FALSE, OPJ_FALSE, OPJ_TRUE },
+    { OPJ_RPCL, OPJ_FALSE, 3, { 50, 20, 8, 0 }, OPJ_TRUE, OPJ_TRUE, OPJ_FALSE },
+    { OPJ_PCRL, OPJ_FALSE, 2, { 25, 6, 0, 0 }, OPJ_FALSE, OPJ_TRUE, OPJ_TRUE },
+    { OPJ_CPRL, OPJ_FALSE, 3, { 60, 15, 0, 0 }, OPJ_TRUE, OPJ_FALSE, OPJ_FALSE },
+    { OPJ_LRCP, OPJ_TRUE, 3, { 28, 34, 40, 0 }, OPJ_FALSE, OPJ_FALSE, OPJ_FALSE },
+    { OPJ_RPCL, OPJ_TRUE, 2, { 30, 0, 0, 0 }, OPJ_TRUE, OPJ_TRUE, OPJ_TRUE }
+};
+
+/* Encodes the test image to a file. Returns the size of the codestream, */
+/* or 0 in case of failure */
+static OPJ_SIZE_T encode(const config_t *config, int nb_threads,
+                         const char *name)
+{
+    opj_cparameters_t parameters;
+    opj_image_t *image;
+    opj_codec_t *codec;
+    OPJ_BOOL ok = OPJ_FALSE;
+    int layno;
+
+    opj_set_default_encoder_parameters(&parameters);
+    parameters.prog_order = config->prog_order;
+    parameters.tcp_numlayers = config->numlayers;
+    for (layno = 0; layno < config->numlayers; ++layno) {
+        if (config->fixed_quality) {
+            parameters.tcp_distoratio[layno] = config->targets[layno];
+        } else {
+            parameters.tcp_rates[layno] = config->targets[layno];
+        }
+    }
+    if (config->fixed_quality) {
+        parameters.cp_fixed_quality = 1;
+    } else {
+        parameters.cp_disto_alloc = 1;
+    }
+    parameters.irreversible = 1;
+    parameters.tcp_mct = 1;
+    if (config->tiles) {
+        parameters.tile_size_on = OPJ_TRUE;
+        parameters.cp_tdx = 128;
+        parameters.cp_tdy = 96;
+    }
+    if (config->precincts) {
+        parameters.csty |= 0x01;
+        parameters.res_spec = 2;
+        parameters.prcw_init[0] = 64;
+        parameters.prch_init[0] = 64;
+        parameters.prcw_init[1] = 32;
+        parameters.prch_init[1] = 32;
+    }
+    if (config->sop_eph) {
+        parameters.csty |= 0x02 | 0x04;
+    }
+    parameters.cblockw_init = 32;
+    parameters.cblockh_init = 32;
+
+    image = test_create_image(NB_COMPS, IMAGE_W, IMAGE_H, 12345);
+    if (!image) {
+        return 0;
+    }
+    codec = test_create_compress(OPJ_CODEC_J2K, &parameters, image, NULL);
+    if (codec != NULL) {
+        ok = opj_codec_set_threads(codec, nb_threads) &&
+             test_compress(codec, image, name);
+    }
+    opj_destroy_codec(codec);
+    opj_image_destroy(image);
+    return ok ? test_file_size(name) : 0;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *ref_name = "test_rate_allocation_tmp0.j2k";
+    const char *name = "test_rate_allocation_tmp1.j2k";
+    size_t i;
+    int ret = 0;
+
+    (void)argc;
+    (void)argv;
+
+    for (i = 0; i < sizeof(configs) / sizeof(configs[0]); ++i) {
+        const config_t *config = &configs[i];
+        OPJ_SIZE_T ref_size = encode(config, 0, ref_name);
+        OPJ_SIZE_T size = encode(config, 4, name);
+
+        if (ref_size == 0 || size == 0) {
+            fprintf(stderr, "Config %d: encoding failed\n", (int)i);
+            ret = 1;
+            continue;
+        }
+        if (!test_same_files(ref_name, name)) {
+            fprintf(stderr, "Config %d: codestreams differ with 4 threads\n",
+                    (int)i);
+            ret = 1;
+        }
+        if (!config->fixed_quality &&
+                config->targets[config->numlayers - 1] > 0) {
+            /* The rate target of the last layer bounds the size of the */
+            /* codestream. The size of the headers is only estimated by */
+            /* the encoder, hence a tolerance of 1% */
+            OPJ_SIZE_T max_size = (OPJ_SIZE_T)(1.01 * IMAGE_W * IMAGE_H * NB_COMPS /
+                                               config->targets[config->numlayers - 1]);
+            if (ref_size > max_size) {
+                fprintf(stderr, "Config %d: %u bytes for a target of %u bytes\n",
+                        (int)i, (unsigned)ref_size, (unsigned)max_size);
+                ret = 1;
+            }
+        }
+    }
+
+    remove(ref_name);
+    remove(name);
+    if (ret == 0) {
+        printf("All tests passed\n");
+    }
+    return ret;
+}
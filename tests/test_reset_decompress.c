@@ -0,0 +1,275 @@
+/*
+ * Copyright (c) 2026, OpenJPEG contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS `AS IS'
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Test of opj_reset_decompress().
+ *
+ * A sequence of frames is decoded with a single decompressor, reset between
+ * frames: two frames sharing their main header, the first one decoded for an
+ * area only, then a grayscale frame of another size. The decoded samples
+ * must be the ones obtained with a decompressor per frame. The second frame
+ * must not allocate any coding structure, its tile decoder being the one of
+ * the first frame, and everything must have been freed once the
+ * decompressor is destroyed.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "test_common.h"
+
+#define NB_FRAMES    3
+#define TILE_W       128
+#define TILE_H       128
+
+typedef struct {
+    OPJ_UINT32 numcomps;
+    OPJ_UINT32 w;
+    OPJ_UINT32 h;
+    OPJ_UINT32 seed;
+    /* Area to decode, or 0,0,0,0 for the whole frame */
+    OPJ_INT32 area[4];
+} frame_t;
+
+static const frame_t frames[NB_FRAMES] = {
+    { 3, 300, 200, 1, { 40, 30, 250, 170 } },
+    { 3, 300, 200, 2, { 0, 0, 0, 0 } },
+    { 1, 150, 260, 3, { 0, 0, 0, 0 } }
+};
+
+typedef struct {
+    int nb_allocs;
+    int nb_frees;
+} counting_allocator_t;
+
+static void* counting_alloc(OPJ_SIZE_T size, void *user_data)
+{
+    counting_allocator_t *counter = (counting_allocator_t *)user_data;
+    counter->nb_allocs ++;
+    return malloc(size);
+}
+
+static void counting_free(void *ptr, void *user_data)
+{
+    counting_allocator_t *counter = (counting_allocator_t *)user_data;
+    if (ptr) {
+        counter->nb_frees ++;
+        free(ptr);
+    }
+}
+
+static void get_filename(char *name, OPJ_CODEC_FORMAT format, int frameno)
+{
+    sprintf(name, "test_reset_decompress_tmp%d.%s", frameno,
+            format == OPJ_CODEC_JP2 ? "jp2" : "j2k");
+}
+
+static int encode(OPJ_CODEC_FORMAT format, OPJ_BOOL ht, int frameno)
+{
+    const frame_t *frame = &frames[frameno];
+    opj_cparameters_t parameters;
+    opj_image_t *image;
+    opj_codec_t *codec;
+    char name[64];
+    int ret = 1;
+
+    image = test_create_image(frame->numcomps, frame->w, frame->h,
+                              frame->seed);
+    if (!image) {
+        return 1;
+    }
+
+    opj_set_default_encoder_parameters(&parameters);
+    parameters.tcp_numlayers = 1;
+    parameters.cp_disto_alloc = 1;
+    parameters.tcp_rates[0] = 0;
+    parameters.tcp_mct = frame->numcomps == 3 ? 1 : 0;
+    parameters.tile_size_on = OPJ_TRUE;
+    parameters.cp_tdx = TILE_W;
+    parameters.cp_tdy = TILE_H;
+    parameters.cblockw_init = 16;
+    parameters.cblockh_init = 16;
+    if (ht) {
+        parameters.mode = 64;
+    }
+
+    get_filename(name, format, frameno);
+    codec = test_create_compress(format, &parameters, image, NULL);
+    if (codec != NULL) {
+        if (opj_reset_decompress(codec)) {
+            fprintf(stderr, "Compressor reset\n");
+        } else if (test_compress(codec, image, name)) {
+            ret = 0;
+        }
+    }
+    opj_destroy_codec(codec);
+    opj_image_destroy(image);
+    return ret;
+}
+
+/* Decodes a frame with codec, which is reset first if reset is set */
+static opj_image_t* decode(opj_codec_t *codec, OPJ_BOOL reset,
+                           OPJ_CODEC_FORMAT format, int frameno)
+{
+    const frame_t *frame = &frames[frameno];
+    opj_stream_t *stream;
+    opj_image_t *image = NULL;
+    char name[64];
+    OPJ_BOOL ok = OPJ_FALSE;
+
+    get_filename(name, format, frameno);
+    stream = opj_stream_create_default_file_stream(name, OPJ_TRUE);
+    if (!stream) {
+        return NULL;
+    }
+    if ((!reset || opj_reset_decompress(codec)) &&
+            opj_read_header(stream, codec, &image)) {
+        ok = (frame->area[2] == 0 ||
+              opj_set_decode_area(codec, image, frame->area[0], frame->area[1],
+                                  frame->area[2], frame->area[3])) &&
+             opj_decode(codec, stream, image) &&
+             opj_end_decompress(codec, stream);
+    }
+    opj_stream_destroy(stream);
+    if (!ok) {
+        opj_image_destroy(image);
+        return NULL;
+    }
+    return image;
+}
+
+static opj_codec_t* create_decompress(OPJ_CODEC_FORMAT format, int nb_threads,
+                                      counting_allocator_t *counter)
+{
+    opj_codec_t *codec;
+    opj_allocator_t allocator;
+
+    codec = test_create_decompress(format, NULL, NULL);
+    if (!codec) {
+        return NULL;
+    }
+    allocator.alloc_fn = counting_alloc;
+    allocator.free_fn = counting_free;
+    allocator.user_data = counter;
+    if (!opj_codec_set_threads(codec, nb_threads) ||
+            (counter != NULL && !opj_codec_set_allocator(codec, &allocator))) {
+        opj_destroy_codec(codec);
+        return NULL;
+    }
+    return codec;
+}
+
+static int test_sequence(OPJ_CODEC_FORMAT format, OPJ_BOOL ht, int nb_threads)
+{
+    counting_allocator_t counter;
+    opj_codec_t *codec;
+    int nb_allocs[NB_FRAMES];
+    int frameno;
+    int ret = 0;
+    char name[64];
+
+    sprintf(name, "%s %s threads=%d", format == OPJ_CODEC_JP2 ? "JP2" : "J2K",
+            ht ? "HT" : "MQ", nb_threads);
+
+    memset(&counter, 0, sizeof(counter));
+    codec = create_decompress(format, nb_threads, &counter);
+    if (!codec) {
+        fprintf(stderr, "%s: cannot create the decompressor\n", name);
+        return 1;
+    }
+    for (frameno = 0; frameno < NB_FRAMES; ++frameno) {
+        opj_codec_t *ref_codec = create_decompress(format, nb_threads, NULL);
+        opj_image_t *ref = ref_codec ? decode(ref_codec, OPJ_FALSE, format,
+                                              frameno) : NULL;
+        opj_image_t *image = decode(codec, frameno > 0, format, frameno);
+        if (!ref || !image) {
+            fprintf(stderr, "%s: decoding of frame %d failed\n", name, frameno);
+            ret = 1;
+        } else if (!test_same_images(ref, image)) {
+            fprintf(stderr, "%s: decoded frame %d differs\n", name, frameno);
+            ret = 1;
+        }
+        nb_allocs[frameno] = counter.nb_allocs;
+        opj_image_destroy(ref);
+        opj_image_destroy(image);
+        opj_destroy_codec(ref_codec);
+        if (ret) {
+            break;
+        }
+    }
+    if (ret == 0 && opj_codec_set_threads(codec, 1)) {
+        fprintf(stderr, "%s: threads changed after a reset\n", name);
+        ret = 1;
+    }
+    if (ret == 0 && nb_allocs[1] != nb_allocs[0]) {
+        fprintf(stderr, "%s: %d allocations for the second frame\n", name,
+                nb_allocs[1] - nb_allocs[0]);
+        ret = 1;
+    }
+    opj_destroy_codec(codec);
+    if (counter.nb_frees != counter.nb_allocs) {
+        fprintf(stderr, "%s: %d blocks not freed\n", name,
+                counter.nb_allocs - counter.nb_frees);
+        ret = 1;
+    }
+    return ret;
+}
+
+int main(int argc, char *argv[])
+{
+    int ret = 0;
+    int ht, frameno;
+    char name[64];
+
+    (void)argc;
+    (void)argv;
+
+    for (ht = 0; ht <= 1; ++ht) {
+        for (frameno = 0; frameno < NB_FRAMES; ++frameno) {
+            if (encode(OPJ_CODEC_J2K, ht, frameno) != 0 ||
+                    encode(OPJ_CODEC_JP2, ht, frameno) != 0) {
+                fprintf(stderr, "Encoding failed\n");
+                return 1;
+            }
+        }
+        ret |= test_sequence(OPJ_CODEC_J2K, ht, 0);
+        ret |= test_sequence(OPJ_CODEC_J2K, ht, 2);
+        ret |= test_sequence(OPJ_CODEC_JP2, ht, 0);
+        ret |= test_sequence(OPJ_CODEC_JP2, ht, 2);
+    }
+
+    for (frameno = 0; frameno < NB_FRAMES; ++frameno) {
+        get_filename(name, OPJ_CODEC_J2K, frameno);
+        remove(name);
+        get_filename(name, OPJ_CODEC_JP2, frameno);
+        remove(name);
+    }
+    if (ret == 0) {
+        printf("All tests passed\n");
+    }
+    return ret;
+}
@@ -0,0 +1,255 @@
+/*
+ * Copyright (c) 2026, OpenJPEG contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS `AS IS'
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Test of the sequence decoder (opj_create_sequence_decoder()).
+ *
+ * Frames of different sizes, one of them not being a codestream, are
+ * decoded with several frames in flight, with and without a shared thread
+ * pool. They must be popped in the order they were pushed, and be the ones
+ * obtained with a decompressor per frame. Pushing more frames than allowed
+ * in flight must fail, and frames that are not popped must be released by
+ * opj_destroy_sequence_decoder().
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "test_common.h"
+
+#define NB_FRAMES     7
+#define BAD_FRAME     3
+
+static const char *tmpfile_name = "test_sequence_decoder_tmp.j2k";
+
+typedef struct {
+    OPJ_BYTE *data;
+    OPJ_SIZE_T size;
+} frame_t;
+
+static frame_t frames[NB_FRAMES];
+
+/* Encodes a frame, whose size depends on its index, and reads it back */
+static int encode(int frameno)
+{
+    opj_cparameters_t parameters;
+    opj_image_t *image;
+    OPJ_BOOL ok;
+
+    image = test_create_image(3, 160 + 16 * (OPJ_UINT32)frameno,
+                              120 + 8 * (OPJ_UINT32)frameno,
+                              (OPJ_UINT32)frameno);
+    if (!image) {
+        return 1;
+    }
+
+    opj_set_default_encoder_parameters(&parameters);
+    parameters.tcp_numlayers = 1;
+    parameters.cp_disto_alloc = 1;
+    parameters.tcp_rates[0] = 0;
+    parameters.tcp_mct = 1;
+    parameters.tile_size_on = OPJ_TRUE;
+    parameters.cp_tdx = 128;
+    parameters.cp_tdy = 128;
+    parameters.cblockw_init = 32;
+    parameters.cblockh_init = 32;
+
+    ok = test_encode(OPJ_CODEC_J2K, &parameters, image, NULL, tmpfile_name);
+    opj_image_destroy(image);
+    if (!ok) {
+        return 1;
+    }
+    frames[frameno].data = test_read_file(tmpfile_name, &frames[frameno].size);
+    return frames[frameno].data != NULL ? 0 : 1;
+}
+
+/* Decodes a frame with a decompressor of its own */
+static opj_image_t* decode(int frameno)
+{
+    opj_codec_t *codec;
+    opj_stream_t *stream;
+    opj_image_t *image = NULL;
+    OPJ_BOOL ok = OPJ_FALSE;
+
+    stream = opj_stream_create_memory_stream(frames[frameno].data,
+             frames[frameno].size);
+    codec = test_create_decompress(OPJ_CODEC_J2K, NULL, NULL);
+    if (stream && codec && opj_read_header(stream, codec, &image)) {
+        ok = opj_decode(codec, stream, image) &&
+             opj_end_decompress(codec, stream);
+    }
+    opj_destroy_codec(codec);
+    opj_stream_destroy(stream);
+    if (!ok) {
+        opj_image_destroy(image);
+        return NULL;
+    }
+    return image;
+}
+
+/* Checks the next frame popped from the sequence decoder */
+static int check_pop(opj_sequence_decoder_t *decoder, int frameno,
+                     const char *name)
+{
+    opj_image_t *image = NULL;
+    opj_image_t *ref;
+    OPJ_BOOL ok;
+    int ret = 0;
+
+    ok = opj_sequence_decoder_pop(decoder, &image);
+    if (frameno == BAD_FRAME) {
+        if (ok || image != NULL) {
+            fprintf(stderr, "%s: frame %d should have failed\n", name, frameno);
+            ret = 1;
+        }
+        opj_image_destroy(image);
+        return ret;
+    }
+    ref = decode(frameno);
+    if (!ok || !image || !ref) {
+        fprintf(stderr, "%s: decoding of frame %d failed\n", name, frameno);
+        ret = 1;
+    } else if (!test_same_images(ref, image)) {
+        fprintf(stderr, "%s: decoded frame %d differs\n", name, frameno);
+        ret = 1;
+    }
+    opj_image_destroy(ref);
+    opj_image_destroy(image);
+    return ret;
+}
+
+static int test_sequence(int nb_threads, OPJ_UINT32 frames_in_flight)
+{
+    opj_dparameters_t parameters;
+    opj_thread_pool_t *tp = NULL;
+    opj_sequence_decoder_t *decoder;
+    opj_image_t *image = NULL;
+    int pushed = 0, popped = 0;
+    int ret = 0;
+    char name[64];
+
+    sprintf(name, "threads=%d in_flight=%u", nb_threads, frames_in_flight);
+
+    if (nb_threads > 0) {
+        tp = opj_create_thread_pool(nb_threads);
+        if (!tp) {
+            /* No thread support */
+            return 0;
+        }
+    }
+    opj_set_default_decoder_parameters(&parameters);
+    decoder = opj_create_sequence_decoder(OPJ_CODEC_J2K, &parameters, tp,
+                                          frames_in_flight);
+    /* The decoder keeps the thread pool alive */
+    opj_destroy_thread_pool(tp);
+    if (!decoder) {
+        fprintf(stderr, "%s: cannot create the sequence decoder\n", name);
+        return 1;
+    }
+    opj_sequence_decoder_set_error_handler(decoder, test_quiet_callback, NULL);
+
+    if (opj_sequence_decoder_pop(decoder, &image) || image != NULL) {
+        fprintf(stderr, "%s: frame popped from an empty decoder\n", name);
+        ret = 1;
+    }
+
+    while (ret == 0 && popped < NB_FRAMES) {
+        while (pushed < NB_FRAMES &&
+                pushed - popped < (int)frames_in_flight) {
+            if (!opj_sequence_decoder_push(decoder, frames[pushed].data,
+                                           frames[pushed].size)) {
+                fprintf(stderr, "%s: cannot push frame %d\n", name, pushed);
+                ret = 1;
+                break;
+            }
+            pushed ++;
+        }
+        if (ret == 0 && pushed - popped == (int)frames_in_flight &&
+                opj_sequence_decoder_push(decoder, frames[0].data,
+                                          frames[0].size)) {
+            fprintf(stderr, "%s: too many frames in flight\n", name);
+            ret = 1;
+        }
+        if (ret == 0) {
+            ret = check_pop(decoder, popped, name);
+            popped ++;
+        }
+    }
+
+    /* Frames left in flight are discarded */
+    if (ret == 0) {
+        int i;
+        for (i = 0; i < (int)frames_in_flight; i++) {
+            if (!opj_sequence_decoder_push(decoder, frames[i % 2].data,
+                                           frames[i % 2].size)) {
+                fprintf(stderr, "%s: cannot push again\n", name);
+                ret = 1;
+            }
+        }
+    }
+    opj_destroy_sequence_decoder(decoder);
+    return ret;
+}
+
+int main(int argc, char *argv[])
+{
+    static const char bad_frame[] = "not a JPEG 2000 codestream";
+    int ret = 0;
+    int frameno;
+
+    (void)argc;
+    (void)argv;
+
+    for (frameno = 0; frameno < NB_FRAMES; ++frameno) {
+        if (frameno == BAD_FRAME) {
+            frames[frameno].data = (OPJ_BYTE *)malloc(sizeof(bad_frame));
+            if (!frames[frameno].data) {
+                return 1;
+            }
+            memcpy(frames[frameno].data, bad_frame, sizeof(bad_frame));
+            frames[frameno].size = sizeof(bad_frame);
+        } else if (encode(frameno) != 0) {
+            fprintf(stderr, "Encoding failed\n");
+            return 1;
+        }
+    }
+    remove(tmpfile_name);
+
+    ret |= test_sequence(0, 1);
+    ret |= test_sequence(0, 4);
+    ret |= test_sequence(2, 1);
+    ret |= test_sequence(2, 3);
+    ret |= test_sequence(4, NB_FRAMES + 1);
+
+    for (frameno = 0; frameno < NB_FRAMES; ++frameno) {
+        free(frames[frameno].data);
+    }
+    if (ret == 0) {
+        printf("All tests passed\n");
+    }
+    return ret;
+}
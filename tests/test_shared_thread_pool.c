@@ -0,0 +1,173 @@
+/*
+ * Copyright (c) 2026, OpenJPEG contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS `AS IS'
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Test of opj_create_thread_pool() / opj_codec_set_thread_pool().
+ *
+ * An image is encoded with a compressor attached to a shared thread pool,
+ * and then decoded by several decompressors attached to the same thread
+ * pool, the pool itself being destroyed before the codecs. The decoded
+ * samples must match the ones of a decode that does not use threads.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "test_common.h"
+
+#define IMAGE_W      300
+#define IMAGE_H      200
+#define TILE_W       64
+#define TILE_H       64
+#define NUM_COMPS     3
+#define NUM_DECODERS  3
+
+static const char *tmpfile_name = "test_shared_thread_pool_tmp.j2k";
+
+static int encode(opj_thread_pool_t *tp)
+{
+    opj_cparameters_t parameters;
+    opj_image_t *image;
+    opj_codec_t *codec;
+    int ret = 1;
+
+    image = test_create_image(NUM_COMPS, IMAGE_W, IMAGE_H, 1);
+    if (!image) {
+        return 1;
+    }
+
+    opj_set_default_encoder_parameters(&parameters);
+    parameters.tcp_numlayers = 1;
+    parameters.cp_disto_alloc = 1;
+    parameters.tcp_rates[0] = 4;
+    parameters.irreversible = 1;
+    parameters.tile_size_on = OPJ_TRUE;
+    parameters.cp_tdx = TILE_W;
+    parameters.cp_tdy = TILE_H;
+    parameters.cblockw_init = 16;
+    parameters.cblockh_init = 16;
+
+    codec = test_create_compress(OPJ_CODEC_J2K, &parameters, image, NULL);
+    if (codec != NULL && opj_codec_set_thread_pool(codec, tp) &&
+            test_compress(codec, image, tmpfile_name)) {
+        ret = 0;
+    }
+    opj_destroy_codec(codec);
+    opj_image_destroy(image);
+    return ret;
+}
+
+/* Creates a decompressor and reads the header. If tp is not NULL, the */
+/* decompressor is attached to it. */
+static opj_codec_t *open_decoder(opj_thread_pool_t *tp,
+                                 opj_stream_t **p_stream,
+                                 opj_image_t **p_image)
+{
+    opj_codec_t *codec = test_create_decompress(OPJ_CODEC_J2K, NULL, NULL);
+
+    if (codec != NULL &&
+            ((tp != NULL && !opj_codec_set_thread_pool(codec, tp)) ||
+             !test_read_header(codec, tmpfile_name, p_stream, p_image))) {
+        opj_destroy_codec(codec);
+        return NULL;
+    }
+    return codec;
+}
+
+static int decode(opj_codec_t *codec, opj_stream_t *stream,
+                  opj_image_t *image)
+{
+    return (opj_decode(codec, stream, image) &&
+            opj_end_decompress(codec, stream)) ? 0 : 1;
+}
+
+int main(void)
+{
+    opj_thread_pool_t *tp;
+    opj_codec_t *codecs[NUM_DECODERS];
+    opj_stream_t *streams[NUM_DECODERS];
+    opj_image_t *images[NUM_DECODERS];
+    opj_codec_t *ref_codec;
+    opj_stream_t *ref_stream;
+    opj_image_t *ref_image = NULL;
+    int i;
+    int ret = 0;
+
+    tp = opj_create_thread_pool(4);
+    if (tp == NULL) {
+        if (!opj_has_thread_support()) {
+            printf("No thread support: skipping test\n");
+            return 0;
+        }
+        fprintf(stderr, "opj_create_thread_pool() failed\n");
+        return 1;
+    }
+
+    if (encode(tp) != 0) {
+        fprintf(stderr, "encoding failed\n");
+        opj_destroy_thread_pool(tp);
+        return 1;
+    }
+
+    ref_codec = open_decoder(NULL, &ref_stream, &ref_image);
+    if (!ref_codec || decode(ref_codec, ref_stream, ref_image) != 0) {
+        fprintf(stderr, "reference decoding failed\n");
+        opj_destroy_thread_pool(tp);
+        return 1;
+    }
+    opj_stream_destroy(ref_stream);
+    opj_destroy_codec(ref_codec);
+
+    for (i = 0; i < NUM_DECODERS; ++i) {
+        images[i] = NULL;
+        codecs[i] = open_decoder(tp, &streams[i], &images[i]);
+        if (!codecs[i]) {
+            fprintf(stderr, "cannot open decoder %d\n", i);
+            return 1;
+        }
+    }
+
+    /* The codecs hold a reference on the thread pool */
+    opj_destroy_thread_pool(tp);
+
+    for (i = 0; i < NUM_DECODERS; ++i) {
+        if (decode(codecs[i], streams[i], images[i]) != 0) {
+            fprintf(stderr, "decoding failed for decoder %d\n", i);
+            ret = 1;
+        } else if (!test_same_images(ref_image, images[i])) {
+            fprintf(stderr, "decoder %d does not match the reference\n", i);
+            ret = 1;
+        }
+        opj_stream_destroy(streams[i]);
+        opj_destroy_codec(codecs[i]);
+        opj_image_destroy(images[i]);
+    }
+
+    opj_image_destroy(ref_image);
+    remove(tmpfile_name);
+    return ret;
+}
@@ -0,0 +1,259 @@
+/*
+ * Copyright (c) 2026, OpenJPEG contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS `AS IS'
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Test of the SIMD kernels selected at runtime.
+ *
+ * The test is run once per value of the OPJ_SIMD_LEVEL environment
+ * variable. Images whose dimensions and origins exercise the vector loops
+ * and their scalar tails are encoded and decoded back, with the regular and
+ * the HT code-block coders. Reversible codestreams must decode to the
+ * original samples. The samples decoded from irreversible codestreams are
+ * written to a reference file by the "write" run, and the "compare" runs
+ * check that the other kernels decode the same values (up to a rounding
+ * difference).
+ *
+ * Usage: test_simd_dispatch write|compare <reference file>
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "test_common.h"
+
+typedef struct {
+    OPJ_UINT32 numcomps;
+    OPJ_UINT32 prec;
+    int irreversible;
+    int cblk_size;
+    int tile_size;
+    int numresolution;
+    OPJ_UINT32 x0, y0, w, h;
+    int cblk_sty;
+} test_case_t;
+
+static const test_case_t test_cases[] = {
+    { 1, 8, 0, 64, 0, 6, 0, 0, 203, 117, 0 },
+    { 3, 8, 0, 32, 64, 6, 0, 0, 203, 117, 0 },
+    { 1, 12, 0, 4, 0, 6, 0, 0, 67, 45, 0 },
+    { 1, 8, 0, 64, 0, 6, 3, 5, 131, 71, 0 },
+    { 1, 8, 0, 16, 0, 3, 0, 0, 7, 300, 0 },
+    { 3, 8, 1, 64, 0, 6, 0, 0, 203, 117, 0 },
+    { 1, 12, 1, 16, 64, 6, 1, 2, 150, 97, 0 },
+    { 1, 8, 1, 8, 0, 2, 0, 0, 37, 3, 0 },
+    /* HT code-blocks */
+    { 3, 8, 0, 64, 0, 6, 0, 0, 203, 117, 64 },
+    { 1, 16, 0, 32, 0, 1, 3, 5, 131, 71, 64 },
+    { 1, 8, 0, 4, 0, 2, 0, 0, 37, 3, 64 },
+    { 3, 12, 1, 64, 64, 6, 1, 2, 150, 97, 64 }
+};
+
+static char tmpfile_name[64];
+
+/* Creates an image made of a gradient followed by noise */
+static opj_image_t *create_test_image(const test_case_t *tc)
+{
+    opj_image_cmptparm_t cmptparm[3];
+    opj_image_t *image;
+    OPJ_UINT32 compno, x, y;
+    OPJ_UINT32 seed = 4321;
+    OPJ_INT32 maxval = (OPJ_INT32)((1U << tc->prec) - 1);
+
+    memset(cmptparm, 0, sizeof(cmptparm));
+    for (compno = 0; compno < tc->numcomps; ++compno) {
+        cmptparm[compno].dx = 1;
+        cmptparm[compno].dy = 1;
+        cmptparm[compno].x0 = tc->x0;
+        cmptparm[compno].y0 = tc->y0;
+        cmptparm[compno].w = tc->w;
+        cmptparm[compno].h = tc->h;
+        cmptparm[compno].prec = tc->prec;
+    }
+
+    image = opj_image_create(tc->numcomps, cmptparm,
+                             tc->numcomps == 3 ? OPJ_CLRSPC_SRGB : OPJ_CLRSPC_GRAY);
+    if (!image) {
+        return NULL;
+    }
+    image->x0 = tc->x0;
+    image->y0 = tc->y0;
+    image->x1 = tc->x0 + tc->w;
+    image->y1 = tc->y0 + tc->h;
+
+    for (compno = 0; compno < tc->numcomps; ++compno) {
+        for (y = 0; y < tc->h; ++y) {
+            for (x = 0; x < tc->w; ++x) {
+                OPJ_INT32 v;
+                if (y < tc->h / 2) {
+                    v = (OPJ_INT32)((((x + y + compno * 17) % tc->w) *
+                                     (OPJ_UINT32)maxval) / tc->w);
+                } else {
+                    seed = seed * 1103515245U + 12345U;
+                    v = (OPJ_INT32)((seed >> 8) & (OPJ_UINT32)maxval);
+                }
+                image->comps[compno].data[y * tc->w + x] = v;
+            }
+        }
+    }
+    return image;
+}
+
+static int encode(opj_image_t *image, const test_case_t *tc)
+{
+    opj_cparameters_t parameters;
+
+    opj_set_default_encoder_parameters(&parameters);
+    parameters.irreversible = tc->irreversible;
+    parameters.cblockw_init = tc->cblk_size;
+    parameters.cblockh_init = tc->cblk_size;
+    parameters.numresolution = tc->numresolution;
+    parameters.mode = tc->cblk_sty;
+    parameters.image_offset_x0 = (int)tc->x0;
+    parameters.image_offset_y0 = (int)tc->y0;
+    if (tc->tile_size) {
+        parameters.tile_size_on = OPJ_TRUE;
+        parameters.cp_tdx = tc->tile_size;
+        parameters.cp_tdy = tc->tile_size;
+        parameters.cp_tx0 = (int)tc->x0;
+        parameters.cp_ty0 = (int)tc->y0;
+    }
+    return test_encode(OPJ_CODEC_J2K, &parameters, image, NULL,
+                       tmpfile_name) ? 0 : 1;
+}
+
+/* Writes the samples of an irreversible case to the reference file, or */
+/* compares them with it */
+static int check_reference(FILE *ref, int write_ref, const opj_image_t *image)
+{
+    OPJ_UINT32 compno;
+
+    for (compno = 0; compno < image->numcomps; ++compno) {
+        const opj_image_comp_t *comp = &image->comps[compno];
+        size_t i, count = (size_t)comp->w * comp->h;
+        for (i = 0; i < count; ++i) {
+            OPJ_INT32 expected;
+            if (write_ref) {
+                if (fwrite(&comp->data[i], sizeof(OPJ_INT32), 1, ref) != 1) {
+                    return 1;
+                }
+                continue;
+            }
+            if (fread(&expected, sizeof(OPJ_INT32), 1, ref) != 1) {
+                fprintf(stderr, "reference file too short\n");
+                return 1;
+            }
+            if (abs(expected - comp->data[i]) > 1) {
+                fprintf(stderr, "comp %u sample %u: %d instead of %d\n",
+                        compno, (unsigned)i, comp->data[i], expected);
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+static int test_round_trip(const test_case_t *tc, FILE *ref, int write_ref)
+{
+    opj_image_t *image, *decoded;
+    OPJ_UINT32 compno;
+    int ret = 1;
+
+    image = create_test_image(tc);
+    if (!image) {
+        return 1;
+    }
+    if (encode(image, tc) != 0) {
+        fprintf(stderr, "encoding failed\n");
+    } else if (opj_image_destroy(image),
+               (image = create_test_image(tc)) == NULL) {
+        /* the encoder may release the sample buffers it consumed */
+        return 1;
+    } else if ((decoded = test_decode_file(tmpfile_name,
+                                           OPJ_CODEC_J2K)) == NULL) {
+        fprintf(stderr, "decoding failed\n");
+    } else {
+        ret = 0;
+        if (decoded->numcomps != tc->numcomps) {
+            ret = 1;
+        }
+        for (compno = 0; ret == 0 && compno < tc->numcomps; ++compno) {
+            const opj_image_comp_t *comp = &decoded->comps[compno];
+            if (comp->w != tc->w || comp->h != tc->h) {
+                ret = 1;
+            } else if (!tc->irreversible &&
+                       memcmp(comp->data, image->comps[compno].data,
+                              (size_t)tc->w * tc->h * sizeof(OPJ_INT32)) != 0) {
+                fprintf(stderr, "reversible decoding is not lossless\n");
+                ret = 1;
+            }
+        }
+        if (ret == 0 && tc->irreversible) {
+            ret = check_reference(ref, write_ref, decoded);
+        }
+        opj_image_destroy(decoded);
+    }
+    if (ret) {
+        fprintf(stderr, "failure with numcomps=%u prec=%u irreversible=%d "
+                "cblk=%d tile=%d origin=%u,%u size=%ux%u cblk_sty=%d\n",
+                tc->numcomps, tc->prec, tc->irreversible, tc->cblk_size,
+                tc->tile_size, tc->x0, tc->y0, tc->w, tc->h, tc->cblk_sty);
+    }
+    opj_image_destroy(image);
+    return ret;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *level = getenv("OPJ_SIMD_LEVEL");
+    FILE *ref;
+    int write_ref;
+    size_t i;
+    int ret = 0;
+
+    if (argc != 3 || (strcmp(argv[1], "write") != 0 &&
+                      strcmp(argv[1], "compare") != 0)) {
+        fprintf(stderr, "usage: %s write|compare <reference file>\n", argv[0]);
+        return 1;
+    }
+    write_ref = strcmp(argv[1], "write") == 0;
+    ref = fopen(argv[2], write_ref ? "wb" : "rb");
+    if (!ref) {
+        fprintf(stderr, "cannot open %s\n", argv[2]);
+        return 1;
+    }
+    /* One codestream per level, as the tests may run concurrently */
+    sprintf(tmpfile_name, "test_simd_dispatch_%.16s.j2k",
+            level ? level : "default");
+
+    for (i = 0; i < sizeof(test_cases) / sizeof(test_cases[0]); ++i) {
+        ret |= test_round_trip(&test_cases[i], ref, write_ref);
+    }
+
+    fclose(ref);
+    remove(tmpfile_name);
+    return ret;
+}
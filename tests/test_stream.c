@@ -0,0 +1,289 @@
+/*
+ * Copyright (c) 2026, OpenJPEG contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS `AS IS'
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Test of the streams reading a codestream without copying it to the
+ * buffers of a file stream.
+ *
+ * Usage: test_stream memory|prefetch
+ *
+ * - memory: opj_stream_create_memory_stream() and
+ *   opj_stream_create_mapped_file_stream(). Images are decoded from a file
+ *   stream, from a memory stream and from a mapped file stream, with and
+ *   without threads. The memory streams read the data in place: the mapped
+ *   file is read-only, so that any write to the compressed data would
+ *   crash.
+ * - prefetch: opj_stream_create_prefetch_file_stream(). A tiled image with
+ *   TLM markers is decoded from prefetching file streams with several
+ *   read-ahead windows, as a whole and in sub-areas for which the
+ *   tile-parts to read are planned from the TLM markers.
+ *
+ * The decoded samples must be the ones decoded from a file stream.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "test_common.h"
+
+#define IMAGE_W      300
+#define IMAGE_H      200
+
+typedef enum {
+    FILE_STREAM,
+    MEMORY_STREAM,
+    MAPPED_STREAM,
+    PREFETCH_STREAM
+} stream_kind_t;
+
+/* Encodes the test image, with tiles of tile_size if it is not zero, one */
+/* tile-part per resolution if split_tile_parts is set, and TLM markers if */
+/* tlm is set */
+static OPJ_BOOL encode(const char *filename, OPJ_CODEC_FORMAT format,
+                       OPJ_UINT32 tile_size, OPJ_BOOL split_tile_parts,
+                       OPJ_BOOL tlm)
+{
+    const char* const options[] = { "TLM=YES", NULL };
+    opj_cparameters_t parameters;
+    opj_image_t *image = test_create_image(3, IMAGE_W, IMAGE_H, 1);
+    OPJ_BOOL ret;
+
+    opj_set_default_encoder_parameters(&parameters);
+    parameters.tcp_numlayers = 1;
+    parameters.cp_disto_alloc = 1;
+    parameters.tcp_rates[0] = 0;
+    if (tile_size) {
+        parameters.tile_size_on = OPJ_TRUE;
+        parameters.cp_tdx = (int)tile_size;
+        parameters.cp_tdy = (int)tile_size;
+    }
+    if (split_tile_parts) {
+        parameters.tp_on = 1;
+        parameters.tp_flag = 'R';
+    }
+    ret = image != NULL && test_encode(format, &parameters, image,
+                                       tlm ? options : NULL, filename);
+    opj_image_destroy(image);
+    return ret;
+}
+
+/* Decodes the area (x0, y0, x1, y1), or the whole image if x1 is 0, with */
+/* the given kind of stream. window is the read-ahead window of a */
+/* prefetching stream. Returns NULL on failure */
+static opj_image_t *decode(const char *filename, OPJ_CODEC_FORMAT format,
+                           stream_kind_t kind, OPJ_SIZE_T window,
+                           int num_threads, OPJ_INT32 x0, OPJ_INT32 y0,
+                           OPJ_INT32 x1, OPJ_INT32 y1)
+{
+    opj_codec_t *codec;
+    opj_stream_t *stream = NULL;
+    opj_image_t *image = NULL;
+    OPJ_BYTE *data = NULL;
+    OPJ_SIZE_T size = 0;
+    OPJ_BOOL ok = OPJ_FALSE;
+
+    switch (kind) {
+    case FILE_STREAM:
+        stream = opj_stream_create_default_file_stream(filename, OPJ_TRUE);
+        break;
+    case MEMORY_STREAM:
+        data = test_read_file(filename, &size);
+        if (data) {
+            stream = opj_stream_create_memory_stream(data, size);
+        }
+        break;
+    case MAPPED_STREAM:
+        stream = opj_stream_create_mapped_file_stream(filename);
+        break;
+    case PREFETCH_STREAM:
+        stream = opj_stream_create_prefetch_file_stream(filename, window);
+        break;
+    }
+    codec = test_create_decompress(format, NULL, NULL);
+    if (stream && codec &&
+            opj_codec_set_threads(codec, num_threads) &&
+            opj_read_header(stream, codec, &image) &&
+            (x1 == 0 || opj_set_decode_area(codec, image, x0, y0, x1, y1)) &&
+            opj_decode(codec, stream, image) &&
+            opj_end_decompress(codec, stream)) {
+        ok = OPJ_TRUE;
+    }
+    opj_destroy_codec(codec);
+    opj_stream_destroy(stream);
+    free(data);
+    if (!ok) {
+        opj_image_destroy(image);
+        return NULL;
+    }
+    return image;
+}
+
+/* -------------------------------------------------------------------------- */
+/* memory */
+
+static int test_memory_file(const char *filename, OPJ_CODEC_FORMAT format,
+                            OPJ_UINT32 tile_size, OPJ_BOOL split_tile_parts)
+{
+    static const stream_kind_t kinds[] = { MEMORY_STREAM, MAPPED_STREAM };
+    opj_image_t *ref;
+    int ret = 0;
+    size_t i;
+    int num_threads;
+
+    if (!encode(filename, format, tile_size, split_tile_parts, OPJ_FALSE)) {
+        fprintf(stderr, "encoding of %s failed\n", filename);
+        return 1;
+    }
+    ref = decode(filename, format, FILE_STREAM, 0, 1, 0, 0, 0, 0);
+    if (!ref) {
+        fprintf(stderr, "decoding of %s from a file stream failed\n", filename);
+        return 1;
+    }
+    for (i = 0; i < sizeof(kinds) / sizeof(kinds[0]); i++) {
+        for (num_threads = 1; num_threads <= 2; num_threads++) {
+            opj_image_t *image = decode(filename, format, kinds[i], 0,
+                                        num_threads, 0, 0, 0, 0);
+            if (!image || !test_same_images(ref, image)) {
+                fprintf(stderr, "decoding of %s (tile_size=%u, "
+                        "split_tile_parts=%d) from stream kind %d with "
+                        "%d thread(s) failed\n", filename, tile_size,
+                        split_tile_parts, (int)kinds[i], num_threads);
+                ret = 1;
+            }
+            opj_image_destroy(image);
+        }
+    }
+    opj_image_destroy(ref);
+    remove(filename);
+    return ret;
+}
+
+static int test_memory(void)
+{
+    const char *j2k_name = "test_stream_memory_tmp.j2k";
+    const char *jp2_name = "test_stream_memory_tmp.jp2";
+    opj_stream_t *stream;
+    int ret = 0;
+
+    /* Empty and missing data */
+    stream = opj_stream_create_memory_stream(NULL, 0);
+    if (!stream) {
+        fprintf(stderr, "cannot create an empty memory stream\n");
+        return 1;
+    }
+    opj_stream_destroy(stream);
+    if (opj_stream_create_memory_stream(NULL, 1) != NULL ||
+            opj_stream_create_mapped_file_stream("does_not_exist.j2k") != NULL) {
+        fprintf(stderr, "stream created on invalid data\n");
+        return 1;
+    }
+
+    ret |= test_memory_file(j2k_name, OPJ_CODEC_J2K, 0, OPJ_FALSE);
+    ret |= test_memory_file(j2k_name, OPJ_CODEC_J2K, 64, OPJ_FALSE);
+    ret |= test_memory_file(j2k_name, OPJ_CODEC_J2K, 64, OPJ_TRUE);
+    ret |= test_memory_file(jp2_name, OPJ_CODEC_JP2, 128, OPJ_TRUE);
+    return ret;
+}
+
+/* -------------------------------------------------------------------------- */
+/* prefetch */
+
+static int test_prefetch(void)
+{
+    const char *name = "test_stream_prefetch_tmp.j2k";
+    /* Whole image, areas within a tile, across tiles and at the bottom */
+    /* right corner */
+    static const OPJ_INT32 areas[][4] = {
+        { 0, 0, 0, 0 },
+        { 10, 10, 50, 50 },
+        { 50, 40, 210, 150 },
+        { 250, 190, 300, 200 }
+    };
+    /* Read-ahead windows: smaller than a tile-part, a few tile-parts, */
+    /* and the default */
+    static const OPJ_SIZE_T windows[] = { 256, 16384, 0 };
+    size_t i, j;
+    int ret = 0;
+
+    if (!encode(name, OPJ_CODEC_J2K, 64, OPJ_TRUE, OPJ_TRUE)) {
+        fprintf(stderr, "encoding failed\n");
+        return 1;
+    }
+
+    if (opj_stream_create_prefetch_file_stream("does_not_exist.j2k", 0) != NULL) {
+        fprintf(stderr, "stream created for a missing file\n");
+        ret = 1;
+    }
+
+    for (i = 0; i < sizeof(areas) / sizeof(areas[0]); ++i) {
+        opj_image_t *ref = decode(name, OPJ_CODEC_J2K, FILE_STREAM, 0, 0,
+                                  areas[i][0], areas[i][1],
+                                  areas[i][2], areas[i][3]);
+        if (!ref) {
+            fprintf(stderr, "reference decoding failed for area %d\n", (int)i);
+            ret = 1;
+            continue;
+        }
+        for (j = 0; j < sizeof(windows) / sizeof(windows[0]); ++j) {
+            opj_image_t *image = decode(name, OPJ_CODEC_J2K, PREFETCH_STREAM,
+                                        windows[j], 0, areas[i][0], areas[i][1],
+                                        areas[i][2], areas[i][3]);
+            if (!image) {
+                fprintf(stderr, "decoding failed for area %d, window %d\n",
+                        (int)i, (int)windows[j]);
+                ret = 1;
+            } else if (!test_same_images(ref, image)) {
+                fprintf(stderr, "area %d, window %d does not match the reference\n",
+                        (int)i, (int)windows[j]);
+                ret = 1;
+            }
+            opj_image_destroy(image);
+        }
+        opj_image_destroy(ref);
+    }
+
+    remove(name);
+    return ret;
+}
+
+/* -------------------------------------------------------------------------- */
+
+int main(int argc, char *argv[])
+{
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s memory|prefetch\n", argv[0]);
+        return 1;
+    }
+    if (strcmp(argv[1], "memory") == 0) {
+        return test_memory();
+    }
+    if (strcmp(argv[1], "prefetch") == 0) {
+        return test_prefetch();
+    }
+    fprintf(stderr, "unknown test %s\n", argv[1]);
+    return 1;
+}
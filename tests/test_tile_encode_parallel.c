@@ -0,0 +1,200 @@
+/*
+ * Copyright (c) 2026, OpenJPEG contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS `AS IS'
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Test of the encoding of several tiles concurrently (TILES_IN_FLIGHT
+ * encoder option).
+ *
+ * Images made of several tiles are encoded with and without tile-parts,
+ * PLT markers and POC, by a single thread and then with several tiles in
+ * flight. The codestreams must be identical. With TLM markers, tiles are
+ * written in the order they are finished, so the codestreams are compared
+ * by decoding them.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "test_common.h"
+
+#define IMAGE_W     301
+#define IMAGE_H     217
+#define NB_COMPS    3
+
+typedef struct {
+    int tile_w;
+    int tile_h;
+    /* Whether the layers are allocated by rate, or the image is lossless */
+    OPJ_BOOL lossy;
+    /* Tile-part division: 0, 'R', 'L' or 'C' */
+    char tp_flag;
+    OPJ_BOOL poc;
+    OPJ_BOOL plt;
+    OPJ_BOOL tlm;
+} config_t;
+
+static const config_t configs[] = {
+    { 64, 64, OPJ_TRUE, 0, OPJ_FALSE, OPJ_FALSE, OPJ_FALSE },
+    { 100, 50, OPJ_FALSE, 0, OPJ_FALSE, OPJ_FALSE, OPJ_FALSE },
+    { 128, 96, OPJ_TRUE, 'R', OPJ_FALSE, OPJ_TRUE, OPJ_FALSE },
+    { 64, 128, OPJ_TRUE, 0, OPJ_TRUE, OPJ_FALSE, OPJ_FALSE },
+    { 80, 80, OPJ_TRUE, 'L', OPJ_FALSE, OPJ_FALSE, OPJ_FALSE },
+    { 64, 64, OPJ_TRUE, 'R', OPJ_FALSE, OPJ_FALSE, OPJ_TRUE },
+    { 96, 80, OPJ_FALSE, 0, OPJ_FALSE, OPJ_TRUE, OPJ_TRUE }
+};
+
+/* Encodes the test image to a file. Returns OPJ_FALSE in case of failure */
+static OPJ_BOOL encode(const config_t *config, int tiles_in_flight,
+                       const char *name)
+{
+    opj_cparameters_t parameters;
+    opj_image_t *image;
+    opj_codec_t *codec;
+    const char* options[4] = { NULL, NULL, NULL, NULL };
+    char tiles_in_flight_option[32];
+    int nb_options = 0;
+    OPJ_BOOL ret = OPJ_FALSE;
+
+    opj_set_default_encoder_parameters(&parameters);
+    parameters.tile_size_on = OPJ_TRUE;
+    parameters.cp_tdx = config->tile_w;
+    parameters.cp_tdy = config->tile_h;
+    parameters.cblockw_init = 32;
+    parameters.cblockh_init = 32;
+    parameters.numresolution = 4;
+    parameters.tcp_mct = 1;
+    parameters.tcp_numlayers = 3;
+    if (config->lossy) {
+        parameters.irreversible = 1;
+        parameters.tcp_rates[0] = 40;
+        parameters.tcp_rates[1] = 15;
+        parameters.tcp_rates[2] = 6;
+    } else {
+        parameters.tcp_rates[0] = 30;
+        parameters.tcp_rates[1] = 10;
+        parameters.tcp_rates[2] = 0;
+    }
+    parameters.cp_disto_alloc = 1;
+    if (config->tp_flag) {
+        parameters.tp_on = 1;
+        parameters.tp_flag = config->tp_flag;
+    }
+    if (config->poc) {
+        /* Resolutions 0 and 1 of layer 0 first, then everything else */
+        parameters.numpocs = 2;
+        parameters.POC[0].tile = 1;
+        parameters.POC[0].resno0 = 0;
+        parameters.POC[0].compno0 = 0;
+        parameters.POC[0].layno1 = 1;
+        parameters.POC[0].resno1 = 2;
+        parameters.POC[0].compno1 = NB_COMPS;
+        parameters.POC[0].prg1 = OPJ_CPRL;
+        parameters.POC[1].tile = 1;
+        parameters.POC[1].resno0 = 0;
+        parameters.POC[1].compno0 = 0;
+        parameters.POC[1].layno1 = 3;
+        parameters.POC[1].resno1 = 4;
+        parameters.POC[1].compno1 = NB_COMPS;
+        parameters.POC[1].prg1 = OPJ_LRCP;
+    }
+    if (config->plt) {
+        options[nb_options++] = "PLT=YES";
+    }
+    if (config->tlm) {
+        options[nb_options++] = "TLM=YES";
+    }
+    if (tiles_in_flight > 0) {
+        sprintf(tiles_in_flight_option, "TILES_IN_FLIGHT=%d", tiles_in_flight);
+        options[nb_options++] = tiles_in_flight_option;
+    }
+
+    image = test_create_image(NB_COMPS, IMAGE_W, IMAGE_H, 4321);
+    if (!image) {
+        return OPJ_FALSE;
+    }
+    codec = test_create_compress(OPJ_CODEC_J2K, &parameters, image, options);
+    if (codec != NULL) {
+        ret = opj_codec_set_threads(codec, tiles_in_flight > 0 ? 4 : 0) &&
+              test_compress(codec, image, name);
+    }
+    opj_destroy_codec(codec);
+    opj_image_destroy(image);
+    return ret;
+}
+
+static int same_decoded_images(const char *name1, const char *name2)
+{
+    opj_image_t *image1 = test_decode_file(name1, OPJ_CODEC_J2K);
+    opj_image_t *image2 = test_decode_file(name2, OPJ_CODEC_J2K);
+    int ret = image1 != NULL && image2 != NULL &&
+              test_same_images(image1, image2);
+
+    opj_image_destroy(image1);
+    opj_image_destroy(image2);
+    return ret;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *ref_name = "test_tile_encode_parallel_tmp0.j2k";
+    const char *name = "test_tile_encode_parallel_tmp1.j2k";
+    static const int tiles_in_flight[] = { 2, 5 };
+    size_t i, j;
+    int ret = 0;
+
+    (void)argc;
+    (void)argv;
+
+    for (i = 0; i < sizeof(configs) / sizeof(configs[0]); ++i) {
+        const config_t *config = &configs[i];
+
+        if (!encode(config, 0, ref_name)) {
+            fprintf(stderr, "Config %d: encoding failed\n", (int)i);
+            ret = 1;
+            continue;
+        }
+        for (j = 0; j < sizeof(tiles_in_flight) / sizeof(tiles_in_flight[0]); ++j) {
+            if (!encode(config, tiles_in_flight[j], name)) {
+                fprintf(stderr, "Config %d: encoding failed with %d tiles in flight\n",
+                        (int)i, tiles_in_flight[j]);
+                ret = 1;
+            } else if (config->tlm ? !same_decoded_images(ref_name, name) :
+                       !test_same_files(ref_name, name)) {
+                fprintf(stderr, "Config %d: codestreams differ with %d tiles in flight\n",
+                        (int)i, tiles_in_flight[j]);
+                ret = 1;
+            }
+        }
+    }
+
+    remove(ref_name);
+    remove(name);
+    if (ret == 0) {
+        printf("All tests passed\n");
+    }
+    return ret;
+}